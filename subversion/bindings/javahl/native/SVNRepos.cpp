@@ -269,9 +269,9 @@ void SVNRepos::hotcopy(File &path, File &targetPath,
       return;
     }
 
-  SVN_JNI_ERR(svn_repos_hotcopy3(path.getInternalStyle(requestPool),
+  SVN_JNI_ERR(svn_repos_hotcopy4(path.getInternalStyle(requestPool),
                                  targetPath.getInternalStyle(requestPool),
-                                 cleanLogs, incremental,
+                                 cleanLogs, incremental, 1 /* jobs */,
                                  notifyCallback != NULL
                                     ? ReposNotifyCallback::notify
                                     : NULL,
@@ -641,9 +641,10 @@ SVNRepos::verify(File &path, Revision &revisionStart, Revision &revisionEnd,
       (SVN_ERR_INCORRECT_PARAMS, NULL,
        _("Start revision cannot be higher than end revision")), );
 
-  SVN_JNI_ERR(svn_repos_verify_fs3(repos, lower, upper,
+  SVN_JNI_ERR(svn_repos_verify_fs4(repos, lower, upper,
                                    checkNormalization,
                                    metadataOnly,
+                                   1 /* jobs */,
                                    (!notifyCallback ? NULL
                                     : ReposNotifyCallback::notify),
                                    notifyCallback,
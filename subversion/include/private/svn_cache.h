@@ -292,7 +292,8 @@ svn_cache__make_memcache_from_config(svn_memcache_t **memcache_p,
  * @a thread_safe may be set to @c FALSE for maximum performance.
  *
  * There is no limit on the number of threads reading a given cache segment
- * concurrently.  Writes, however, need an exclusive lock on the respective
+ * concurrently.  Lookups usually don't even need to acquire the segment
+ * lock.  Writes, however, need an exclusive lock on the respective
  * segment.  @a allow_blocking_writes controls contention is handled here.
  * If set to TRUE, writes will wait until the lock becomes available, i.e.
  * reads should be short.  If set to FALSE, write attempts will be ignored
@@ -378,6 +379,69 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
                                   apr_pool_t *result_pool,
                                   apr_pool_t *scratch_pool);
 
+/**
+ * A memory-mapped file that keeps serialized cache items across process
+ * restarts.  It acts as an additional, persistent level underneath the
+ * in-memory levels of a membuffer cache.
+ *
+ * All access is thread-safe.  Multiple processes may map the same file;
+ * their writes get serialized by a lock on a separate lock file.
+ * Every item is checksummed, so partially written or otherwise corrupted
+ * items, e.g. after a crash, simply become cache misses.
+ */
+typedef struct svn_cache__file_tier_t svn_cache__file_tier_t;
+
+/**
+ * Open the persistent cache file at @a path in @a *tier, creating it with
+ * a size of @a size bytes if it does not exist yet.  Existing files keep
+ * their size.
+ *
+ * The file is bound to the repository identified by @a uuid and
+ * @a instance_id, whose youngest revision is @a youngest.  If it has been
+ * created for a different repository instance, by an incompatible
+ * version of this code or for a repository that had more revisions than
+ * @a youngest, it will be discarded and replaced by an empty file.
+ * Since other processes may still have the old file mapped, it never
+ * gets modified in that case.
+ *
+ * Return #SVN_ERR_UNSUPPORTED_FEATURE if memory-mapped files are not
+ * supported on this platform.  Allocate @a *tier in @a result_pool and
+ * keep the file mapped for the lifetime of that pool.  Use @a scratch_pool
+ * for temporary allocations.
+ */
+svn_error_t *
+svn_cache__file_tier_open(svn_cache__file_tier_t **tier,
+                          const char *path,
+                          apr_uint64_t size,
+                          const char *uuid,
+                          const char *instance_id,
+                          svn_revnum_t youngest,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_cache__create_membuffer_cache() but also store all items in
+ * @a file_tier and look them up there if they are not in @a membuffer.
+ * @a file_tier may be NULL.
+ *
+ * Only use this for immutable data.  Items in @a file_tier are identified
+ * by @a prefix and their key.  So, @a prefix must uniquely identify the
+ * repository and the type of data.
+ */
+svn_error_t *
+svn_cache__create_persistent_membuffer_cache(
+  svn_cache__t **cache_p,
+  svn_membuffer_t *membuffer,
+  svn_cache__file_tier_t *file_tier,
+  svn_cache__serialize_func_t serialize,
+  svn_cache__deserialize_func_t deserialize,
+  apr_ssize_t klen,
+  const char *prefix,
+  apr_uint32_t priority,
+  svn_boolean_t thread_safe,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool);
+
 /**
  * Creates a null-cache instance in @a *cache_p, allocated from
  * @a result_pool.  The given @c id is the only data stored in it and can
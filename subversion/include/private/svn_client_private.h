@@ -551,6 +551,42 @@ svn_client__wc_copy_mods(const char *src_wc_abspath,
                          svn_client_ctx_t *ctx,
                          apr_pool_t *scratch_pool);
 
+/** Callback type used with svn_client__blame_file_revs().  Report a
+ * sequence of file revisions to @a handler with @a handler_baton, just
+ * as svn_ra_get_file_revs2() would.  Use @a scratch_pool for temporary
+ * allocations.
+ */
+typedef svn_error_t *(*svn_client__file_revs_func_t)(
+  void *baton,
+  svn_file_rev_handler_t handler,
+  void *handler_baton,
+  apr_pool_t *scratch_pool);
+
+/** Like svn_client_blame6() but calculate the blame information for the
+ * file revisions reported by @a fetch_func with @a fetch_baton instead of
+ * fetching them from the repository.  @a target is only used for error
+ * messages, @a repos_root_url only for notifications.  @a start_revnum
+ * and @a end_revnum are the range to blame, as returned by
+ * svn_client_blame6().
+ *
+ * This allows for measuring the cost of the blame algorithm independently
+ * of the RA layer.
+ */
+svn_error_t *
+svn_client__blame_file_revs(const char *target,
+                            const char *repos_root_url,
+                            svn_revnum_t start_revnum,
+                            svn_revnum_t end_revnum,
+                            svn_client__file_revs_func_t fetch_func,
+                            void *fetch_baton,
+                            const svn_diff_file_options_t *diff_options,
+                            svn_boolean_t ignore_mime_type,
+                            svn_boolean_t include_merged_revisions,
+                            svn_client_blame_receiver4_t receiver,
+                            void *receiver_baton,
+                            svn_client_ctx_t *ctx,
+                            apr_pool_t *pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
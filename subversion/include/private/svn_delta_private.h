@@ -101,13 +101,59 @@ svn_delta__delta_from_editor(const svn_delta_editor_t **deditor,
                              struct svn_delta__extra_baton *exb,
                              apr_pool_t *pool);
 
+/** The largest source and target view size of a delta window that can
+    be represented in svndiff version 3.  Older svndiff versions are
+    limited to 100kB windows. */
+#define SVN_DELTA__MAX_WINDOW_SIZE (8 * 1024 * 1024)
+
+/** Return the largest source and target view size of a delta window
+    that can be represented in svndiff version @a svndiff_version. */
+apr_size_t
+svn_txdelta__max_window_size(int svndiff_version);
+
+/** Like svn_txdelta2() but use up to @a window_size bytes of source and
+    target data for each delta window.  Larger windows allow for matches
+    across a wider range of data at the expense of memory usage.
+
+    Windows larger than svn_txdelta__max_window_size(2) can only be
+    represented in svndiff version 3.  @a window_size must not exceed
+    #SVN_DELTA__MAX_WINDOW_SIZE.  Zero selects the default window size. */
+void
+svn_txdelta__create(svn_txdelta_stream_t **stream,
+                    svn_stream_t *source,
+                    svn_stream_t *target,
+                    svn_boolean_t calculate_checksum,
+                    apr_size_t window_size,
+                    apr_pool_t *pool);
+
+/** Like svn_txdelta_target_push() but use up to @a window_size bytes of
+    source and target data for each delta window.  The same restrictions
+    as for svn_txdelta__create() apply to @a window_size. */
+svn_stream_t *
+svn_txdelta__target_push(svn_txdelta_window_handler_t handler,
+                         void *handler_baton,
+                         svn_stream_t *source,
+                         apr_size_t window_size,
+                         apr_pool_t *pool);
+
 /** Read the txdelta window header from @a stream and return the total
-    length of the unparsed window data in @a *window_len. */
+    length of the unparsed window data in @a *window_len.  @a version is
+    the svndiff version of the data and determines the window size limits
+    to enforce. */
 svn_error_t *
 svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
+                                 int version,
                                  apr_pool_t *pool);
 
+/** If @a enable is FALSE, make the xdelta engine extend matches byte by
+    byte like it does on platforms that don't allow unaligned access.
+    Otherwise, compare whole machine words where possible (the default).
+    Both produce the same deltas.  This is meant for comparing their
+    performance in tests only and affects all threads. */
+void
+svn_txdelta__xdelta_set_word_matching(svn_boolean_t enable);
+
 /* Return a debug editor that wraps @a wrapped_editor.
  *
  * The debug editor simply prints an indication of what callbacks are being
@@ -353,6 +353,101 @@ typedef struct svn_fs_fs__ioctl_revision_size_output_t
 /* See svn_fs_fs__revision_size(). */
 SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_REVISION_SIZE, SVN_FS_TYPE_FSFS, 1003);
 
+typedef struct svn_fs_fs__ioctl_build_rep_cache_input_t
+{
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+  svn_fs_progress_notify_func_t progress_func;
+  void *progress_baton;
+} svn_fs_fs__ioctl_build_rep_cache_input_t;
+
+/* See svn_fs_fs__build_rep_cache(). */
+SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_BUILD_REP_CACHE, SVN_FS_TYPE_FSFS, 1004);
+
+/* Kinds of item accesses recorded in an FSFS access trace.
+ * See #SVN_FS_CONFIG_FSFS_ACCESS_TRACE.
+ */
+typedef enum svn_fs_fs__access_kind_t
+{
+  /* Node revision read. */
+  svn_fs_fs__access_noderev = 0,
+
+  /* Representation header read, i.e. start reading a representation. */
+  svn_fs_fs__access_rep_header,
+
+  /* Txdelta window read from a deltified representation. */
+  svn_fs_fs__access_delta_window,
+
+  /* Block of changed paths read. */
+  svn_fs_fs__access_changes
+} svn_fs_fs__access_kind_t;
+
+/* Number of distinct svn_fs_fs__access_kind_t values. */
+#define SVN_FS_FS__ACCESS_KIND_COUNT (svn_fs_fs__access_changes + 1)
+
+/* A single item access as recorded in an FSFS access trace file.
+ */
+typedef struct svn_fs_fs__access_record_t
+{
+  /* What has been accessed. */
+  svn_fs_fs__access_kind_t kind;
+
+  /* The item's revision and item index.  For delta windows, these identify
+   * the representation that the window belongs to. */
+  svn_revnum_t revision;
+  apr_uint64_t item_index;
+
+  /* Whether REVISION was stored in a pack file at the time of access. */
+  svn_boolean_t packed;
+
+  /* Offset of the data within the rev / pack file.  -1 if not known,
+   * e.g. because it got served from cache. */
+  apr_off_t offset;
+
+  /* Number of bytes read from the rev / pack file.  For representation
+   * headers, this is the on-disk size of the whole representation.
+   * 0 if not known. */
+  apr_uint64_t size;
+
+  /* Fulltext size of the representation for representation headers.
+   * 0 for all other kinds. */
+  apr_uint64_t expanded_size;
+
+  /* Index of the txdelta window within the representation for delta
+   * windows and index of the first change in the block for changed
+   * paths.  0 for all other kinds. */
+  apr_uint64_t sub_item;
+
+  /* Whether the access has been served from cache or memory without
+   * reading from the rev / pack file. */
+  svn_boolean_t cache_hit;
+
+  /* Time spent on the access in microseconds. */
+  apr_interval_time_t latency;
+} svn_fs_fs__access_record_t;
+
+/* Callback function type receiving the RECORDED item access from a trace
+ * file and the corresponding REPLAYED access, a user provided BATON and a
+ * SCRATCH_POOL for temporary allocations.  REPLAYED will be NULL if the
+ * access could not be replayed, e.g. because it refers to a delta window
+ * of a representation whose header access is not part of the trace.
+ */
+typedef svn_error_t *
+(*svn_fs_fs__replay_access_func_t)(const svn_fs_fs__access_record_t *recorded,
+                                   const svn_fs_fs__access_record_t *replayed,
+                                   void *baton,
+                                   apr_pool_t *scratch_pool);
+
+typedef struct svn_fs_fs__ioctl_replay_access_trace_input_t
+{
+  const char *trace_path;
+  svn_fs_fs__replay_access_func_t callback_func;
+  void *callback_baton;
+} svn_fs_fs__ioctl_replay_access_trace_input_t;
+
+/* See svn_fs_fs__replay_access_trace(). */
+SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_REPLAY_ACCESS_TRACE, SVN_FS_TYPE_FSFS, 1005);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -211,6 +211,33 @@ svn_fs__get_deleted_node(svn_fs_root_t **node_root,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool);
 
+/** Set @a *svndiff_p to a stream delivering the svndiff data that the
+ * backend stores for the contents of @a target_path under @a target_root
+ * as a delta against the contents of @a source_path under @a source_root
+ * and set @a *len_p to the length of that data.  If @a source_root is
+ * @c NULL, the delta shall be against the empty file.
+ *
+ * This is a shortcut for svn_fs_get_file_delta_stream() followed by
+ * svndiff encoding the result, avoiding any delta computation and
+ * re-compression.  Therefore, only data in svndiff version @a max_version
+ * or lower will be returned, and only if its delta base matches exactly.
+ * Otherwise, set @a *svndiff_p to @c NULL.  Backends that don't support
+ * this will always do the latter.
+ *
+ * Allocate the stream in @a result_pool and use @a scratch_pool for
+ * temporary allocations.
+ */
+svn_error_t *
+svn_fs__get_stored_svndiff(svn_stream_t **svndiff_p,
+                           svn_filesize_t *len_p,
+                           svn_fs_root_t *source_root,
+                           const char *source_path,
+                           svn_fs_root_t *target_root,
+                           const char *target_path,
+                           int max_version,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool);
+
 
 /** @} */
 
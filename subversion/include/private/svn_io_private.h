@@ -84,6 +84,22 @@ svn_error_t *
 svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool);
 
+/**
+ * Like svn_io_copy_file() but let the kernel copy the contents of @a src
+ * where the platform and file systems support it.  This may share the
+ * data blocks between @a src and @a dst (reflink) or use
+ * copy_file_range(), and falls back to a normal copy otherwise.
+ *
+ * Shared data blocks make later modifications of either file more
+ * expensive.  So, only use this for files that are not expected to be
+ * modified, e.g. when copying repositories.
+ */
+svn_error_t *
+svn_io__copy_file_in_kernel(const char *src,
+                            const char *dst,
+                            svn_boolean_t copy_perms,
+                            apr_pool_t *pool);
+
 
 /** Return the underlying file, if any, associated with the stream, or
  * NULL if not available.  Accessing the file bypasses the stream.
@@ -127,6 +143,82 @@ svn_stream__install_get_info(apr_finfo_t *finfo,
                              apr_int32_t wanted,
                              apr_pool_t *scratch_pool);
 
+/* Compression methods for block-compressed streams. */
+#define SVN_STREAM__BLOCK_COMPRESSION_ZLIB 1
+#define SVN_STREAM__BLOCK_COMPRESSION_LZ4  2
+
+/* Set *COMPRESSION to the block compression method named WORD, i.e.
+   "zlib" or "lz4".  Return SVN_ERR_BAD_COMPRESSION_METHOD for any other
+   WORD. */
+svn_error_t *
+svn_stream__parse_block_compression(int *compression,
+                                    const char *word);
+
+/* Return a writable stream that compresses all data written to it with
+   the block compression method COMPRESSION and writes the result to
+   STREAM.  Closing the returned stream will close STREAM as well.
+
+   The data gets split into blocks of up to 1 MB, each compressed
+   independently, such that up to JOBS threads can compress and later
+   decompress them concurrently.  The output starts with the magic bytes
+   "SVNZ", followed by a format version and the compression method byte.
+   Every block then consists of an svn__encode_uint() encoded header and
+   the svn__compress_zlib() or svn__compress_lz4() output as payload.  The
+   header is twice the payload length plus one if the block starts at a
+   record boundary (see svn_stream__block_boundary()).  A zero header
+   terminates the stream.
+
+   With thread support, full batches of blocks get compressed and written
+   to STREAM by a background thread, so the caller can produce the next
+   batch in the meantime, even if JOBS is 1.  STREAM must not be used by
+   anyone else until the returned stream has been closed.  Errors from
+   the background thread get reported by later writes and by closing the
+   returned stream.
+
+   Allocate the stream in RESULT_POOL. */
+svn_stream_t *
+svn_stream__block_compressed(svn_stream_t *stream,
+                             int compression,
+                             int jobs,
+                             apr_pool_t *result_pool);
+
+/* Tell the block-compressed STREAM that the data written next starts a
+   new record, e.g. a revision in a dump stream.  Unless the current block
+   is still small, it will be completed and the next block will be marked
+   as starting a record.  Readers may use these marks to skip to record
+   boundaries without decompressing the preceding blocks.
+
+   Do nothing if STREAM has not been created by
+   svn_stream__block_compressed(). */
+svn_error_t *
+svn_stream__block_boundary(svn_stream_t *stream);
+
+/* Return a readable stream that decompresses the data that
+   svn_stream__block_compressed() wrote to STREAM, using up to JOBS
+   threads.  If STREAM does not start with the respective magic bytes,
+   return its contents unchanged.  Closing the returned stream will close
+   STREAM as well.
+
+   Allocate the stream in RESULT_POOL. */
+svn_stream_t *
+svn_stream__block_decompressed(svn_stream_t *stream,
+                               int jobs,
+                               apr_pool_t *result_pool);
+
+/* Set *COMPRESSED to TRUE if the data in STREAM starts with the magic
+   bytes written by svn_stream__block_compressed() and to FALSE otherwise.
+   STREAM must support mark and seek; its read position does not change.
+
+   Callers may use this to wrap STREAM with
+   svn_stream__block_decompressed() only if necessary, because the
+   wrapper does not support mark and seek itself.
+
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_stream__is_block_compressed(svn_boolean_t *compressed,
+                                svn_stream_t *stream,
+                                apr_pool_t *scratch_pool);
+
 /* Internal version of svn_stream_from_aprfile2() supporting the
    additional TRUNCATE_ON_SEEK argument. */
 svn_stream_t *
@@ -135,6 +227,70 @@ svn_stream__from_aprfile(apr_file_t *file,
                          svn_boolean_t truncate_on_seek,
                          apr_pool_t *pool);
 
+/* Infrastructure for efficiently calling fsync on files and directories.
+ *
+ * The idea is to have a container of open file handles (including
+ * directory handles on POSIX), at most one per file.  During the course
+ * of an FS operation that needs to be fsync'ed, all touched files and
+ * folders accumulate in the container.
+ *
+ * At the end of the FS operation, all file changes will be written the
+ * physical disk, once per file and folder.  Afterwards, all handles will
+ * be closed and the container is ready for reuse.
+ *
+ * To minimize the delay caused by the batch flush, run all fsync calls
+ * concurrently - if the OS supports multi-threading.
+ */
+
+/* Opaque container type.
+ */
+typedef struct svn_io__batch_fsync_t svn_io__batch_fsync_t;
+
+/* Initialize the concurrent fsync infrastructure.  Clean it up when
+ * OWNING_POOL gets cleared.
+ *
+ * This function must be called before using any of the other functions in
+ * in this module.  Further calls have no effect.
+ */
+svn_error_t *
+svn_io__batch_fsync_init(apr_pool_t *owning_pool);
+
+/* Set *RESULT_P to a new batch fsync structure, allocated in RESULT_POOL.
+ * If FLUSH_TO_DISK is not set, the resulting struct will not actually use
+ * fsync. */
+svn_error_t *
+svn_io__batch_fsync_create(svn_io__batch_fsync_t **result_p,
+                           svn_boolean_t flush_to_disk,
+                           apr_pool_t *result_pool);
+
+/* Open the file at FILENAME for read and write access.  Return it in *FILE
+ * and schedule it for fsync in BATCH.  If BATCH already contains an open
+ * file for FILENAME, return that instead creating a new instance.
+ *
+ * Use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_io__batch_fsync_open_file(apr_file_t **file,
+                              svn_io__batch_fsync_t *batch,
+                              const char *filename,
+                              apr_pool_t *scratch_pool);
+
+/* Inform the BATCH that a file or directory has been created at PATH.
+ * "Created" means either newly created to renamed to PATH - even if another
+ * item with the same name existed before.  Depending on the OS, the correct
+ * path will scheduled for fsync.
+ *
+ * Use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_io__batch_fsync_new_path(svn_io__batch_fsync_t *batch,
+                             const char *path,
+                             apr_pool_t *scratch_pool);
+
+/* For all files and directories in BATCH, flush all changes to disk and
+ * close the file handles.  Use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_io__batch_fsync_run(svn_io__batch_fsync_t *batch,
+                        apr_pool_t *scratch_pool);
+
 #if defined(WIN32)
 
 /* ### Move to something like io.h or subr.h, to avoid making it
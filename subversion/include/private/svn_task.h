@@ -0,0 +1,140 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_task.h
+ * @brief Concurrent processing with ordered output
+ *
+ * Many long-running operations - verification, packing, dumping etc. -
+ * consist of a sequence of mostly independent work items whose results
+ * must be reported in a well-defined order.  This API allows the items
+ * to be processed by multiple worker threads while the results are being
+ * handed to an output function in the calling thread, one at a time and
+ * in strictly ascending item order.
+ *
+ * The number of items being processed or waiting for output at any given
+ * time is bounded, i.e. fast workers will not run arbitrarily far ahead
+ * of the output and the memory consumption remains in check.
+ *
+ * Without thread support in APR or if the caller asks for only a single
+ * job, all items get processed sequentially in the calling thread.  The
+ * results are the same in either case.
+ */
+
+#ifndef SVN_TASK_H
+#define SVN_TASK_H
+
+#include <apr.h>        /* for apr_int64_t */
+#include <apr_pools.h>  /* for apr_pool_t */
+
+#include "svn_types.h"
+#include "svn_error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+
+/* Construct the per-thread context in *THREAD_CONTEXT, allocated in
+ * RESULT_POOL, using BATON.  Typically, this opens private instances
+ * of objects that cannot be shared between threads, e.g. a svn_fs_t.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+typedef svn_error_t *
+(*svn_task__thread_context_constructor_t)(void **thread_context,
+                                          void *baton,
+                                          apr_pool_t *result_pool,
+                                          apr_pool_t *scratch_pool);
+
+/* Process the work item with number INDEX and return its result in
+ * *RESULT, allocated in RESULT_POOL.  THREAD_CONTEXT is the context
+ * object constructed for the current thread and PROCESS_BATON is the
+ * same for all calls.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * This function may get called from any thread.  CANCEL_FUNC with
+ * CANCEL_BATON, if not NULL, may be used to check for cancellation.
+ * When running concurrently, this is not the caller's cancellation
+ * function but a thread-safe one that reports whether the whole
+ * operation has been aborted.
+ *
+ * Returning an error aborts the whole operation.  Functions that want
+ * to report item-level problems and continue should pass them on
+ * as part of *RESULT instead.
+ */
+typedef svn_error_t *
+(*svn_task__process_func_t)(void **result,
+                            void *thread_context,
+                            void *process_baton,
+                            apr_int64_t index,
+                            svn_cancel_func_t cancel_func,
+                            void *cancel_baton,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/* Handle the RESULT produced for the work item with number INDEX.
+ * OUTPUT_BATON is the same for all calls.  Use SCRATCH_POOL for
+ * temporary allocations.
+ *
+ * This function will only be called from the thread that called
+ * svn_task__run() and it will be called in ascending INDEX order.
+ * Returning an error aborts the whole operation.
+ */
+typedef svn_error_t *
+(*svn_task__output_func_t)(void *result,
+                           void *output_baton,
+                           apr_int64_t index,
+                           apr_pool_t *scratch_pool);
+
+/* Process the work items 0 ... COUNT-1 using up to CONCURRENCY threads.
+ *
+ * Each thread will first call CONTEXT_CONSTRUCTOR with CONTEXT_BATON,
+ * if the former is not NULL, and then call PROCESS_FUNC with
+ * PROCESS_BATON for as many items as it can get.  OUTPUT_FUNC, if not
+ * NULL, will be called with OUTPUT_BATON for each item's result in item
+ * order.  The result memory will be released right after that.
+ *
+ * CANCEL_FUNC with CANCEL_BATON will be called between output calls and
+ * periodically while waiting for results.  It will only be called from
+ * the current thread and need not be thread-safe.  PROCESS_FUNC gets
+ * CANCEL_FUNC only if all work is done in the current thread.
+ *
+ * If CONCURRENCY is less than 2, all work will be done in the current
+ * thread.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_task__run(int concurrency,
+              apr_int64_t count,
+              svn_task__thread_context_constructor_t context_constructor,
+              void *context_baton,
+              svn_task__process_func_t process_func,
+              void *process_baton,
+              svn_task__output_func_t output_func,
+              void *output_baton,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_TASK_H */
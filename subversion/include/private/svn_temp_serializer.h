@@ -48,6 +48,14 @@ struct svn_stringbuf_t;
  */
 #define SVN_TEMP_SERIALIZER__OVERHEAD (sizeof(svn_stringbuf_t) + 1)
 
+/**
+ * Version of the data layout produced by the serialization functions.
+ * Serialized data may outlive the process when stored in a persistent
+ * cache.  Bump this whenever the serialization functions of this API or
+ * of any persistently cached item type change their output.
+ */
+#define SVN_TEMP_SERIALIZER__FORMAT 1
+
 /**
  * Opaque structure controlling the serialization process and holding the
  * intermediate as well as final results.
@@ -526,7 +526,10 @@ svn_txdelta_apply(svn_stream_t *source,
  *
  * @since New in 1.7.  Since 1.10, @a svndiff_version can be 2 for the
  * svndiff2 format.  @a compression_level is currently ignored if
- * @a svndiff_version is set to 2.
+ * @a svndiff_version is set to 2.  Since 1.13, @a svndiff_version can be
+ * 3 for the svndiff3 format, which uses the same compression as svndiff2
+ * but a more compact instruction encoding and allows for delta windows
+ * of up to 8MB.  @a compression_level is ignored for svndiff3 as well.
  */
 void
 svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
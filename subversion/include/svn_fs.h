@@ -166,6 +166,55 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_FSFS_LOG_ADDRESSING       "fsfs-log-addressing"
 
+/** Enable / disable paged representations for very large directories
+ * in a newly created FSFS format 9 repository.  Paged directories carry
+ * a small index that allows looking up a single entry without reading
+ * and parsing the whole directory.  The default is "false".
+ *
+ * This option will only be used during the creation of new repositories
+ * and is otherwise ignored.
+ *
+ * @since New in 1.13.
+ */
+#define SVN_FS_CONFIG_FSFS_PAGED_DIRECTORIES    "fsfs-paged-directories"
+
+/** String with a decimal representation of the maximum number of worker
+ * threads that FSFS may use for long-running operations that cover the
+ * whole repository, such as verification and packing.  Values less than "2" mean
+ * that all work is done in the calling thread, which is the default.
+ *
+ * @since New in 1.13.
+ */
+#define SVN_FS_CONFIG_FSFS_JOBS                 "fsfs-jobs"
+
+/** String with a decimal representation of the number of revisions for
+ * which FSFS collects new rep-cache entries in memory before writing them
+ * in a single database transaction.  Values less than "2" mean that every
+ * commit writes its own entries, which is the default.
+ *
+ * This speeds up bulk operations like loading a dump file into a
+ * repository with rep-sharing enabled.  Entries not yet written when the
+ * filesystem object gets destroyed, e.g. because the process crashed,
+ * only cost opportunities to share representations.
+ *
+ * @since New in 1.13.
+ */
+#define SVN_FS_CONFIG_FSFS_REP_CACHE_BATCH      "fsfs-rep-cache-batch"
+
+/** Path of a file to which FSFS shall append a compact binary record for
+ * every node revision, representation, txdelta window and changed paths
+ * list that it reads from a revision.  Each record describes the rev /
+ * pack file location, the item type, whether it was served from cache
+ * and how long the access took.  Tracing is disabled by default.
+ *
+ * Multiple processes and filesystem objects may append to the same file
+ * concurrently.  The trace can be replayed against a copy of the
+ * repository using 'svnfsfs replay-trace'.
+ *
+ * @since New in 1.13.
+ */
+#define SVN_FS_CONFIG_FSFS_ACCESS_TRACE         "fsfs-access-trace"
+
 /* Note to maintainers: if you add further SVN_FS_CONFIG_FSFS_CACHE_* knobs,
    update fs_fs.c:verify_as_revision_before_current_plus_plus(). */
 
@@ -553,10 +602,34 @@ typedef void (*svn_fs_hotcopy_notify_t)(void *baton,
  * @a cancel_baton as usual to allow the user to preempt this potentially
  * lengthy operation.
  *
+ * @a fs_config is passed to the source and destination filesystems; it
+ * may be @c NULL.  With FSFS, #SVN_FS_CONFIG_FSFS_JOBS in @a fs_config
+ * controls how many revision and pack files may be copied in parallel.
+ * The notifications will still be sent in revision order.
+ *
  * Use @a scratch_pool for temporary allocations.
  *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_fs_hotcopy4(const char *src_path,
+                const char *dest_path,
+                svn_boolean_t clean,
+                svn_boolean_t incremental,
+                apr_hash_t *fs_config,
+                svn_fs_hotcopy_notify_t notify_func,
+                void *notify_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_fs_hotcopy4(), but with @a fs_config always passed as @c NULL.
+ *
+ * @deprecated Provided for backward compatibility with the 1.12 API.
  * @since New in 1.9.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_hotcopy3(const char *src_path,
                 const char *dest_path,
@@ -2858,6 +2931,48 @@ svn_fs_revision_proplist(apr_hash_t **table_p,
                          svn_revnum_t rev,
                          apr_pool_t *pool);
 
+/** Receives the property list @a proplist of revision @a revision.
+ *
+ * The user-provided @a baton is being passed through by the retrieval
+ * function and @a scratch_pool will be cleared between invocations.
+ * @a proplist is allocated in the pool given to the retrieval function.
+ *
+ * @since New in 1.13.
+ */
+typedef svn_error_t *
+(*svn_fs_revision_proplist_receiver_t)(void *baton,
+                                       svn_revnum_t revision,
+                                       apr_hash_t *proplist,
+                                       apr_pool_t *scratch_pool);
+
+/** Retrieve the property lists of all revisions from @a start to @a end
+ * (inclusive) in filesystem @a fs and invoke @a receiver with
+ * @a receiver_baton for each of them.  Revisions will be reported in
+ * ascending order if @a start <= @a end and in descending order otherwise.
+ *
+ * The property lists have the same format as those returned by
+ * svn_fs_revision_proplist2().  Backends may read them much more
+ * efficiently than by individual svn_fs_revision_proplist2() calls, e.g.
+ * with only a single pass over each FSFS revprop pack file.
+ *
+ * @a refresh has the same meaning as for svn_fs_revision_proplist2().
+ * If @a cancel_func is not @c NULL, call it with @a cancel_baton to
+ * check for cancellation.  Use @a scratch_pool for temporary allocations;
+ * the property lists will be allocated there as well.
+ *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_fs_revision_proplists(svn_fs_t *fs,
+                          svn_revnum_t start,
+                          svn_revnum_t end,
+                          svn_boolean_t refresh,
+                          svn_fs_revision_proplist_receiver_t receiver,
+                          void *receiver_baton,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool);
+
 /** Change a revision's property's value, or add/delete a property.
  *
  * - @a fs is a filesystem, and @a rev is the revision in that filesystem
@@ -3302,10 +3417,33 @@ typedef svn_error_t *(*svn_fs_pack_notify_t)(void *baton,
 
 /**
  * Possibly update the filesystem located in the directory @a path
- * to use disk space more efficiently.
+ * to use disk space more efficiently.  Use the backend-specific
+ * configuration @a fs_config when opening the filesystem.
+ * @a fs_config may be @c NULL.
+ *
+ * @a notify_func will be called with @a notify_baton in the calling
+ * thread.  If @a fs_config allows for multiple jobs, the start
+ * notifications of several shards may precede their end notifications.
+ * Both kinds of notification are still sent in shard order.
+ *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_fs_pack2(const char *db_path,
+             apr_hash_t *fs_config,
+             svn_fs_pack_notify_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool);
+
+/**
+ * Like svn_fs_pack2(), but with @a fs_config always passed as @c NULL.
  *
  * @since New in 1.6.
+ * @deprecated Provided for backward compatibility with the 1.12 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_pack(const char *db_path,
             svn_fs_pack_notify_t notify_func,
@@ -250,7 +250,10 @@ typedef enum svn_repos_notify_action_t
   svn_repos_notify_pack_noop,
 
   /** The revision properties got set. @since New in 1.10. */
-  svn_repos_notify_load_revprop_set
+  svn_repos_notify_load_revprop_set,
+
+  /** A revision range was added to the log index. @since New in 1.13. */
+  svn_repos_notify_log_index_rev_range
 } svn_repos_notify_action_t;
 
 /** The type of warning occurring.
@@ -352,12 +355,15 @@ typedef struct svn_repos_notify_t
   const char *path;
 
   /** For #svn_repos_notify_hotcopy_rev_range, the start of the copied
-      revision range.
+      revision range.  For #svn_repos_notify_log_index_rev_range, the
+      start of the indexed revision range.
       @since New in 1.9. */
   svn_revnum_t start_revision;
 
   /** For #svn_repos_notify_hotcopy_rev_range, the end of the copied
       revision range (might be the same as @a start_revision).
+      For #svn_repos_notify_log_index_rev_range, the end of the indexed
+      revision range.
       @since New in 1.9. */
   svn_revnum_t end_revision;
 
@@ -679,11 +685,35 @@ svn_repos_fs_type(svn_repos_t *repos,
  * The optional @a cancel_func callback will be invoked with
  * @a cancel_baton as usual to allow the user to preempt this potentially
  * lengthy operation.
- * 
+ *
+ * Use up to @a jobs threads to copy independent revision and pack files
+ * concurrently, where the filesystem backend supports it.  Notifications
+ * will still be sent in revision order and from the calling thread.
+ * Values of @a jobs less than 2 select single-threaded operation.
+ *
  * Use @a scratch_pool for temporary allocations.
  *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_repos_hotcopy4(const char *src_path,
+                   const char *dst_path,
+                   svn_boolean_t clean_logs,
+                   svn_boolean_t incremental,
+                   int jobs,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_repos_hotcopy4(), but with @a jobs set to 1.
+ *
  * @since New in 1.9.
+ * @deprecated Provided for backward compatibility with the 1.12 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_hotcopy3(const char *src_path,
                    const char *dst_path,
@@ -740,6 +770,38 @@ svn_repos_fs_pack2(svn_repos_t *repos,
                    void *cancel_baton,
                    apr_pool_t *pool);
 
+/**
+ * Create the optional log index of @a repos, if it does not exist yet,
+ * and add all revisions up to the youngest one to it.
+ *
+ * The log index records the mergeinfo changes of every revision, so that
+ * svn_repos_get_logs5() with @a include_merged_revisions set does not
+ * need to determine them from the repository contents over and over
+ * again.  Once the index exists, every commit made through
+ * svn_repos_fs_commit_txn() extends it.  Revisions committed otherwise,
+ * e.g. by svn_repos_load_fs6(), are picked up by the next call to this
+ * function.
+ *
+ * For each revision range indexed, @a notify_func will be called with
+ * @a notify_baton and a notification structure of type
+ * #svn_repos_notify_log_index_rev_range.  @a notify_func may be @c NULL.
+ *
+ * The optional @a cancel_func callback will be invoked with
+ * @a cancel_baton as usual to allow the user to preempt this potentially
+ * lengthy operation.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_repos_build_log_index(svn_repos_t *repos,
+                          svn_repos_notify_func_t notify_func,
+                          void *notify_baton,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool);
+
 /**
  * Similar to svn_repos_fs_pack2(), but with a #svn_fs_pack_notify_t instead
  * of a #svn_repos_notify_t.
@@ -3134,10 +3196,10 @@ enum svn_repos_load_uuid
   svn_repos_load_uuid_force
 };
 
-/** Callback type for use with svn_repos_verify_fs3().  @a revision
+/** Callback type for use with svn_repos_verify_fs4().  @a revision
  * and @a verify_err are the details of a single verification failure
- * that occurred during the svn_repos_verify_fs3() call.  @a baton is
- * the same baton given to svn_repos_verify_fs3().  @a scratch_pool is
+ * that occurred during the svn_repos_verify_fs4() call.  @a baton is
+ * the same baton given to svn_repos_verify_fs4().  @a scratch_pool is
  * provided for the convenience of the implementor, who should not
  * expect it to live longer than a single callback call.
  *
@@ -3147,7 +3209,7 @@ enum svn_repos_load_uuid
  * should also call svn_error_dup() for @a verify_err.  Implementors of this
  * callback are forbidden to call svn_error_clear() for @a verify_err.
  *
- * @see svn_repos_verify_fs3
+ * @see svn_repos_verify_fs4
  *
  * @since New in 1.9.
  */
@@ -3176,6 +3238,12 @@ typedef svn_error_t *(*svn_repos_verify_callback_t)(void *baton,
  * file context reconstruction and verification.  For FSFS format 7+ and
  * FSX, this allows for a very fast check against external corruption.
  *
+ * Use up to @a jobs threads to verify independent revisions and, where the
+ * backend supports it, independent parts of the backend-specific data
+ * concurrently.  Notifications and errors will still be reported in
+ * revision order and from the calling thread.  Values of @a jobs less than
+ * 2 select single-threaded operation.
+ *
  * If @a verify_callback is not @c NULL, call it with @a verify_baton upon
  * receiving an FS-specific structure failure or a revision verification
  * failure.  Set @c revision callback argument to #SVN_INVALID_REVNUM or
@@ -3224,8 +3292,30 @@ typedef svn_error_t *(*svn_repos_verify_callback_t)(void *baton,
  *
  * @see svn_repos_verify_callback_t
  *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_repos_verify_fs4(svn_repos_t *repos,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     svn_boolean_t check_normalization,
+                     svn_boolean_t metadata_only,
+                     int jobs,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_repos_verify_callback_t verify_callback,
+                     void *verify_baton,
+                     svn_cancel_func_t cancel,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_repos_verify_fs4(), but with @a jobs set to 1.
+ *
  * @since New in 1.9.
+ * @deprecated Provided for backward compatibility with the 1.12 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_verify_fs3(svn_repos_t *repos,
                      svn_revnum_t start_rev,
@@ -3283,7 +3373,7 @@ svn_repos_verify_fs(svn_repos_t *repos,
  * Dump the contents of the filesystem within already-open @a repos into
  * writable @a dumpstream.  If @a dumpstream is
  * @c NULL, this is effectively a primitive verify.  It is not complete,
- * however; see instead svn_repos_verify_fs3().
+ * however; see instead svn_repos_verify_fs4().
  *
  * Begin at revision @a start_rev, and dump every revision up through
  * @a end_rev.  If @a start_rev is #SVN_INVALID_REVNUM, start at revision
@@ -3300,6 +3390,11 @@ svn_repos_verify_fs(svn_repos_t *repos,
  * be done with full plain text.  A dump with @a use_deltas set cannot
  * be loaded by Subversion 1.0.x.
  *
+ * If @a raw_deltas is @c TRUE as well, texts that the repository already
+ * stores as a delta against the same base will be copied as is in their
+ * compressed svndiff format, which may require Subversion 1.10 or newer
+ * to load them.  Otherwise, only uncompressed stored deltas get copied.
+ *
  * If @a include_revprops is @c TRUE, output the revision properties as
  * well, otherwise omit them.
  *
@@ -3334,14 +3429,50 @@ svn_repos_verify_fs(svn_repos_t *repos,
  * If @a filter_func is not @c NULL, it is called for each node being
  * dumped, allowing the caller to exclude it from dump.
  *
+ * Use up to @a jobs threads to dump independent revisions concurrently.
+ * Each revision will be buffered in memory or, if it is large, in a
+ * temporary file until all previous revisions have been written, so the
+ * output is identical to that of a single-threaded dump.  Notifications
+ * and errors will still be reported in revision order and from the
+ * calling thread, but @a filter_func may be called concurrently from
+ * multiple threads.  Values of @a jobs less than 2 select single-threaded
+ * operation.
+ *
  * If @a cancel_func is not @c NULL, it is called periodically with
  * @a cancel_baton as argument to see if the client wishes to cancel
  * the dump.
  *
  * Use @a scratch_pool for temporary allocation.
  *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_repos_dump_fs5(svn_repos_t *repos,
+                   svn_stream_t *stream,
+                   svn_revnum_t start_rev,
+                   svn_revnum_t end_rev,
+                   svn_boolean_t incremental,
+                   svn_boolean_t use_deltas,
+                   svn_boolean_t raw_deltas,
+                   svn_boolean_t include_revprops,
+                   svn_boolean_t include_changes,
+                   int jobs,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_repos_dump_filter_func_t filter_func,
+                   void *filter_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool);
+
+/**
+ * Similar to svn_repos_dump_fs5(), but with @a raw_deltas set to
+ * @c FALSE and @a jobs set to 1.
+ *
  * @since New in 1.10.
+ * @deprecated Provided for backward compatibility with the 1.12 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_dump_fs4(svn_repos_t *repos,
                    svn_stream_t *stream,
@@ -3479,8 +3610,42 @@ svn_repos_dump_fs(svn_repos_t *repos,
  * @a cancel_baton as argument to see if the client wishes to cancel
  * the load.
  *
+ * Use up to @a jobs threads to decode text deltas of upcoming revisions
+ * while earlier revisions are still being committed.  Revisions will
+ * still be committed in stream order and from the calling thread, and so
+ * will all notifications be sent.  Values of @a jobs less than 2 select
+ * single-threaded operation.  Otherwise, @a dumpstream will be read from
+ * a separate thread and must be allocated in a pool with a thread-safe
+ * allocator, e.g. a root pool created by svn_pool_create(NULL).
+ *
+ * @since New in 1.13.
+ */
+svn_error_t *
+svn_repos_load_fs7(svn_repos_t *repos,
+                   svn_stream_t *dumpstream,
+                   svn_revnum_t start_rev,
+                   svn_revnum_t end_rev,
+                   enum svn_repos_load_uuid uuid_action,
+                   const char *parent_dir,
+                   svn_boolean_t use_pre_commit_hook,
+                   svn_boolean_t use_post_commit_hook,
+                   svn_boolean_t validate_props,
+                   svn_boolean_t ignore_dates,
+                   svn_boolean_t normalize_props,
+                   int jobs,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool);
+
+/**
+ * Similar to svn_repos_load_fs7(), but with @a jobs set to 1.
+ *
  * @since New in 1.10.
+ * @deprecated Provided for backward compatibility with the 1.12 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_load_fs6(svn_repos_t *repos,
                    svn_stream_t *dumpstream,
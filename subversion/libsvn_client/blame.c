@@ -23,7 +23,14 @@
 
 #include <apr_pools.h>
 
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+#endif
+
 #include "client.h"
+#include "blame_tree.h"
 
 #include "svn_client.h"
 #include "svn_subst.h"
@@ -37,6 +44,7 @@
 #include "svn_hash.h"
 #include "svn_sorts.h"
 
+#include "private/svn_client_private.h"
 #include "private/svn_wc_private.h"
 
 #include "svn_private_config.h"
@@ -52,7 +60,7 @@ struct rev
   const char *path;      /* the absolute repository path */
 };
 
-/* One chunk of blame */
+/* One chunk of blame, as reported to the caller */
 struct blame
 {
   const struct rev *rev;    /* the responsible revision */
@@ -60,14 +68,25 @@ struct blame
   struct blame *next;       /* the next chunk */
 };
 
+/* Length of the last chunk in a blame chain.  We don't know the number of
+   tokens in a file but the diff will never address anything beyond its
+   end, so an arbitrary large value will do. */
+#define BLAME_OPEN_END ((apr_off_t)1 << (sizeof(apr_off_t) * 8 - 4))
+
 /* A chain of blame chunks */
 struct blame_chain
 {
-  struct blame *blame;      /* linked list of blame chunks */
-  struct blame *avail;      /* linked list of free blame chunks */
+  svn_client__blame_tree_t *tree; /* blame chunks while collecting them,
+                                     associated with their struct rev */
+  struct blame *blame;      /* linked list of blame chunks, created from
+                               TREE by blame_chain_finalize */
   struct apr_pool_t *pool;  /* Allocate members from this pool. */
 };
 
+/* Processes the blame updates of one revision after the other in a
+   separate thread.  See pipeline_start(). */
+struct blame_pipeline;
+
 /* The baton use for the diff output routine. */
 struct diff_baton {
   struct blame_chain *chain;
@@ -106,6 +125,9 @@ struct file_rev_baton {
      happens when we move to the previous revision */
   svn_revnum_t last_revnum;
   apr_hash_t *last_props;
+
+  /* If not NULL, update CHAIN in the background. */
+  struct blame_pipeline *pipeline;
 };
 
 /* The baton used by the txdelta window handler. Allocated per revision */
@@ -124,135 +146,63 @@ struct delta_baton {
 
 
 /* Return a blame chunk associated with REV for a change starting
-   at token START, and allocated in CHAIN->mainpool. */
+   at token START, and allocated in CHAIN->pool. */
 static struct blame *
 blame_create(struct blame_chain *chain,
              const struct rev *rev,
              apr_off_t start)
 {
-  struct blame *blame;
-  if (chain->avail)
-    {
-      blame = chain->avail;
-      chain->avail = blame->next;
-    }
-  else
-    blame = apr_palloc(chain->pool, sizeof(*blame));
+  struct blame *blame = apr_palloc(chain->pool, sizeof(*blame));
   blame->rev = rev;
   blame->start = start;
   blame->next = NULL;
   return blame;
 }
 
-/* Destroy a blame chunk. */
-static void
-blame_destroy(struct blame_chain *chain,
-              struct blame *blame)
+/* Return a new blame chain allocated in POOL. */
+static struct blame_chain *
+blame_chain_create(apr_pool_t *pool)
 {
-  blame->next = chain->avail;
-  chain->avail = blame;
-}
+  struct blame_chain *chain = apr_pcalloc(pool, sizeof(*chain));
+  chain->tree = svn_client__blame_tree_create(pool);
+  chain->pool = pool;
 
-/* Return the blame chunk that contains token OFF, starting the search at
-   BLAME. */
-static struct blame *
-blame_find(struct blame *blame, apr_off_t off)
-{
-  struct blame *prev = NULL;
-  while (blame)
-    {
-      if (blame->start > off) break;
-      prev = blame;
-      blame = blame->next;
-    }
-  return prev;
+  return chain;
 }
 
-/* Shift the start-point of BLAME and all subsequence blame-chunks
-   by ADJUST tokens */
-static void
-blame_adjust(struct blame *blame, apr_off_t adjust)
+/* Baton type used by append_blame(). */
+struct blame_chain_link
 {
-  while (blame)
-    {
-      blame->start += adjust;
-      blame = blame->next;
-    }
-}
+  struct blame_chain *chain;  /* allocate new chunks in here */
+  struct blame **link;        /* the NEXT member of the last chunk */
+};
 
-/* Delete the blame associated with the region from token START to
-   START + LENGTH */
-static svn_error_t *
-blame_delete_range(struct blame_chain *chain,
-                   apr_off_t start,
-                   apr_off_t length)
+/* Implements svn_client__blame_tree_walk_func_t.  Append a blame chunk
+   for DATA starting at START to the list described by BATON, a struct
+   blame_chain_link. */
+static void
+append_blame(void *baton,
+             const void *data,
+             apr_off_t start,
+             apr_off_t length)
 {
-  struct blame *first = blame_find(chain->blame, start);
-  struct blame *last = blame_find(chain->blame, start + length);
-  struct blame *tail = last->next;
+  struct blame_chain_link *link = baton;
 
-  if (first != last)
-    {
-      struct blame *walk = first->next;
-      while (walk != last)
-        {
-          struct blame *next = walk->next;
-          blame_destroy(chain, walk);
-          walk = next;
-        }
-      first->next = last;
-      last->start = start;
-      if (first->start == start)
-        {
-          *first = *last;
-          blame_destroy(chain, last);
-          last = first;
-        }
-    }
-
-  if (tail && tail->start == last->start + length)
-    {
-      *last = *tail;
-      blame_destroy(chain, tail);
-      tail = last->next;
-    }
-
-  blame_adjust(tail, -length);
-
-  return SVN_NO_ERROR;
+  *link->link = blame_create(link->chain, data, start);
+  link->link = &(*link->link)->next;
 }
 
-/* Insert a chunk of blame associated with REV starting
-   at token START and continuing for LENGTH tokens */
-static svn_error_t *
-blame_insert_range(struct blame_chain *chain,
-                   const struct rev *rev,
-                   apr_off_t start,
-                   apr_off_t length)
+/* Set CHAIN->blame to the list of blame chunks in CHAIN->tree.
+   The tree must not be modified afterwards. */
+static void
+blame_chain_finalize(struct blame_chain *chain)
 {
-  struct blame *head = chain->blame;
-  struct blame *point = blame_find(head, start);
-  struct blame *insert;
+  struct blame_chain_link link;
 
-  if (point->start == start)
-    {
-      insert = blame_create(chain, point->rev, point->start + length);
-      point->rev = rev;
-      insert->next = point->next;
-      point->next = insert;
-    }
-  else
-    {
-      struct blame *middle;
-      middle = blame_create(chain, rev, start);
-      insert = blame_create(chain, point->rev, start + length);
-      middle->next = insert;
-      insert->next = point->next;
-      point->next = middle;
-    }
-  blame_adjust(insert->next, length);
-
-  return SVN_NO_ERROR;
+  chain->blame = NULL;
+  link.chain = chain;
+  link.link = &chain->blame;
+  svn_client__blame_tree_walk(chain->tree, append_blame, &link);
 }
 
 /* Callback for diff between subsequent revisions */
@@ -268,11 +218,12 @@ output_diff_modified(void *baton,
   struct diff_baton *db = baton;
 
   if (original_length)
-    SVN_ERR(blame_delete_range(db->chain, modified_start, original_length));
+    svn_client__blame_tree_delete(db->chain->tree, modified_start,
+                                  original_length);
 
   if (modified_length)
-    SVN_ERR(blame_insert_range(db->chain, db->rev, modified_start,
-                               modified_length));
+    svn_client__blame_tree_insert(db->chain->tree, db->rev, modified_start,
+                                  modified_length);
 
   return SVN_NO_ERROR;
 }
@@ -297,8 +248,8 @@ add_file_blame(const char *last_file,
 {
   if (!last_file)
     {
-      SVN_ERR_ASSERT(chain->blame == NULL);
-      chain->blame = blame_create(chain, rev, 0);
+      /* Everything in the first revision gets blamed on it. */
+      svn_client__blame_tree_insert(chain->tree, rev, 0, BLAME_OPEN_END);
     }
   else
     {
@@ -318,6 +269,304 @@ add_file_blame(const char *last_file,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS
+
+/* Maximum number of revisions whose blame information may be pending
+   in a blame_pipeline. */
+#define PIPELINE_DEPTH 16
+
+/* Interval in microseconds at which the calling thread checks for
+   cancellation while waiting for the pipeline to drain. */
+#define PIPELINE_CANCEL_INTERVAL 100000
+
+/* Blame update request for one revision, see add_file_blame(). */
+struct blame_job
+{
+  const char *last_file;
+  const char *cur_file;
+  struct rev *rev;
+};
+
+/* Diffing two revisions of a file typically takes as long as fetching
+   the next revision from the repository.  The pipeline runs the former
+   in a separate thread while the RA layer keeps streaming the latter.
+
+   The calling thread creates a temporary file for each revision in one
+   of the FILE_POOLS, which are used round-robin, and queues a job to
+   diff it against the previous revision.  The worker thread processes
+   the jobs in order and is the only one to touch CHAIN until the
+   pipeline has been finished.  A file may only be released after the
+   job for the next revision has been completed.
+
+   All modifiable members except FILES_CREATED are protected by MUTEX. */
+struct blame_pipeline
+{
+  /* The chain to update and the diff options to use. */
+  struct blame_chain *chain;
+  const svn_diff_file_options_t *diff_options;
+
+  /* Ring buffer of queued jobs.  Job I uses slot I % PIPELINE_DEPTH. */
+  struct blame_job jobs[PIPELINE_DEPTH];
+  apr_int64_t jobs_queued;
+  apr_int64_t jobs_done;
+
+  /* Ring buffer of pools for the temporary files.  Revision I uses
+     slot I % (PIPELINE_DEPTH + 1). */
+  apr_pool_t *file_pools[PIPELINE_DEPTH + 1];
+  apr_int64_t files_created;
+
+  /* Set by the calling thread when no further jobs will be queued. */
+  svn_boolean_t finished;
+
+  /* Set when processing shall stop immediately. */
+  svn_boolean_t aborted;
+
+  /* Error returned by the worker thread. */
+  svn_error_t *error;
+
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *cond;
+  apr_thread_t *thread;
+};
+
+/* Handy macro to check APR function results and turning them into
+ * svn_error_t upon failure. */
+#define WRAP_APR_ERR(x,msg)                     \
+  {                                             \
+    apr_status_t status_ = (x);                 \
+    if (status_)                                \
+      return svn_error_wrap_apr(status_, msg);  \
+  }
+
+/* Worker thread function.  DATA is the blame_pipeline. */
+static void * APR_THREAD_FUNC
+pipeline_worker(apr_thread_t *tid,
+                void *data)
+{
+  struct blame_pipeline *pipeline = data;
+  apr_pool_t *iterpool = svn_pool_create(NULL);
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  while (TRUE)
+    {
+      struct blame_job job;
+      svn_error_t *err;
+
+      while (   !pipeline->aborted
+             && !pipeline->finished
+             && pipeline->jobs_done == pipeline->jobs_queued)
+        apr_thread_cond_wait(pipeline->cond, pipeline->mutex);
+
+      if (   pipeline->aborted
+          || pipeline->jobs_done == pipeline->jobs_queued)
+        break;
+
+      job = pipeline->jobs[pipeline->jobs_done % PIPELINE_DEPTH];
+      apr_thread_mutex_unlock(pipeline->mutex);
+
+      /* The cancellation function may not be thread-safe.  The calling
+         thread keeps checking it, though. */
+      svn_pool_clear(iterpool);
+      err = add_file_blame(job.last_file, job.cur_file, pipeline->chain,
+                           job.rev, pipeline->diff_options, NULL, NULL,
+                           iterpool);
+
+      apr_thread_mutex_lock(pipeline->mutex);
+      if (err)
+        {
+          pipeline->error = err;
+          pipeline->aborted = TRUE;
+        }
+      else
+        pipeline->jobs_done++;
+
+      apr_thread_cond_broadcast(pipeline->cond);
+    }
+
+  apr_thread_mutex_unlock(pipeline->mutex);
+  svn_pool_destroy(iterpool);
+
+  return NULL;
+}
+
+/* Return the error reported by the worker thread of the aborted
+   PIPELINE.  PIPELINE->MUTEX must be held by the caller. */
+static svn_error_t *
+pipeline_take_error(struct blame_pipeline *pipeline)
+{
+  svn_error_t *err = pipeline->error;
+  pipeline->error = SVN_NO_ERROR;
+
+  return err ? err : svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+}
+
+/* apr_pool_cleanup_register() callback destroying the root pool DATA. */
+static apr_status_t
+destroy_root_pool(void *data)
+{
+  svn_pool_destroy(data);
+  return APR_SUCCESS;
+}
+
+/* Set *PIPELINE to a new pipeline updating CHAIN using DIFF_OPTIONS.
+   The temporary files will be allocated in sub-pools of FILES_POOL.
+   Everything else will be allocated in POOL.
+
+   The blame information in CHAIN will be allocated in a separate pool
+   from now on that lives as long as POOL. */
+static svn_error_t *
+pipeline_start(struct blame_pipeline **pipeline,
+               struct blame_chain *chain,
+               const svn_diff_file_options_t *diff_options,
+               apr_pool_t *files_pool,
+               apr_pool_t *pool)
+{
+  struct blame_pipeline *result = apr_pcalloc(pool, sizeof(*result));
+  int i;
+
+  result->chain = chain;
+  result->diff_options = diff_options;
+  for (i = 0; i < PIPELINE_DEPTH + 1; ++i)
+    result->file_pools[i] = svn_pool_create(files_pool);
+
+  WRAP_APR_ERR(apr_thread_mutex_create(&result->mutex,
+                                       APR_THREAD_MUTEX_DEFAULT, pool),
+               _("Can't create mutex"));
+  WRAP_APR_ERR(apr_thread_cond_create(&result->cond, pool),
+               _("Can't create condition variable"));
+
+  /* POOL is not thread-safe, so the worker needs a root pool of its own
+     for the blame information.  CHAIN is still empty at this point. */
+  chain->pool = svn_pool_create(NULL);
+  apr_pool_cleanup_register(pool, chain->pool, destroy_root_pool,
+                            apr_pool_cleanup_null);
+  chain->tree = svn_client__blame_tree_create(chain->pool);
+
+  WRAP_APR_ERR(apr_thread_create(&result->thread, NULL, pipeline_worker,
+                                 result, pool),
+               _("Can't create thread"));
+
+  *pipeline = result;
+  return SVN_NO_ERROR;
+}
+
+/* Set *POOL to the pool to use for the temporary file of the next
+   revision to be added to PIPELINE.  Block until that pool is
+   available. */
+static svn_error_t *
+pipeline_file_pool(apr_pool_t **pool,
+                   struct blame_pipeline *pipeline)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_int64_t index = pipeline->files_created;
+
+  /* Wait until the file previously using the same slot is no longer
+     needed, i.e. the job for the revision after it has been completed.
+     That also leaves room for the job of this revision. */
+  apr_thread_mutex_lock(pipeline->mutex);
+  while (   !pipeline->aborted
+         && index - pipeline->jobs_done >= PIPELINE_DEPTH)
+    apr_thread_cond_wait(pipeline->cond, pipeline->mutex);
+
+  if (pipeline->aborted)
+    err = pipeline_take_error(pipeline);
+  apr_thread_mutex_unlock(pipeline->mutex);
+  SVN_ERR(err);
+
+  *pool = pipeline->file_pools[index % (PIPELINE_DEPTH + 1)];
+  svn_pool_clear(*pool);
+  pipeline->files_created++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Queue the blame update for REV, diffing LAST_FILE against CUR_FILE,
+   in PIPELINE.  CUR_FILE must have been allocated in the pool returned
+   by the latest call to pipeline_file_pool(). */
+static svn_error_t *
+pipeline_queue(struct blame_pipeline *pipeline,
+               const char *last_file,
+               const char *cur_file,
+               struct rev *rev)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  struct blame_job *job;
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  if (pipeline->aborted)
+    {
+      err = pipeline_take_error(pipeline);
+    }
+  else
+    {
+      job = &pipeline->jobs[pipeline->jobs_queued % PIPELINE_DEPTH];
+      job->last_file = last_file;
+      job->cur_file = cur_file;
+      job->rev = rev;
+
+      pipeline->jobs_queued++;
+      apr_thread_cond_broadcast(pipeline->cond);
+    }
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  return svn_error_trace(err);
+}
+
+/* Stop the worker thread of PIPELINE and wait for it to exit.  If
+   COMPLETE is set, process all queued jobs first.  While waiting for
+   them, keep checking CANCEL_FUNC with CANCEL_BATON and abort the
+   remaining jobs upon cancellation.  Return any error encountered by
+   the worker or the cancellation error. */
+static svn_error_t *
+pipeline_finish(struct blame_pipeline *pipeline,
+                svn_boolean_t complete,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_status_t retval;
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  if (complete)
+    {
+      pipeline->finished = TRUE;
+      apr_thread_cond_broadcast(pipeline->cond);
+
+      /* The worker may be up to PIPELINE_DEPTH revisions behind. */
+      while (   !pipeline->aborted
+             && pipeline->jobs_done < pipeline->jobs_queued)
+        {
+          if (cancel_func)
+            {
+              apr_thread_mutex_unlock(pipeline->mutex);
+              err = cancel_func(cancel_baton);
+              apr_thread_mutex_lock(pipeline->mutex);
+              if (err)
+                break;
+            }
+
+          apr_thread_cond_timedwait(pipeline->cond, pipeline->mutex,
+                                    PIPELINE_CANCEL_INTERVAL);
+        }
+    }
+
+  if (!complete || err)
+    pipeline->aborted = TRUE;
+  apr_thread_cond_broadcast(pipeline->cond);
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  apr_thread_join(&retval, pipeline->thread);
+
+  /* Errors that have been returned before are not being reported
+     again. */
+  err = svn_error_compose_create(err, pipeline->error);
+  pipeline->error = SVN_NO_ERROR;
+
+  return svn_error_trace(err);
+}
+
+#endif
+
 /* Record the blame information for the revision in BATON->file_rev_baton.
  */
 static svn_error_t *
@@ -334,6 +583,18 @@ update_blame(void *baton)
   if (dbaton->source_stream)
     SVN_ERR(svn_stream_close(dbaton->source_stream));
 
+#if APR_HAS_THREADS
+  /* Let the worker thread do the diff. */
+  if (frb->pipeline)
+    {
+      SVN_ERR(pipeline_queue(frb->pipeline, frb->last_filename,
+                             dbaton->filename, dbaton->rev));
+      frb->last_filename = dbaton->filename;
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
   /* If we are including merged revisions, we need to add each rev to the
      merged chain. */
   if (frb->include_merged_revisions)
@@ -508,6 +769,12 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
   else
     filepool = frb->currpool;
 
+#if APR_HAS_THREADS
+  /* The files must live until the worker thread is done with them. */
+  if (frb->pipeline)
+    SVN_ERR(pipeline_file_pool(&filepool, frb->pipeline));
+#endif
+
   SVN_ERR(svn_stream_open_unique(&cur_stream, &delta_baton->filename, NULL,
                                  svn_io_file_del_on_pool_cleanup,
                                  filepool, filepool));
@@ -655,6 +922,252 @@ normalize_blames(struct blame_chain *chain,
     }
 }
 
+/* Prepare FRB for blaming TARGET from START_REVNUM to END_REVNUM in the
+   repository at REPOS_ROOT_URL.  The other parameters are the same as for
+   svn_client_blame6().  Allocate everything in POOL. */
+static void
+init_file_rev_baton(struct file_rev_baton *frb,
+                    const char *target,
+                    const char *repos_root_url,
+                    svn_revnum_t start_revnum,
+                    svn_revnum_t end_revnum,
+                    const svn_diff_file_options_t *diff_options,
+                    svn_boolean_t ignore_mime_type,
+                    svn_boolean_t include_merged_revisions,
+                    svn_client_ctx_t *ctx,
+                    apr_pool_t *pool)
+{
+  frb->start_rev = start_revnum;
+  frb->end_rev = end_revnum;
+  frb->target = target;
+  frb->ctx = ctx;
+  frb->diff_options = diff_options;
+  frb->include_merged_revisions = include_merged_revisions;
+  frb->last_filename = NULL;
+  frb->last_rev = NULL;
+  frb->last_original_filename = NULL;
+  frb->chain = blame_chain_create(pool);
+  frb->merged_chain = include_merged_revisions ? blame_chain_create(pool)
+                                               : NULL;
+  frb->backwards = (frb->start_rev > frb->end_rev);
+  frb->last_revnum = SVN_INVALID_REVNUM;
+  frb->last_props = NULL;
+  frb->check_mime_type = (frb->backwards && !ignore_mime_type);
+  frb->repos_root_url = repos_root_url;
+
+  frb->mainpool = pool;
+  /* The callback will flip the following two pools, because it needs
+     information from the previous call.  Obviously, it can't rely on
+     the lifetime of the pool provided by get_file_revs. */
+  frb->lastpool = svn_pool_create(pool);
+  frb->currpool = svn_pool_create(pool);
+  frb->filepool = svn_pool_create(pool);
+  frb->prevfilepool = svn_pool_create(pool);
+  frb->pipeline = NULL;
+}
+
+/* Collect the blame information in FRB for the file revisions that
+   FETCH_FUNC with FETCH_BATON reports.  Use POOL for allocations that
+   must live as long as FRB. */
+static svn_error_t *
+collect_blame(struct file_rev_baton *frb,
+              svn_client__file_revs_func_t fetch_func,
+              void *fetch_baton,
+              apr_pool_t *pool)
+{
+  svn_error_t *err;
+
+#if APR_HAS_THREADS
+  /* Tracking merged revisions requires the blame information of the
+     previous revision to be complete before the next one can be
+     handled. */
+  if (!frb->include_merged_revisions)
+    SVN_ERR(pipeline_start(&frb->pipeline, frb->chain, frb->diff_options,
+                           frb->filepool, pool));
+#endif
+
+  err = fetch_func(fetch_baton, file_rev_handler, frb, pool);
+
+#if APR_HAS_THREADS
+  /* Wait for all blame information to be complete. */
+  if (frb->pipeline)
+    err = svn_error_compose_create(err,
+                                   pipeline_finish(frb->pipeline, err == NULL,
+                                                   frb->ctx->cancel_func,
+                                                   frb->ctx->cancel_baton));
+#endif
+
+  return svn_error_trace(err);
+}
+
+/* Report the blame information collected in FRB to RECEIVER with
+   RECEIVER_BATON and release FRB's resources.  The contents of the file
+   are taken from FRB->last_filename.  Use POOL for allocations. */
+static svn_error_t *
+report_blame(struct file_rev_baton *frb,
+             svn_client_blame_receiver4_t receiver,
+             void *receiver_baton,
+             apr_pool_t *pool)
+{
+  svn_client_ctx_t *ctx = frb->ctx;
+  struct blame *walk, *walk_merged = NULL;
+  apr_pool_t *iterpool;
+  svn_stream_t *last_stream;
+  svn_stream_t *stream;
+
+  /* The callback has to have been called at least once. */
+  SVN_ERR_ASSERT(frb->last_filename != NULL);
+
+  /* Create a pool for the iteration below. */
+  iterpool = svn_pool_create(pool);
+
+  /* Open the last file and get a stream. */
+  SVN_ERR(svn_stream_open_readonly(&last_stream, frb->last_filename,
+                                   pool, pool));
+  stream = svn_subst_stream_translated(last_stream,
+                                       "\n", TRUE, NULL, FALSE, pool);
+
+  /* Convert the blame information into simple chunk lists. */
+  blame_chain_finalize(frb->chain);
+  if (frb->include_merged_revisions)
+    blame_chain_finalize(frb->merged_chain);
+
+  /* Perform optional merged chain normalization. */
+  if (frb->include_merged_revisions)
+    {
+      /* If we never created any blame for the original chain, create it now,
+         with the most recent changed revision.  This could occur if a file
+         was created on a branch and them merged to another branch.  This is
+         semanticly a copy, and we want to use the revision on the branch as
+         the most recently changed revision.  ### Is this really what we want
+         to do here?  Do the sematics of copy change? */
+      if (!frb->chain->blame)
+        frb->chain->blame = blame_create(frb->chain, frb->last_rev, 0);
+
+      normalize_blames(frb->chain, frb->merged_chain, pool);
+      walk_merged = frb->merged_chain->blame;
+    }
+
+  /* Process each blame item. */
+  for (walk = frb->chain->blame; walk; walk = walk->next)
+    {
+      apr_off_t line_no;
+      svn_revnum_t merged_rev;
+      const char *merged_path;
+      apr_hash_t *merged_rev_props;
+
+      if (walk_merged)
+        {
+          merged_rev = walk_merged->rev->revision;
+          merged_rev_props = walk_merged->rev->rev_props;
+          merged_path = walk_merged->rev->path;
+        }
+      else
+        {
+          merged_rev = SVN_INVALID_REVNUM;
+          merged_rev_props = NULL;
+          merged_path = NULL;
+        }
+
+      for (line_no = walk->start;
+           !walk->next || line_no < walk->next->start;
+           ++line_no)
+        {
+          svn_boolean_t eof;
+          svn_stringbuf_t *sb;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(svn_stream_readline(stream, &sb, "\n", &eof, iterpool));
+          if (ctx->cancel_func)
+            SVN_ERR(ctx->cancel_func(ctx->cancel_baton));
+          if (!eof || sb->len)
+            {
+              svn_string_t line;
+              line.data = sb->data;
+              line.len = sb->len;
+              if (walk->rev)
+                SVN_ERR(receiver(receiver_baton,
+                                 line_no, walk->rev->revision,
+                                 walk->rev->rev_props, merged_rev,
+                                 merged_rev_props, merged_path,
+                                 &line, FALSE, iterpool));
+              else
+                SVN_ERR(receiver(receiver_baton,
+                                 line_no, SVN_INVALID_REVNUM,
+                                 NULL, SVN_INVALID_REVNUM,
+                                 NULL, NULL,
+                                 &line, TRUE, iterpool));
+            }
+          if (eof) break;
+        }
+
+      if (walk_merged)
+        walk_merged = walk_merged->next;
+    }
+
+  SVN_ERR(svn_stream_close(stream));
+
+  svn_pool_destroy(frb->lastpool);
+  svn_pool_destroy(frb->currpool);
+  svn_pool_destroy(frb->filepool);
+  svn_pool_destroy(frb->prevfilepool);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton type used by ra_file_revs(). */
+struct ra_file_revs_baton
+{
+  svn_ra_session_t *ra_session;
+  svn_revnum_t start;
+  svn_revnum_t end;
+  svn_boolean_t include_merged_revisions;
+};
+
+/* Implements svn_client__file_revs_func_t.  Fetch the file revisions
+   described by BATON, a struct ra_file_revs_baton, from the repository. */
+static svn_error_t *
+ra_file_revs(void *baton,
+             svn_file_rev_handler_t handler,
+             void *handler_baton,
+             apr_pool_t *scratch_pool)
+{
+  struct ra_file_revs_baton *b = baton;
+
+  return svn_error_trace(svn_ra_get_file_revs2(b->ra_session, "",
+                                               b->start, b->end,
+                                               b->include_merged_revisions,
+                                               handler, handler_baton,
+                                               scratch_pool));
+}
+
+svn_error_t *
+svn_client__blame_file_revs(const char *target,
+                            const char *repos_root_url,
+                            svn_revnum_t start_revnum,
+                            svn_revnum_t end_revnum,
+                            svn_client__file_revs_func_t fetch_func,
+                            void *fetch_baton,
+                            const svn_diff_file_options_t *diff_options,
+                            svn_boolean_t ignore_mime_type,
+                            svn_boolean_t include_merged_revisions,
+                            svn_client_blame_receiver4_t receiver,
+                            void *receiver_baton,
+                            svn_client_ctx_t *ctx,
+                            apr_pool_t *pool)
+{
+  struct file_rev_baton frb;
+
+  init_file_rev_baton(&frb, target, repos_root_url, start_revnum,
+                      end_revnum, diff_options, ignore_mime_type,
+                      include_merged_revisions, ctx, pool);
+  SVN_ERR(collect_blame(&frb, fetch_func, fetch_baton, pool));
+
+  return svn_error_trace(report_blame(&frb, receiver, receiver_baton,
+                                      pool));
+}
+
 svn_error_t *
 svn_client_blame6(svn_revnum_t *start_revnum_p,
                   svn_revnum_t *end_revnum_p,
@@ -671,13 +1184,11 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
                   apr_pool_t *pool)
 {
   struct file_rev_baton frb;
+  struct ra_file_revs_baton fetch_baton;
   svn_ra_session_t *ra_session;
   svn_revnum_t start_revnum, end_revnum;
-  struct blame *walk, *walk_merged = NULL;
-  apr_pool_t *iterpool;
-  svn_stream_t *last_stream;
-  svn_stream_t *stream;
   const char *target_abspath_or_url;
+  const char *repos_root_url;
 
   if (start->kind == svn_opt_revision_unspecified
       || end->kind == svn_opt_revision_unspecified)
@@ -772,55 +1283,21 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
         }
     }
 
-  frb.start_rev = start_revnum;
-  frb.end_rev = end_revnum;
-  frb.target = target;
-  frb.ctx = ctx;
-  frb.diff_options = diff_options;
-  frb.include_merged_revisions = include_merged_revisions;
-  frb.last_filename = NULL;
-  frb.last_rev = NULL;
-  frb.last_original_filename = NULL;
-  frb.chain = apr_palloc(pool, sizeof(*frb.chain));
-  frb.chain->blame = NULL;
-  frb.chain->avail = NULL;
-  frb.chain->pool = pool;
-  if (include_merged_revisions)
-    {
-      frb.merged_chain = apr_palloc(pool, sizeof(*frb.merged_chain));
-      frb.merged_chain->blame = NULL;
-      frb.merged_chain->avail = NULL;
-      frb.merged_chain->pool = pool;
-    }
-  frb.backwards = (frb.start_rev > frb.end_rev);
-  frb.last_revnum = SVN_INVALID_REVNUM;
-  frb.last_props = NULL;
-  frb.check_mime_type = (frb.backwards && !ignore_mime_type);
-
-  SVN_ERR(svn_ra_get_repos_root2(ra_session, &frb.repos_root_url, pool));
-
-  frb.mainpool = pool;
-  /* The callback will flip the following two pools, because it needs
-     information from the previous call.  Obviously, it can't rely on
-     the lifetime of the pool provided by get_file_revs. */
-  frb.lastpool = svn_pool_create(pool);
-  frb.currpool = svn_pool_create(pool);
-  if (include_merged_revisions)
-    {
-      frb.filepool = svn_pool_create(pool);
-      frb.prevfilepool = svn_pool_create(pool);
-    }
+  SVN_ERR(svn_ra_get_repos_root2(ra_session, &repos_root_url, pool));
+  init_file_rev_baton(&frb, target, repos_root_url, start_revnum,
+                      end_revnum, diff_options, ignore_mime_type,
+                      include_merged_revisions, ctx, pool);
 
   /* Collect all blame information.
      We need to ensure that we get one revision before the start_rev,
      if available so that we can know what was actually changed in the start
      revision. */
-  SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
-                                frb.backwards ? start_revnum
-                                              : MAX(0, start_revnum-1),
-                                end_revnum,
-                                include_merged_revisions,
-                                file_rev_handler, &frb, pool));
+  fetch_baton.ra_session = ra_session;
+  fetch_baton.start = frb.backwards ? start_revnum
+                                    : MAX(0, start_revnum - 1);
+  fetch_baton.end = end_revnum;
+  fetch_baton.include_merged_revisions = include_merged_revisions;
+  SVN_ERR(collect_blame(&frb, ra_file_revs, &fetch_baton, pool));
 
   if (end->kind == svn_opt_revision_working)
     {
@@ -883,102 +1360,5 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
     }
 
   /* Report the blame to the caller. */
-
-  /* The callback has to have been called at least once. */
-  SVN_ERR_ASSERT(frb.last_filename != NULL);
-
-  /* Create a pool for the iteration below. */
-  iterpool = svn_pool_create(pool);
-
-  /* Open the last file and get a stream. */
-  SVN_ERR(svn_stream_open_readonly(&last_stream, frb.last_filename,
-                                   pool, pool));
-  stream = svn_subst_stream_translated(last_stream,
-                                       "\n", TRUE, NULL, FALSE, pool);
-
-  /* Perform optional merged chain normalization. */
-  if (include_merged_revisions)
-    {
-      /* If we never created any blame for the original chain, create it now,
-         with the most recent changed revision.  This could occur if a file
-         was created on a branch and them merged to another branch.  This is
-         semanticly a copy, and we want to use the revision on the branch as
-         the most recently changed revision.  ### Is this really what we want
-         to do here?  Do the sematics of copy change? */
-      if (!frb.chain->blame)
-        frb.chain->blame = blame_create(frb.chain, frb.last_rev, 0);
-
-      normalize_blames(frb.chain, frb.merged_chain, pool);
-      walk_merged = frb.merged_chain->blame;
-    }
-
-  /* Process each blame item. */
-  for (walk = frb.chain->blame; walk; walk = walk->next)
-    {
-      apr_off_t line_no;
-      svn_revnum_t merged_rev;
-      const char *merged_path;
-      apr_hash_t *merged_rev_props;
-
-      if (walk_merged)
-        {
-          merged_rev = walk_merged->rev->revision;
-          merged_rev_props = walk_merged->rev->rev_props;
-          merged_path = walk_merged->rev->path;
-        }
-      else
-        {
-          merged_rev = SVN_INVALID_REVNUM;
-          merged_rev_props = NULL;
-          merged_path = NULL;
-        }
-
-      for (line_no = walk->start;
-           !walk->next || line_no < walk->next->start;
-           ++line_no)
-        {
-          svn_boolean_t eof;
-          svn_stringbuf_t *sb;
-
-          svn_pool_clear(iterpool);
-          SVN_ERR(svn_stream_readline(stream, &sb, "\n", &eof, iterpool));
-          if (ctx->cancel_func)
-            SVN_ERR(ctx->cancel_func(ctx->cancel_baton));
-          if (!eof || sb->len)
-            {
-              svn_string_t line;
-              line.data = sb->data;
-              line.len = sb->len;
-              if (walk->rev)
-                SVN_ERR(receiver(receiver_baton,
-                                 line_no, walk->rev->revision,
-                                 walk->rev->rev_props, merged_rev,
-                                 merged_rev_props, merged_path,
-                                 &line, FALSE, iterpool));
-              else
-                SVN_ERR(receiver(receiver_baton,
-                                 line_no, SVN_INVALID_REVNUM,
-                                 NULL, SVN_INVALID_REVNUM,
-                                 NULL, NULL,
-                                 &line, TRUE, iterpool));
-            }
-          if (eof) break;
-        }
-
-      if (walk_merged)
-        walk_merged = walk_merged->next;
-    }
-
-  SVN_ERR(svn_stream_close(stream));
-
-  svn_pool_destroy(frb.lastpool);
-  svn_pool_destroy(frb.currpool);
-  if (include_merged_revisions)
-    {
-      svn_pool_destroy(frb.filepool);
-      svn_pool_destroy(frb.prevfilepool);
-    }
-  svn_pool_destroy(iterpool);
-
-  return SVN_NO_ERROR;
+  return svn_error_trace(report_blame(&frb, receiver, receiver_baton, pool));
 }
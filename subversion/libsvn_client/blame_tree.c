@@ -0,0 +1,232 @@
+/*
+ * blame_tree.c :  tree of blame chunks with implicit token positions
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "blame_tree.h"
+
+/* One chunk of blame within the tree. */
+typedef struct blame_node_t
+{
+  const void *data;           /* associated with all tokens in this chunk */
+  apr_off_t length;           /* number of tokens in this chunk */
+  apr_off_t total;            /* sum of LENGTH over this sub-tree */
+  apr_uint32_t priority;      /* parents have higher priorities */
+  struct blame_node_t *left;  /* chunks before this one */
+  struct blame_node_t *right; /* chunks after this one */
+} blame_node_t;
+
+struct svn_client__blame_tree_t
+{
+  blame_node_t *root;         /* tree of blame chunks */
+  blame_node_t *avail;        /* list of free blame chunks, linked by RIGHT */
+  apr_uint32_t seed;          /* state of the priority generator */
+  apr_pool_t *pool;           /* Allocate members from this pool. */
+};
+
+/* Return a blame tree node associated with DATA for LENGTH tokens,
+   allocated in TREE->pool. */
+static blame_node_t *
+node_create(svn_client__blame_tree_t *tree,
+            const void *data,
+            apr_off_t length)
+{
+  blame_node_t *node;
+  if (tree->avail)
+    {
+      node = tree->avail;
+      tree->avail = node->right;
+    }
+  else
+    node = apr_palloc(tree->pool, sizeof(*node));
+
+  /* Any cheap pseudo-random sequence will do to keep the tree balanced. */
+  tree->seed = tree->seed * 1103515245 + 12345;
+
+  node->data = data;
+  node->length = length;
+  node->total = length;
+  node->priority = tree->seed;
+  node->left = NULL;
+  node->right = NULL;
+  return node;
+}
+
+/* Return NODE and all its sub-nodes to the free list of TREE. */
+static void
+node_destroy(svn_client__blame_tree_t *tree,
+             blame_node_t *node)
+{
+  if (node)
+    {
+      node_destroy(tree, node->left);
+      node_destroy(tree, node->right);
+      node->right = tree->avail;
+      tree->avail = node;
+    }
+}
+
+/* Update NODE->total after its children changed. */
+static void
+node_update(blame_node_t *node)
+{
+  node->total = node->length
+              + (node->left ? node->left->total : 0)
+              + (node->right ? node->right->total : 0);
+}
+
+/* Return the tree containing the chunks of LEFT followed by those of
+   RIGHT. */
+static blame_node_t *
+node_merge(blame_node_t *left,
+           blame_node_t *right)
+{
+  if (!left)
+    return right;
+  if (!right)
+    return left;
+
+  if (left->priority > right->priority)
+    {
+      left->right = node_merge(left->right, right);
+      node_update(left);
+      return left;
+    }
+  else
+    {
+      right->left = node_merge(left, right->left);
+      node_update(right);
+      return right;
+    }
+}
+
+/* Split the tree NODE into *LEFT, covering the first OFFSET tokens,
+   and *RIGHT, covering the remainder.  A chunk that straddles OFFSET
+   gets split in two, using TREE to allocate the new node. */
+static void
+node_split(blame_node_t **left,
+           blame_node_t **right,
+           svn_client__blame_tree_t *tree,
+           blame_node_t *node,
+           apr_off_t offset)
+{
+  apr_off_t left_total;
+
+  if (!node)
+    {
+      *left = NULL;
+      *right = NULL;
+      return;
+    }
+
+  left_total = node->left ? node->left->total : 0;
+  if (offset <= left_total)
+    {
+      node_split(left, &node->left, tree, node->left, offset);
+      node_update(node);
+      *right = node;
+    }
+  else if (offset >= left_total + node->length)
+    {
+      node_split(&node->right, right, tree, node->right,
+                 offset - left_total - node->length);
+      node_update(node);
+      *left = node;
+    }
+  else
+    {
+      /* NODE keeps the head of the chunk, a new node takes the tail. */
+      apr_off_t head_length = offset - left_total;
+      blame_node_t *tail = node_create(tree, node->data,
+                                       node->length - head_length);
+
+      *right = node_merge(tail, node->right);
+
+      node->length = head_length;
+      node->right = NULL;
+      node_update(node);
+      *left = node;
+    }
+}
+
+/* Call WALK_FUNC with WALK_BATON for all chunks in the tree NODE.
+   *START is the token position of the first chunk in NODE and will be
+   updated to the position following the last one. */
+static void
+node_walk(apr_off_t *start,
+          blame_node_t *node,
+          svn_client__blame_tree_walk_func_t walk_func,
+          void *walk_baton)
+{
+  if (node)
+    {
+      node_walk(start, node->left, walk_func, walk_baton);
+
+      walk_func(walk_baton, node->data, *start, node->length);
+      *start += node->length;
+
+      node_walk(start, node->right, walk_func, walk_baton);
+    }
+}
+
+svn_client__blame_tree_t *
+svn_client__blame_tree_create(apr_pool_t *result_pool)
+{
+  svn_client__blame_tree_t *tree = apr_pcalloc(result_pool, sizeof(*tree));
+  tree->pool = result_pool;
+
+  return tree;
+}
+
+void
+svn_client__blame_tree_insert(svn_client__blame_tree_t *tree,
+                              const void *data,
+                              apr_off_t start,
+                              apr_off_t length)
+{
+  blame_node_t *head, *tail;
+
+  node_split(&head, &tail, tree, tree->root, start);
+  head = node_merge(head, node_create(tree, data, length));
+  tree->root = node_merge(head, tail);
+}
+
+void
+svn_client__blame_tree_delete(svn_client__blame_tree_t *tree,
+                              apr_off_t start,
+                              apr_off_t length)
+{
+  blame_node_t *head, *middle, *tail;
+
+  node_split(&head, &tail, tree, tree->root, start);
+  node_split(&middle, &tail, tree, tail, length);
+  node_destroy(tree, middle);
+  tree->root = node_merge(head, tail);
+}
+
+void
+svn_client__blame_tree_walk(svn_client__blame_tree_t *tree,
+                            svn_client__blame_tree_walk_func_t walk_func,
+                            void *walk_baton)
+{
+  apr_off_t start = 0;
+  node_walk(&start, tree->root, walk_func, walk_baton);
+}
@@ -0,0 +1,93 @@
+/*
+ * blame_tree.h : Client library-internal tree of blame chunks.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_CLIENT_BLAME_TREE_H
+#define SVN_LIBSVN_CLIENT_BLAME_TREE_H
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/* A sequence of chunks of consecutive tokens, e.g. lines, each of which
+   is associated with some caller-provided data.
+
+   The chunks form a treap, i.e. a binary tree ordered by token position
+   that is balanced by pseudo-randomly assigned heap priorities.
+   Positions are not stored explicitly but are implied by the lengths of
+   all preceding chunks.  Thus, inserting or deleting a range of tokens
+   is O(log n) instead of having to adjust all following chunks.
+
+   Instances are not thread-safe. */
+typedef struct svn_client__blame_tree_t svn_client__blame_tree_t;
+
+/* Return a new, empty blame tree.  Allocate it and all of its chunks
+   in RESULT_POOL. */
+svn_client__blame_tree_t *
+svn_client__blame_tree_create(apr_pool_t *result_pool);
+
+/* Insert a chunk of LENGTH tokens associated with DATA into TREE, such
+   that it starts at token position START.  Tokens at or after START move
+   back by LENGTH.  A chunk that covers START gets split in two.
+
+   START must not exceed the total number of tokens in TREE and LENGTH
+   must be positive. */
+void
+svn_client__blame_tree_insert(svn_client__blame_tree_t *tree,
+                              const void *data,
+                              apr_off_t start,
+                              apr_off_t length);
+
+/* Remove the LENGTH tokens starting at position START from TREE.  Chunks
+   that partly overlap with that range get shortened accordingly.  Tokens
+   beyond the end of TREE are ignored. */
+void
+svn_client__blame_tree_delete(svn_client__blame_tree_t *tree,
+                              apr_off_t start,
+                              apr_off_t length);
+
+/* Callback type used with svn_client__blame_tree_walk().  DATA is the
+   data associated with the chunk covering the LENGTH tokens starting at
+   position START. */
+typedef void (*svn_client__blame_tree_walk_func_t)(void *baton,
+                                                   const void *data,
+                                                   apr_off_t start,
+                                                   apr_off_t length);
+
+/* Call WALK_FUNC with WALK_BATON for all chunks in TREE, in ascending
+   order of their token positions.  Empty chunks are never reported. */
+void
+svn_client__blame_tree_walk(svn_client__blame_tree_t *tree,
+                            svn_client__blame_tree_walk_func_t walk_func,
+                            void *walk_baton);
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_CLIENT_BLAME_TREE_H */
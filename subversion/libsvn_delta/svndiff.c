@@ -39,13 +39,16 @@
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
 static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
+static const char SVNDIFF_V3[] = { 'S', 'V', 'N', 3 };
 
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
 static const char *
 get_svndiff_header(int version)
 {
-  if (version == 2)
+  if (version == 3)
+    return SVNDIFF_V3;
+  else if (version == 2)
     return SVNDIFF_V2;
   else if (version == 1)
     return SVNDIFF_V1;
@@ -70,9 +73,18 @@ struct encoder_baton {
 /* This is at least as big as the largest size for a single instruction. */
 #define MAX_INSTRUCTION_LEN (2*SVN__MAX_ENCODED_UINT_LEN+1)
 /* This is at least as big as the largest possible instructions
-   section: in theory, the instructions could be SVN_DELTA_WINDOW_SIZE
-   1-byte copy-from-source instructions (though this is very unlikely). */
-#define MAX_INSTRUCTION_SECTION_LEN (SVN_DELTA_WINDOW_SIZE*MAX_INSTRUCTION_LEN)
+   section for svndiff VERSION: in theory, the instructions could be
+   window size 1-byte copy-from-source instructions (though this is very
+   unlikely). */
+#define MAX_INSTRUCTION_SECTION_LEN(version) \
+  (svn_txdelta__max_window_size(version) * MAX_INSTRUCTION_LEN)
+
+apr_size_t
+svn_txdelta__max_window_size(int svndiff_version)
+{
+  return svndiff_version >= 3 ? SVN_DELTA__MAX_WINDOW_SIZE
+                              : SVN_DELTA_WINDOW_SIZE;
+}
 
 
 /* Append an encoded integer to a string.  */
@@ -169,6 +181,7 @@ encode_window(svn_stringbuf_t **instructions_p,
   const svn_string_t *newdata;
   unsigned char ibuf[MAX_INSTRUCTION_LEN], *ip;
   const svn_txdelta_op_t *op;
+  apr_size_t source_pos = 0;
 
   /* create the necessary data buffers */
   instructions = svn_stringbuf_create_empty(pool);
@@ -189,7 +202,16 @@ encode_window(svn_stringbuf_t **instructions_p,
         *ip++ |= (unsigned char)op->length;
       else
         ip = svn__encode_uint(ip + 1, op->length);
-      if (op->action_code != svn_txdelta_new)
+      if (op->action_code == svn_txdelta_source && version >= 3)
+        {
+          /* Source copies tend to continue close to where the previous
+             one ended.  Storing the offset relative to that position
+             keeps the numbers small even in large windows. */
+          ip = svn__encode_int(ip, (apr_int64_t)op->offset
+                                   - (apr_int64_t)source_pos);
+          source_pos = op->offset + op->length;
+        }
+      else if (op->action_code != svn_txdelta_new)
         ip = svn__encode_uint(ip, op->offset);
       svn_stringbuf_appendbytes(instructions, (const char *)ibuf, ip - ibuf);
     }
@@ -198,7 +220,7 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, window->sview_offset);
   append_encoded_int(header, window->sview_len);
   append_encoded_int(header, window->tview_len);
-  if (version == 2)
+  if (version == 2 || version == 3)
     {
       svn_stringbuf_t *compressed_instructions;
       compressed_instructions = svn_stringbuf_create_empty(pool);
@@ -217,7 +239,7 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, instructions->len);
 
   /* Encode the data. */
-  if (version == 2)
+  if (version == 2 || version == 3)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
 
@@ -424,13 +446,52 @@ decode_size(apr_size_t *val,
   return result;
 }
 
-/* Decode an instruction into OP, returning a pointer to the text
-   after the instruction.  Note that if the action code is
-   svn_txdelta_new, the offset field of *OP will not be set.  */
+/* Decode the offset of a source copy instruction of length LENGTH
+   in svndiff3 format into *OFFSET, returning a pointer to the text
+   after the offset.  *SOURCE_POS is the end of the previous source copy
+   within the source view, the stored value being relative to it.
+   Update it for the next instruction. */
+static const unsigned char *
+decode_source_offset(apr_size_t *offset,
+                     apr_size_t *source_pos,
+                     apr_size_t length,
+                     const unsigned char *p,
+                     const unsigned char *end)
+{
+  apr_int64_t delta;
+
+  p = svn__decode_int(&delta, p, end);
+  if (p == NULL)
+    return NULL;
+
+  /* Reject offsets before the start of the view and any overflow. */
+  if (delta < 0)
+    {
+      if ((apr_uint64_t)0 - (apr_uint64_t)delta > *source_pos)
+        return NULL;
+    }
+  else if ((apr_uint64_t)delta > APR_SIZE_MAX - *source_pos)
+    return NULL;
+
+  *offset = (apr_size_t)((apr_int64_t)*source_pos + delta);
+  if (length > APR_SIZE_MAX - *offset)
+    return NULL;
+
+  *source_pos = *offset + length;
+  return p;
+}
+
+/* Decode an instruction of svndiff VERSION into OP, returning a pointer
+   to the text after the instruction.  Note that if the action code is
+   svn_txdelta_new, the offset field of *OP will not be set.
+   *SOURCE_POS must be 0 for the first instruction in a window and will
+   be updated for the next one.  */
 static const unsigned char *
 decode_instruction(svn_txdelta_op_t *op,
+                   apr_size_t *source_pos,
                    const unsigned char *p,
-                   const unsigned char *end)
+                   const unsigned char *end,
+                   unsigned int version)
 {
   apr_size_t c;
   apr_size_t action;
@@ -458,7 +519,13 @@ decode_instruction(svn_txdelta_op_t *op,
       if (p == NULL)
         return NULL;
     }
-  if (action != svn_txdelta_new)
+  if (action == svn_txdelta_source && version >= 3)
+    {
+      p = decode_source_offset(&op->offset, source_pos, op->length, p, end);
+      if (p == NULL)
+        return NULL;
+    }
+  else if (action != svn_txdelta_new)
     {
       p = decode_size(&op->offset, p, end);
       if (p == NULL)
@@ -471,22 +538,23 @@ decode_instruction(svn_txdelta_op_t *op,
 /* Count the instructions in the range [P..END-1] and make sure they
    are valid for the given window lengths.  Return an error if the
    instructions are invalid; otherwise set *NINST to the number of
-   instructions.  */
+   instructions.  VERSION is the svndiff version in use.  */
 static svn_error_t *
 count_and_verify_instructions(int *ninst,
                               const unsigned char *p,
                               const unsigned char *end,
                               apr_size_t sview_len,
                               apr_size_t tview_len,
-                              apr_size_t new_len)
+                              apr_size_t new_len,
+                              unsigned int version)
 {
   int n = 0;
   svn_txdelta_op_t op;
-  apr_size_t tpos = 0, npos = 0;
+  apr_size_t tpos = 0, npos = 0, source_pos = 0;
 
   while (p < end)
     {
-      p = decode_instruction(&op, p, end);
+      p = decode_instruction(&op, &source_pos, p, end, version);
 
       /* Detect any malformed operations from the instruction stream. */
       if (p == NULL)
@@ -555,7 +623,7 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 {
   const unsigned char *insend;
   int ninst;
-  apr_size_t npos;
+  apr_size_t npos, source_pos;
   svn_txdelta_op_t *ops, *op;
   svn_string_t *new_data;
 
@@ -565,15 +633,15 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   insend = data + inslen;
 
-  if (version == 2)
+  if (version == 2 || version == 3)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
       SVN_ERR(svn__decompress_lz4(insend, newlen, ndout,
-                                  SVN_DELTA_WINDOW_SIZE));
+                                  svn_txdelta__max_window_size(version)));
       SVN_ERR(svn__decompress_lz4(data, insend - data, instout,
-                                  MAX_INSTRUCTION_SECTION_LEN));
+                                  MAX_INSTRUCTION_SECTION_LEN(version)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -589,7 +657,7 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
       SVN_ERR(svn__decompress_zlib(insend, newlen, ndout,
                                    SVN_DELTA_WINDOW_SIZE));
       SVN_ERR(svn__decompress_zlib(data, insend - data, instout,
-                                   MAX_INSTRUCTION_SECTION_LEN));
+                                   MAX_INSTRUCTION_SECTION_LEN(version)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -606,15 +674,17 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   /* Count the instructions and make sure they are all valid.  */
   SVN_ERR(count_and_verify_instructions(&ninst, data, insend,
-                                        sview_len, tview_len, newlen));
+                                        sview_len, tview_len, newlen,
+                                        version));
 
   /* Allocate a buffer for the instructions and decode them. */
   ops = apr_palloc(pool, ninst * sizeof(*ops));
   npos = 0;
+  source_pos = 0;
   window->src_ops = 0;
   for (op = ops; op < ops + ninst; op++)
     {
-      data = decode_instruction(op, data, insend);
+      data = decode_instruction(op, &source_pos, data, insend, version);
       if (op->action_code == svn_txdelta_source)
         ++window->src_ops;
       else if (op->action_code == svn_txdelta_new)
@@ -653,6 +723,8 @@ write_handler(void *baton,
         db->version = 1;
       else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
         db->version = 2;
+      else if (memcmp(buffer, SVNDIFF_V3 + db->header_bytes, nheader) == 0)
+        db->version = 3;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -688,6 +760,8 @@ write_handler(void *baton,
         {
           svn_filesize_t sview_offset;
           apr_size_t sview_len, tview_len, inslen, newlen;
+          apr_size_t max_window_size
+            = svn_txdelta__max_window_size(db->version);
           const unsigned char *hdr_start = p;
 
           p = decode_file_offset(&sview_offset, p, end);
@@ -710,11 +784,11 @@ write_handler(void *baton,
           if (p == NULL)
               break;
 
-          if (tview_len > SVN_DELTA_WINDOW_SIZE ||
-              sview_len > SVN_DELTA_WINDOW_SIZE ||
+          if (tview_len > max_window_size ||
+              sview_len > max_window_size ||
               /* for svndiff1, newlen includes the original length */
-              newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-              inslen > MAX_INSTRUCTION_SECTION_LEN)
+              newlen > max_window_size + SVN__MAX_ENCODED_UINT_LEN ||
+              inslen > MAX_INSTRUCTION_SECTION_LEN(db->version))
             return svn_error_create(
                      SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                      _("Svndiff contains a too-large window"));
@@ -894,14 +968,16 @@ read_one_size(apr_size_t *size,
   return SVN_NO_ERROR;
 }
 
-/* Read a window header from STREAM and check it for integer overflow. */
+/* Read a window header from STREAM and check it for integer overflow
+   and the size limits of svndiff VERSION. */
 static svn_error_t *
 read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
                    apr_size_t *sview_len, apr_size_t *tview_len,
                    apr_size_t *inslen, apr_size_t *newlen,
-                   apr_size_t *header_len)
+                   apr_size_t *header_len, int version)
 {
   unsigned char c;
+  apr_size_t max_window_size = svn_txdelta__max_window_size(version);
 
   /* Read the source view offset by hand, since it's not an apr_size_t. */
   *header_len = 0;
@@ -921,11 +997,11 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
   SVN_ERR(read_one_size(inslen, header_len, stream));
   SVN_ERR(read_one_size(newlen, header_len, stream));
 
-  if (*tview_len > SVN_DELTA_WINDOW_SIZE ||
-      *sview_len > SVN_DELTA_WINDOW_SIZE ||
+  if (*tview_len > max_window_size ||
+      *sview_len > max_window_size ||
       /* for svndiff1, newlen includes the original length */
-      *newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-      *inslen > MAX_INSTRUCTION_SECTION_LEN)
+      *newlen > max_window_size + SVN__MAX_ENCODED_UINT_LEN ||
+      *inslen > MAX_INSTRUCTION_SECTION_LEN(version))
     return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                             _("Svndiff contains a too-large window"));
 
@@ -950,7 +1026,8 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
   unsigned char *buf;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             svndiff_version));
   len = inslen + newlen;
   buf = apr_palloc(pool, len);
   SVN_ERR(svn_stream_read_full(stream, (char*)buf, &len));
@@ -974,7 +1051,8 @@ svn_txdelta_skip_svndiff_window(apr_file_t *file,
   apr_off_t offset;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             svndiff_version));
 
   offset = inslen + newlen;
   return svn_io_file_seek(file, APR_CUR, &offset, pool);
@@ -983,13 +1061,14 @@ svn_txdelta_skip_svndiff_window(apr_file_t *file,
 svn_error_t *
 svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
+                                 int version,
                                  apr_pool_t *pool)
 {
   svn_filesize_t sview_offset;
   apr_size_t sview_len, tview_len, inslen, newlen, header_len;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len, version));
 
   *window_len = inslen + newlen + header_len;
   return SVN_NO_ERROR;
@@ -29,6 +29,7 @@
 
 #include "svn_hash.h"
 #include "svn_delta.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_string_private.h"
 #include "delta.h"
 
@@ -49,10 +50,17 @@
    the number of checksums that actually occur, i.e. we expect a >95%
    probability that non-matching checksums get already detected by checking
    against the FLAGS array.
+   Larger windows use proportionally more flags, up to MAX_FLAGS_COUNT.
    Must be a power of 2.
  */
 #define FLAGS_COUNT (32 * 1024)
 
+/* Upper limit to the size of the FLAGS array.  Since the bytes in FLAGS
+   are being addressed by the upper 16 bits of the adler32 checksum, more
+   flags could not be used.
+ */
+#define MAX_FLAGS_COUNT (8 * 0x10000)
+
 /* "no" / "invalid" / "unused" value for positions within the delta windows
  */
 #define NO_POSITION ((apr_uint32_t)-1)
@@ -135,10 +143,13 @@ struct blocks
      adler32 checksum.  Since FLAGS has much more entries than SLOTS, this
      will indicate most cases of non-matching checksums with a "0" bit, i.e.
      as "known not to have a match".
-     The mapping of adler32 checksum bits is [0..2][16..27] (LSB -> MSB),
+     The mapping of adler32 checksum bits is [0..2][16..] (LSB -> MSB),
      i.e. address the byte by the multiplicative part of adler32 and address
      the bits in that byte by the additive part of adler32. */
-  char flags[FLAGS_COUNT / 8];
+  char *flags;
+
+  /* Number of bytes in FLAGS minus 1.  The size is a power of 2. */
+  apr_uint32_t flags_mask;
 
   /* The vector of blocks.  A pos value of NO_POSITION represents an unused
      slot. */
@@ -156,13 +167,13 @@ static apr_uint32_t hash_func(apr_uint32_t sum)
   return sum ^ (sum >> 12);
 }
 
-/* Return the offset in BLOCKS.FLAGS for the adler32 SUM. */
-static apr_uint32_t hash_flags(apr_uint32_t sum)
+/* Return the offset in BLOCKS->FLAGS for the adler32 SUM. */
+static apr_uint32_t hash_flags(const struct blocks *blocks, apr_uint32_t sum)
 {
   /* The upper half of SUM has a wider value range than the lower 16 bit.
      Also, we want to a different folding than HASH_FUNC to minimize
      correlation between different hash levels. */
-  return (sum >> 16) & ((FLAGS_COUNT / 8) - 1);
+  return (sum >> 16) & blocks->flags_mask;
 }
 
 /* Insert a block with the checksum ADLERSUM at position POS in the source
@@ -182,7 +193,7 @@ add_block(struct blocks *blocks, apr_uint32_t adlersum, apr_uint32_t pos)
 
   blocks->slots[h].adlersum = adlersum;
   blocks->slots[h].pos = pos;
-  blocks->flags[hash_flags(adlersum)] |= 1 << (adlersum & 7);
+  blocks->flags[hash_flags(blocks, adlersum)] |= 1 << (adlersum & 7);
 }
 
 /* Find a block in BLOCKS with the checksum ADLERSUM and matching the content
@@ -216,6 +227,7 @@ init_blocks_table(const char *data,
   apr_size_t nblocks;
   apr_size_t wnslots = 1;
   apr_uint32_t nslots;
+  apr_uint32_t nflags;
   apr_uint32_t i;
 
   /* Be pessimistic about the block count. */
@@ -247,8 +259,16 @@ init_blocks_table(const char *data,
       blocks->slots[i].pos = NO_POSITION;
     }
 
+  /* Keep the ratio between flags and slots constant for larger windows.
+     There are 8 flags per byte, i.e. NSLOTS bytes give 16 to 32 flags
+     per block. */
+  nflags = nslots < FLAGS_COUNT / 8 ? FLAGS_COUNT / 8 : nslots;
+  if (nflags > MAX_FLAGS_COUNT / 8)
+    nflags = MAX_FLAGS_COUNT / 8;
+  blocks->flags_mask = nflags - 1;
+
   /* No checksum entries in SLOTS, yet => reset all checksum flags. */
-  memset(blocks->flags, 0, sizeof(blocks->flags));
+  blocks->flags = apr_pcalloc(pool, nflags);
 
   /* If there is an odd block at the end of the buffer, we will
      not use that shorter block for deltification (only indirectly
@@ -257,6 +277,48 @@ init_blocks_table(const char *data,
     add_block(blocks, init_adler32(data + i), i);
 }
 
+/* Whether find_match() compares whole machine words where the platform
+   allows it.  Tests may disable it to compare against the byte-wise
+   fallback.  See svn_txdelta__xdelta_set_word_matching(). */
+static svn_boolean_t word_matching = TRUE;
+
+void
+svn_txdelta__xdelta_set_word_matching(svn_boolean_t enable)
+{
+  word_matching = enable;
+}
+
+/* Return the number of matching bytes at the start of A and B, but no
+   more than MAX_LEN.  Byte-wise version of svn_cstring__match_length(). */
+static apr_size_t
+match_length_bytewise(const char *a,
+                      const char *b,
+                      apr_size_t max_len)
+{
+  apr_size_t pos = 0;
+
+  while (pos < max_len && a[pos] == b[pos])
+    ++pos;
+
+  return pos;
+}
+
+/* Return the number of matching bytes immediately before A and B, but no
+   more than MAX_LEN.  Byte-wise version of
+   svn_cstring__reverse_match_length(). */
+static apr_size_t
+reverse_match_length_bytewise(const char *a,
+                              const char *b,
+                              apr_size_t max_len)
+{
+  apr_size_t pos = 0;
+
+  while (pos < max_len && *(a - pos - 1) == *(b - pos - 1))
+    ++pos;
+
+  return pos;
+}
+
 /* Try to find a match for the target data B in BLOCKS, and then
    extend the match as long as data in A and B at the match position
    continues to match.  We set the position in A we ended up in (in
@@ -278,7 +340,7 @@ find_match(const struct blocks *blocks,
            apr_size_t pending_insert_start)
 {
   apr_size_t apos, bpos = *bposp;
-  apr_size_t delta, max_delta;
+  apr_size_t delta, max_delta, back;
 
   apos = find_block(blocks, rolling, b + bpos);
 
@@ -290,18 +352,27 @@ find_match(const struct blocks *blocks,
   max_delta = asize - apos - MATCH_BLOCKSIZE < bsize - bpos - MATCH_BLOCKSIZE
             ? asize - apos - MATCH_BLOCKSIZE
             : bsize - bpos - MATCH_BLOCKSIZE;
-  delta = svn_cstring__match_length(a + apos + MATCH_BLOCKSIZE,
+  delta = word_matching
+        ? svn_cstring__match_length(a + apos + MATCH_BLOCKSIZE,
                                     b + bpos + MATCH_BLOCKSIZE,
-                                    max_delta);
+                                    max_delta)
+        : match_length_bytewise(a + apos + MATCH_BLOCKSIZE,
+                                b + bpos + MATCH_BLOCKSIZE,
+                                max_delta);
 
   /* See if we can extend backwards (max MATCH_BLOCKSIZE-1 steps because A's
-     content has been sampled only every MATCH_BLOCKSIZE positions).  */
-  while (apos > 0 && bpos > pending_insert_start && a[apos-1] == b[bpos-1])
-    {
-      --apos;
-      --bpos;
-      ++delta;
-    }
+     content has been sampled only every MATCH_BLOCKSIZE positions).
+     Like the forward extension, this compares whole machine words where
+     the platform allows it.  */
+  max_delta = apos < bpos - pending_insert_start
+            ? apos
+            : bpos - pending_insert_start;
+  back = word_matching
+       ? svn_cstring__reverse_match_length(a + apos, b + bpos, max_delta)
+       : reverse_match_length_bytewise(a + apos, b + bpos, max_delta);
+  apos -= back;
+  bpos -= back;
+  delta += back;
 
   *aposp = apos;
   *bposp = bpos;
@@ -414,7 +485,8 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
 
       /* Quickly skip positions whose respective ROLLING checksums
          definitely do not match any SLOT in BLOCKS. */
-      while (!(blocks.flags[hash_flags(rolling)] & (1 << (rolling & 7)))
+      while (!(  blocks.flags[hash_flags(&blocks, rolling)]
+               & (1 << (rolling & 7)))
              && lo < upper)
         {
           rolling = adler32_replace(rolling, b[lo], b[lo+MATCH_BLOCKSIZE]);
@@ -645,8 +645,9 @@ svn_fs_delete_fs(const char *path, apr_pool_t *pool)
 }
 
 svn_error_t *
-svn_fs_hotcopy3(const char *src_path, const char *dst_path,
+svn_fs_hotcopy4(const char *src_path, const char *dst_path,
                 svn_boolean_t clean, svn_boolean_t incremental,
+                apr_hash_t *fs_config,
                 svn_fs_hotcopy_notify_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
@@ -666,8 +667,8 @@ svn_fs_hotcopy3(const char *src_path, const char *dst_path,
 
   SVN_ERR(svn_fs_type(&src_fs_type, src_path, scratch_pool));
   SVN_ERR(get_library_vtable(&vtable, src_fs_type, scratch_pool));
-  src_fs = fs_new(NULL, scratch_pool);
-  dst_fs = fs_new(NULL, scratch_pool);
+  src_fs = fs_new(fs_config, scratch_pool);
+  dst_fs = fs_new(fs_config, scratch_pool);
 
   SVN_ERR(svn_io_check_path(dst_path, &dst_kind, scratch_pool));
   if (dst_kind == svn_node_file)
@@ -710,18 +711,19 @@ svn_fs_hotcopy3(const char *src_path, const char *dst_path,
 }
 
 svn_error_t *
-svn_fs_pack(const char *path,
-            svn_fs_pack_notify_t notify_func,
-            void *notify_baton,
-            svn_cancel_func_t cancel_func,
-            void *cancel_baton,
-            apr_pool_t *pool)
+svn_fs_pack2(const char *path,
+             apr_hash_t *fs_config,
+             svn_fs_pack_notify_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool)
 {
   fs_library_vtable_t *vtable;
   svn_fs_t *fs;
 
   SVN_ERR(fs_library_vtable(&vtable, path, pool));
-  fs = fs_new(NULL, pool);
+  fs = fs_new(fs_config, pool);
 
   SVN_ERR(vtable->pack_fs(fs, path, notify_func, notify_baton,
                           cancel_func, cancel_baton, common_pool_lock,
@@ -816,8 +818,8 @@ svn_error_t *
 svn_fs_hotcopy_berkeley(const char *src_path, const char *dest_path,
                         svn_boolean_t clean_logs, apr_pool_t *pool)
 {
-  return svn_error_trace(svn_fs_hotcopy3(src_path, dest_path, clean_logs,
-                                         FALSE, NULL, NULL, NULL, NULL,
+  return svn_error_trace(svn_fs_hotcopy4(src_path, dest_path, clean_logs,
+                                         FALSE, NULL, NULL, NULL, NULL, NULL,
                                          pool));
 }
 
@@ -1705,6 +1707,52 @@ svn_fs_revision_proplist2(apr_hash_t **table_p,
                                                        scratch_pool));
 }
 
+svn_error_t *
+svn_fs_revision_proplists(svn_fs_t *fs,
+                          svn_revnum_t start,
+                          svn_revnum_t end,
+                          svn_boolean_t refresh,
+                          svn_fs_revision_proplist_receiver_t receiver,
+                          void *receiver_baton,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  svn_revnum_t rev;
+  int step = start <= end ? 1 : -1;
+
+  if (fs->vtable->revision_proplists)
+    return svn_error_trace(fs->vtable->revision_proplists(fs, start, end,
+                                                          refresh,
+                                                          receiver,
+                                                          receiver_baton,
+                                                          cancel_func,
+                                                          cancel_baton,
+                                                          scratch_pool));
+
+  /* Fall back to fetching the revprops one revision at a time. */
+  iterpool = svn_pool_create(scratch_pool);
+  for (rev = start; rev != end + step; rev += step)
+    {
+      apr_hash_t *proplist;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(fs->vtable->revision_proplist(&proplist, fs, rev, refresh,
+                                            scratch_pool, iterpool));
+      SVN_ERR(receiver(receiver_baton, rev, proplist, iterpool));
+
+      /* Only the first read needs to act as a barrier. */
+      refresh = FALSE;
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_change_rev_prop2(svn_fs_t *fs, svn_revnum_t rev, const char *name,
                         const svn_string_t *const *old_value_p,
@@ -1728,6 +1776,28 @@ svn_fs_get_file_delta_stream(svn_txdelta_stream_t **stream_p,
                            target_root, target_path, pool));
 }
 
+svn_error_t *
+svn_fs__get_stored_svndiff(svn_stream_t **svndiff_p,
+                           svn_filesize_t *len_p,
+                           svn_fs_root_t *source_root,
+                           const char *source_path,
+                           svn_fs_root_t *target_root,
+                           const char *target_path,
+                           int max_version,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool)
+{
+  if (target_root->vtable->get_stored_svndiff)
+    return svn_error_trace(target_root->vtable->get_stored_svndiff(
+                             svndiff_p, len_p,
+                             source_root, source_path,
+                             target_root, target_path,
+                             max_version, result_pool, scratch_pool));
+
+  *svndiff_p = NULL;
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs__get_deleted_node(svn_fs_root_t **node_root,
                          const char **node_path,
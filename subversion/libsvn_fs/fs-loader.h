@@ -214,6 +214,17 @@ typedef struct fs_vtable_t
                                     svn_boolean_t refresh,
                                     apr_pool_t *result_pool, 
                                     apr_pool_t *scratch_pool);
+  /* May be NULL, in which case revision_proplist will be used. */
+  svn_error_t *(*revision_proplists)(svn_fs_t *fs,
+                                     svn_revnum_t start,
+                                     svn_revnum_t end,
+                                     svn_boolean_t refresh,
+                                     svn_fs_revision_proplist_receiver_t
+                                       receiver,
+                                     void *receiver_baton,
+                                     svn_cancel_func_t cancel_func,
+                                     void *cancel_baton,
+                                     apr_pool_t *scratch_pool);
   svn_error_t *(*change_rev_prop)(svn_fs_t *fs, svn_revnum_t rev,
                                   const char *name,
                                   const svn_string_t *const *old_value_p,
@@ -421,6 +432,16 @@ typedef struct root_vtable_t
                                         svn_fs_root_t *target_root,
                                         const char *target_path,
                                         apr_pool_t *pool);
+  /* May be NULL, in which case no stored svndiff data is available. */
+  svn_error_t *(*get_stored_svndiff)(svn_stream_t **svndiff_p,
+                                     svn_filesize_t *len_p,
+                                     svn_fs_root_t *source_root,
+                                     const char *source_path,
+                                     svn_fs_root_t *target_root,
+                                     const char *target_path,
+                                     int max_version,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool);
 
   /* Merging. */
   svn_error_t *(*merge)(const char **conflict_p,
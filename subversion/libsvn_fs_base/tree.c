@@ -5540,6 +5540,7 @@ static root_vtable_t root_vtable = {
   base_apply_text,
   base_contents_changed,
   base_get_file_delta_stream,
+  NULL /* get_stored_svndiff */,
   base_merge,
   base_get_mergeinfo,
 };
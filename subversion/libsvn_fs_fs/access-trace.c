@@ -0,0 +1,343 @@
+/* access-trace.c --- recording and replaying FSFS item access traces
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_strings.h>
+
+#include "svn_dirent_uri.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_subr_private.h"
+
+#include "access-trace.h"
+#include "cached_data.h"
+#include "fs.h"
+#include "util.h"
+
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_private_config.h"
+
+/* First line of every access trace file. */
+#define TRACE_HEADER "fsfs-access-trace 1\n"
+
+/* Number of integers per record. */
+#define RECORD_FIELDS 8
+
+/* Upper limit to the encoded size of a single record. */
+#define MAX_RECORD_LEN (RECORD_FIELDS * SVN__MAX_ENCODED_UINT_LEN)
+
+/* Chunk size for reading trace files. */
+#define READ_BUFFER_SIZE 0x10000
+
+svn_error_t *
+svn_fs_fs__open_access_trace(svn_fs_t *fs,
+                             const char *path,
+                             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_file_t *file;
+  svn_error_t *err;
+
+  /* Whoever creates the file writes the header.  Everybody else simply
+   * appends to it. */
+  err = svn_io_file_open(&file, path,
+                         APR_WRITE | APR_CREATE | APR_EXCL | APR_APPEND,
+                         APR_OS_DEFAULT, fs->pool);
+  if (err && APR_STATUS_IS_EEXIST(err->apr_err))
+    {
+      svn_error_clear(err);
+      SVN_ERR(svn_io_file_open(&file, path, APR_WRITE | APR_APPEND,
+                               APR_OS_DEFAULT, fs->pool));
+    }
+  else
+    {
+      SVN_ERR(err);
+      SVN_ERR(svn_io_file_write_full(file, TRACE_HEADER,
+                                     sizeof(TRACE_HEADER) - 1, NULL,
+                                     scratch_pool));
+    }
+
+  ffd->access_trace_file = file;
+
+  return SVN_NO_ERROR;
+}
+
+svn_boolean_t
+svn_fs_fs__tracing_access(svn_fs_t *fs)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  return ffd->access_trace_file || ffd->access_trace_func;
+}
+
+void
+svn_fs_fs__trace_access(svn_fs_t *fs,
+                        svn_fs_fs__access_record_t *record,
+                        apr_time_t start,
+                        apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  record->packed = svn_fs_fs__is_packed_rev(fs, record->revision);
+  record->latency = apr_time_now() - start;
+
+  if (ffd->access_trace_func)
+    ffd->access_trace_func(ffd->access_trace_baton, record);
+
+  if (ffd->access_trace_file)
+    {
+      unsigned char buffer[MAX_RECORD_LEN];
+      unsigned char *p = buffer;
+      svn_error_t *err;
+
+      p = svn__encode_uint(p, ((apr_uint64_t)record->kind << 2)
+                              | (record->packed ? 2 : 0)
+                              | (record->cache_hit ? 1 : 0));
+      p = svn__encode_uint(p, (apr_uint64_t)record->revision);
+      p = svn__encode_uint(p, record->item_index);
+      p = svn__encode_uint(p, (apr_uint64_t)(record->offset + 1));
+      p = svn__encode_uint(p, record->size);
+      p = svn__encode_uint(p, record->expanded_size);
+      p = svn__encode_uint(p, record->sub_item);
+      p = svn__encode_uint(p, (apr_uint64_t)MAX(record->latency, 0));
+
+      /* A single unbuffered write to a file opened in append mode keeps
+       * records from concurrent writers intact.  Tracing is a diagnostic
+       * aid, so don't let it fail the actual read. */
+      err = svn_io_file_write_full(ffd->access_trace_file, buffer,
+                                   p - buffer, NULL, scratch_pool);
+      if (err)
+        {
+          ffd->access_trace_file = NULL;
+          err = svn_error_quick_wrap(err, _("FSFS access tracing disabled"));
+          (fs->warning)(fs->warning_baton, err);
+          svn_error_clear(err);
+        }
+    }
+}
+
+/* Decode the record starting at *DATA into *RECORD and advance *DATA to
+ * the next record.  If there is no complete record before END, leave
+ * *DATA unchanged and set *COMPLETE to FALSE.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+static svn_error_t *
+decode_record(svn_fs_fs__access_record_t *record,
+              svn_boolean_t *complete,
+              const unsigned char **data,
+              const unsigned char *end,
+              apr_pool_t *scratch_pool)
+{
+  apr_uint64_t values[RECORD_FIELDS];
+  const unsigned char *p = *data;
+  int i;
+
+  for (i = 0; i < RECORD_FIELDS; ++i)
+    {
+      p = svn__decode_uint(&values[i], p, end);
+      if (p == NULL)
+        {
+          *complete = FALSE;
+          return SVN_NO_ERROR;
+        }
+    }
+
+  if ((values[0] >> 2) >= SVN_FS_FS__ACCESS_KIND_COUNT)
+    return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                             _("Invalid item access kind %s in trace"),
+                             apr_psprintf(scratch_pool,
+                                          "%" APR_UINT64_T_FMT,
+                                          values[0] >> 2));
+
+  record->kind = (svn_fs_fs__access_kind_t)(values[0] >> 2);
+  record->packed = (values[0] & 2) != 0;
+  record->cache_hit = (values[0] & 1) != 0;
+  record->revision = (svn_revnum_t)values[1];
+  record->item_index = values[2];
+  record->offset = (apr_off_t)values[3] - 1;
+  record->size = values[4];
+  record->expanded_size = values[5];
+  record->sub_item = values[6];
+  record->latency = (apr_interval_time_t)values[7];
+
+  *complete = TRUE;
+  *data = p;
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for capture_access(). */
+typedef struct capture_baton_t
+{
+  /* The access that we are replaying right now. */
+  const svn_fs_fs__access_record_t *recorded;
+
+  /* The matching access observed during the replay, if FOUND is set. */
+  svn_fs_fs__access_record_t replayed;
+  svn_boolean_t found;
+} capture_baton_t;
+
+/* Implements fs_fs_data_t.access_trace_func.  Store RECORD in the
+ * (capture_baton_t *) BATON if it describes the same access as the one
+ * being replayed.  Replaying a single access may trigger others, e.g.
+ * reading the header before the first delta window of a representation.
+ */
+static void
+capture_access(void *baton,
+               const svn_fs_fs__access_record_t *record)
+{
+  capture_baton_t *b = baton;
+
+  if (   record->kind == b->recorded->kind
+      && record->revision == b->recorded->revision
+      && record->item_index == b->recorded->item_index
+      && record->sub_item == b->recorded->sub_item)
+    {
+      b->replayed = *record;
+      b->found = TRUE;
+    }
+}
+
+/* Replay all records from FILE, which has been positioned just behind the
+ * header, against FS, capturing the replayed accesses in CAPTURE.  The
+ * other parameters are the same as for svn_fs_fs__replay_access_trace().
+ */
+static svn_error_t *
+replay_records(svn_fs_t *fs,
+               apr_file_t *file,
+               capture_baton_t *capture,
+               svn_fs_fs__replay_access_func_t callback_func,
+               void *callback_baton,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__replay_context_t *context;
+  unsigned char *buffer = apr_palloc(scratch_pool, READ_BUFFER_SIZE);
+  apr_size_t len = 0;
+  apr_size_t pos = 0;
+  svn_boolean_t eof = FALSE;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_fs_fs__create_replay_context(&context, fs, scratch_pool));
+
+  while (!eof || pos < len)
+    {
+      svn_boolean_t complete = TRUE;
+
+      /* Move the unprocessed tail to the front and refill the buffer. */
+      if (!eof)
+        {
+          apr_size_t bytes_read;
+
+          memmove(buffer, buffer + pos, len - pos);
+          len -= pos;
+          pos = 0;
+
+          SVN_ERR(svn_io_file_read_full2(file, buffer + len,
+                                         READ_BUFFER_SIZE - len,
+                                         &bytes_read, &eof, iterpool));
+          len += bytes_read;
+        }
+
+      /* Replay all complete records in the buffer. */
+      while (pos < len)
+        {
+          svn_fs_fs__access_record_t recorded;
+          const unsigned char *next = buffer + pos;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(decode_record(&recorded, &complete, &next, buffer + len,
+                                iterpool));
+          if (!complete)
+            break;
+
+          pos = next - buffer;
+
+          if (cancel_func)
+            SVN_ERR(cancel_func(cancel_baton));
+
+          capture->recorded = &recorded;
+          capture->found = FALSE;
+          SVN_ERR(svn_fs_fs__replay_access(context, &recorded, iterpool));
+          SVN_ERR(callback_func(&recorded,
+                                capture->found ? &capture->replayed : NULL,
+                                callback_baton, iterpool));
+        }
+
+      if (eof && !complete)
+        return svn_error_create(SVN_ERR_MALFORMED_FILE, NULL,
+                                _("Access trace ends with an incomplete "
+                                  "record"));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__replay_access_trace(svn_fs_t *fs,
+                               const char *trace_path,
+                               svn_fs_fs__replay_access_func_t callback_func,
+                               void *callback_baton,
+                               svn_cancel_func_t cancel_func,
+                               void *cancel_baton,
+                               apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_file_t *file;
+  char header[sizeof(TRACE_HEADER) - 1];
+  apr_size_t len;
+  capture_baton_t capture = { 0 };
+  apr_file_t *trace_file = ffd->access_trace_file;
+  svn_error_t *err;
+
+  SVN_ERR(svn_io_file_open(&file, trace_path, APR_READ | APR_BUFFERED,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(file, header, sizeof(header), &len, NULL,
+                                 scratch_pool));
+  if (len != sizeof(header) || memcmp(header, TRACE_HEADER, len))
+    return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                             _("'%s' is not an FSFS access trace"),
+                             svn_dirent_local_style(trace_path,
+                                                    scratch_pool));
+
+  /* Observe the accesses made during the replay but don't add them to
+   * any trace file. */
+  ffd->access_trace_file = NULL;
+  ffd->access_trace_func = capture_access;
+  ffd->access_trace_baton = &capture;
+
+  err = replay_records(fs, file, &capture, callback_func, callback_baton,
+                       cancel_func, cancel_baton, scratch_pool);
+
+  ffd->access_trace_file = trace_file;
+  ffd->access_trace_func = NULL;
+  ffd->access_trace_baton = NULL;
+
+  SVN_ERR(err);
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
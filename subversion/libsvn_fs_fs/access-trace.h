@@ -0,0 +1,97 @@
+/* access-trace.h : recording and replaying FSFS item access traces
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_ACCESS_TRACE_H
+#define SVN_LIBSVN_FS_FS_ACCESS_TRACE_H
+
+#include "svn_fs.h"
+#include "private/svn_fs_fs_private.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* An access trace file starts with a fixed header line followed by a
+ * sequence of records without any separators.  Each record consists of
+ * the following unsigned integers, encoded with svn__encode_uint():
+ *
+ *   kind * 4 + (packed ? 2 : 0) + (cache_hit ? 1 : 0)
+ *   revision
+ *   item_index
+ *   offset + 1
+ *   size
+ *   expanded_size
+ *   sub_item
+ *   latency
+ *
+ * See svn_fs_fs__access_record_t for the semantics of those fields.
+ */
+
+/* Open the access trace file at PATH for FS, creating it if necessary,
+ * and start recording all item accesses to it.  The file handle will be
+ * allocated in FS->POOL.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__open_access_trace(svn_fs_t *fs,
+                             const char *path,
+                             apr_pool_t *scratch_pool);
+
+/* Return TRUE, if item accesses in FS shall be reported to
+ * svn_fs_fs__trace_access().
+ */
+svn_boolean_t
+svn_fs_fs__tracing_access(svn_fs_t *fs);
+
+/* Complete the item access RECORD in FS that started at time START by
+ * setting its PACKED and LATENCY fields and append it to the trace.
+ * Failure to write the trace will disable tracing for FS and be reported
+ * as a warning only.  Use SCRATCH_POOL for temporary allocations.
+ */
+void
+svn_fs_fs__trace_access(svn_fs_t *fs,
+                        svn_fs_fs__access_record_t *record,
+                        apr_time_t start,
+                        apr_pool_t *scratch_pool);
+
+/* Re-execute all item accesses recorded in the access trace file at
+ * TRACE_PATH against FS, in the order they were recorded.  Call
+ * CALLBACK_FUNC with CALLBACK_BATON for each record and the corresponding
+ * record of the replayed access.  The latter will not be written to any
+ * trace file.
+ *
+ * Use optional CANCEL_FUNC with CANCEL_BATON for cancellation support and
+ * SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__replay_access_trace(svn_fs_t *fs,
+                               const char *trace_path,
+                               svn_fs_fs__replay_access_func_t callback_func,
+                               void *callback_baton,
+                               svn_cancel_func_t cancel_func,
+                               void *cancel_baton,
+                               apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_FS_ACCESS_TRACE_H */
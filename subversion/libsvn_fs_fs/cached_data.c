@@ -33,6 +33,7 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_temp_serializer.h"
 
+#include "access-trace.h"
 #include "fs_fs.h"
 #include "id.h"
 #include "index.h"
@@ -193,21 +194,6 @@ dbg_log_access(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-/* Convenience wrapper around svn_io_file_aligned_seek, taking filesystem
-   FS instead of a block size. */
-static svn_error_t *
-aligned_seek(svn_fs_t *fs,
-             apr_file_t *file,
-             apr_off_t *buffer_start,
-             apr_off_t offset,
-             apr_pool_t *pool)
-{
-  fs_fs_data_t *ffd = fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(file, ffd->block_size,
-                                                  buffer_start, offset,
-                                                  pool));
-}
-
 /* Open the revision file for revision REV in filesystem FS and store
    the newly opened file in FILE.  Seek to location OFFSET before
    returning.  Perform temporary allocations in POOL. */
@@ -227,7 +213,7 @@ open_and_seek_revision(svn_fs_fs__revision_file_t **file,
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL, item,
                                  pool));
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
 
   *file = rev_file;
 
@@ -249,7 +235,7 @@ open_and_seek_transaction(svn_fs_fs__revision_file_t **file,
 
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, NULL, SVN_INVALID_REVNUM,
                                  &rep->txn_id, rep->item_index, pool));
-  SVN_ERR(aligned_seek(fs, (*file)->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(*file, NULL, offset));
 
   return SVN_NO_ERROR;
 }
@@ -401,12 +387,14 @@ fixup_node_revision(svn_fs_t *fs,
 
 /* Get the node-revision for the node ID in FS.
    Set *NODEREV_P to the new node-revision structure, allocated in POOL.
+   Set *CACHE_HIT if the node-revision has been found in the cache.
    See svn_fs_fs__get_node_revision, which wraps this and adds another
    error. */
 static svn_error_t *
 get_node_revision_body(node_revision_t **noderev_p,
                        svn_fs_t *fs,
                        const svn_fs_id_t *id,
+                       svn_boolean_t *cache_hit,
                        apr_pool_t *result_pool,
                        apr_pool_t *scratch_pool)
 {
@@ -414,6 +402,7 @@ get_node_revision_body(node_revision_t **noderev_p,
   svn_boolean_t is_cached = FALSE;
   fs_fs_data_t *ffd = fs->fsap_data;
 
+  *cache_hit = FALSE;
   if (svn_fs_fs__id_is_txn(id))
     {
       apr_file_t *file;
@@ -461,7 +450,10 @@ get_node_revision_body(node_revision_t **noderev_p,
                                  &key,
                                  result_pool));
           if (is_cached)
-            return SVN_NO_ERROR;
+            {
+              *cache_hit = TRUE;
+              return SVN_NO_ERROR;
+            }
         }
 
       /* read the data from disk */
@@ -512,8 +504,10 @@ svn_fs_fs__get_node_revision(node_revision_t **noderev_p,
                              apr_pool_t *scratch_pool)
 {
   const svn_fs_fs__id_part_t *rev_item = svn_fs_fs__id_rev_item(id);
+  apr_time_t start = svn_fs_fs__tracing_access(fs) ? apr_time_now() : 0;
+  svn_boolean_t cache_hit;
 
-  svn_error_t *err = get_node_revision_body(noderev_p, fs, id,
+  svn_error_t *err = get_node_revision_body(noderev_p, fs, id, &cache_hit,
                                             result_pool, scratch_pool);
   if (err && err->apr_err == SVN_ERR_FS_CORRUPT)
     {
@@ -530,6 +524,18 @@ svn_fs_fs__get_node_revision(node_revision_t **noderev_p,
                          SVN_FS_FS__ITEM_TYPE_NODEREV,
                          scratch_pool));
 
+  if (start && !err && !svn_fs_fs__id_is_txn(id))
+    {
+      svn_fs_fs__access_record_t record = { 0 };
+      record.kind = svn_fs_fs__access_noderev;
+      record.revision = rev_item->revision;
+      record.item_index = rev_item->number;
+      record.offset = -1;
+      record.cache_hit = cache_hit;
+
+      svn_fs_fs__trace_access(fs, &record, start, scratch_pool);
+    }
+
   return svn_error_trace(err);
 }
 
@@ -547,7 +553,7 @@ get_fs_id_at_offset(svn_fs_id_t **id_p,
 {
   node_revision_t *noderev;
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev,
                                   rev_file->stream,
                                   pool, pool));
@@ -630,9 +636,8 @@ get_root_changes_offset(apr_off_t *root_offset,
     }
 
   /* Read in this last block, from which we will identify the last line. */
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, start, pool));
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, buffer, len, NULL, NULL,
-                                 pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, start));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, len));
 
   /* Parse the last line. */
   trailer = svn_stringbuf_ncreate(buffer, len, pool);
@@ -744,31 +749,31 @@ typedef struct rep_state_t
   int ver;          /* If a delta, what svndiff version?
                        -1 for unknown delta version. */
   int chunk_index;  /* number of the window to read */
+                    /* If not NULL, the first PREFETCHED_SIZE bytes of the
+                       representation data following START, read ahead of
+                       time by prefetch_delta_chain or mapped into memory.
+                       Anything beyond that gets read from file. */
+  const char *prefetched;
+  apr_off_t prefetched_size;
 } rep_state_t;
 
-/* Simple wrapper around svn_io_file_get_offset to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_offset to simplify callers. */
 static svn_error_t *
 get_file_offset(apr_off_t *offset,
-                rep_state_t *rs,
-                apr_pool_t *pool)
+                rep_state_t *rs)
 {
-  return svn_error_trace(svn_io_file_get_offset(offset,
-                                                rs->sfile->rfile->file,
-                                                pool));
+  return svn_error_trace(svn_fs_fs__rev_file_offset(offset,
+                                                    rs->sfile->rfile));
 }
 
-/* Simple wrapper around svn_io_file_aligned_seek to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_seek to simplify callers. */
 static svn_error_t *
 rs_aligned_seek(rep_state_t *rs,
                 apr_off_t *buffer_start,
-                apr_off_t offset,
-                apr_pool_t *pool)
+                apr_off_t offset)
 {
-  fs_fs_data_t *ffd = rs->sfile->fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(rs->sfile->rfile->file,
-                                                  ffd->block_size,
-                                                  buffer_start, offset,
-                                                  pool));
+  return svn_error_trace(svn_fs_fs__rev_file_seek(rs->sfile->rfile,
+                                                  buffer_start, offset));
 }
 
 /* Open FILE->FILE and FILE->STREAM if they haven't been opened, yet. */
@@ -808,9 +813,8 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
   if (rs->ver == -1)
     {
       char buf[4];
-      SVN_ERR(rs_aligned_seek(rs, NULL, rs->start, pool));
-      SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                     sizeof(buf), NULL, NULL, pool));
+      SVN_ERR(rs_aligned_seek(rs, NULL, rs->start));
+      SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf, sizeof(buf)));
 
       /* ### Layering violation */
       if (! ((buf[0] == 'S') && (buf[1] == 'V') && (buf[2] == 'N')))
@@ -826,6 +830,28 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* If the representation RS is stored in a memory-mapped pack file, let
+   RS->PREFETCHED point to its data within the mapping.  All further reads
+   will then use that data directly.  Use POOL for temporary allocations.
+ */
+static svn_error_t *
+auto_map_rep_data(rep_state_t *rs, apr_pool_t *pool)
+{
+  if (rs->prefetched || !SVN_IS_VALID_REVNUM(rs->revision))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(auto_open_shared_file(rs->sfile));
+  if (rs->sfile->rfile->mapped)
+    {
+      SVN_ERR(auto_set_start_offset(rs, pool));
+      rs->prefetched = svn_fs_fs__rev_file_data(rs->sfile->rfile, rs->start,
+                                                rs->size);
+      rs->prefetched_size = rs->size;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* See create_rep_state, which wraps this and adds another error. */
 static svn_error_t *
 create_rep_state_body(rep_state_t **rep_state,
@@ -841,6 +867,7 @@ create_rep_state_body(rep_state_t **rep_state,
   svn_fs_fs__rep_header_t *rh;
   svn_boolean_t is_cached = FALSE;
   apr_uint64_t estimated_window_storage;
+  apr_time_t start = svn_fs_fs__tracing_access(fs) ? apr_time_now() : 0;
 
   /* If the hint is
    * - given,
@@ -928,7 +955,7 @@ create_rep_state_body(rep_state_t **rep_state,
           SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rs->sfile->rfile,
                                          rep->revision, NULL, rep->item_index,
                                          scratch_pool));
-          SVN_ERR(rs_aligned_seek(rs, NULL, offset, scratch_pool));
+          SVN_ERR(rs_aligned_seek(rs, NULL, offset));
         }
       else
         {
@@ -941,7 +968,7 @@ create_rep_state_body(rep_state_t **rep_state,
 
       SVN_ERR(svn_fs_fs__read_rep_header(&rh, rs->sfile->rfile->stream,
                                          result_pool, scratch_pool));
-      SVN_ERR(get_file_offset(&rs->start, rs, result_pool));
+      SVN_ERR(get_file_offset(&rs->start, rs));
 
       /* populate the cache if appropriate */
       if (! svn_fs_fs__id_txn_used(&rep->txn_id))
@@ -960,6 +987,20 @@ create_rep_state_body(rep_state_t **rep_state,
   SVN_ERR(dbg_log_access(fs, rep->revision, rep->item_index, rh,
                          SVN_FS_FS__ITEM_TYPE_ANY_REP, scratch_pool));
 
+  if (start && !svn_fs_fs__id_txn_used(&rep->txn_id))
+    {
+      svn_fs_fs__access_record_t record = { 0 };
+      record.kind = svn_fs_fs__access_rep_header;
+      record.revision = rep->revision;
+      record.item_index = rep->item_index;
+      record.offset = is_cached ? -1 : rs->start - (apr_off_t)rh->header_size;
+      record.size = rep->size;
+      record.expanded_size = rep->expanded_size;
+      record.cache_hit = is_cached;
+
+      svn_fs_fs__trace_access(fs, &record, start, scratch_pool);
+    }
+
   rs->header_size = rh->header_size;
   *rep_state = rs;
   *rep_header = rh;
@@ -1541,13 +1582,264 @@ rep_read_get_baton(struct rep_read_baton **rb_p,
   return SVN_NO_ERROR;
 }
 
-/* Skip forwards to THIS_CHUNK in REP_STATE and then read the next delta
-   window into *NWIN.  Note that RS->CHUNK_INDEX will be THIS_CHUNK rather
-   than THIS_CHUNK + 1 when this function returns. */
+/* Upper limit for the amount of representation data that
+ * prefetch_delta_chain() will keep in memory. */
+#define PREFETCH_LIMIT (16 * 1024 * 1024)
+
+/* Upper limit for the size of an svndiff window header. */
+#define MAX_WINDOW_HEADER_LEN (5 * SVN__MAX_ENCODED_UINT_LEN)
+
+/* Compare the rep_state_t * elements A and B by file and offset.
+ * Implements the comparison function for svn_sort__array().
+ */
+static int
+compare_rep_state_offsets(const void *a,
+                          const void *b)
+{
+  const rep_state_t *lhs = *(const rep_state_t * const *)a;
+  const rep_state_t *rhs = *(const rep_state_t * const *)b;
+
+  if (lhs->sfile->revision != rhs->sfile->revision)
+    return lhs->sfile->revision < rhs->sfile->revision ? -1 : 1;
+  if (lhs->start != rhs->start)
+    return lhs->start < rhs->start ? -1 : 1;
+
+  return 0;
+}
+
+/* Return TRUE, if the first window of the representation RS should be
+ * read by prefetch_delta_chain(), i.e. RS is still at its start and the
+ * window is not in any of the caches yet.  Use SCRATCH_POOL for temporary
+ * allocations. */
 static svn_error_t *
-read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
-                  rep_state_t *rs, apr_pool_t *result_pool,
-                  apr_pool_t *scratch_pool)
+needs_prefetch(svn_boolean_t *prefetch,
+               rep_state_t *rs,
+               apr_pool_t *scratch_pool)
+{
+  window_cache_key_t key = { 0 };
+  svn_boolean_t is_cached = FALSE;
+
+  *prefetch = FALSE;
+  if (   rs->prefetched
+      || rs->ver != -1
+      || rs->chunk_index != 0
+      || !SVN_IS_VALID_REVNUM(rs->revision))
+    return SVN_NO_ERROR;
+
+  get_window_key(&key, rs);
+  if (rs->window_cache)
+    SVN_ERR(svn_cache__has_key(&is_cached, rs->window_cache, &key,
+                               scratch_pool));
+  if (!is_cached && rs->raw_window_cache)
+    SVN_ERR(svn_cache__has_key(&is_cached, rs->raw_window_cache, &key,
+                               scratch_pool));
+
+  *prefetch = !is_cached;
+  return SVN_NO_ERROR;
+}
+
+/* Read the delta chain of RB into memory before starting to combine its
+ * first windows.  Otherwise, we would need a separate seek and read for
+ * every representation in the chain, jumping back and forth in the rev
+ * and pack files.
+ *
+ * Instead, determine the byte ranges of all representations that have
+ * not been cached, yet, sort them by file and offset and merge ranges
+ * that are close to each other.  Read those in ascending order and let
+ * the rep states point into the respective buffer.  Stop adding
+ * representations once PREFETCH_LIMIT has been reached.
+ *
+ * Only the first window of each representation is needed for the first
+ * chunk and the caller might not read any further.  So, only read a
+ * prefix of each representation that will cover its first window in all
+ * but exotic cases.  Everything beyond that gets read on demand.
+ *
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+prefetch_delta_chain(struct rep_read_baton *rb,
+                     apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = rb->fs->fsap_data;
+  apr_array_header_t *states
+    = apr_array_make(scratch_pool, rb->rs_list->nelts + 1,
+                     sizeof(rep_state_t *));
+  apr_off_t total = 0;
+  apr_off_t prefix_size = 2 * (apr_off_t)ffd->delta_window_size;
+  int i, k;
+
+  /* Collect the representations to read.  Include the plain text base,
+   * unless that has been found in the cache. */
+  for (i = 0; i <= rb->rs_list->nelts; ++i)
+    {
+      rep_state_t *rs;
+      svn_boolean_t prefetch;
+
+      if (i < rb->rs_list->nelts)
+        {
+          rs = APR_ARRAY_IDX(rb->rs_list, i, rep_state_t *);
+          SVN_ERR(needs_prefetch(&prefetch, rs, scratch_pool));
+        }
+      else
+        {
+          rs = rb->src_state;
+          prefetch = rs && !rb->base_window && !rs->prefetched
+                  && rs->current == 0;
+        }
+
+      if (!prefetch || MIN(rs->size, prefix_size) > PREFETCH_LIMIT - total)
+        continue;
+
+      /* Data in memory-mapped pack files does not need to be copied. */
+      SVN_ERR(auto_map_rep_data(rs, scratch_pool));
+      if (rs->prefetched)
+        continue;
+
+      SVN_ERR(auto_open_shared_file(rs->sfile));
+      SVN_ERR(auto_set_start_offset(rs, scratch_pool));
+
+      rs->prefetched_size = MIN(rs->size, prefix_size);
+      total += rs->prefetched_size;
+      APR_ARRAY_PUSH(states, rep_state_t *) = rs;
+    }
+
+  /* With only a single representation to read, there is nothing to
+   * batch.  The normal code path may use block-read instead. */
+  if (states->nelts < 2)
+    return SVN_NO_ERROR;
+
+  svn_sort__array(states, compare_rep_state_offsets);
+
+  /* Read ranges of representations that are stored in the same file
+   * and have gaps of no more than one block between them. */
+  for (i = 0; i < states->nelts; i = k)
+    {
+      rep_state_t *first = APR_ARRAY_IDX(states, i, rep_state_t *);
+      apr_off_t range_start = first->start;
+      apr_off_t range_end = first->start + first->prefetched_size;
+      char *buffer;
+
+      for (k = i + 1; k < states->nelts; ++k)
+        {
+          rep_state_t *rs = APR_ARRAY_IDX(states, k, rep_state_t *);
+          if (   rs->sfile != first->sfile
+              || rs->start > range_end + ffd->block_size)
+            break;
+
+          range_end = MAX(range_end, rs->start + rs->prefetched_size);
+        }
+
+      buffer = apr_palloc(rb->filehandle_pool,
+                          (apr_size_t)(range_end - range_start));
+      SVN_ERR(rs_aligned_seek(first, NULL, range_start));
+      SVN_ERR(svn_fs_fs__rev_file_read(first->sfile->rfile, buffer,
+                                       (apr_size_t)(range_end - range_start)));
+
+      for (; i < k; ++i)
+        {
+          rep_state_t *rs = APR_ARRAY_IDX(states, i, rep_state_t *);
+          rs->prefetched = buffer + (rs->start - range_start);
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Like read_delta_window but for representations whose data has been
+ * read into memory by prefetch_delta_chain already.  If the window has
+ * not been read completely, set *FOUND to FALSE and leave RS at the
+ * start of a window so the caller can continue from file.  Otherwise,
+ * set *FOUND to TRUE. */
+static svn_error_t *
+read_prefetched_window(svn_txdelta_window_t **nwin,
+                       svn_boolean_t *found,
+                       int this_chunk,
+                       rep_state_t *rs,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  svn_string_t data;
+  apr_size_t window_len;
+
+  *found = FALSE;
+
+  /* Check the svndiff header. */
+  if (rs->ver == -1)
+    {
+      /* ### Layering violation */
+      if (   rs->prefetched_size < 4
+          || rs->prefetched[0] != 'S'
+          || rs->prefetched[1] != 'V'
+          || rs->prefetched[2] != 'N')
+        return svn_error_create
+          (SVN_ERR_FS_CORRUPT, NULL,
+           _("Malformed svndiff data in representation"));
+
+      rs->ver = rs->prefetched[3];
+      rs->chunk_index = 0;
+      rs->current = 4;
+    }
+
+  /* Skip windows to reach the current chunk and determine the size of
+   * the window to read. */
+  while (TRUE)
+    {
+      if (rs->current >= rs->size)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Reading one svndiff window read "
+                                  "beyond the end of the "
+                                  "representation"));
+
+      /* The window header may extend beyond the prefetched data. */
+      if (   rs->prefetched_size < rs->size
+          && rs->current + MAX_WINDOW_HEADER_LEN > rs->prefetched_size)
+        return SVN_NO_ERROR;
+
+      data.data = rs->prefetched + rs->current;
+      data.len = (apr_size_t)(rs->prefetched_size - rs->current);
+      SVN_ERR(svn_txdelta__read_raw_window_len(&window_len,
+                                  svn_stream_from_string(&data, scratch_pool),
+                                  rs->ver, scratch_pool));
+      if (window_len > (apr_size_t)(rs->size - rs->current))
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Reading one svndiff window read beyond "
+                                  "the end of the representation"));
+
+      if (rs->chunk_index == this_chunk)
+        break;
+
+      rs->current += window_len;
+      rs->chunk_index++;
+    }
+
+  /* Leave windows beyond the prefetched data to the caller. */
+  if (window_len > data.len)
+    return SVN_NO_ERROR;
+
+  /* Actually parse the window. */
+  data.len = window_len;
+  SVN_ERR(svn_txdelta_read_svndiff_window(nwin,
+                                  svn_stream_from_string(&data, scratch_pool),
+                                  rs->ver, result_pool));
+  rs->current += window_len;
+  *found = TRUE;
+
+  /* the window has not been cached before, thus cache it now
+   * (if caching is used for them at all) */
+  SVN_ERR(set_cached_window(*nwin, rs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* See read_delta_window, which wraps this and records the access.
+   If RECORD is not NULL, update its CACHE_HIT, OFFSET and SIZE fields
+   when reading from the rev / pack file. */
+static svn_error_t *
+read_delta_window_body(svn_txdelta_window_t **nwin, int this_chunk,
+                       rep_state_t *rs,
+                       svn_fs_fs__access_record_t *record,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
 {
   svn_boolean_t is_cached;
   apr_off_t start_offset;
@@ -1565,6 +1857,17 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   if (is_cached)
     return SVN_NO_ERROR;
 
+  /* The data may already be in memory. */
+  SVN_ERR(auto_map_rep_data(rs, scratch_pool));
+  if (rs->prefetched)
+    {
+      svn_boolean_t found;
+      SVN_ERR(read_prefetched_window(nwin, &found, this_chunk, rs,
+                                     result_pool, scratch_pool));
+      if (found)
+        return SVN_NO_ERROR;
+    }
+
   /* someone has to actually read the data from file.  Open it */
   SVN_ERR(auto_open_shared_file(rs->sfile));
 
@@ -1576,6 +1879,9 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
       && use_block_read(rs->sfile->fs)
       && rs->raw_window_cache)
     {
+      if (record)
+        record->cache_hit = FALSE;
+
       SVN_ERR(block_read(NULL, rs->sfile->fs, rs->revision, rs->item_index,
                          rs->sfile->rfile, result_pool, scratch_pool));
 
@@ -1595,17 +1901,21 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   /* RS->FILE may be shared between RS instances -> make sure we point
    * to the right data. */
   start_offset = rs->start + rs->current;
-  SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, scratch_pool));
+  SVN_ERR(rs_aligned_seek(rs, NULL, start_offset));
 
   /* Skip windows to reach the current chunk if we aren't there yet. */
   iterpool = svn_pool_create(scratch_pool);
   while (rs->chunk_index < this_chunk)
     {
+      apr_size_t window_len;
+
       svn_pool_clear(iterpool);
-      SVN_ERR(svn_txdelta_skip_svndiff_window(rs->sfile->rfile->file,
-                                              rs->ver, iterpool));
+      SVN_ERR(svn_txdelta__read_raw_window_len(&window_len,
+                                               rs->sfile->rfile->stream,
+                                               rs->ver, iterpool));
       rs->chunk_index++;
-      SVN_ERR(get_file_offset(&start_offset, rs, iterpool));
+      start_offset += window_len;
+      SVN_ERR(rs_aligned_seek(rs, NULL, start_offset));
       rs->current = start_offset - rs->start;
       if (rs->current >= rs->size)
         return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
@@ -1618,13 +1928,20 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   /* Actually read the next window. */
   SVN_ERR(svn_txdelta_read_svndiff_window(nwin, rs->sfile->rfile->stream,
                                           rs->ver, result_pool));
-  SVN_ERR(get_file_offset(&end_offset, rs, scratch_pool));
+  SVN_ERR(get_file_offset(&end_offset, rs));
   rs->current = end_offset - rs->start;
   if (rs->current > rs->size)
     return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
                             _("Reading one svndiff window read beyond "
                               "the end of the representation"));
 
+  if (record)
+    {
+      record->cache_hit = FALSE;
+      record->offset = start_offset;
+      record->size = end_offset - start_offset;
+    }
+
   /* the window has not been cached before, thus cache it now
    * (if caching is used for them at all) */
   if (SVN_IS_VALID_REVNUM(rs->revision))
@@ -1633,6 +1950,39 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   return SVN_NO_ERROR;
 }
 
+/* Skip forwards to THIS_CHUNK in REP_STATE and then read the next delta
+   window into *NWIN.  Note that RS->CHUNK_INDEX will be THIS_CHUNK rather
+   than THIS_CHUNK + 1 when this function returns. */
+static svn_error_t *
+read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
+                  rep_state_t *rs, apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = rs->sfile->fs;
+  svn_fs_fs__access_record_t record = { 0 };
+  apr_time_t start;
+
+  /* Windows of in-txn representations are not being traced. */
+  if (!SVN_IS_VALID_REVNUM(rs->revision) || !svn_fs_fs__tracing_access(fs))
+    return svn_error_trace(read_delta_window_body(nwin, this_chunk, rs, NULL,
+                                                  result_pool,
+                                                  scratch_pool));
+
+  start = apr_time_now();
+  record.kind = svn_fs_fs__access_delta_window;
+  record.revision = rs->revision;
+  record.item_index = rs->item_index;
+  record.offset = -1;
+  record.sub_item = this_chunk;
+  record.cache_hit = TRUE;
+
+  SVN_ERR(read_delta_window_body(nwin, this_chunk, rs, &record,
+                                 result_pool, scratch_pool));
+  svn_fs_fs__trace_access(fs, &record, start, scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Read SIZE bytes from the representation RS and return it in *NWIN. */
 static svn_error_t *
 read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
@@ -1641,19 +1991,35 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
 {
   apr_off_t offset;
 
+  /* The data may already be in memory. */
+  SVN_ERR(auto_map_rep_data(rs, scratch_pool));
+  if (rs->prefetched && rs->current + (apr_off_t)size > rs->size)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Reading beyond the end of the "
+                              "representation"));
+
+  if (rs->prefetched && rs->current + (apr_off_t)size <= rs->prefetched_size)
+    {
+      *nwin = svn_stringbuf_ncreate(rs->prefetched + rs->current, size,
+                                    result_pool);
+      rs->current += (apr_off_t)size;
+
+      return SVN_NO_ERROR;
+    }
+
   /* RS->FILE may be shared between RS instances -> make sure we point
    * to the right data. */
   SVN_ERR(auto_open_shared_file(rs->sfile));
   SVN_ERR(auto_set_start_offset(rs, scratch_pool));
 
   offset = rs->start + rs->current;
-  SVN_ERR(rs_aligned_seek(rs, NULL, offset, scratch_pool));
+  SVN_ERR(rs_aligned_seek(rs, NULL, offset));
 
   /* Read the plain data. */
   *nwin = svn_stringbuf_create_ensure(size, result_pool);
-  SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, (*nwin)->data, size,
-                                 NULL, NULL, result_pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, (*nwin)->data, size));
   (*nwin)->data[size] = 0;
+  (*nwin)->len = size;
 
   /* Update RS. */
   rs->current += (apr_off_t)size;
@@ -1672,6 +2038,39 @@ skip_plain_window(rep_state_t *rs,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__rep_window_size_matches(svn_boolean_t *matches,
+                                   representation_t *rep,
+                                   apr_size_t window_size,
+                                   svn_fs_t *fs,
+                                   apr_pool_t *scratch_pool)
+{
+  rep_state_t *rs;
+  svn_fs_fs__rep_header_t *header;
+  svn_txdelta_window_t *window;
+  shared_file_t *file_hint = NULL;
+
+  /* PLAIN reps get read in whatever chunks the delta on top of them
+     asks for. */
+  SVN_ERR(create_rep_state(&rs, &header, &file_hint, rep, fs,
+                           scratch_pool, scratch_pool));
+  if (header->type == svn_fs_fs__rep_plain)
+    {
+      *matches = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  /* All but the last window of a delta rep span exactly the window size
+     it has been written with.  A rep that fits into a single window is
+     fine with any window size that covers all of it. */
+  SVN_ERR(read_delta_window(&window, 0, rs, scratch_pool, scratch_pool));
+  *matches = (window->tview_len == window_size)
+          || (   window->tview_len < window_size
+              && (svn_filesize_t)window->tview_len == rep->expanded_size);
+
+  return SVN_NO_ERROR;
+}
+
 /* Get the undeltified window that is a result of combining all deltas
    from the current desired representation identified in *RB with its
    base representation.  Store the window in *RESULT. */
@@ -1693,6 +2092,10 @@ get_combined_window(svn_stringbuf_t **result,
   window_pool = svn_pool_create(rb->pool);
   windows = apr_array_make(window_pool, 0, sizeof(svn_txdelta_window_t *));
   iterpool = svn_pool_create(rb->pool);
+
+  /* Fetch the data of all uncached reps in one go. */
+  if (rb->chunk_index == 0)
+    SVN_ERR(prefetch_delta_chain(rb, iterpool));
   for (i = 0; i < rb->rs_list->nelts; ++i)
     {
       svn_txdelta_window_t *window;
@@ -1839,9 +2242,8 @@ get_contents_from_windows(struct rep_read_baton *rb,
           SVN_ERR(auto_set_start_offset(rs, rb->pool));
 
           offset = rs->start + rs->current;
-          SVN_ERR(rs_aligned_seek(rs, NULL, offset, rb->pool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, cur,
-                                         copy_len, NULL, NULL, rb->pool));
+          SVN_ERR(rs_aligned_seek(rs, NULL, offset));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, cur, copy_len));
         }
 
       rs->current += copy_len;
@@ -2267,6 +2669,7 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
                                   apr_off_t offset,
                                   apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_read_baton *rb;
   pair_cache_key_t fulltext_cache_key = { SVN_INVALID_REVNUM, 0 };
   rep_state_t *rs = apr_pcalloc(pool, sizeof(*rs));
@@ -2294,12 +2697,14 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
   rs->sfile->rfile->start_revision = SVN_INVALID_REVNUM;
   rs->sfile->rfile->file = file;
   rs->sfile->rfile->stream = svn_stream_from_aprfile2(file, TRUE, pool);
+  rs->sfile->rfile->block_size = ffd->block_size;
+  rs->sfile->rfile->pool = pool;
 
   /* Read the rep header. */
-  SVN_ERR(aligned_seek(fs, file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rs->sfile->rfile, NULL, offset));
   SVN_ERR(svn_fs_fs__read_rep_header(&rh, rs->sfile->rfile->stream,
                                      pool, pool));
-  SVN_ERR(get_file_offset(&rs->start, rs, pool));
+  SVN_ERR(get_file_offset(&rs->start, rs));
   rs->header_size = rh->header_size;
 
   /* Log the access. */
@@ -2472,6 +2877,31 @@ get_storaged_delta_stream(rep_state_t *rep_state,
                                    delta_read_md5_digest, pool);
 }
 
+/* Set *USABLE to TRUE if the stored delta representation RS may be handed
+   out to arbitrary consumers as is.  This is not the case for svndiff3
+   data because its windows may exceed the size limit of older svndiff
+   versions.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+storaged_delta_usable(svn_boolean_t *usable,
+                      rep_state_t *rs,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = rs->sfile->fs->fsap_data;
+
+  if (ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    {
+      *usable = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(auto_open_shared_file(rs->sfile));
+  SVN_ERR(auto_set_start_offset(rs, scratch_pool));
+  SVN_ERR(auto_read_diff_version(rs, scratch_pool));
+  *usable = rs->ver < 3;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
                                  svn_fs_t *fs,
@@ -2482,6 +2912,7 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
   svn_stream_t *source_stream, *target_stream;
   rep_state_t *rep_state;
   svn_fs_fs__rep_header_t *rep_header;
+  svn_boolean_t usable = FALSE;
   fs_fs_data_t *ffd = fs->fsap_data;
 
   /* Try a shortcut: if the target is stored as a delta against the source,
@@ -2501,6 +2932,9 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
           if (rep_header->type == svn_fs_fs__rep_delta
               && rep_header->base_revision == source->data_rep->revision
               && rep_header->base_item_index == source->data_rep->item_index)
+            SVN_ERR(storaged_delta_usable(&usable, rep_state, pool));
+
+          if (usable)
             {
               *stream_p = get_storaged_delta_stream(rep_state, target, pool);
               return SVN_NO_ERROR;
@@ -2512,6 +2946,9 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
              added in this revision and is already stored in the requested
              format. */
           if (rep_header->type == svn_fs_fs__rep_self_delta)
+            SVN_ERR(storaged_delta_usable(&usable, rep_state, pool));
+
+          if (usable)
             {
               *stream_p = get_storaged_delta_stream(rep_state, target, pool);
               return SVN_NO_ERROR;
@@ -2543,6 +2980,122 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
   return SVN_NO_ERROR;
 }
 
+/* Baton used when reading raw svndiff data. */
+typedef struct stored_svndiff_baton_t
+{
+  /* The delta representation to read.  Its file is positioned at
+     START + CURRENT. */
+  rep_state_t *rs;
+
+  /* Number of bytes already returned, relative to RS->START. */
+  apr_off_t current;
+} stored_svndiff_baton_t;
+
+/* This implements the svn_read_fn_t interface. */
+static svn_error_t *
+stored_svndiff_read(void *baton,
+                    char *buffer,
+                    apr_size_t *len)
+{
+  stored_svndiff_baton_t *ssb = baton;
+  apr_off_t remaining = ssb->rs->size - ssb->current;
+
+  if ((apr_off_t)*len > remaining)
+    *len = (apr_size_t)remaining;
+
+  if (*len)
+    {
+      SVN_ERR(svn_fs_fs__rev_file_read(ssb->rs->sfile->rfile, buffer,
+                                       *len));
+      ssb->current += *len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* This implements the svn_close_fn_t interface. */
+static svn_error_t *
+stored_svndiff_close(void *baton)
+{
+  stored_svndiff_baton_t *ssb = baton;
+  svn_fs_fs__revision_file_t *rfile = ssb->rs->sfile->rfile;
+
+  /* Don't keep file handles open for longer than necessary. */
+  ssb->rs->sfile->rfile = NULL;
+  if (rfile)
+    SVN_ERR(svn_fs_fs__close_revision_file(rfile));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__get_stored_svndiff(svn_stream_t **stream_p,
+                              svn_filesize_t *len_p,
+                              svn_fs_t *fs,
+                              node_revision_t *source,
+                              node_revision_t *target,
+                              int max_version,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool)
+{
+  rep_state_t *rs;
+  svn_fs_fs__rep_header_t *rep_header;
+  svn_boolean_t match;
+  stored_svndiff_baton_t *ssb;
+
+  *stream_p = NULL;
+
+  /* Empty files and uncommitted contents don't have stored deltas. */
+  if (!target->data_rep || !SVN_IS_VALID_REVNUM(target->data_rep->revision))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(create_rep_state(&rs, &rep_header, NULL, target->data_rep, fs,
+                           result_pool, scratch_pool));
+
+  /* A SOURCE without contents is the same as the empty delta base. */
+  if (source && source->data_rep)
+    match = rep_header->type == svn_fs_fs__rep_delta
+         && rep_header->base_revision == source->data_rep->revision
+         && rep_header->base_item_index == source->data_rep->item_index;
+  else
+    match = rep_header->type == svn_fs_fs__rep_self_delta;
+
+  if (match)
+    {
+      SVN_ERR(auto_open_shared_file(rs->sfile));
+      SVN_ERR(auto_set_start_offset(rs, scratch_pool));
+      SVN_ERR(auto_read_diff_version(rs, scratch_pool));
+      match = rs->ver <= max_version;
+    }
+
+  if (!match)
+    {
+      /* Don't keep file handles open for longer than necessary. */
+      if (rs->sfile->rfile)
+        {
+          SVN_ERR(svn_fs_fs__close_revision_file(rs->sfile->rfile));
+          rs->sfile->rfile = NULL;
+        }
+
+      return SVN_NO_ERROR;
+    }
+
+  /* Return everything from the svndiff header up to the end of the
+     representation. */
+  SVN_ERR(rs_aligned_seek(rs, NULL, rs->start));
+
+  ssb = apr_pcalloc(result_pool, sizeof(*ssb));
+  ssb->rs = rs;
+
+  *stream_p = svn_stream_create(ssb, result_pool);
+  svn_stream_set_read2(*stream_p, NULL /* only full read support */,
+                       stored_svndiff_read);
+  svn_stream_set_close(*stream_p, stored_svndiff_close);
+  *len_p = rs->size;
+
+  return SVN_NO_ERROR;
+}
+
 /* Return TRUE when all svn_fs_dirent_t* in ENTRIES are already sorted
    by their respective name. */
 static svn_boolean_t
@@ -2728,6 +3281,64 @@ get_txn_dir_info(svn_filesize_t *filesize,
   return SVN_NO_ERROR;
 }
 
+/* Into *ENTRIES_P, read all directory entries from the paged directory
+ * representation contents TEXT.  ID is provided for nicer error messages.
+ */
+static svn_error_t *
+read_paged_dir_entries(apr_array_header_t **entries_p,
+                       svn_stringbuf_t *text,
+                       const svn_fs_id_t *id,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_fs_fs__dir_index_t *index;
+  apr_array_header_t *entries;
+  int i;
+
+  SVN_ERR(svn_fs_fs__parse_dir_index(&index, text->data, text->len,
+                                     scratch_pool));
+  entries = apr_array_make(result_pool, (int)index->entry_count,
+                           sizeof(svn_fs_dirent_t *));
+
+  /* Pages are sorted and so are the entries within each page. */
+  for (i = 0; i < index->page_count; ++i)
+    {
+      svn_fs_fs__dir_page_t *page = &index->pages[i];
+      apr_array_header_t *page_entries;
+      svn_string_t page_text;
+
+      svn_pool_clear(iterpool);
+      if (page->offset + page->size > text->len)
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Directory page beyond the end of the "
+                                   "representation in '%s'"),
+                                 svn_fs_fs__id_unparse(id, iterpool)->data);
+
+      page_text.data = text->data + page->offset;
+      page_text.len = page->size;
+      SVN_ERR(read_dir_entries(&page_entries,
+                               svn_stream_from_string(&page_text, iterpool),
+                               FALSE, id, result_pool, iterpool));
+      apr_array_cat(entries, page_entries);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  if (entries->nelts != index->entry_count)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Directory index of '%s' lists %s entries "
+                               "but %d have been found"),
+                             svn_fs_fs__id_unparse(id, scratch_pool)->data,
+                             apr_psprintf(scratch_pool, "%" APR_INT64_T_FMT,
+                                          index->entry_count),
+                             entries->nelts);
+
+  *entries_p = entries;
+
+  return SVN_NO_ERROR;
+}
+
 /* Fetch the contents of a directory into DIR.  Values are stored
    as filename to string mappings; further conversion is necessary to
    convert them into svn_fs_dirent_t values. */
@@ -2773,6 +3384,7 @@ get_dir_contents(svn_fs_fs__dir_data_t *dir,
        * parse it byte-by-byte.
        */
       apr_size_t len = noderev->data_rep->expanded_size;
+      apr_size_t index_end;
       svn_stringbuf_t *text;
 
       /* The representation is immutable.  Read it normally. */
@@ -2781,10 +3393,20 @@ get_dir_contents(svn_fs_fs__dir_data_t *dir,
       SVN_ERR(svn_stringbuf_from_stream(&text, contents, len, scratch_pool));
       SVN_ERR(svn_stream_close(contents));
 
-      /* de-serialize hash */
-      contents = svn_stream_from_stringbuf(text, scratch_pool);
-      SVN_ERR(read_dir_entries(&dir->entries, contents, FALSE, noderev->id,
-                               result_pool, scratch_pool));
+      /* de-serialize hash, possibly split into pages */
+      SVN_ERR(svn_fs_fs__parse_dir_index_header(&index_end, text->data,
+                                                text->len));
+      if (index_end)
+        {
+          SVN_ERR(read_paged_dir_entries(&dir->entries, text, noderev->id,
+                                         result_pool, scratch_pool));
+        }
+      else
+        {
+          contents = svn_stream_from_stringbuf(text, scratch_pool);
+          SVN_ERR(read_dir_entries(&dir->entries, contents, FALSE,
+                                   noderev->id, result_pool, scratch_pool));
+        }
     }
   else
     {
@@ -2886,6 +3508,183 @@ svn_fs_fs__rep_contents_dir(apr_array_header_t **entries_p,
   return SVN_NO_ERROR;
 }
 
+/* Read SIZE bytes starting at OFFSET from the PLAIN representation RS and
+ * return them in *TEXT, allocated in RESULT_POOL. */
+static svn_error_t *
+read_plain_range(svn_stringbuf_t **text,
+                 rep_state_t *rs,
+                 apr_size_t offset,
+                 apr_size_t size,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  if ((apr_off_t)offset + (apr_off_t)size > rs->size)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Reading beyond the end of the "
+                              "representation"));
+
+  rs->current = offset;
+  return svn_error_trace(read_plain_window(text, rs, size, result_pool,
+                                           scratch_pool));
+}
+
+/* Read the index of the committed directory representation REP in FS
+ * and return it in *INDEX_P, allocated in RESULT_POOL.  For directories
+ * that are not paged, the index will contain no pages.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_dir_index(svn_fs_fs__dir_index_t **index_p,
+               svn_fs_t *fs,
+               representation_t *rep,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  rep_state_t *rs;
+  svn_fs_fs__rep_header_t *rh;
+  svn_stringbuf_t *text;
+  apr_size_t index_end;
+  svn_fs_fs__dir_index_t *index;
+  int i;
+
+  /* Paged directories are never deltified. */
+  SVN_ERR(create_rep_state(&rs, &rh, NULL, rep, fs, scratch_pool,
+                           scratch_pool));
+  if (rh->type != svn_fs_fs__rep_plain)
+    {
+      *index_p = apr_pcalloc(result_pool, sizeof(**index_p));
+      return SVN_NO_ERROR;
+    }
+
+  /* The header line tells us how large the whole index is. */
+  SVN_ERR(read_plain_range(&text, rs, 0,
+                           (apr_size_t)MIN(rs->size,
+                                           SVN_FS_FS__PAGED_DIR_HEADER_MAX),
+                           scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__parse_dir_index_header(&index_end, text->data,
+                                            text->len));
+  if (index_end == 0)
+    {
+      *index_p = apr_pcalloc(result_pool, sizeof(**index_p));
+      return SVN_NO_ERROR;
+    }
+
+  if (index_end > text->len)
+    SVN_ERR(read_plain_range(&text, rs, 0, index_end, scratch_pool,
+                             scratch_pool));
+  SVN_ERR(svn_fs_fs__parse_dir_index(&index, text->data, index_end,
+                                     result_pool));
+
+  /* All pages must be within the representation. */
+  for (i = 0; i < index->page_count; ++i)
+    if (  (apr_off_t)index->pages[i].offset + (apr_off_t)index->pages[i].size
+        > rs->size)
+      return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                              _("Directory page beyond the end of the "
+                                "representation"));
+
+  *index_p = index;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the page from INDEX that may contain the entry NAME or NULL if
+ * NAME sorts before all entries. */
+static svn_fs_fs__dir_page_t *
+find_dir_page(svn_fs_fs__dir_index_t *index,
+              const char *name)
+{
+  int lower = 0;
+  int upper = index->page_count;
+
+  while (lower < upper)
+    {
+      int middle = lower + (upper - lower) / 2;
+      if (strcmp(index->pages[middle].first_name, name) <= 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  return lower ? &index->pages[lower - 1] : NULL;
+}
+
+/* If the committed directory NODEREV in FS is paged, set *PAGED to TRUE
+ * and return its entry NAME in *DIRENT, allocated in RESULT_POOL, or NULL
+ * if no such entry exists.  Only the index and a single page will be read.
+ * If the directory is not paged, set *PAGED to FALSE.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_paged_dir_entry(svn_fs_dirent_t **dirent,
+                    svn_boolean_t *paged,
+                    svn_fs_t *fs,
+                    node_revision_t *noderev,
+                    const char *name,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  representation_t *rep = noderev->data_rep;
+  pair_cache_key_t key = { 0 };
+  extract_dir_page_baton_t baton;
+  svn_fs_fs__dir_page_t *page = NULL;
+  svn_boolean_t found = FALSE;
+  rep_state_t *rs;
+  svn_fs_fs__rep_header_t *rh;
+  svn_stringbuf_t *text;
+  apr_array_header_t *entries;
+  svn_fs_dirent_t *entry;
+
+  /* Find the page that may contain NAME. */
+  key.revision = rep->revision;
+  key.second = rep->item_index;
+  baton.name = name;
+  baton.paged = FALSE;
+
+  if (ffd->dir_index_cache)
+    SVN_ERR(svn_cache__get_partial((void **)&page, &found,
+                                   ffd->dir_index_cache, &key,
+                                   svn_fs_fs__extract_dir_page, &baton,
+                                   scratch_pool));
+
+  if (!found)
+    {
+      svn_fs_fs__dir_index_t *index;
+      SVN_ERR(read_dir_index(&index, fs, rep, scratch_pool, scratch_pool));
+      if (ffd->dir_index_cache)
+        SVN_ERR(svn_cache__set(ffd->dir_index_cache, &key, index,
+                               scratch_pool));
+
+      baton.paged = index->page_count > 0;
+      page = find_dir_page(index, name);
+    }
+
+  *paged = baton.paged;
+  *dirent = NULL;
+  if (!baton.paged || page == NULL)
+    return SVN_NO_ERROR;
+
+  /* Read and parse just that page. */
+  SVN_ERR(create_rep_state(&rs, &rh, NULL, rep, fs, scratch_pool,
+                           scratch_pool));
+  SVN_ERR(read_plain_range(&text, rs, page->offset, page->size,
+                           scratch_pool, scratch_pool));
+  SVN_ERR(read_dir_entries(&entries,
+                           svn_stream_from_stringbuf(text, scratch_pool),
+                           FALSE, noderev->id, scratch_pool, scratch_pool));
+
+  /* find desired entry and return a copy in POOL, if found */
+  entry = svn_fs_fs__find_dir_entry(entries, name, NULL);
+  if (entry)
+    {
+      *dirent = apr_palloc(result_pool, sizeof(**dirent));
+      (*dirent)->name = apr_pstrdup(result_pool, entry->name);
+      (*dirent)->id = svn_fs_fs__id_copy(entry->id, result_pool);
+      (*dirent)->kind = entry->kind;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_fs_dirent_t *
 svn_fs_fs__find_dir_entry(apr_array_header_t *entries,
                           const char *name,
@@ -2932,9 +3731,21 @@ svn_fs_fs__rep_contents_dir_entry(svn_fs_dirent_t **dirent,
   /* fetch data from disk if we did not find it in the cache */
   if (! found || baton.out_of_date)
     {
+      fs_fs_data_t *ffd = fs->fsap_data;
       svn_fs_dirent_t *entry;
       svn_fs_dirent_t *entry_copy = NULL;
       svn_fs_fs__dir_data_t dir;
+      svn_boolean_t paged = FALSE;
+
+      /* Committed paged directories let us read just a single page. */
+      if (   ffd->paged_directories
+          && noderev->data_rep
+          && !svn_fs_fs__id_txn_used(&noderev->data_rep->txn_id))
+        SVN_ERR(get_paged_dir_entry(dirent, &paged, fs, noderev, name,
+                                    result_pool, scratch_pool));
+
+      if (paged)
+        return SVN_NO_ERROR;
 
       /* Read in the directory contents. */
       SVN_ERR(get_dir_contents(&dir, fs, noderev, scratch_pool,
@@ -3066,11 +3877,21 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
   svn_boolean_t found;
   fs_fs_data_t *ffd = context->fs->fsap_data;
   svn_fs_fs__changes_list_t *changes_list;
+  apr_time_t start = svn_fs_fs__tracing_access(context->fs)
+                   ? apr_time_now()
+                   : 0;
+  svn_fs_fs__access_record_t record = { 0 };
 
   pair_cache_key_t key;
   key.revision = context->revision;
   key.second = context->next;
 
+  record.kind = svn_fs_fs__access_changes;
+  record.revision = context->revision;
+  record.item_index = SVN_FS_FS__ITEM_INDEX_CHANGES;
+  record.offset = -1;
+  record.sub_item = context->next;
+
   /* try cache lookup first */
 
   if (ffd->changes_cache)
@@ -3083,6 +3904,7 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
       found = FALSE;
     }
 
+  record.cache_hit = found;
   if (!found)
     {
       /* read changes from revision file */
@@ -3142,9 +3964,9 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
             }
 
           /* Actual reading and parsing are the same, though. */
-          SVN_ERR(aligned_seek(context->fs, context->revision_file->file,
-                               NULL, changes_offset + context->next_offset,
-                               scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_seek(context->revision_file, NULL,
+                                           changes_offset
+                                             + context->next_offset));
 
           SVN_ERR(svn_fs_fs__read_changes(changes,
                                           context->revision_file->stream,
@@ -3153,15 +3975,17 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
 
           /* Construct the info object for the entries block we just read. */
           changes_list = apr_pcalloc(scratch_pool, sizeof(*changes_list));
-          SVN_ERR(svn_io_file_get_offset(&changes_list->end_offset,
-                                         context->revision_file->file,
-                                         scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_offset(&changes_list->end_offset,
+                                             context->revision_file));
           changes_list->end_offset -= changes_offset;
           changes_list->start_offset = context->next_offset;
           changes_list->count = (*changes)->nelts;
           changes_list->changes = (change_t **)(*changes)->elts;
           changes_list->eol = changes_list->count < SVN_FS_FS__CHANGES_BLOCK_SIZE;
 
+          record.offset = changes_offset + changes_list->start_offset;
+          record.size = changes_list->end_offset - changes_list->start_offset;
+
           /* cache for future reference */
 
           if (ffd->changes_cache)
@@ -3194,6 +4018,9 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
   SVN_ERR(dbg_log_access(context->fs, context->revision, item_index, *changes,
                          SVN_FS_FS__ITEM_TYPE_CHANGES, scratch_pool));
 
+  if (start)
+    svn_fs_fs__trace_access(context->fs, &record, start, scratch_pool);
+
   return SVN_NO_ERROR;
 }
 
@@ -3330,16 +4157,16 @@ cache_windows(svn_fs_t *fs,
           char *buf;
 
           /* navigate to the current window */
-          SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
+          SVN_ERR(rs_aligned_seek(rs, NULL, start_offset));
           SVN_ERR(svn_txdelta__read_raw_window_len(&window_len,
                                                    rs->sfile->rfile->stream,
-                                                   iterpool));
+                                                   rs->ver, iterpool));
 
           /* Read the raw window. */
           buf = apr_palloc(iterpool, window_len + 1);
-          SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                         window_len, NULL, NULL, iterpool));
+          SVN_ERR(rs_aligned_seek(rs, NULL, start_offset));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf,
+                                           window_len));
           buf[window_len] = 0;
 
           /* update relative offset in representation */
@@ -3415,12 +4242,11 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
       /* for larger reps, the header may have crossed a block boundary.
        * make sure we still read blocks properly aligned, i.e. don't use
        * plain seek here. */
-      SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, scratch_pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
 
       plaintext = svn_stringbuf_create_ensure(rs.size, result_pool);
-      SVN_ERR(svn_io_file_read_full2(rev_file->file, plaintext->data,
-                                     rs.size, &plaintext->len, NULL,
-                                     result_pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, plaintext->data, rs.size));
+      plaintext->len = rs.size;
       plaintext->data[plaintext->len] = 0;
       rs.current += rs.size;
 
@@ -3510,16 +4336,23 @@ read_item(svn_stream_t **stream,
   apr_uint32_t digest;
   svn_checksum_t *expected, *actual;
   apr_uint32_t plain_digest;
-
-  /* Read item into string buffer. */
-  svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
-  text->len = entry->size;
-  text->data[text->len] = 0;
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, text->data, text->len,
-                                 NULL, NULL, pool));
+  svn_string_t *text = apr_palloc(pool, sizeof(*text));
+
+  /* Items in memory-mapped pack files can be parsed in-place.
+   * Otherwise, read the item into a string buffer. */
+  text->data = svn_fs_fs__rev_file_data(rev_file, entry->offset,
+                                        entry->size);
+  text->len = (apr_size_t)entry->size;
+  if (text->data == NULL)
+    {
+      char *buffer = apr_palloc(pool, text->len + 1);
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, text->len));
+      buffer[text->len] = 0;
+      text->data = buffer;
+    }
 
   /* Return (construct, calculate) stream and checksum. */
-  *stream = svn_stream_from_stringbuf(text, pool);
+  *stream = svn_stream_from_string(text, pool);
   digest = svn__fnv1a_32x4(text->data, text->len);
 
   /* Checksums will match most of the time. */
@@ -3718,8 +4551,7 @@ block_read(void **result,
                                           ffd->block_size, scratch_pool,
                                           scratch_pool));
 
-      SVN_ERR(aligned_seek(fs, revision_file->file, &block_start, offset,
-                           iterpool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(revision_file, &block_start, offset));
 
       /* read all items from the block */
       for (i = 0; i < entries->nelts; ++i)
@@ -3751,8 +4583,8 @@ block_read(void **result,
                             && entry->size < ffd->block_size))
             {
               void *item = NULL;
-              SVN_ERR(svn_io_file_seek(revision_file->file, APR_SET,
-                                       &entry->offset, iterpool));
+              SVN_ERR(svn_fs_fs__rev_file_seek(revision_file, NULL,
+                                               entry->offset));
               switch (entry->type)
                 {
                   case SVN_FS_FS__ITEM_TYPE_FILE_REP:
@@ -3804,3 +4636,172 @@ block_read(void **result,
 
   return SVN_NO_ERROR;
 }
+
+/* Baton type for replaying item accesses. */
+struct svn_fs_fs__replay_context_t
+{
+  /* The filesystem to read from. */
+  svn_fs_t *fs;
+
+  /* Representations for which we replayed the header access, i.e. a
+   * pair_cache_key_t * -> representation_t * map. */
+  apr_hash_t *reps;
+
+  /* State of the representation whose delta windows we read most
+   * recently.  NULL until the first representation has been replayed. */
+  rep_state_t *rs;
+
+  /* Pool for the long-lived data in this context. */
+  apr_pool_t *pool;
+
+  /* Pool for RS.  Gets cleared whenever we switch representations. */
+  apr_pool_t *rs_pool;
+};
+
+svn_error_t *
+svn_fs_fs__create_replay_context(svn_fs_fs__replay_context_t **context,
+                                 svn_fs_t *fs,
+                                 apr_pool_t *result_pool)
+{
+  svn_fs_fs__replay_context_t *result = apr_pcalloc(result_pool,
+                                                    sizeof(*result));
+  result->fs = fs;
+  result->reps = apr_hash_make(result_pool);
+  result->pool = result_pool;
+  result->rs_pool = svn_pool_create(result_pool);
+
+  *context = result;
+  return SVN_NO_ERROR;
+}
+
+/* Replace the current representation state in CONTEXT with a new one for
+ * reading REP.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+replay_rep_header(svn_fs_fs__replay_context_t *context,
+                  representation_t *rep,
+                  apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__rep_header_t *rh;
+
+  svn_pool_clear(context->rs_pool);
+  context->rs = NULL;
+
+  SVN_ERR(create_rep_state(&context->rs, &rh, NULL, rep, context->fs,
+                           context->rs_pool, scratch_pool));
+
+  /* PLAIN representations don't have delta windows. */
+  if (rh->type == svn_fs_fs__rep_plain)
+    context->rs = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__replay_access(svn_fs_fs__replay_context_t *context,
+                         const svn_fs_fs__access_record_t *record,
+                         apr_pool_t *scratch_pool)
+{
+  pair_cache_key_t key;
+  representation_t *rep;
+
+  key.revision = record->revision;
+  key.second = record->item_index;
+
+  switch (record->kind)
+    {
+      case svn_fs_fs__access_noderev:
+        {
+          node_revision_t *noderev;
+          svn_fs_fs__id_part_t node_id = { 0 };
+          svn_fs_fs__id_part_t copy_id = { 0 };
+          svn_fs_fs__id_part_t rev_item;
+
+          rev_item.revision = record->revision;
+          rev_item.number = record->item_index;
+          SVN_ERR(svn_fs_fs__get_node_revision(&noderev, context->fs,
+                                               svn_fs_fs__id_rev_create(
+                                                 &node_id, &copy_id,
+                                                 &rev_item, scratch_pool),
+                                               scratch_pool, scratch_pool));
+        }
+        break;
+
+      case svn_fs_fs__access_rep_header:
+        /* Remember the representation for future delta window reads. */
+        rep = apr_hash_get(context->reps, &key, sizeof(key));
+        if (rep == NULL)
+          {
+            rep = apr_pcalloc(context->pool, sizeof(*rep));
+            rep->revision = record->revision;
+            rep->item_index = record->item_index;
+            rep->size = record->size;
+            rep->expanded_size = record->expanded_size;
+            svn_fs_fs__id_txn_reset(&rep->txn_id);
+
+            apr_hash_set(context->reps,
+                         apr_pmemdup(context->pool, &key, sizeof(key)),
+                         sizeof(key), rep);
+          }
+
+        SVN_ERR(replay_rep_header(context, rep, scratch_pool));
+        break;
+
+      case svn_fs_fs__access_delta_window:
+        {
+          svn_txdelta_window_t *window;
+          int chunk = (int)record->sub_item;
+
+          /* Continue reading from the current representation, if possible.
+           * That is what the original reader most likely did. */
+          if (   context->rs == NULL
+              || context->rs->revision != record->revision
+              || context->rs->item_index != record->item_index
+              || context->rs->chunk_index > chunk)
+            {
+              rep = apr_hash_get(context->reps, &key, sizeof(key));
+              if (rep == NULL)
+                return SVN_NO_ERROR;
+
+              SVN_ERR(replay_rep_header(context, rep, scratch_pool));
+              if (context->rs == NULL)
+                return SVN_NO_ERROR;
+            }
+
+          SVN_ERR(read_delta_window(&window, chunk, context->rs,
+                                    scratch_pool, scratch_pool));
+          context->rs->chunk_index++;
+        }
+        break;
+
+      case svn_fs_fs__access_changes:
+        {
+          svn_fs_fs__changes_context_t *changes_context;
+          apr_array_header_t *changes;
+          apr_size_t block_start;
+
+          /* Blocks can only be read in sequence.  All but the last one
+           * will most likely be cache hits. */
+          SVN_ERR(svn_fs_fs__create_changes_context(&changes_context,
+                                                    context->fs,
+                                                    record->revision,
+                                                    scratch_pool));
+          do
+            {
+              block_start = changes_context->next;
+              SVN_ERR(svn_fs_fs__get_changes(&changes, changes_context,
+                                             scratch_pool, scratch_pool));
+            }
+          while (!changes_context->eol && block_start < record->sub_item);
+
+          if (changes_context->revision_file)
+            SVN_ERR(svn_fs_fs__close_revision_file(
+                                            changes_context->revision_file));
+        }
+        break;
+
+      default:
+        SVN_ERR_MALFUNCTION();
+    }
+
+  return SVN_NO_ERROR;
+}
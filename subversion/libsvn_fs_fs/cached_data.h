@@ -81,6 +81,17 @@ svn_fs_fs__rep_chain_length(int *chain_length,
                             svn_fs_t *fs,
                             apr_pool_t *scratch_pool);
 
+/* Set *MATCHES to TRUE if a delta written with WINDOW_SIZE bytes per
+   window may use representation REP in FS as its base, i.e. if the
+   windows of both line up when reading the combined delta chain.
+   Do any allocations in SCRATCH_POOL. */
+svn_error_t *
+svn_fs_fs__rep_window_size_matches(svn_boolean_t *matches,
+                                   representation_t *rep,
+                                   apr_size_t window_size,
+                                   svn_fs_t *fs,
+                                   apr_pool_t *scratch_pool);
+
 /* Set *CONTENTS_P to be a readable svn_stream_t that receives the text
    representation REP as seen in filesystem FS.  If CACHE_FULLTEXT is
    not set, bypass fulltext cache lookup for this rep and don't put the
@@ -129,6 +140,23 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
                                  node_revision_t *target,
                                  apr_pool_t *pool);
 
+/* Set *STREAM_P to a stream returning the raw svndiff data with which
+   the contents of TARGET are stored in FS, if that is a delta against
+   SOURCE in svndiff version MAX_VERSION or lower.  Set *LEN_P to the
+   length of that data.  If SOURCE is null, the data must be a self-delta.
+   In all other cases, set *STREAM_P to NULL.
+   Allocate the stream in RESULT_POOL and use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_fs_fs__get_stored_svndiff(svn_stream_t **stream_p,
+                              svn_filesize_t *len_p,
+                              svn_fs_t *fs,
+                              node_revision_t *source,
+                              node_revision_t *target,
+                              int max_version,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
+
 /* Set *ENTRIES to an apr_array_header_t of dirent structs that contain
    the directory entries of node-revision NODEREV in filesystem FS.  The
    returned table is allocated in RESULT_POOL and entries are sorted
@@ -188,4 +216,24 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
                        apr_pool_t *result_pool,
                        apr_pool_t *scratch_pool);
 
+/* Opaque state for replaying a sequence of item accesses. */
+typedef struct svn_fs_fs__replay_context_t svn_fs_fs__replay_context_t;
+
+/* Create a context for replaying item accesses in FS, allocated in
+ * RESULT_POOL, and return it in *CONTEXT. */
+svn_error_t *
+svn_fs_fs__create_replay_context(svn_fs_fs__replay_context_t **context,
+                                 svn_fs_t *fs,
+                                 apr_pool_t *result_pool);
+
+/* Re-execute the item access described by RECORD using CONTEXT.  Delta
+ * windows can only be read from representations whose header access has
+ * been replayed before; other windows will be silently skipped.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__replay_access(svn_fs_fs__replay_context_t *context,
+                         const svn_fs_fs__access_record_t *record,
+                         apr_pool_t *scratch_pool);
+
 #endif
@@ -278,7 +278,9 @@ init_callbacks(svn_cache__t *cache,
 
 /* Sets *CACHE_P to cache instance based on provided options.
  * Creates memcache if MEMCACHE is not NULL. Creates membuffer cache if
- * MEMBUFFER is not NULL. Fallbacks to inprocess cache if MEMCACHE and
+ * MEMBUFFER is not NULL.  In that case, FILE_TIER, if not NULL, backs
+ * the membuffer cache with a persistent tier.  Only caches of immutable
+ * data may use it.  Fallbacks to inprocess cache if MEMCACHE and
  * MEMBUFFER are NULL and pages is non-zero.  Sets *CACHE_P to NULL
  * otherwise.  Use the given PRIORITY class for the new cache.  If it
  * is 0, then use the default priority class.  HAS_NAMESPACE indicates
@@ -293,6 +295,7 @@ static svn_error_t *
 create_cache(svn_cache__t **cache_p,
              svn_memcache_t *memcache,
              svn_membuffer_t *membuffer,
+             svn_cache__file_tier_t *file_tier,
              apr_int64_t pages,
              apr_int64_t items_per_page,
              svn_cache__serialize_func_t serializer,
@@ -321,6 +324,13 @@ create_cache(svn_cache__t **cache_p,
                     ? NULL
                     : warn_and_continue_on_cache_errors;
     }
+  else if (membuffer && file_tier)
+    {
+      SVN_ERR(svn_cache__create_persistent_membuffer_cache(
+                cache_p, membuffer, file_tier, serializer, deserializer,
+                klen, prefix, priority, FALSE,
+                result_pool, scratch_pool));
+    }
   else if (membuffer)
     {
       /* We assume caches with namespaces to be relatively short-lived,
@@ -357,6 +367,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                                    ":",
                                    SVN_VA_NULL);
   svn_membuffer_t *membuffer;
+  svn_cache__file_tier_t *file_tier;
   svn_boolean_t no_handler = ffd->fail_stop;
   svn_boolean_t cache_txdeltas;
   svn_boolean_t cache_fulltexts;
@@ -377,6 +388,10 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
 
   membuffer = svn_cache__get_global_membuffer_cache();
 
+  /* Immutable data may additionally be kept in the persistent cache file
+   * of this repository, if that has been enabled in fsfs.conf. */
+  file_tier = ffd->shared ? ffd->shared->file_tier : NULL;
+
   /* General rules for assigning cache priorities:
    *
    * - Data that can be reconstructed from other elements has low prio
@@ -408,6 +423,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->rev_root_id_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1, 50,
                        svn_fs_fs__serialize_id,
                        svn_fs_fs__deserialize_id,
@@ -424,6 +440,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->rev_node_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1, 8,
                        svn_fs_fs__dag_serialize,
                        svn_fs_fs__dag_deserialize,
@@ -442,6 +459,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->dir_cache),
                        NULL,
                        membuffer,
+                       file_tier,
                        1, 8,
                        svn_fs_fs__serialize_dir_entries,
                        svn_fs_fs__deserialize_dir_entries,
@@ -453,11 +471,29 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        no_handler,
                        fs->pool, pool));
 
+  /* Only paged directories have a non-trivial index.  Those are large
+     but their index is only about 1/256th of the directory size. */
+  SVN_ERR(create_cache(&(ffd->dir_index_cache),
+                       NULL,
+                       membuffer,
+                       NULL,
+                       1, 8,
+                       svn_fs_fs__serialize_dir_index,
+                       svn_fs_fs__deserialize_dir_index,
+                       sizeof(pair_cache_key_t),
+                       apr_pstrcat(pool, prefix, "DIRIDX", SVN_VA_NULL),
+                       SVN_CACHE__MEMBUFFER_HIGH_PRIORITY,
+                       has_namespace,
+                       fs,
+                       no_handler,
+                       fs->pool, pool));
+
   /* 8 kBytes per entry (1000 revs / shared, one file offset per rev).
      Covering about 8 pack files gives us an "o.k." hit rate. */
   SVN_ERR(create_cache(&(ffd->packed_offset_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        8, 1,
                        svn_fs_fs__serialize_manifest,
                        svn_fs_fs__deserialize_manifest,
@@ -474,6 +510,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->node_revision_cache),
                        NULL,
                        membuffer,
+                       file_tier,
                        2, 16, /* ~500 byte / entry; 32 entries total */
                        svn_fs_fs__serialize_node_revision,
                        svn_fs_fs__deserialize_node_revision,
@@ -489,6 +526,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->rep_header_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1, 200, /* ~40 bytes / entry; 200 entries total */
                        svn_fs_fs__serialize_rep_header,
                        svn_fs_fs__deserialize_rep_header,
@@ -504,6 +542,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->changes_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        1, 8, /* 1k / entry; 8 entries total, rarely used */
                        svn_fs_fs__serialize_changes,
                        svn_fs_fs__deserialize_changes,
@@ -519,6 +558,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->revprop_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        8, 20, /* ~400 bytes / entry, capa for ~2 packs */
                        svn_fs_fs__serialize_revprops,
                        svn_fs_fs__deserialize_revprops,
@@ -536,6 +576,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->fulltext_cache),
                            ffd->memcache,
                            membuffer,
+                           NULL,
                            0, 0, /* Do not use the inprocess cache */
                            /* Values are svn_stringbuf_t */
                            NULL, NULL,
@@ -550,6 +591,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->mergeinfo_cache),
                            NULL,
                            membuffer,
+                           NULL,
                            0, 0, /* Do not use the inprocess cache */
                            svn_fs_fs__serialize_mergeinfo,
                            svn_fs_fs__deserialize_mergeinfo,
@@ -565,6 +607,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->mergeinfo_existence_cache),
                            NULL,
                            membuffer,
+                           NULL,
                            0, 0, /* Do not use the inprocess cache */
                            /* Values are svn_stringbuf_t */
                            NULL, NULL,
@@ -590,6 +633,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->properties_cache),
                            NULL,
                            membuffer,
+                           NULL,
                            0, 0, /* Do not use the inprocess cache */
                            svn_fs_fs__serialize_properties,
                            svn_fs_fs__deserialize_properties,
@@ -613,6 +657,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->raw_window_cache),
                            NULL,
                            membuffer,
+                           NULL,
                            0, 0, /* Do not use the inprocess cache */
                            svn_fs_fs__serialize_raw_window,
                            svn_fs_fs__deserialize_raw_window,
@@ -628,6 +673,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->txdelta_window_cache),
                            NULL,
                            membuffer,
+                           file_tier,
                            0, 0, /* Do not use the inprocess cache */
                            svn_fs_fs__serialize_txdelta_window,
                            svn_fs_fs__deserialize_txdelta_window,
@@ -643,6 +689,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
       SVN_ERR(create_cache(&(ffd->combined_window_cache),
                            NULL,
                            membuffer,
+                           NULL,
                            0, 0, /* Do not use the inprocess cache */
                            /* Values are svn_stringbuf_t */
                            NULL, NULL,
@@ -664,6 +711,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->l2p_header_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        8, 16, /* entry size varies but we must cover a
                                  reasonable number of rev / pack files
                                  to allow for delta chains to be walked
@@ -681,6 +729,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->l2p_page_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        8, 16, /* entry size varies but we must cover a
                                  reasonable number of rev / pack files
                                  to allow for delta chains to be walked
@@ -698,6 +747,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->p2l_header_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        4, 1, /* Large entries. Rarely used. */
                        svn_fs_fs__serialize_p2l_header,
                        svn_fs_fs__deserialize_p2l_header,
@@ -712,6 +762,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&(ffd->p2l_page_cache),
                        NULL,
                        membuffer,
+                       NULL,
                        4, 1, /* Variably sized entries. Rarely used. */
                        svn_fs_fs__serialize_p2l_page,
                        svn_fs_fs__deserialize_p2l_page,
@@ -871,6 +922,7 @@ svn_fs_fs__initialize_txn_caches(svn_fs_t *fs,
   SVN_ERR(create_cache(&ffd->txn_dir_cache,
                        NULL,
                        svn_cache__get_global_membuffer_cache(),
+                       NULL,
                        1024, 8,
                        svn_fs_fs__serialize_txndir_entries,
                        svn_fs_fs__deserialize_dir_entries,
@@ -439,6 +439,23 @@ svn_fs_fs__dag_get_file_delta_stream(svn_txdelta_stream_t **stream_p,
                                      dag_node_t *target,
                                      apr_pool_t *pool);
 
+/* Set *SVNDIFF_P to a stream of the svndiff data stored for TARGET as a
+   delta against SOURCE and *LEN_P to its length, if the svndiff version
+   is not larger than MAX_VERSION.  Otherwise, set *SVNDIFF_P to NULL.
+   If SOURCE is null, the empty string will be used as the delta base.
+
+   Allocate the stream in RESULT_POOL and use SCRATCH_POOL for temporary
+   allocations.
+ */
+svn_error_t *
+svn_fs_fs__dag_get_stored_svndiff(svn_stream_t **svndiff_p,
+                                  svn_filesize_t *len_p,
+                                  dag_node_t *source,
+                                  dag_node_t *target,
+                                  int max_version,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool);
+
 /* Return a generic writable stream in *CONTENTS with which to set the
    contents of FILE.  Allocate the stream in POOL.
 
@@ -32,6 +32,8 @@
 #include "svn_delta.h"
 #include "svn_version.h"
 #include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "access-trace.h"
 #include "fs.h"
 #include "fs_fs.h"
 #include "tree.h"
@@ -48,6 +50,7 @@
 #include "svn_private_config.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fs_fs_private.h"
+#include "private/svn_io_private.h"
 
 #include "../libsvn_fs/fs-loader.h"
 
@@ -124,12 +127,46 @@ fs_serialized_init(svn_fs_t *fs, apr_pool_t *common_pool, apr_pool_t *pool)
          transaction list and free transaction pointer. */
       SVN_ERR(svn_mutex__init(&ffsd->txn_list_lock, TRUE, common_pool));
 
+      /* The rep-cache filter is shared by all threads. */
+      SVN_ERR(svn_mutex__init(&ffsd->rep_cache_filter_lock, TRUE,
+                              common_pool));
+
       key = apr_pstrdup(common_pool, key);
       status = apr_pool_userdata_set(ffsd, key, NULL, common_pool);
       if (status)
         return svn_error_wrap_apr(status, _("Can't store FSFS shared data"));
     }
 
+  /* The persistent cache is shared by all instances of this repository
+     within this process. */
+  if (ffd->persistent_cache_size && !ffsd->file_tier)
+    {
+      svn_revnum_t youngest;
+      svn_error_t *err;
+
+      SVN_ERR(svn_fs_fs__youngest_rev(&youngest, fs, pool));
+      err = svn_cache__file_tier_open(&ffsd->file_tier,
+                                      svn_dirent_join(fs->path,
+                                                      PATH_PERSISTENT_CACHE,
+                                                      pool),
+                                      ffd->persistent_cache_size,
+                                      fs->uuid, ffd->instance_id, youngest,
+                                      common_pool, pool);
+
+      /* Caching is optional.  Users without write access to the
+         repository are expected to fail here and don't need to be told. */
+      if (err && !ffd->fail_stop)
+        {
+          if (!APR_STATUS_IS_EACCES(err->apr_err))
+            (fs->warning)(fs->warning_baton, err);
+
+          svn_error_clear(err);
+          ffsd->file_tier = NULL;
+        }
+      else
+        SVN_ERR(err);
+    }
+
   ffd->shared = ffsd;
 
   return SVN_NO_ERROR;
@@ -308,6 +345,29 @@ fs_ioctl(svn_fs_t *fs, svn_fs_ioctl_code_t ctlcode,
                                            scratch_pool));
           *output_p = output;
         }
+      else if (ctlcode.code == SVN_FS_FS__IOCTL_BUILD_REP_CACHE.code)
+        {
+          svn_fs_fs__ioctl_build_rep_cache_input_t *input = input_void;
+
+          SVN_ERR(svn_fs_fs__build_rep_cache(fs, input->start_rev,
+                                             input->end_rev,
+                                             input->progress_func,
+                                             input->progress_baton,
+                                             cancel_func, cancel_baton,
+                                             scratch_pool));
+          *output_p = NULL;
+        }
+      else if (ctlcode.code == SVN_FS_FS__IOCTL_REPLAY_ACCESS_TRACE.code)
+        {
+          svn_fs_fs__ioctl_replay_access_trace_input_t *input = input_void;
+
+          SVN_ERR(svn_fs_fs__replay_access_trace(fs, input->trace_path,
+                                                 input->callback_func,
+                                                 input->callback_baton,
+                                                 cancel_func, cancel_baton,
+                                                 scratch_pool));
+          *output_p = NULL;
+        }
       else
         return svn_error_create(SVN_ERR_FS_UNRECOGNIZED_IOCTL_CODE, NULL, NULL);
     }
@@ -323,6 +383,7 @@ static fs_vtable_t fs_vtable = {
   fs_refresh_revprops,
   svn_fs_fs__revision_prop,
   svn_fs_fs__get_revision_proplist,
+  svn_fs_fs__get_revision_proplists,
   svn_fs_fs__change_rev_prop,
   fs_set_uuid,
   svn_fs_fs__revision_root,
@@ -354,8 +415,10 @@ initialize_fs_struct(svn_fs_t *fs)
 {
   fs_fs_data_t *ffd = apr_pcalloc(fs->pool, sizeof(*ffd));
   ffd->use_log_addressing = FALSE;
+  ffd->paged_directories = FALSE;
   ffd->revprop_prefix = 0;
   ffd->flush_to_disk = TRUE;
+  ffd->jobs = 1;
 
   fs->vtable = &fs_vtable;
   fs->fsap_data = ffd;
@@ -388,9 +451,10 @@ fs_create(svn_fs_t *fs,
 
   SVN_ERR(svn_fs_fs__create(fs, path, scratch_pool));
 
-  SVN_ERR(svn_fs_fs__initialize_caches(fs, scratch_pool));
+  /* The caches depend on the shared data. */
   SVN_MUTEX__WITH_LOCK(common_pool_lock,
                        fs_serialized_init(fs, common_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__initialize_caches(fs, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -419,9 +483,10 @@ fs_open(svn_fs_t *fs,
 
   SVN_ERR(svn_fs_fs__open(fs, path, subpool));
 
-  SVN_ERR(svn_fs_fs__initialize_caches(fs, subpool));
+  /* The caches depend on the shared data. */
   SVN_MUTEX__WITH_LOCK(common_pool_lock,
                        fs_serialized_init(fs, common_pool, subpool));
+  SVN_ERR(svn_fs_fs__initialize_caches(fs, subpool));
 
   svn_pool_destroy(subpool);
 
@@ -429,6 +494,43 @@ fs_open(svn_fs_t *fs,
 }
 
 
+svn_error_t *
+svn_fs_fs__open_clone(svn_fs_t **clone_p,
+                      svn_fs_t *fs,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_data_t *clone_ffd;
+
+  /* Same configuration, warning handler etc. but nothing that has been
+     derived from FS's own state or pool. */
+  svn_fs_t *clone = apr_pmemdup(result_pool, fs, sizeof(*fs));
+  clone->pool = result_pool;
+  clone->path = NULL;
+  clone->access_ctx = NULL;
+  clone->vtable = NULL;
+  clone->fsap_data = NULL;
+  clone->uuid = NULL;
+
+  SVN_ERR(initialize_fs_struct(clone));
+  SVN_ERR(svn_fs_fs__open(clone, fs->path, scratch_pool));
+
+  /* It is the same repository, thus we may share the same process-wide
+     data.  No need to go through the common pool lock again.  The caches
+     depend on the shared data. */
+  clone_ffd = clone->fsap_data;
+  clone_ffd->shared = ffd->shared;
+  clone_ffd->svn_fs_open_ = ffd->svn_fs_open_;
+
+  SVN_ERR(svn_fs_fs__initialize_caches(clone, scratch_pool));
+
+  *clone_p = clone;
+
+  return SVN_NO_ERROR;
+}
+
+
 
 /* This implements the fs_library_vtable_t.open_for_recovery() API. */
 static svn_error_t *
@@ -689,6 +791,8 @@ svn_fs_fs__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(fs_version(), checklist, svn_ver_equal));
 
+  SVN_ERR(svn_io__batch_fsync_init(common_pool));
+
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
 }
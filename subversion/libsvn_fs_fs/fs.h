@@ -78,6 +78,8 @@ extern "C" {
                                                     to-log index */
 /* If you change this, look at tests/svn_test_fs.c(maybe_install_fsfs_conf) */
 #define PATH_CONFIG           "fsfs.conf"        /* Configuration */
+#define PATH_PERSISTENT_CACHE "persistent-cache" /* Cache file kept across
+                                                    process restarts */
 
 /* Names of special files and file extensions for transactions */
 #define PATH_CHANGES       "changes"       /* Records changes made so far */
@@ -100,6 +102,7 @@ extern "C" {
 /* Names of sections and options in fsfs.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_PERSISTENT_CACHE_SIZE "persistent-cache-size"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
@@ -115,10 +118,12 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_MMAP_PACK_FILES    "mmap-pack-files"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
 #define CONFIG_OPTION_COMPRESSION        "compression"
+#define CONFIG_OPTION_DELTA_WINDOW_SIZE  "delta-window-size"
 
 /* The format number of this filesystem.
    This is independent of the repository format number, and
@@ -127,7 +132,7 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -188,6 +193,14 @@ extern "C" {
 /* The minimum format number that supports svndiff version 2. */
 #define SVN_FS_FS__MIN_SVNDIFF2_FORMAT 8
 
+/* The minimum format number that supports svndiff version 3 and, with
+   it, delta windows larger than the default 100kB. */
+#define SVN_FS_FS__MIN_SVNDIFF3_FORMAT 9
+
+/* The minimum format number that supports the "directories" format option,
+   i.e. paged representations for large directories. */
+#define SVN_FS_FS__MIN_PAGED_DIRS_FORMAT 9
+
 /* The minimum format number that supports the special notation ("-")
    for optional values that are not present in the representation strings,
    such as SHA1 or the uniquifier.  For example:
@@ -278,6 +291,16 @@ typedef struct fs_fs_shared_data_t
   /* The common pool, under which this object is allocated, subpools
      of which are used to allocate the transaction objects. */
   apr_pool_t *common_pool;
+
+  /* Persistent cache level shared by all caches of this repository
+     that hold immutable data.  NULL if disabled or not available. */
+  svn_cache__file_tier_t *file_tier;
+
+  /* Bloom filter over the keys in the rep-cache database.  Created on
+     demand.  See rep-cache.c for details.  All access is synchronised
+     under REP_CACHE_FILTER_LOCK. */
+  struct rep_cache_filter_t *rep_cache_filter;
+  svn_mutex__t *rep_cache_filter_lock;
 } fs_fs_shared_data_t;
 
 /* Data structure for the 1st level DAG node cache. */
@@ -333,9 +356,18 @@ typedef struct fs_fs_data_t
      physical addressing. */
   svn_boolean_t use_log_addressing;
 
+  /* If set, large directories get written as paged representations that
+     allow for looking up individual entries without reading the whole
+     directory.  Readers support both layouts regardless of this flag. */
+  svn_boolean_t paged_directories;
+
   /* Rev / pack file read granularity in bytes. */
   apr_int64_t block_size;
 
+  /* If set, read pack files through memory mappings instead of buffered
+   * file access. */
+  svn_boolean_t mmap_pack_files;
+
   /* Capacity in entries of log-to-phys index pages */
   apr_int64_t l2p_page_size;
 
@@ -360,6 +392,9 @@ typedef struct fs_fs_data_t
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
 
+  /* Size of the persistent cache file in bytes.  0 if disabled. */
+  apr_int64_t persistent_cache_size;
+
   /* A cache of revision root IDs, mapping from (svn_revnum_t *) to
      (svn_fs_id_t *).  (Not threadsafe.) */
   svn_cache__t *rev_root_id_cache;
@@ -376,6 +411,10 @@ typedef struct fs_fs_data_t
      names to (svn_fs_dirent_t *). */
   svn_cache__t *dir_cache;
 
+  /* A cache of the page indexes of immutable directory representations;
+     maps from (revision, item index) to svn_fs_fs__dir_index_t *. */
+  svn_cache__t *dir_index_cache;
+
   /* Fulltext cache; currently only used with memcached.  Maps from
      rep key (revision/offset) to svn_stringbuf_t. */
   svn_cache__t *fulltext_cache;
@@ -465,6 +504,14 @@ typedef struct fs_fs_data_t
   /* Thread-safe boolean */
   svn_atomic_t rep_cache_db_opened;
 
+  /* Rep-cache entries deferred by commits.  NULL until the first one.
+     See rep-cache.c for details. */
+  struct rep_cache_pending_t *rep_cache_pending;
+
+  /* Number of revisions for which to defer rep-cache entries, see
+     SVN_FS_CONFIG_FSFS_REP_CACHE_BATCH.  Values < 2 disable deferral. */
+  int rep_cache_batch;
+
   /* The oldest revision not in a pack file.  It also applies to revprops
    * if revprop packing has been enabled by the FSFS format version. */
   svn_revnum_t min_unpacked_rev;
@@ -499,6 +546,10 @@ typedef struct fs_fs_data_t
   /* Compression level (currently, only used with compression_type_zlib). */
   int delta_compression_level;
 
+  /* Maximum size of the source and target views of the delta windows
+     in new representations.  Sizes beyond the default require svndiff3. */
+  apr_size_t delta_window_size;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
@@ -514,6 +565,21 @@ typedef struct fs_fs_data_t
   /* Ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
 
+  /* Maximum number of worker threads to use for repository-wide
+     operations.  Values below 2 mean "single-threaded". */
+  int jobs;
+
+  /* Trace file to which we append a record for every item access.
+     NULL if tracing has been disabled. */
+  apr_file_t *access_trace_file;
+
+  /* If not NULL, gets called with ACCESS_TRACE_BATON for every item access
+     in addition to writing it to ACCESS_TRACE_FILE.  Used when replaying
+     traces. */
+  void (*access_trace_func)(void *baton,
+                            const svn_fs_fs__access_record_t *record);
+  void *access_trace_baton;
+
   /* Pointer to svn_fs_open. */
   svn_error_t *(*svn_fs_open_)(svn_fs_t **, const char *, apr_hash_t *,
                                apr_pool_t *, apr_pool_t *);
@@ -697,6 +763,33 @@ typedef struct svn_fs_fs__dir_data_t
   svn_filesize_t txn_filesize;
 } svn_fs_fs__dir_data_t;
 
+/* A single page of a paged directory representation. */
+typedef struct svn_fs_fs__dir_page_t
+{
+  /* Name of the first entry in this page. */
+  const char *first_name;
+
+  /* Start of the page within the representation contents. */
+  apr_size_t offset;
+
+  /* Length of the page in bytes. */
+  apr_size_t size;
+} svn_fs_fs__dir_page_t;
+
+/* Page index of a directory representation.  PAGE_COUNT is 0 for
+   directories not stored as paged representations. */
+typedef struct svn_fs_fs__dir_index_t
+{
+  /* Total number of entries in the directory. */
+  apr_int64_t entry_count;
+
+  /* Number of elements in PAGES. */
+  int page_count;
+
+  /* All pages, ordered by their FIRST_NAME. */
+  svn_fs_fs__dir_page_t *pages;
+} svn_fs_fs__dir_index_t;
+
 
 #ifdef __cplusplus
 }
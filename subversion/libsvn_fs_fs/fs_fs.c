@@ -34,6 +34,7 @@
 #include "svn_sorts.h"
 #include "svn_version.h"
 
+#include "access-trace.h"
 #include "cached_data.h"
 #include "id.h"
 #include "index.h"
@@ -43,6 +44,7 @@
 #include "tree.h"
 #include "util.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_io_private.h"
 #include "private/svn_string_private.h"
@@ -457,19 +459,22 @@ check_format(int format)
 }
 
 /* Read the format number and maximum number of files per directory
-   from PATH and return them in *PFORMAT, *MAX_FILES_PER_DIR and
-   USE_LOG_ADDRESSIONG respectively.
+   from PATH and return them in *PFORMAT, *MAX_FILES_PER_DIR,
+   USE_LOG_ADDRESSIONG and *PAGED_DIRECTORIES respectively.
 
    *MAX_FILES_PER_DIR is obtained from the 'layout' format option, and
    will be set to zero if a linear scheme should be used.
    *USE_LOG_ADDRESSIONG is obtained from the 'addressing' format option,
    and will be set to FALSE for physical addressing.
+   *PAGED_DIRECTORIES is obtained from the 'directories' format option,
+   and will be set to FALSE if that option is absent.
 
    Use POOL for temporary allocation. */
 static svn_error_t *
 read_format(int *pformat,
             int *max_files_per_dir,
             svn_boolean_t *use_log_addressing,
+            svn_boolean_t *paged_directories,
             const char *path,
             apr_pool_t *pool)
 {
@@ -493,6 +498,7 @@ read_format(int *pformat,
       *pformat = 1;
       *max_files_per_dir = 0;
       *use_log_addressing = FALSE;
+      *paged_directories = FALSE;
 
       return SVN_NO_ERROR;
     }
@@ -518,6 +524,7 @@ read_format(int *pformat,
   /* Set the default values for anything that can be set via an option. */
   *max_files_per_dir = 0;
   *use_log_addressing = FALSE;
+  *paged_directories = FALSE;
 
   /* Read any options. */
   while (!eos)
@@ -560,6 +567,22 @@ read_format(int *pformat,
             }
         }
 
+      if (*pformat >= SVN_FS_FS__MIN_PAGED_DIRS_FORMAT &&
+          strncmp(buf->data, "directories ", 12) == 0)
+        {
+          if (strcmp(buf->data + 12, "flat") == 0)
+            {
+              *paged_directories = FALSE;
+              continue;
+            }
+
+          if (strcmp(buf->data + 12, "paged") == 0)
+            {
+              *paged_directories = TRUE;
+              continue;
+            }
+        }
+
       return svn_error_createf(SVN_ERR_BAD_VERSION_FILE_FORMAT, NULL,
          _("'%s' contains invalid filesystem format option '%s'"),
          svn_dirent_local_style(path, pool), buf->data);
@@ -577,9 +600,10 @@ read_format(int *pformat,
   return SVN_NO_ERROR;
 }
 
-/* Write the format number, maximum number of files per directory and
-   the addressing scheme to a new format file in PATH, possibly expecting
-   to overwrite a previously existing file.
+/* Write the format number, maximum number of files per directory, the
+   addressing scheme and the directory representation to a new format
+   file in PATH, possibly expecting to overwrite a previously existing
+   file.
 
    Use POOL for temporary allocation. */
 svn_error_t *
@@ -613,6 +637,12 @@ svn_fs_fs__write_format(svn_fs_t *fs,
         svn_stringbuf_appendcstr(sb, "addressing physical\n");
     }
 
+  /* Only mention the option when it has been enabled such that formats
+     that don't use it remain readable by older code of the same format. */
+  if (   ffd->format >= SVN_FS_FS__MIN_PAGED_DIRS_FORMAT
+      && ffd->paged_directories)
+    svn_stringbuf_appendcstr(sb, "directories paged\n");
+
   /* svn_io_write_version_file() does a load of magic to allow it to
      replace version files that already exist.  We only need to do
      that when we're allowed to overwrite an existing file. */
@@ -848,6 +878,11 @@ read_config(fs_fs_data_t *ffd,
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
     }
 
+  SVN_ERR(svn_config_get_bool(config, &ffd->mmap_pack_files,
+                              CONFIG_SECTION_IO,
+                              CONFIG_OPTION_MMAP_PACK_FILES,
+                              FALSE));
+
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
       SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
@@ -925,6 +960,37 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
     }
 
+  /* Initialize the delta window size.  Larger windows require svndiff3,
+   * which in turn implies lz4 compression. */
+  ffd->delta_window_size = svn_txdelta__max_window_size(2);
+  if (ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    {
+      apr_int64_t window_size;
+      apr_int64_t min_size = svn_txdelta__max_window_size(2) / 0x400;
+      apr_int64_t max_size = svn_txdelta__max_window_size(3) / 0x400;
+
+      /* The window size is given in kBytes. */
+      SVN_ERR(svn_config_get_int64(config, &window_size,
+                                   CONFIG_SECTION_DELTIFICATION,
+                                   CONFIG_OPTION_DELTA_WINDOW_SIZE,
+                                   min_size));
+      if (window_size < min_size || window_size > max_size)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("'%s' must be between %d and %d"),
+                                 CONFIG_OPTION_DELTA_WINDOW_SIZE,
+                                 (int)min_size, (int)max_size);
+
+      if (   window_size > min_size
+          && ffd->delta_compression_type != compression_type_lz4)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("A '%s' larger than %d requires "
+                                   "compression type 'lz4'"),
+                                 CONFIG_OPTION_DELTA_WINDOW_SIZE,
+                                 (int)min_size);
+
+      ffd->delta_window_size = (apr_size_t)window_size * 0x400;
+    }
+
 #ifdef SVN_DEBUG
   SVN_ERR(svn_config_get_bool(config, &ffd->verify_before_commit,
                               CONFIG_SECTION_DEBUG,
@@ -945,6 +1011,19 @@ read_config(fs_fs_data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  /* The persistent cache size is given in MBytes. */
+  SVN_ERR(svn_config_get_int64(config, &ffd->persistent_cache_size,
+                               CONFIG_SECTION_CACHES,
+                               CONFIG_OPTION_PERSISTENT_CACHE_SIZE,
+                               0));
+  if (   ffd->persistent_cache_size < 0
+      || ffd->persistent_cache_size > 0x100000)
+    return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                             _("'%s' must be between 0 and %d"),
+                             CONFIG_OPTION_PERSISTENT_CACHE_SIZE,
+                             0x100000);
+  ffd->persistent_cache_size *= 0x100000;
+
   return SVN_NO_ERROR;
 }
 
@@ -977,6 +1056,14 @@ write_config(svn_fs_t *fs,
 "### configured (and ignoring it with file:// access).  To make"             NL
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
+"###"                                                                        NL
+"### Some of the cached data, e.g. node revisions, directories and deltas,"  NL
+"### can also be kept in a memory-mapped file inside the 'db' directory."    NL
+"### That data survives server restarts, so a restarted server does not"     NL
+"### need to read everything from the revision files again.  This option"    NL
+"### sets the size of that file in MB.  0, the default, disables it."        NL
+"### Users without write access to the repository will not use the file."    NL
+"# " CONFIG_OPTION_PERSISTENT_CACHE_SIZE " = 0"                              NL
 ""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
@@ -1079,6 +1166,18 @@ write_config(svn_fs_t *fs,
 "### still be used (and it will result in zlib compression with the"         NL
 "### corresponding compression level)."                                      NL
 "###   " CONFIG_OPTION_COMPRESSION_LEVEL " = 0 ... 9 (default is 5)"         NL
+"###"                                                                        NL
+"### The delta algorithm compares the data in windows of limited size.  With" NL
+"### the default size of 100 kBytes, data that got inserted into or removed"  NL
+"### from large files, e.g. archives or office documents, shifts most of the" NL
+"### contents beyond the reach of the delta algorithm.  Larger windows allow" NL
+"### for far smaller deltas in such cases at the expense of memory usage."   NL
+"### This parameter sets the window size in kBytes for future revisions."    NL
+"### Values larger than 100 require the 'lz4' compression and the resulting" NL
+"### data will be stored in svndiff3 format.  This option is supported,"     NL
+"### starting from format 9 repositories, available in Subversion 1.13 and"  NL
+"### higher.  Valid values range from 100 to 8192; the default is 100."      NL
+"# " CONFIG_OPTION_DELTA_WINDOW_SIZE " = 100"                                NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -1147,6 +1246,16 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### Pack files may be memory-mapped instead of being read through file"     NL
+"### buffers.  Index pages, representation headers and plain (undeltified)"  NL
+"### data will then be accessed directly in memory, saving system calls and" NL
+"### copies.  This is most useful for read-heavy servers on 64 bit systems"  NL
+"### with enough RAM to keep the pack files in the OS file cache.  It also"  NL
+"### applies to repositories in older formats.  Pack files that cannot be"   NL
+"### mapped will be read through file buffers as usual."                     NL
+"### mmap-pack-files is disabled by default and can be changed at any time." NL
+"# " CONFIG_OPTION_MMAP_PACK_FILES " = false"                                NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
@@ -1174,6 +1283,43 @@ read_global_config(svn_fs_t *fs)
                                            SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                                            FALSE);
 
+  ffd->jobs = 1;
+  if (fs->config)
+    {
+      const char *jobs_str = svn_hash_gets(fs->config,
+                                           SVN_FS_CONFIG_FSFS_JOBS);
+      if (jobs_str)
+        {
+          apr_int64_t val;
+          SVN_ERR(svn_cstring_strtoi64(&val, jobs_str, 0, APR_INT32_MAX,
+                                       10));
+          ffd->jobs = (int) val;
+        }
+    }
+
+  ffd->rep_cache_batch = 1;
+  if (fs->config)
+    {
+      const char *batch_str = svn_hash_gets(fs->config,
+                                            SVN_FS_CONFIG_FSFS_REP_CACHE_BATCH);
+      if (batch_str)
+        {
+          apr_int64_t val;
+          SVN_ERR(svn_cstring_strtoi64(&val, batch_str, 0, APR_INT32_MAX,
+                                       10));
+          ffd->rep_cache_batch = (int) val;
+        }
+    }
+
+  /* Record item accesses, if requested. */
+  if (fs->config)
+    {
+      const char *trace_path = svn_hash_gets(fs->config,
+                                             SVN_FS_CONFIG_FSFS_ACCESS_TRACE);
+      if (trace_path)
+        SVN_ERR(svn_fs_fs__open_access_trace(fs, trace_path, fs->pool));
+    }
+
   /* Ignore the user-specified larger block size if we don't use block-read.
      Defaulting to 4k gives us the same access granularity in format 7 as in
      older formats. */
@@ -1226,15 +1372,18 @@ svn_fs_fs__read_format_file(svn_fs_t *fs, apr_pool_t *scratch_pool)
   fs_fs_data_t *ffd = fs->fsap_data;
   int format, max_files_per_dir;
   svn_boolean_t use_log_addressing;
+  svn_boolean_t paged_directories;
 
   /* Read info from format file. */
   SVN_ERR(read_format(&format, &max_files_per_dir, &use_log_addressing,
-                      path_format(fs, scratch_pool), scratch_pool));
+                      &paged_directories, path_format(fs, scratch_pool),
+                      scratch_pool));
 
   /* Now that we've got *all* info, store / update values in FFD. */
   ffd->format = format;
   ffd->max_files_per_dir = max_files_per_dir;
   ffd->use_log_addressing = use_log_addressing;
+  ffd->paged_directories = paged_directories;
 
   return SVN_NO_ERROR;
 }
@@ -1300,13 +1449,14 @@ upgrade_body(void *baton, apr_pool_t *pool)
   fs_fs_data_t *ffd = fs->fsap_data;
   int format, max_files_per_dir;
   svn_boolean_t use_log_addressing;
+  svn_boolean_t paged_directories;
   const char *format_path = path_format(fs, pool);
   svn_node_kind_t kind;
   svn_boolean_t needs_revprop_shard_cleanup = FALSE;
 
   /* Read the FS format number and max-files-per-dir setting. */
   SVN_ERR(read_format(&format, &max_files_per_dir, &use_log_addressing,
-                      format_path, pool));
+                      &paged_directories, format_path, pool));
 
   /* If the config file does not exist, create one. */
   SVN_ERR(svn_io_check_path(svn_dirent_join(fs->path, PATH_CONFIG, pool),
@@ -1382,6 +1532,7 @@ upgrade_body(void *baton, apr_pool_t *pool)
   ffd->format = SVN_FS_FS__FORMAT_NUMBER;
   ffd->max_files_per_dir = max_files_per_dir;
   ffd->use_log_addressing = use_log_addressing;
+  ffd->paged_directories = paged_directories;
 
   /* Always add / bump the instance ID such that no form of caching
      accidentally uses outdated information.  Keep the UUID. */
@@ -1913,6 +2064,7 @@ svn_fs_fs__create(svn_fs_t *fs,
                   const char *path,
                   apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   int format = SVN_FS_FS__FORMAT_NUMBER;
   int shard_size = SVN_FS_FS_DEFAULT_MAX_FILES_PER_DIR;
   svn_boolean_t log_addressing;
@@ -1951,6 +2103,11 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 9: format = 7;
                   break;
 
+          case 10:
+          case 11:
+          case 12: format = 8;
+                  break;
+
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
@@ -1973,6 +2130,12 @@ svn_fs_fs__create(svn_fs_t *fs,
   SVN_ERR(svn_fs_fs__create_file_tree(fs, path, format, shard_size,
                                       log_addressing, pool));
 
+  /* Paged directory representations are opt-in. */
+  if (format >= SVN_FS_FS__MIN_PAGED_DIRS_FORMAT)
+    ffd->paged_directories
+      = svn_hash__get_bool(fs->config, SVN_FS_CONFIG_FSFS_PAGED_DIRECTORIES,
+                           FALSE);
+
   /* This filesystem is ready.  Stamp it with a format number. */
   SVN_ERR(svn_fs_fs__write_format(fs, FALSE, pool));
 
@@ -2322,8 +2485,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 13;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
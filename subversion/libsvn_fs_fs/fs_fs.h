@@ -48,6 +48,16 @@ svn_error_t *svn_fs_fs__initialize_shared_data(svn_fs_t *fs,
                                                apr_pool_t *pool,
                                                apr_pool_t *common_pool);
 
+/* Open another instance of the already open filesystem FS and return it
+   in *CLONE_P.  The new instance uses the same configuration and shared
+   data as FS but has its own caches and file handles.  This allows it to
+   be used in a different thread than FS.  Allocate *CLONE_P in
+   RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *svn_fs_fs__open_clone(svn_fs_t **clone_p,
+                                   svn_fs_t *fs,
+                                   apr_pool_t *result_pool,
+                                   apr_pool_t *scratch_pool);
+
 /* Upgrade the fsfs filesystem FS.  Indicate progress via the optional
  * NOTIFY_FUNC callback using NOTIFY_BATON.  The optional CANCEL_FUNC
  * will periodically be called with CANCEL_BATON to allow for preemption.
@@ -32,6 +32,9 @@
 
 #include "../libsvn_fs/fs-loader.h"
 
+#include "private/svn_io_private.h"
+#include "private/svn_task.h"
+
 #include "svn_private_config.h"
 
 /* Like svn_io_dir_file_copy(), but doesn't copy files that exist at
@@ -72,8 +75,11 @@ hotcopy_io_dir_file_copy(svn_boolean_t *skipped_p,
   if (skipped_p)
     *skipped_p = FALSE;
 
-  return svn_error_trace(svn_io_dir_file_copy(src_path, dst_path, file,
-                                              scratch_pool));
+  /* Most of what we copy here is immutable revision data, so letting
+   * the kernel share its storage with the source is fine. */
+  src_target = svn_dirent_join(src_path, file, scratch_pool);
+  return svn_error_trace(svn_io__copy_file_in_kernel(src_target, dst_target,
+                                                     TRUE, scratch_pool));
 }
 
 /* Set *NAME_P to the UTF-8 representation of directory entry NAME.
@@ -237,8 +243,35 @@ hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
   return SVN_NO_ERROR;
 }
 
+/* Create the shard folder in DST_SUBDIR that will contain the un-packed
+ * revision or revprop file for revision REV.  Assume a sharding layout
+ * based on MAX_FILES_PER_DIR.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+hotcopy_make_shard_dir(const char *dst_subdir,
+                       svn_revnum_t rev,
+                       int max_files_per_dir,
+                       apr_pool_t *scratch_pool)
+{
+  const char *dst_subdir_shard;
+
+  if (!max_files_per_dir)
+    return SVN_NO_ERROR;
+
+  dst_subdir_shard = svn_dirent_join(dst_subdir,
+                                     apr_psprintf(scratch_pool, "%ld",
+                                                  rev / max_files_per_dir),
+                                     scratch_pool);
+  SVN_ERR(svn_io_make_dir_recursively(dst_subdir_shard, scratch_pool));
+  SVN_ERR(svn_io_copy_perms(dst_subdir, dst_subdir_shard, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy an un-packed revision or revprop file for revision REV from SRC_SUBDIR
  * to DST_SUBDIR. Assume a sharding layout based on MAX_FILES_PER_DIR.
+ * The shard folder must already exist in DST_SUBDIR, see
+ * hotcopy_make_shard_dir().
  * Set *SKIPPED_P to FALSE only if the file was copied, do not change the
  * value in *SKIPPED_P otherwise. SKIPPED_P may be NULL if not required.
  * Use SCRATCH_POOL for temporary allocations. */
@@ -259,13 +292,6 @@ hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
                                        rev / max_files_per_dir);
       src_subdir_shard = svn_dirent_join(src_subdir, shard, scratch_pool);
       dst_subdir_shard = svn_dirent_join(dst_subdir, shard, scratch_pool);
-
-      if (rev % max_files_per_dir == 0)
-        {
-          SVN_ERR(svn_io_make_dir_recursively(dst_subdir_shard, scratch_pool));
-          SVN_ERR(svn_io_copy_perms(dst_subdir, dst_subdir_shard,
-                                    scratch_pool));
-        }
     }
 
   SVN_ERR(hotcopy_io_dir_file_copy(skipped_p,
@@ -279,15 +305,14 @@ hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
 
 /* Copy a packed shard containing revision REV, and which contains
  * MAX_FILES_PER_DIR revisions, from SRC_FS to DST_FS.
- * Update *DST_MIN_UNPACKED_REV in case the shard is new in DST_FS.
- * Do not re-copy data which already exists in DST_FS.
+ * Do not re-copy data which already exists in DST_FS.  The caller is
+ * responsible for updating the min-unpacked-rev file in DST_FS.
  * Set *SKIPPED_P to FALSE only if at least one part of the shard
  * was copied, do not change the value in *SKIPPED_P otherwise.
  * SKIPPED_P may be NULL if not required.
  * Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
 hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
-                          svn_revnum_t *dst_min_unpacked_rev,
                           svn_fs_t *src_fs,
                           svn_fs_t *dst_fs,
                           svn_revnum_t rev,
@@ -323,6 +348,9 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
       || src_ffd->min_unpacked_rev < rev + max_files_per_dir)
     {
       /* copy unpacked revprops rev by rev */
+      SVN_ERR(hotcopy_make_shard_dir(dst_subdir, rev, max_files_per_dir,
+                                     scratch_pool));
+
       iterpool = svn_pool_create(scratch_pool);
       for (revprop_rev = rev;
            revprop_rev < rev + max_files_per_dir;
@@ -340,9 +368,13 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
     {
       /* revprop for revision 0 will never be packed */
       if (rev == 0)
-        SVN_ERR(hotcopy_copy_shard_file(skipped_p, src_subdir, dst_subdir,
-                                        0, max_files_per_dir,
-                                        scratch_pool));
+        {
+          SVN_ERR(hotcopy_make_shard_dir(dst_subdir, 0, max_files_per_dir,
+                                         scratch_pool));
+          SVN_ERR(hotcopy_copy_shard_file(skipped_p, src_subdir, dst_subdir,
+                                          0, max_files_per_dir,
+                                          scratch_pool));
+        }
 
       /* packed revprops folder */
       packed_shard = apr_psprintf(scratch_pool, "%ld" PATH_EXT_PACKED_SHARD,
@@ -357,15 +389,6 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
                                               scratch_pool));
     }
 
-  /* If necessary, update the min-unpacked rev file in the hotcopy. */
-  if (*dst_min_unpacked_rev < rev + max_files_per_dir)
-    {
-      *dst_min_unpacked_rev = rev + max_files_per_dir;
-      SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs,
-                                                *dst_min_unpacked_rev,
-                                                scratch_pool));
-    }
-
   return SVN_NO_ERROR;
 }
 
@@ -532,6 +555,223 @@ remove_folder(const char *path,
   return svn_error_trace(err);
 }
 
+/* Shared state of the hotcopy_revisions() tasks.  The copy tasks only
+ * read from it and may run in any thread.  The output callbacks run in
+ * the calling thread in revision order and are the only ones to update
+ * this structure and to modify the state files in DST_FS. */
+typedef struct hotcopy_task_baton_t
+{
+  /* Source and destination filesystems. */
+  svn_fs_t *src_fs;
+  svn_fs_t *dst_fs;
+
+  /* Revision corresponding to task index 0. */
+  svn_revnum_t first_rev;
+
+  /* Youngest revision in DST_FS before the hotcopy started. */
+  svn_revnum_t dst_youngest;
+
+  /* Current value of min-unpacked-rev in DST_FS. */
+  svn_revnum_t dst_min_unpacked_rev;
+
+  /* Shard folders for un-packed revisions and revprops. */
+  const char *src_revs_dir;
+  const char *dst_revs_dir;
+  const char *src_revprops_dir;
+  const char *dst_revprops_dir;
+
+  /* The parameters passed to hotcopy_revisions(). */
+  svn_boolean_t incremental;
+  svn_fs_hotcopy_notify_t notify_func;
+  void *notify_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} hotcopy_task_baton_t;
+
+/* Implements svn_task__process_func_t.
+ * Copy the packed shard number INDEX as described by the
+ * hotcopy_task_baton_t in PROCESS_BATON.  Return whether all of its
+ * contents already existed in the destination as svn_boolean_t in
+ * *RESULT. */
+static svn_error_t *
+hotcopy_packed_shard_task(void **result,
+                          void *thread_context,
+                          void *process_baton,
+                          apr_int64_t index,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  hotcopy_task_baton_t *baton = process_baton;
+  fs_fs_data_t *src_ffd = baton->src_fs->fsap_data;
+  int max_files_per_dir = src_ffd->max_files_per_dir;
+  svn_boolean_t *skipped = apr_palloc(result_pool, sizeof(*skipped));
+
+  *skipped = TRUE;
+  SVN_ERR(hotcopy_copy_packed_shard(skipped, baton->src_fs, baton->dst_fs,
+                                    (svn_revnum_t)index * max_files_per_dir,
+                                    max_files_per_dir, scratch_pool));
+  *result = skipped;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * Make the packed shard number INDEX visible in the destination and
+ * clean up the un-packed files that it replaces.  Because we get called
+ * in shard order, min-unpacked-rev and 'current' will be bumped one shard
+ * at a time - just as in the single-threaded case. */
+static svn_error_t *
+hotcopy_packed_shard_output(void *result,
+                            void *output_baton,
+                            apr_int64_t index,
+                            apr_pool_t *scratch_pool)
+{
+  hotcopy_task_baton_t *baton = output_baton;
+  svn_fs_t *dst_fs = baton->dst_fs;
+  fs_fs_data_t *dst_ffd = dst_fs->fsap_data;
+  int max_files_per_dir = dst_ffd->max_files_per_dir;
+  svn_revnum_t rev = (svn_revnum_t)index * max_files_per_dir;
+  svn_revnum_t pack_end_rev = rev + max_files_per_dir - 1;
+  svn_boolean_t skipped = *(svn_boolean_t *)result;
+
+  /* If necessary, update the min-unpacked rev file in the hotcopy. */
+  if (baton->dst_min_unpacked_rev < rev + max_files_per_dir)
+    {
+      baton->dst_min_unpacked_rev = rev + max_files_per_dir;
+      SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs,
+                                                baton->dst_min_unpacked_rev,
+                                                scratch_pool));
+    }
+
+  /* Whenever this pack did not previously exist in the destination,
+   * update 'current' to the most recent packed rev (so readers can see
+   * new revisions which arrived in this pack). */
+  if (pack_end_rev > baton->dst_youngest)
+    {
+      SVN_ERR(svn_fs_fs__write_current(dst_fs, pack_end_rev, 0, 0,
+                                       scratch_pool));
+    }
+
+  /* When notifying about packed shards, make things simpler by either
+   * reporting a full revision range, i.e [pack start, pack end] or
+   * reporting nothing. There is one case when this approach might not
+   * be exact (incremental hotcopy with a pack replacing last unpacked
+   * revisions), but generally this is good enough. */
+  if (baton->notify_func && !skipped)
+    baton->notify_func(baton->notify_baton, rev, pack_end_rev, scratch_pool);
+
+  /* Remove revision files which are now packed. */
+  if (baton->incremental)
+    {
+      SVN_ERR(hotcopy_remove_rev_files(dst_fs, rev,
+                                       rev + max_files_per_dir,
+                                       max_files_per_dir, scratch_pool));
+      if (dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
+        SVN_ERR(hotcopy_remove_revprop_files(dst_fs, rev,
+                                             rev + max_files_per_dir,
+                                             max_files_per_dir,
+                                             scratch_pool));
+    }
+
+  /* Now that all revisions have moved into the pack, the original
+   * rev dir can be removed. */
+  SVN_ERR(remove_folder(svn_fs_fs__path_rev_shard(dst_fs, rev, scratch_pool),
+                        baton->cancel_func, baton->cancel_baton,
+                        scratch_pool));
+  if (rev > 0 && dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
+    SVN_ERR(remove_folder(svn_fs_fs__path_revprops_shard(dst_fs, rev,
+                                                         scratch_pool),
+                          baton->cancel_func, baton->cancel_baton,
+                          scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+ * Copy the rev and revprop files of the un-packed revision FIRST_REV +
+ * INDEX as described by the hotcopy_task_baton_t in PROCESS_BATON.
+ * Return whether both already existed in the destination as svn_boolean_t
+ * in *RESULT. */
+static svn_error_t *
+hotcopy_rev_task(void **result,
+                 void *thread_context,
+                 void *process_baton,
+                 apr_int64_t index,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  hotcopy_task_baton_t *baton = process_baton;
+  fs_fs_data_t *src_ffd = baton->src_fs->fsap_data;
+  int max_files_per_dir = src_ffd->max_files_per_dir;
+  svn_revnum_t rev = baton->first_rev + (svn_revnum_t)index;
+  svn_boolean_t *skipped = apr_palloc(result_pool, sizeof(*skipped));
+
+  /* Copying non-packed revisions is racy in case the source repository is
+   * being packed concurrently with this hotcopy operation. The race can
+   * happen with FS formats prior to SVN_FS_FS__MIN_PACK_LOCK_FORMAT that
+   * support packed revisions. With the pack lock, however, the race is
+   * impossible, because hotcopy and pack operations block each other.
+   *
+   * We assume that all revisions coming after 'min-unpacked-rev' really
+   * are unpacked and that's not necessarily true with concurrent packing.
+   * Don't try to be smart in this edge case, because handling it properly
+   * might require copying *everything* from the start. Just abort the
+   * hotcopy with an ENOENT (revision file moved to a pack, so it is no
+   * longer where we expect it to be). */
+
+  *skipped = TRUE;
+
+  /* Copy the rev file. */
+  SVN_ERR(hotcopy_copy_shard_file(skipped,
+                                  baton->src_revs_dir, baton->dst_revs_dir,
+                                  rev, max_files_per_dir, scratch_pool));
+  /* Copy the revprop file. */
+  SVN_ERR(hotcopy_copy_shard_file(skipped,
+                                  baton->src_revprops_dir,
+                                  baton->dst_revprops_dir,
+                                  rev, max_files_per_dir, scratch_pool));
+  *result = skipped;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * Checkpoint and report the un-packed revision FIRST_REV + INDEX.
+ * All older revisions have been copied when this gets called. */
+static svn_error_t *
+hotcopy_rev_output(void *result,
+                   void *output_baton,
+                   apr_int64_t index,
+                   apr_pool_t *scratch_pool)
+{
+  hotcopy_task_baton_t *baton = output_baton;
+  fs_fs_data_t *dst_ffd = baton->dst_fs->fsap_data;
+  int max_files_per_dir = dst_ffd->max_files_per_dir;
+  svn_revnum_t rev = baton->first_rev + (svn_revnum_t)index;
+  svn_boolean_t skipped = *(svn_boolean_t *)result;
+
+  /* Whenever this revision did not previously exist in the destination,
+   * checkpoint the progress via 'current' (do that once per full shard
+   * in order not to slow things down). */
+  if (rev > baton->dst_youngest)
+    {
+      if (max_files_per_dir && (rev % max_files_per_dir == 0))
+        {
+          SVN_ERR(svn_fs_fs__write_current(baton->dst_fs, rev, 0, 0,
+                                           scratch_pool));
+        }
+    }
+
+  if (baton->notify_func && !skipped)
+    baton->notify_func(baton->notify_baton, rev, rev, scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy the revision and revprop files (possibly sharded / packed) from
  * SRC_FS to DST_FS.  Do not re-copy data which already exists in DST_FS.
  * When copying packed or unpacked shards, checkpoint the result in DST_FS
@@ -539,6 +779,10 @@ remove_folder(const char *path,
  * the >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT filesystem format without
  * global next-ID counters.  Indicate progress via the optional NOTIFY_FUNC
  * callback using NOTIFY_BATON.  Use POOL for temporary allocations.
+ *
+ * Packed shards and un-packed revisions get copied using up to as many
+ * threads as configured for SRC_FS.  Updates to the state files in DST_FS
+ * and notifications still happen in revision order from this thread.
  */
 static svn_error_t *
 hotcopy_revisions(svn_fs_t *src_fs,
@@ -557,11 +801,11 @@ hotcopy_revisions(svn_fs_t *src_fs,
                   apr_pool_t *pool)
 {
   fs_fs_data_t *src_ffd = src_fs->fsap_data;
-  fs_fs_data_t *dst_ffd = dst_fs->fsap_data;
   int max_files_per_dir = src_ffd->max_files_per_dir;
   svn_revnum_t src_min_unpacked_rev;
   svn_revnum_t dst_min_unpacked_rev;
   svn_revnum_t rev;
+  hotcopy_task_baton_t baton;
   apr_pool_t *iterpool;
 
   /* Copy the min unpacked rev, and read its value. */
@@ -596,131 +840,67 @@ hotcopy_revisions(svn_fs_t *src_fs,
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
+  baton.src_fs = src_fs;
+  baton.dst_fs = dst_fs;
+  baton.first_rev = 0;
+  baton.dst_youngest = dst_youngest;
+  baton.dst_min_unpacked_rev = dst_min_unpacked_rev;
+  baton.src_revs_dir = src_revs_dir;
+  baton.dst_revs_dir = dst_revs_dir;
+  baton.src_revprops_dir = src_revprops_dir;
+  baton.dst_revprops_dir = dst_revprops_dir;
+  baton.incremental = incremental;
+  baton.notify_func = notify_func;
+  baton.notify_baton = notify_baton;
+  baton.cancel_func = cancel_func;
+  baton.cancel_baton = cancel_baton;
+
   /*
    * Copy the necessary rev files.
    */
 
-  iterpool = svn_pool_create(pool);
   /* First, copy packed shards. */
-  for (rev = 0; rev < src_min_unpacked_rev; rev += max_files_per_dir)
-    {
-      svn_boolean_t skipped = TRUE;
-      svn_revnum_t pack_end_rev;
-
-      svn_pool_clear(iterpool);
-
-      if (cancel_func)
-        SVN_ERR(cancel_func(cancel_baton));
-
-      /* Copy the packed shard. */
-      SVN_ERR(hotcopy_copy_packed_shard(&skipped, &dst_min_unpacked_rev,
-                                        src_fs, dst_fs,
-                                        rev, max_files_per_dir,
-                                        iterpool));
-
-      pack_end_rev = rev + max_files_per_dir - 1;
-
-      /* Whenever this pack did not previously exist in the destination,
-       * update 'current' to the most recent packed rev (so readers can see
-       * new revisions which arrived in this pack). */
-      if (pack_end_rev > dst_youngest)
-        {
-          SVN_ERR(svn_fs_fs__write_current(dst_fs, pack_end_rev, 0, 0,
-                                           iterpool));
-        }
-
-      /* When notifying about packed shards, make things simpler by either
-       * reporting a full revision range, i.e [pack start, pack end] or
-       * reporting nothing. There is one case when this approach might not
-       * be exact (incremental hotcopy with a pack replacing last unpacked
-       * revisions), but generally this is good enough. */
-      if (notify_func && !skipped)
-        notify_func(notify_baton, rev, pack_end_rev, iterpool);
-
-      /* Remove revision files which are now packed. */
-      if (incremental)
-        {
-          SVN_ERR(hotcopy_remove_rev_files(dst_fs, rev,
-                                           rev + max_files_per_dir,
-                                           max_files_per_dir, iterpool));
-          if (dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
-            SVN_ERR(hotcopy_remove_revprop_files(dst_fs, rev,
-                                                 rev + max_files_per_dir,
-                                                 max_files_per_dir,
-                                                 iterpool));
-        }
-
-      /* Now that all revisions have moved into the pack, the original
-       * rev dir can be removed. */
-      SVN_ERR(remove_folder(svn_fs_fs__path_rev_shard(dst_fs, rev, iterpool),
-                            cancel_func, cancel_baton, iterpool));
-      if (rev > 0 && dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
-        SVN_ERR(remove_folder(svn_fs_fs__path_revprops_shard(dst_fs, rev,
-                                                             iterpool),
-                              cancel_func, cancel_baton, iterpool));
-    }
+  if (src_min_unpacked_rev > 0)
+    SVN_ERR(svn_task__run(src_ffd->jobs,
+                          src_min_unpacked_rev / max_files_per_dir,
+                          NULL, NULL,
+                          hotcopy_packed_shard_task, &baton,
+                          hotcopy_packed_shard_output, &baton,
+                          cancel_func, cancel_baton, pool));
 
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
-  SVN_ERR_ASSERT(rev == src_min_unpacked_rev);
-  SVN_ERR_ASSERT(src_min_unpacked_rev == dst_min_unpacked_rev);
+  SVN_ERR_ASSERT(src_min_unpacked_rev == baton.dst_min_unpacked_rev);
 
   /* Now, copy pairs of non-packed revisions and revprop files.
-   * If necessary, update 'current' after copying all files from a shard. */
-  for (; rev <= src_youngest; rev++)
+   * If necessary, update 'current' after copying all files from a shard.
+   *
+   * The copy tasks may run in any order, so create all shard folders
+   * up-front. */
+  if (max_files_per_dir)
     {
-      svn_boolean_t skipped = TRUE;
-
-      svn_pool_clear(iterpool);
-
-      if (cancel_func)
-        SVN_ERR(cancel_func(cancel_baton));
-
-      /* Copying non-packed revisions is racy in case the source repository is
-       * being packed concurrently with this hotcopy operation. The race can
-       * happen with FS formats prior to SVN_FS_FS__MIN_PACK_LOCK_FORMAT that
-       * support packed revisions. With the pack lock, however, the race is
-       * impossible, because hotcopy and pack operations block each other.
-       *
-       * We assume that all revisions coming after 'min-unpacked-rev' really
-       * are unpacked and that's not necessarily true with concurrent packing.
-       * Don't try to be smart in this edge case, because handling it properly
-       * might require copying *everything* from the start. Just abort the
-       * hotcopy with an ENOENT (revision file moved to a pack, so it is no
-       * longer where we expect it to be). */
-
-      /* Copy the rev file. */
-      SVN_ERR(hotcopy_copy_shard_file(&skipped,
-                                      src_revs_dir, dst_revs_dir, rev,
-                                      max_files_per_dir,
-                                      iterpool));
-      /* Copy the revprop file. */
-      SVN_ERR(hotcopy_copy_shard_file(&skipped,
-                                      src_revprops_dir, dst_revprops_dir,
-                                      rev, max_files_per_dir,
-                                      iterpool));
-
-      /* Whenever this revision did not previously exist in the destination,
-       * checkpoint the progress via 'current' (do that once per full shard
-       * in order not to slow things down). */
-      if (rev > dst_youngest)
+      iterpool = svn_pool_create(pool);
+      for (rev = src_min_unpacked_rev;
+           rev <= src_youngest;
+           rev += max_files_per_dir)
         {
-          if (max_files_per_dir && (rev % max_files_per_dir == 0))
-            {
-              SVN_ERR(svn_fs_fs__write_current(dst_fs, rev, 0, 0,
-                                               iterpool));
-            }
+          svn_pool_clear(iterpool);
+          SVN_ERR(hotcopy_make_shard_dir(dst_revs_dir, rev,
+                                         max_files_per_dir, iterpool));
+          SVN_ERR(hotcopy_make_shard_dir(dst_revprops_dir, rev,
+                                         max_files_per_dir, iterpool));
         }
-
-      if (notify_func && !skipped)
-        notify_func(notify_baton, rev, rev, iterpool);
+      svn_pool_destroy(iterpool);
     }
-  svn_pool_destroy(iterpool);
 
-  /* We assume that all revisions were copied now, i.e. we didn't exit the
-   * above loop early. 'rev' was last incremented during exit of the loop. */
-  SVN_ERR_ASSERT(rev == src_youngest + 1);
+  baton.first_rev = src_min_unpacked_rev;
+  SVN_ERR(svn_task__run(src_ffd->jobs,
+                        src_youngest + 1 - src_min_unpacked_rev,
+                        NULL, NULL,
+                        hotcopy_rev_task, &baton,
+                        hotcopy_rev_output, &baton,
+                        cancel_func, cancel_baton, pool));
 
   return SVN_NO_ERROR;
 }
@@ -987,6 +1167,13 @@ hotcopy_body(void *baton, apr_pool_t *pool)
              carried over to the copy. */
           SVN_ERR(svn_io_set_file_read_write(dst_subdir, FALSE, pool));
           SVN_ERR(svn_fs_fs__del_rep_reference(dst_fs, src_youngest, pool));
+
+          /* Any existing filter describes the old database contents.
+             It will be rebuilt by the next commit. */
+          SVN_ERR(svn_io_remove_file2(svn_dirent_join(dst_fs->path,
+                                                      REP_CACHE_FILTER_NAME,
+                                                      pool),
+                                      TRUE, pool));
         }
     }
 
@@ -1053,6 +1240,7 @@ svn_fs_fs__hotcopy(svn_fs_t *src_fs,
       /* Start out with an empty destination using the same configuration
        * as the source. */
       fs_fs_data_t *src_ffd = src_fs->fsap_data;
+      fs_fs_data_t *dst_ffd = dst_fs->fsap_data;
 
       /* Create the DST_FS repository with the same layout as SRC_FS. */
       SVN_ERR(svn_fs_fs__create_file_tree(dst_fs, dst_path, src_ffd->format,
@@ -1060,6 +1248,9 @@ svn_fs_fs__hotcopy(svn_fs_t *src_fs,
                                           src_ffd->use_log_addressing,
                                           pool));
 
+      /* Directory representations will be copied verbatim. */
+      dst_ffd->paged_directories = src_ffd->paged_directories;
+
       /* Copy the UUID.  Hotcopy destination receives a new instance ID, but
        * has the same filesystem UUID as the source. */
       SVN_ERR(svn_fs_fs__set_uuid(dst_fs, src_fs->uuid, NULL, pool));
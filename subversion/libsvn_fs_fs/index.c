@@ -186,6 +186,10 @@ struct svn_fs_fs__packed_number_stream_t
   /* underlying data file containing the packed values */
   apr_file_t *file;
 
+  /* If not NULL, the contents of FILE mapped into memory.  We will then
+   * decode the packed values directly from there. */
+  const unsigned char *mapped;
+
   /* Offset within FILE at which the stream data starts
    * (i.e. which offset will reported as offset 0 by packed_stream_offset). */
   apr_off_t stream_start;
@@ -250,43 +254,58 @@ SVN__PREVENT_INLINE
 static svn_error_t *
 packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 {
-  unsigned char buffer[MAX_NUMBER_PREFETCH];
+  unsigned char file_buffer[MAX_NUMBER_PREFETCH];
+  const unsigned char *buffer = file_buffer;
   apr_size_t bytes_read = 0;
   apr_size_t i;
   value_position_pair_t *target;
   apr_off_t block_start = 0;
   apr_off_t block_left = 0;
-  apr_status_t err;
+  apr_status_t err = APR_SUCCESS;
 
   /* all buffered data will have been read starting here */
   stream->start_offset = stream->next_offset;
 
-  /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH blocks,
-   * i.e. the last number has been incomplete (and not buffered in stream)
-   * and need to be re-read.  Therefore, always correct the file pointer.
-   */
-  SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
-                                   &block_start, stream->next_offset,
-                                   stream->pool));
+  if (stream->mapped)
+    {
+      /* No need to copy anything nor to care about block boundaries. */
+      buffer = stream->mapped + stream->next_offset;
+      if (stream->next_offset < stream->stream_end)
+        bytes_read = (apr_size_t)MIN((apr_off_t)sizeof(file_buffer),
+                                     stream->stream_end - stream->next_offset);
+      else
+        err = APR_EOF;
+    }
+  else
+    {
+      /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH
+       * blocks, i.e. the last number has been incomplete (and not buffered
+       * in stream) and need to be re-read.  Therefore, always correct the
+       * file pointer.
+       */
+      SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
+                                       &block_start, stream->next_offset,
+                                       stream->pool));
 
-  /* prefetch at least one number but, if feasible, don't cross block
-   * boundaries.  This shall prevent jumping back and forth between two
-   * blocks because the extra data was not actually request _now_.
-   */
-  bytes_read = sizeof(buffer);
-  block_left = stream->block_size - (stream->next_offset - block_start);
-  if (block_left >= 10 && block_left < bytes_read)
-    bytes_read = (apr_size_t)block_left;
-
-  /* Don't read beyond the end of the file section that belongs to this
-   * index / stream. */
-  bytes_read = (apr_size_t)MIN(bytes_read,
-                               stream->stream_end - stream->next_offset);
-
-  err = apr_file_read(stream->file, buffer, &bytes_read);
-  if (err && !APR_STATUS_IS_EOF(err))
-    return stream_error_create(stream, err,
-      _("Can't read index file '%s' at offset 0x%s"));
+      /* prefetch at least one number but, if feasible, don't cross block
+       * boundaries.  This shall prevent jumping back and forth between two
+       * blocks because the extra data was not actually request _now_.
+       */
+      bytes_read = sizeof(file_buffer);
+      block_left = stream->block_size - (stream->next_offset - block_start);
+      if (block_left >= 10 && block_left < bytes_read)
+        bytes_read = (apr_size_t)block_left;
+
+      /* Don't read beyond the end of the file section that belongs to this
+       * index / stream. */
+      bytes_read = (apr_size_t)MIN(bytes_read,
+                                   stream->stream_end - stream->next_offset);
+
+      err = apr_file_read(stream->file, file_buffer, &bytes_read);
+      if (err && !APR_STATUS_IS_EOF(err))
+        return stream_error_create(stream, err,
+          _("Can't read index file '%s' at offset 0x%s"));
+    }
 
   /* if the last number is incomplete, trim it from the buffer */
   while (bytes_read > 0 && buffer[bytes_read-1] >= 0x80)
@@ -345,12 +364,15 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 
 /* Create and open a packed number stream reading from offsets START to
  * END in FILE and return it in *STREAM.  Access the file in chunks of
- * BLOCK_SIZE bytes.  Expect the stream to be prefixed by STREAM_PREFIX.
- * Allocate *STREAM in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ * BLOCK_SIZE bytes.  If MAPPED is not NULL, it contains the whole of FILE
+ * and will be read instead.  Expect the stream to be prefixed by
+ * STREAM_PREFIX.  Allocate *STREAM in RESULT_POOL and use SCRATCH_POOL
+ * for temporaries.
  */
 static svn_error_t *
 packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
                    apr_file_t *file,
+                   const char *mapped,
                    apr_off_t start,
                    apr_off_t end,
                    const char *stream_prefix,
@@ -367,10 +389,17 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
   SVN_ERR_ASSERT(len < sizeof(buffer));
 
   /* Read the header prefix and compare it with the expected prefix */
-  SVN_ERR(svn_io_file_aligned_seek(file, block_size, NULL, start,
-                                   scratch_pool));
-  SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
-                                 scratch_pool));
+  if (mapped && start >= 0 && end - start >= (apr_off_t)len)
+    {
+      memcpy(buffer, mapped + start, len);
+    }
+  else
+    {
+      SVN_ERR(svn_io_file_aligned_seek(file, block_size, NULL, start,
+                                       scratch_pool));
+      SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
+                                     scratch_pool));
+    }
 
   if (strncmp(buffer, stream_prefix, len))
     return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
@@ -383,6 +412,7 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
 
   result->pool = result_pool;
   result->file = file;
+  result->mapped = (const unsigned char *)mapped;
   result->stream_start = start + len;
   result->stream_end = end;
 
@@ -947,6 +977,8 @@ auto_open_l2p_index(svn_fs_fs__revision_file_t *rev_file,
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->l2p_stream,
                                  rev_file->file,
+                                 svn_fs_fs__rev_file_data(rev_file, 0,
+                                                   rev_file->footer_offset),
                                  rev_file->l2p_offset,
                                  rev_file->p2l_offset,
                                  L2P_STREAM_PREFIX,
@@ -2139,6 +2171,8 @@ auto_open_p2l_index(svn_fs_fs__revision_file_t *rev_file,
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->p2l_stream,
                                  rev_file->file,
+                                 svn_fs_fs__rev_file_data(rev_file, 0,
+                                                   rev_file->footer_offset),
                                  rev_file->p2l_offset,
                                  rev_file->footer_offset,
                                  P2L_STREAM_PREFIX,
@@ -1328,3 +1328,174 @@ svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
 
   return svn_error_trace(svn_stream_puts(stream, text));
 }
+
+/* Parse the header line of the paged directory representation contents
+ * in DATA of LEN bytes.  Return the number of entries and pages in
+ * *ENTRY_COUNT and *PAGE_COUNT, respectively, the length of the header
+ * line in *HEADER_LEN and that of the page list following it in
+ * *PAGES_LEN.  The caller must make sure that DATA starts with
+ * SVN_FS_FS__PAGED_DIR_MARKER.
+ */
+static svn_error_t *
+parse_dir_index_header(apr_int64_t *entry_count,
+                       int *page_count,
+                       apr_size_t *header_len,
+                       apr_size_t *pages_len,
+                       const char *data,
+                       apr_size_t len)
+{
+  const apr_size_t marker_len = sizeof(SVN_FS_FS__PAGED_DIR_MARKER) - 1;
+  char buffer[SVN_FS_FS__PAGED_DIR_HEADER_MAX];
+  char *last_str = buffer;
+  const char *str;
+  const char *eol;
+  apr_int64_t val;
+
+  eol = memchr(data, '\n', MIN(len, SVN_FS_FS__PAGED_DIR_HEADER_MAX));
+  if (eol == NULL || (apr_size_t)(eol - data) < marker_len)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Malformed paged directory header"));
+
+  /* Tokenize a NUL-terminated copy of the numbers following the marker. */
+  *header_len = eol - data + 1;
+  memcpy(buffer, data + marker_len, *header_len - marker_len - 1);
+  buffer[*header_len - marker_len - 1] = '\0';
+
+  str = svn_cstring_tokenize(" ", &last_str);
+  if (str == NULL)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Malformed paged directory header"));
+  SVN_ERR(svn_cstring_strtoi64(&val, str, 0, APR_INT64_MAX, 10));
+  *entry_count = val;
+
+  str = svn_cstring_tokenize(" ", &last_str);
+  if (str == NULL)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Malformed paged directory header"));
+  SVN_ERR(svn_cstring_strtoi64(&val, str, 1, APR_INT32_MAX, 10));
+  *page_count = (int)val;
+
+  str = svn_cstring_tokenize(" ", &last_str);
+  if (str == NULL)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Malformed paged directory header"));
+  SVN_ERR(svn_cstring_strtoi64(&val, str, 0, APR_INT32_MAX, 10));
+  *pages_len = (apr_size_t)val;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__parse_dir_index_header(apr_size_t *index_end,
+                                  const char *data,
+                                  apr_size_t len)
+{
+  const apr_size_t marker_len = sizeof(SVN_FS_FS__PAGED_DIR_MARKER) - 1;
+  apr_int64_t entry_count;
+  int page_count;
+  apr_size_t header_len;
+  apr_size_t pages_len;
+
+  /* Plain hash dumps start with either "K " or "END". */
+  if (len < marker_len || memcmp(data, SVN_FS_FS__PAGED_DIR_MARKER,
+                                 marker_len))
+    {
+      *index_end = 0;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(parse_dir_index_header(&entry_count, &page_count, &header_len,
+                                 &pages_len, data, len));
+  *index_end = header_len + pages_len;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__parse_dir_index(svn_fs_fs__dir_index_t **index,
+                           const char *data,
+                           apr_size_t len,
+                           apr_pool_t *result_pool)
+{
+  svn_fs_fs__dir_index_t *result;
+  apr_size_t header_len;
+  apr_size_t pages_len;
+  apr_size_t offset;
+  const char *p;
+  const char *end;
+  int i;
+
+  result = apr_pcalloc(result_pool, sizeof(*result));
+  SVN_ERR(parse_dir_index_header(&result->entry_count, &result->page_count,
+                                 &header_len, &pages_len, data, len));
+  if (header_len + pages_len > len)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Truncated paged directory index"));
+
+  /* Each line in the page list is "<size> <first name>". */
+  result->pages = apr_pcalloc(result_pool,
+                              result->page_count * sizeof(*result->pages));
+  p = data + header_len;
+  end = p + pages_len;
+  offset = header_len + pages_len;
+  for (i = 0; i < result->page_count; ++i)
+    {
+      svn_fs_fs__dir_page_t *page = &result->pages[i];
+      const char *eol = memchr(p, '\n', end - p);
+      const char *next;
+
+      if (eol == NULL)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Truncated paged directory index"));
+
+      page->offset = offset;
+      page->size = svn__strtoul(p, &next);
+      if (next == p || *next != ' ' || next + 1 >= eol || page->size == 0)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Malformed paged directory index"));
+
+      page->first_name = apr_pstrmemdup(result_pool, next + 1,
+                                        eol - next - 1);
+      if (i > 0 && strcmp(result->pages[i-1].first_name,
+                          page->first_name) >= 0)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Unordered paged directory index"));
+
+      offset += page->size;
+      p = eol + 1;
+    }
+
+  if (p != end)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Malformed paged directory index"));
+
+  *index = result;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__write_dir_index(svn_fs_fs__dir_index_t *index,
+                           svn_stream_t *stream,
+                           apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *pages = svn_stringbuf_create_empty(scratch_pool);
+  int i;
+
+  for (i = 0; i < index->page_count; ++i)
+    {
+      svn_fs_fs__dir_page_t *page = &index->pages[i];
+      svn_stringbuf_appendcstr(pages,
+                               apr_psprintf(scratch_pool,
+                                            "%" APR_SIZE_T_FMT " %s\n",
+                                            page->size, page->first_name));
+    }
+
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            SVN_FS_FS__PAGED_DIR_MARKER
+                            "%" APR_INT64_T_FMT " %d %" APR_SIZE_T_FMT "\n",
+                            index->entry_count, index->page_count,
+                            pages->len));
+
+  return svn_error_trace(svn_stream_write(stream, pages->data, &pages->len));
+}
@@ -37,6 +37,7 @@
  * - node revision
  * - representation (as in "text:" and "props:" lines)
  * - representation header ("PLAIN" and "DELTA" lines)
+ * - paged directory index ("PAGED" line and page list)
  */
 
 /* Given the last "few" bytes (should be at least 40) of revision REV in
@@ -233,3 +234,51 @@ svn_error_t *
 svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
                             svn_stream_t *stream,
                             apr_pool_t *scratch_pool);
+
+/* Every paged directory representation starts with this keyword. */
+#define SVN_FS_FS__PAGED_DIR_MARKER     "PAGED "
+
+/* Upper limit for the length of the header line of a paged directory
+ * representation, including the EOL. */
+#define SVN_FS_FS__PAGED_DIR_HEADER_MAX 80
+
+/* Maximum number of entries in a single page of a paged directory. */
+#define SVN_FS_FS__DIR_PAGE_SIZE        256
+
+/* Directories with more than this number of entries will be written as
+ * paged representations if the repository format option is set. */
+#define SVN_FS_FS__MIN_PAGED_DIR_SIZE   1024
+
+/* Given the first LEN bytes of a directory representation's contents in
+ * DATA, set *INDEX_END to the number of bytes at the start of the contents
+ * occupied by the page index.  The pages follow immediately after it.
+ * Set *INDEX_END to 0 if the directory is not stored as paged rep.
+ *
+ * LEN should be at least SVN_FS_FS__PAGED_DIR_HEADER_MAX bytes unless the
+ * whole representation is shorter than that.
+ */
+svn_error_t *
+svn_fs_fs__parse_dir_index_header(apr_size_t *index_end,
+                                  const char *data,
+                                  apr_size_t len);
+
+/* Parse the page index at the start of the paged directory contents DATA
+ * of LEN bytes.  LEN must cover at least the whole index as returned by
+ * svn_fs_fs__parse_dir_index_header.  Return the result in *INDEX,
+ * allocated in RESULT_POOL.  The page ranges will not be checked against
+ * the size of the representation.
+ */
+svn_error_t *
+svn_fs_fs__parse_dir_index(svn_fs_fs__dir_index_t **index,
+                           const char *data,
+                           apr_size_t len,
+                           apr_pool_t *result_pool);
+
+/* Write the page index for INDEX to STREAM.  The pages themselves must
+ * follow immediately, in the order and with the sizes given in INDEX.
+ * Their OFFSET members will be ignored.
+ * Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__write_dir_index(svn_fs_fs__dir_index_t *index,
+                           svn_stream_t *stream,
+                           apr_pool_t *scratch_pool);
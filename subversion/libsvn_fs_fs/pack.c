@@ -30,6 +30,7 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_io_private.h"
+#include "private/svn_task.h"
 
 #include "fs_fs.h"
 #include "pack.h"
@@ -1957,6 +1958,53 @@ synced_pack_shard(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Set *PACK_FILE_DIR and *SHARD_PATH to the paths of the packed and the
+ * non-packed version of SHARD within REVS_DIR.  Allocate them in POOL.
+ */
+static void
+get_rev_shard_paths(const char **pack_file_dir,
+                    const char **shard_path,
+                    const char *revs_dir,
+                    apr_int64_t shard,
+                    apr_pool_t *pool)
+{
+  *pack_file_dir = svn_dirent_join(revs_dir,
+                  apr_psprintf(pool,
+                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
+                               shard),
+                  pool);
+  *shard_path = svn_dirent_join(revs_dir,
+                                apr_psprintf(pool, "%" APR_INT64_T_FMT,
+                                             shard),
+                                pool);
+}
+
+/* Switch FS over to the already packed revision contents of the shard
+ * described by BATON, pack its revprops and notify the caller.
+ */
+static svn_error_t *
+switch_to_packed_shard(struct pack_baton *baton,
+                       apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
+
+  /* For newer repo formats, we only acquired the pack lock so far.
+     Before modifying the repo state by switching over to the packed
+     data, we need to acquire the global (write) lock. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
+    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
+                                       pool));
+  else
+    SVN_ERR(synced_pack_shard(baton, pool));
+
+  /* Notify caller we're done packing this shard. */
+  if (baton->notify_func)
+    SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
+                               svn_fs_pack_notify_end, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Pack the shard described by BATON.
  *
  * If for some reason we detect a partial packing already performed,
@@ -1975,16 +2023,8 @@ pack_shard(struct pack_baton *baton,
                                svn_fs_pack_notify_start, pool));
 
   /* Some useful paths. */
-  rev_pack_file_dir = svn_dirent_join(baton->revs_dir,
-                  apr_psprintf(pool,
-                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
-                               baton->shard),
-                  pool);
-  baton->rev_shard_path = svn_dirent_join(baton->revs_dir,
-                                          apr_psprintf(pool,
-                                                       "%" APR_INT64_T_FMT,
-                                                       baton->shard),
-                                          pool);
+  get_rev_shard_paths(&rev_pack_file_dir, &baton->rev_shard_path,
+                      baton->revs_dir, baton->shard, pool);
 
   /* pack the revision content */
   SVN_ERR(pack_rev_shard(baton->fs, rev_pack_file_dir, baton->rev_shard_path,
@@ -1992,23 +2032,153 @@ pack_shard(struct pack_baton *baton,
                          baton->max_mem, ffd->flush_to_disk,
                          baton->cancel_func, baton->cancel_baton, pool));
 
-  /* For newer repo formats, we only acquired the pack lock so far.
-     Before modifying the repo state by switching over to the packed
-     data, we need to acquire the global (write) lock. */
-  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
-    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
-                                       pool));
-  else
-    SVN_ERR(synced_pack_shard(baton, pool));
+  return svn_error_trace(switch_to_packed_shard(baton, pool));
+}
 
-  /* Notify caller we're starting to pack this shard. */
-  if (baton->notify_func)
-    SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
-                               svn_fs_pack_notify_end, pool));
+/* Baton type used with svn_task__run() by pack_concurrently(). */
+typedef struct pack_task_baton_t
+{
+  /* The pack operation's state.  Only to be modified by the main thread.
+   * Its filesystem serves as a template for the worker instances. */
+  struct pack_baton *pb;
+
+  /* Shard to pack for task index 0. */
+  apr_int64_t first_shard;
+
+  /* Number of shards to pack. */
+  apr_int64_t count;
+
+  /* Number of workers. */
+  int jobs;
+
+  /* Memory limit for each of the workers. */
+  apr_size_t max_mem;
+} pack_task_baton_t;
+
+/* Implements svn_task__thread_context_constructor_t.
+ * Open a private instance of the pack_task_baton_t's filesystem. */
+static svn_error_t *
+open_fs_for_thread(void **thread_context,
+                   void *baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  pack_task_baton_t *task_baton = baton;
+  svn_fs_t *fs;
+
+  SVN_ERR(svn_fs_fs__open_clone(&fs, task_baton->pb->fs, result_pool,
+                                scratch_pool));
+  *thread_context = fs;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+ * Pack the revision contents of the shard given by INDEX.  This does not
+ * modify the repository state and may therefore run concurrently for
+ * any number of shards. */
+static svn_error_t *
+pack_shard_task(void **result,
+                void *thread_context,
+                void *process_baton,
+                apr_int64_t index,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  pack_task_baton_t *task_baton = process_baton;
+  svn_fs_t *fs = thread_context;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_int64_t shard = task_baton->first_shard + index;
+  const char *rev_pack_file_dir, *rev_shard_path;
+
+  get_rev_shard_paths(&rev_pack_file_dir, &rev_shard_path,
+                      task_baton->pb->revs_dir, shard, scratch_pool);
+  SVN_ERR(pack_rev_shard(fs, rev_pack_file_dir, rev_shard_path,
+                         shard, ffd->max_files_per_dir,
+                         task_baton->max_mem, ffd->flush_to_disk,
+                         cancel_func, cancel_baton, scratch_pool));
+
+  *result = NULL;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * Switch over to the shard packed for INDEX.  Since this is being called
+ * in shard order, min-unpacked-rev will only ever be bumped by one shard
+ * at a time - just as in the single-threaded case.
+ *
+ * With the worker slot of INDEX becoming available, announce the start
+ * of the shard that will take its place. */
+static svn_error_t *
+pack_shard_output(void *result,
+                  void *output_baton,
+                  apr_int64_t index,
+                  apr_pool_t *scratch_pool)
+{
+  pack_task_baton_t *task_baton = output_baton;
+  struct pack_baton *pb = task_baton->pb;
+  const char *rev_pack_file_dir;
+
+  pb->shard = task_baton->first_shard + index;
+  get_rev_shard_paths(&rev_pack_file_dir, &pb->rev_shard_path,
+                      pb->revs_dir, pb->shard, scratch_pool);
+
+  SVN_ERR(switch_to_packed_shard(pb, scratch_pool));
+
+  if (pb->notify_func && index + task_baton->jobs < task_baton->count)
+    SVN_ERR(pb->notify_func(pb->notify_baton,
+                            pb->shard + task_baton->jobs,
+                            svn_fs_pack_notify_start, scratch_pool));
 
   return SVN_NO_ERROR;
 }
 
+/* Pack the shards FIRST_SHARD up to but not including END_SHARD as
+ * described by PB, using up to FFD->JOBS threads.  Each worker opens its
+ * own filesystem instance once and then packs as many shards as it can
+ * get.  Each worker gets an equal share of PB->MAX_MEM.  Use POOL for
+ * allocations.
+ *
+ * The notification callback must only be invoked from this thread.
+ * We announce the first shards up to the number of workers right away
+ * and every further one when a previous shard has been completed.  This
+ * keeps the start notifications roughly in line with the actual work.
+ */
+static svn_error_t *
+pack_concurrently(struct pack_baton *pb,
+                  apr_int64_t first_shard,
+                  apr_int64_t end_shard,
+                  apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = pb->fs->fsap_data;
+  pack_task_baton_t task_baton;
+  apr_int64_t i;
+
+  task_baton.pb = pb;
+  task_baton.first_shard = first_shard;
+  task_baton.count = end_shard - first_shard;
+  task_baton.jobs = ffd->jobs;
+  if (task_baton.jobs > task_baton.count)
+    task_baton.jobs = (int)task_baton.count;
+
+  task_baton.max_mem = pb->max_mem / task_baton.jobs;
+
+  /* Notify caller we're starting to pack the first shards. */
+  if (pb->notify_func)
+    for (i = 0; i < task_baton.jobs; ++i)
+      SVN_ERR(pb->notify_func(pb->notify_baton, first_shard + i,
+                              svn_fs_pack_notify_start, pool));
+
+  return svn_error_trace(svn_task__run(task_baton.jobs, task_baton.count,
+                                       open_fs_for_thread, &task_baton,
+                                       pack_shard_task, &task_baton,
+                                       pack_shard_output, &task_baton,
+                                       pb->cancel_func, pb->cancel_baton,
+                                       pool));
+}
+
 /* Read the youngest rev and the first non-packed rev info for FS from disk.
    Set *FULLY_PACKED when there is no completed unpacked shard.
    Use SCRATCH_POOL for temporary allocations.
@@ -2080,6 +2250,12 @@ pack_body(void *baton,
     pb->revsprops_dir = svn_dirent_join(pb->fs->path, PATH_REVPROPS_DIR,
                                         pool);
 
+  /* Pack the revision contents of multiple shards at once? */
+  if (ffd->jobs > 1)
+    return svn_error_trace(pack_concurrently(pb,
+                              ffd->min_unpacked_rev / ffd->max_files_per_dir,
+                              completed_shards, pool));
+
   iterpool = svn_pool_create(pool);
   for (pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
        pb->shard < completed_shards;
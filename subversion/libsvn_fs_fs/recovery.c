@@ -134,6 +134,51 @@ read_handler_recover(void *baton, char *buffer, apr_size_t *len)
   return svn_stream_read_full(b->stream, buffer, &bytes_to_read);
 }
 
+/* Read the directory contents of EXPANDED_SIZE bytes from STREAM into
+   ENTRIES like svn_hash_read2() would but also accept paged directory
+   representations.  Use POOL for allocations. */
+static svn_error_t *
+read_dir_hash(apr_hash_t *entries,
+              svn_stream_t *stream,
+              svn_filesize_t expanded_size,
+              apr_pool_t *pool)
+{
+  svn_stringbuf_t *text;
+  svn_fs_fs__dir_index_t *index;
+  apr_size_t index_end;
+  int i;
+
+  SVN_ERR(svn_stringbuf_from_stream(&text, stream, (apr_size_t)expanded_size,
+                                    pool));
+  SVN_ERR(svn_fs_fs__parse_dir_index_header(&index_end, text->data,
+                                            text->len));
+  if (index_end == 0)
+    return svn_error_trace(svn_hash_read2(entries,
+                                          svn_stream_from_stringbuf(text,
+                                                                    pool),
+                                          SVN_HASH_TERMINATOR, pool));
+
+  /* Each page is a complete hash dump of its own. */
+  SVN_ERR(svn_fs_fs__parse_dir_index(&index, text->data, text->len, pool));
+  for (i = 0; i < index->page_count; ++i)
+    {
+      svn_string_t page_text;
+
+      if (index->pages[i].offset + index->pages[i].size > text->len)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Directory page beyond the end of the "
+                                  "representation"));
+
+      page_text.data = text->data + index->pages[i].offset;
+      page_text.len = index->pages[i].size;
+      SVN_ERR(svn_hash_read2(entries,
+                             svn_stream_from_string(&page_text, pool),
+                             SVN_HASH_TERMINATOR, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Part of the recovery procedure.  Read the directory noderev at offset
    OFFSET of file REV_FILE (the revision file of revision REV of
    filesystem FS), and set MAX_NODE_ID and MAX_COPY_ID to be the node-id
@@ -163,7 +208,7 @@ recover_find_max_ids(svn_fs_t *fs,
   svn_error_t *err;
 
   baton.stream = rev_file->stream;
-  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev, baton.stream, pool, pool));
 
   /* Check that this is a directory.  It should be. */
@@ -186,7 +231,7 @@ recover_find_max_ids(svn_fs_t *fs,
      rely on directory entries being stored as PLAIN reps, though. */
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL,
                                  noderev->data_rep->item_index, pool));
-  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
   SVN_ERR(svn_fs_fs__read_rep_header(&header, baton.stream, pool, pool));
   if (header->type != svn_fs_fs__rep_plain)
     return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
@@ -204,7 +249,8 @@ recover_find_max_ids(svn_fs_t *fs,
 
   /* Now read the entries from that stream. */
   entries = apr_hash_make(pool);
-  err = svn_hash_read2(entries, stream, SVN_HASH_TERMINATOR, pool);
+  err = read_dir_hash(entries, stream, noderev->data_rep->expanded_size,
+                      pool);
   if (err)
     {
       svn_string_t *id_str = svn_fs_fs__id_unparse(noderev->id, pool);
@@ -64,6 +64,29 @@ WHERE hash = ?1
 INSERT OR FAIL INTO rep_cache (hash, revision, offset, size, expanded_size)
 VALUES (?1, ?2, ?3, ?4, ?5)
 
+-- STMT_SET_REP_BATCH
+/* Insert REP_BATCH_SIZE (see rep-cache.c) rows at once.  If any hash
+   is already present, none of the rows get inserted.
+
+   Works for both V1 and V2 schemas. */
+INSERT INTO rep_cache (hash, revision, offset, size, expanded_size)
+VALUES (?1, ?2, ?3, ?4, ?5),
+       (?6, ?7, ?8, ?9, ?10),
+       (?11, ?12, ?13, ?14, ?15),
+       (?16, ?17, ?18, ?19, ?20),
+       (?21, ?22, ?23, ?24, ?25),
+       (?26, ?27, ?28, ?29, ?30),
+       (?31, ?32, ?33, ?34, ?35),
+       (?36, ?37, ?38, ?39, ?40),
+       (?41, ?42, ?43, ?44, ?45),
+       (?46, ?47, ?48, ?49, ?50),
+       (?51, ?52, ?53, ?54, ?55),
+       (?56, ?57, ?58, ?59, ?60),
+       (?61, ?62, ?63, ?64, ?65),
+       (?66, ?67, ?68, ?69, ?70),
+       (?71, ?72, ?73, ?74, ?75),
+       (?76, ?77, ?78, ?79, ?80)
+
 -- STMT_GET_REPS_FOR_RANGE
 /* Works for both V1 and V2 schemas. */
 SELECT hash, revision, offset, size, expanded_size
@@ -80,6 +103,43 @@ FROM rep_cache
 DELETE FROM rep_cache
 WHERE revision > ?1
 
+-- STMT_CREATE_FILTER_STATE
+/* Count all rows ever inserted into rep_cache.  The rep-cache filter
+   records the count that it covers, so it can tell when rows got added
+   behind its back, e.g. by clients that don't maintain the filter.
+   The trigger keeps the count current for those clients as well.
+
+   Works for both V1 and V2 schemas. */
+CREATE TABLE IF NOT EXISTS filter_state (
+  inserted INTEGER NOT NULL
+  );
+
+INSERT INTO filter_state (inserted)
+SELECT 0 WHERE NOT EXISTS (SELECT 1 FROM filter_state);
+
+CREATE TRIGGER IF NOT EXISTS rep_cache_insert_trigger
+AFTER INSERT ON rep_cache
+BEGIN
+  UPDATE filter_state SET inserted = inserted + 1;
+END;
+
+-- STMT_HAS_FILTER_STATE
+SELECT 1 FROM sqlite_master
+WHERE type = 'table' AND name = 'filter_state'
+
+-- STMT_GET_FILTER_STATE
+SELECT inserted FROM filter_state
+
+-- STMT_COUNT_REPS
+/* Works for both V1 and V2 schemas. */
+SELECT COUNT(*)
+FROM rep_cache
+
+-- STMT_GET_ALL_HASHES
+/* Works for both V1 and V2 schemas. */
+SELECT hash
+FROM rep_cache
+
 /* An INSERT takes an SQLite reserved lock that prevents other writes
    but doesn't block reads.  The incomplete transaction means that no
    permanent change is made to the database and the transaction is
@@ -38,6 +38,13 @@
 
 REP_CACHE_DB_SQL_DECLARE_STATEMENTS(statements);
 
+/* Number of rows inserted by STMT_SET_REP_BATCH. */
+#define REP_BATCH_SIZE 16
+
+/* Number of representations that svn_fs_fs__build_rep_cache() collects
+   before writing them in a single database transaction. */
+#define BUILD_BATCH_SIZE 4096
+
 
 
 /** Helper functions. **/
@@ -48,7 +55,923 @@ path_rep_cache_db(const char *fs_path,
   return svn_dirent_join(fs_path, REP_CACHE_DB_NAME, result_pool);
 }
 
-
+static APR_INLINE const char *
+path_rep_cache_filter(const char *fs_path,
+                      apr_pool_t *result_pool)
+{
+  return svn_dirent_join(fs_path, REP_CACHE_FILTER_NAME, result_pool);
+}
+
+
+/** The rep-cache filter.
+ *
+ * Almost all lookups in the rep cache during a commit are for new
+ * contents and miss.  To answer those without querying the database,
+ * we keep a Bloom filter over all SHA1 keys in rep-cache.db.  False
+ * positives simply fall back to the database.
+ *
+ * The filter is persisted in REP_CACHE_FILTER_NAME and only ever written
+ * while holding the RESERVED lock on the database.  Keys added without
+ * updating the filter would turn into false negatives, i.e. missed
+ * sharing opportunities.  To detect that, the database counts all
+ * insertions in its FILTER_STATE table and the filter file records the
+ * count that it covers.  A filter whose count does not match the
+ * database is not used for lookups.
+ *
+ * All svn_fs_t instances of a repository within a process share one
+ * in-memory copy of the filter, see fs_fs_shared_data_t.  Adding keys
+ * is cheap and done by the commits themselves.  Building a filter from
+ * scratch, however, requires reading the whole database.  That is never
+ * done while writing to the rep cache but by the next lookup that does
+ * not hold the repository write lock.
+ *
+ * File format: FILTER_MAGIC, the insertion count covered, the number of
+ * keys added and the size of the bit array in bytes, each as 8 byte
+ * big-endian numbers, followed by the bit array itself.
+ **/
+
+#define FILTER_MAGIC "SVNRCF1\n"
+#define FILTER_HEADER_SIZE 32
+
+/* The bit array gets written in blocks of this size.  The array size
+   is always a power of two and a multiple of this. */
+#define FILTER_BLOCK_SIZE 0x1000
+#define FILTER_MIN_SIZE (2 * FILTER_BLOCK_SIZE)
+
+/* With 16 bits per key and 8 probes, the false positive rate is about
+   0.06%.  Filters exceeding that load get rebuilt with twice the size. */
+#define FILTER_BYTES_PER_KEY 2
+#define FILTER_PROBES 8
+
+/* An in-memory copy of the filter.  Instances get replaced as a whole
+   and are only modified by the one thread updating the rep cache.  All
+   access to the shared instance is serialized by the filter lock in
+   fs_fs_shared_data_t. */
+typedef struct rep_cache_filter_t
+{
+  /* Root pool owning this structure and all its members. */
+  apr_pool_t *pool;
+
+  /* Header followed by the bit array, i.e. the file contents.
+     NULL for a placeholder that only tracks our state. */
+  unsigned char *data;
+
+  /* Size of the bit array in bytes. */
+  apr_size_t size;
+
+  /* Value of the database's insertion counter covered by the filter. */
+  apr_uint64_t stamp;
+
+  /* Number of keys added to the filter. */
+  apr_uint64_t keys;
+
+  /* Set while some svn_fs_t in this process writes to the rep cache.
+     Lookups must not use the filter during that time. */
+  svn_boolean_t updating;
+
+  /* One flag per FILTER_BLOCK_SIZE block of the bit array, telling which
+     blocks need to be written.  Non-NULL only while adding keys. */
+  svn_boolean_t *dirty;
+
+  /* Whether the filter covers all keys in the database, as of when the
+     youngest revision was CHECKED_REV. */
+  svn_boolean_t usable;
+  svn_revnum_t checked_rev;
+} rep_cache_filter_t;
+
+static void
+encode_uint64(unsigned char *p,
+              apr_uint64_t value)
+{
+  int i;
+  for (i = 7; i >= 0; --i)
+    {
+      p[i] = (unsigned char)(value & 0xff);
+      value >>= 8;
+    }
+}
+
+static apr_uint64_t
+decode_uint64(const unsigned char *p)
+{
+  apr_uint64_t value = 0;
+  int i;
+  for (i = 0; i < 8; ++i)
+    value = (value << 8) | p[i];
+
+  return value;
+}
+
+/* Return a new filter with an empty bit array of SIZE bytes.  If SIZE
+   is 0, return a placeholder without a bit array.  The filter lives in
+   a root pool of its own, so it may outlive the svn_fs_t that built it. */
+static rep_cache_filter_t *
+filter_create(apr_size_t size)
+{
+  apr_pool_t *pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  rep_cache_filter_t *filter = apr_pcalloc(pool, sizeof(*filter));
+
+  filter->pool = pool;
+  filter->size = size;
+  filter->checked_rev = SVN_INVALID_REVNUM;
+  if (size)
+    filter->data = apr_pcalloc(pool, FILTER_HEADER_SIZE + size);
+
+  return filter;
+}
+
+/* Release FILTER, which may be NULL. */
+static void
+filter_destroy(rep_cache_filter_t *filter)
+{
+  if (filter)
+    svn_pool_destroy(filter->pool);
+}
+
+/* Set all bits for the SHA1 DIGEST in FILTER.  Because SHA1 digests are
+   uniformly distributed, we can use them directly for double hashing. */
+static void
+filter_add(rep_cache_filter_t *filter,
+           const unsigned char *digest)
+{
+  unsigned char *bits = filter->data + FILTER_HEADER_SIZE;
+  apr_uint64_t mask = (apr_uint64_t)filter->size * 8 - 1;
+  apr_uint64_t h1 = decode_uint64(digest);
+  apr_uint64_t h2 = decode_uint64(digest + 8) | 1;
+  int i;
+
+  for (i = 0; i < FILTER_PROBES; ++i)
+    {
+      apr_uint64_t bit = (h1 + i * h2) & mask;
+      bits[bit / 8] |= (unsigned char)(1 << (bit % 8));
+      if (filter->dirty)
+        filter->dirty[bit / 8 / FILTER_BLOCK_SIZE] = TRUE;
+    }
+
+  filter->keys++;
+}
+
+/* Return FALSE if the SHA1 DIGEST is definitely not in FILTER. */
+static svn_boolean_t
+filter_may_contain(const rep_cache_filter_t *filter,
+                   const unsigned char *digest)
+{
+  const unsigned char *bits = filter->data + FILTER_HEADER_SIZE;
+  apr_uint64_t mask = (apr_uint64_t)filter->size * 8 - 1;
+  apr_uint64_t h1 = decode_uint64(digest);
+  apr_uint64_t h2 = decode_uint64(digest + 8) | 1;
+  int i;
+
+  for (i = 0; i < FILTER_PROBES; ++i)
+    {
+      apr_uint64_t bit = (h1 + i * h2) & mask;
+      if ((bits[bit / 8] & (1 << (bit % 8))) == 0)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Update the header in FILTER's DATA from its members. */
+static void
+encode_filter_header(rep_cache_filter_t *filter)
+{
+  memcpy(filter->data, FILTER_MAGIC, 8);
+  encode_uint64(filter->data + 8, filter->stamp);
+  encode_uint64(filter->data + 16, filter->keys);
+  encode_uint64(filter->data + 24, filter->size);
+}
+
+/* Set *COUNT to the number of rows ever inserted into FS's rep cache.
+   Set *FOUND to FALSE, if the database does not keep that count yet. */
+static svn_error_t *
+read_insert_count(svn_boolean_t *found,
+                  apr_uint64_t *count,
+                  svn_fs_t *fs,
+                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                    STMT_HAS_FILTER_STATE));
+  SVN_ERR(svn_sqlite__step(found, stmt));
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  *count = 0;
+  if (*found)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                        STMT_GET_FILTER_STATE));
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+      if (have_row)
+        *count = (apr_uint64_t)svn_sqlite__column_int64(stmt, 0);
+      else
+        *found = FALSE;
+
+      SVN_ERR(svn_sqlite__reset(stmt));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the header of FS's filter file into *STAMP, *KEYS and *SIZE.
+   Set *FOUND to FALSE if there is no such file or if it is not valid.
+   Otherwise, return the file, positioned at the start of the bit array,
+   in *FILE, allocated in RESULT_POOL. */
+static svn_error_t *
+open_filter_file(apr_file_t **file,
+                 svn_boolean_t *found,
+                 apr_uint64_t *stamp,
+                 apr_uint64_t *keys,
+                 apr_size_t *size,
+                 svn_fs_t *fs,
+                 apr_pool_t *result_pool)
+{
+  unsigned char header[FILTER_HEADER_SIZE];
+  apr_size_t bytes_read;
+  svn_boolean_t eof;
+  apr_uint64_t file_size;
+  svn_error_t *err;
+
+  *found = FALSE;
+  err = svn_io_file_open(file, path_rep_cache_filter(fs->path, result_pool),
+                         APR_READ | APR_BUFFERED, APR_OS_DEFAULT,
+                         result_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(err);
+  SVN_ERR(svn_io_file_read_full2(*file, header, sizeof(header), &bytes_read,
+                                 &eof, result_pool));
+
+  file_size = decode_uint64(header + 24);
+  if (   bytes_read < sizeof(header)
+      || memcmp(header, FILTER_MAGIC, 8) != 0
+      || file_size < FILTER_MIN_SIZE
+      || file_size != (apr_size_t)file_size
+      || (file_size & (file_size - 1)) != 0)
+    return svn_error_trace(svn_io_file_close(*file, result_pool));
+
+  *found = TRUE;
+  *stamp = decode_uint64(header + 8);
+  *keys = decode_uint64(header + 16);
+  *size = (apr_size_t)file_size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *FILTER_P to a new filter read from FS's filter file, if that
+   exists and covers insertion count STAMP.  Otherwise, set it to NULL. */
+static svn_error_t *
+read_filter(rep_cache_filter_t **filter_p,
+            svn_fs_t *fs,
+            apr_uint64_t stamp,
+            apr_pool_t *scratch_pool)
+{
+  rep_cache_filter_t *filter;
+  apr_file_t *file;
+  svn_boolean_t found;
+  apr_uint64_t file_stamp;
+  apr_uint64_t keys;
+  apr_size_t size;
+  apr_size_t bytes_read;
+  svn_boolean_t eof;
+  svn_error_t *err;
+
+  *filter_p = NULL;
+  SVN_ERR(open_filter_file(&file, &found, &file_stamp, &keys, &size, fs,
+                           scratch_pool));
+  if (! found)
+    return SVN_NO_ERROR;
+
+  if (file_stamp != stamp)
+    return svn_error_trace(svn_io_file_close(file, scratch_pool));
+
+  filter = filter_create(size);
+  err = svn_io_file_read_full2(file, filter->data + FILTER_HEADER_SIZE,
+                               size, &bytes_read, &eof, scratch_pool);
+  err = svn_error_compose_create(err, svn_io_file_close(file, scratch_pool));
+
+  /* Don't use truncated files. */
+  if (err || bytes_read != size)
+    {
+      filter_destroy(filter);
+      return svn_error_trace(err);
+    }
+
+  filter->stamp = stamp;
+  filter->keys = keys;
+  encode_filter_header(filter);
+  *filter_p = filter;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *FILTER_P to a new filter containing all keys in FS's rep cache
+   and mark it as covering insertion count STAMP.  This reads the whole
+   database but does not lock it. */
+static svn_error_t *
+scan_filter(rep_cache_filter_t **filter_p,
+            svn_fs_t *fs,
+            apr_uint64_t stamp,
+            apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  rep_cache_filter_t *filter;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  apr_int64_t count;
+  apr_size_t size = FILTER_MIN_SIZE;
+  apr_pool_t *iterpool;
+  int iterations = 0;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  /* Leave room for the repository to double in size. */
+  SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                    STMT_COUNT_REPS));
+  SVN_ERR(svn_sqlite__step_row(stmt));
+  count = svn_sqlite__column_int64(stmt, 0);
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  while ((apr_uint64_t)size < 2 * FILTER_BYTES_PER_KEY * (apr_uint64_t)count
+         && size < APR_SIZE_MAX / 4)
+    size *= 2;
+
+  filter = filter_create(size);
+  iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                    STMT_GET_ALL_HASHES));
+  err = svn_sqlite__step(&have_row, stmt);
+  while (!err && have_row)
+    {
+      svn_checksum_t *checksum;
+
+      if (iterations++ % 1024 == 0)
+        svn_pool_clear(iterpool);
+
+      err = svn_checksum_parse_hex(&checksum, svn_checksum_sha1,
+                                   svn_sqlite__column_text(stmt, 0, iterpool),
+                                   iterpool);
+      if (!err && checksum)
+        filter_add(filter, checksum->digest);
+
+      if (!err)
+        err = svn_sqlite__step(&have_row, stmt);
+    }
+
+  err = svn_error_compose_create(err, svn_sqlite__reset(stmt));
+  svn_pool_destroy(iterpool);
+  if (err)
+    {
+      filter_destroy(filter);
+      return svn_error_trace(err);
+    }
+
+  filter->stamp = stamp;
+  encode_filter_header(filter);
+  *filter_p = filter;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write FILTER to FS's filter file, replacing any existing one. */
+static svn_error_t *
+write_filter(rep_cache_filter_t *filter,
+             svn_fs_t *fs,
+             apr_pool_t *scratch_pool)
+{
+  /* The filter is merely an optimization.  No need to flush it. */
+  return svn_error_trace(
+           svn_io_write_atomic2(path_rep_cache_filter(fs->path, scratch_pool),
+                                filter->data,
+                                FILTER_HEADER_SIZE + filter->size,
+                                svn_fs_fs__path_current(fs, scratch_pool),
+                                FALSE, scratch_pool));
+}
+
+/* Body of rebuild_filter(), to be run with the RESERVED lock on FS's
+   database.  Write FILTER to disk if it covers insertion count STAMP,
+   which has to be the current one.  Set *WRITTEN accordingly. */
+static svn_error_t *
+publish_filter(svn_boolean_t *written,
+               rep_cache_filter_t *filter,
+               svn_fs_t *fs,
+               apr_uint64_t stamp,
+               apr_pool_t *scratch_pool)
+{
+  svn_boolean_t found;
+  apr_uint64_t count;
+
+  *written = FALSE;
+  SVN_ERR(read_insert_count(&found, &count, fs, scratch_pool));
+  if (found && count == stamp)
+    {
+      SVN_ERR(write_filter(filter, fs, scratch_pool));
+      *written = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Build a new filter covering insertion count STAMP for FS and write it
+   to disk.  Return it in *FILTER_P.  If some commit added to the rep
+   cache in the meantime, set *FILTER_P to NULL.
+
+   Scanning the database does not block any writers.  Only the final
+   write of the filter file happens under the RESERVED lock, to make sure
+   that it does not miss any key. */
+static svn_error_t *
+rebuild_filter(rep_cache_filter_t **filter_p,
+               svn_fs_t *fs,
+               apr_uint64_t stamp,
+               apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  rep_cache_filter_t *filter;
+  svn_boolean_t written = FALSE;
+  svn_error_t *err;
+
+  *filter_p = NULL;
+  SVN_ERR(scan_filter(&filter, fs, stamp, scratch_pool));
+
+  err = svn_sqlite__begin_immediate_transaction(ffd->rep_cache_db);
+  if (!err)
+    {
+      err = publish_filter(&written, filter, fs, stamp, scratch_pool);
+      err = svn_sqlite__finish_transaction(ffd->rep_cache_db, err);
+    }
+
+  if (err || !written)
+    {
+      filter_destroy(filter);
+      return svn_error_trace(err);
+    }
+
+  *filter_p = filter;
+  return SVN_NO_ERROR;
+}
+
+/* Write the modified blocks and the header of FILTER to FS's filter file.
+   The header goes last, so an interrupted write leaves a superset of
+   the previous filter. */
+static svn_error_t *
+write_filter_blocks(rep_cache_filter_t *filter,
+                    svn_fs_t *fs,
+                    apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  apr_off_t offset;
+  apr_size_t i;
+  apr_size_t block_count = filter->size / FILTER_BLOCK_SIZE;
+
+  SVN_ERR(svn_io_file_open(&file,
+                           path_rep_cache_filter(fs->path, scratch_pool),
+                           APR_WRITE, APR_OS_DEFAULT, scratch_pool));
+
+  for (i = 0; i < block_count; ++i)
+    if (filter->dirty[i])
+      {
+        offset = FILTER_HEADER_SIZE + i * FILTER_BLOCK_SIZE;
+        SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+        SVN_ERR(svn_io_file_write_full(file, filter->data + offset,
+                                       FILTER_BLOCK_SIZE, NULL,
+                                       scratch_pool));
+      }
+
+  encode_filter_header(filter);
+  offset = 0;
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, filter->data, FILTER_HEADER_SIZE,
+                                 NULL, scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+/* Replace the shared filter in FFSD by FILTER, unless the rep cache is
+   being updated.  Release whichever of them is no longer used.
+   To be called with FFSD's filter lock held. */
+static svn_error_t *
+install_filter(fs_fs_shared_data_t *ffsd,
+               rep_cache_filter_t *filter)
+{
+  if (ffsd->rep_cache_filter && ffsd->rep_cache_filter->updating)
+    {
+      filter_destroy(filter);
+    }
+  else
+    {
+      filter_destroy(ffsd->rep_cache_filter);
+      ffsd->rep_cache_filter = filter;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Try to answer whether the SHA1 DIGEST may be in the rep cache with the
+   shared filter in FFSD, as of the youngest revision YOUNGEST.  If that
+   is possible, set *MAY_CONTAIN and set *ANSWERED to TRUE.  If COUNT is
+   not NULL, it is the database's current insertion count, which allows
+   us to validate the filter for YOUNGEST.
+   To be called with FFSD's filter lock held. */
+static svn_error_t *
+probe_filter(svn_boolean_t *answered,
+             svn_boolean_t *may_contain,
+             fs_fs_shared_data_t *ffsd,
+             const unsigned char *digest,
+             svn_revnum_t youngest,
+             const apr_uint64_t *count)
+{
+  rep_cache_filter_t *filter = ffsd->rep_cache_filter;
+
+  *answered = FALSE;
+  if (! filter)
+    return SVN_NO_ERROR;
+
+  /* Keys added during an update are not in the database's count yet. */
+  if (filter->updating)
+    {
+      *answered = TRUE;
+      *may_contain = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  if (count && filter->data && filter->stamp == *count)
+    {
+      filter->usable = TRUE;
+      filter->checked_rev = youngest;
+    }
+
+  /* Other processes may add keys when they commit, so re-validate the
+     filter whenever we learn about new revisions.  Missing the very
+     latest keys only costs us a sharing opportunity. */
+  if (   SVN_IS_VALID_REVNUM(filter->checked_rev)
+      && filter->checked_rev == youngest)
+    {
+      *answered = TRUE;
+      *may_contain = !filter->usable || filter_may_contain(filter, digest);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *MAY_CONTAIN to FALSE if the SHA1 DIGEST is definitely not in
+   FS's rep cache.  Load or rebuild the shared filter as necessary. */
+static svn_error_t *
+check_filter(svn_boolean_t *may_contain,
+             svn_fs_t *fs,
+             const unsigned char *digest,
+             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_shared_data_t *ffsd = ffd->shared;
+  svn_revnum_t youngest = ffd->youngest_rev_cache;
+  rep_cache_filter_t *filter;
+  svn_boolean_t answered;
+  svn_boolean_t found;
+  apr_uint64_t count;
+
+  SVN_MUTEX__WITH_LOCK(ffsd->rep_cache_filter_lock,
+                       probe_filter(&answered, may_contain, ffsd, digest,
+                                    youngest, NULL));
+  if (answered)
+    return SVN_NO_ERROR;
+
+  *may_contain = TRUE;
+  SVN_ERR(read_insert_count(&found, &count, fs, scratch_pool));
+  if (! found)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(ffsd->rep_cache_filter_lock,
+                       probe_filter(&answered, may_contain, ffsd, digest,
+                                    youngest, &count));
+  if (answered)
+    return SVN_NO_ERROR;
+
+  /* Our copy is outdated.  Another process may have written a current
+     one.  If not, build it ourselves unless we might hold up commits by
+     other threads or processes. */
+  SVN_ERR(read_filter(&filter, fs, count, scratch_pool));
+  if (!filter && !ffd->has_write_lock)
+    {
+      /* Failing to publish, e.g. due to a busy database, is no reason
+         to fail the lookup. */
+      svn_error_t *err = rebuild_filter(&filter, fs, count, scratch_pool);
+      svn_error_clear(err);
+    }
+
+  /* A placeholder keeps us from retrying before the next revision. */
+  if (! filter)
+    filter = filter_create(0);
+
+  filter->usable = filter->data != NULL;
+  filter->checked_rev = youngest;
+
+  SVN_MUTEX__WITH_LOCK(ffsd->rep_cache_filter_lock,
+                       install_filter(ffsd, filter));
+  SVN_MUTEX__WITH_LOCK(ffsd->rep_cache_filter_lock,
+                       probe_filter(&answered, may_contain, ffsd, digest,
+                                    youngest, NULL));
+  if (! answered)
+    *may_contain = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark the shared filter in FFSD as being updated.  If FILTER is not
+   NULL, replace the shared filter with it before.  Start recording the
+   modified blocks if the filter has a bit array.
+   To be called with FFSD's filter lock held. */
+static svn_error_t *
+start_update(fs_fs_shared_data_t *ffsd,
+             rep_cache_filter_t *filter)
+{
+  if (filter)
+    {
+      filter_destroy(ffsd->rep_cache_filter);
+      ffsd->rep_cache_filter = filter;
+    }
+
+  filter = ffsd->rep_cache_filter;
+  filter->updating = TRUE;
+  filter->usable = FALSE;
+  filter->checked_rev = SVN_INVALID_REVNUM;
+  if (filter->data)
+    filter->dirty = apr_pcalloc(filter->pool,
+                                filter->size / FILTER_BLOCK_SIZE
+                                  * sizeof(*filter->dirty));
+
+  return SVN_NO_ERROR;
+}
+
+/* If the shared filter in FFSD covers insertion count STAMP and is not
+   overloaded, start updating it and set *STARTED.  Set *REWRITE if the
+   filter file does not match it, i.e. unless FILE_CURRENT is set and the
+   file header gives the same KEYS and SIZE.
+   To be called with FFSD's filter lock held. */
+static svn_error_t *
+try_start_update(svn_boolean_t *started,
+                 svn_boolean_t *rewrite,
+                 fs_fs_shared_data_t *ffsd,
+                 apr_uint64_t stamp,
+                 svn_boolean_t file_current,
+                 apr_uint64_t keys,
+                 apr_size_t size)
+{
+  rep_cache_filter_t *filter = ffsd->rep_cache_filter;
+
+  *started = (   filter && filter->data && filter->stamp == stamp
+              && filter->keys * FILTER_BYTES_PER_KEY <= filter->size);
+  *rewrite = (   *started
+              && !(file_current && filter->keys == keys
+                   && filter->size == size));
+  if (*started)
+    SVN_ERR(start_update(ffsd, NULL));
+
+  return SVN_NO_ERROR;
+}
+
+/* Prepare FS's rep-cache filter for adding keys, if it is current.
+   Otherwise, the keys added until end_filter_update() will not go into
+   the filter and a later lookup has to rebuild it.
+
+   The caller must hold the RESERVED lock on the rep cache database. */
+static svn_error_t *
+begin_filter_update(svn_fs_t *fs,
+                    apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_shared_data_t *ffsd = ffd->shared;
+  rep_cache_filter_t *filter = NULL;
+  apr_file_t *file;
+  svn_boolean_t found;
+  svn_boolean_t file_current;
+  svn_boolean_t started;
+  svn_boolean_t rewrite;
+  apr_uint64_t count;
+  apr_uint64_t file_stamp;
+  apr_uint64_t keys;
+  apr_size_t size;
+
+  SVN_ERR(read_insert_count(&found, &count, fs, scratch_pool));
+  if (! found)
+    {
+      SVN_ERR(svn_sqlite__exec_statements(ffd->rep_cache_db,
+                                          STMT_CREATE_FILTER_STATE));
+      SVN_ERR(read_insert_count(&found, &count, fs, scratch_pool));
+    }
+
+  SVN_ERR(open_filter_file(&file, &found, &file_stamp, &keys, &size, fs,
+                           scratch_pool));
+  if (found)
+    SVN_ERR(svn_io_file_close(file, scratch_pool));
+  file_current = found && file_stamp == count;
+
+  /* Our in-memory copy is good if it covers the whole database.  If the
+     file got lost or replaced in the meantime, simply write it anew.
+     Since we are updating, nobody else accesses FILTER's bit array. */
+  SVN_MUTEX__WITH_LOCK(ffsd->rep_cache_filter_lock,
+                       try_start_update(&started, &rewrite, ffsd, count,
+                                        file_current, keys, size));
+  if (started)
+    {
+      if (rewrite)
+        {
+          filter = ffsd->rep_cache_filter;
+          encode_filter_header(filter);
+          SVN_ERR(write_filter(filter, fs, scratch_pool));
+        }
+
+      return SVN_NO_ERROR;
+    }
+
+  if (file_current)
+    {
+      SVN_ERR(read_filter(&filter, fs, count, scratch_pool));
+    }
+  else if (count == 0)
+    {
+      /* Nothing to scan.  Start with an empty filter. */
+      filter = filter_create(FILTER_MIN_SIZE);
+      encode_filter_header(filter);
+      SVN_ERR(write_filter(filter, fs, scratch_pool));
+    }
+
+  /* Don't add to an overloaded filter.  Let it be rebuilt larger. */
+  if (filter && filter->keys * FILTER_BYTES_PER_KEY > filter->size)
+    {
+      filter_destroy(filter);
+      filter = NULL;
+    }
+
+  if (! filter)
+    filter = filter_create(0);
+
+  SVN_MUTEX__WITH_LOCK(ffsd->rep_cache_filter_lock,
+                       start_update(ffsd, filter));
+
+  return SVN_NO_ERROR;
+}
+
+/* Add the SHA1 DIGEST to FS's rep-cache filter, if we are maintaining it.
+   To be called with FFSD's filter lock held. */
+static svn_error_t *
+add_to_filter(fs_fs_shared_data_t *ffsd,
+              const unsigned char *digest)
+{
+  rep_cache_filter_t *filter = ffsd->rep_cache_filter;
+
+  if (filter && filter->dirty)
+    filter_add(filter, digest);
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark the shared filter in FFSD as no longer being updated.  If
+   DISCARD is set, drop it entirely.
+   To be called with FFSD's filter lock held. */
+static svn_error_t *
+finish_update(fs_fs_shared_data_t *ffsd,
+              svn_boolean_t discard)
+{
+  rep_cache_filter_t *filter = ffsd->rep_cache_filter;
+
+  if (filter && discard)
+    {
+      filter_destroy(filter);
+      ffsd->rep_cache_filter = NULL;
+    }
+  else if (filter)
+    {
+      filter->updating = FALSE;
+      filter->dirty = NULL;
+      filter->checked_rev = SVN_INVALID_REVNUM;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Persist the keys added to FS's rep-cache filter since
+   begin_filter_update().  The caller must still hold the RESERVED lock
+   on the rep cache database. */
+static svn_error_t *
+end_filter_update(svn_fs_t *fs,
+                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_shared_data_t *ffsd = ffd->shared;
+  rep_cache_filter_t *filter = ffsd->rep_cache_filter;
+  svn_boolean_t found;
+  apr_uint64_t count;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  /* While we are updating, nobody else replaces or modifies FILTER. */
+  if (filter->dirty)
+    {
+      err = read_insert_count(&found, &count, fs, scratch_pool);
+      if (!err && !found)
+        err = svn_error_create(SVN_ERR_ASSERTION_FAIL, NULL, NULL);
+
+      if (!err)
+        {
+          filter->stamp = count;
+          err = write_filter_blocks(filter, fs, scratch_pool);
+        }
+    }
+
+  SVN_MUTEX__WITH_LOCK(ffsd->rep_cache_filter_lock,
+                       svn_error_compose_create(
+                         finish_update(ffsd, err != SVN_NO_ERROR), err));
+
+  return SVN_NO_ERROR;
+}
+
+/* Drop FS's rep-cache filter after a failed update of the rep cache.
+   Its file might not match the database anymore. */
+static void
+discard_filter(svn_fs_t *fs,
+               apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_shared_data_t *ffsd = ffd->shared;
+  svn_error_t *err;
+
+  /* There is nothing else we could do about errors at this point. */
+  err = svn_mutex__lock(ffsd->rep_cache_filter_lock);
+  if (!err)
+    err = svn_mutex__unlock(ffsd->rep_cache_filter_lock,
+                            finish_update(ffsd, TRUE));
+  svn_error_clear(err);
+
+  svn_error_clear(svn_io_remove_file2(path_rep_cache_filter(fs->path,
+                                                            scratch_pool),
+                                      TRUE, scratch_pool));
+}
+
+
+/** Deferred rep-cache entries.
+ *
+ * With SVN_FS_CONFIG_FSFS_REP_CACHE_BATCH set, commits don't write their
+ * rep-cache entries right away.  Instead, we collect them here until
+ * enough revisions have accumulated and then write them in a single
+ * database transaction.  Lookups check these entries first.
+ *
+ * Losing deferred entries, e.g. due to a crash, only costs sharing
+ * opportunities; the rep cache is never required to be complete.
+ **/
+
+typedef struct rep_cache_pending_t
+{
+  /* Pool for REPS and HASH.  Cleared after each flush. */
+  apr_pool_t *pool;
+
+  /* Used for flushing when the svn_fs_t gets closed. */
+  apr_pool_t *scratch_pool;
+
+  /* The deferred entries as representation_t * in commit order. */
+  apr_array_header_t *reps;
+
+  /* The same entries keyed by their SHA1 digest. */
+  apr_hash_t *hash;
+
+  /* Number of revisions that contributed to REPS. */
+  int revisions;
+} rep_cache_pending_t;
+
+/* Forget all entries in PENDING. */
+static void
+reset_pending(rep_cache_pending_t *pending)
+{
+  svn_pool_clear(pending->pool);
+  pending->reps = apr_array_make(pending->pool, 16,
+                                 sizeof(representation_t *));
+  pending->hash = apr_hash_make(pending->pool);
+  pending->revisions = 0;
+}
+
+/* Pool pre-cleanup writing the deferred rep-cache entries of the
+   svn_fs_t in BATON.  This runs before the pool's children and the
+   database connection get cleaned up. */
+static apr_status_t
+flush_pending_on_close(void *baton)
+{
+  svn_fs_t *fs = baton;
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  /* There is nobody to report errors to at this point. */
+  svn_error_clear(svn_fs_fs__flush_rep_references(
+                    fs, ffd->rep_cache_pending->scratch_pool));
+
+  return APR_SUCCESS;
+}
+
+
 /** Library-private API's. **/
 
 /* Body of svn_fs_fs__open_rep_cache().
@@ -186,6 +1109,9 @@ svn_fs_fs__walk_rep_reference(svn_fs_t *fs,
   if (! ffd->rep_cache_db)
     SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
 
+  /* Make the walk cover deferred entries as well. */
+  SVN_ERR(svn_fs_fs__flush_rep_references(fs, pool));
+
   /* Check global invariants. */
   if (start == 0)
     {
@@ -270,6 +1196,8 @@ svn_fs_fs__get_rep_reference(representation_t **rep_p,
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
   representation_t *rep;
+  svn_boolean_t may_contain;
+  svn_error_t *err;
 
   SVN_ERR_ASSERT(ffd->rep_sharing_allowed);
   if (! ffd->rep_cache_db)
@@ -281,6 +1209,33 @@ svn_fs_fs__get_rep_reference(representation_t **rep_p,
                             _("Only SHA1 checksums can be used as keys in the "
                               "rep_cache table.\n"));
 
+  /* Entries deferred by previous commits are not in the database yet. */
+  if (ffd->rep_cache_pending)
+    {
+      rep = apr_hash_get(ffd->rep_cache_pending->hash, checksum->digest,
+                         APR_SHA1_DIGESTSIZE);
+      if (rep)
+        {
+          *rep_p = svn_fs_fs__rep_copy(rep, pool);
+          return SVN_NO_ERROR;
+        }
+    }
+
+  /* Most lookups miss.  Answer those without querying the database.
+     If the filter is not available, simply fall back to the database. */
+  err = check_filter(&may_contain, fs, checksum->digest, pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      may_contain = TRUE;
+    }
+
+  if (! may_contain)
+    {
+      *rep_p = NULL;
+      return SVN_NO_ERROR;
+    }
+
   SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db, STMT_GET_REP));
   SVN_ERR(svn_sqlite__bindf(stmt, "s",
                             svn_checksum_to_cstring(checksum, pool)));
@@ -304,8 +1259,6 @@ svn_fs_fs__get_rep_reference(representation_t **rep_p,
 
   if (rep)
     {
-      svn_error_t *err;
-
       SVN_ERR(svn_fs_fs__fixup_expanded_size(fs, rep, pool));
 
       /* Check that REP refers to a revision that exists in FS. */
@@ -352,6 +1305,10 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
                             (apr_int64_t) rep->expanded_size));
 
   err = svn_sqlite__insert(NULL, stmt);
+  if (!err)
+    SVN_MUTEX__WITH_LOCK(ffd->shared->rep_cache_filter_lock,
+                         add_to_filter(ffd->shared, rep->sha1_digest));
+
   if (err)
     {
       representation_t *old_rep;
@@ -377,6 +1334,343 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Insert the REP_BATCH_SIZE representations starting at index FIRST in
+   REPS into FS's rep cache, using a single statement.  Add them to the
+   rep-cache filter as well.  If any of them is already present, insert
+   them one by one using svn_fs_fs__set_rep_reference(), so existing
+   entries get treated exactly as for single rows.
+   Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+set_rep_batch(svn_fs_t *fs,
+              const apr_array_header_t *reps,
+              int first,
+              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_sqlite__stmt_t *stmt;
+  svn_error_t *err;
+  int i;
+
+  /* We only allow SHA1 checksums in this table. */
+  for (i = first; i < first + REP_BATCH_SIZE; i++)
+    if (! APR_ARRAY_IDX(reps, i, representation_t *)->has_sha1)
+      return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL,
+                              _("Only SHA1 checksums can be used as keys in "
+                                "the rep_cache table.\n"));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                    STMT_SET_REP_BATCH));
+  for (i = 0; i < REP_BATCH_SIZE; i++)
+    {
+      representation_t *rep = APR_ARRAY_IDX(reps, first + i,
+                                            representation_t *);
+      svn_checksum_t checksum;
+      int slot = 5 * i + 1;
+
+      checksum.kind = svn_checksum_sha1;
+      checksum.digest = rep->sha1_digest;
+
+      SVN_ERR(svn_sqlite__bind_text(stmt, slot,
+                                    svn_checksum_to_cstring(&checksum,
+                                                            scratch_pool)));
+      SVN_ERR(svn_sqlite__bind_revnum(stmt, slot + 1, rep->revision));
+      SVN_ERR(svn_sqlite__bind_int64(stmt, slot + 2, rep->item_index));
+      SVN_ERR(svn_sqlite__bind_int64(stmt, slot + 3, rep->size));
+      SVN_ERR(svn_sqlite__bind_int64(stmt, slot + 4, rep->expanded_size));
+    }
+
+  /* A constraint violation backs out all rows of the statement. */
+  err = svn_sqlite__insert(NULL, stmt);
+  if (err && err->apr_err == SVN_ERR_SQLITE_CONSTRAINT)
+    {
+      apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+      svn_error_clear(err);
+      for (i = first; i < first + REP_BATCH_SIZE; i++)
+        {
+          representation_t *rep = APR_ARRAY_IDX(reps, i,
+                                                representation_t *);
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(svn_fs_fs__set_rep_reference(fs, rep, iterpool));
+        }
+      svn_pool_destroy(iterpool);
+
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(err);
+  for (i = first; i < first + REP_BATCH_SIZE; i++)
+    SVN_MUTEX__WITH_LOCK(ffd->shared->rep_cache_filter_lock,
+                         add_to_filter(ffd->shared,
+                                       APR_ARRAY_IDX(reps, i,
+                                                     representation_t *)
+                                         ->sha1_digest));
+
+  return SVN_NO_ERROR;
+}
+
+/* Insert REPS into FS's rep cache.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+insert_rep_references(svn_fs_t *fs,
+                      const apr_array_header_t *reps,
+                      apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  /* Insert full batches with multi-row statements and the remainder
+     one by one. */
+  for (i = 0; i + REP_BATCH_SIZE <= reps->nelts; i += REP_BATCH_SIZE)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(set_rep_batch(fs, reps, i, iterpool));
+    }
+
+  for (; i < reps->nelts; i++)
+    {
+      representation_t *rep = APR_ARRAY_IDX(reps, i, representation_t *);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__set_rep_reference(fs, rep, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__set_rep_references(svn_fs_t *fs,
+                              const apr_array_header_t *reps,
+                              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
+
+  if (reps->nelts == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR_ASSERT(ffd->rep_sharing_allowed);
+  if (! ffd->rep_cache_db)
+    SVN_ERR(svn_fs_fs__open_rep_cache(fs, scratch_pool));
+
+  err = begin_filter_update(fs, scratch_pool);
+  if (!err)
+    err = insert_rep_references(fs, reps, scratch_pool);
+  if (!err)
+    err = end_filter_update(fs, scratch_pool);
+
+  if (err)
+    discard_filter(fs, scratch_pool);
+
+  return svn_error_trace(err);
+}
+
+svn_error_t *
+svn_fs_fs__write_rep_references(svn_fs_t *fs,
+                                const apr_array_header_t *reps,
+                                apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
+
+  SVN_ERR(svn_fs_fs__open_rep_cache(fs, scratch_pool));
+
+  /* We use an sqlite transaction to speed things up;
+   * see <http://www.sqlite.org/faq.html#q19>.
+   * Take the RESERVED lock right away because we need it to update
+   * the rep-cache filter consistently with the database.
+   */
+  SVN_ERR(svn_sqlite__begin_immediate_transaction(ffd->rep_cache_db));
+  err = svn_fs_fs__set_rep_references(fs, reps, scratch_pool);
+  err = svn_sqlite__finish_transaction(ffd->rep_cache_db, err);
+
+  /* A rolled back transaction leaves the filter file ahead of the
+     database. */
+  if (err)
+    discard_filter(fs, scratch_pool);
+
+  if (svn_error_find_cause(err, SVN_ERR_SQLITE_ROLLBACK_FAILED))
+    {
+      /* Failed rollback means that our db connection is unusable, and
+         the only thing we can do is close it.  The connection will be
+         reopened during the next operation with rep-cache.db. */
+      return svn_error_trace(
+          svn_error_compose_create(err,
+                                   svn_fs_fs__close_rep_cache(fs)));
+    }
+
+  return svn_error_trace(err);
+}
+
+svn_error_t *
+svn_fs_fs__defer_rep_references(svn_fs_t *fs,
+                                const apr_array_header_t *reps,
+                                apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  rep_cache_pending_t *pending = ffd->rep_cache_pending;
+  int i;
+
+  if (! pending)
+    {
+      pending = apr_pcalloc(fs->pool, sizeof(*pending));
+      pending->pool = svn_pool_create(fs->pool);
+      pending->scratch_pool = svn_pool_create(fs->pool);
+      reset_pending(pending);
+
+      ffd->rep_cache_pending = pending;
+      apr_pool_pre_cleanup_register(fs->pool, fs, flush_pending_on_close);
+    }
+
+  for (i = 0; i < reps->nelts; i++)
+    {
+      representation_t *rep
+        = svn_fs_fs__rep_copy(APR_ARRAY_IDX(reps, i, representation_t *),
+                              pending->pool);
+
+      APR_ARRAY_PUSH(pending->reps, representation_t *) = rep;
+      apr_hash_set(pending->hash, rep->sha1_digest, APR_SHA1_DIGESTSIZE,
+                   rep);
+    }
+
+  if (++pending->revisions >= ffd->rep_cache_batch)
+    SVN_ERR(svn_fs_fs__flush_rep_references(fs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__flush_rep_references(svn_fs_t *fs,
+                                apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  rep_cache_pending_t *pending = ffd->rep_cache_pending;
+  svn_error_t *err;
+
+  if (! pending || pending->reps->nelts == 0)
+    return SVN_NO_ERROR;
+
+  /* Don't retry failed entries.  They would most likely fail again. */
+  err = svn_fs_fs__write_rep_references(fs, pending->reps, scratch_pool);
+  reset_pending(pending);
+
+  return svn_error_trace(err);
+}
+
+svn_error_t *
+svn_fs_fs__build_rep_cache(svn_fs_t *fs,
+                           svn_revnum_t start_rev,
+                           svn_revnum_t end_rev,
+                           svn_fs_progress_notify_func_t progress_func,
+                           void *progress_baton,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_pool_t *iterpool;
+  apr_pool_t *batch_pool;
+  apr_array_header_t *reps;
+  svn_revnum_t youngest;
+  svn_revnum_t batch_start;
+  svn_revnum_t rev;
+
+  if (ffd->format < SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    return svn_error_createf(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                             _("FSFS format (%d) too old for rep-sharing; "
+                               "please upgrade the filesystem."),
+                             ffd->format);
+
+  if (! ffd->rep_sharing_allowed)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Filesystem does not allow rep-sharing."));
+
+  SVN_ERR(svn_fs_fs__youngest_rev(&youngest, fs, pool));
+  if (! SVN_IS_VALID_REVNUM(start_rev))
+    start_rev = 0;
+  if (! SVN_IS_VALID_REVNUM(end_rev))
+    end_rev = youngest;
+
+  SVN_ERR(svn_fs_fs__ensure_revision_exists(end_rev, fs, pool));
+  if (start_rev > end_rev)
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Invalid revision range r%ld:%ld"),
+                             start_rev, end_rev);
+
+  /* Keep the database in commit order. */
+  SVN_ERR(svn_fs_fs__flush_rep_references(fs, pool));
+
+  iterpool = svn_pool_create(pool);
+  batch_pool = svn_pool_create(pool);
+  reps = apr_array_make(batch_pool, 16, sizeof(representation_t *));
+  batch_start = start_rev;
+
+  for (rev = start_rev; rev <= end_rev; ++rev)
+    {
+      svn_fs_fs__changes_context_t *context;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      /* All reps that REV added belong to nodes changed in REV. */
+      SVN_ERR(svn_fs_fs__create_changes_context(&context, fs, rev,
+                                                iterpool));
+      while (! context->eol)
+        {
+          apr_array_header_t *changes;
+          int i;
+
+          SVN_ERR(svn_fs_fs__get_changes(&changes, context, iterpool,
+                                         iterpool));
+          for (i = 0; i < changes->nelts; ++i)
+            {
+              change_t *change = APR_ARRAY_IDX(changes, i, change_t *);
+              node_revision_t *noderev;
+
+              if (   change->info.change_kind == svn_fs_path_change_delete
+                  || change->info.node_rev_id == NULL)
+                continue;
+
+              SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs,
+                                                   change->info.node_rev_id,
+                                                   iterpool, iterpool));
+
+              /* The same reps that commits add, see write_final_rev(). */
+              if (   noderev->kind == svn_node_file && noderev->data_rep
+                  && noderev->data_rep->revision == rev
+                  && noderev->data_rep->has_sha1)
+                APR_ARRAY_PUSH(reps, representation_t *)
+                  = svn_fs_fs__rep_copy(noderev->data_rep, batch_pool);
+
+              if (   noderev->prop_rep && noderev->prop_rep->revision == rev
+                  && noderev->prop_rep->has_sha1)
+                APR_ARRAY_PUSH(reps, representation_t *)
+                  = svn_fs_fs__rep_copy(noderev->prop_rep, batch_pool);
+            }
+        }
+
+      /* Write many revisions per database transaction. */
+      if (reps->nelts >= BUILD_BATCH_SIZE || rev == end_rev)
+        {
+          SVN_ERR(svn_fs_fs__write_rep_references(fs, reps, iterpool));
+
+          if (progress_func)
+            for (; batch_start <= rev; ++batch_start)
+              progress_func(batch_start, progress_baton, iterpool);
+
+          svn_pool_clear(batch_pool);
+          reps = apr_array_make(batch_pool, 16, sizeof(representation_t *));
+          batch_start = rev + 1;
+        }
+    }
+
+  svn_pool_destroy(batch_pool);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
 
 svn_error_t *
 svn_fs_fs__del_rep_reference(svn_fs_t *fs,
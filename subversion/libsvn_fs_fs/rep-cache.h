@@ -33,6 +33,7 @@ extern "C" {
 
 
 #define REP_CACHE_DB_NAME        "rep-cache.db"
+#define REP_CACHE_FILTER_NAME    "rep-cache.filter"
 
 /* Open and create, if needed, the rep cache database associated with FS.
    Use POOL for temporary allocations. */
@@ -83,6 +84,58 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
                              representation_t *rep,
                              apr_pool_t *pool);
 
+/* Set the representations in REPS, an array of representation_t *,
+   in FS and add them to the rep-cache filter, if that is current.
+   Otherwise, a later lookup will rebuild the filter.
+
+   This must be called within a transaction on the rep cache database
+   that holds a RESERVED lock, e.g. one started by
+   svn_sqlite__begin_immediate_transaction().
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__set_rep_references(svn_fs_t *fs,
+                              const apr_array_header_t *reps,
+                              apr_pool_t *scratch_pool);
+
+/* Like svn_fs_fs__set_rep_references() but take care of the database
+   transaction as well. */
+svn_error_t *
+svn_fs_fs__write_rep_references(svn_fs_t *fs,
+                                const apr_array_header_t *reps,
+                                apr_pool_t *scratch_pool);
+
+/* Remember the representations in REPS, an array of representation_t *
+   added by one revision, to be written to FS's rep cache later.  Write
+   all remembered entries once the configured number of revisions has
+   been reached.  Until then, lookups will find them nonetheless.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__defer_rep_references(svn_fs_t *fs,
+                                const apr_array_header_t *reps,
+                                apr_pool_t *scratch_pool);
+
+/* Write all entries remembered by svn_fs_fs__defer_rep_references() to
+   FS's rep cache.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__flush_rep_references(svn_fs_t *fs,
+                                apr_pool_t *scratch_pool);
+
+/* Add the representations created in revisions START_REV through END_REV
+   of FS to its rep cache, skipping existing entries.  Invalid revision
+   numbers default to 0 and HEAD, respectively.  Write entries for many
+   revisions in a single database transaction and call PROGRESS_FUNC with
+   PROGRESS_BATON for each revision once its entries have been written.
+   Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__build_rep_cache(svn_fs_t *fs,
+                           svn_revnum_t start_rev,
+                           svn_revnum_t end_rev,
+                           svn_fs_progress_notify_func_t progress_func,
+                           void *progress_baton,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *pool);
+
 /* Delete from the cache all reps corresponding to revisions younger
    than YOUNGEST. */
 svn_error_t *
@@ -20,6 +20,8 @@
  * ====================================================================
  */
 
+#include <apr_mmap.h>
+
 #include "rev_file.h"
 #include "fs_fs.h"
 #include "index.h"
@@ -28,6 +30,8 @@
 
 #include "../libsvn_fs/fs-loader.h"
 
+#include "svn_sorts.h"
+
 #include "private/svn_io_private.h"
 #include "svn_private_config.h"
 
@@ -46,6 +50,9 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
 
   file->file = NULL;
   file->stream = NULL;
+  file->mapped = NULL;
+  file->mapped_size = 0;
+  file->mapped_pos = 0;
   file->p2l_stream = NULL;
   file->l2p_stream = NULL;
   file->block_size = ffd->block_size;
@@ -120,6 +127,97 @@ auto_make_writable(const char *path,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_MMAP
+
+/* Implements svn_read_fn_t for streams reading from the mapped revision
+ * file given as BATON. */
+static svn_error_t *
+mapped_read(void *baton,
+            char *buffer,
+            apr_size_t *len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  apr_off_t left = file->mapped_size - file->mapped_pos;
+
+  if (left < (apr_off_t)*len)
+    *len = left > 0 ? (apr_size_t)left : 0;
+
+  memcpy(buffer, file->mapped + file->mapped_pos, *len);
+  file->mapped_pos += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_skip_fn_t for streams reading from the mapped
+ * revision file given as BATON. */
+static svn_error_t *
+mapped_skip(void *baton,
+            apr_size_t len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  apr_off_t left = file->mapped_size - file->mapped_pos;
+
+  file->mapped_pos += MIN((apr_off_t)len, MAX(left, 0));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_data_available_fn_t for streams reading from the
+ * mapped revision file given as BATON. */
+static svn_error_t *
+mapped_data_available(void *baton,
+                      svn_boolean_t *data_available)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  *data_available = file->mapped_pos < file->mapped_size;
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+/* If FS has been configured to do so, map the pack file FILE into memory
+ * and let FILE->STREAM read from that mapping.  If the file cannot be
+ * mapped, e.g. due to a lack of address space, silently keep using plain
+ * file access.  Allocate the mapping in RESULT_POOL and use SCRATCH_POOL
+ * for temporaries. */
+static svn_error_t *
+auto_map_file(svn_fs_fs__revision_file_t *file,
+              svn_fs_t *fs,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+#if APR_HAS_MMAP
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_filesize_t size;
+  apr_mmap_t *mmap;
+  svn_stream_t *stream;
+
+  if (!ffd->mmap_pack_files || !file->is_packed)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_io_file_size_get(&size, file->file, scratch_pool));
+  if (size <= 0 || (apr_uint64_t)size > APR_SIZE_MAX)
+    return SVN_NO_ERROR;
+
+  if (apr_mmap_create(&mmap, file->file, 0, (apr_size_t)size,
+                      APR_MMAP_READ, result_pool))
+    return SVN_NO_ERROR;
+
+  file->mapped = mmap->mm;
+  file->mapped_size = (apr_off_t)size;
+  file->mapped_pos = 0;
+
+  stream = svn_stream_create(file, result_pool);
+  svn_stream_set_read2(stream, mapped_read, mapped_read);
+  svn_stream_set_skip(stream, mapped_skip);
+  svn_stream_set_data_available(stream, mapped_data_available);
+  file->stream = stream;
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 /* Core implementation of svn_fs_fs__open_pack_or_rev_file working on an
  * existing, initialized FILE structure.  If WRITABLE is TRUE, give write
  * access to the file - temporarily resetting the r/o state if necessary.
@@ -160,6 +258,10 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
                                                   result_pool);
           file->is_packed = svn_fs_fs__is_packed_rev(fs, rev);
 
+          /* Files that we may modify must not be mapped. */
+          if (!writable)
+            SVN_ERR(auto_map_file(file, fs, result_pool, scratch_pool));
+
           return SVN_NO_ERROR;
         }
 
@@ -274,6 +376,7 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   apr_file_t *apr_file;
   SVN_ERR(svn_io_file_open(&apr_file,
                            svn_fs_fs__path_txn_proto_rev(fs, txn_id,
@@ -286,10 +389,89 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
   (*file)->is_packed = FALSE;
   (*file)->start_revision = SVN_INVALID_REVNUM;
   (*file)->stream = svn_stream_from_aprfile2(apr_file, TRUE, result_pool);
+  (*file)->block_size = ffd->block_size;
+  (*file)->l2p_offset = -1;
+  (*file)->p2l_offset = -1;
+  (*file)->footer_offset = -1;
+  (*file)->pool = result_pool;
 
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset)
+{
+  if (file->mapped)
+    {
+      if (buffer_start)
+        *buffer_start = file->block_size
+                      ? offset - (offset % file->block_size)
+                      : offset;
+
+      file->mapped_pos = offset;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_aligned_seek(file->file,
+                                                  file->block_size,
+                                                  buffer_start, offset,
+                                                  file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file)
+{
+  if (file->mapped)
+    {
+      *offset = file->mapped_pos;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_get_offset(offset, file->file,
+                                                file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buf,
+                         apr_size_t nbytes)
+{
+  if (file->mapped)
+    {
+      const char *data = svn_fs_fs__rev_file_data(file, file->mapped_pos,
+                                                  nbytes);
+      if (data == NULL)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Unexpected end of pack file"));
+
+      memcpy(buf, data, nbytes);
+      file->mapped_pos += nbytes;
+
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_read_full2(file->file, buf, nbytes,
+                                                NULL, NULL, file->pool));
+}
+
+const char *
+svn_fs_fs__rev_file_data(svn_fs_fs__revision_file_t *file,
+                         apr_off_t offset,
+                         apr_off_t len)
+{
+  if (   file->mapped == NULL
+      || offset < 0
+      || len < 0
+      || offset > file->mapped_size
+      || len > file->mapped_size - offset)
+    return NULL;
+
+  return file->mapped + offset;
+}
+
 svn_error_t *
 svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 {
@@ -298,8 +480,13 @@ svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
   if (file->file)
     SVN_ERR(svn_io_file_close(file->file, file->pool));
 
+  /* The mapping itself, if any, remains valid until FILE->POOL gets
+   * cleaned up because callers may still reference data within it. */
   file->file = NULL;
   file->stream = NULL;
+  file->mapped = NULL;
+  file->mapped_size = 0;
+  file->mapped_pos = 0;
   file->l2p_stream = NULL;
   file->p2l_stream = NULL;
 
@@ -57,6 +57,18 @@ typedef struct svn_fs_fs__revision_file_t
   /* stream based on FILE and not NULL exactly when FILE is not NULL */
   svn_stream_t *stream;
 
+  /* If not NULL, the contents of FILE mapped into memory.  This is only
+   * being used for pack files and only if enabled in fsfs.conf.  STREAM
+   * and the svn_fs_fs__rev_file_* functions will then access the data
+   * in memory and not use the file pointer of FILE. */
+  const char *mapped;
+
+  /* Number of bytes in MAPPED.  0 if MAPPED is NULL. */
+  apr_off_t mapped_size;
+
+  /* Current read position within MAPPED. */
+  apr_off_t mapped_pos;
+
   /* the opened P2L index stream or NULL.  Always NULL for txns. */
   svn_fs_fs__packed_number_stream_t *p2l_stream;
 
@@ -128,6 +140,40 @@ svn_fs_fs__open_pack_or_rev_file_writable(svn_fs_fs__revision_file_t **file,
 svn_error_t *
 svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file);
 
+/* Set the read position of FILE to OFFSET.  Unless FILE has been mapped
+ * into memory, this is a svn_io_file_aligned_seek with FILE's block size.
+ * If BUFFER_START is not NULL, return the start of the block containing
+ * OFFSET in *BUFFER_START.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset);
+
+/* Set *OFFSET to the current read position of FILE.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file);
+
+/* Read exactly NBYTES from the current read position of FILE into BUF.
+ * Return an error if FILE ends before that.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buf,
+                         apr_size_t nbytes);
+
+/* If FILE has been mapped into memory and contains the LEN bytes starting
+ * at OFFSET, return a pointer to them.  Return NULL otherwise.  The read
+ * position of FILE is not changed.  The data remains valid until FILE's
+ * pool gets cleaned up, even if FILE gets closed before that.
+ */
+const char *
+svn_fs_fs__rev_file_data(svn_fs_fs__revision_file_t *file,
+                         apr_off_t offset,
+                         apr_off_t len);
+
 /* Open the proto-rev file of transaction TXN_ID in FS and return it in *FILE.
  * Allocate *FILE in RESULT_POOL use and SCRATCH_POOL for temporaries.. */
 svn_error_t *
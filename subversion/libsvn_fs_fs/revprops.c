@@ -730,6 +730,38 @@ svn_fs_fs__get_revision_props_size(apr_off_t *props_size_p,
   return SVN_NO_ERROR;
 }
 
+/* Set *PROPERTIES to the revprops of revision REV in FS, if they are in
+ * FS's revprop cache.  Otherwise, set it to NULL.  Make sure to call
+ * prepare_revprop_cache() before.
+ *
+ * Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+get_cached_revprops(apr_hash_t **properties,
+                    svn_fs_t *fs,
+                    svn_revnum_t rev,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_boolean_t is_cached;
+  pair_cache_key_t key;
+
+  key.revision = rev;
+  key.second = ffd->revprop_prefix;
+
+  /* The only way that this might error out is due to parser error. */
+  SVN_ERR_W(svn_cache__get((void **) properties, &is_cached,
+                           ffd->revprop_cache, &key, result_pool),
+            apr_psprintf(scratch_pool,
+                         "Failed to parse revprops for r%ld.",
+                         rev));
+  if (!is_cached)
+    *properties = NULL;
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the revprops for revision REV in FS and return them in *PROPERTIES_P.
  *
  * Allocations will be done in POOL.
@@ -763,21 +795,10 @@ svn_fs_fs__get_revision_proplist(apr_hash_t **proplist_p,
   else
     {
       /* Try cache lookup first. */
-      svn_boolean_t is_cached;
-      pair_cache_key_t key;
-
-      /* Auto-alloc prefix and construct the key. */
       SVN_ERR(prepare_revprop_cache(fs, scratch_pool));
-      key.revision = rev;
-      key.second = ffd->revprop_prefix;
-
-      /* The only way that this might error out is due to parser error. */
-      SVN_ERR_W(svn_cache__get((void **) proplist_p, &is_cached,
-                               ffd->revprop_cache, &key, result_pool),
-                apr_psprintf(scratch_pool,
-                             "Failed to parse revprops for r%ld.",
-                             rev));
-      if (is_cached)
+      SVN_ERR(get_cached_revprops(proplist_p, fs, rev, result_pool,
+                                  scratch_pool));
+      if (*proplist_p)
         return SVN_NO_ERROR;
     }
 
@@ -819,6 +840,135 @@ svn_fs_fs__get_revision_proplist(apr_hash_t **proplist_p,
   return SVN_NO_ERROR;
 }
 
+/* Report the revprops of all revisions in LOWER to UPPER that are stored
+ * in the same revprop pack file as REV in FS to RECEIVER with
+ * RECEIVER_BATON.  Report them in ascending order if ASCENDING is set and
+ * in descending order otherwise.  Return the next revision to process
+ * after that in *NEXT_REV.  Parse only those revprops that are not in the
+ * revprop cache yet and add them to it.
+ *
+ * Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+report_packed_revprops(svn_revnum_t *next_rev,
+                       svn_fs_t *fs,
+                       svn_revnum_t rev,
+                       svn_revnum_t lower,
+                       svn_revnum_t upper,
+                       svn_boolean_t ascending,
+                       svn_fs_revision_proplist_receiver_t receiver,
+                       void *receiver_baton,
+                       apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  packed_revprops_t *revprops;
+  svn_revnum_t first, last, i;
+
+  /* Read the whole pack file once and determine the overlap with
+   * LOWER ... UPPER.  It will at least contain REV. */
+  SVN_ERR(read_pack_revprop(&revprops, fs, rev, TRUE /*read_all*/,
+                            FALSE /*populate_cache*/, scratch_pool));
+  first = MAX(lower, revprops->start_revision);
+  last = MIN(upper, revprops->start_revision + revprops->sizes->nelts - 1);
+
+  /* Report them in the order requested. */
+  for (i = 0; i <= last - first; ++i)
+    {
+      svn_revnum_t revision = ascending ? first + i : last - i;
+      apr_hash_t *proplist;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(get_cached_revprops(&proplist, fs, revision, iterpool,
+                                  iterpool));
+      if (!proplist)
+        {
+          int idx = (int)(revision - revprops->start_revision);
+          svn_string_t serialized;
+
+          serialized.data = revprops->packed_revprops->data
+                          + APR_ARRAY_IDX(revprops->offsets, idx,
+                                          apr_size_t);
+          serialized.len = APR_ARRAY_IDX(revprops->sizes, idx, apr_size_t);
+
+          SVN_ERR(parse_revprop(&proplist, fs, revision, &serialized,
+                                iterpool, iterpool));
+          SVN_ERR(cache_revprops(NULL, fs, revision, &serialized,
+                                 iterpool));
+        }
+
+      SVN_ERR(receiver(receiver_baton, revision, proplist, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  *next_rev = ascending ? last + 1 : first - 1;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__get_revision_proplists(svn_fs_t *fs,
+                                  svn_revnum_t start,
+                                  svn_revnum_t end,
+                                  svn_boolean_t refresh,
+                                  svn_fs_revision_proplist_receiver_t receiver,
+                                  void *receiver_baton,
+                                  svn_cancel_func_t cancel_func,
+                                  void *cancel_baton,
+                                  apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_boolean_t ascending = start <= end;
+  svn_revnum_t lower = ascending ? start : end;
+  svn_revnum_t upper = ascending ? end : start;
+  svn_revnum_t rev = start;
+
+  /* should they be available at all? */
+  SVN_ERR(svn_fs_fs__ensure_revision_exists(upper, fs, scratch_pool));
+
+  /* Act as a read barrier only once, at the start. */
+  if (refresh)
+    svn_fs_fs__reset_revprop_cache(fs);
+  SVN_ERR(prepare_revprop_cache(fs, scratch_pool));
+
+  while (lower <= rev && rev <= upper)
+    {
+      apr_hash_t *proplist;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      /* Revprops that we already have don't require reading any file. */
+      SVN_ERR(get_cached_revprops(&proplist, fs, rev, iterpool, iterpool));
+      if (proplist)
+        {
+          SVN_ERR(receiver(receiver_baton, rev, proplist, iterpool));
+          rev += ascending ? 1 : -1;
+        }
+      else if (svn_fs_fs__is_packed_revprop(fs, rev))
+        {
+          /* Everything within the same pack file in one go. */
+          SVN_ERR(report_packed_revprops(&rev, fs, rev, lower, upper,
+                                         ascending, receiver, receiver_baton,
+                                         iterpool));
+        }
+      else
+        {
+          /* Non-packed revprops, or REV got packed just now.  The latter
+           * case is handled transparently by this call. */
+          SVN_ERR(svn_fs_fs__get_revision_proplist(&proplist, fs, rev, FALSE,
+                                                   iterpool, iterpool));
+          SVN_ERR(receiver(receiver_baton, rev, proplist, iterpool));
+
+          rev += ascending ? 1 : -1;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Serialize the revision property list PROPLIST of revision REV in
  * filesystem FS to a non-packed file.  Return the name of that temporary
  * file in *TMP_PATH and the file path that it must be moved to in
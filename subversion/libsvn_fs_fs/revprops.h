@@ -85,6 +85,22 @@ svn_fs_fs__get_revision_proplist(apr_hash_t **proplist_p,
                                  apr_pool_t *result_pool,
                                  apr_pool_t *scratch_pool);
 
+/* Implements the svn_fs_revision_proplists() API for FSFS.
+ *
+ * Each revprop pack file will be read and parsed only once.  All revprops
+ * read will also be added to the revprop cache.
+ */
+svn_error_t *
+svn_fs_fs__get_revision_proplists(svn_fs_t *fs,
+                                  svn_revnum_t start,
+                                  svn_revnum_t end,
+                                  svn_boolean_t refresh,
+                                  svn_fs_revision_proplist_receiver_t receiver,
+                                  void *receiver_baton,
+                                  svn_cancel_func_t cancel_func,
+                                  void *cancel_baton,
+                                  apr_pool_t *scratch_pool);
+
 /* Set the revision property list of revision REV in filesystem FS to
    PROPLIST.  Use POOL for temporary allocations. */
 svn_error_t *
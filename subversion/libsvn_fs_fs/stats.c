@@ -28,6 +28,7 @@
 #include "private/svn_cache.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_string_private.h"
+#include "private/svn_task.h"
 
 #include "index.h"
 #include "pack.h"
@@ -164,6 +165,28 @@ typedef struct revision_info_t
   svn_fs_fs__revision_file_t *rev_file;
 } revision_info_t;
 
+/* A noderev found while scanning a rev / pack file.  Rev / pack files may
+ * be scanned concurrently but the references to representations have to
+ * be counted in revision order to classify the reps and to find the
+ * largest changes exactly as a single-threaded scan would. */
+typedef struct noderev_info_t
+{
+  /* Data and property representations of the noderev, NULL if there is
+   * none.  These may be place-holders for reps in other rev / pack files,
+   * in which case only the location and size fields are valid. */
+  rep_stats_t *text;
+  rep_stats_t *props;
+
+  /* Kind of the node. */
+  svn_node_kind_t kind;
+
+  /* Path the node has been created at. */
+  const char *created_path;
+
+  /* Whether the node has a predecessor. */
+  svn_boolean_t has_predecessor;
+} noderev_info_t;
+
 /* Root data structure containing all information about a given repository.
  * We use it as a wrapper around svn_fs_t and pass it around where we would
  * otherwise just use a svn_fs_t.
@@ -182,9 +205,21 @@ typedef struct query_t
   /* First non-packed revision. */
   svn_revnum_t min_unpacked_rev;
 
-  /* all revisions */
+  /* all revisions, starting at FIRST_REVISION */
   apr_array_header_t *revisions;
 
+  /* Revision number of the first entry in REVISIONS.  This is 0 for the
+   * query covering the whole repository. */
+  svn_revnum_t first_revision;
+
+  /* noderev_info_t * of all noderevs found in REVISIONS, in scan order.
+   * Only used when scanning a single rev / pack file. */
+  apr_array_header_t *noderevs;
+
+  /* rep_ref_t * of all representations found in REVISIONS.
+   * Only used when scanning a single rev / pack file. */
+  apr_array_header_t *rep_refs;
+
   /* empty representation.
    * Used as a dummy base for DELTA reps without base. */
   rep_stats_t *null_base;
@@ -372,7 +407,8 @@ compare_representation_item_index(const void *data, const void *key)
 
 /* Find the revision_info_t object to the given REVISION in QUERY and
  * return it in *REVISION_INFO. For performance reasons, we skip the
- * lookup if the info is already provided.
+ * lookup if the info is already provided.  If QUERY does not cover
+ * REVISION, set *REVISION_INFO to NULL.
  *
  * In that revision, look for the rep_stats_t object for item ITEM_INDEX.
  * If it already exists, set *IDX to its index in *REVISION_INFO's
@@ -393,7 +429,14 @@ find_representation(int *idx,
   info = revision_info ? *revision_info : NULL;
   if (info == NULL || info->revision != revision)
     {
-      info = APR_ARRAY_IDX(query->revisions, revision, revision_info_t*);
+      if (   revision < query->first_revision
+          || revision - query->first_revision >= query->revisions->nelts)
+        info = NULL;
+      else
+        info = APR_ARRAY_IDX(query->revisions,
+                             revision - query->first_revision,
+                             revision_info_t*);
+
       if (revision_info)
         *revision_info = info;
     }
@@ -420,13 +463,19 @@ find_representation(int *idx,
 }
 
 /* Find / auto-construct the representation stats for REP in QUERY and
- * return it in *REPRESENTATION.
+ * return it in *REPRESENTATION.  Set *IS_NEW if the rep has been added
+ * to QUERY by this call, i.e. if this is the first reference to it.
+ *
+ * If REP is not covered by QUERY, return a place-holder that only
+ * describes the location and size of REP.  Resolving it is left to
+ * add_noderev().
  *
  * If necessary, allocate the result in RESULT_POOL; use SCRATCH_POOL for
  * temporary allocations.
  */
 static svn_error_t *
 parse_representation(rep_stats_t **representation,
+                     svn_boolean_t *is_new,
                      query_t *query,
                      representation_t *rep,
                      revision_info_t *revision_info,
@@ -441,6 +490,7 @@ parse_representation(rep_stats_t **representation,
   /* look it up */
   result = find_representation(&idx, query, &revision_info, rep->revision,
                                rep->item_index);
+  *is_new = !result && revision_info != NULL;
   if (!result)
     {
       /* not parsed, yet (probably a rep in the same revision).
@@ -452,40 +502,48 @@ parse_representation(rep_stats_t **representation,
       result->item_index = rep->item_index;
       result->size = rep->size;
 
+      /* Reps in other rev / pack files are none of our business. */
+      if (!revision_info)
+        {
+          *representation = result;
+          return SVN_NO_ERROR;
+        }
+
       /* In phys. addressing mode, follow link to the actual representation.
        * In log. addressing mode, we will find it already as part of our
        * linear walk through the whole file. */
       if (!svn_fs_fs__use_log_addressing(query->fs))
         {
           svn_fs_fs__rep_header_t *header;
+          rep_ref_t *ref = apr_pcalloc(result_pool, sizeof(*ref));
           apr_off_t offset = revision_info->offset
                            + (apr_off_t)rep->item_index;
 
           SVN_ERR_ASSERT(revision_info->rev_file);
-          SVN_ERR(svn_io_file_seek(revision_info->rev_file->file, APR_SET,
-                                   &offset, scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_seek(revision_info->rev_file, NULL,
+                                           offset));
           SVN_ERR(svn_fs_fs__read_rep_header(&header,
                                              revision_info->rev_file->stream,
                                              scratch_pool, scratch_pool));
 
-          result->header_size = header->header_size;
+          /* The length of the delta chain will be determined once the
+           * base reps are known. */
+          ref->header_size = header->header_size;
+          ref->revision = rep->revision;
+          ref->item_index = rep->item_index;
 
-          /* Determine length of the delta chain. */
           if (header->type == svn_fs_fs__rep_delta)
             {
-              int base_idx;
-              rep_stats_t *base_rep
-                = find_representation(&base_idx, query, NULL,
-                                      header->base_revision,
-                                      header->base_item_index);
-
-              result->chain_length = 1 + MIN(base_rep->chain_length,
-                                             (apr_byte_t)0xfe);
+              ref->base_item_index = header->base_item_index;
+              ref->base_revision = header->base_revision;
             }
           else
             {
-              result->chain_length = 1;
+              ref->base_item_index = SVN_FS_FS__ITEM_INDEX_UNUSED;
+              ref->base_revision = SVN_INVALID_REVNUM;
             }
+
+          APR_ARRAY_PUSH(query->rep_refs, rep_ref_t *) = ref;
         }
 
       svn_sort__array_insert(revision_info->representations, &result, idx);
@@ -530,8 +588,7 @@ read_phsy_noderev(svn_stringbuf_t **noderev,
   SVN_ERR_ASSERT(revision_info->rev_file);
 
   offset += revision_info->offset;
-  SVN_ERR(svn_io_file_seek(revision_info->rev_file->file, APR_SET,
-                           &offset, scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(revision_info->rev_file, NULL, offset));
 
   /* Read it (terminated by an empty line) */
   do
@@ -610,8 +667,9 @@ read_noderev(query_t *query,
              apr_pool_t *result_pool,
              apr_pool_t *scratch_pool)
 {
-  rep_stats_t *text = NULL;
-  rep_stats_t *props = NULL;
+  noderev_info_t *info = apr_pcalloc(result_pool, sizeof(*info));
+  svn_boolean_t text_is_new = FALSE;
+  svn_boolean_t props_is_new;
   node_revision_t *noderev;
 
   svn_stream_t *stream = svn_stream_from_stringbuf(noderev_str, scratch_pool);
@@ -623,40 +681,25 @@ read_noderev(query_t *query,
                                          scratch_pool));
 
   if (noderev->data_rep)
-    {
-      SVN_ERR(parse_representation(&text, query,
-                                   noderev->data_rep, revision_info,
-                                   result_pool, scratch_pool));
-
-      /* if we are the first to use this rep, mark it as "text rep" */
-      if (++text->ref_count == 1)
-        text->kind = noderev->kind == svn_node_dir ? dir_rep : file_rep;
-    }
+    SVN_ERR(parse_representation(&info->text, &text_is_new, query,
+                                 noderev->data_rep, revision_info,
+                                 result_pool, scratch_pool));
 
   if (noderev->prop_rep)
-    {
-      SVN_ERR(parse_representation(&props, query,
-                                   noderev->prop_rep, revision_info,
-                                   result_pool, scratch_pool));
-
-      /* if we are the first to use this rep, mark it as "prop rep" */
-      if (++props->ref_count == 1)
-        props->kind = noderev->kind == svn_node_dir ? dir_property_rep
-                                                    : file_property_rep;
-    }
+    SVN_ERR(parse_representation(&info->props, &props_is_new, query,
+                                 noderev->prop_rep, revision_info,
+                                 result_pool, scratch_pool));
 
-  /* record largest changes */
-  if (text && text->ref_count == 1)
-    add_change(query->stats, text->size, text->expanded_size, text->revision,
-               noderev->created_path, text->kind, !noderev->predecessor_id);
-  if (props && props->ref_count == 1)
-    add_change(query->stats, props->size, props->expanded_size,
-               props->revision, noderev->created_path, props->kind,
-               !noderev->predecessor_id);
+  /* Reference counting and the size stats will be done by add_noderev()
+   * in revision order. */
+  info->kind = noderev->kind;
+  info->created_path = apr_pstrdup(result_pool, noderev->created_path);
+  info->has_predecessor = noderev->predecessor_id != NULL;
+  APR_ARRAY_PUSH(query->noderevs, noderev_info_t *) = info;
 
   /* if this is a directory and has not been processed, yet, read and
    * process it recursively */
-  if (   noderev->kind == svn_node_dir && text && text->ref_count == 1
+  if (   noderev->kind == svn_node_dir && text_is_new
       && !svn_fs_fs__use_log_addressing(query->fs))
     SVN_ERR(parse_dir(query, noderev, revision_info, result_pool,
                       scratch_pool));
@@ -801,9 +844,6 @@ read_phys_pack_file(query_t *query,
 
       SVN_ERR(read_phys_revision(query, info, result_pool, iterpool));
 
-      info->representations = apr_array_copy(result_pool,
-                                             info->representations);
-
       /* Done with this revision. */
       info->rev_file = NULL;
 
@@ -817,10 +857,6 @@ read_phys_pack_file(query_t *query,
   /* Done with this pack file. */
   SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
 
-  /* one more pack file processed */
-  if (query->progress_func)
-    query->progress_func(base, query->progress_baton, scratch_pool);
-
   return SVN_NO_ERROR;
 }
 
@@ -866,15 +902,6 @@ read_phys_revision_file(query_t *query,
   /* put it into our container */
   APR_ARRAY_PUSH(query->revisions, revision_info_t*) = info;
 
-  /* show progress every 1000 revs or so */
-  if (query->progress_func)
-    {
-      if (query->shard_size && (revision % query->shard_size == 0))
-        query->progress_func(revision, query->progress_baton, scratch_pool);
-      if (!query->shard_size && (revision % 1000 == 0))
-        query->progress_func(revision, query->progress_baton, scratch_pool);
-    }
-
   return SVN_NO_ERROR;
 }
 
@@ -1008,12 +1035,6 @@ read_log_rev_or_packfile(query_t *query,
   int i;
   svn_fs_fs__revision_file_t *rev_file;
 
-  /* We collect the delta chain links as we scan the file.  Afterwards,
-   * we determine the lengths of those delta chains and throw this
-   * temporary container away. */
-  apr_array_header_t *rep_refs = apr_array_make(scratch_pool, 64,
-                                                sizeof(rep_ref_t *));
-
   /* we will process every revision in the rev / pack file */
   for (i = 0; i < count; ++i)
     {
@@ -1034,7 +1055,8 @@ read_log_rev_or_packfile(query_t *query,
 
   /* record the whole pack size in the first rev so the total sum will
      still be correct */
-  APR_ARRAY_IDX(query->revisions, base, revision_info_t*)->end = max_offset;
+  APR_ARRAY_IDX(query->revisions, base - query->first_revision,
+                revision_info_t*)->end = max_offset;
 
   /* for all offsets in the file, get the P2L index entries and process
      the interesting items (change lists, noderevs) */
@@ -1070,7 +1092,8 @@ read_log_rev_or_packfile(query_t *query,
             continue;
 
           /* read and process interesting items */
-          info = APR_ARRAY_IDX(query->revisions, entry->item.revision,
+          info = APR_ARRAY_IDX(query->revisions,
+                               entry->item.revision - query->first_revision,
                                revision_info_t*);
 
           if (entry->type == SVN_FS_FS__ITEM_TYPE_NODEREV)
@@ -1090,14 +1113,13 @@ read_log_rev_or_packfile(query_t *query,
                    || (entry->type == SVN_FS_FS__ITEM_TYPE_FILE_PROPS)
                    || (entry->type == SVN_FS_FS__ITEM_TYPE_DIR_PROPS))
             {
-              /* Collect the delta chain link. */
+              /* Collect the delta chain link.  It will be resolved once
+               * the results of this file get added to the global query. */
               svn_fs_fs__rep_header_t *header;
-              rep_ref_t *ref = apr_pcalloc(scratch_pool, sizeof(*ref));
+              rep_ref_t *ref = apr_pcalloc(result_pool, sizeof(*ref));
 
-              SVN_ERR(svn_io_file_aligned_seek(rev_file->file,
-                                               rev_file->block_size,
-                                               NULL, entry->offset,
-                                               iterpool));
+              SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL,
+                                               entry->offset));
               SVN_ERR(svn_fs_fs__read_rep_header(&header,
                                                  rev_file->stream,
                                                  iterpool, iterpool));
@@ -1117,7 +1139,7 @@ read_log_rev_or_packfile(query_t *query,
                   ref->base_revision = SVN_INVALID_REVNUM;
                 }
 
-              APR_ARRAY_PUSH(rep_refs, rep_ref_t *) = ref;
+              APR_ARRAY_PUSH(query->rep_refs, rep_ref_t *) = ref;
             }
 
           /* advance offset */
@@ -1125,9 +1147,6 @@ read_log_rev_or_packfile(query_t *query,
         }
     }
 
-  /* Resolve the delta chain links. */
-  SVN_ERR(resolve_representation_refs(query, rep_refs));
-
   /* clean up and close file handles */
   svn_pool_destroy(iterpool);
 
@@ -1149,10 +1168,6 @@ read_log_pack_file(query_t *query,
   SVN_ERR(read_log_rev_or_packfile(query, base, query->shard_size,
                                    result_pool, scratch_pool));
 
-  /* one more pack file processed */
-  if (query->progress_func)
-    query->progress_func(base, query->progress_baton, scratch_pool);
-
   return SVN_NO_ERROR;
 }
 
@@ -1171,58 +1186,274 @@ read_log_revision_file(query_t *query,
   SVN_ERR(read_log_rev_or_packfile(query, revision, 1,
                                    result_pool, scratch_pool));
 
-  /* show progress every 1000 revs or so */
-  if (query->progress_func)
+  return SVN_NO_ERROR;
+}
+
+/* Return the rep_stats_t in QUERY for the representation described by
+ * REP in *RESULT.  If it has not been recorded in QUERY, yet, add a copy
+ * of REP allocated in RESULT_POOL.
+ */
+static svn_error_t *
+get_representation(rep_stats_t **result,
+                   query_t *query,
+                   const rep_stats_t *rep,
+                   apr_pool_t *result_pool)
+{
+  int idx;
+  revision_info_t *revision_info = NULL;
+
+  *result = find_representation(&idx, query, &revision_info, rep->revision,
+                                rep->item_index);
+  if (!*result)
     {
-      if (query->shard_size && (revision % query->shard_size == 0))
-        query->progress_func(revision, query->progress_baton, scratch_pool);
-      if (!query->shard_size && (revision % 1000 == 0))
-        query->progress_func(revision, query->progress_baton, scratch_pool);
+      SVN_ERR_ASSERT(revision_info);
+
+      *result = apr_pmemdup(result_pool, rep, sizeof(*rep));
+      svn_sort__array_insert(revision_info->representations, result, idx);
     }
 
   return SVN_NO_ERROR;
 }
 
-/* Read the repository and collect the stats info in QUERY.
- *
- * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
- * temporaries.
+/* Count the references to the representations of the noderev described
+ * by INFO in QUERY and update the largest changes list accordingly.
+ * This must be called in revision order.  Use RESULT_POOL for persistent
+ * allocations.
  */
 static svn_error_t *
-read_revisions(query_t *query,
-               apr_pool_t *result_pool,
-               apr_pool_t *scratch_pool)
+add_noderev(query_t *query,
+            const noderev_info_t *info,
+            apr_pool_t *result_pool)
 {
-  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
-  svn_revnum_t revision;
+  rep_stats_t *text = NULL;
+  rep_stats_t *props = NULL;
 
-  /* read all packed revs */
-  for ( revision = 0
-      ; revision < query->min_unpacked_rev
-      ; revision += query->shard_size)
+  if (info->text)
     {
-      svn_pool_clear(iterpool);
+      SVN_ERR(get_representation(&text, query, info->text, result_pool));
 
-      if (svn_fs_fs__use_log_addressing(query->fs))
-        SVN_ERR(read_log_pack_file(query, revision, result_pool, iterpool));
-      else
-        SVN_ERR(read_phys_pack_file(query, revision, result_pool, iterpool));
+      /* if we are the first to use this rep, mark it as "text rep" */
+      if (++text->ref_count == 1)
+        text->kind = info->kind == svn_node_dir ? dir_rep : file_rep;
     }
 
-  /* read non-packed revs */
-  for ( ; revision <= query->head; ++revision)
+  if (info->props)
     {
-      svn_pool_clear(iterpool);
+      SVN_ERR(get_representation(&props, query, info->props, result_pool));
 
-      if (svn_fs_fs__use_log_addressing(query->fs))
-        SVN_ERR(read_log_revision_file(query, revision, result_pool,
-                                       iterpool));
+      /* if we are the first to use this rep, mark it as "prop rep" */
+      if (++props->ref_count == 1)
+        props->kind = info->kind == svn_node_dir ? dir_property_rep
+                                                 : file_property_rep;
+    }
+
+  /* record largest changes */
+  if (text && text->ref_count == 1)
+    add_change(query->stats, text->size, text->expanded_size, text->revision,
+               info->created_path, text->kind, !info->has_predecessor);
+  if (props && props->ref_count == 1)
+    add_change(query->stats, props->size, props->expanded_size,
+               props->revision, info->created_path, props->kind,
+               !info->has_predecessor);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton type used by the read_revisions tasks. */
+typedef struct read_task_baton_t
+{
+  /* Query covering the whole repository. */
+  query_t *query;
+
+  /* Number of pack files.  Task indexes below that refer to pack files,
+   * all others to non-packed revisions. */
+  apr_int64_t pack_count;
+
+  /* Pool to allocate the contents of QUERY in. */
+  apr_pool_t *result_pool;
+} read_task_baton_t;
+
+/* Implements svn_task__thread_context_constructor_t.
+ * Open a private instance of the read_task_baton_t's filesystem. */
+static svn_error_t *
+open_fs_for_thread(void **thread_context,
+                   void *baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  read_task_baton_t *task_baton = baton;
+  svn_fs_t *fs;
+
+  SVN_ERR(svn_fs_fs__open_clone(&fs, task_baton->query->fs, result_pool,
+                                scratch_pool));
+  *thread_context = fs;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the first revision in the rev / pack file of task INDEX. */
+static svn_revnum_t
+task_first_revision(read_task_baton_t *task_baton,
+                    apr_int64_t index)
+{
+  query_t *query = task_baton->query;
+
+  return index < task_baton->pack_count
+       ? (svn_revnum_t)(index * query->shard_size)
+       : query->min_unpacked_rev
+         + (svn_revnum_t)(index - task_baton->pack_count);
+}
+
+/* Implements svn_task__process_func_t.
+ * Scan the rev / pack file given by INDEX and return the findings as a
+ * query_t * covering only that file in *RESULT.  Nothing is written to
+ * the global query such that any number of files may be scanned
+ * concurrently. */
+static svn_error_t *
+read_file_task(void **result,
+               void *thread_context,
+               void *process_baton,
+               apr_int64_t index,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  read_task_baton_t *task_baton = process_baton;
+  query_t *query = apr_pmemdup(result_pool, task_baton->query,
+                               sizeof(*query));
+  svn_revnum_t base = task_first_revision(task_baton, index);
+  svn_boolean_t is_pack = index < task_baton->pack_count;
+
+  if (thread_context)
+    query->fs = thread_context;
+
+  query->first_revision = base;
+  query->revisions = apr_array_make(result_pool,
+                                    is_pack ? query->shard_size : 1,
+                                    sizeof(revision_info_t *));
+  query->noderevs = apr_array_make(result_pool, 16,
+                                   sizeof(noderev_info_t *));
+  query->rep_refs = apr_array_make(result_pool, 16, sizeof(rep_ref_t *));
+  query->stats = NULL;
+  query->progress_func = NULL;
+
+  if (svn_fs_fs__use_log_addressing(query->fs))
+    {
+      if (is_pack)
+        SVN_ERR(read_log_pack_file(query, base, result_pool, scratch_pool));
       else
-        SVN_ERR(read_phys_revision_file(query, revision, result_pool,
-                                        iterpool));
+        SVN_ERR(read_log_revision_file(query, base, result_pool,
+                                       scratch_pool));
+    }
+  else
+    {
+      if (is_pack)
+        SVN_ERR(read_phys_pack_file(query, base, result_pool, scratch_pool));
+      else
+        SVN_ERR(read_phys_revision_file(query, base, result_pool,
+                                        scratch_pool));
     }
 
-  svn_pool_destroy(iterpool);
+  *result = query;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * Add the findings of the rev / pack file given by INDEX in RESULT to the
+ * global query.  This gets called in revision order. */
+static svn_error_t *
+read_file_output(void *result,
+                 void *output_baton,
+                 apr_int64_t index,
+                 apr_pool_t *scratch_pool)
+{
+  read_task_baton_t *task_baton = output_baton;
+  query_t *query = task_baton->query;
+  query_t *file_query = result;
+  svn_revnum_t base = file_query->first_revision;
+  int i, k;
+
+  /* The per-file results get discarded after this call, so copy the
+   * revision and representation info into the global query. */
+  for (i = 0; i < file_query->revisions->nelts; ++i)
+    {
+      revision_info_t *info
+        = apr_pmemdup(task_baton->result_pool,
+                      APR_ARRAY_IDX(file_query->revisions, i,
+                                    revision_info_t *),
+                      sizeof(*info));
+      apr_array_header_t *reps = info->representations;
+
+      info->representations = apr_array_make(task_baton->result_pool,
+                                             reps->nelts,
+                                             sizeof(rep_stats_t *));
+      for (k = 0; k < reps->nelts; ++k)
+        APR_ARRAY_PUSH(info->representations, rep_stats_t *)
+          = apr_pmemdup(task_baton->result_pool,
+                        APR_ARRAY_IDX(reps, k, rep_stats_t *),
+                        sizeof(rep_stats_t));
+
+      APR_ARRAY_PUSH(query->revisions, revision_info_t *) = info;
+    }
+
+  /* Count rep references in the same order as a single-threaded scan. */
+  for (i = 0; i < file_query->noderevs->nelts; ++i)
+    SVN_ERR(add_noderev(query,
+                        APR_ARRAY_IDX(file_query->noderevs, i,
+                                      noderev_info_t *),
+                        task_baton->result_pool));
+
+  /* Resolve the delta chain links. */
+  SVN_ERR(resolve_representation_refs(query, file_query->rep_refs));
+
+  /* one more pack file processed / show progress every 1000 revs or so */
+  if (query->progress_func)
+    {
+      if (index < task_baton->pack_count)
+        query->progress_func(base, query->progress_baton, scratch_pool);
+      else if (query->shard_size && (base % query->shard_size == 0))
+        query->progress_func(base, query->progress_baton, scratch_pool);
+      else if (!query->shard_size && (base % 1000 == 0))
+        query->progress_func(base, query->progress_baton, scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the repository and collect the stats info in QUERY.
+ *
+ * Rev and pack files get scanned by up to FSFS_JOBS concurrent tasks while
+ * the results are being added to QUERY in revision order.
+ *
+ * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
+ * temporaries.
+ */
+static svn_error_t *
+read_revisions(query_t *query,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = query->fs->fsap_data;
+  read_task_baton_t task_baton;
+  apr_int64_t pack_count = query->shard_size
+                         ? query->min_unpacked_rev / query->shard_size
+                         : 0;
+
+  task_baton.query = query;
+  task_baton.pack_count = pack_count;
+  task_baton.result_pool = result_pool;
+
+  SVN_ERR(svn_task__run(ffd->jobs,
+                        pack_count + query->head + 1
+                          - query->min_unpacked_rev,
+                        ffd->jobs > 1 ? open_fs_for_thread : NULL,
+                        &task_baton,
+                        read_file_task, &task_baton,
+                        read_file_output, &task_baton,
+                        query->cancel_func, query->cancel_baton,
+                        scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -1362,6 +1593,7 @@ create_query(query_t **query,
    * and the repository has more revisions than int can hold. */
   (*query)->revisions = apr_array_make(result_pool, (int) (*query)->head + 1,
                                        sizeof(revision_info_t *));
+  (*query)->first_revision = 0;
   (*query)->null_base = apr_pcalloc(result_pool,
                                     sizeof(*(*query)->null_base));
 
@@ -981,6 +981,109 @@ svn_fs_fs__extract_dir_entry(void **out,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__serialize_dir_index(void **data,
+                               apr_size_t *data_len,
+                               void *in,
+                               apr_pool_t *pool)
+{
+  svn_fs_fs__dir_index_t *index = in;
+  svn_temp_serializer__context_t *context;
+  svn_stringbuf_t *serialized;
+  int i;
+
+  /* serialize the index struct, the page array and all page names */
+  context = svn_temp_serializer__init(index,
+                                      sizeof(*index),
+                                      index->page_count * 64 + 32,
+                                      pool);
+
+  svn_temp_serializer__push(context,
+                            (const void * const *)&index->pages,
+                            index->page_count * sizeof(*index->pages));
+
+  for (i = 0; i < index->page_count; ++i)
+    svn_temp_serializer__add_string(context, &index->pages[i].first_name);
+
+  svn_temp_serializer__pop(context);
+
+  /* return the serialized result */
+  serialized = svn_temp_serializer__get(context);
+
+  *data = serialized->data;
+  *data_len = serialized->len;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__deserialize_dir_index(void **out,
+                                 void *data,
+                                 apr_size_t data_len,
+                                 apr_pool_t *pool)
+{
+  svn_fs_fs__dir_index_t *index = data;
+  int i;
+
+  svn_temp_deserializer__resolve(index, (void **)&index->pages);
+  for (i = 0; i < index->page_count; ++i)
+    svn_temp_deserializer__resolve(index->pages,
+                                   (void **)&index->pages[i].first_name);
+
+  *out = index;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__extract_dir_page(void **out,
+                            const void *data,
+                            apr_size_t data_len,
+                            void *baton,
+                            apr_pool_t *pool)
+{
+  const svn_fs_fs__dir_index_t *index = data;
+  extract_dir_page_baton_t *page_baton = baton;
+  const svn_fs_fs__dir_page_t *pages;
+  svn_fs_fs__dir_page_t *page;
+  int lower = 0;
+  int upper = index->page_count;
+
+  *out = NULL;
+  page_baton->paged = index->page_count > 0;
+  if (!page_baton->paged)
+    return SVN_NO_ERROR;
+
+  /* binary search for the last page starting at or before NAME */
+  pages = svn_temp_deserializer__ptr(index,
+                                     (const void *const *)&index->pages);
+  while (lower < upper)
+    {
+      int middle = lower + (upper - lower) / 2;
+      const char *first_name
+        = svn_temp_deserializer__ptr(pages,
+                         (const void *const *)&pages[middle].first_name);
+
+      if (strcmp(first_name, page_baton->name) <= 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  /* NAME sorts before the first entry -> not found */
+  if (lower == 0)
+    return SVN_NO_ERROR;
+
+  /* return a copy of that page */
+  page = apr_pmemdup(pool, &pages[lower - 1], sizeof(*page));
+  page->first_name
+    = apr_pstrdup(pool, svn_temp_deserializer__ptr(pages,
+                          (const void *const *)&pages[lower - 1].first_name));
+  *(svn_fs_fs__dir_page_t **)out = page;
+
+  return SVN_NO_ERROR;
+}
+
 /* Utility function for svn_fs_fs__replace_dir_entry that implements the
  * modification as a simply deserialize / modify / serialize sequence.
  */
@@ -1134,18 +1237,6 @@ svn_fs_fs__replace_dir_entry(void **data,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_fs_fs__reset_txn_filesize(void **data,
-                              apr_size_t *data_len,
-                              void *baton,
-                              apr_pool_t *pool)
-{
-  dir_data_t *dir_data = (dir_data_t *)*data;
-  dir_data->txn_filesize = SVN_INVALID_FILESIZE;
-
-  return SVN_NO_ERROR;
-}
-
 svn_error_t  *
 svn_fs_fs__serialize_rep_header(void **data,
                                 apr_size_t *data_len,
@@ -300,6 +300,51 @@ svn_fs_fs__extract_dir_entry(void **out,
                              void *baton,
                              apr_pool_t *pool);
 
+/**
+ * Implements #svn_cache__serialize_func_t for a #svn_fs_fs__dir_index_t
+ */
+svn_error_t *
+svn_fs_fs__serialize_dir_index(void **data,
+                               apr_size_t *data_len,
+                               void *in,
+                               apr_pool_t *pool);
+
+/**
+ * Implements #svn_cache__deserialize_func_t for a #svn_fs_fs__dir_index_t
+ */
+svn_error_t *
+svn_fs_fs__deserialize_dir_index(void **out,
+                                 void *data,
+                                 apr_size_t data_len,
+                                 apr_pool_t *pool);
+
+/**
+ * Describes the directory page to be found in a paged directory index:
+ * Identifies the page by the @a name of the entry it must contain.
+ */
+typedef struct extract_dir_page_baton_t
+{
+  /** name of the directory entry to look up */
+  const char *name;
+
+  /** Will be set by the callback.  If FALSE, the directory is not paged
+   * and the whole representation needs to be read. */
+  svn_boolean_t paged;
+} extract_dir_page_baton_t;
+
+/**
+ * Implements #svn_cache__partial_getter_func_t for the single
+ * #svn_fs_fs__dir_page_t within a serialized #svn_fs_fs__dir_index_t that
+ * may contain the entry given by (extract_dir_page_baton_t *) @a *baton.
+ * If the entry would sort before the first page, @a *out will be NULL.
+ */
+svn_error_t *
+svn_fs_fs__extract_dir_page(void **out,
+                            const void *data,
+                            apr_size_t data_len,
+                            void *baton,
+                            apr_pool_t *pool);
+
 /**
  * Describes the change to be done to a directory: Set the entry
  * identify by @a name to the value @a new_entry. If the latter is
@@ -333,17 +378,6 @@ svn_fs_fs__replace_dir_entry(void **data,
                              void *baton,
                              apr_pool_t *pool);
 
-/**
- * Implements #svn_cache__partial_setter_func_t for a #svn_fs_fs__dir_data_t
- * at @a *data, resetting its txn_filesize field to SVN_INVALID_FILESIZE.
- * &a baton should be NULL.
- */
-svn_error_t *
-svn_fs_fs__reset_txn_filesize(void **data,
-                              apr_size_t *data_len,
-                              void *baton,
-                              apr_pool_t *pool);
-
 /**
  * Implements #svn_cache__serialize_func_t for a #svn_fs_fs__rep_header_t.
  */
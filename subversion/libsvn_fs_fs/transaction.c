@@ -43,8 +43,10 @@
 #include "lock.h"
 #include "rep-cache.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
+#include "private/svn_io_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
@@ -2008,13 +2010,15 @@ shards_spanned(int *spanned,
 /* Given a node-revision NODEREV in filesystem FS, return the
    representation in *REP to use as the base for a text representation
    delta if PROPS is FALSE.  If PROPS has been set, a suitable props
-   base representation will be returned.  Perform temporary allocations
-   in *POOL. */
+   base representation will be returned.  The new delta will be written
+   with WINDOW_SIZE bytes per window; only bases whose windows line up
+   with that will be returned.  Perform temporary allocations in *POOL. */
 static svn_error_t *
 choose_delta_base(representation_t **rep,
                   svn_fs_t *fs,
                   node_revision_t *noderev,
                   svn_boolean_t props,
+                  apr_size_t window_size,
                   apr_pool_t *pool)
 {
   /* The zero-based index (counting from the "oldest" end), along NODEREVs line
@@ -2123,6 +2127,18 @@ choose_delta_base(representation_t **rep,
           *rep = NULL;
     }
 
+  /* The reader combines the windows of all deltas along the chain by
+   * their index.  Start a new chain if the 'delta-window-size' has been
+   * changed since the base got written. */
+  if (*rep)
+    {
+      svn_boolean_t matches;
+      SVN_ERR(svn_fs_fs__rep_window_size_matches(&matches, *rep,
+                                                 window_size, fs, pool));
+      if (!matches)
+        *rep = NULL;
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -2169,7 +2185,13 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
   fs_fs_data_t *ffd = fs->fsap_data;
   int svndiff_version;
 
-  if (ffd->delta_compression_type == compression_type_lz4)
+  if (ffd->delta_window_size > svn_txdelta__max_window_size(2))
+    {
+      /* Only svndiff3 can represent windows that large. */
+      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT);
+      svndiff_version = 3;
+    }
+  else if (ffd->delta_compression_type == compression_type_lz4)
     {
       SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT);
       svndiff_version = 2;
@@ -2198,6 +2220,7 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
                     node_revision_t *noderev,
                     apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_write_baton *b;
   apr_file_t *file;
   representation_t *base_rep;
@@ -2231,7 +2254,8 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
   SVN_ERR(svn_io_file_get_offset(&b->rep_offset, file, b->scratch_pool));
 
   /* Get the base for this delta. */
-  SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE, b->scratch_pool));
+  SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE,
+                            ffd->delta_window_size, b->scratch_pool));
   SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
                                   b->scratch_pool));
 
@@ -2261,8 +2285,9 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
   /* Prepare to write the svndiff data. */
   txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, pool);
 
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->scratch_pool);
+  b->delta_stream = svn_txdelta__target_push(wh, whb, source,
+                                             ffd->delta_window_size,
+                                             b->scratch_pool);
 
   *wb_p = b;
 
@@ -2769,6 +2794,62 @@ write_directory_to_stream(svn_stream_t *stream,
   return SVN_NO_ERROR;
 }
 
+/* Implement collection_writer_t writing the svn_fs_dirent_t* array given
+   as BATON as a paged directory, i.e. the directory index followed by
+   pages of up to SVN_FS_FS__DIR_PAGE_SIZE entries each. */
+static svn_error_t *
+write_paged_directory_to_stream(svn_stream_t *stream,
+                                void *baton,
+                                apr_pool_t *pool)
+{
+  apr_array_header_t *dir = baton;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_fs_fs__dir_index_t index;
+  svn_stringbuf_t **pages;
+  int i;
+
+  index.entry_count = dir->nelts;
+  index.page_count = (dir->nelts + SVN_FS_FS__DIR_PAGE_SIZE - 1)
+                   / SVN_FS_FS__DIR_PAGE_SIZE;
+  index.pages = apr_pcalloc(pool, index.page_count * sizeof(*index.pages));
+  pages = apr_palloc(pool, index.page_count * sizeof(*pages));
+
+  /* Serialize all pages first because the index needs their sizes. */
+  for (i = 0; i < index.page_count; ++i)
+    {
+      int first = i * SVN_FS_FS__DIR_PAGE_SIZE;
+      int count = MIN(dir->nelts - first, SVN_FS_FS__DIR_PAGE_SIZE);
+      apr_array_header_t *page_entries;
+      int k;
+
+      svn_pool_clear(iterpool);
+      page_entries = apr_array_make(iterpool, count,
+                                    sizeof(svn_fs_dirent_t *));
+      for (k = first; k < first + count; ++k)
+        APR_ARRAY_PUSH(page_entries, svn_fs_dirent_t *)
+          = APR_ARRAY_IDX(dir, k, svn_fs_dirent_t *);
+
+      pages[i] = svn_stringbuf_create_empty(pool);
+      SVN_ERR(unparse_dir_entries(page_entries,
+                                  svn_stream_from_stringbuf(pages[i],
+                                                            iterpool),
+                                  iterpool));
+
+      index.pages[i].first_name
+        = APR_ARRAY_IDX(dir, first, svn_fs_dirent_t *)->name;
+      index.pages[i].size = pages[i]->len;
+    }
+
+  svn_pool_clear(iterpool);
+  SVN_ERR(svn_fs_fs__write_dir_index(&index, stream, iterpool));
+  for (i = 0; i < index.page_count; ++i)
+    SVN_ERR(svn_stream_write(stream, pages[i]->data, &pages[i]->len));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Write out the COLLECTION as a text representation to file FILE using
    WRITER.  In the process, record position, the total size of the dump and
    MD5 as well as SHA1 in REP.   Add the representation of type ITEM_TYPE to
@@ -2919,7 +3000,8 @@ write_container_delta_rep(representation_t *rep,
                         || (item_type == SVN_FS_FS__ITEM_TYPE_DIR_PROPS);
 
   /* Get the base for this delta. */
-  SVN_ERR(choose_delta_base(&base_rep, fs, noderev, is_props, scratch_pool));
+  SVN_ERR(choose_delta_base(&base_rep, fs, noderev, is_props,
+                            svn_txdelta__max_window_size(2), scratch_pool));
   SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, FALSE, scratch_pool));
 
   SVN_ERR(svn_io_file_get_offset(&offset, file, scratch_pool));
@@ -3100,6 +3182,40 @@ get_final_id(svn_fs_fs__id_part_t *part,
     }
 }
 
+/* A directory written by write_final_rev().  Its contents get added to
+   the directory cache once the new revision has been committed. */
+typedef struct dir_to_cache_t
+{
+  /* Cache key of the new directory representation. */
+  pair_cache_key_t key;
+
+  /* The directory entries, svn_fs_dirent_t *. */
+  apr_array_header_t *entries;
+} dir_to_cache_t;
+
+/* Return a deep copy of the directory ENTRIES, allocated in RESULT_POOL. */
+static apr_array_header_t *
+copy_dir_entries(const apr_array_header_t *entries,
+                 apr_pool_t *result_pool)
+{
+  apr_array_header_t *result = apr_array_make(result_pool, entries->nelts,
+                                              sizeof(svn_fs_dirent_t *));
+  int i;
+
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      const svn_fs_dirent_t *entry
+        = APR_ARRAY_IDX(entries, i, const svn_fs_dirent_t *);
+      svn_fs_dirent_t *copy = apr_pmemdup(result_pool, entry, sizeof(*copy));
+
+      copy->name = apr_pstrdup(result_pool, entry->name);
+      copy->id = svn_fs_fs__id_copy(entry->id, result_pool);
+      APR_ARRAY_PUSH(result, svn_fs_dirent_t *) = copy;
+    }
+
+  return result;
+}
+
 /* Copy a node-revision specified by id ID in fileystem FS from a
    transaction into the proto-rev-file FILE.  Set *NEW_ID_P to a
    pointer to the new node-id which will be allocated in POOL.
@@ -3114,8 +3230,9 @@ get_final_id(svn_fs_fs__id_part_t *part,
    INITIAL_OFFSET is the offset of the proto-rev-file on entry to
    commit_body.
 
-   Collect the pair_cache_key_t of all directories written to the
-   committed cache in DIRECTORY_IDS.
+   Collect a dir_to_cache_t for each directory written in DIRECTORY_IDS,
+   allocated in the array's pool.  This does not touch the directory
+   cache itself, since REV may not get committed from this transaction.
 
    If REPS_TO_CACHE is not NULL, append to it a copy (allocated in
    REPS_POOL) of each data rep that is new in this revision.
@@ -3189,12 +3306,19 @@ write_final_rev(const svn_fs_id_t **new_id_p,
 
       if (noderev->data_rep && is_txn_rep(noderev->data_rep))
         {
-          pair_cache_key_t *key;
-          svn_fs_fs__dir_data_t dir_data;
+          dir_to_cache_t *dir;
 
           /* Write out the contents of this directory as a text rep. */
           noderev->data_rep->revision = rev;
-          if (ffd->deltify_directories)
+          if (   ffd->paged_directories
+              && entries->nelts > SVN_FS_FS__MIN_PAGED_DIR_SIZE)
+            /* Paged directories are never deltified such that readers
+               may access individual pages directly. */
+            SVN_ERR(write_container_rep(noderev->data_rep, file, entries,
+                                        write_paged_directory_to_stream, fs,
+                                        NULL, FALSE,
+                                        SVN_FS_FS__ITEM_TYPE_DIR_REP, pool));
+          else if (ffd->deltify_directories)
             SVN_ERR(write_container_delta_rep(noderev->data_rep, file,
                                               entries,
                                               write_directory_to_stream,
@@ -3209,22 +3333,13 @@ write_final_rev(const svn_fs_id_t **new_id_p,
 
           reset_txn_in_rep(noderev->data_rep);
 
-          /* Cache the new directory contents.  Otherwise, subsequent reads
-           * or commits will likely have to reconstruct, verify and parse
-           * it again. */
-          key = apr_array_push(directory_ids);
-          key->revision = noderev->data_rep->revision;
-          key->second = noderev->data_rep->item_index;
-
-          /* Store directory contents under the new revision number but mark
-           * it as "stale" by setting the file length to 0.  Committed dirs
-           * will report -1, in-txn dirs will report > 0, so that this can
-           * never match.  We reset that to -1 after the commit is complete.
-           */
-          dir_data.entries = entries;
-          dir_data.txn_filesize = 0;
-
-          SVN_ERR(svn_cache__set(ffd->dir_cache, key, &dir_data, subpool));
+          /* Remember the new directory contents for the cache.  Otherwise,
+           * subsequent reads or commits will likely have to reconstruct,
+           * verify and parse it again. */
+          dir = apr_array_push(directory_ids);
+          dir->key.revision = noderev->data_rep->revision;
+          dir->key.second = noderev->data_rep->item_index;
+          dir->entries = copy_dir_entries(entries, directory_ids->pool);
         }
     }
   else
@@ -3593,13 +3708,14 @@ verify_locks(svn_fs_t *fs,
 }
 
 /* Writes final revision properties to file PATH applying permissions
-   from file PERMS_REFERENCE. This involves setting svn:date and
-   removing any temporary properties associated with the commit flags. */
+   from file PERMS_REFERENCE and schedule the necessary fsync calls in
+   BATCH. This involves setting svn:date and removing any temporary
+   properties associated with the commit flags. */
 static svn_error_t *
 write_final_revprop(const char *path,
                     const char *perms_reference,
                     svn_fs_txn_t *txn,
-                    svn_boolean_t flush_to_disk,
+                    svn_io__batch_fsync_t *batch,
                     apr_pool_t *pool)
 {
   apr_hash_t *txnprops;
@@ -3629,21 +3745,19 @@ write_final_revprop(const char *path,
       svn_hash_sets(txnprops, SVN_PROP_REVISION_DATE, &date);
     }
 
-  /* Create new revprops file. Tell OS to truncate existing file,
-     since  file may already exists from failed transaction. */
-  SVN_ERR(svn_io_file_open(&revprop_file, path,
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE
-                           | APR_BUFFERED, APR_OS_DEFAULT, pool));
+  /* Create new revprops file. Truncate any existing file, since the
+     file may already exists from failed transaction.  BATCH owns the
+     file handle and will close it. */
+  SVN_ERR(svn_io__batch_fsync_open_file(&revprop_file, batch, path,
+                                        pool));
+  SVN_ERR(svn_io_file_trunc(revprop_file, 0, pool));
 
   stream = svn_stream_from_aprfile2(revprop_file, TRUE, pool);
   SVN_ERR(svn_hash_write2(txnprops, stream, SVN_HASH_TERMINATOR, pool));
   SVN_ERR(svn_stream_close(stream));
 
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(revprop_file, pool));
-  SVN_ERR(svn_io_file_close(revprop_file, pool));
-
   SVN_ERR(svn_io_copy_perms(perms_reference, path, pool));
+  SVN_ERR(svn_io__batch_fsync_new_path(batch, path, pool));
 
   return SVN_NO_ERROR;
 }
@@ -3689,12 +3803,13 @@ svn_fs_fs__add_index_data(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-/* Mark the directories cached in FS with the keys from DIRECTORY_IDS
- * as "valid" now.  Use SCRATCH_POOL for temporaries. */
+/* Add the directory contents collected as dir_to_cache_t in DIRECTORY_IDS
+ * to the directory cache of FS.  Call this only after the new revision
+ * became visible.  Use SCRATCH_POOL for temporaries. */
 static svn_error_t *
-promote_cached_directories(svn_fs_t *fs,
-                           apr_array_header_t *directory_ids,
-                           apr_pool_t *scratch_pool)
+cache_new_directories(svn_fs_t *fs,
+                      apr_array_header_t *directory_ids,
+                      apr_pool_t *scratch_pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   apr_pool_t *iterpool;
@@ -3706,17 +3821,16 @@ promote_cached_directories(svn_fs_t *fs,
   iterpool = svn_pool_create(scratch_pool);
   for (i = 0; i < directory_ids->nelts; ++i)
     {
-      const pair_cache_key_t *key
-        = &APR_ARRAY_IDX(directory_ids, i, pair_cache_key_t);
+      dir_to_cache_t *dir = &APR_ARRAY_IDX(directory_ids, i, dir_to_cache_t);
+      svn_fs_fs__dir_data_t dir_data;
 
       svn_pool_clear(iterpool);
 
-      /* Currently, the entry for KEY - if it still exists - is marked
-       * as "stale" and would not be used.  Mark it as current for in-
-       * revison data. */
-      SVN_ERR(svn_cache__set_partial(ffd->dir_cache, key,
-                                     svn_fs_fs__reset_txn_filesize, NULL,
-                                     iterpool));
+      /* Committed dirs report an invalid txn file size. */
+      dir_data.entries = dir->entries;
+      dir_data.txn_filesize = SVN_INVALID_FILESIZE;
+      SVN_ERR(svn_cache__set(ffd->dir_cache, &dir->key, &dir_data,
+                             iterpool));
     }
 
   svn_pool_destroy(iterpool);
@@ -3724,6 +3838,186 @@ promote_cached_directories(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Move the finished revision file OLD_FILENAME to NEW_FILENAME, applying
+   permissions from PERMS_REFERENCE.  On POSIX, schedule the fsync of the
+   directory entry in BATCH instead of flushing it immediately.  Fall back
+   to svn_fs_fs__move_into_place with FLUSH_TO_DISK for all other cases.
+   Use POOL for temporary allocations. */
+static svn_error_t *
+move_into_place_batched(const char *old_filename,
+                        const char *new_filename,
+                        const char *perms_reference,
+                        svn_io__batch_fsync_t *batch,
+                        svn_boolean_t flush_to_disk,
+                        apr_pool_t *pool)
+{
+#ifdef SVN_ON_POSIX
+  svn_error_t *err;
+
+  SVN_ERR(svn_io_copy_perms(perms_reference, old_filename, pool));
+  err = svn_io_file_rename2(old_filename, new_filename, FALSE, pool);
+  if (!err)
+    return svn_error_trace(svn_io__batch_fsync_new_path(batch,
+                                                        new_filename,
+                                                        pool));
+
+  /* Can't rename across devices; let the fallback copy the file. */
+  if (!APR_STATUS_IS_EXDEV(err->apr_err))
+    return svn_error_trace(err);
+  svn_error_clear(err);
+#endif
+
+  return svn_error_trace(svn_fs_fs__move_into_place(old_filename,
+                                                    new_filename,
+                                                    perms_reference,
+                                                    flush_to_disk, pool));
+}
+
+/* Sizes of the transaction files that finalize_proto_rev() appends to,
+   recorded before it started.  A size of -1 means "did not exist". */
+typedef struct proto_rev_checkpoint_t
+{
+  /* Length of the proto-rev file.  -1 if there is nothing to roll back. */
+  apr_off_t proto_rev_size;
+
+  /* Whether the transaction used log addressing at that time. */
+  svn_boolean_t use_log_addressing;
+
+  /* Lengths of the proto-index files.  Only used in log addressing mode. */
+  apr_off_t l2p_proto_index_size;
+  apr_off_t p2l_proto_index_size;
+
+  /* Contents of the item index counter file, NULL if it did not exist. */
+  svn_stringbuf_t *item_index;
+} proto_rev_checkpoint_t;
+
+/* Set *SIZE to the length of the file at PATH or to -1 if it does not
+   exist.  Use POOL for temporary allocations. */
+static svn_error_t *
+get_txn_file_size(apr_off_t *size,
+                  const char *path,
+                  apr_pool_t *pool)
+{
+  apr_finfo_t finfo;
+  svn_error_t *err = svn_io_stat(&finfo, path, APR_FINFO_SIZE, pool);
+
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *size = -1;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(err);
+  *size = finfo.size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Restore the file at PATH to the SIZE reported by get_txn_file_size().
+   Use POOL for temporary allocations. */
+static svn_error_t *
+restore_txn_file_size(const char *path,
+                      apr_off_t size,
+                      apr_pool_t *pool)
+{
+  apr_file_t *file;
+
+  if (size < 0)
+    return svn_error_trace(svn_io_remove_file2(path, TRUE, pool));
+
+  SVN_ERR(svn_io_file_open(&file, path, APR_WRITE, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_trunc(file, size, pool));
+
+  return svn_error_trace(svn_io_file_close(file, pool));
+}
+
+/* Record in *CHECKPOINT the state of the files of transaction TXN_ID in FS
+   that finalize_proto_rev() is going to modify.  PROTO_REV_SIZE is the
+   current length of the proto-rev file.  Allocate the result in POOL. */
+static svn_error_t *
+checkpoint_proto_rev(proto_rev_checkpoint_t *checkpoint,
+                     svn_fs_t *fs,
+                     const svn_fs_fs__id_part_t *txn_id,
+                     apr_off_t proto_rev_size,
+                     apr_pool_t *pool)
+{
+  checkpoint->use_log_addressing = svn_fs_fs__use_log_addressing(fs);
+  checkpoint->item_index = NULL;
+  checkpoint->l2p_proto_index_size = -1;
+  checkpoint->p2l_proto_index_size = -1;
+
+  if (checkpoint->use_log_addressing)
+    {
+      svn_error_t *err;
+
+      SVN_ERR(get_txn_file_size(&checkpoint->l2p_proto_index_size,
+                      svn_fs_fs__path_l2p_proto_index(fs, txn_id, pool),
+                      pool));
+      SVN_ERR(get_txn_file_size(&checkpoint->p2l_proto_index_size,
+                      svn_fs_fs__path_p2l_proto_index(fs, txn_id, pool),
+                      pool));
+
+      err = svn_stringbuf_from_file2(&checkpoint->item_index,
+                            svn_fs_fs__path_txn_item_index(fs, txn_id, pool),
+                            pool);
+      if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+        {
+          svn_error_clear(err);
+          checkpoint->item_index = NULL;
+        }
+      else
+        SVN_ERR(err);
+    }
+
+  /* Set this last.  It marks the checkpoint as valid. */
+  checkpoint->proto_rev_size = proto_rev_size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Undo all changes that finalize_proto_rev() made to the files of
+   transaction TXN_ID in FS since CHECKPOINT was taken.  The proto-rev file
+   must be closed and still be locked by the caller.  Invalidate
+   CHECKPOINT afterwards.  Use POOL for temporary allocations. */
+static svn_error_t *
+rollback_proto_rev(proto_rev_checkpoint_t *checkpoint,
+                   svn_fs_t *fs,
+                   const svn_fs_fs__id_part_t *txn_id,
+                   apr_pool_t *pool)
+{
+  const char *item_index_path;
+
+  if (checkpoint->proto_rev_size < 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(restore_txn_file_size(svn_fs_fs__path_txn_proto_rev(fs, txn_id,
+                                                              pool),
+                                checkpoint->proto_rev_size, pool));
+  checkpoint->proto_rev_size = -1;
+
+  if (!checkpoint->use_log_addressing)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(restore_txn_file_size(svn_fs_fs__path_l2p_proto_index(fs, txn_id,
+                                                                pool),
+                                checkpoint->l2p_proto_index_size, pool));
+  SVN_ERR(restore_txn_file_size(svn_fs_fs__path_p2l_proto_index(fs, txn_id,
+                                                                pool),
+                                checkpoint->p2l_proto_index_size, pool));
+
+  item_index_path = svn_fs_fs__path_txn_item_index(fs, txn_id, pool);
+  if (checkpoint->item_index)
+    SVN_ERR(svn_io_write_atomic2(item_index_path,
+                                 checkpoint->item_index->data,
+                                 checkpoint->item_index->len,
+                                 NULL, FALSE, pool));
+  else
+    SVN_ERR(svn_io_remove_file2(item_index_path, TRUE, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton used for commit_body below. */
 struct commit_baton {
   svn_revnum_t *new_rev_p;
@@ -3732,11 +4026,180 @@ struct commit_baton {
   apr_array_header_t *reps_to_cache;
   apr_hash_t *reps_hash;
   apr_pool_t *reps_pool;
+
+  /* Folded list of changes in TXN. */
+  apr_hash_t *changed_paths;
+
+  /* New directory contents to cache after the commit, dir_to_cache_t. */
+  apr_array_header_t *directory_ids;
+
+  /* The revision that TXN's proto-rev file has been finalized for or
+     SVN_INVALID_REVNUM.  PREPARED_FORMAT is the FS format at that time. */
+  svn_revnum_t prepared_rev;
+  int prepared_format;
+
+  /* Lock on TXN's proto-rev file.  NULL if not held. */
+  void *proto_file_lockcookie;
+
+  /* How to undo the finalization of TXN's proto-rev file. */
+  proto_rev_checkpoint_t checkpoint;
 };
 
+/* Append the final node-revisions, the changed-path information and the
+   index data or trailer for revision NEW_REV of transaction CB->TXN to
+   PROTO_FILE.  Record the original state of the transaction files in
+   CB->CHECKPOINT first.  START_NODE_ID and START_COPY_ID are passed
+   through to write_final_rev().  Use POOL for allocations. */
+static svn_error_t *
+write_final_data(struct commit_baton *cb,
+                 apr_file_t *proto_file,
+                 svn_revnum_t new_rev,
+                 apr_uint64_t start_node_id,
+                 apr_uint64_t start_copy_id,
+                 apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = cb->fs->fsap_data;
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
+  const svn_fs_id_t *root_id, *new_root_id;
+  apr_off_t initial_offset, changed_path_offset;
+
+  SVN_ERR(svn_io_file_get_offset(&initial_offset, proto_file, pool));
+  SVN_ERR(checkpoint_proto_rev(&cb->checkpoint, cb->fs, txn_id,
+                               initial_offset, pool));
+
+  /* Write out all the node-revisions and directory contents. */
+  root_id = svn_fs_fs__id_txn_create_root(txn_id, pool);
+  SVN_ERR(write_final_rev(&new_root_id, proto_file, new_rev, cb->fs, root_id,
+                          start_node_id, start_copy_id, initial_offset,
+                          cb->directory_ids, cb->reps_to_cache,
+                          cb->reps_hash, cb->reps_pool, TRUE, pool));
+
+  /* Write the changed-path information. */
+  SVN_ERR(write_final_changed_path_info(&changed_path_offset, proto_file,
+                                        cb->fs, txn_id, cb->changed_paths,
+                                        pool));
+
+  if (svn_fs_fs__use_log_addressing(cb->fs))
+    {
+      /* Append the index data to the rev file. */
+      SVN_ERR(svn_fs_fs__add_index_data(cb->fs, proto_file,
+                      svn_fs_fs__path_l2p_proto_index(cb->fs, txn_id, pool),
+                      svn_fs_fs__path_p2l_proto_index(cb->fs, txn_id, pool),
+                      new_rev, pool));
+    }
+  else
+    {
+      /* Write the final line. */
+
+      svn_stringbuf_t *trailer
+        = svn_fs_fs__unparse_revision_trailer
+                  ((apr_off_t)svn_fs_fs__id_item(new_root_id),
+                   changed_path_offset,
+                   pool);
+      SVN_ERR(svn_io_file_write_full(proto_file, trailer->data, trailer->len,
+                                     NULL, pool));
+    }
+
+  if (ffd->flush_to_disk)
+    SVN_ERR(svn_io_file_flush_to_disk(proto_file, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Lock the proto-rev file of transaction CB->TXN and turn it into the
+   complete revision file for NEW_REV, except for moving it into place.
+   Keep the lock in CB->PROTO_FILE_LOCKCOOKIE.  START_NODE_ID and
+   START_COPY_ID are passed through to write_final_rev().
+
+   None of this depends on the youngest revision in the repository except
+   for the revision number itself and, for old formats, the next node and
+   copy IDs.  Hence, with new formats, this can be done before taking out
+   the write lock; commit_body() then verifies that NEW_REV is still the
+   next revision.
+
+   On failure, undo all changes to the proto-rev and release the lock.
+   Use POOL for allocations. */
+static svn_error_t *
+finalize_proto_rev(struct commit_baton *cb,
+                   svn_revnum_t new_rev,
+                   apr_uint64_t start_node_id,
+                   apr_uint64_t start_copy_id,
+                   apr_pool_t *pool)
+{
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
+  apr_file_t *proto_file;
+  svn_error_t *err;
+
+  /* Get a write handle on the proto revision file. */
+  SVN_ERR(get_writable_proto_rev(&proto_file, &cb->proto_file_lockcookie,
+                                 cb->fs, txn_id, pool));
+
+  cb->checkpoint.proto_rev_size = -1;
+  err = write_final_data(cb, proto_file, new_rev, start_node_id,
+                         start_copy_id, pool);
+  err = svn_error_compose_create(err, svn_io_file_close(proto_file, pool));
+
+  /* Unless we failed, we don't unlock the prototype revision file
+     immediately to avoid a race with another caller writing to the
+     prototype revision file before we commit it. */
+  if (err)
+    {
+      err = svn_error_compose_create(err,
+                                     rollback_proto_rev(&cb->checkpoint,
+                                                        cb->fs, txn_id,
+                                                        pool));
+      err = svn_error_compose_create(err,
+                                     unlock_proto_rev(cb->fs, txn_id,
+                                                 cb->proto_file_lockcookie,
+                                                 pool));
+      cb->proto_file_lockcookie = NULL;
+
+      return svn_error_trace(err);
+    }
+
+  cb->prepared_rev = new_rev;
+  cb->prepared_format = ((fs_fs_data_t *)cb->fs->fsap_data)->format;
+
+  return SVN_NO_ERROR;
+}
+
+/* Undo the effects of finalize_proto_rev() for CB->TXN, if any, and
+   release the proto-rev lock.  Use POOL for temporary allocations. */
+static svn_error_t *
+abort_finalization(struct commit_baton *cb,
+                   apr_pool_t *pool)
+{
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
+  svn_error_t *err;
+
+  if (!cb->proto_file_lockcookie)
+    return SVN_NO_ERROR;
+
+  err = rollback_proto_rev(&cb->checkpoint, cb->fs, txn_id, pool);
+  err = svn_error_compose_create(err,
+                                 unlock_proto_rev(cb->fs, txn_id,
+                                                  cb->proto_file_lockcookie,
+                                                  pool));
+  cb->proto_file_lockcookie = NULL;
+  cb->prepared_rev = SVN_INVALID_REVNUM;
+
+  /* Forget about everything we collected while finalizing. */
+  apr_array_clear(cb->directory_ids);
+  if (cb->reps_to_cache)
+    apr_array_clear(cb->reps_to_cache);
+  if (cb->reps_hash)
+    apr_hash_clear(cb->reps_hash);
+
+  return svn_error_trace(err);
+}
+
 /* The work-horse for svn_fs_fs__commit, called with the FS write lock.
    This implements the svn_fs_fs__with_write_lock() 'body' callback
-   type.  BATON is a 'struct commit_baton *'. */
+   type.  BATON is a 'struct commit_baton *'.
+
+   If the proto-rev file has already been finalized by our caller, all
+   that is left to do here is to verify that its revision number is
+   still correct and to publish the new revision. */
 static svn_error_t *
 commit_body(void *baton, apr_pool_t *pool)
 {
@@ -3744,17 +4207,12 @@ commit_body(void *baton, apr_pool_t *pool)
   fs_fs_data_t *ffd = cb->fs->fsap_data;
   const char *old_rev_filename, *rev_filename, *proto_filename;
   const char *revprop_filename;
-  const svn_fs_id_t *root_id, *new_root_id;
   apr_uint64_t start_node_id;
   apr_uint64_t start_copy_id;
   svn_revnum_t old_rev, new_rev;
-  apr_file_t *proto_file;
-  void *proto_file_lockcookie;
-  apr_off_t initial_offset, changed_path_offset;
   const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
-  apr_hash_t *changed_paths;
-  apr_array_header_t *directory_ids = apr_array_make(pool, 4,
-                                                     sizeof(pair_cache_key_t));
+  svn_io__batch_fsync_t *batch;
+  void *proto_file_lockcookie;
 
   /* Re-Read the current repository format.  All our repo upgrade and
      config evaluation strategies are such that existing information in
@@ -3785,65 +4243,33 @@ commit_body(void *baton, apr_pool_t *pool)
     return svn_error_create(SVN_ERR_FS_TXN_OUT_OF_DATE, NULL,
                             _("Transaction out of date"));
 
-  /* We need the changes list for verification as well as for writing it
-     to the final rev file. */
-  SVN_ERR(svn_fs_fs__txn_changes_fetch(&changed_paths, cb->fs, txn_id,
-                                       pool));
-
   /* Locks may have been added (or stolen) between the calling of
      previous svn_fs.h functions and svn_fs_commit_txn(), so we need
      to re-examine every changed-path in the txn and re-verify all
      discovered locks. */
-  SVN_ERR(verify_locks(cb->fs, txn_id, changed_paths, pool));
+  SVN_ERR(verify_locks(cb->fs, txn_id, cb->changed_paths, pool));
 
   /* We are going to be one better than this puny old revision. */
   new_rev = old_rev + 1;
 
-  /* Get a write handle on the proto revision file. */
-  SVN_ERR(get_writable_proto_rev(&proto_file, &proto_file_lockcookie,
-                                 cb->fs, txn_id, pool));
-  SVN_ERR(svn_io_file_get_offset(&initial_offset, proto_file, pool));
-
-  /* Write out all the node-revisions and directory contents. */
-  root_id = svn_fs_fs__id_txn_create_root(txn_id, pool);
-  SVN_ERR(write_final_rev(&new_root_id, proto_file, new_rev, cb->fs, root_id,
-                          start_node_id, start_copy_id, initial_offset,
-                          directory_ids, cb->reps_to_cache, cb->reps_hash,
-                          cb->reps_pool, TRUE, pool));
-
-  /* Write the changed-path information. */
-  SVN_ERR(write_final_changed_path_info(&changed_path_offset, proto_file,
-                                        cb->fs, txn_id, changed_paths,
-                                        pool));
+  /* A format upgrade invalidates whatever has been prepared. */
+  if (SVN_IS_VALID_REVNUM(cb->prepared_rev)
+      && cb->prepared_format != ffd->format)
+    SVN_ERR(abort_finalization(cb, pool));
 
-  if (svn_fs_fs__use_log_addressing(cb->fs))
-    {
-      /* Append the index data to the rev file. */
-      SVN_ERR(svn_fs_fs__add_index_data(cb->fs, proto_file,
-                      svn_fs_fs__path_l2p_proto_index(cb->fs, txn_id, pool),
-                      svn_fs_fs__path_p2l_proto_index(cb->fs, txn_id, pool),
-                      new_rev, pool));
-    }
+  /* Finalize the proto-rev file now, unless our caller already did. */
+  if (SVN_IS_VALID_REVNUM(cb->prepared_rev))
+    SVN_ERR_ASSERT(cb->prepared_rev == new_rev);
   else
-    {
-      /* Write the final line. */
-
-      svn_stringbuf_t *trailer
-        = svn_fs_fs__unparse_revision_trailer
-                  ((apr_off_t)svn_fs_fs__id_item(new_root_id),
-                   changed_path_offset,
-                   pool);
-      SVN_ERR(svn_io_file_write_full(proto_file, trailer->data, trailer->len,
-                                     NULL, pool));
-    }
-
-  if (ffd->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(proto_file, pool));
-  SVN_ERR(svn_io_file_close(proto_file, pool));
-
-  /* We don't unlock the prototype revision file immediately to avoid a
-     race with another caller writing to the prototype revision file
-     before we commit it. */
+    SVN_ERR(finalize_proto_rev(cb, new_rev, start_node_id, start_copy_id,
+                               pool));
+
+  /* Collect all files and directories that need to be flushed to disk
+     before we may bump 'current' and flush them in one go.  Their fsyncs
+     then run concurrently instead of one after another.  The rev file
+     contents have already been flushed by finalize_proto_rev(). */
+  SVN_ERR(svn_io__batch_fsync_create(&batch, ffd->flush_to_disk, pool));
+  proto_filename = svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id, pool);
 
   /* Create the shard for the rev and revprop file, if we're sharding and
      this is the first revision of a new shard.  We don't care if this
@@ -3863,6 +4289,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_io__batch_fsync_new_path(batch, new_dir, pool));
         }
 
       /* Create the revprops shard. */
@@ -3879,6 +4306,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVPROPS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_io__batch_fsync_new_path(batch, new_dir, pool));
         }
     }
 
@@ -3889,22 +4317,28 @@ commit_body(void *baton, apr_pool_t *pool)
      ### not complete for any reason the transaction will be lost. */
   old_rev_filename = svn_fs_fs__path_rev_absolute(cb->fs, old_rev, pool);
   rev_filename = svn_fs_fs__path_rev(cb->fs, new_rev, pool);
-  proto_filename = svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id, pool);
-  SVN_ERR(svn_fs_fs__move_into_place(proto_filename, rev_filename,
-                                     old_rev_filename, ffd->flush_to_disk,
-                                     pool));
+  SVN_ERR(move_into_place_batched(proto_filename, rev_filename,
+                                  old_rev_filename, batch,
+                                  ffd->flush_to_disk, pool));
 
   /* Now that we've moved the prototype revision file out of the way,
      we can unlock it (since further attempts to write to the file
      will fail as it no longer exists).  We must do this so that we can
-     remove the transaction directory later. */
+     remove the transaction directory later.  There is no way back. */
+  cb->checkpoint.proto_rev_size = -1;
+  proto_file_lockcookie = cb->proto_file_lockcookie;
+  cb->proto_file_lockcookie = NULL;
   SVN_ERR(unlock_proto_rev(cb->fs, txn_id, proto_file_lockcookie, pool));
 
   /* Write final revprops file. */
   SVN_ERR_ASSERT(! svn_fs_fs__is_packed_revprop(cb->fs, new_rev));
   revprop_filename = svn_fs_fs__path_revprops(cb->fs, new_rev, pool);
   SVN_ERR(write_final_revprop(revprop_filename, old_rev_filename,
-                              cb->txn, ffd->flush_to_disk, pool));
+                              cb->txn, batch, pool));
+
+  /* Make the revision contents, its revprops and all new directory
+     entries durable. */
+  SVN_ERR(svn_io__batch_fsync_run(batch, pool));
 
   /* Run paranoia checks. */
   if (ffd->verify_before_commit)
@@ -3925,9 +4359,8 @@ commit_body(void *baton, apr_pool_t *pool)
 
   ffd->youngest_rev_cache = new_rev;
 
-  /* Make the directory contents alreday cached for the new revision
-   * visible. */
-  SVN_ERR(promote_cached_directories(cb->fs, directory_ids, pool));
+  /* Cache the contents of the directories written for the new revision. */
+  SVN_ERR(cache_new_directories(cb->fs, cb->directory_ids, pool));
 
   /* Remove this transaction directory. */
   SVN_ERR(svn_fs_fs__purge_txn(cb->fs, cb->txn->id, pool));
@@ -3935,25 +4368,6 @@ commit_body(void *baton, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
-/* Add the representations in REPS_TO_CACHE (an array of representation_t *)
- * to the rep-cache database of FS. */
-static svn_error_t *
-write_reps_to_cache(svn_fs_t *fs,
-                    const apr_array_header_t *reps_to_cache,
-                    apr_pool_t *scratch_pool)
-{
-  int i;
-
-  for (i = 0; i < reps_to_cache->nelts; i++)
-    {
-      representation_t *rep = APR_ARRAY_IDX(reps_to_cache, i, representation_t *);
-
-      SVN_ERR(svn_fs_fs__set_rep_reference(fs, rep, scratch_pool));
-    }
-
-  return SVN_NO_ERROR;
-}
-
 svn_error_t *
 svn_fs_fs__commit(svn_revnum_t *new_rev_p,
                   svn_fs_t *fs,
@@ -3962,10 +4376,16 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
 {
   struct commit_baton cb;
   fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
 
   cb.new_rev_p = new_rev_p;
   cb.fs = fs;
   cb.txn = txn;
+  cb.directory_ids = apr_array_make(pool, 4, sizeof(dir_to_cache_t));
+  cb.prepared_rev = SVN_INVALID_REVNUM;
+  cb.prepared_format = 0;
+  cb.proto_file_lockcookie = NULL;
+  cb.checkpoint.proto_rev_size = -1;
 
   if (ffd->rep_sharing_allowed)
     {
@@ -3980,40 +4400,47 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
       cb.reps_pool = NULL;
     }
 
-  SVN_ERR(svn_fs_fs__with_write_lock(fs, commit_body, &cb, pool));
+  /* We need the changes list for verification as well as for writing it
+     to the final rev file. */
+  SVN_ERR(svn_fs_fs__txn_changes_fetch(&cb.changed_paths, fs,
+                                       svn_fs_fs__txn_get_id(txn), pool));
+
+  /* Turning TXN into a revision mostly does not need the write lock.
+     If TXN is likely to become the next revision, do that work now to
+     keep the time that other commits must wait for the lock short. */
+  SVN_ERR(svn_fs_fs__read_format_file(fs, pool));
+  if (ffd->format >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT)
+    {
+      svn_revnum_t youngest;
+
+      SVN_ERR(svn_fs_fs__youngest_rev(&youngest, fs, pool));
+      if (youngest == txn->base_rev)
+        SVN_ERR(finalize_proto_rev(&cb, youngest + 1, 0, 0, pool));
+    }
+
+  /* If the commit fails, e.g. because TXN is out of date by now, revert
+     the proto-rev such that the caller may merge and retry. */
+  err = svn_fs_fs__with_write_lock(fs, commit_body, &cb, pool);
+  if (err)
+    return svn_error_compose_create(err, abort_finalization(&cb, pool));
 
   /* At this point, *NEW_REV_P has been set, so errors below won't affect
      the success of the commit.  (See svn_fs_commit_txn().)  */
 
   if (ffd->rep_sharing_allowed)
     {
-      svn_error_t *err;
-
-      SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
-
-      /* Write new entries to the rep-sharing database.
-       *
-       * We use an sqlite transaction to speed things up;
-       * see <http://www.sqlite.org/faq.html#q19>.
+      /* Write new entries to the rep-sharing database, unless we have
+       * been asked to collect them over multiple revisions.
        */
       /* ### A commit that touches thousands of files will starve other
              (reader/writer) commits for the duration of the below call.
              Maybe write in batches? */
-      SVN_ERR(svn_sqlite__begin_transaction(ffd->rep_cache_db));
-      err = write_reps_to_cache(fs, cb.reps_to_cache, pool);
-      err = svn_sqlite__finish_transaction(ffd->rep_cache_db, err);
-
-      if (svn_error_find_cause(err, SVN_ERR_SQLITE_ROLLBACK_FAILED))
-        {
-          /* Failed rollback means that our db connection is unusable, and
-             the only thing we can do is close it.  The connection will be
-             reopened during the next operation with rep-cache.db. */
-          return svn_error_trace(
-              svn_error_compose_create(err,
-                                       svn_fs_fs__close_rep_cache(fs)));
-        }
-      else if (err)
-        return svn_error_trace(err);
+      if (ffd->rep_cache_batch > 1)
+        SVN_ERR(svn_fs_fs__defer_rep_references(fs, cb.reps_to_cache,
+                                                pool));
+      else
+        SVN_ERR(svn_fs_fs__write_rep_references(fs, cb.reps_to_cache,
+                                                pool));
     }
 
   return SVN_NO_ERROR;
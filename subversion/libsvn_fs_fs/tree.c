@@ -3304,6 +3304,30 @@ fs_get_file_delta_stream(svn_txdelta_stream_t **stream_p,
                                               target_node, pool);
 }
 
+static svn_error_t *
+fs_get_stored_svndiff(svn_stream_t **svndiff_p,
+                      svn_filesize_t *len_p,
+                      svn_fs_root_t *source_root,
+                      const char *source_path,
+                      svn_fs_root_t *target_root,
+                      const char *target_path,
+                      int max_version,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  dag_node_t *source_node, *target_node;
+
+  if (source_root && source_path)
+    SVN_ERR(get_dag(&source_node, source_root, source_path, scratch_pool));
+  else
+    source_node = NULL;
+  SVN_ERR(get_dag(&target_node, target_root, target_path, scratch_pool));
+
+  return svn_fs_fs__dag_get_stored_svndiff(svndiff_p, len_p, source_node,
+                                           target_node, max_version,
+                                           result_pool, scratch_pool);
+}
+
 
 
 /* Finding Changes */
@@ -4577,6 +4601,7 @@ static root_vtable_t root_vtable = {
   fs_apply_text,
   fs_contents_changed,
   fs_get_file_delta_stream,
+  fs_get_stored_svndiff,
   fs_merge,
   fs_get_mergeinfo,
 };
@@ -24,6 +24,7 @@
 #include "svn_checksum.h"
 #include "svn_time.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_task.h"
 
 #include "verify.h"
 #include "fs_fs.h"
@@ -792,6 +793,40 @@ pack_size(svn_fs_t *fs, svn_revnum_t rev)
   return rev < ffd->min_unpacked_rev ? ffd->max_files_per_dir : 1;
 }
 
+/* Run all metadata checks for the rev / pack file that contains the
+ * COUNT revisions starting at PACK_START in FS.  If given, invoke
+ * CANCEL_FUNC with CANCEL_BATON at regular intervals.  Use SCRATCH_POOL
+ * for temporary allocations.
+ */
+static svn_error_t *
+verify_pack_or_rev_file(svn_fs_t *fs,
+                        svn_revnum_t pack_start,
+                        svn_revnum_t count,
+                        svn_cancel_func_t cancel_func,
+                        void *cancel_baton,
+                        apr_pool_t *scratch_pool)
+{
+  /* Check for external corruption to the indexes. */
+  SVN_ERR(verify_index_checksums(fs, pack_start, cancel_func,
+                                 cancel_baton, scratch_pool));
+
+  /* two-way index check */
+  SVN_ERR(compare_l2p_to_p2l_index(fs, pack_start, count,
+                                   cancel_func, cancel_baton, scratch_pool));
+  SVN_ERR(compare_p2l_to_l2p_index(fs, pack_start, count,
+                                   cancel_func, cancel_baton, scratch_pool));
+
+  /* verify in-index checksums and types vs. actual rev / pack files */
+  SVN_ERR(compare_p2l_to_rev(fs, pack_start, count,
+                             cancel_func, cancel_baton, scratch_pool));
+
+  /* ensure that revprops are available and accessible */
+  SVN_ERR(verify_revprops(fs, pack_start, pack_start + count,
+                          cancel_func, cancel_baton, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Verify that on-disk representation has not been tempered with (in a way
  * that leaves the repository in a corrupted state).  This compares log-to-
  * phys with phys-to-log indexes, verifies the low-level checksums and
@@ -828,27 +863,8 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
       if (notify_func && (pack_start % ffd->max_files_per_dir == 0))
         notify_func(pack_start, notify_baton, iterpool);
 
-      /* Check for external corruption to the indexes. */
-      err = verify_index_checksums(fs, pack_start, cancel_func,
-                                   cancel_baton, iterpool);
-
-      /* two-way index check */
-      if (!err)
-        err = compare_l2p_to_p2l_index(fs, pack_start, pack_end - pack_start,
-                                       cancel_func, cancel_baton, iterpool);
-      if (!err)
-        err = compare_p2l_to_l2p_index(fs, pack_start, pack_end - pack_start,
-                                       cancel_func, cancel_baton, iterpool);
-
-      /* verify in-index checksums and types vs. actual rev / pack files */
-      if (!err)
-        err = compare_p2l_to_rev(fs, pack_start, pack_end - pack_start,
-                                 cancel_func, cancel_baton, iterpool);
-
-      /* ensure that revprops are available and accessible */
-      if (!err)
-        err = verify_revprops(fs, pack_start, pack_end,
-                              cancel_func, cancel_baton, iterpool);
+      err = verify_pack_or_rev_file(fs, pack_start, count,
+                                    cancel_func, cancel_baton, iterpool);
 
       /* concurrent packing is one of the reasons why verification may fail.
          Make sure, we operate on up-to-date information. */
@@ -884,6 +900,196 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* A rev / pack file to verify in verify_f7_metadata_concurrently(). */
+typedef struct verify_unit_t
+{
+  /* First revision in the file. */
+  svn_revnum_t pack_start;
+
+  /* Number of revisions in the file. */
+  svn_revnum_t count;
+} verify_unit_t;
+
+/* Baton type used with svn_task__run() by
+ * verify_f7_metadata_concurrently(). */
+typedef struct verify_task_baton_t
+{
+  /* The filesystem being verified.  Only to be used by the main thread
+   * and as a template for the worker instances. */
+  svn_fs_t *fs;
+
+  /* Array of verify_unit_t, in revision order. */
+  apr_array_header_t *units;
+
+  /* Last revision to verify. */
+  svn_revnum_t end;
+
+  /* All revisions below this one have been verified. */
+  svn_revnum_t verified;
+
+  /* Progress notification. */
+  svn_fs_progress_notify_func_t notify_func;
+  void *notify_baton;
+
+  /* Cancellation support, used by the main thread. */
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} verify_task_baton_t;
+
+/* Implements svn_task__thread_context_constructor_t.
+ * Open a private instance of the verify_task_baton_t's filesystem. */
+static svn_error_t *
+open_fs_for_thread(void **thread_context,
+                   void *baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  verify_task_baton_t *task_baton = baton;
+  svn_fs_t *fs;
+
+  SVN_ERR(svn_fs_fs__open_clone(&fs, task_baton->fs, result_pool,
+                                scratch_pool));
+  *thread_context = fs;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+ * Verify the unit given by INDEX and return the svn_error_t * outcome
+ * as *RESULT.  Only cancellation is being reported as a real error. */
+static svn_error_t *
+verify_unit_task(void **result,
+                 void *thread_context,
+                 void *process_baton,
+                 apr_int64_t index,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  verify_task_baton_t *task_baton = process_baton;
+  const verify_unit_t *unit = &APR_ARRAY_IDX(task_baton->units, (int)index,
+                                             verify_unit_t);
+  svn_error_t **err_p = apr_palloc(result_pool, sizeof(*err_p));
+
+  *err_p = verify_pack_or_rev_file(thread_context, unit->pack_start,
+                                   unit->count, cancel_func, cancel_baton,
+                                   scratch_pool);
+  if (*err_p && (*err_p)->apr_err == SVN_ERR_CANCELLED)
+    return svn_error_trace(*err_p);
+
+  *result = err_p;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * Report progress and errors in revision order.  Re-verify sections
+ * that got packed while we were verifying them. */
+static svn_error_t *
+verify_unit_output(void *result,
+                   void *output_baton,
+                   apr_int64_t index,
+                   apr_pool_t *scratch_pool)
+{
+  verify_task_baton_t *task_baton = output_baton;
+  svn_fs_t *fs = task_baton->fs;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const verify_unit_t *unit = &APR_ARRAY_IDX(task_baton->units, (int)index,
+                                             verify_unit_t);
+  svn_error_t *err = *(svn_error_t **)result;
+  svn_revnum_t pack_end = unit->pack_start + unit->count;
+
+  /* Already covered by a re-verification of a larger pack file? */
+  if (pack_end <= task_baton->verified)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  if (   task_baton->notify_func
+      && (unit->pack_start % ffd->max_files_per_dir == 0))
+    task_baton->notify_func(unit->pack_start, task_baton->notify_baton,
+                            scratch_pool);
+
+  if (err)
+    {
+      /* concurrent packing is one of the reasons why verification may
+         fail.  Make sure, we operate on up-to-date information. */
+      svn_error_t *err2
+        = svn_fs_fs__read_min_unpacked_rev(&ffd->min_unpacked_rev,
+                                           fs, scratch_pool);
+      if (err2)
+        return svn_error_trace(svn_error_compose_create(err, err2));
+
+      if (unit->count == pack_size(fs, unit->pack_start))
+        return svn_error_trace(err);
+
+      /* The shard got packed in the meantime.  Verify the whole pack file
+         in this thread.  Later units that it covers will be skipped. */
+      svn_error_clear(err);
+      pack_end = svn_fs_fs__packed_base_rev(fs, unit->pack_start)
+               + pack_size(fs, unit->pack_start);
+      SVN_ERR(verify_f7_metadata_consistency(fs, unit->pack_start,
+                                             MIN(pack_end - 1,
+                                                 task_baton->end),
+                                             NULL, NULL,
+                                             task_baton->cancel_func,
+                                             task_baton->cancel_baton,
+                                             scratch_pool));
+    }
+
+  task_baton->verified = pack_end;
+
+  return SVN_NO_ERROR;
+}
+
+/* Same as verify_f7_metadata_consistency but verify up to FFD->JOBS
+ * rev / pack files concurrently.  Errors and progress notifications will
+ * still be reported in revision order.
+ */
+static svn_error_t *
+verify_f7_metadata_concurrently(svn_fs_t *fs,
+                                svn_revnum_t start,
+                                svn_revnum_t end,
+                                svn_fs_progress_notify_func_t notify_func,
+                                void *notify_baton,
+                                svn_cancel_func_t cancel_func,
+                                void *cancel_baton,
+                                apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  verify_task_baton_t baton = { 0 };
+  svn_revnum_t revision;
+
+  baton.fs = fs;
+  baton.end = end;
+  baton.verified = start;
+  baton.notify_func = notify_func;
+  baton.notify_baton = notify_baton;
+  baton.cancel_func = cancel_func;
+  baton.cancel_baton = cancel_baton;
+
+  /* Split the range into independent rev / pack files. */
+  baton.units = apr_array_make(pool, 16, sizeof(verify_unit_t));
+  for (revision = start; revision <= end; )
+    {
+      verify_unit_t *unit = apr_array_push(baton.units);
+      unit->count = pack_size(fs, revision);
+      unit->pack_start = svn_fs_fs__packed_base_rev(fs, revision);
+
+      revision = unit->pack_start + unit->count;
+    }
+
+  SVN_ERR(svn_task__run(ffd->jobs, baton.units->nelts,
+                        open_fs_for_thread, &baton,
+                        verify_unit_task, &baton,
+                        verify_unit_output, &baton,
+                        cancel_func, cancel_baton, pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__verify(svn_fs_t *fs,
                   svn_revnum_t start,
@@ -910,9 +1116,18 @@ svn_fs_fs__verify(svn_fs_t *fs,
   /* log/phys index consistency.  We need to check them first to make
      sure we can access the rev / pack files in format7. */
   if (svn_fs_fs__use_log_addressing(fs))
-    SVN_ERR(verify_f7_metadata_consistency(fs, start, end,
-                                           notify_func, notify_baton,
-                                           cancel_func, cancel_baton, pool));
+    {
+      if (ffd->jobs > 1)
+        SVN_ERR(verify_f7_metadata_concurrently(fs, start, end,
+                                                notify_func, notify_baton,
+                                                cancel_func, cancel_baton,
+                                                pool));
+      else
+        SVN_ERR(verify_f7_metadata_consistency(fs, start, end,
+                                               notify_func, notify_baton,
+                                               cancel_func, cancel_baton,
+                                               pool));
+    }
 
   /* rep cache consistency */
   if (ffd->format >= SVN_FS_FS__MIN_REP_SHARING_FORMAT)
@@ -32,7 +32,6 @@
 #include "svn_delta.h"
 #include "svn_version.h"
 #include "svn_pools.h"
-#include "batch_fsync.h"
 #include "fs.h"
 #include "fs_x.h"
 #include "pack.h"
@@ -48,6 +47,7 @@
 #include "util.h"
 #include "svn_private_config.h"
 #include "private/svn_fs_util.h"
+#include "private/svn_io_private.h"
 
 #include "../libsvn_fs/fs-loader.h"
 
@@ -292,6 +292,7 @@ static fs_vtable_t fs_vtable = {
   x_refresh_revprops,
   svn_fs_x__revision_prop,
   x_revision_proplist,
+  NULL /* revision_proplists */,
   svn_fs_x__change_rev_prop,
   x_set_uuid,
   svn_fs_x__revision_root,
@@ -667,7 +668,7 @@ svn_fs_x__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(x_version(), checklist, svn_ver_equal));
 
-  SVN_ERR(svn_fs_x__batch_fsync_init(common_pool));
+  SVN_ERR(svn_io__batch_fsync_init(common_pool));
 
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
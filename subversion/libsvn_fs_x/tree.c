@@ -3227,6 +3227,7 @@ static root_vtable_t root_vtable = {
   x_apply_text,
   x_contents_changed,
   x_get_file_delta_stream,
+  NULL /* get_stored_svndiff */,
   x_merge,
   x_get_mergeinfo,
 };
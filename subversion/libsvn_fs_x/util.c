@@ -704,7 +704,7 @@ svn_error_t *
 svn_fs_x__move_into_place(const char *old_filename,
                           const char *new_filename,
                           const char *perms_reference,
-                          svn_fs_x__batch_fsync_t *batch,
+                          svn_io__batch_fsync_t *batch,
                           apr_pool_t *scratch_pool)
 {
   /* Copying permissions is a no-op on WIN32. */
@@ -723,7 +723,7 @@ svn_fs_x__move_into_place(const char *old_filename,
                               scratch_pool));
 
   /* Schedule for synchronization. */
-  SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, new_filename, scratch_pool));
+  SVN_ERR(svn_io__batch_fsync_new_path(batch, new_filename, scratch_pool));
 #else
   SVN_ERR(svn_io_file_rename2(old_filename, new_filename, TRUE,
                               scratch_pool));
@@ -1925,6 +1925,11 @@ negotiate_put_encoding(int *svndiff_version_p,
       svndiff_version = 0;
     }
 
+  /* Svndiff3 uses the same compression as svndiff2 but encodes the
+   * delta instructions more compactly. */
+  if (svndiff_version == 2 && session->supports_svndiff3)
+    svndiff_version = 3;
+
   if (svndiff_version == 0)
     compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
   else
@@ -758,6 +758,7 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   /* supports_rev_rsrc_replay */
   /* supports_svndiff1 */
   /* supports_svndiff2 */
+  /* supports_svndiff3 */
   /* supports_put_result_checksum */
   /* conn_latency */
 
@@ -45,6 +45,8 @@
 #include "private/svn_utf_private.h"
 #include "private/svn_cache.h"
 #include "private/svn_fspath.h"
+#include "private/svn_task.h"
+#include "private/svn_subr_private.h"
 
 #define ARE_VALID_COPY_ARGS(p,r) ((p) && SVN_IS_VALID_REVNUM(r))
 
@@ -315,29 +317,55 @@ tracker_path_delete(path_tracker_t *tracker,
 }
 
 
-/* Compute the delta between OLDROOT/OLDPATH and NEWROOT/NEWPATH and
-   store it into a new temporary file *TEMPFILE.  OLDROOT may be NULL,
-   in which case the delta will be computed against an empty file, as
-   per the svn_fs_get_file_delta_stream docstring.  Record the length
-   of the temporary file in *LEN, and rewind the file before
-   returning. */
+/* Newest svndiff version that we copy as-is from the repository into
+   the dump stream by default.  That is what we would produce ourselves,
+   so any loader can read it. */
+#define DEFAULT_STORED_SVNDIFF_VERSION 0
+
+/* Newest svndiff version that we copy as-is from the repository, if the
+   caller asked for raw deltas.  svndiff1 and svndiff2 need a newer
+   loader.  svndiff3 may use delta windows larger than what other svndiff
+   consumers accept. */
+#define MAX_STORED_SVNDIFF_VERSION 2
+
+/* Set *CONTENTS to the svndiff data of the delta between OLDROOT/OLDPATH
+   and NEWROOT/NEWPATH and *LEN to its length.  OLDROOT may be NULL, in
+   which case the delta will be against an empty file, as per the
+   svn_fs_get_file_delta_stream docstring.
+
+   If the repository stores exactly that delta in an svndiff version no
+   newer than DEFAULT_STORED_SVNDIFF_VERSION, or MAX_STORED_SVNDIFF_VERSION
+   if RAW_DELTAS is set, simply read the stored svndiff data.  Otherwise,
+   compute the delta and store it into a new temporary file, which will be
+   removed when *CONTENTS gets closed. */
 static svn_error_t *
-store_delta(apr_file_t **tempfile, svn_filesize_t *len,
+store_delta(svn_stream_t **contents, svn_filesize_t *len,
             svn_fs_root_t *oldroot, const char *oldpath,
-            svn_fs_root_t *newroot, const char *newpath, apr_pool_t *pool)
+            svn_fs_root_t *newroot, const char *newpath,
+            svn_boolean_t raw_deltas, apr_pool_t *pool)
 {
+  apr_file_t *tempfile;
   svn_stream_t *temp_stream;
   apr_off_t offset;
   svn_txdelta_stream_t *delta_stream;
   svn_txdelta_window_handler_t wh;
   void *whb;
 
+  SVN_ERR(svn_fs__get_stored_svndiff(contents, len, oldroot, oldpath,
+                                     newroot, newpath,
+                                     raw_deltas
+                                       ? MAX_STORED_SVNDIFF_VERSION
+                                       : DEFAULT_STORED_SVNDIFF_VERSION,
+                                     pool, pool));
+  if (*contents)
+    return SVN_NO_ERROR;
+
   /* Create a temporary file and open a stream to it. Note that we need
      the file handle in order to rewind it. */
-  SVN_ERR(svn_io_open_unique_file3(tempfile, NULL, NULL,
+  SVN_ERR(svn_io_open_unique_file3(&tempfile, NULL, NULL,
                                    svn_io_file_del_on_pool_cleanup,
                                    pool, pool));
-  temp_stream = svn_stream_from_aprfile2(*tempfile, TRUE, pool);
+  temp_stream = svn_stream_from_aprfile2(tempfile, TRUE, pool);
 
   /* Compute the delta and send it to the temporary file. */
   SVN_ERR(svn_fs_get_file_delta_stream(&delta_stream, oldroot, oldpath,
@@ -347,10 +375,15 @@ store_delta(apr_file_t **tempfile, svn_filesize_t *len,
   SVN_ERR(svn_txdelta_send_txstream(delta_stream, wh, whb, pool));
 
   /* Get the length of the temporary file and rewind it. */
-  SVN_ERR(svn_io_file_get_offset(&offset, *tempfile, pool));
+  SVN_ERR(svn_io_file_get_offset(&offset, tempfile, pool));
   *len = offset;
   offset = 0;
-  return svn_io_file_seek(*tempfile, APR_SET, &offset, pool);
+  SVN_ERR(svn_io_file_seek(tempfile, APR_SET, &offset, pool));
+
+  /* Make sure to close the underlying file when the stream is closed. */
+  *contents = svn_stream_from_aprfile2(tempfile, FALSE, pool);
+
+  return SVN_NO_ERROR;
 }
 
 
@@ -670,6 +703,10 @@ struct edit_baton
   /* True if dumped nodes should output deltas instead of full text. */
   svn_boolean_t use_deltas;
 
+  /* True if stored deltas may be copied in any svndiff version that
+     other consumers accept. */
+  svn_boolean_t raw_deltas;
+
   /* True if this "dump" is in fact a verify. */
   svn_boolean_t verify;
 
@@ -1125,7 +1162,7 @@ dump_node(struct edit_baton *eb,
   const char *compare_path = path;
   svn_revnum_t compare_rev = eb->current_rev - 1;
   svn_fs_root_t *compare_root = NULL;
-  apr_file_t *delta_file = NULL;
+  svn_stream_t *delta_contents = NULL;
   svn_repos__dumpfile_headers_t *headers
     = svn_repos__dumpfile_headers_create(pool);
   svn_filesize_t textlen;
@@ -1451,11 +1488,12 @@ dump_node(struct edit_baton *eb,
 
       if (eb->use_deltas)
         {
-          /* Compute the text delta now and write it into a temporary
-             file, so that we can find its length.  Output a header
-             saying our text contents are a delta. */
-          SVN_ERR(store_delta(&delta_file, &textlen, compare_root,
-                              compare_path, eb->fs_root, path, pool));
+          /* Fetch or compute the text delta now, so that we can find
+             its length.  Output a header saying our text contents are
+             a delta. */
+          SVN_ERR(store_delta(&delta_contents, &textlen, compare_root,
+                              compare_path, eb->fs_root, path,
+                              eb->raw_deltas, pool));
           svn_repos__dumpfile_header_push(
             headers, SVN_REPOS_DUMPFILE_TEXT_DELTA, "true");
 
@@ -1514,12 +1552,8 @@ dump_node(struct edit_baton *eb,
     {
       svn_stream_t *contents;
 
-      if (delta_file)
-        {
-          /* Make sure to close the underlying file when the stream is
-             closed. */
-          contents = svn_stream_from_aprfile2(delta_file, FALSE, pool);
-        }
+      if (delta_contents)
+        contents = delta_contents;
       else
         SVN_ERR(svn_fs_file_contents(&contents, eb->fs_root, path, pool));
 
@@ -1878,6 +1912,7 @@ get_dump_editor(const svn_delta_editor_t **editor,
                 void *notify_baton,
                 svn_revnum_t oldest_dumped_rev,
                 svn_boolean_t use_deltas,
+                svn_boolean_t raw_deltas,
                 svn_boolean_t verify,
                 svn_boolean_t check_normalization,
                 apr_pool_t *pool)
@@ -1900,6 +1935,7 @@ get_dump_editor(const svn_delta_editor_t **editor,
   eb->fs = fs;
   eb->current_rev = to_rev;
   eb->use_deltas = use_deltas;
+  eb->raw_deltas = raw_deltas;
   eb->verify = verify;
   eb->check_normalization = check_normalization;
   eb->found_old_reference = found_old_reference;
@@ -1945,6 +1981,43 @@ get_dump_editor(const svn_delta_editor_t **editor,
 /** The main dumping routine, svn_repos_dump_fs. **/
 
 
+/* Implements svn_repos_notify_func_t.  Append a copy of NOTIFY to the
+ * apr_array_header_t of svn_repos_notify_t * given as BATON. */
+static void
+capture_notification(void *baton,
+                     const svn_repos_notify_t *notify,
+                     apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *notifications = baton;
+  svn_repos_notify_t *copy = apr_pmemdup(notifications->pool, notify,
+                                         sizeof(*notify));
+
+  copy->warning_str = apr_pstrdup(notifications->pool, notify->warning_str);
+  copy->path = apr_pstrdup(notifications->pool, notify->path);
+
+  APR_ARRAY_PUSH(notifications, svn_repos_notify_t *) = copy;
+}
+
+/* Pool cleanup handler.  Clear the svn_error_t * that DATA points to.
+ * Used for task results whose errors may never get reported. */
+static apr_status_t
+clear_result_error(void *data)
+{
+  svn_error_t **err = data;
+
+  svn_error_clear(*err);
+  *err = SVN_NO_ERROR;
+
+  return APR_SUCCESS;
+}
+
+/* A warning handling function that does not abort on errors. */
+static void
+verify_warning_func(void *baton,
+                    svn_error_t *err)
+{
+}
+
 /* Helper for svn_repos_dump_fs.
 
    Write a revision record of REV in REPOS to writable STREAM, using POOL.
@@ -2008,16 +2081,391 @@ dump_filter_authz_func(svn_boolean_t *allowed,
 
 
 
+/* Write the dump records of revision REV in REPOS to STREAM.  Report
+ * references to revisions older than START_REV in *FOUND_OLD_REFERENCE
+ * and *FOUND_OLD_MERGEINFO.  The other parameters are the same as for
+ * svn_repos_dump_fs5().  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+dump_revision(svn_stream_t *stream,
+              svn_repos_t *repos,
+              svn_revnum_t rev,
+              svn_revnum_t start_rev,
+              svn_boolean_t incremental,
+              svn_boolean_t use_deltas,
+              svn_boolean_t raw_deltas,
+              svn_boolean_t include_revprops,
+              svn_boolean_t include_changes,
+              svn_boolean_t *found_old_reference,
+              svn_boolean_t *found_old_mergeinfo,
+              svn_repos_notify_func_t notify_func,
+              void *notify_baton,
+              svn_repos_authz_func_t authz_func,
+              void *authz_baton,
+              apr_pool_t *scratch_pool)
+{
+  const svn_delta_editor_t *dump_editor;
+  void *dump_edit_baton = NULL;
+  svn_fs_t *fs = svn_repos_fs(repos);
+  svn_fs_root_t *to_root;
+  svn_boolean_t use_deltas_for_rev;
+
+  /* Write the revision record. */
+  SVN_ERR(write_revision_record(stream, repos, rev, include_revprops,
+                                authz_func, authz_baton, scratch_pool));
+
+  /* When dumping revision 0, we just write out the revision record.
+     The parser might want to use its properties.
+     If we don't want revision changes at all, skip in any case. */
+  if (rev == 0 || !include_changes)
+    return SVN_NO_ERROR;
+
+  /* Fetch the editor which dumps nodes to a file.  Regardless of
+     what we've been told, don't use deltas for the first rev of a
+     non-incremental dump. */
+  use_deltas_for_rev = use_deltas && (incremental || rev != start_rev);
+  SVN_ERR(get_dump_editor(&dump_editor, &dump_edit_baton, fs, rev,
+                          "", stream, found_old_reference,
+                          found_old_mergeinfo, NULL,
+                          notify_func, notify_baton,
+                          start_rev, use_deltas_for_rev, raw_deltas,
+                          FALSE, FALSE, scratch_pool));
+
+  /* Drive the editor in one way or another. */
+  SVN_ERR(svn_fs_revision_root(&to_root, fs, rev, scratch_pool));
+
+  /* If this is the first revision of a non-incremental dump,
+     we're in for a full tree dump.  Otherwise, we want to simply
+     replay the revision.  */
+  if ((rev == start_rev) && (! incremental))
+    {
+      /* Compare against revision 0, so everything appears to be added. */
+      svn_fs_root_t *from_root;
+      SVN_ERR(svn_fs_revision_root(&from_root, fs, 0, scratch_pool));
+      SVN_ERR(svn_repos_dir_delta2(from_root, "", "",
+                                   to_root, "",
+                                   dump_editor, dump_edit_baton,
+                                   authz_func, authz_baton,
+                                   FALSE, /* don't send text-deltas */
+                                   svn_depth_infinity,
+                                   FALSE, /* don't send entry props */
+                                   FALSE, /* don't ignore ancestry */
+                                   scratch_pool));
+    }
+  else
+    {
+      /* The normal case: compare consecutive revs. */
+      SVN_ERR(svn_repos_replay2(to_root, "", SVN_INVALID_REVNUM, FALSE,
+                                dump_editor, dump_edit_baton,
+                                authz_func, authz_baton, scratch_pool));
+
+      /* While our editor close_edit implementation is a no-op, we still
+         do this for completeness. */
+      SVN_ERR(dump_editor->close_edit(dump_edit_baton, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Keep up to this many bytes of a revision's dump data in memory before
+ * spilling the remainder to a temporary file. */
+#define DUMP_BUFFER_SIZE 0x100000
+
+/* Result of dumping a single revision in dump_revs_concurrently(). */
+typedef struct dump_rev_result_t
+{
+  /* The dump records of this revision. */
+  svn_spillbuf_t *buffer;
+
+  /* Error that occurred while dumping this revision, or NULL. */
+  svn_error_t *err;
+
+  /* Copies of the svn_repos_notify_t * sent while dumping. */
+  apr_array_header_t *notifications;
+
+  /* Flags as reported by dump_revision(). */
+  svn_boolean_t found_old_reference;
+  svn_boolean_t found_old_mergeinfo;
+} dump_rev_result_t;
+
+/* Thread context of the workers in dump_revs_concurrently(). */
+typedef struct dump_thread_context_t
+{
+  /* The worker's private instance of the repository. */
+  svn_repos_t *repos;
+
+  /* Where to put the FS warnings for the revision being dumped. */
+  apr_array_header_t *notifications;
+} dump_thread_context_t;
+
+/* Baton type used with svn_task__run() by dump_revs_concurrently(). */
+typedef struct dump_revs_baton_t
+{
+  /* Repository to dump.  Workers open their own instances of it. */
+  svn_repos_t *repos;
+
+  /* Parameters as passed to svn_repos_dump_fs5(). */
+  svn_stream_t *stream;
+  svn_revnum_t start_rev;
+  svn_boolean_t incremental;
+  svn_boolean_t use_deltas;
+  svn_boolean_t raw_deltas;
+  svn_boolean_t include_revprops;
+  svn_boolean_t include_changes;
+  svn_repos_notify_func_t notify_func;
+  void *notify_baton;
+  svn_repos_authz_func_t authz_func;
+  void *authz_baton;
+
+  /* Flags accumulated over all revisions written so far. */
+  svn_boolean_t found_old_reference;
+  svn_boolean_t found_old_mergeinfo;
+
+  /* Re-usable notification object for svn_repos_notify_dump_rev_end. */
+  svn_repos_notify_t *notify;
+} dump_revs_baton_t;
+
+/* Implements svn_fs_warning_callback_t.  Add ERR as a warning
+ * notification to the current revision of the dump_thread_context_t
+ * BATON.  FS warnings have no svn_repos_notify_warning_t of their own. */
+static void
+capture_fs_warning(void *baton,
+                   svn_error_t *err)
+{
+  dump_thread_context_t *context = baton;
+  apr_array_header_t *notifications = context->notifications;
+  svn_repos_notify_t *notify;
+  char buffer[1024];
+
+  if (notifications == NULL)
+    return;
+
+  notify = svn_repos_notify_create(svn_repos_notify_warning,
+                                   notifications->pool);
+  notify->warning_str
+    = apr_pstrdup(notifications->pool,
+                  svn_err_best_message(err, buffer, sizeof(buffer)));
+
+  APR_ARRAY_PUSH(notifications, svn_repos_notify_t *) = notify;
+}
+
+/* Implements svn_task__thread_context_constructor_t.
+ * Open a private instance of the dump_revs_baton_t's repository. */
+static svn_error_t *
+open_repos_for_thread(void **thread_context,
+                      void *baton,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  dump_revs_baton_t *dump_baton = baton;
+  dump_thread_context_t *context = apr_pcalloc(result_pool,
+                                               sizeof(*context));
+
+  SVN_ERR(svn_repos_open3(&context->repos,
+                          svn_repos_path(dump_baton->repos, scratch_pool),
+                          svn_fs_config(svn_repos_fs(dump_baton->repos),
+                                        result_pool),
+                          result_pool, scratch_pool));
+
+  /* The caller's warning function may not be thread-safe.  Report the
+   * warnings as notifications in revision order instead. */
+  svn_fs_set_warning_func(svn_repos_fs(context->repos), capture_fs_warning,
+                          context);
+
+  *thread_context = context;
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Implements svn_task__process_func_t.
+ * Dump revision START_REV + INDEX and return a dump_rev_result_t. */
+static svn_error_t *
+dump_rev_task(void **result,
+              void *thread_context,
+              void *process_baton,
+              apr_int64_t index,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  dump_revs_baton_t *dump_baton = process_baton;
+  dump_thread_context_t *context = thread_context;
+  dump_rev_result_t *rev_result = apr_pcalloc(result_pool,
+                                              sizeof(*rev_result));
+  svn_stream_t *stream;
+
+  rev_result->buffer = svn_spillbuf__create(SVN__STREAM_CHUNK_SIZE,
+                                            DUMP_BUFFER_SIZE, result_pool);
+  rev_result->notifications = apr_array_make(result_pool, 0,
+                                             sizeof(svn_repos_notify_t *));
+  stream = svn_stream__from_spillbuf(rev_result->buffer, scratch_pool);
+
+  /* Results that never get output must not leak their errors. */
+  apr_pool_cleanup_register(result_pool, &rev_result->err,
+                            clear_result_error, apr_pool_cleanup_null);
+
+  if (dump_baton->notify_func)
+    context->notifications = rev_result->notifications;
+
+  rev_result->err
+    = dump_revision(stream, context->repos,
+                    dump_baton->start_rev + (svn_revnum_t)index,
+                    dump_baton->start_rev, dump_baton->incremental,
+                    dump_baton->use_deltas, dump_baton->raw_deltas,
+                    dump_baton->include_revprops,
+                    dump_baton->include_changes,
+                    &rev_result->found_old_reference,
+                    &rev_result->found_old_mergeinfo,
+                    dump_baton->notify_func ? capture_notification : NULL,
+                    rev_result->notifications,
+                    dump_baton->authz_func, dump_baton->authz_baton,
+                    scratch_pool);
+  context->notifications = NULL;
+
+  if (rev_result->err && rev_result->err->apr_err == SVN_ERR_CANCELLED)
+    {
+      svn_error_t *err = rev_result->err;
+
+      rev_result->err = SVN_NO_ERROR;
+      return svn_error_trace(err);
+    }
+
+  *result = rev_result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * Write the dump data of revision START_REV + INDEX to the output stream
+ * and forward its notifications.  Errors get reported only after all
+ * previous revisions have been written, just like in the sequential
+ * code path. */
+static svn_error_t *
+dump_rev_output(void *result,
+                void *output_baton,
+                apr_int64_t index,
+                apr_pool_t *scratch_pool)
+{
+  dump_revs_baton_t *dump_baton = output_baton;
+  dump_rev_result_t *rev_result = result;
+  svn_error_t *rev_err = rev_result->err;
+  svn_error_t *err = SVN_NO_ERROR;
+  const char *data;
+  int i;
+
+  /* We own the error from now on. */
+  rev_result->err = SVN_NO_ERROR;
+
+  for (i = 0; i < rev_result->notifications->nelts; ++i)
+    dump_baton->notify_func(dump_baton->notify_baton,
+                            APR_ARRAY_IDX(rev_result->notifications, i,
+                                          svn_repos_notify_t *),
+                            scratch_pool);
+
+  dump_baton->found_old_reference |= rev_result->found_old_reference;
+  dump_baton->found_old_mergeinfo |= rev_result->found_old_mergeinfo;
+
+  /* Write whatever got dumped, even if the revision is incomplete. */
+  do
+    {
+      apr_size_t len;
+
+      err = svn_spillbuf__read(&data, &len, rev_result->buffer,
+                               scratch_pool);
+      if (!err && data)
+        err = svn_stream_write(dump_baton->stream, data, &len);
+    }
+  while (!err && data);
+
+  if (err)
+    return svn_error_compose_create(err, rev_err);
+
+  SVN_ERR(rev_err);
+
+  if (dump_baton->notify_func)
+    {
+      dump_baton->notify->revision = dump_baton->start_rev
+                                   + (svn_revnum_t)index;
+      dump_baton->notify_func(dump_baton->notify_baton, dump_baton->notify,
+                              scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Dump revisions START_REV to END_REV of REPOS to STREAM, using up to
+ * JOBS threads.  Every revision gets dumped into a separate spill buffer
+ * and the buffers are written to STREAM in revision order.  Set
+ * *FOUND_OLD_REFERENCE and *FOUND_OLD_MERGEINFO if any dumped revision
+ * refers to revisions older than START_REV.  The other parameters are the
+ * same as for svn_repos_dump_fs5().  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+dump_revs_concurrently(svn_repos_t *repos,
+                       svn_stream_t *stream,
+                       svn_revnum_t start_rev,
+                       svn_revnum_t end_rev,
+                       svn_boolean_t incremental,
+                       svn_boolean_t use_deltas,
+                       svn_boolean_t raw_deltas,
+                       svn_boolean_t include_revprops,
+                       svn_boolean_t include_changes,
+                       int jobs,
+                       svn_boolean_t *found_old_reference,
+                       svn_boolean_t *found_old_mergeinfo,
+                       svn_repos_notify_func_t notify_func,
+                       void *notify_baton,
+                       svn_repos_authz_func_t authz_func,
+                       void *authz_baton,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *scratch_pool)
+{
+  dump_revs_baton_t baton = { 0 };
+  svn_error_t *err;
+
+  baton.repos = repos;
+  baton.stream = stream;
+  baton.start_rev = start_rev;
+  baton.incremental = incremental;
+  baton.use_deltas = use_deltas;
+  baton.raw_deltas = raw_deltas;
+  baton.include_revprops = include_revprops;
+  baton.include_changes = include_changes;
+  baton.notify_func = notify_func;
+  baton.notify_baton = notify_baton;
+  baton.authz_func = authz_func;
+  baton.authz_baton = authz_baton;
+  baton.notify = svn_repos_notify_create(svn_repos_notify_dump_rev_end,
+                                         scratch_pool);
+
+  err = svn_task__run(jobs, end_rev - start_rev + 1,
+                      open_repos_for_thread, &baton,
+                      dump_rev_task, &baton,
+                      dump_rev_output, &baton,
+                      cancel_func, cancel_baton, scratch_pool);
+
+  /* Report what we found in the revisions written so far, even if we
+   * failed somewhere in between. */
+  *found_old_reference |= baton.found_old_reference;
+  *found_old_mergeinfo |= baton.found_old_mergeinfo;
+
+  return svn_error_trace(err);
+}
+
 /* The main dumper. */
 svn_error_t *
-svn_repos_dump_fs4(svn_repos_t *repos,
+svn_repos_dump_fs5(svn_repos_t *repos,
                    svn_stream_t *stream,
                    svn_revnum_t start_rev,
                    svn_revnum_t end_rev,
                    svn_boolean_t incremental,
                    svn_boolean_t use_deltas,
+                   svn_boolean_t raw_deltas,
                    svn_boolean_t include_revprops,
                    svn_boolean_t include_changes,
+                   int jobs,
                    svn_repos_notify_func_t notify_func,
                    void *notify_baton,
                    svn_repos_dump_filter_func_t filter_func,
@@ -2026,8 +2474,6 @@ svn_repos_dump_fs4(svn_repos_t *repos,
                    void *cancel_baton,
                    apr_pool_t *pool)
 {
-  const svn_delta_editor_t *dump_editor;
-  void *dump_edit_baton = NULL;
   svn_revnum_t rev;
   svn_fs_t *fs = svn_repos_fs(repos);
   apr_pool_t *iterpool = svn_pool_create(pool);
@@ -2095,82 +2541,45 @@ svn_repos_dump_fs4(svn_repos_t *repos,
   SVN_ERR(svn_repos__dump_magic_header_record(stream, version, pool));
   SVN_ERR(svn_repos__dump_uuid_header_record(stream, uuid, pool));
 
-  /* Create a notify object that we can reuse in the loop. */
-  if (notify_func)
-    notify = svn_repos_notify_create(svn_repos_notify_dump_rev_end,
-                                     pool);
-
-  /* Main loop:  we're going to dump revision REV.  */
-  for (rev = start_rev; rev <= end_rev; rev++)
+  if (jobs > 1 && start_rev < end_rev)
     {
-      svn_fs_root_t *to_root;
-      svn_boolean_t use_deltas_for_rev;
-
-      svn_pool_clear(iterpool);
-
-      /* Check for cancellation. */
-      if (cancel_func)
-        SVN_ERR(cancel_func(cancel_baton));
-
-      /* Write the revision record. */
-      SVN_ERR(write_revision_record(stream, repos, rev, include_revprops,
-                                    authz_func, &authz_baton, iterpool));
-
-      /* When dumping revision 0, we just write out the revision record.
-         The parser might want to use its properties.
-         If we don't want revision changes at all, skip in any case. */
-      if (rev == 0 || !include_changes)
-        goto loop_end;
-
-      /* Fetch the editor which dumps nodes to a file.  Regardless of
-         what we've been told, don't use deltas for the first rev of a
-         non-incremental dump. */
-      use_deltas_for_rev = use_deltas && (incremental || rev != start_rev);
-      SVN_ERR(get_dump_editor(&dump_editor, &dump_edit_baton, fs, rev,
-                              "", stream, &found_old_reference,
-                              &found_old_mergeinfo, NULL,
-                              notify_func, notify_baton,
-                              start_rev, use_deltas_for_rev, FALSE, FALSE,
-                              iterpool));
-
-      /* Drive the editor in one way or another. */
-      SVN_ERR(svn_fs_revision_root(&to_root, fs, rev, iterpool));
-
-      /* If this is the first revision of a non-incremental dump,
-         we're in for a full tree dump.  Otherwise, we want to simply
-         replay the revision.  */
-      if ((rev == start_rev) && (! incremental))
-        {
-          /* Compare against revision 0, so everything appears to be added. */
-          svn_fs_root_t *from_root;
-          SVN_ERR(svn_fs_revision_root(&from_root, fs, 0, iterpool));
-          SVN_ERR(svn_repos_dir_delta2(from_root, "", "",
-                                       to_root, "",
-                                       dump_editor, dump_edit_baton,
-                                       authz_func, &authz_baton,
-                                       FALSE, /* don't send text-deltas */
-                                       svn_depth_infinity,
-                                       FALSE, /* don't send entry props */
-                                       FALSE, /* don't ignore ancestry */
-                                       iterpool));
-        }
-      else
-        {
-          /* The normal case: compare consecutive revs. */
-          SVN_ERR(svn_repos_replay2(to_root, "", SVN_INVALID_REVNUM, FALSE,
-                                    dump_editor, dump_edit_baton,
-                                    authz_func, &authz_baton, iterpool));
-
-          /* While our editor close_edit implementation is a no-op, we still
-             do this for completeness. */
-          SVN_ERR(dump_editor->close_edit(dump_edit_baton, iterpool));
-        }
-
-    loop_end:
+      SVN_ERR(dump_revs_concurrently(repos, stream, start_rev, end_rev,
+                                     incremental, use_deltas, raw_deltas,
+                                     include_revprops, include_changes,
+                                     jobs, &found_old_reference,
+                                     &found_old_mergeinfo,
+                                     notify_func, notify_baton,
+                                     authz_func, &authz_baton,
+                                     cancel_func, cancel_baton, iterpool));
+    }
+  else
+    {
+      /* Create a notify object that we can reuse in the loop. */
       if (notify_func)
+        notify = svn_repos_notify_create(svn_repos_notify_dump_rev_end,
+                                         pool);
+
+      /* Main loop:  we're going to dump revision REV.  */
+      for (rev = start_rev; rev <= end_rev; rev++)
         {
-          notify->revision = rev;
-          notify_func(notify_baton, notify, iterpool);
+          svn_pool_clear(iterpool);
+
+          /* Check for cancellation. */
+          if (cancel_func)
+            SVN_ERR(cancel_func(cancel_baton));
+
+          SVN_ERR(dump_revision(stream, repos, rev, start_rev, incremental,
+                                use_deltas, raw_deltas, include_revprops,
+                                include_changes, &found_old_reference,
+                                &found_old_mergeinfo,
+                                notify_func, notify_baton,
+                                authz_func, &authz_baton, iterpool));
+
+          if (notify_func)
+            {
+              notify->revision = rev;
+              notify_func(notify_baton, notify, iterpool);
+            }
         }
     }
 
@@ -2370,7 +2779,8 @@ verify_one_revision(svn_fs_t *fs,
                           verify_close_directory,
                           notify_func, notify_baton,
                           start_rev,
-                          FALSE, TRUE, /* use_deltas, verify */
+                          FALSE, FALSE, /* use_deltas, raw_deltas */
+                          TRUE, /* verify */
                           check_normalization,
                           scratch_pool));
   SVN_ERR(svn_delta_get_cancellation_editor(cancel_func, cancel_baton,
@@ -2446,12 +2856,184 @@ report_error(svn_revnum_t revision,
     }
 }
 
+/* Result of verifying a single revision in verify_revs_concurrently(). */
+typedef struct verify_rev_result_t
+{
+  /* Verification error for this revision.  NULL, if it is fine. */
+  svn_error_t *err;
+
+  /* Copies of the svn_repos_notify_t * sent during verification. */
+  apr_array_header_t *notifications;
+} verify_rev_result_t;
+
+/* Baton type used with svn_task__run() by verify_revs_concurrently(). */
+typedef struct verify_revs_baton_t
+{
+  /* Filesystem to verify.  Workers open their own instances of it. */
+  svn_fs_t *fs;
+
+  /* First revision to verify. */
+  svn_revnum_t start_rev;
+
+  /* Parameters as passed to svn_repos_verify_fs4(). */
+  svn_boolean_t check_normalization;
+  svn_repos_notify_func_t notify_func;
+  void *notify_baton;
+  svn_repos_verify_callback_t verify_callback;
+  void *verify_baton;
+
+  /* Re-usable notification object for svn_repos_notify_verify_rev_end. */
+  svn_repos_notify_t *notify;
+} verify_revs_baton_t;
+
+/* Implements svn_task__thread_context_constructor_t.
+ * Open a private instance of the verify_revs_baton_t's filesystem. */
+static svn_error_t *
+open_fs_for_thread(void **thread_context,
+                   void *baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  verify_revs_baton_t *verify_baton = baton;
+  svn_fs_t *fs;
+
+  SVN_ERR(svn_fs_open2(&fs, svn_fs_path(verify_baton->fs, scratch_pool),
+                       svn_fs_config(verify_baton->fs, result_pool),
+                       result_pool, scratch_pool));
+  svn_fs_set_warning_func(fs, verify_warning_func, NULL);
+
+  *thread_context = fs;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+ * Verify revision START_REV + INDEX and return a verify_rev_result_t. */
+static svn_error_t *
+verify_rev_task(void **result,
+                void *thread_context,
+                void *process_baton,
+                apr_int64_t index,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  verify_revs_baton_t *verify_baton = process_baton;
+  verify_rev_result_t *rev_result = apr_pcalloc(result_pool,
+                                                sizeof(*rev_result));
+
+  rev_result->notifications = apr_array_make(result_pool, 0,
+                                             sizeof(svn_repos_notify_t *));
+  apr_pool_cleanup_register(result_pool, &rev_result->err,
+                            clear_result_error, apr_pool_cleanup_null);
+  rev_result->err
+    = verify_one_revision(thread_context,
+                          verify_baton->start_rev + (svn_revnum_t)index,
+                          verify_baton->notify_func
+                            ? capture_notification : NULL,
+                          rev_result->notifications,
+                          verify_baton->start_rev,
+                          verify_baton->check_normalization,
+                          cancel_func, cancel_baton, scratch_pool);
+
+  if (rev_result->err && rev_result->err->apr_err == SVN_ERR_CANCELLED)
+    {
+      svn_error_t *err = rev_result->err;
+
+      rev_result->err = SVN_NO_ERROR;
+      return svn_error_trace(err);
+    }
+
+  *result = rev_result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * Forward notifications and errors for revision START_REV + INDEX. */
+static svn_error_t *
+verify_rev_output(void *result,
+                  void *output_baton,
+                  apr_int64_t index,
+                  apr_pool_t *scratch_pool)
+{
+  verify_revs_baton_t *verify_baton = output_baton;
+  verify_rev_result_t *rev_result = result;
+  svn_revnum_t rev = verify_baton->start_rev + (svn_revnum_t)index;
+  svn_error_t *rev_err = rev_result->err;
+  int i;
+
+  /* We own the error from now on. */
+  rev_result->err = SVN_NO_ERROR;
+
+  for (i = 0; i < rev_result->notifications->nelts; ++i)
+    verify_baton->notify_func(verify_baton->notify_baton,
+                              APR_ARRAY_IDX(rev_result->notifications, i,
+                                            svn_repos_notify_t *),
+                              scratch_pool);
+
+  if (rev_err)
+    {
+      SVN_ERR(report_error(rev, rev_err,
+                           verify_baton->verify_callback,
+                           verify_baton->verify_baton, scratch_pool));
+    }
+  else if (verify_baton->notify_func)
+    {
+      /* Tell the caller that we're done with this revision. */
+      verify_baton->notify->revision = rev;
+      verify_baton->notify_func(verify_baton->notify_baton,
+                                verify_baton->notify, scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify revisions START_REV to END_REV in FS using up to JOBS threads.
+ * The remaining parameters are the same as for svn_repos_verify_fs4. */
+static svn_error_t *
+verify_revs_concurrently(svn_fs_t *fs,
+                         svn_revnum_t start_rev,
+                         svn_revnum_t end_rev,
+                         svn_boolean_t check_normalization,
+                         int jobs,
+                         svn_repos_notify_func_t notify_func,
+                         void *notify_baton,
+                         svn_repos_verify_callback_t verify_callback,
+                         void *verify_baton,
+                         svn_cancel_func_t cancel_func,
+                         void *cancel_baton,
+                         apr_pool_t *scratch_pool)
+{
+  verify_revs_baton_t baton;
+
+  baton.fs = fs;
+  baton.start_rev = start_rev;
+  baton.check_normalization = check_normalization;
+  baton.notify_func = notify_func;
+  baton.notify_baton = notify_baton;
+  baton.verify_callback = verify_callback;
+  baton.verify_baton = verify_baton;
+  baton.notify = svn_repos_notify_create(svn_repos_notify_verify_rev_end,
+                                         scratch_pool);
+
+  SVN_ERR(svn_task__run(jobs, end_rev - start_rev + 1,
+                        open_fs_for_thread, &baton,
+                        verify_rev_task, &baton,
+                        verify_rev_output, &baton,
+                        cancel_func, cancel_baton, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
-svn_repos_verify_fs3(svn_repos_t *repos,
+svn_repos_verify_fs4(svn_repos_t *repos,
                      svn_revnum_t start_rev,
                      svn_revnum_t end_rev,
                      svn_boolean_t check_normalization,
                      svn_boolean_t metadata_only,
+                     int jobs,
                      svn_repos_notify_func_t notify_func,
                      void *notify_baton,
                      svn_repos_verify_callback_t verify_callback,
@@ -2467,6 +3049,7 @@ svn_repos_verify_fs3(svn_repos_t *repos,
   svn_repos_notify_t *notify;
   svn_fs_progress_notify_func_t verify_notify = NULL;
   struct verify_fs_notify_func_baton_t *verify_notify_baton = NULL;
+  apr_hash_t *fs_config;
   svn_error_t *err;
 
   /* Make sure we catch up on the latest revprop changes.  This is the only
@@ -2508,8 +3091,19 @@ svn_repos_verify_fs3(svn_repos_t *repos,
         = svn_repos_notify_create(svn_repos_notify_verify_rev_structure, pool);
     }
 
+  /* Let the backend use the same number of threads. */
+  fs_config = svn_fs_config(fs, pool);
+  if (jobs > 1)
+    {
+      if (!fs_config)
+        fs_config = apr_hash_make(pool);
+
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_JOBS,
+                    apr_itoa(pool, jobs));
+    }
+
   /* Verify global metadata and backend-specific data first. */
-  err = svn_fs_verify(svn_fs_path(fs, pool), svn_fs_config(fs, pool),
+  err = svn_fs_verify(svn_fs_path(fs, pool), fs_config,
                       start_rev, end_rev,
                       verify_notify, verify_notify_baton,
                       cancel_func, cancel_baton, pool);
@@ -2524,7 +3118,13 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                            verify_baton, iterpool));
     }
 
-  if (!metadata_only)
+  if (!metadata_only && jobs > 1)
+    SVN_ERR(verify_revs_concurrently(fs, start_rev, end_rev,
+                                     check_normalization, jobs,
+                                     notify_func, notify_baton,
+                                     verify_callback, verify_baton,
+                                     cancel_func, cancel_baton, iterpool));
+  else if (!metadata_only)
     for (rev = start_rev; rev <= end_rev; rev++)
       {
         svn_pool_clear(iterpool);
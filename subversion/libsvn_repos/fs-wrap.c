@@ -111,6 +111,10 @@ svn_repos_fs_commit_txn(const char **conflict_p,
       return err;
     }
 
+  /* Extend the log index, if there is one.  The commit itself has
+     already succeeded and the index can catch up later. */
+  svn_error_clear(svn_repos__log_index_committed(repos, *new_rev, pool));
+
   /* Run post-commit hooks. */
   if ((err2 = svn_repos__hooks_post_commit(repos, hooks_env,
                                            *new_rev, txn_name, pool)))
@@ -1045,10 +1049,11 @@ svn_repos_fs_pack2(svn_repos_t *repos,
   pnb.notify_func = notify_func;
   pnb.notify_baton = notify_baton;
 
-  return svn_fs_pack(repos->db_path,
-                     notify_func ? pack_notify_func : NULL,
-                     notify_func ? &pnb : NULL,
-                     cancel_func, cancel_baton, pool);
+  /* Pass the configuration on, e.g. to let the backend use threads. */
+  return svn_fs_pack2(repos->db_path, svn_fs_config(repos->fs, pool),
+                      notify_func ? pack_notify_func : NULL,
+                      notify_func ? &pnb : NULL,
+                      cancel_func, cancel_baton, pool);
 }
 
 svn_error_t *
@@ -1251,7 +1251,7 @@ svn_repos_get_fs_build_parser6(const svn_repos_parse_fns3_t **callbacks,
 
 
 svn_error_t *
-svn_repos_load_fs6(svn_repos_t *repos,
+svn_repos_load_fs7(svn_repos_t *repos,
                    svn_stream_t *dumpstream,
                    svn_revnum_t start_rev,
                    svn_revnum_t end_rev,
@@ -1262,6 +1262,7 @@ svn_repos_load_fs6(svn_repos_t *repos,
                    svn_boolean_t validate_props,
                    svn_boolean_t ignore_dates,
                    svn_boolean_t normalize_props,
+                   int jobs,
                    svn_repos_notify_func_t notify_func,
                    void *notify_baton,
                    svn_cancel_func_t cancel_func,
@@ -1288,6 +1289,12 @@ svn_repos_load_fs6(svn_repos_t *repos,
                                          notify_baton,
                                          pool));
 
+  if (jobs > 1)
+    return svn_repos__parse_dumpstream_pipelined(dumpstream,
+                                                 parser, parse_baton, jobs,
+                                                 cancel_func, cancel_baton,
+                                                 pool);
+
   return svn_repos_parse_dumpstream3(dumpstream, parser, parse_baton, FALSE,
                                      cancel_func, cancel_baton, pool);
 }
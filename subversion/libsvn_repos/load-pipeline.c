@@ -0,0 +1,1183 @@
+/* load-pipeline.c --- parsing dump streams ahead of the commit
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* The pipeline has three stages:
+ *
+ *   1. A parser thread reads the dump stream and records all records of
+ *      a revision, including the raw text blocks, in memory or in
+ *      temporary spill files.  Complete revisions go into a bounded
+ *      queue, so the parser never runs arbitrarily far ahead.
+ *
+ *   2. The calling thread takes batches of revisions from that queue and
+ *      has worker threads decode the svndiff data of their text deltas,
+ *      one revision per work item.
+ *
+ *   3. The calling thread replays the records of each revision in stream
+ *      order to the caller's parser vtable, e.g. the one that commits to
+ *      the repository.  This overlaps with stage 2 for later revisions
+ *      and with stage 1 for later batches.
+ *
+ * Errors found in stage 2 are not reported immediately.  Instead, they
+ * are raised when stage 3 gets to the respective node, i.e. at the same
+ * point in the stream where the single-threaded parser would fail.
+ * Likewise, a malformed stream only gets reported after all complete
+ * revisions before that point have been replayed.
+ *
+ * Fulltexts are simply passed on.  Their checksums get verified by the
+ * receiving parser anyway.
+ */
+
+#include <string.h>
+
+#include <apr_pools.h>
+
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+#endif
+
+#include "svn_private_config.h"
+#include "svn_delta.h"
+#include "svn_error.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_repos.h"
+#include "repos.h"
+
+#include "private/svn_task.h"
+
+/* Text blocks larger than this will be spilled to a temporary file. */
+#define SPILL_THRESHOLD 0x100000
+
+/* Run the workers once this many revisions per job have been collected
+ * or once the text blocks of the collected revisions exceed BATCH_SIZE
+ * bytes, whichever comes first. */
+#define REVISIONS_PER_JOB 16
+#define BATCH_SIZE 0x4000000
+
+/* Interval in microseconds at which the calling thread checks for
+ * cancellation while waiting for the parser thread. */
+#define CANCEL_INTERVAL 100000
+
+/* What a recorded property change does. */
+typedef enum prop_action_t
+{
+  prop_action_set,
+  prop_action_delete,
+  prop_action_remove_all
+} prop_action_t;
+
+/* A recorded property change. */
+typedef struct prop_op_t
+{
+  prop_action_t action;
+
+  /* Property name.  NULL for prop_action_remove_all. */
+  const char *name;
+
+  /* New value for prop_action_set, otherwise NULL. */
+  const svn_string_t *value;
+} prop_op_t;
+
+/* A recorded text block. */
+typedef struct text_t
+{
+  /* The block contains svndiff data rather than a fulltext. */
+  svn_boolean_t is_delta;
+
+  /* Contents of the block, if not spilled to FILE. */
+  svn_stringbuf_t *data;
+
+  /* Temporary file holding the contents of the block, or NULL. */
+  apr_file_t *file;
+
+  /* The decoded delta windows (svn_txdelta_window_t *), in stream order.
+   * Set by the workers for text deltas only. */
+  apr_array_header_t *windows;
+
+  /* Error to report when replaying this text.  Set by the workers. */
+  svn_error_t *error;
+} text_t;
+
+typedef struct revision_t revision_t;
+
+/* A recorded revision, node or UUID record. */
+typedef struct record_t
+{
+  /* For UUID records, the UUID.  NULL for all other records. */
+  const char *uuid;
+
+  /* Record headers (const char * -> const char *). */
+  apr_hash_t *headers;
+
+  /* Property changes (prop_op_t), in stream order. */
+  apr_array_header_t *props;
+
+  /* The text block, or NULL. */
+  text_t *text;
+
+  /* The revision that this record belongs to. */
+  revision_t *revision;
+} record_t;
+
+/* A recorded revision with all the records that follow its header. */
+struct revision_t
+{
+  /* The revision record.  NULL, if there was no revision record, i.e. for
+   * records found ahead of the first revision in the stream. */
+  record_t *record;
+
+  /* Node and UUID records (record_t *), in stream order. */
+  apr_array_header_t *children;
+
+  /* Total size of all text blocks in this revision. */
+  svn_filesize_t size;
+
+  /* Dump format version found ahead of this revision, or 0. */
+  int version;
+
+  /* The pipeline that this revision is being recorded for. */
+  struct pipeline_t *pipeline;
+
+  /* All of the above are allocated in this root pool.  Only one thread at
+   * a time may use it.  NULL after the revision has been released. */
+  apr_pool_t *pool;
+};
+
+/* Parse baton for the recording vtable.
+
+   Unless noted otherwise, members are only used by the calling thread.
+   With thread support, the parser runs on a separate thread and the
+   queue members are protected by MUTEX. */
+typedef struct pipeline_t
+{
+  /* The vtable to replay the records to and its parse baton. */
+  const svn_repos_parse_fns3_t *parse_fns;
+  void *parse_baton;
+
+  /* The stream to parse and the recording vtable to parse it with.
+   * Used by the parser only. */
+  svn_stream_t *stream;
+  const svn_repos_parse_fns3_t *recorder;
+
+  /* Maximum number of worker threads. */
+  int jobs;
+
+  /* Revisions (revision_t *) waiting to be processed, in stream order. */
+  apr_array_header_t *batch;
+
+  /* Sum of the sizes of all revisions in BATCH. */
+  svn_filesize_t batch_size;
+
+  /* The revision currently being parsed, or NULL.  Used by the parser
+   * only. */
+  revision_t *current;
+
+  /* Ring buffer of parsed revisions that have not been taken into BATCH
+   * yet.  Revision I uses slot I % QUEUE_DEPTH. */
+  revision_t **queue;
+  int queue_depth;
+  apr_int64_t queued;
+  apr_int64_t taken;
+
+  /* Sum of the sizes of all revisions in QUEUE. */
+  svn_filesize_t queue_size;
+
+  /* Set by the parser once it has queued its last revision. */
+  svn_boolean_t parsed;
+
+  /* Error that ended parsing, set together with PARSED. */
+  svn_error_t *parse_error;
+
+  /* Set when the parser shall stop immediately. */
+  svn_boolean_t aborted;
+
+#if APR_HAS_THREADS
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *cond;
+  apr_thread_t *thread;
+#endif
+
+  /* The caller's cancellation function.  Used by the calling thread
+   * only. */
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* Pool for temporary allocations.  Used by the calling thread only. */
+  apr_pool_t *pool;
+} pipeline_t;
+
+
+/*----------------------------------------------------------------------*/
+
+/** Recording the dump stream **/
+
+/* Return a new, empty revision for PIPELINE.  Allocate it in a new root
+ * pool, so the workers can use it independently of any other pool. */
+static revision_t *
+create_revision(pipeline_t *pipeline)
+{
+  apr_pool_t *pool = svn_pool_create(NULL);
+  revision_t *revision = apr_pcalloc(pool, sizeof(*revision));
+
+  revision->children = apr_array_make(pool, 16, sizeof(record_t *));
+  revision->pipeline = pipeline;
+  revision->pool = pool;
+
+  return revision;
+}
+
+/* Release the memory and spill files used by REVISION. */
+static void
+release_revision(revision_t *revision)
+{
+  if (revision->pool)
+    {
+      svn_pool_destroy(revision->pool);
+      revision->pool = NULL;
+    }
+}
+
+/* Return a new record in REVISION with a copy of HEADERS. */
+static record_t *
+create_record(revision_t *revision,
+              apr_hash_t *headers)
+{
+  apr_pool_t *pool = revision->pool;
+  record_t *record = apr_pcalloc(pool, sizeof(*record));
+  apr_hash_index_t *hi;
+
+  record->headers = apr_hash_make(pool);
+  if (headers)
+    for (hi = apr_hash_first(pool, headers); hi; hi = apr_hash_next(hi))
+      svn_hash_sets(record->headers,
+                    apr_pstrdup(pool, apr_hash_this_key(hi)),
+                    apr_pstrdup(pool, apr_hash_this_val(hi)));
+
+  record->props = apr_array_make(pool, 4, sizeof(prop_op_t));
+  record->revision = revision;
+
+  return record;
+}
+
+/* Return the revision that records shall be added to in PIPELINE. */
+static revision_t *
+get_current(pipeline_t *pipeline)
+{
+  if (pipeline->current == NULL)
+    pipeline->current = create_revision(pipeline);
+
+  return pipeline->current;
+}
+
+/* Append a property change with ACTION, NAME and VALUE to RECORD. */
+static void
+add_prop_op(record_t *record,
+            prop_action_t action,
+            const char *name,
+            const svn_string_t *value)
+{
+  apr_pool_t *pool = record->revision->pool;
+  prop_op_t *op = apr_array_push(record->props);
+
+  op->action = action;
+  op->name = name ? apr_pstrdup(pool, name) : NULL;
+  op->value = value ? svn_string_dup(value, pool) : NULL;
+}
+
+/* Forward declaration. */
+static svn_error_t *
+process_batch(pipeline_t *pipeline);
+
+#if APR_HAS_THREADS
+
+/* Return TRUE if the parser has to wait before adding more revisions to
+ * PIPELINE's queue.  To be called with PIPELINE->MUTEX held. */
+static svn_boolean_t
+queue_full(pipeline_t *pipeline)
+{
+  apr_int64_t count = pipeline->queued - pipeline->taken;
+
+  return count >= pipeline->queue_depth
+      || (count > 0 && pipeline->queue_size >= BATCH_SIZE);
+}
+
+#endif
+
+/* Hand REVISION over to the calling thread of PIPELINE.  Block while the
+ * queue is full.  Release REVISION, if the pipeline has been aborted.
+ *
+ * Without thread support, add REVISION to the batch directly and process
+ * the latter, once it is large enough. */
+static svn_error_t *
+push_revision(pipeline_t *pipeline,
+              revision_t *revision)
+{
+#if APR_HAS_THREADS
+  svn_boolean_t aborted;
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  while (!pipeline->aborted && queue_full(pipeline))
+    apr_thread_cond_wait(pipeline->cond, pipeline->mutex);
+
+  aborted = pipeline->aborted;
+  if (!aborted)
+    {
+      pipeline->queue[pipeline->queued % pipeline->queue_depth] = revision;
+      pipeline->queued++;
+      pipeline->queue_size += revision->size;
+      apr_thread_cond_broadcast(pipeline->cond);
+    }
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  if (aborted)
+    {
+      release_revision(revision);
+      return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+    }
+#else
+  APR_ARRAY_PUSH(pipeline->batch, revision_t *) = revision;
+  pipeline->batch_size += revision->size;
+
+  if (   pipeline->batch->nelts >= pipeline->jobs * REVISIONS_PER_JOB
+      || pipeline->batch_size >= BATCH_SIZE)
+    {
+      svn_error_t *err = process_batch(pipeline);
+
+      /* Replaying failed.  Don't replay anything after that point. */
+      if (err)
+        pipeline->aborted = TRUE;
+
+      SVN_ERR(err);
+    }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Hand PIPELINE->CURRENT, if any, over to the calling thread. */
+static svn_error_t *
+queue_current(pipeline_t *pipeline)
+{
+  revision_t *revision = pipeline->current;
+
+  if (revision == NULL)
+    return SVN_NO_ERROR;
+
+  pipeline->current = NULL;
+  return svn_error_trace(push_revision(pipeline, revision));
+}
+
+/* Implements svn_write_fn_t.  Append DATA to the text of the record_t
+ * BATON, spilling it to a temporary file once it gets large. */
+static svn_error_t *
+text_write_handler(void *baton,
+                   const char *data,
+                   apr_size_t *len)
+{
+  record_t *record = baton;
+  revision_t *revision = record->revision;
+  text_t *text = record->text;
+
+  if (   text->file == NULL
+      && text->data->len + *len > SPILL_THRESHOLD)
+    {
+      apr_pool_t *pool = revision->pool;
+
+      SVN_ERR(svn_io_open_unique_file3(&text->file, NULL, NULL,
+                                       svn_io_file_del_on_pool_cleanup,
+                                       pool, pool));
+      SVN_ERR(svn_io_file_write_full(text->file, text->data->data,
+                                     text->data->len, NULL, pool));
+      text->data = NULL;
+    }
+
+  if (text->file)
+    SVN_ERR(svn_io_file_write_full(text->file, data, *len, NULL,
+                                   revision->pool));
+  else
+    svn_stringbuf_appendbytes(text->data, data, *len);
+
+  revision->size += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *STREAM to a stream that reads the contents of TEXT from the
+ * beginning.  Allocate it in RESULT_POOL. */
+static svn_error_t *
+read_text(svn_stream_t **stream,
+          text_t *text,
+          apr_pool_t *result_pool)
+{
+  if (text->file)
+    {
+      apr_off_t offset = 0;
+
+      SVN_ERR(svn_io_file_seek(text->file, APR_SET, &offset, result_pool));
+      *stream = svn_stream_from_aprfile2(text->file, TRUE, result_pool);
+    }
+  else
+    {
+      *stream = svn_stream_from_stringbuf(text->data, result_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.magic_header_record.  Record the
+ * dump format version, to be replayed ahead of the next revision. */
+static svn_error_t *
+pipeline_magic_header_record(int version,
+                             void *parse_baton,
+                             apr_pool_t *pool)
+{
+  pipeline_t *pipeline = parse_baton;
+
+  get_current(pipeline)->version = version;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.uuid_record. */
+static svn_error_t *
+pipeline_uuid_record(const char *uuid,
+                     void *parse_baton,
+                     apr_pool_t *pool)
+{
+  pipeline_t *pipeline = parse_baton;
+  revision_t *revision = get_current(pipeline);
+  record_t *record = create_record(revision, NULL);
+
+  record->uuid = apr_pstrdup(revision->pool, uuid);
+  APR_ARRAY_PUSH(revision->children, record_t *) = record;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.new_revision_record. */
+static svn_error_t *
+pipeline_new_revision_record(void **revision_baton,
+                             apr_hash_t *headers,
+                             void *parse_baton,
+                             apr_pool_t *pool)
+{
+  pipeline_t *pipeline = parse_baton;
+  revision_t *revision;
+
+  /* Queue any records that we found ahead of this revision. */
+  SVN_ERR(queue_current(pipeline));
+
+  revision = get_current(pipeline);
+  revision->record = create_record(revision, headers);
+  *revision_baton = revision->record;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.new_node_record. */
+static svn_error_t *
+pipeline_new_node_record(void **node_baton,
+                         apr_hash_t *headers,
+                         void *revision_baton,
+                         apr_pool_t *pool)
+{
+  record_t *revision_record = revision_baton;
+  revision_t *revision;
+  record_t *record;
+
+  /* There is no revision to add the node to. */
+  if (revision_record == NULL)
+    return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                            _("Node record found before the first "
+                              "revision record"));
+
+  revision = revision_record->revision;
+  record = create_record(revision, headers);
+  APR_ARRAY_PUSH(revision->children, record_t *) = record;
+  *node_baton = record;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.set_revision_property. */
+static svn_error_t *
+pipeline_set_revision_property(void *baton,
+                               const char *name,
+                               const svn_string_t *value)
+{
+  add_prop_op(baton, prop_action_set, name, value);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.set_node_property. */
+static svn_error_t *
+pipeline_set_node_property(void *baton,
+                           const char *name,
+                           const svn_string_t *value)
+{
+  add_prop_op(baton, prop_action_set, name, value);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.delete_node_property. */
+static svn_error_t *
+pipeline_delete_node_property(void *baton,
+                              const char *name)
+{
+  add_prop_op(baton, prop_action_delete, name, NULL);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.remove_node_props. */
+static svn_error_t *
+pipeline_remove_node_props(void *baton)
+{
+  add_prop_op(baton, prop_action_remove_all, NULL, NULL);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.set_fulltext.  The stream gets parsed
+ * with DELTAS_ARE_TEXT set, so this receives the raw svndiff data of text
+ * deltas as well. */
+static svn_error_t *
+pipeline_set_fulltext(svn_stream_t **stream,
+                      void *baton)
+{
+  record_t *record = baton;
+  apr_pool_t *pool = record->revision->pool;
+  const char *delta = svn_hash_gets(record->headers,
+                                    SVN_REPOS_DUMPFILE_TEXT_DELTA);
+
+  record->text = apr_pcalloc(pool, sizeof(*record->text));
+  record->text->is_delta = delta && strcmp(delta, "true") == 0;
+  record->text->data = svn_stringbuf_create_empty(pool);
+
+  *stream = svn_stream_create(record, pool);
+  svn_stream_set_write(*stream, text_write_handler);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_parse_fns3_t.close_revision. */
+static svn_error_t *
+pipeline_close_revision(void *baton)
+{
+  record_t *record = baton;
+
+  return svn_error_trace(queue_current(record->revision->pipeline));
+}
+
+
+/*----------------------------------------------------------------------*/
+
+/** Decoding on the worker threads **/
+
+/* Baton for collect_window(). */
+typedef struct window_collector_t
+{
+  /* Where to add the windows to. */
+  apr_array_header_t *windows;
+
+  /* Pool to copy the windows into. */
+  apr_pool_t *pool;
+} window_collector_t;
+
+/* Implements svn_txdelta_window_handler_t, adding a copy of WINDOW to the
+ * window_collector_t BATON. */
+static svn_error_t *
+collect_window(svn_txdelta_window_t *window,
+               void *baton)
+{
+  window_collector_t *collector = baton;
+
+  if (window)
+    APR_ARRAY_PUSH(collector->windows, svn_txdelta_window_t *)
+      = svn_txdelta_window_dup(window, collector->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Decode the svndiff data of TEXT into TEXT->WINDOWS, allocated in
+ * RESULT_POOL.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+decode_delta(text_t *text,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  window_collector_t *collector = apr_pcalloc(scratch_pool,
+                                              sizeof(*collector));
+  svn_stream_t *source;
+  svn_stream_t *target;
+
+  text->windows = apr_array_make(result_pool, 4,
+                                 sizeof(svn_txdelta_window_t *));
+  collector->windows = text->windows;
+  collector->pool = result_pool;
+
+  SVN_ERR(read_text(&source, text, scratch_pool));
+  target = svn_txdelta_parse_svndiff(collect_window, collector, TRUE,
+                                     scratch_pool);
+
+  return svn_error_trace(svn_stream_copy3(source, target, NULL, NULL,
+                                          scratch_pool));
+}
+
+/* Decode the text block of RECORD, if it is a text delta.  Store any
+ * error in the text itself.  Use SCRATCH_POOL for temporary allocations.
+ */
+static void
+process_record(record_t *record,
+               apr_pool_t *scratch_pool)
+{
+  text_t *text = record->text;
+
+  if (text && text->is_delta)
+    text->error = decode_delta(text, record->revision->pool, scratch_pool);
+}
+
+/* Implements svn_task__process_func_t.  Decode all text deltas of the
+ * revision with the given INDEX in the pipeline_t PROCESS_BATON's
+ * batch.  That revision will be returned in *RESULT.
+ *
+ * This runs on a worker thread and must not touch any other revision.
+ */
+static svn_error_t *
+process_revision(void **result,
+                 void *thread_context,
+                 void *process_baton,
+                 apr_int64_t index,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  pipeline_t *pipeline = process_baton;
+  revision_t *revision = APR_ARRAY_IDX(pipeline->batch, index,
+                                       revision_t *);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  if (revision->record)
+    process_record(revision->record, iterpool);
+
+  for (i = 0; i < revision->children->nelts; ++i)
+    {
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      process_record(APR_ARRAY_IDX(revision->children, i, record_t *),
+                     iterpool);
+    }
+
+  svn_pool_destroy(iterpool);
+  *result = revision;
+
+  return SVN_NO_ERROR;
+}
+
+
+/*----------------------------------------------------------------------*/
+
+/** Replaying in the calling thread **/
+
+/* Send all property changes of RECORD to PARSE_FNS for BATON.  IS_NODE
+ * selects between node and revision properties. */
+static svn_error_t *
+replay_props(const svn_repos_parse_fns3_t *parse_fns,
+             record_t *record,
+             void *baton,
+             svn_boolean_t is_node)
+{
+  int i;
+
+  for (i = 0; i < record->props->nelts; ++i)
+    {
+      const prop_op_t *op = &APR_ARRAY_IDX(record->props, i, prop_op_t);
+
+      switch (op->action)
+        {
+          case prop_action_set:
+            if (is_node)
+              SVN_ERR(parse_fns->set_node_property(baton, op->name,
+                                                   op->value));
+            else
+              SVN_ERR(parse_fns->set_revision_property(baton, op->name,
+                                                       op->value));
+            break;
+
+          case prop_action_delete:
+            SVN_ERR(parse_fns->delete_node_property(baton, op->name));
+            break;
+
+          default:
+            SVN_ERR(parse_fns->remove_node_props(baton));
+            break;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Send the text block of RECORD, if any, to PARSE_FNS for BATON.  Report
+ * errors found by the workers at the point where the single-threaded
+ * parser would have found them.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+replay_text(const svn_repos_parse_fns3_t *parse_fns,
+            record_t *record,
+            void *baton,
+            svn_cancel_func_t cancel_func,
+            void *cancel_baton,
+            apr_pool_t *scratch_pool)
+{
+  text_t *text = record->text;
+  svn_error_t *deferred;
+
+  if (text == NULL)
+    return SVN_NO_ERROR;
+
+  /* We own the error from now on. */
+  deferred = text->error;
+  text->error = NULL;
+
+  if (text->is_delta)
+    {
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_error_t *err;
+      int i;
+
+      /* Without a handler, the data would simply have been skipped. */
+      err = parse_fns->apply_textdelta(&handler, &handler_baton, baton);
+      if (err || handler == NULL)
+        {
+          svn_error_clear(deferred);
+          return svn_error_trace(err);
+        }
+
+      /* The windows before a decoding error get applied nonetheless. */
+      for (i = 0; i < text->windows->nelts; ++i)
+        {
+          err = handler(APR_ARRAY_IDX(text->windows, i,
+                                      svn_txdelta_window_t *),
+                        handler_baton);
+          if (err)
+            {
+              svn_error_clear(deferred);
+              return svn_error_trace(err);
+            }
+        }
+
+      SVN_ERR(deferred);
+      SVN_ERR(handler(NULL, handler_baton));
+    }
+  else
+    {
+      svn_stream_t *target;
+      svn_stream_t *source;
+      svn_error_t *err;
+
+      err = parse_fns->set_fulltext(&target, baton);
+      if (err || target == NULL)
+        {
+          svn_error_clear(deferred);
+          return svn_error_trace(err);
+        }
+
+      SVN_ERR(deferred);
+      SVN_ERR(read_text(&source, text, scratch_pool));
+      SVN_ERR(svn_stream_copy3(source, target, cancel_func, cancel_baton,
+                               scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Replay all records of the
+ * revision_t RESULT to the parser of the pipeline_t OUTPUT_BATON and
+ * release the revision afterwards. */
+static svn_error_t *
+replay_revision(void *result,
+                void *output_baton,
+                apr_int64_t index,
+                apr_pool_t *scratch_pool)
+{
+  revision_t *revision = result;
+  pipeline_t *pipeline = output_baton;
+  const svn_repos_parse_fns3_t *parse_fns = pipeline->parse_fns;
+  void *revision_baton = NULL;
+  apr_pool_t *nodepool = svn_pool_create(scratch_pool);
+  int i;
+
+  if (revision->version && parse_fns->magic_header_record)
+    SVN_ERR(parse_fns->magic_header_record(revision->version,
+                                           pipeline->parse_baton,
+                                           scratch_pool));
+
+  if (revision->record)
+    {
+      SVN_ERR(parse_fns->new_revision_record(&revision_baton,
+                                             revision->record->headers,
+                                             pipeline->parse_baton,
+                                             scratch_pool));
+      SVN_ERR(replay_props(parse_fns, revision->record, revision_baton,
+                           FALSE));
+      SVN_ERR(replay_text(parse_fns, revision->record, revision_baton,
+                          pipeline->cancel_func, pipeline->cancel_baton,
+                          scratch_pool));
+    }
+
+  for (i = 0; i < revision->children->nelts; ++i)
+    {
+      record_t *record = APR_ARRAY_IDX(revision->children, i, record_t *);
+      void *node_baton;
+
+      svn_pool_clear(nodepool);
+
+      if (record->uuid)
+        {
+          SVN_ERR(parse_fns->uuid_record(record->uuid, pipeline->parse_baton,
+                                         nodepool));
+          continue;
+        }
+
+      SVN_ERR(parse_fns->new_node_record(&node_baton, record->headers,
+                                         revision_baton, nodepool));
+      SVN_ERR(replay_props(parse_fns, record, node_baton, TRUE));
+      SVN_ERR(replay_text(parse_fns, record, node_baton,
+                          pipeline->cancel_func, pipeline->cancel_baton,
+                          nodepool));
+      SVN_ERR(parse_fns->close_node(node_baton));
+    }
+
+  if (revision->record)
+    SVN_ERR(parse_fns->close_revision(revision_baton));
+
+  svn_pool_destroy(nodepool);
+  release_revision(revision);
+
+  return SVN_NO_ERROR;
+}
+
+/* Run the workers and replay all revisions in PIPELINE's batch.  Release
+ * the batched revisions in any case. */
+static svn_error_t *
+process_batch(pipeline_t *pipeline)
+{
+  apr_pool_t *scratch_pool;
+  svn_error_t *err;
+  int i;
+
+  if (pipeline->batch->nelts == 0)
+    return SVN_NO_ERROR;
+
+  scratch_pool = svn_pool_create(pipeline->pool);
+  err = svn_task__run(pipeline->jobs, pipeline->batch->nelts,
+                      NULL, NULL,
+                      process_revision, pipeline,
+                      replay_revision, pipeline,
+                      pipeline->cancel_func, pipeline->cancel_baton,
+                      scratch_pool);
+  svn_pool_destroy(scratch_pool);
+
+  /* Upon error, some revisions will not have been replayed. */
+  for (i = 0; i < pipeline->batch->nelts; ++i)
+    {
+      revision_t *revision = APR_ARRAY_IDX(pipeline->batch, i,
+                                           revision_t *);
+      int k;
+
+      if (revision->pool == NULL)
+        continue;
+
+      if (revision->record && revision->record->text)
+        svn_error_clear(revision->record->text->error);
+      for (k = 0; k < revision->children->nelts; ++k)
+        {
+          record_t *record = APR_ARRAY_IDX(revision->children, k,
+                                           record_t *);
+          if (record->text)
+            svn_error_clear(record->text->error);
+        }
+
+      release_revision(revision);
+    }
+
+  apr_array_clear(pipeline->batch);
+  pipeline->batch_size = 0;
+
+  return svn_error_trace(err);
+}
+
+
+/*----------------------------------------------------------------------*/
+
+/** Running the parser **/
+
+/* Parse PIPELINE->STREAM, handing over all complete revisions.  Use
+ * CANCEL_FUNC with CANCEL_BATON and SCRATCH_POOL for parsing. */
+static svn_error_t *
+parse_stream(pipeline_t *pipeline,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *scratch_pool)
+{
+  /* Text deltas will be decoded by the workers. */
+  svn_error_t *err = svn_repos_parse_dumpstream3(pipeline->stream,
+                                                 pipeline->recorder,
+                                                 pipeline, TRUE,
+                                                 cancel_func, cancel_baton,
+                                                 scratch_pool);
+
+  /* The stream parser closes the last revision, so anything left in
+   * CURRENT is either incomplete due to a parser error or consists of
+   * records that don't belong to any revision. */
+  if (err && pipeline->current)
+    {
+      release_revision(pipeline->current);
+      pipeline->current = NULL;
+    }
+
+  if (err)
+    return svn_error_trace(err);
+
+  return svn_error_trace(queue_current(pipeline));
+}
+
+#if APR_HAS_THREADS
+
+/* Handy macro to check APR function results and turning them into
+ * svn_error_t upon failure. */
+#define WRAP_APR_ERR(x,msg)                     \
+  {                                             \
+    apr_status_t status_ = (x);                 \
+    if (status_)                                \
+      return svn_error_wrap_apr(status_, msg);  \
+  }
+
+/* Implements svn_cancel_func_t for the parser thread.  The caller's
+ * cancellation function may not be thread-safe, so the parser only
+ * checks whether the pipeline_t BATON has been aborted. */
+static svn_error_t *
+check_aborted(void *baton)
+{
+  pipeline_t *pipeline = baton;
+  svn_boolean_t aborted;
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  aborted = pipeline->aborted;
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  return aborted ? svn_error_create(SVN_ERR_CANCELLED, NULL, NULL)
+                 : SVN_NO_ERROR;
+}
+
+/* Parser thread function.  DATA is the pipeline_t. */
+static void * APR_THREAD_FUNC
+parser_thread(apr_thread_t *tid,
+              void *data)
+{
+  pipeline_t *pipeline = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+  svn_error_t *err = parse_stream(pipeline, check_aborted, pipeline, pool);
+
+  svn_pool_destroy(pool);
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  pipeline->parse_error = err;
+  pipeline->parsed = TRUE;
+  apr_thread_cond_broadcast(pipeline->cond);
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  return NULL;
+}
+
+/* Move as many revisions as fit from PIPELINE's queue into its batch.
+ * Wait for the parser, if the queue is empty.  Set *DONE, if there will
+ * be no further revisions after that. */
+static svn_error_t *
+take_batch(svn_boolean_t *done,
+           pipeline_t *pipeline)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+
+  apr_thread_mutex_lock(pipeline->mutex);
+  while (!pipeline->parsed && pipeline->taken == pipeline->queued)
+    {
+      if (pipeline->cancel_func)
+        {
+          apr_thread_mutex_unlock(pipeline->mutex);
+          err = pipeline->cancel_func(pipeline->cancel_baton);
+          apr_thread_mutex_lock(pipeline->mutex);
+          if (err)
+            break;
+        }
+
+      apr_thread_cond_timedwait(pipeline->cond, pipeline->mutex,
+                                CANCEL_INTERVAL);
+    }
+
+  while (   !err
+         && pipeline->taken < pipeline->queued
+         && pipeline->batch->nelts < pipeline->jobs * REVISIONS_PER_JOB
+         && pipeline->batch_size < BATCH_SIZE)
+    {
+      revision_t *revision
+        = pipeline->queue[pipeline->taken % pipeline->queue_depth];
+
+      pipeline->taken++;
+      pipeline->queue_size -= revision->size;
+      APR_ARRAY_PUSH(pipeline->batch, revision_t *) = revision;
+      pipeline->batch_size += revision->size;
+    }
+
+  *done = pipeline->parsed && pipeline->taken == pipeline->queued;
+  apr_thread_cond_broadcast(pipeline->cond);
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  return svn_error_trace(err);
+}
+
+/* Run the parser of PIPELINE on a separate thread and replay all
+ * revisions that it finds. */
+static svn_error_t *
+run_pipeline(pipeline_t *pipeline)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  svn_error_t *parse_err;
+  svn_boolean_t done = FALSE;
+  apr_status_t retval;
+
+  WRAP_APR_ERR(apr_thread_mutex_create(&pipeline->mutex,
+                                       APR_THREAD_MUTEX_DEFAULT,
+                                       pipeline->pool),
+               _("Can't create mutex"));
+  WRAP_APR_ERR(apr_thread_cond_create(&pipeline->cond, pipeline->pool),
+               _("Can't create condition variable"));
+  WRAP_APR_ERR(apr_thread_create(&pipeline->thread, NULL, parser_thread,
+                                 pipeline, pipeline->pool),
+               _("Can't create thread"));
+
+  while (!err && !done)
+    {
+      err = take_batch(&done, pipeline);
+      if (!err)
+        err = process_batch(pipeline);
+    }
+
+  /* Stop the parser, unless it has finished already. */
+  apr_thread_mutex_lock(pipeline->mutex);
+  pipeline->aborted = TRUE;
+  apr_thread_cond_broadcast(pipeline->cond);
+  apr_thread_mutex_unlock(pipeline->mutex);
+
+  apr_thread_join(&retval, pipeline->thread);
+
+  for (; pipeline->taken < pipeline->queued; pipeline->taken++)
+    release_revision(pipeline->queue[pipeline->taken
+                                     % pipeline->queue_depth]);
+
+  /* If replaying failed, the single-threaded parser would not have read
+   * any further.  Errors from the parser thread don't count then. */
+  parse_err = pipeline->parse_error;
+  pipeline->parse_error = SVN_NO_ERROR;
+  if (err)
+    {
+      svn_error_clear(parse_err);
+      return svn_error_trace(err);
+    }
+
+  return svn_error_trace(parse_err);
+}
+
+#endif
+
+
+/*----------------------------------------------------------------------*/
+
+/** The public routines **/
+
+svn_error_t *
+svn_repos__parse_dumpstream_pipelined(svn_stream_t *stream,
+                                      const svn_repos_parse_fns3_t *parse_fns,
+                                      void *parse_baton,
+                                      int jobs,
+                                      svn_cancel_func_t cancel_func,
+                                      void *cancel_baton,
+                                      apr_pool_t *scratch_pool)
+{
+  svn_repos_parse_fns3_t *recorder = apr_pcalloc(scratch_pool,
+                                                 sizeof(*recorder));
+  pipeline_t *pipeline = apr_pcalloc(scratch_pool, sizeof(*pipeline));
+#if !APR_HAS_THREADS
+  svn_error_t *err;
+#endif
+
+  recorder->magic_header_record = pipeline_magic_header_record;
+  recorder->uuid_record = pipeline_uuid_record;
+  recorder->new_revision_record = pipeline_new_revision_record;
+  recorder->new_node_record = pipeline_new_node_record;
+  recorder->set_revision_property = pipeline_set_revision_property;
+  recorder->set_node_property = pipeline_set_node_property;
+  recorder->delete_node_property = pipeline_delete_node_property;
+  recorder->remove_node_props = pipeline_remove_node_props;
+  recorder->set_fulltext = pipeline_set_fulltext;
+  recorder->apply_textdelta = NULL;
+  recorder->close_node = NULL;
+  recorder->close_revision = pipeline_close_revision;
+
+  pipeline->parse_fns = parse_fns;
+  pipeline->parse_baton = parse_baton;
+  pipeline->stream = stream;
+  pipeline->recorder = recorder;
+  pipeline->jobs = jobs;
+  pipeline->batch = apr_array_make(scratch_pool,
+                                   jobs * REVISIONS_PER_JOB,
+                                   sizeof(revision_t *));
+
+  /* Let the parser get up to one batch ahead of the batch being
+   * processed. */
+  pipeline->queue_depth = jobs * REVISIONS_PER_JOB;
+  pipeline->queue = apr_pcalloc(scratch_pool,
+                                pipeline->queue_depth
+                                  * sizeof(*pipeline->queue));
+  pipeline->cancel_func = cancel_func;
+  pipeline->cancel_baton = cancel_baton;
+  pipeline->pool = scratch_pool;
+
+#if APR_HAS_THREADS
+  return svn_error_trace(run_pipeline(pipeline));
+#else
+  err = parse_stream(pipeline, cancel_func, cancel_baton, scratch_pool);
+
+  /* Replay all complete revisions, even if we ran into a parser error.
+   * A replay error comes first in the stream and takes precedence. */
+  if (!pipeline->aborted)
+    err = svn_error_compose_create(process_batch(pipeline), err);
+
+  return svn_error_trace(err);
+#endif
+}
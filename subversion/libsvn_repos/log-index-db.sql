@@ -0,0 +1,66 @@
+/* log-index-db.sql -- schema of the optional repository log index
+ *   This is intended for use with SQLite 3
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+-- STMT_CREATE_SCHEMA
+/* The explicit mergeinfo changes of each revision, as determined by
+   'svn log -g'.  There is one row per path whose svn:mergeinfo changed
+   and DELETED / ADDED are the unparsed mergeinfo differences.
+   Revisions without mergeinfo changes have no rows at all. */
+CREATE TABLE mergeinfo_changes (
+  revision INTEGER NOT NULL,
+  path TEXT NOT NULL,
+  deleted TEXT NOT NULL,
+  added TEXT NOT NULL,
+  PRIMARY KEY (revision, path)
+  );
+
+/* A single row containing the youngest revision covered by the index.
+   All revisions up to and including that one have been indexed. */
+CREATE TABLE indexed (
+  youngest INTEGER NOT NULL
+  );
+
+INSERT INTO indexed (youngest) VALUES (0);
+
+PRAGMA USER_VERSION = 1;
+
+-- STMT_GET_YOUNGEST
+SELECT youngest
+FROM indexed
+
+-- STMT_SET_YOUNGEST
+UPDATE indexed
+SET youngest = ?1
+
+-- STMT_GET_MERGEINFO_CHANGES
+SELECT path, deleted, added
+FROM mergeinfo_changes
+WHERE revision = ?1
+
+-- STMT_SET_MERGEINFO_CHANGE
+INSERT OR REPLACE INTO mergeinfo_changes (revision, path, deleted, added)
+VALUES (?1, ?2, ?3, ?4)
+
+-- STMT_DEL_MERGEINFO_CHANGES_YOUNGER_THAN_REV
+DELETE FROM mergeinfo_changes
+WHERE revision > ?1
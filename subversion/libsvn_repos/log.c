@@ -56,8 +56,19 @@ typedef struct log_callbacks_t
   void *revision_receiver_baton;
   svn_repos_authz_func_t authz_read_func;
   void *authz_read_baton;
+
+  /* The repository's log index, if available.  May be NULL. */
+  svn_repos__log_index_t *log_index;
+
+  /* Revprops fetched in bulk for the revisions PREFETCH_START and later,
+     i.e. (apr_hash_t *) at index REV - PREFETCH_START.  May be NULL. */
+  apr_array_header_t *prefetched_revprops;
+  svn_revnum_t prefetch_start;
 } log_callbacks_t;
 
+/* Number of revisions for which we fetch revprops in one go. */
+#define REVPROP_PREFETCH_SIZE 1000
+
 
 svn_repos_path_change_t *
 svn_repos_path_change_create(apr_pool_t *result_pool)
@@ -609,18 +620,15 @@ next_history_rev(const apr_array_header_t *histories)
   return next_rev;
 }
 
-/* Set *DELETED_MERGEINFO_CATALOG and *ADDED_MERGEINFO_CATALOG to
-   catalogs describing how mergeinfo values on paths (which are the
-   keys of those catalogs) were changed in REV. */
 /* ### TODO: This would make a *great*, useful public function,
    ### svn_repos_fs_mergeinfo_changed()!  -- cmpilato  */
-static svn_error_t *
-fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
-                     svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
-                     svn_fs_t *fs,
-                     svn_revnum_t rev,
-                     apr_pool_t *result_pool,
-                     apr_pool_t *scratch_pool)
+svn_error_t *
+svn_repos__fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+                                svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+                                svn_fs_t *fs,
+                                svn_revnum_t rev,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool)
 {
   svn_fs_root_t *root;
   apr_pool_t *iterpool, *iterator_pool;
@@ -877,11 +885,13 @@ fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
 
 /* Determine what (if any) mergeinfo for PATHS was modified in
    revision REV, returning the differences for added mergeinfo in
-   *ADDED_MERGEINFO and deleted mergeinfo in *DELETED_MERGEINFO. */
+   *ADDED_MERGEINFO and deleted mergeinfo in *DELETED_MERGEINFO.
+   Consult LOG_INDEX, if not NULL, before looking at the changes in REV. */
 static svn_error_t *
 get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
                                svn_mergeinfo_t *deleted_mergeinfo,
                                svn_fs_t *fs,
+                               svn_repos__log_index_t *log_index,
                                const apr_array_header_t *paths,
                                svn_revnum_t rev,
                                apr_pool_t *result_pool,
@@ -893,6 +903,7 @@ get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
   apr_pool_t *iterpool;
   int i;
   svn_error_t *err;
+  svn_boolean_t found = FALSE;
 
   /* Initialize return value. */
   *added_mergeinfo = svn_hash__make(result_pool);
@@ -907,10 +918,19 @@ get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
     return SVN_NO_ERROR;
 
   /* Fetch the mergeinfo changes for REV. */
-  err = fs_mergeinfo_changed(&deleted_mergeinfo_catalog,
-                             &added_mergeinfo_catalog,
-                             fs, rev,
-                             scratch_pool, scratch_pool);
+  if (log_index)
+    SVN_ERR(svn_repos__log_index_get(&found,
+                                     &deleted_mergeinfo_catalog,
+                                     &added_mergeinfo_catalog,
+                                     log_index, rev,
+                                     scratch_pool, scratch_pool));
+  if (found)
+    err = SVN_NO_ERROR;
+  else
+    err = svn_repos__fs_mergeinfo_changed(&deleted_mergeinfo_catalog,
+                                          &added_mergeinfo_catalog,
+                                          fs, rev,
+                                          scratch_pool, scratch_pool);
   if (err)
     {
       if (err->apr_err == SVN_ERR_MERGEINFO_PARSE_ERROR)
@@ -1136,8 +1156,16 @@ fill_log_entry(svn_repos_log_entry_t *log_entry,
   if (get_revprops && want_revprops)
     {
       /* User is allowed to see at least some revprops. */
-      SVN_ERR(svn_fs_revision_proplist2(&r_props, fs, rev, FALSE, pool,
-                                        pool));
+      if (   callbacks->prefetched_revprops
+          && rev >= callbacks->prefetch_start
+          && rev - callbacks->prefetch_start
+               < callbacks->prefetched_revprops->nelts)
+        r_props = APR_ARRAY_IDX(callbacks->prefetched_revprops,
+                                rev - callbacks->prefetch_start,
+                                apr_hash_t *);
+      else
+        SVN_ERR(svn_fs_revision_proplist2(&r_props, fs, rev, FALSE, pool,
+                                          pool));
       if (revprops == NULL)
         {
           /* Requested all revprops... */
@@ -2075,7 +2103,8 @@ do_logs(svn_fs_t *fs,
                 }
               SVN_ERR(get_combined_mergeinfo_changes(&added_mergeinfo,
                                                      &deleted_mergeinfo,
-                                                     fs, cur_paths,
+                                                     fs, callbacks->log_index,
+                                                     cur_paths,
                                                      current,
                                                      iterpool, iterpool));
               has_children = (apr_hash_count(added_mergeinfo) > 0
@@ -2303,6 +2332,45 @@ get_paths_history_as_mergeinfo(svn_mergeinfo_t *paths_history_mergeinfo,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_fs_revision_proplist_receiver_t, storing PROPLIST in the
+   (log_callbacks_t *) BATON's prefetch array. */
+static svn_error_t *
+prefetch_revprops_receiver(void *baton,
+                           svn_revnum_t revision,
+                           apr_hash_t *proplist,
+                           apr_pool_t *scratch_pool)
+{
+  log_callbacks_t *callbacks = baton;
+  APR_ARRAY_IDX(callbacks->prefetched_revprops,
+                revision - callbacks->prefetch_start,
+                apr_hash_t *) = proplist;
+
+  return SVN_NO_ERROR;
+}
+
+/* Fetch the revprops for all revisions from START to END in FS with a
+   single bulk read and store them in CALLBACKS, allocated in
+   RESULT_POOL. */
+static svn_error_t *
+prefetch_revprops(log_callbacks_t *callbacks,
+                  svn_fs_t *fs,
+                  svn_revnum_t start,
+                  svn_revnum_t end,
+                  apr_pool_t *result_pool)
+{
+  int count = (int)(start <= end ? end - start + 1 : start - end + 1);
+
+  callbacks->prefetch_start = MIN(start, end);
+  callbacks->prefetched_revprops
+    = apr_array_make(result_pool, count, sizeof(apr_hash_t *));
+  callbacks->prefetched_revprops->nelts = count;
+
+  return svn_error_trace(svn_fs_revision_proplists(fs, start, end, FALSE,
+                                                   prefetch_revprops_receiver,
+                                                   callbacks, NULL, NULL,
+                                                   result_pool));
+}
+
 svn_error_t *
 svn_repos_get_logs5(svn_repos_t *repos,
                     const apr_array_header_t *paths,
@@ -2332,6 +2400,9 @@ svn_repos_get_logs5(svn_repos_t *repos,
   callbacks.revision_receiver_baton = revision_receiver_baton;
   callbacks.authz_read_func = authz_read_func;
   callbacks.authz_read_baton = authz_read_baton;
+  callbacks.log_index = NULL;
+  callbacks.prefetched_revprops = NULL;
+  callbacks.prefetch_start = SVN_INVALID_REVNUM;
 
   if (revprops)
     {
@@ -2398,6 +2469,8 @@ svn_repos_get_logs5(svn_repos_t *repos,
       apr_uint64_t send_count = 0;
       int i;
       apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+      apr_pool_t *prefetch_pool = svn_pool_create(scratch_pool);
+      svn_boolean_t want_revprops = !revprops || revprops->nelts;
 
       /* If we are provided an authz callback function, use it to
          verify that the user has read access to the root path in the
@@ -2434,11 +2507,26 @@ svn_repos_get_logs5(svn_repos_t *repos,
             rev = end - i;
           else
             rev = start + i;
+
+          /* Read the revprops for the next batch of revisions in bulk.
+             That is much faster than reading them one-by-one. */
+          if (want_revprops && i % REVPROP_PREFETCH_SIZE == 0)
+            {
+              int count = (int)MIN(send_count - i, REVPROP_PREFETCH_SIZE);
+
+              svn_pool_clear(prefetch_pool);
+              SVN_ERR(prefetch_revprops(&callbacks, fs, rev,
+                                        descending_order ? rev - count + 1
+                                                         : rev + count - 1,
+                                        prefetch_pool));
+            }
+
           SVN_ERR(send_log(rev, fs, NULL, NULL,
                            FALSE, FALSE, revprops, FALSE,
                            &callbacks, iterpool));
         }
       svn_pool_destroy(iterpool);
+      svn_pool_destroy(prefetch_pool);
 
       return SVN_NO_ERROR;
     }
@@ -2451,6 +2539,18 @@ svn_repos_get_logs5(svn_repos_t *repos,
   if (include_merged_revisions)
     {
       apr_pool_t *subpool = svn_pool_create(scratch_pool);
+      svn_error_t *err;
+
+      /* The log index is merely an optimization.  If we can't use it,
+         we will find the mergeinfo changes the hard way. */
+      err = svn_repos__log_index_open(&callbacks.log_index, repos,
+                                      svn_sqlite__mode_readonly,
+                                      scratch_pool, subpool);
+      if (err)
+        {
+          svn_error_clear(err);
+          callbacks.log_index = NULL;
+        }
 
       SVN_ERR(get_paths_history_as_mergeinfo(&paths_history_mergeinfo,
                                              repos, paths, start, end,
@@ -0,0 +1,420 @@
+/* log_index.c --- the optional mergeinfo index for 'svn log -g'
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_mergeinfo.h"
+#include "svn_repos.h"
+#include "svn_sorts.h"
+
+#include "svn_private_config.h"
+
+#include "repos.h"
+
+#include "private/svn_sqlite.h"
+#include "private/svn_subr_private.h"
+
+#include "log-index-db.h"
+
+LOG_INDEX_DB_SQL_DECLARE_STATEMENTS(statements);
+
+
+
+/* Number of revisions to add to the index per SQLite transaction. */
+#define LOG_INDEX_BATCH_SIZE 100
+
+/* A commit will only bring the index up to date if there are no more
+   than this many revisions missing.  Larger gaps, e.g. after a dump
+   got loaded, are left to svn_repos_build_log_index() instead of
+   delaying the commit response. */
+#define LOG_INDEX_MAX_CATCH_UP 100
+
+struct svn_repos__log_index_t
+{
+  /* The repository that this index belongs to. */
+  svn_repos_t *repos;
+
+  /* The index database.  Gets closed with the pool it was opened in. */
+  svn_sqlite__db_t *sdb;
+
+  /* Youngest indexed revision as of opening / last updating the index.
+     Revisions up to this one may be looked up in the index. */
+  svn_revnum_t youngest;
+};
+
+/* Return the path of the log index DB for REPOS, allocated in
+   RESULT_POOL. */
+static const char *
+path_log_index_db(svn_repos_t *repos,
+                  apr_pool_t *result_pool)
+{
+  return svn_dirent_join(repos->path, SVN_REPOS__LOG_INDEX_DB, result_pool);
+}
+
+svn_error_t *
+svn_repos__log_index_open(svn_repos__log_index_t **index,
+                          svn_repos_t *repos,
+                          svn_sqlite__mode_t mode,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  const char *db_path = path_log_index_db(repos, scratch_pool);
+  svn_repos__log_index_t *result;
+  svn_node_kind_t kind;
+  int version;
+
+  SVN_ERR(svn_io_check_path(db_path, &kind, scratch_pool));
+  if (kind == svn_node_none)
+    {
+      if (mode != svn_sqlite__mode_rwcreate)
+        {
+          *index = NULL;
+          return SVN_NO_ERROR;
+        }
+
+#ifndef WIN32
+      {
+        /* Extend the permissions that apply to the repository as a whole
+           to the new index instead of simply defaulting to umask. */
+        svn_error_t *err = svn_io_file_create_empty(db_path, scratch_pool);
+
+        if (err && !APR_STATUS_IS_EEXIST(err->apr_err))
+          return svn_error_trace(err);
+        else if (err)
+          svn_error_clear(err);
+        else
+          SVN_ERR(svn_io_copy_perms(svn_dirent_join(repos->path,
+                                                    SVN_REPOS__FORMAT,
+                                                    scratch_pool),
+                                    db_path, scratch_pool));
+      }
+#endif
+    }
+
+  result = apr_pcalloc(result_pool, sizeof(*result));
+  result->repos = repos;
+
+  SVN_ERR(svn_sqlite__open(&result->sdb, db_path, mode, statements,
+                           0, NULL, 0, result_pool, scratch_pool));
+
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version,
+                                                        result->sdb,
+                                                        scratch_pool),
+                        result->sdb);
+
+  /* An empty database is an index that is still being created. */
+  if (version <= 0)
+    {
+      if (mode != svn_sqlite__mode_rwcreate)
+        {
+          SVN_ERR(svn_sqlite__close(result->sdb));
+          *index = NULL;
+          return SVN_NO_ERROR;
+        }
+
+      SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(result->sdb,
+                                                        STMT_CREATE_SCHEMA),
+                            result->sdb);
+    }
+
+  SVN_SQLITE__ERR_CLOSE(svn_repos__log_index_youngest(&result->youngest,
+                                                      result, scratch_pool),
+                        result->sdb);
+
+  *index = result;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__log_index_youngest(svn_revnum_t *youngest,
+                              svn_repos__log_index_t *index,
+                              apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb, STMT_GET_YOUNGEST));
+  SVN_ERR(svn_sqlite__step_row(stmt));
+  *youngest = svn_sqlite__column_revnum(stmt, 0);
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Forget everything that INDEX knows about revisions younger than
+   REVISION.  Must be called within a transaction. */
+static svn_error_t *
+truncate_index(svn_repos__log_index_t *index,
+               svn_revnum_t revision)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                              STMT_DEL_MERGEINFO_CHANGES_YOUNGER_THAN_REV));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, revision));
+  SVN_ERR(svn_sqlite__step_done(stmt));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb, STMT_SET_YOUNGEST));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, revision));
+  SVN_ERR(svn_sqlite__step_done(stmt));
+
+  index->youngest = revision;
+  return SVN_NO_ERROR;
+}
+
+/* Store the mergeinfo changes of REV in INDEX.  Must be called within a
+   transaction.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+index_revision(svn_repos__log_index_t *index,
+               svn_revnum_t rev,
+               apr_pool_t *scratch_pool)
+{
+  svn_mergeinfo_catalog_t deleted_catalog, added_catalog;
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool;
+  svn_error_t *err;
+
+  err = svn_repos__fs_mergeinfo_changed(&deleted_catalog, &added_catalog,
+                                        index->repos->fs, rev,
+                                        scratch_pool, scratch_pool);
+  if (err && err->apr_err == SVN_ERR_MERGEINFO_PARSE_ERROR)
+    {
+      /* Issue #3896: 'svn log -g' treats invalid mergeinfo as if there
+         were no mergeinfo modifications.  Record exactly that. */
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (hi = apr_hash_first(scratch_pool, added_catalog);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const char *path = apr_hash_this_key(hi);
+      svn_mergeinfo_t added = apr_hash_this_val(hi);
+      svn_mergeinfo_t deleted = svn_hash_gets(deleted_catalog, path);
+      svn_string_t *added_str, *deleted_str;
+      svn_sqlite__stmt_t *stmt;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_mergeinfo_to_string(&deleted_str, deleted, iterpool));
+      SVN_ERR(svn_mergeinfo_to_string(&added_str, added, iterpool));
+
+      SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                        STMT_SET_MERGEINFO_CHANGE));
+      SVN_ERR(svn_sqlite__bindf(stmt, "rsss", rev, path,
+                                deleted_str->data, added_str->data));
+      SVN_ERR(svn_sqlite__insert(NULL, stmt));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Add up to LOG_INDEX_BATCH_SIZE revisions following the youngest one
+   in INDEX, but none younger than REVISION, to INDEX.  Set *START and
+   *END to the range of revisions added.  Must be called within a
+   transaction.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+index_batch(svn_revnum_t *start,
+            svn_revnum_t *end,
+            svn_repos__log_index_t *index,
+            svn_revnum_t revision,
+            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_sqlite__stmt_t *stmt;
+  svn_revnum_t youngest;
+  svn_revnum_t rev;
+
+  /* Some concurrent commit may have updated the index in the meantime. */
+  SVN_ERR(svn_repos__log_index_youngest(&youngest, index, scratch_pool));
+  *start = youngest + 1;
+  *end = MIN(revision, youngest + LOG_INDEX_BATCH_SIZE);
+
+  for (rev = *start; rev <= *end; ++rev)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(index_revision(index, rev, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  if (*end >= *start)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                        STMT_SET_YOUNGEST));
+      SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, *end));
+      SVN_ERR(svn_sqlite__step_done(stmt));
+    }
+
+  index->youngest = MAX(youngest, *end);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__log_index_update(svn_repos__log_index_t *index,
+                            svn_revnum_t revision,
+                            svn_repos_notify_func_t notify_func,
+                            void *notify_baton,
+                            svn_cancel_func_t cancel_func,
+                            void *cancel_baton,
+                            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (index->youngest < revision)
+    {
+      svn_revnum_t start, end;
+
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_SQLITE__WITH_IMMEDIATE_TXN(index_batch(&start, &end, index,
+                                                 revision, iterpool),
+                                     index->sdb);
+
+      if (notify_func && end >= start)
+        {
+          svn_repos_notify_t *notify
+            = svn_repos_notify_create(svn_repos_notify_log_index_rev_range,
+                                      iterpool);
+          notify->start_revision = start;
+          notify->end_revision = end;
+          notify_func(notify_baton, notify, iterpool);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__log_index_committed(svn_repos_t *repos,
+                               svn_revnum_t new_rev,
+                               apr_pool_t *scratch_pool)
+{
+  svn_repos__log_index_t *index;
+  svn_revnum_t head;
+
+  SVN_ERR(svn_repos__log_index_open(&index, repos, svn_sqlite__mode_readwrite,
+                                    scratch_pool, scratch_pool));
+  if (! index)
+    return SVN_NO_ERROR;
+
+  /* An index that covers revisions which don't exist must have been
+     left behind by some other history of this repository, e.g. before
+     the repository got restored from a backup. */
+  SVN_ERR(svn_fs_youngest_rev(&head, repos->fs, scratch_pool));
+  if (index->youngest > head)
+    SVN_SQLITE__WITH_TXN(truncate_index(index, new_rev - 1), index->sdb);
+
+  if (new_rev - index->youngest > LOG_INDEX_MAX_CATCH_UP)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(svn_repos__log_index_update(index, new_rev,
+                                                     NULL, NULL, NULL, NULL,
+                                                     scratch_pool));
+}
+
+svn_error_t *
+svn_repos__log_index_get(svn_boolean_t *found,
+                         svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+                         svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+                         svn_repos__log_index_t *index,
+                         svn_revnum_t rev,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  if (rev > index->youngest)
+    {
+      *found = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  *deleted_mergeinfo_catalog = svn_hash__make(result_pool);
+  *added_mergeinfo_catalog = svn_hash__make(result_pool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_GET_MERGEINFO_CHANGES));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, rev));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row)
+    {
+      const char *path = svn_sqlite__column_text(stmt, 0, result_pool);
+      svn_mergeinfo_t deleted, added;
+      svn_error_t *err;
+
+      err = svn_mergeinfo_parse(&deleted,
+                                svn_sqlite__column_text(stmt, 1, NULL),
+                                result_pool);
+      if (!err)
+        err = svn_mergeinfo_parse(&added,
+                                  svn_sqlite__column_text(stmt, 2, NULL),
+                                  result_pool);
+      if (err)
+        return svn_error_compose_create(err, svn_sqlite__reset(stmt));
+
+      svn_hash_sets(*deleted_mergeinfo_catalog, path, deleted);
+      svn_hash_sets(*added_mergeinfo_catalog, path, added);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  *found = TRUE;
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+svn_error_t *
+svn_repos_build_log_index(svn_repos_t *repos,
+                          svn_repos_notify_func_t notify_func,
+                          void *notify_baton,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool)
+{
+  svn_repos__log_index_t *index;
+  svn_revnum_t head;
+  apr_pool_t *subpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_repos__log_index_open(&index, repos, svn_sqlite__mode_rwcreate,
+                                    subpool, subpool));
+
+  SVN_ERR(svn_fs_youngest_rev(&head, repos->fs, subpool));
+  if (index->youngest > head)
+    SVN_SQLITE__WITH_TXN(truncate_index(index, head), index->sdb);
+
+  SVN_ERR(svn_repos__log_index_update(index, head, notify_func, notify_baton,
+                                      cancel_func, cancel_baton, subpool));
+
+  /* Closes the index. */
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
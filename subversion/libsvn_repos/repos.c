@@ -22,6 +22,7 @@
 
 #include <apr_pools.h>
 #include <apr_file_io.h>
+#include <apr_strings.h>
 
 #include "svn_pools.h"
 #include "svn_error.h"
@@ -1892,6 +1893,11 @@ static svn_error_t *hotcopy_structure(void *baton,
           (svn_dirent_get_longest_ancestor(SVN_REPOS__FORMAT, sub_path, pool),
            SVN_REPOS__FORMAT) == 0)
         return SVN_NO_ERROR;
+
+      /* The log index may be in flux.  Since it only contains derived
+         data, 'svnadmin build-log-index' can recreate it in the copy. */
+      if (svn_path_compare_paths(sub_path, SVN_REPOS__LOG_INDEX_DB) == 0)
+        return SVN_NO_ERROR;
     }
 
   target = svn_dirent_join(ctx->dest, sub_path, pool);
@@ -1964,10 +1970,11 @@ fs_hotcopy_notify(void *baton,
 
 /* Make a copy of a repository with hot backup of fs. */
 svn_error_t *
-svn_repos_hotcopy3(const char *src_path,
+svn_repos_hotcopy4(const char *src_path,
                    const char *dst_path,
                    svn_boolean_t clean_logs,
                    svn_boolean_t incremental,
+                   int jobs,
                    svn_repos_notify_func_t notify_func,
                    void *notify_baton,
                    svn_cancel_func_t cancel_func,
@@ -1977,6 +1984,7 @@ svn_repos_hotcopy3(const char *src_path,
   svn_fs_hotcopy_notify_t fs_notify_func;
   struct fs_hotcopy_notify_baton_t fs_notify_baton;
   struct hotcopy_ctx_t hotcopy_context;
+  apr_hash_t *fs_config = NULL;
   const char *src_abspath;
   const char *dst_abspath;
   svn_repos_t *src_repos;
@@ -2052,8 +2060,15 @@ svn_repos_hotcopy3(const char *src_path,
   fs_notify_baton.notify_func = notify_func;
   fs_notify_baton.notify_baton = notify_baton;
 
-  SVN_ERR(svn_fs_hotcopy3(src_repos->db_path, dst_repos->db_path,
-                          clean_logs, incremental,
+  if (jobs > 1)
+    {
+      fs_config = apr_hash_make(scratch_pool);
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_JOBS,
+                    apr_itoa(scratch_pool, jobs));
+    }
+
+  SVN_ERR(svn_fs_hotcopy4(src_repos->db_path, dst_repos->db_path,
+                          clean_logs, incremental, fs_config,
                           fs_notify_func, &fs_notify_baton,
                           cancel_func, cancel_baton, scratch_pool));
 
@@ -28,6 +28,9 @@
 
 #include "svn_fs.h"
 #include "svn_config.h"
+#include "svn_mergeinfo.h"
+
+#include "private/svn_sqlite.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -103,6 +106,10 @@ extern "C" {
 #define SVN_REPOS__CONF_AUTHZ "authz"
 #define SVN_REPOS__CONF_GROUPS "groups"
 
+/* The optional log index database, in the repository's top-level
+   directory.  See svn_repos__log_index_open(). */
+#define SVN_REPOS__LOG_INDEX_DB "log-index.db"
+
 /* The Repository object, created by svn_repos_open2() and
    svn_repos_create(). */
 struct svn_repos_t
@@ -387,6 +394,116 @@ svn_repos__prev_location(svn_revnum_t *appeared_rev,
                          const char *path,
                          apr_pool_t *pool);
 
+/* Set *DELETED_MERGEINFO_CATALOG and *ADDED_MERGEINFO_CATALOG to
+   catalogs describing how mergeinfo values on paths (which are the
+   keys of those catalogs) were changed in REV of FS.  Allocate the
+   result in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_repos__fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+                                svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+                                svn_fs_t *fs,
+                                svn_revnum_t rev,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool);
+
+
+/*** Log Index ***/
+
+/* The log index is an optional SQLite database in the repository that
+   records the result of svn_repos__fs_mergeinfo_changed() for every
+   revision.  Since revisions are immutable, 'svn log -g' can use it
+   instead of inspecting the changed paths and mergeinfo properties of
+   each revision in the log range over and over again.
+
+   It gets created and caught up by svn_repos_build_log_index() and,
+   once it exists, extended by every commit through the repos layer. */
+typedef struct svn_repos__log_index_t svn_repos__log_index_t;
+
+/* Open the log index of REPOS in *INDEX with the given MODE, allocated
+   in RESULT_POOL.  Unless MODE is svn_sqlite__mode_rwcreate, set *INDEX
+   to NULL if REPOS has no log index.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_repos__log_index_open(svn_repos__log_index_t **index,
+                          svn_repos_t *repos,
+                          svn_sqlite__mode_t mode,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/* Set *YOUNGEST to the youngest revision covered by INDEX.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__log_index_youngest(svn_revnum_t *youngest,
+                              svn_repos__log_index_t *index,
+                              apr_pool_t *scratch_pool);
+
+/* Add the revisions following the youngest indexed one up to and
+   including REVISION to INDEX.  If not NULL, call NOTIFY_FUNC with
+   NOTIFY_BATON for every revision range added.  Use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_repos__log_index_update(svn_repos__log_index_t *index,
+                            svn_revnum_t revision,
+                            svn_repos_notify_func_t notify_func,
+                            void *notify_baton,
+                            svn_cancel_func_t cancel_func,
+                            void *cancel_baton,
+                            apr_pool_t *scratch_pool);
+
+/* Update the log index of REPOS, if there is one, after NEW_REV has been
+   committed.  This is best-effort: errors are not fatal to the commit and
+   the caller should just clear them.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_repos__log_index_committed(svn_repos_t *repos,
+                               svn_revnum_t new_rev,
+                               apr_pool_t *scratch_pool);
+
+/* Look up the mergeinfo changes of REV in INDEX.  If REV is covered by
+   INDEX, set *FOUND and return the same catalogs as
+   svn_repos__fs_mergeinfo_changed() would in *DELETED_MERGEINFO_CATALOG
+   and *ADDED_MERGEINFO_CATALOG, allocated in RESULT_POOL.  Otherwise,
+   set *FOUND to FALSE.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__log_index_get(svn_boolean_t *found,
+                         svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+                         svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+                         svn_repos__log_index_t *index,
+                         svn_revnum_t rev,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool);
+
+
+/*** Load pipeline. ***/
+
+/* Like svn_repos_parse_dumpstream3() with DELTAS_ARE_TEXT set to FALSE,
+   but read STREAM on a separate thread and use up to JOBS worker threads
+   to decode the text deltas of upcoming revisions while PARSE_FNS still
+   processes earlier ones.  The reader stays at most a bounded number of
+   revisions ahead.  STREAM must not be used by the caller until this
+   function returns and must be allocated in a pool with a thread-safe
+   allocator.
+
+   All PARSE_FNS callbacks except magic_header_record must be provided.
+   They will be called from the calling thread and in the same order as
+   by svn_repos_parse_dumpstream3(), but the records of each revision will
+   only be passed on once the whole revision has been read.  Errors found
+   by the workers will be reported when the respective record is passed
+   on.  If the dump stream turns out to be malformed, all complete
+   revisions before that point will be passed on before returning the
+   error.  If PARSE_FNS fails, that error will be returned and the rest
+   of the stream will not be passed on.
+
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__parse_dumpstream_pipelined(svn_stream_t *stream,
+                                      const svn_repos_parse_fns3_t *parse_fns,
+                                      void *parse_baton,
+                                      int jobs,
+                                      svn_cancel_func_t cancel_func,
+                                      void *cancel_baton,
+                                      apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
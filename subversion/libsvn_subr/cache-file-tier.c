@@ -0,0 +1,628 @@
+/*
+ * cache-file-tier.c: persistent, memory-mapped cache level
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_mmap.h>
+
+#include "svn_io.h"
+#include "svn_dirent_uri.h"
+#include "svn_pools.h"
+#include "svn_version.h"
+
+#include "svn_private_config.h"
+
+#include "cache.h"
+#include "fnv1a.h"
+#include "private/svn_mutex.h"
+#include "private/svn_temp_serializer.h"
+
+/* This is a very simple, direct-mapped cache that lives in a single
+ * memory-mapped file.  The file consists of three sections:
+ *
+ * - A fixed-size header identifying the format, the build and the repository
+ *   instance that the contents belong to.
+ * - A hash index with one entry per bucket.  Each entry refers to the
+ *   most recent item written for that bucket.
+ * - A ring buffer of item records.  New items get appended at the current
+ *   write position and simply overwrite the oldest items once the end of
+ *   the buffer has been reached.
+ *
+ * Nothing here gets ever flushed explicitly.  Instead, every record
+ * carries a checksum over its key and contents.  Readers verify it on
+ * every access and treat mismatches as cache misses.  This covers items
+ * that were only partially written when the process died, index entries
+ * that refer to overwritten data as well as reads racing with writes.
+ *
+ * Writers serialize through a mutex within the process and through a lock
+ * on a separate lock file across processes.  Once created, a cache file
+ * never gets truncated or re-initialized in place because other processes
+ * may have it mapped.  Files that don't match the repository anymore get
+ * replaced by a new file instead.  Processes still mapping the old file
+ * continue to use it undisturbed until they re-open the repository.
+ */
+
+/* Identifies files in the format produced by this code.
+ */
+#define FILE_TIER_MAGIC "SVNCACHE"
+#define FILE_TIER_FORMAT 2
+
+/* Stored in native byte order to detect files created on platforms
+ * with a different endianness.
+ */
+#define FILE_TIER_BYTE_ORDER 0x01020304
+
+/* Size of the file header section in bytes. */
+#define HEADER_SIZE 0x1000
+
+/* Smallest file size that we accept. */
+#define MIN_FILE_SIZE 0x100000
+
+/* Average number of data bytes per index entry. */
+#define BYTES_PER_INDEX_ENTRY 256
+
+/* Records are aligned to this many bytes.  Must be a power of 2. */
+#define RECORD_ALIGNMENT 16
+
+/* Records larger than this fraction of the data section will not be
+ * stored because they would evict too much other data. */
+#define MAX_RECORD_FRACTION 8
+
+/* Align integer VALUE to the next RECORD_ALIGNMENT boundary. */
+#define ALIGN_RECORD(value) \
+  (((value) + RECORD_ALIGNMENT - 1) & ~(apr_uint64_t)(RECORD_ALIGNMENT - 1))
+
+/* Maximum length of the identifiers and version strings in the header. */
+#define MAX_ID_LEN 64
+
+/* The file header as it is stored at offset 0 of the file.
+ */
+typedef struct file_header_t
+{
+  /* FILE_TIER_MAGIC, not NUL-terminated. */
+  char magic[8];
+
+  /* FILE_TIER_FORMAT */
+  apr_uint32_t format;
+
+  /* FILE_TIER_BYTE_ORDER */
+  apr_uint32_t byte_order;
+
+  /* sizeof(void *) of the creating process.  Serialized items contain
+   * pointer-sized offsets. */
+  apr_uint32_t pointer_size;
+
+  /* SVN_TEMP_SERIALIZER__FORMAT of the creating process. */
+  apr_uint32_t serializer_format;
+
+  /* SVN_VER_NUMBER of the creating process, NUL-padded.  The serialized
+   * representation of any item type may change between versions. */
+  char svn_version[MAX_ID_LEN];
+
+  /* Number of entries in the index section. */
+  apr_uint32_t index_entries;
+
+  /* Total size of the file. */
+  apr_uint64_t file_size;
+
+  /* Offset of the first record in the ring buffer. */
+  apr_uint64_t data_start;
+
+  /* Offset at which the next record shall be written. */
+  apr_uint64_t write_pos;
+
+  /* Repository UUID and instance ID, NUL-padded. */
+  char uuid[MAX_ID_LEN];
+  char instance_id[MAX_ID_LEN];
+
+  /* Youngest revision in the repository when the file was last opened.
+   * If the repository turns out to be older than this, it has been
+   * replaced, e.g. by restoring a backup, and the contents are stale. */
+  apr_int64_t youngest;
+} file_header_t;
+
+/* An entry in the index section.
+ */
+typedef struct index_entry_t
+{
+  /* Hash value of the item key.  0 for unused entries. */
+  apr_uint64_t hash;
+
+  /* Offset of the item record within the file. */
+  apr_uint64_t offset;
+} index_entry_t;
+
+/* Header of an item record in the ring buffer.  It is immediately
+ * followed by the key and then the item data.
+ */
+typedef struct record_header_t
+{
+  /* Checksum over the lengths, the key and the data. */
+  apr_uint64_t checksum;
+
+  /* Length of the key in bytes. */
+  apr_uint32_t key_len;
+
+  /* Length of the item data in bytes. */
+  apr_uint32_t data_len;
+} record_header_t;
+
+struct svn_cache__file_tier_t
+{
+  /* Start of the mapped file contents. */
+  unsigned char *base;
+
+  /* The file header, located at BASE. */
+  file_header_t *header;
+
+  /* The index section and its number of entries. */
+  index_entry_t *index;
+  apr_uint32_t index_entries;
+
+  /* The ring buffer section is [DATA_START, DATA_END). */
+  apr_uint64_t data_start;
+  apr_uint64_t data_end;
+
+  /* Serializes writers within this process. */
+  svn_mutex__t *mutex;
+
+  /* Serializes writers and file replacements across processes. */
+  apr_file_t *lock_file;
+};
+
+/* Return a 64 bit hash value over the LEN bytes at DATA. */
+static apr_uint64_t
+hash_bytes(const void *data,
+           apr_size_t len)
+{
+  apr_uint32_t hashes[4];
+  svn__fnv1a_32x4_raw(hashes, data, len);
+
+  return ((apr_uint64_t)(hashes[0] ^ hashes[2]) << 32)
+       | (hashes[1] ^ hashes[3]);
+}
+
+/* Return the index hash for the KEY_LEN bytes at KEY.  Never returns 0. */
+static apr_uint64_t
+key_hash(const void *key,
+         apr_size_t key_len)
+{
+  apr_uint64_t hash = hash_bytes(key, key_len);
+  return hash ? hash : 1;
+}
+
+/* Return the record checksum for the KEY_LEN bytes at KEY followed by the
+ * DATA_LEN bytes at DATA. */
+static apr_uint64_t
+record_checksum(const void *key,
+                apr_uint32_t key_len,
+                const void *data,
+                apr_uint32_t data_len)
+{
+  /* Combine the partial hashes with the 64 bit FNV prime. */
+  apr_uint64_t checksum = hash_bytes(key, key_len);
+  checksum = checksum * APR_UINT64_C(0x100000001b3)
+           ^ hash_bytes(data, data_len);
+  checksum = checksum * APR_UINT64_C(0x100000001b3)
+           ^ (((apr_uint64_t)key_len << 32) | data_len);
+
+  return checksum;
+}
+
+/* Copy the identifier ID into the header field TARGET, padding it with
+ * NULs.  Overly long identifiers get truncated. */
+static void
+set_id(char target[MAX_ID_LEN],
+       const char *id)
+{
+  memset(target, 0, MAX_ID_LEN);
+  strncpy(target, id, MAX_ID_LEN - 1);
+}
+
+/* Return TRUE if the header field SOURCE matches ID as stored by set_id. */
+static svn_boolean_t
+id_matches(const char source[MAX_ID_LEN],
+           const char *id)
+{
+  char expected[MAX_ID_LEN];
+  set_id(expected, id);
+
+  return memcmp(source, expected, MAX_ID_LEN) == 0;
+}
+
+/* Set the section boundaries in TIER for a file of FILE_SIZE bytes. */
+static void
+init_layout(svn_cache__file_tier_t *tier,
+            apr_uint64_t file_size)
+{
+  tier->index_entries = (apr_uint32_t)(file_size / BYTES_PER_INDEX_ENTRY
+                                       / sizeof(index_entry_t));
+  tier->data_start
+    = ALIGN_RECORD(HEADER_SIZE
+                   + tier->index_entries * sizeof(index_entry_t));
+  tier->data_end = file_size;
+}
+
+/* Return TRUE if HEADER describes a usable file of FILE_SIZE bytes,
+ * belonging to the repository identified by UUID and INSTANCE_ID with
+ * YOUNGEST as its youngest revision. */
+static svn_boolean_t
+header_matches(const file_header_t *header,
+               apr_uint64_t file_size,
+               const char *uuid,
+               const char *instance_id,
+               svn_revnum_t youngest)
+{
+  svn_cache__file_tier_t layout;
+  init_layout(&layout, file_size);
+
+  return memcmp(header->magic, FILE_TIER_MAGIC, sizeof(header->magic)) == 0
+      && header->format == FILE_TIER_FORMAT
+      && header->byte_order == FILE_TIER_BYTE_ORDER
+      && header->pointer_size == sizeof(void *)
+      && header->serializer_format == SVN_TEMP_SERIALIZER__FORMAT
+      && id_matches(header->svn_version, SVN_VER_NUMBER)
+      && file_size >= MIN_FILE_SIZE
+      && file_size <= APR_SIZE_MAX
+      && header->file_size == file_size
+      && header->index_entries == layout.index_entries
+      && header->data_start == layout.data_start
+      && header->youngest <= youngest
+      && id_matches(header->uuid, uuid)
+      && id_matches(header->instance_id, instance_id);
+}
+
+/* Create a new, empty cache file of FILE_SIZE bytes for the repository
+ * identified by UUID, INSTANCE_ID and YOUNGEST and atomically move it into
+ * place at PATH.  Processes that have the previous file mapped keep using
+ * it without getting disturbed.  The caller must hold the lock file lock.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+replace_file(const char *path,
+             apr_uint64_t file_size,
+             const char *uuid,
+             const char *instance_id,
+             svn_revnum_t youngest,
+             apr_pool_t *scratch_pool)
+{
+  svn_cache__file_tier_t layout;
+  file_header_t header;
+  apr_file_t *file;
+  const char *tmp_path;
+
+  init_layout(&layout, file_size);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, FILE_TIER_MAGIC, sizeof(header.magic));
+  header.format = FILE_TIER_FORMAT;
+  header.byte_order = FILE_TIER_BYTE_ORDER;
+  header.pointer_size = sizeof(void *);
+  header.serializer_format = SVN_TEMP_SERIALIZER__FORMAT;
+  set_id(header.svn_version, SVN_VER_NUMBER);
+  header.index_entries = layout.index_entries;
+  header.file_size = file_size;
+  header.data_start = layout.data_start;
+  header.write_pos = layout.data_start;
+  header.youngest = youngest;
+  set_id(header.uuid, uuid);
+  set_id(header.instance_id, instance_id);
+
+  /* Extending the file fills the index with zeros, i.e. empty entries. */
+  SVN_ERR(svn_io_open_uniquely_named(&file, &tmp_path,
+                                     svn_dirent_dirname(path, scratch_pool),
+                                     svn_dirent_basename(path, scratch_pool),
+                                     ".tmp", svn_io_file_del_none,
+                                     scratch_pool, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, &header, sizeof(header), NULL,
+                                 scratch_pool));
+  SVN_ERR(svn_io_file_trunc(file, file_size, scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  return svn_error_trace(svn_io_file_rename2(tmp_path, path, FALSE,
+                                             scratch_pool));
+}
+
+/* Open the cache file at PATH in *FILE and read its header into *HEADER
+ * and its size into *FILE_SIZE.  If the file does not exist, set *FILE
+ * to NULL.  Allocate *FILE in RESULT_POOL.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+read_header(apr_file_t **file,
+            file_header_t *header,
+            apr_uint64_t *file_size,
+            const char *path,
+            apr_pool_t *result_pool,
+            apr_pool_t *scratch_pool)
+{
+  svn_filesize_t size;
+  apr_size_t bytes_read;
+  svn_error_t *err;
+
+  memset(header, 0, sizeof(*header));
+  *file_size = 0;
+
+  err = svn_io_file_open(file, path, APR_READ | APR_WRITE | APR_BINARY,
+                         APR_OS_DEFAULT, result_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *file = NULL;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_size_get(&size, *file, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(*file, header, sizeof(*header),
+                                 &bytes_read, NULL, scratch_pool));
+  *file_size = (apr_uint64_t)size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_cache__file_tier_open() for a TIER with an already
+ * locked lock file. */
+static svn_error_t *
+file_tier_open_locked(svn_cache__file_tier_t *tier,
+                      const char *path,
+                      apr_uint64_t size,
+                      const char *uuid,
+                      const char *instance_id,
+                      svn_revnum_t youngest,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  apr_mmap_t *mmap;
+  file_header_t header;
+  apr_uint64_t file_size;
+  apr_status_t status;
+
+  /* Keep existing files in whatever size they have.  Replace files that
+   * are missing or don't match this repository. */
+  SVN_ERR(read_header(&file, &header, &file_size, path, scratch_pool,
+                      scratch_pool));
+  if (!file || !header_matches(&header, file_size, uuid, instance_id,
+                               youngest))
+    {
+      if (file)
+        SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+      SVN_ERR(replace_file(path, size, uuid, instance_id, youngest,
+                           scratch_pool));
+      SVN_ERR(read_header(&file, &header, &file_size, path, scratch_pool,
+                          scratch_pool));
+      if (!file || !header_matches(&header, file_size, uuid, instance_id,
+                                   youngest))
+        return svn_error_createf(SVN_ERR_CORRUPTED_ATOMIC_STORAGE, NULL,
+                                 _("Can't initialize persistent cache '%s'"),
+                                 svn_dirent_local_style(path,
+                                                        scratch_pool));
+    }
+
+  status = apr_mmap_create(&mmap, file, 0, (apr_size_t)file_size,
+                           APR_MMAP_READ | APR_MMAP_WRITE, result_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't map persistent cache '%s'"),
+                              svn_dirent_local_style(path, scratch_pool));
+
+  /* The mapping remains valid after the file has been closed. */
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  tier->base = mmap->mm;
+  tier->header = (file_header_t *)tier->base;
+  tier->index = (index_entry_t *)(tier->base + HEADER_SIZE);
+  init_layout(tier, file_size);
+
+  /* Remember how far the repository got, so we can detect it being
+   * replaced by an older version.  This only ever moves forward. */
+  if (tier->header->youngest < youngest)
+    tier->header->youngest = youngest;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__file_tier_open(svn_cache__file_tier_t **tier,
+                          const char *path,
+                          apr_uint64_t size,
+                          const char *uuid,
+                          const char *instance_id,
+                          svn_revnum_t youngest,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+#if APR_HAS_MMAP
+  svn_cache__file_tier_t *result;
+  svn_error_t *err;
+
+  /* Only use full pages. */
+  size &= ~(apr_uint64_t)(HEADER_SIZE - 1);
+  if (size < MIN_FILE_SIZE || size > APR_SIZE_MAX)
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Invalid size %s for persistent cache '%s'"),
+                             apr_psprintf(scratch_pool,
+                                          "%" APR_UINT64_T_FMT, size),
+                             svn_dirent_local_style(path, scratch_pool));
+
+  result = apr_pcalloc(result_pool, sizeof(*result));
+  SVN_ERR(svn_mutex__init(&result->mutex, TRUE, result_pool));
+
+  /* The lock file stays open for the lifetime of the tier because
+   * closing any handle to it would release our locks. */
+  SVN_ERR(svn_io_file_open(&result->lock_file,
+                           apr_pstrcat(scratch_pool, path, ".lock",
+                                       SVN_VA_NULL),
+                           APR_READ | APR_WRITE | APR_CREATE | APR_BINARY,
+                           APR_OS_DEFAULT, result_pool));
+
+  SVN_ERR(svn_io_lock_open_file(result->lock_file, TRUE, FALSE,
+                                scratch_pool));
+  err = file_tier_open_locked(result, path, size, uuid, instance_id,
+                              youngest, result_pool, scratch_pool);
+  SVN_ERR(svn_error_compose_create(err,
+                                   svn_io_unlock_open_file(result->lock_file,
+                                                           scratch_pool)));
+
+  *tier = result;
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Persistent caches require support for "
+                            "memory-mapped files"));
+#endif
+}
+
+svn_error_t *
+svn_cache__file_tier_get(void **data,
+                         apr_size_t *size,
+                         svn_cache__file_tier_t *tier,
+                         const void *key,
+                         apr_size_t key_len,
+                         apr_pool_t *result_pool)
+{
+  apr_uint64_t hash = key_hash(key, key_len);
+  index_entry_t entry = tier->index[hash % tier->index_entries];
+  record_header_t record;
+  apr_uint64_t available;
+  char *buffer;
+
+  *data = NULL;
+  *size = 0;
+
+  /* Any other writer may modify the file concurrently.  So, verify that
+   * all offsets are within the ring buffer before accessing the record. */
+  if (   entry.hash != hash
+      || entry.offset < tier->data_start
+      || entry.offset > tier->data_end - sizeof(record))
+    return SVN_NO_ERROR;
+
+  memcpy(&record, tier->base + entry.offset, sizeof(record));
+  available = tier->data_end - entry.offset - sizeof(record);
+  if (   record.key_len != key_len
+      || key_len > available
+      || record.data_len > available - key_len)
+    return SVN_NO_ERROR;
+
+  if (memcmp(tier->base + entry.offset + sizeof(record), key, key_len))
+    return SVN_NO_ERROR;
+
+  /* Copy the data before verifying it.  Otherwise, the record might get
+   * modified after we checked it. */
+  buffer = apr_palloc(result_pool, record.data_len ? record.data_len : 1);
+  memcpy(buffer, tier->base + entry.offset + sizeof(record) + key_len,
+         record.data_len);
+
+  if (record.checksum != record_checksum(key, record.key_len,
+                                         buffer, record.data_len))
+    return SVN_NO_ERROR;
+
+  *data = buffer;
+  *size = record.data_len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the record for KEY with DATA to TIER.  The caller must hold both
+ * of TIER's locks.  RECORD_SIZE is the aligned total size of the new
+ * record. */
+static void
+write_record(svn_cache__file_tier_t *tier,
+             const void *key,
+             apr_uint32_t key_len,
+             const void *data,
+             apr_uint32_t data_len,
+             apr_uint64_t record_size)
+{
+  apr_uint64_t hash = key_hash(key, key_len);
+  index_entry_t *entry = &tier->index[hash % tier->index_entries];
+  apr_uint64_t offset = tier->header->write_pos;
+  record_header_t record;
+
+  /* Other processes may have messed with the write position. */
+  if (   offset < tier->data_start
+      || offset > tier->data_end
+      || offset % RECORD_ALIGNMENT)
+    offset = tier->data_start;
+
+  /* Wrap around at the end of the ring buffer. */
+  if (record_size > tier->data_end - offset)
+    offset = tier->data_start;
+
+  record.checksum = record_checksum(key, key_len, data, data_len);
+  record.key_len = key_len;
+  record.data_len = data_len;
+
+  memcpy(tier->base + offset, &record, sizeof(record));
+  memcpy(tier->base + offset + sizeof(record), key, key_len);
+  memcpy(tier->base + offset + sizeof(record) + key_len, data, data_len);
+  tier->header->write_pos = offset + record_size;
+
+  entry->hash = hash;
+  entry->offset = offset;
+}
+
+/* Implement svn_cache__file_tier_set() for TIER with its mutex already
+ * being held.  RECORD_SIZE is the aligned total size of the new record.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+file_tier_set_internal(svn_cache__file_tier_t *tier,
+                       const void *key,
+                       apr_uint32_t key_len,
+                       const void *data,
+                       apr_uint32_t data_len,
+                       apr_uint64_t record_size,
+                       apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_io_lock_open_file(tier->lock_file, TRUE, FALSE,
+                                scratch_pool));
+  write_record(tier, key, key_len, data, data_len, record_size);
+
+  return svn_error_trace(svn_io_unlock_open_file(tier->lock_file,
+                                                 scratch_pool));
+}
+
+svn_error_t *
+svn_cache__file_tier_set(svn_cache__file_tier_t *tier,
+                         const void *key,
+                         apr_size_t key_len,
+                         const void *data,
+                         apr_size_t size,
+                         apr_pool_t *scratch_pool)
+{
+  apr_uint64_t record_size
+    = ALIGN_RECORD(sizeof(record_header_t) + (apr_uint64_t)key_len + size);
+
+  if (   record_size > (tier->data_end - tier->data_start)
+                        / MAX_RECORD_FRACTION
+      || key_len > APR_UINT32_MAX
+      || size > APR_UINT32_MAX)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(tier->mutex,
+                       file_tier_set_internal(tier, key,
+                                              (apr_uint32_t)key_len,
+                                              data, (apr_uint32_t)size,
+                                              record_size, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
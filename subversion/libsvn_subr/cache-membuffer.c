@@ -129,6 +129,13 @@
  * to scale well despite that bottleneck, we simply segment the cache into
  * a number of independent caches (segments). Items will be multiplexed based
  * on their hash key.
+ *
+ * Writers must still hold the segment lock.  Plain lookups, however, are
+ * first attempted without any lock: every writer bumps the segment's
+ * GENERATION counter before and after modifying it.  A reader that sees
+ * the same even GENERATION value before and after copying the item data
+ * knows that the copy is consistent (seqlock scheme).  Only if a writer
+ * interfered, the reader falls back to acquiring the read lock.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -146,6 +153,16 @@
 #  define USE_SIMPLE_MUTEX 0
 #endif
 
+/* Try to serve membuffer_cache_get() without taking the segment lock.
+ * This is pointless without threads.  The debug code verifies content
+ * hashes under the lock, so we don't use it in that configuration either.
+ */
+#if APR_HAS_THREADS && !defined(SVN_DEBUG_CACHE_MEMBUFFER)
+#  define USE_OPTIMISTIC_READS 1
+#else
+#  define USE_OPTIMISTIC_READS 0
+#endif
+
 /* For more efficient copy operations, let's align all data items properly.
  * Since we can't portably align pointers, this is rather the item size
  * granularity which ensures *relative* alignment within the cache - still
@@ -817,6 +834,12 @@ struct svn_membuffer_t
    * This one is only used in debug assertions to verify that you used
    * the correct multi-threading settings. */
   svn_atomic_t write_lock_count;
+
+  /* Modification counter used to validate unlocked reads.  Writers
+   * increment it once after acquiring the write lock and once more before
+   * releasing it.  Hence, it is odd while the segment is being modified.
+   */
+  volatile svn_atomic_t generation;
 };
 
 /* Align integer VALUE to the next ITEM_ALIGNMENT boundary.
@@ -927,6 +950,36 @@ unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 #endif
 }
 
+/* Full memory barrier.  APR does not provide explicit fences but all its
+ * atomic read-modify-write operations imply one.  Use a local variable as
+ * the target such that we don't cause cache line contention.
+ */
+static APR_INLINE void
+memory_barrier(void)
+{
+  volatile svn_atomic_t fence = 0;
+  svn_atomic_inc(&fence);
+}
+
+/* Tell concurrent unlocked readers that CACHE is about to be modified.
+ * The caller must hold the write lock.
+ */
+static APR_INLINE void
+begin_write(svn_membuffer_t *cache)
+{
+  svn_atomic_inc(&cache->generation);
+}
+
+/* Tell concurrent unlocked readers that the modification of CACHE is
+ * complete.  The caller must still hold the write lock.  Return ERR.
+ */
+static APR_INLINE svn_error_t *
+end_write(svn_membuffer_t *cache, svn_error_t *err)
+{
+  svn_atomic_inc(&cache->generation);
+  return err;
+}
+
 /* If supported, guard the execution of EXPR with a read lock to CACHE.
  * The macro has been modeled after SVN_MUTEX__WITH_LOCK.
  */
@@ -959,7 +1012,8 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  begin_write(cache);                                           \
+  SVN_ERR(unlock_cache(cache, end_write(cache, (expr))));       \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -2046,6 +2100,7 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
 #endif
       /* No writers at the moment. */
       c[seg].write_lock_count = 0;
+      c[seg].generation = 0;
     }
 
   /* done here
@@ -2078,6 +2133,7 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
     {
       /* Unconditionally acquire the write lock. */
       SVN_ERR(force_write_lock_cache(&cache[seg]));
+      begin_write(&cache[seg]);
 
       /* Mark all groups as "not initialized", which implies "empty". */
       cache[seg].first_spare_group = NO_INDEX;
@@ -2102,7 +2158,8 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
       cache[seg].used_entries = 0;
 
       /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+      SVN_ERR(unlock_cache(&cache[seg], end_write(&cache[seg],
+                                                  SVN_NO_ERROR)));
     }
 
   /* done here */
@@ -2310,37 +2367,28 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
-/* Try to insert the ITEM and use the KEY to uniquely identify it.
- * However, there is no guarantee that it will actually be put into
- * the cache. If there is already some data associated to the KEY,
- * it will be removed from the cache even if the new data cannot
- * be inserted.
- *
- * The SERIALIZER is called to transform the ITEM into a single,
- * flat data buffer. Temporary allocations may be done in POOL.
+/* Try to insert the serialized item of SIZE bytes in BUFFER and use the
+ * KEY to uniquely identify it.  However, there is no guarantee that it
+ * will actually be put into the cache. If there is already some data
+ * associated to the KEY, it will be removed from the cache even if the
+ * new data cannot be inserted.  A NULL BUFFER simply removes the old
+ * data.  Temporary allocations may be done in SCRATCH_POOL.
  */
 static svn_error_t *
-membuffer_cache_set(svn_membuffer_t *cache,
-                    const full_key_t *key,
-                    void *item,
-                    svn_cache__serialize_func_t serializer,
-                    apr_uint32_t priority,
-                    DEBUG_CACHE_MEMBUFFER_TAG_ARG
-                    apr_pool_t *scratch_pool)
+membuffer_cache_set_serialized(svn_membuffer_t *cache,
+                               const full_key_t *key,
+                               void *buffer,
+                               apr_size_t size,
+                               apr_uint32_t priority,
+                               DEBUG_CACHE_MEMBUFFER_TAG_ARG
+                               apr_pool_t *scratch_pool)
 {
   apr_uint32_t group_index;
-  void *buffer = NULL;
-  apr_size_t size = 0;
 
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
 
-  /* Serialize data data.
-   */
-  if (item)
-    SVN_ERR(serializer(&buffer, &size, item, scratch_pool));
-
   /* The actual cache data access needs to sync'ed
    */
   WITH_WRITE_LOCK(cache,
@@ -2355,6 +2403,32 @@ membuffer_cache_set(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* Like membuffer_cache_set_serialized but take the ITEM in its original
+ * form and transform it into a single, flat data buffer using SERIALIZER.
+ */
+static svn_error_t *
+membuffer_cache_set(svn_membuffer_t *cache,
+                    const full_key_t *key,
+                    void *item,
+                    svn_cache__serialize_func_t serializer,
+                    apr_uint32_t priority,
+                    DEBUG_CACHE_MEMBUFFER_TAG_ARG
+                    apr_pool_t *scratch_pool)
+{
+  void *buffer = NULL;
+  apr_size_t size = 0;
+
+  /* Serialize data data.
+   */
+  if (item)
+    SVN_ERR(serializer(&buffer, &size, item, scratch_pool));
+
+  return svn_error_trace(
+           membuffer_cache_set_serialized(cache, key, buffer, size, priority,
+                                          DEBUG_CACHE_MEMBUFFER_TAG
+                                          scratch_pool));
+}
+
 /* Count a hit in ENTRY within CACHE.
  */
 static void
@@ -2363,7 +2437,10 @@ increment_hit_counters(svn_membuffer_t *cache, entry_t *entry)
   /* To minimize the memory footprint of the cache index, we limit local
    * hit counters to 32 bits.  These may overflow but we don't really
    * care because at worst, ENTRY will be dropped from cache once every
-   * few billion hits. */
+   * few billion hits.
+   *
+   * Unlocked readers may race with writers updating the counter.  Losing
+   * a hit in that case only affects the eviction heuristics. */
   svn_atomic_inc(&entry->hit_count);
 
   /* That one is for stats only. */
@@ -2433,6 +2510,136 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+#if USE_OPTIMISTIC_READS
+
+/* Like find_entry with FIND_EMPTY not set but without requiring any lock
+ * on CACHE.  Concurrent writers may modify the directory while we traverse
+ * it.  So, every reference gets range-checked and the result is only
+ * meaningful if CACHE->GENERATION did not change in the meantime.
+ */
+static entry_t *
+find_entry_unlocked(svn_membuffer_t *cache,
+                    apr_uint32_t group_index,
+                    const full_key_t *to_find)
+{
+  apr_uint32_t group_limit = cache->group_count + cache->spare_group_count;
+  apr_uint64_t data_size = cache->l1.size + cache->l2.size;
+  entry_group_t *group = &cache->directory[group_index];
+  int chain_length;
+
+  if (! is_group_initialized(cache, group_index))
+    return NULL;
+
+  for (chain_length = 0; chain_length < MAX_GROUP_CHAIN_LENGTH;
+       ++chain_length)
+    {
+      apr_uint32_t used = group->header.used;
+      apr_uint32_t next = group->header.next;
+      apr_uint32_t i;
+
+      for (i = 0; i < used && i < GROUP_SIZE; ++i)
+        {
+          entry_t *entry = &group->entries[i];
+          apr_uint64_t offset;
+          apr_size_t key_len;
+
+          if (!entry_keys_match(&entry->key, &to_find->entry_key))
+            continue;
+
+          /* The full key, if present, must match as well. */
+          offset = entry->offset;
+          key_len = to_find->entry_key.key_len;
+          if (!key_len)
+            return entry;
+
+          if (offset > data_size || key_len > data_size - offset)
+            return NULL;
+
+          return memcmp(to_find->full_key.data, cache->data + offset,
+                        key_len) == 0 ? entry : NULL;
+        }
+
+      /* end of chain? */
+      if (next == NO_INDEX || next >= group_limit)
+        break;
+
+      group = &cache->directory[next];
+    }
+
+  return NULL;
+}
+
+/* Try to look up the entry identified by TO_FIND in group GROUP_INDEX of
+ * CACHE without acquiring the segment lock.  If that succeeded, set *VALID
+ * and return the results in *BUFFER and *ITEM_SIZE exactly like
+ * membuffer_cache_get_internal would.  If a concurrent writer interfered,
+ * clear *VALID and the caller has to repeat the lookup under the lock.
+ * Allocations will be done in RESULT_POOL.
+ */
+static void
+membuffer_cache_get_optimistic(svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               svn_boolean_t *valid,
+                               apr_pool_t *result_pool)
+{
+  apr_uint64_t data_size = cache->l1.size + cache->l2.size;
+  apr_uint32_t generation = svn_atomic_read(&cache->generation);
+  entry_t *entry;
+  char *data = NULL;
+  apr_size_t size = 0;
+
+  *valid = FALSE;
+
+  /* Some writer is active.  Don't even try. */
+  if (generation & 1)
+    return;
+
+  memory_barrier();
+
+  entry = find_entry_unlocked(cache, group_index, to_find);
+  if (entry)
+    {
+      /* Read each value only once and check that they describe a valid
+       * section of the data buffer.  Whether they are actually consistent
+       * will be determined when we validate the GENERATION. */
+      apr_uint64_t offset = entry->offset;
+      apr_size_t entry_size = entry->size;
+      apr_size_t key_len = entry->key.key_len;
+      apr_size_t aligned_size = ALIGN_VALUE(entry_size);
+
+      if (   entry_size > cache->max_entry_size
+          || key_len > entry_size
+          || offset > data_size
+          || aligned_size > data_size - offset)
+        return;
+
+      data = apr_palloc(result_pool, aligned_size - key_len);
+      memcpy(data, cache->data + offset + key_len, aligned_size - key_len);
+      size = entry_size - key_len;
+    }
+
+  memory_barrier();
+
+  /* Has the segment been modified while we were reading it? */
+  if (svn_atomic_read(&cache->generation) != generation)
+    return;
+
+  /* update hit statistics
+   */
+  cache->total_reads++;
+  if (entry)
+    increment_hit_counters(cache, entry);
+
+  *buffer = data;
+  *item_size = size;
+  *valid = TRUE;
+}
+
+#endif
+
 /* Look for the *ITEM identified by KEY. If no item has been stored
  * for KEY, *ITEM will be NULL. Otherwise, the DESERIALIZER is called
  * to re-construct the proper object from the serialized data.
@@ -2449,18 +2656,29 @@ membuffer_cache_get(svn_membuffer_t *cache,
   apr_uint32_t group_index;
   char *buffer;
   apr_size_t size;
+#if USE_OPTIMISTIC_READS
+  svn_boolean_t valid;
+#endif
 
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_internal(cache,
-                                              group_index,
-                                              key,
-                                              &buffer,
-                                              &size,
-                                              DEBUG_CACHE_MEMBUFFER_TAG
-                                              result_pool));
+
+#if USE_OPTIMISTIC_READS
+  /* Most of the time, there will be no concurrent writer to this segment
+   * and we don't need to acquire the lock. */
+  membuffer_cache_get_optimistic(cache, group_index, key, &buffer, &size,
+                                 &valid, result_pool);
+  if (!valid)
+#endif
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_get_internal(cache,
+                                                group_index,
+                                                key,
+                                                &buffer,
+                                                &size,
+                                                DEBUG_CACHE_MEMBUFFER_TAG
+                                                result_pool));
 
   /* re-construct the original data object from its serialized form.
    */
@@ -2806,6 +3024,10 @@ typedef struct svn_membuffer_cache_t
   /* if enabled, this will serialize the access to this instance.
    */
   svn_mutex__t *mutex;
+
+  /* Persistent level underneath MEMBUFFER.  May be NULL.
+   */
+  svn_cache__file_tier_t *file_tier;
 } svn_membuffer_cache_t;
 
 /* Return the prefix key used by CACHE. */
@@ -2917,6 +3139,65 @@ combine_key(svn_membuffer_cache_t *cache,
     = data[1] ^ cache->prefix.fingerprint[1];
 }
 
+/* Return the key under which CACHE->FILE_TIER stores the item identified
+ * by KEY in *TIER_KEY and its length in *TIER_KEY_LEN.  Unlike the combined
+ * key, this must not depend on process-local state such as the prefix
+ * pool indexes.  Allocate the result in RESULT_POOL.
+ */
+static void
+get_file_tier_key(const void **tier_key,
+                  apr_size_t *tier_key_len,
+                  svn_membuffer_cache_t *cache,
+                  const void *key,
+                  apr_pool_t *result_pool)
+{
+  const char *prefix = get_prefix_key(cache);
+  apr_size_t prefix_len = strlen(prefix) + 1;
+  apr_size_t key_len = cache->key_len == APR_HASH_KEY_STRING
+                     ? strlen(key)
+                     : cache->key_len;
+  char *result = apr_palloc(result_pool, prefix_len + key_len);
+
+  memcpy(result, prefix, prefix_len);
+  memcpy(result + prefix_len, key, key_len);
+
+  *tier_key = result;
+  *tier_key_len = prefix_len + key_len;
+}
+
+/* Look for the item identified by KEY in CACHE->FILE_TIER.  If found,
+ * return its serialized form in *BUFFER and its size in *SIZE.  Also, add
+ * it to the in-memory cache again.  Otherwise, set *BUFFER to NULL.
+ * CACHE->COMBINED_KEY must have been set for KEY already.
+ * Allocate *BUFFER in RESULT_POOL.
+ */
+static svn_error_t *
+get_from_file_tier(void **buffer,
+                   apr_size_t *size,
+                   svn_membuffer_cache_t *cache,
+                   const void *key,
+                   DEBUG_CACHE_MEMBUFFER_TAG_ARG
+                   apr_pool_t *result_pool)
+{
+  const void *tier_key;
+  apr_size_t tier_key_len;
+
+  get_file_tier_key(&tier_key, &tier_key_len, cache, key, result_pool);
+  SVN_ERR(svn_cache__file_tier_get(buffer, size, cache->file_tier,
+                                   tier_key, tier_key_len, result_pool));
+
+  /* Promote the item to the in-memory levels.  This copies the data,
+   * so the caller may deserialize BUFFER in-place. */
+  if (*buffer)
+    SVN_ERR(membuffer_cache_set_serialized(cache->membuffer,
+                                           &cache->combined_key,
+                                           *buffer, *size, cache->priority,
+                                           DEBUG_CACHE_MEMBUFFER_TAG
+                                           result_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Implement svn_cache__vtable_t.get (not thread-safe)
  */
 static svn_error_t *
@@ -2952,6 +3233,18 @@ svn_membuffer_cache_get(void **value_p,
                               DEBUG_CACHE_MEMBUFFER_TAG
                               result_pool));
 
+  /* Fall back to the persistent level. */
+  if (*value_p == NULL && cache->file_tier)
+    {
+      void *buffer;
+      apr_size_t size;
+
+      SVN_ERR(get_from_file_tier(&buffer, &size, cache, key,
+                                 DEBUG_CACHE_MEMBUFFER_TAG result_pool));
+      if (buffer)
+        SVN_ERR(cache->deserializer(value_p, buffer, size, result_pool));
+    }
+
   /* return result */
   *found = *value_p != NULL;
 
@@ -3011,6 +3304,29 @@ svn_membuffer_cache_set(void *cache_void,
    */
   combine_key(cache, key, cache->key_len);
 
+  /* Write through to the persistent level. */
+  if (cache->file_tier && value)
+    {
+      void *buffer;
+      apr_size_t size;
+      const void *tier_key;
+      apr_size_t tier_key_len;
+
+      SVN_ERR(cache->serializer(&buffer, &size, value, scratch_pool));
+      get_file_tier_key(&tier_key, &tier_key_len, cache, key, scratch_pool);
+      SVN_ERR(svn_cache__file_tier_set(cache->file_tier,
+                                       tier_key, tier_key_len,
+                                       buffer, size, scratch_pool));
+
+      return svn_error_trace(
+               membuffer_cache_set_serialized(cache->membuffer,
+                                              &cache->combined_key,
+                                              buffer, size,
+                                              cache->priority,
+                                              DEBUG_CACHE_MEMBUFFER_TAG
+                                              scratch_pool));
+    }
+
   /* (probably) add the item to the cache. But there is no real guarantee
    * that the item will actually be cached afterwards.
    */
@@ -3069,6 +3385,21 @@ svn_membuffer_cache_get_partial(void **value_p,
                                       DEBUG_CACHE_MEMBUFFER_TAG
                                       result_pool));
 
+  /* Fall back to the persistent level. */
+  if (!*found && cache->file_tier)
+    {
+      void *buffer;
+      apr_size_t size;
+
+      SVN_ERR(get_from_file_tier(&buffer, &size, cache, key,
+                                 DEBUG_CACHE_MEMBUFFER_TAG result_pool));
+      if (buffer)
+        {
+          SVN_ERR(func(value_p, buffer, size, baton, result_pool));
+          *found = TRUE;
+        }
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -3341,18 +3672,22 @@ deserialize_svn_stringbuf(void **item,
 
 /* Construct a svn_cache__t object on top of a shared memcache.
  */
-svn_error_t *
-svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
-                                  svn_membuffer_t *membuffer,
-                                  svn_cache__serialize_func_t serializer,
-                                  svn_cache__deserialize_func_t deserializer,
-                                  apr_ssize_t klen,
-                                  const char *prefix,
-                                  apr_uint32_t priority,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t short_lived,
-                                  apr_pool_t *result_pool,
-                                  apr_pool_t *scratch_pool)
+/* Implement svn_cache__create_membuffer_cache and
+ * svn_cache__create_persistent_membuffer_cache.  FILE_TIER may be NULL.
+ */
+static svn_error_t *
+create_membuffer_cache(svn_cache__t **cache_p,
+                       svn_membuffer_t *membuffer,
+                       svn_cache__file_tier_t *file_tier,
+                       svn_cache__serialize_func_t serializer,
+                       svn_cache__deserialize_func_t deserializer,
+                       apr_ssize_t klen,
+                       const char *prefix,
+                       apr_uint32_t priority,
+                       svn_boolean_t thread_safe,
+                       svn_boolean_t short_lived,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
 {
   svn_checksum_t *checksum;
   apr_size_t prefix_len, prefix_orig_len;
@@ -3373,6 +3708,7 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
                       : deserialize_svn_stringbuf;
   cache->priority = priority;
   cache->key_len = klen;
+  cache->file_tier = file_tier;
 
   SVN_ERR(svn_mutex__init(&cache->mutex, thread_safe, result_pool));
 
@@ -3444,6 +3780,49 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
+                                  svn_membuffer_t *membuffer,
+                                  svn_cache__serialize_func_t serializer,
+                                  svn_cache__deserialize_func_t deserializer,
+                                  apr_ssize_t klen,
+                                  const char *prefix,
+                                  apr_uint32_t priority,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t short_lived,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(create_membuffer_cache(cache_p, membuffer, NULL,
+                                                serializer, deserializer,
+                                                klen, prefix, priority,
+                                                thread_safe, short_lived,
+                                                result_pool, scratch_pool));
+}
+
+svn_error_t *
+svn_cache__create_persistent_membuffer_cache(
+  svn_cache__t **cache_p,
+  svn_membuffer_t *membuffer,
+  svn_cache__file_tier_t *file_tier,
+  svn_cache__serialize_func_t serializer,
+  svn_cache__deserialize_func_t deserializer,
+  apr_ssize_t klen,
+  const char *prefix,
+  apr_uint32_t priority,
+  svn_boolean_t thread_safe,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool)
+{
+  /* Persistent data is long-lived by definition. */
+  return svn_error_trace(create_membuffer_cache(cache_p, membuffer,
+                                                file_tier,
+                                                serializer, deserializer,
+                                                klen, prefix, priority,
+                                                thread_safe, FALSE,
+                                                result_pool, scratch_pool));
+}
+
 static svn_error_t *
 svn_membuffer_get_global_segment_info(svn_membuffer_t *segment,
                                       svn_cache__info_t *info)
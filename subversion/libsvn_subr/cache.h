@@ -112,6 +112,31 @@ struct svn_cache__t {
 };
 
 
+/* Look up the item identified by the KEY_LEN bytes at KEY in TIER.
+ * If found, return a copy of its serialized form in *DATA and its size
+ * in *SIZE.  Otherwise, set *DATA to NULL.  Allocate *DATA in
+ * RESULT_POOL. */
+svn_error_t *
+svn_cache__file_tier_get(void **data,
+                         apr_size_t *size,
+                         svn_cache__file_tier_t *tier,
+                         const void *key,
+                         apr_size_t key_len,
+                         apr_pool_t *result_pool);
+
+/* Store the SIZE bytes of serialized item DATA in TIER and identify them
+ * by the KEY_LEN bytes at KEY.  This may silently evict other items.
+ * Items that are too large will not be stored.  Use SCRATCH_POOL for
+ * temporary allocations. */
+svn_error_t *
+svn_cache__file_tier_set(svn_cache__file_tier_t *tier,
+                         const void *key,
+                         apr_size_t key_len,
+                         const void *data,
+                         apr_size_t size,
+                         apr_pool_t *scratch_pool);
+
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
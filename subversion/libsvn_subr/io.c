@@ -51,6 +51,11 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_LINUX_FS_H
+#include <sys/ioctl.h>
+#include <linux/fs.h>   /* for FICLONE */
+#endif
+
 #include "svn_hash.h"
 #include "svn_types.h"
 #include "svn_dirent_uri.h"
@@ -916,17 +921,96 @@ copy_contents(apr_file_t *from_file,
   /* NOTREACHED */
 }
 
+/* Try to let the kernel transfer the contents of FROM_FILE to the empty
+ * TO_FILE without passing the data through user space.  Where supported
+ * by the file system, this will clone (reflink) the data blocks, or else
+ * use copy_file_range().  Both files must not have been read from or
+ * written to, yet.
+ *
+ * Set *COPIED to TRUE if the contents have been copied.  Set it to FALSE
+ * if the platform or file system does not support this kind of copy; the
+ * files will then be unchanged and a normal copy must be made.
+ */
+static apr_status_t
+copy_contents_in_kernel(svn_boolean_t *copied,
+                        apr_file_t *from_file,
+                        apr_file_t *to_file)
+{
+#if (defined(HAVE_LINUX_FS_H) && defined(FICLONE)) \
+    || defined(HAVE_COPY_FILE_RANGE)
+  apr_os_file_t from_fd;
+  apr_os_file_t to_fd;
+  apr_status_t status;
 
-svn_error_t *
-svn_io_copy_file(const char *src,
-                 const char *dst,
-                 svn_boolean_t copy_perms,
-                 apr_pool_t *pool)
+  *copied = FALSE;
+
+  status = apr_os_file_get(&from_fd, from_file);
+  if (status)
+    return status;
+  status = apr_os_file_get(&to_fd, to_file);
+  if (status)
+    return status;
+
+#if defined(HAVE_LINUX_FS_H) && defined(FICLONE)
+  /* Sharing the data blocks is the cheapest way by far. */
+  if (ioctl(to_fd, FICLONE, from_fd) == 0)
+    {
+      *copied = TRUE;
+      return APR_SUCCESS;
+    }
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+  while (TRUE)
+    {
+      ssize_t bytes_copied = copy_file_range(from_fd, NULL, to_fd, NULL,
+                                             0x40000000, 0);
+      if (bytes_copied > 0)
+        {
+          *copied = TRUE;
+        }
+      else if (bytes_copied == 0)
+        {
+          /* End of file.  If nothing has been copied at all, the file is
+           * either empty or some special file that copy_file_range does
+           * not support.  Let the caller handle it in either case. */
+          return APR_SUCCESS;
+        }
+      else if (errno != EINTR)
+        {
+          /* Unsupported by the kernel or the file systems involved?
+           * Then, nothing has been changed and the caller may fall back
+           * to a normal copy. */
+          if (!*copied)
+            return APR_SUCCESS;
+
+          return APR_FROM_OS_ERROR(errno);
+        }
+    }
+#else
+  return APR_SUCCESS;
+#endif
+
+#else
+  *copied = FALSE;
+  return APR_SUCCESS;
+#endif
+}
+
+/* Implement svn_io_copy_file() and svn_io__copy_file_in_kernel().
+ * Try copy_contents_in_kernel() first, if IN_KERNEL is set. */
+static svn_error_t *
+copy_file(const char *src,
+          const char *dst,
+          svn_boolean_t copy_perms,
+          svn_boolean_t in_kernel,
+          apr_pool_t *pool)
 {
   apr_file_t *from_file, *to_file;
-  apr_status_t apr_err;
+  apr_status_t apr_err = APR_SUCCESS;
   const char *dst_tmp;
   svn_error_t *err;
+  svn_boolean_t copied = FALSE;
 
   /* ### NOTE: sometimes src == dst. In this case, because we copy to a
      ###   temporary file, and then rename over the top of the destination,
@@ -956,7 +1040,10 @@ svn_io_copy_file(const char *src,
                                    svn_dirent_dirname(dst, pool),
                                    svn_io_file_del_none, pool, pool));
 
-  apr_err = copy_contents(from_file, to_file, pool);
+  if (in_kernel)
+    apr_err = copy_contents_in_kernel(&copied, from_file, to_file);
+  if (!apr_err && !copied)
+    apr_err = copy_contents(from_file, to_file, pool);
 
   if (apr_err)
     {
@@ -990,6 +1077,24 @@ svn_io_copy_file(const char *src,
   return svn_error_trace(svn_io_file_rename2(dst_tmp, dst, FALSE, pool));
 }
 
+svn_error_t *
+svn_io_copy_file(const char *src,
+                 const char *dst,
+                 svn_boolean_t copy_perms,
+                 apr_pool_t *pool)
+{
+  return svn_error_trace(copy_file(src, dst, copy_perms, FALSE, pool));
+}
+
+svn_error_t *
+svn_io__copy_file_in_kernel(const char *src,
+                            const char *dst,
+                            svn_boolean_t copy_perms,
+                            apr_pool_t *pool)
+{
+  return svn_error_trace(copy_file(src, dst, copy_perms, TRUE, pool));
+}
+
 #if !defined(WIN32) && !defined(__OS2__)
 /* Wrapper for apr_file_perms_set(), taking a UTF8-encoded filename. */
 static svn_error_t *
@@ -32,6 +32,12 @@
 #include <apr_poll.h>
 #include <apr_portable.h>
 
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+#endif
+
 #include <zlib.h>
 
 #include "svn_pools.h"
@@ -48,6 +54,7 @@
 #include "private/svn_eol_private.h"
 #include "private/svn_io_private.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_task.h"
 #include "private/svn_utf_private.h"
 
 
@@ -1358,6 +1365,848 @@ svn_stream_compressed(svn_stream_t *stream, apr_pool_t *pool)
   return zstream;
 }
 
+
+/* Block-compressed stream support */
+
+/* Magic bytes at the start of every block-compressed stream.  They are
+   followed by the format version and the compression method, one byte
+   each. */
+#define BLOCK_MAGIC "SVNZ"
+#define BLOCK_MAGIC_LEN 4
+#define BLOCK_HEADER_LEN (BLOCK_MAGIC_LEN + 2)
+#define BLOCK_FORMAT 1
+
+/* Maximum uncompressed size of a block. */
+#define BLOCK_SIZE 0x100000
+
+/* Blocks get completed at record boundaries only if they have at least
+   this many bytes.  Smaller blocks would compress badly. */
+#define BLOCK_MIN_SIZE 0x10000
+
+/* Upper limit to the payload size of a block.  Even incompressible data
+   never grows by that much. */
+#define BLOCK_MAX_PAYLOAD (2 * BLOCK_SIZE)
+
+/* Number of blocks per thread to (de-)compress in one go. */
+#define BLOCKS_PER_JOB 4
+
+/* Number of full batches that may wait for the compressor thread before
+   writing to the stream blocks. */
+#define COMPRESS_QUEUE_DEPTH 2
+
+/* A single block of a block-compressed stream. */
+typedef struct block_t
+{
+  /* The uncompressed data when writing, the payload when reading. */
+  svn_stringbuf_t *data;
+
+  /* Whether this block starts at a record boundary. */
+  svn_boolean_t record_start;
+} block_t;
+
+struct block_baton
+{
+  /* The stream containing the compressed data. */
+  svn_stream_t *substream;
+
+  /* SVN_STREAM__BLOCK_COMPRESSION_* */
+  int compression;
+
+  /* Maximum number of threads to use. */
+  int jobs;
+
+  /* Blocks that still need to be (de-)compressed, allocated in
+     BATCH_POOL. */
+  apr_array_header_t *batch;
+  apr_pool_t *batch_pool;
+
+  /* When writing, the block being filled or NULL.  When reading, the
+     decompressed data of the last batch or, in pass-through mode, the
+     data already read from SUBSTREAM. */
+  svn_stringbuf_t *current;
+
+  /* Whether CURRENT starts at a record boundary (writing only). */
+  svn_boolean_t record_start;
+
+  /* Number of bytes of CURRENT already returned (reading only). */
+  apr_size_t read_pos;
+
+  /* Whether we already handled the header. */
+  svn_boolean_t header_done;
+
+  /* Whether SUBSTREAM is not block-compressed (reading only). */
+  svn_boolean_t passthrough;
+
+  /* Whether we reached the end marker (reading only). */
+  svn_boolean_t eof;
+
+#if APR_HAS_THREADS
+  /* Writing only.  Full batches get compressed and written to SUBSTREAM
+     by a background thread, which is started with the first batch.
+     Once that thread runs, only it may use SUBSTREAM and HEADER_DONE.
+
+     QUEUE holds up to COMPRESS_QUEUE_DEPTH batches, batch I using slot
+     I % COMPRESS_QUEUE_DEPTH.  The queue members, FINISHED, ABORTED and
+     ERROR are protected by MUTEX. */
+  struct write_batch_t *queue[COMPRESS_QUEUE_DEPTH];
+  apr_int64_t queued;
+  apr_int64_t taken;
+
+  /* No more batches will be queued. */
+  svn_boolean_t finished;
+
+  /* Discard all queued batches. */
+  svn_boolean_t aborted;
+
+  /* First error returned while compressing or writing a batch. */
+  svn_error_t *error;
+
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *cond;
+  apr_thread_t *thread;
+
+  /* Root pool with a thread-safe allocator.  All batch pools are created
+     in it, so they may be destroyed by the background thread. */
+  apr_pool_t *batches_pool;
+
+  /* The pool that this baton got allocated in. */
+  apr_pool_t *pool;
+#endif
+};
+
+/* A batch of blocks handed over to the compressor thread. */
+typedef struct write_batch_t
+{
+  /* The stream to write to. */
+  struct block_baton *btn;
+
+  /* The blocks (block_t) to compress. */
+  apr_array_header_t *blocks;
+
+  /* The pool that the blocks are allocated in.  Will be destroyed after
+     the batch has been written. */
+  apr_pool_t *pool;
+} write_batch_t;
+
+svn_error_t *
+svn_stream__parse_block_compression(int *compression,
+                                    const char *word)
+{
+  if (strcmp(word, "zlib") == 0)
+    *compression = SVN_STREAM__BLOCK_COMPRESSION_ZLIB;
+  else if (strcmp(word, "lz4") == 0)
+    *compression = SVN_STREAM__BLOCK_COMPRESSION_LZ4;
+  else
+    return svn_error_createf(SVN_ERR_BAD_COMPRESSION_METHOD, NULL,
+                             _("Unknown compression method '%s'; "
+                               "use 'zlib' or 'lz4'"), word);
+
+  return SVN_NO_ERROR;
+}
+
+/* Start a new, empty batch of blocks in BTN. */
+static void
+reset_batch(struct block_baton *btn)
+{
+  svn_pool_clear(btn->batch_pool);
+  btn->batch = apr_array_make(btn->batch_pool,
+                              MAX(btn->jobs, 1) * BLOCKS_PER_JOB,
+                              sizeof(block_t));
+}
+
+/* Implements svn_task__process_func_t.  Compress block number INDEX in
+   the write_batch_t * PROCESS_BATON and return the payload as
+   svn_stringbuf_t * in *RESULT. */
+static svn_error_t *
+compress_block(void **result,
+               void *thread_context,
+               void *process_baton,
+               apr_int64_t index,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  write_batch_t *batch = process_baton;
+  struct block_baton *btn = batch->btn;
+  const block_t *block = &APR_ARRAY_IDX(batch->blocks, (int)index, block_t);
+  svn_stringbuf_t *payload = svn_stringbuf_create_empty(result_pool);
+
+  if (btn->compression == SVN_STREAM__BLOCK_COMPRESSION_LZ4)
+    SVN_ERR(svn__compress_lz4(block->data->data, block->data->len,
+                              payload));
+  else
+    SVN_ERR(svn__compress_zlib(block->data->data, block->data->len,
+                               payload, SVN__COMPRESSION_ZLIB_DEFAULT));
+
+  *result = payload;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Write the compressed block number
+   INDEX in the write_batch_t * OUTPUT_BATON with the svn_stringbuf_t
+   * RESULT as payload. */
+static svn_error_t *
+write_block(void *result,
+            void *output_baton,
+            apr_int64_t index,
+            apr_pool_t *scratch_pool)
+{
+  write_batch_t *batch = output_baton;
+  struct block_baton *btn = batch->btn;
+  const block_t *block = &APR_ARRAY_IDX(batch->blocks, (int)index, block_t);
+  svn_stringbuf_t *payload = result;
+  unsigned char header[SVN__MAX_ENCODED_UINT_LEN];
+  apr_size_t len;
+
+  len = svn__encode_uint(header, ((apr_uint64_t)payload->len << 1)
+                                 | (block->record_start ? 1 : 0))
+      - header;
+  SVN_ERR(svn_stream_write(btn->substream, (const char *)header, &len));
+
+  len = payload->len;
+  return svn_error_trace(svn_stream_write(btn->substream, payload->data,
+                                          &len));
+}
+
+/* Write the stream header, unless that has already been done, followed
+   by the compressed blocks of BATCH.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+compress_batch(write_batch_t *batch,
+               apr_pool_t *scratch_pool)
+{
+  struct block_baton *btn = batch->btn;
+
+  if (!btn->header_done)
+    {
+      char header[BLOCK_HEADER_LEN] = BLOCK_MAGIC;
+      apr_size_t len = sizeof(header);
+
+      header[BLOCK_MAGIC_LEN] = BLOCK_FORMAT;
+      header[BLOCK_MAGIC_LEN + 1] = (char)btn->compression;
+      SVN_ERR(svn_stream_write(btn->substream, header, &len));
+      btn->header_done = TRUE;
+    }
+
+  if (batch->blocks->nelts)
+    SVN_ERR(svn_task__run(btn->jobs, batch->blocks->nelts, NULL, NULL,
+                          compress_block, batch, write_block, batch,
+                          NULL, NULL, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Handy macro to check APR function results and turning them into
+ * svn_error_t upon failure. */
+#define WRAP_APR_ERR(x,msg)                     \
+  {                                             \
+    apr_status_t status_ = (x);                 \
+    if (status_)                                \
+      return svn_error_wrap_apr(status_, msg);  \
+  }
+
+/* Thread function of the compressor.  DATA is the struct block_baton.
+   Compress and write all queued batches in order until the writer is
+   finished.  After an error, discard all further batches. */
+static void * APR_THREAD_FUNC
+compressor_thread(apr_thread_t *tid,
+                  void *data)
+{
+  struct block_baton *btn = data;
+
+  while (TRUE)
+    {
+      write_batch_t *batch;
+      svn_boolean_t skip;
+      svn_error_t *err = SVN_NO_ERROR;
+
+      apr_thread_mutex_lock(btn->mutex);
+      while (btn->taken == btn->queued && !btn->finished)
+        apr_thread_cond_wait(btn->cond, btn->mutex);
+
+      if (btn->taken == btn->queued)
+        {
+          apr_thread_mutex_unlock(btn->mutex);
+          break;
+        }
+
+      batch = btn->queue[btn->taken % COMPRESS_QUEUE_DEPTH];
+      skip = btn->aborted || btn->error;
+      apr_thread_mutex_unlock(btn->mutex);
+
+      if (!skip)
+        err = compress_batch(batch, batch->pool);
+      svn_pool_destroy(batch->pool);
+
+      apr_thread_mutex_lock(btn->mutex);
+      btn->taken++;
+      if (err)
+        btn->error = err;
+      apr_thread_cond_broadcast(btn->cond);
+      apr_thread_mutex_unlock(btn->mutex);
+    }
+
+  return NULL;
+}
+
+/* Tell the compressor thread in BTN, if any, that no more batches will
+   come and wait for it to finish.  Discard all queued batches if ABORT
+   is set. */
+static void
+stop_compressor(struct block_baton *btn,
+                svn_boolean_t abort)
+{
+  apr_status_t retval;
+
+  if (btn->thread == NULL)
+    return;
+
+  apr_thread_mutex_lock(btn->mutex);
+  btn->finished = TRUE;
+  btn->aborted |= abort;
+  apr_thread_cond_broadcast(btn->cond);
+  apr_thread_mutex_unlock(btn->mutex);
+
+  apr_thread_join(&retval, btn->thread);
+  btn->thread = NULL;
+}
+
+/* Pool pre-cleanup handler for block-compressing streams that never got
+   closed.  Stop the compressor thread of the struct block_baton DATA
+   before its thread pool, mutex and queued batches go away. */
+static apr_status_t
+abort_compressor(void *data)
+{
+  struct block_baton *btn = data;
+
+  stop_compressor(btn, TRUE);
+  svn_error_clear(btn->error);
+  btn->error = SVN_NO_ERROR;
+
+  return APR_SUCCESS;
+}
+
+/* Pool cleanup handler.  Release the batch pools of the struct
+   block_baton DATA. */
+static apr_status_t
+cleanup_batches(void *data)
+{
+  struct block_baton *btn = data;
+
+  svn_pool_destroy(btn->batches_pool);
+
+  return APR_SUCCESS;
+}
+
+/* Start the compressor thread for BTN. */
+static svn_error_t *
+start_compressor(struct block_baton *btn)
+{
+  WRAP_APR_ERR(apr_thread_mutex_create(&btn->mutex,
+                                       APR_THREAD_MUTEX_DEFAULT, btn->pool),
+               _("Can't create mutex"));
+  WRAP_APR_ERR(apr_thread_cond_create(&btn->cond, btn->pool),
+               _("Can't create condition variable"));
+  WRAP_APR_ERR(apr_thread_create(&btn->thread, NULL, compressor_thread,
+                                 btn, btn->pool),
+               _("Can't create thread"));
+  apr_pool_pre_cleanup_register(btn->pool, btn, abort_compressor);
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+/* Compress all blocks collected in BTN and write them to the substream.
+   With thread support, hand them over to the compressor thread instead
+   and only block while its queue is full. */
+static svn_error_t *
+write_batch(struct block_baton *btn)
+{
+  write_batch_t *batch = apr_pcalloc(btn->batch_pool, sizeof(*batch));
+
+  batch->btn = btn;
+  batch->blocks = btn->batch;
+  batch->pool = btn->batch_pool;
+
+#if APR_HAS_THREADS
+  {
+    svn_error_t *err;
+
+    if (btn->thread == NULL)
+      SVN_ERR(start_compressor(btn));
+
+    apr_thread_mutex_lock(btn->mutex);
+    while (   !btn->error
+           && btn->queued - btn->taken >= COMPRESS_QUEUE_DEPTH)
+      apr_thread_cond_wait(btn->cond, btn->mutex);
+
+    /* Keep the original error for close(). */
+    err = svn_error_dup(btn->error);
+    if (!err)
+      {
+        btn->queue[btn->queued % COMPRESS_QUEUE_DEPTH] = batch;
+        btn->queued++;
+        apr_thread_cond_broadcast(btn->cond);
+      }
+    apr_thread_mutex_unlock(btn->mutex);
+
+    /* The blocks belong to the compressor thread now. */
+    if (!err)
+      btn->batch_pool = svn_pool_create(btn->batches_pool);
+
+    reset_batch(btn);
+
+    return svn_error_trace(err);
+  }
+#else
+  SVN_ERR(compress_batch(batch, btn->batch_pool));
+  reset_batch(btn);
+
+  return SVN_NO_ERROR;
+#endif
+}
+
+/* Add the current block in BTN, if any, to the batch and write the batch
+   once it is full.  The next block will start at a record boundary if
+   RECORD_START is set. */
+static svn_error_t *
+complete_block(struct block_baton *btn,
+               svn_boolean_t record_start)
+{
+  if (btn->current)
+    {
+      block_t *block = apr_array_push(btn->batch);
+      block->data = btn->current;
+      block->record_start = btn->record_start;
+      btn->current = NULL;
+
+      if (btn->batch->nelts == btn->batch->nalloc)
+        SVN_ERR(write_batch(btn));
+    }
+
+  btn->record_start = record_start;
+
+  return SVN_NO_ERROR;
+}
+
+/* Collect data for compression */
+static svn_error_t *
+write_handler_block(void *baton, const char *buffer, apr_size_t *len)
+{
+  struct block_baton *btn = baton;
+  apr_size_t remaining = *len;
+
+  while (remaining)
+    {
+      apr_size_t chunk;
+
+      if (btn->current == NULL)
+        btn->current = svn_stringbuf_create_ensure(BLOCK_SIZE,
+                                                   btn->batch_pool);
+
+      chunk = MIN(remaining, BLOCK_SIZE - btn->current->len);
+      svn_stringbuf_appendbytes(btn->current, buffer, chunk);
+      buffer += chunk;
+      remaining -= chunk;
+
+      if (btn->current->len == BLOCK_SIZE)
+        SVN_ERR(complete_block(btn, FALSE));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Flush all data and write the end marker */
+static svn_error_t *
+close_handler_block_write(void *baton)
+{
+  struct block_baton *btn = baton;
+  unsigned char end_marker[SVN__MAX_ENCODED_UINT_LEN];
+  apr_size_t len;
+  svn_error_t *err;
+
+  err = complete_block(btn, FALSE);
+  if (!err && btn->batch->nelts)
+    err = write_batch(btn);
+
+#if APR_HAS_THREADS
+  if (btn->thread)
+    {
+      stop_compressor(btn, err != SVN_NO_ERROR);
+      apr_pool_cleanup_kill(btn->pool, btn, abort_compressor);
+    }
+
+  /* The compressor's error came first. */
+  if (btn->error)
+    {
+      svn_error_clear(err);
+      err = btn->error;
+      btn->error = SVN_NO_ERROR;
+    }
+#endif
+
+  /* Only now, we may use the substream again.  Make sure that even empty
+     streams get a header. */
+  if (!err && !btn->header_done)
+    {
+      write_batch_t batch = { 0 };
+
+      batch.btn = btn;
+      batch.blocks = btn->batch;
+      err = compress_batch(&batch, btn->batch_pool);
+    }
+
+  if (!err)
+    {
+      len = svn__encode_uint(end_marker, 0) - end_marker;
+      err = svn_stream_write(btn->substream, (const char *)end_marker,
+                             &len);
+    }
+
+  svn_pool_destroy(btn->batch_pool);
+#if APR_HAS_THREADS
+  apr_pool_cleanup_run(btn->pool, btn, cleanup_batches);
+#endif
+  SVN_ERR(err);
+
+  return svn_error_trace(svn_stream_close(btn->substream));
+}
+
+/* Return a new block stream baton for SUBSTREAM, allocated in POOL.
+   Create the batch pools in BATCHES_POOL. */
+static struct block_baton *
+create_block_baton(svn_stream_t *substream,
+                   int compression,
+                   int jobs,
+                   apr_pool_t *batches_pool,
+                   apr_pool_t *pool)
+{
+  struct block_baton *btn = apr_pcalloc(pool, sizeof(*btn));
+
+  btn->substream = substream;
+  btn->compression = compression;
+  btn->jobs = jobs;
+  btn->batch_pool = svn_pool_create(batches_pool);
+  btn->record_start = TRUE;
+  reset_batch(btn);
+
+  return btn;
+}
+
+svn_stream_t *
+svn_stream__block_compressed(svn_stream_t *stream,
+                             int compression,
+                             int jobs,
+                             apr_pool_t *result_pool)
+{
+  struct block_baton *baton;
+  svn_stream_t *block_stream;
+  apr_pool_t *batches_pool = result_pool;
+
+  assert(stream != NULL);
+  assert(   compression == SVN_STREAM__BLOCK_COMPRESSION_ZLIB
+         || compression == SVN_STREAM__BLOCK_COMPRESSION_LZ4);
+
+#if APR_HAS_THREADS
+  batches_pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+#endif
+
+  baton = create_block_baton(stream, compression, jobs, batches_pool,
+                             result_pool);
+
+#if APR_HAS_THREADS
+  baton->batches_pool = batches_pool;
+  baton->pool = result_pool;
+  apr_pool_cleanup_register(result_pool, baton, cleanup_batches,
+                            apr_pool_cleanup_null);
+#endif
+
+  block_stream = svn_stream_create(baton, result_pool);
+  svn_stream_set_write(block_stream, write_handler_block);
+  svn_stream_set_close(block_stream, close_handler_block_write);
+
+  return block_stream;
+}
+
+svn_error_t *
+svn_stream__block_boundary(svn_stream_t *stream)
+{
+  struct block_baton *btn = stream->baton;
+
+  if (stream->write_fn != write_handler_block)
+    return SVN_NO_ERROR;
+
+  if (btn->current == NULL)
+    btn->record_start = TRUE;
+  else if (btn->current->len >= BLOCK_MIN_SIZE)
+    SVN_ERR(complete_block(btn, TRUE));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.  Decompress block number INDEX in
+   the struct block_baton * PROCESS_BATON and return the data as
+   svn_stringbuf_t * in *RESULT. */
+static svn_error_t *
+decompress_block(void **result,
+                 void *thread_context,
+                 void *process_baton,
+                 apr_int64_t index,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  struct block_baton *btn = process_baton;
+  const block_t *block = &APR_ARRAY_IDX(btn->batch, (int)index, block_t);
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(result_pool);
+
+  if (btn->compression == SVN_STREAM__BLOCK_COMPRESSION_LZ4)
+    SVN_ERR(svn__decompress_lz4(block->data->data, block->data->len,
+                                data, BLOCK_SIZE));
+  else
+    SVN_ERR(svn__decompress_zlib(block->data->data, block->data->len,
+                                 data, BLOCK_SIZE));
+
+  *result = data;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Append the svn_stringbuf_t * RESULT
+   to the decompressed data in the struct block_baton * OUTPUT_BATON. */
+static svn_error_t *
+append_block(void *result,
+             void *output_baton,
+             apr_int64_t index,
+             apr_pool_t *scratch_pool)
+{
+  struct block_baton *btn = output_baton;
+  svn_stringbuf_t *data = result;
+
+  svn_stringbuf_appendbytes(btn->current, data->data, data->len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a "malformed data" error for the block-compressed stream. */
+static svn_error_t *
+malformed_block_stream(void)
+{
+  return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                          _("Malformed block-compressed stream"));
+}
+
+/* Read an svn__encode_uint() encoded value from STREAM into *VALUE. */
+static svn_error_t *
+read_uint(apr_uint64_t *value,
+          svn_stream_t *stream)
+{
+  unsigned char buffer[SVN__MAX_ENCODED_UINT_LEN];
+  apr_size_t i;
+
+  for (i = 0; i < sizeof(buffer); ++i)
+    {
+      apr_size_t len = 1;
+
+      SVN_ERR(svn_stream_read_full(stream, (char *)&buffer[i], &len));
+      if (len == 0)
+        return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
+                                _("Unexpected end of block-compressed "
+                                  "stream"));
+
+      if ((buffer[i] & 0x80) == 0)
+        {
+          svn__decode_uint(value, buffer, buffer + i + 1);
+          return SVN_NO_ERROR;
+        }
+    }
+
+  return svn_error_trace(malformed_block_stream());
+}
+
+/* Read the header of the substream in BTN and determine whether it is
+   block-compressed at all. */
+static svn_error_t *
+read_block_header(struct block_baton *btn)
+{
+  char header[BLOCK_HEADER_LEN];
+  apr_size_t len = sizeof(header);
+
+  SVN_ERR(svn_stream_read_full(btn->substream, header, &len));
+  btn->header_done = TRUE;
+
+  if (len < sizeof(header) || memcmp(header, BLOCK_MAGIC, BLOCK_MAGIC_LEN))
+    {
+      /* Not compressed.  Return what we read so far as is. */
+      btn->passthrough = TRUE;
+      btn->current = svn_stringbuf_ncreate(header, len, btn->batch_pool);
+      return SVN_NO_ERROR;
+    }
+
+  if (header[BLOCK_MAGIC_LEN] != BLOCK_FORMAT)
+    return svn_error_createf(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                             _("Unsupported block-compressed stream "
+                               "format %d"), header[BLOCK_MAGIC_LEN]);
+
+  btn->compression = header[BLOCK_MAGIC_LEN + 1];
+  if (   btn->compression != SVN_STREAM__BLOCK_COMPRESSION_ZLIB
+      && btn->compression != SVN_STREAM__BLOCK_COMPRESSION_LZ4)
+    return svn_error_createf(SVN_ERR_BAD_COMPRESSION_METHOD, NULL,
+                             _("Unsupported block compression method %d"),
+                             btn->compression);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the next batch of blocks in BTN from the substream and decompress
+   them into BTN->CURRENT. */
+static svn_error_t *
+read_batch(struct block_baton *btn)
+{
+  reset_batch(btn);
+
+  while (!btn->eof && btn->batch->nelts < btn->batch->nalloc)
+    {
+      apr_uint64_t header;
+      apr_size_t len;
+      block_t *block;
+
+      SVN_ERR(read_uint(&header, btn->substream));
+      if (header == 0)
+        {
+          btn->eof = TRUE;
+          break;
+        }
+
+      if ((header >> 1) == 0 || (header >> 1) > BLOCK_MAX_PAYLOAD)
+        return svn_error_trace(malformed_block_stream());
+
+      len = (apr_size_t)(header >> 1);
+      block = apr_array_push(btn->batch);
+      block->record_start = (header & 1) != 0;
+      block->data = svn_stringbuf_create_ensure(len, btn->batch_pool);
+      SVN_ERR(svn_stream_read_full(btn->substream, block->data->data,
+                                   &len));
+      if (len != (apr_size_t)(header >> 1))
+        return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
+                                _("Unexpected end of block-compressed "
+                                  "stream"));
+
+      block->data->len = len;
+      block->data->data[len] = '\0';
+    }
+
+  btn->current = svn_stringbuf_create_ensure(btn->batch->nelts * BLOCK_SIZE,
+                                             btn->batch_pool);
+  btn->read_pos = 0;
+  if (btn->batch->nelts)
+    SVN_ERR(svn_task__run(btn->jobs, btn->batch->nelts, NULL, NULL,
+                          decompress_block, btn, append_block, btn,
+                          NULL, NULL, btn->batch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return decompressed data */
+static svn_error_t *
+read_handler_block(void *baton, char *buffer, apr_size_t *len)
+{
+  struct block_baton *btn = baton;
+  apr_size_t done = 0;
+
+  if (!btn->header_done)
+    SVN_ERR(read_block_header(btn));
+
+  while (done < *len)
+    {
+      if (btn->current && btn->read_pos < btn->current->len)
+        {
+          apr_size_t chunk = MIN(*len - done,
+                                 btn->current->len - btn->read_pos);
+
+          memcpy(buffer + done, btn->current->data + btn->read_pos, chunk);
+          btn->read_pos += chunk;
+          done += chunk;
+        }
+      else if (btn->passthrough)
+        {
+          apr_size_t chunk = *len - done;
+
+          SVN_ERR(svn_stream_read_full(btn->substream, buffer + done,
+                                       &chunk));
+          done += chunk;
+          break;
+        }
+      else if (btn->eof)
+        {
+          break;
+        }
+      else
+        {
+          SVN_ERR(read_batch(btn));
+        }
+    }
+
+  *len = done;
+
+  return SVN_NO_ERROR;
+}
+
+/* Release all buffers and close the substream */
+static svn_error_t *
+close_handler_block_read(void *baton)
+{
+  struct block_baton *btn = baton;
+
+  svn_pool_destroy(btn->batch_pool);
+
+  return svn_error_trace(svn_stream_close(btn->substream));
+}
+
+svn_stream_t *
+svn_stream__block_decompressed(svn_stream_t *stream,
+                               int jobs,
+                               apr_pool_t *result_pool)
+{
+  struct block_baton *baton;
+  svn_stream_t *block_stream;
+
+  assert(stream != NULL);
+
+  baton = create_block_baton(stream, 0, jobs, result_pool, result_pool);
+  block_stream = svn_stream_create(baton, result_pool);
+  svn_stream_set_read2(block_stream, NULL /* only full read support */,
+                       read_handler_block);
+  svn_stream_set_close(block_stream, close_handler_block_read);
+
+  return block_stream;
+}
+
+svn_error_t *
+svn_stream__is_block_compressed(svn_boolean_t *compressed,
+                                svn_stream_t *stream,
+                                apr_pool_t *scratch_pool)
+{
+  char header[BLOCK_MAGIC_LEN];
+  apr_size_t len = sizeof(header);
+  svn_stream_mark_t *mark;
+
+  SVN_ERR(svn_stream_mark(stream, &mark, scratch_pool));
+  SVN_ERR(svn_stream_read_full(stream, header, &len));
+  SVN_ERR(svn_stream_seek(stream, mark));
+
+  *compressed = len == sizeof(header)
+             && memcmp(header, BLOCK_MAGIC, BLOCK_MAGIC_LEN) == 0;
+
+  return SVN_NO_ERROR;
+}
+
 
 /* Checksummed stream support */
 
@@ -0,0 +1,431 @@
+/* task.c : concurrent processing with ordered output
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_thread_proc.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+
+#include "svn_error.h"
+#include "svn_pools.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_task.h"
+
+#include "svn_private_config.h"
+
+
+
+/* Number of result slots per worker thread.  This limits how far the
+ * workers may run ahead of the output function. */
+#define SLOTS_PER_THREAD 2
+
+/* While waiting for results, the calling thread checks for cancellation
+ * at least this often (in microseconds). */
+#define CANCEL_POLL_INTERVAL 100000
+
+/* Run all items sequentially in the current thread.  The parameters are
+ * the same as for svn_task__run(). */
+static svn_error_t *
+run_sequentially(apr_int64_t count,
+                 svn_task__thread_context_constructor_t context_constructor,
+                 void *context_baton,
+                 svn_task__process_func_t process_func,
+                 void *process_baton,
+                 svn_task__output_func_t output_func,
+                 void *output_baton,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  apr_int64_t i;
+  void *thread_context = NULL;
+  apr_pool_t *result_pool = svn_pool_create(scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  if (context_constructor)
+    SVN_ERR(context_constructor(&thread_context, context_baton,
+                                scratch_pool, iterpool));
+
+  for (i = 0; i < count; ++i)
+    {
+      void *result;
+
+      svn_pool_clear(result_pool);
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(process_func(&result, thread_context, process_baton, i,
+                           cancel_func, cancel_baton,
+                           result_pool, iterpool));
+      if (output_func)
+        SVN_ERR(output_func(result, output_baton, i, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(result_pool);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Handy macro to check APR function results and turning them into
+ * svn_error_t upon failure. */
+#define WRAP_APR_ERR(x,msg)                     \
+  {                                             \
+    apr_status_t status_ = (x);                 \
+    if (status_)                                \
+      return svn_error_wrap_apr(status_, msg);  \
+  }
+
+/* Result of a single work item as handed from the worker threads to the
+ * output function. */
+typedef struct slot_t
+{
+  /* Result as returned by the process function. */
+  void *result;
+
+  /* Root pool that RESULT got allocated in.  NULL if the slot is empty. */
+  apr_pool_t *pool;
+
+  /* Set, once the work item has been processed. */
+  svn_boolean_t done;
+} slot_t;
+
+/* Shared state between the calling thread and the worker threads.
+ * All modifiable members are protected by MUTEX. */
+typedef struct task_queue_t
+{
+  /* Number of work items in total. */
+  apr_int64_t count;
+
+  /* Next item to hand out to a worker. */
+  apr_int64_t next_to_process;
+
+  /* Next item to pass to the output function. */
+  apr_int64_t next_to_output;
+
+  /* Ring buffer of SLOT_COUNT result slots.  Item I uses slot
+   * I % SLOT_COUNT. */
+  slot_t *slots;
+  int slot_count;
+
+  /* Set when the operation shall be aborted. */
+  svn_boolean_t aborted;
+
+  /* Copy of ABORTED that the workers may read without holding MUTEX. */
+  volatile svn_atomic_t abort_flag;
+
+  /* First error reported by any of the worker threads. */
+  svn_error_t *error;
+
+  /* Synchronization objects.  COND gets signaled whenever any of the
+   * shared state changes. */
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *cond;
+
+  /* Callbacks and their batons, same as for svn_task__run(). */
+  svn_task__thread_context_constructor_t context_constructor;
+  void *context_baton;
+  svn_task__process_func_t process_func;
+  void *process_baton;
+} task_queue_t;
+
+/* Record ERR in QUEUE and make everybody stop.  QUEUE->MUTEX must be
+ * held by the caller. */
+static void
+abort_queue(task_queue_t *queue,
+            svn_error_t *err)
+{
+  if (queue->error)
+    svn_error_clear(err);
+  else
+    queue->error = err;
+
+  queue->aborted = TRUE;
+  svn_atomic_set(&queue->abort_flag, TRUE);
+  apr_thread_cond_broadcast(queue->cond);
+}
+
+/* Implements svn_cancel_func_t for the worker threads.  BATON is the
+ * task_queue_t.  Unlike the caller's cancellation function, this one may
+ * safely be called from any thread. */
+static svn_error_t *
+worker_cancel_func(void *baton)
+{
+  task_queue_t *queue = baton;
+
+  if (svn_atomic_read(&queue->abort_flag))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Worker thread function.  DATA is the task_queue_t. */
+static void * APR_THREAD_FUNC
+worker(apr_thread_t *tid,
+       void *data)
+{
+  task_queue_t *queue = data;
+  void *thread_context = NULL;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  /* Memory used by this thread.  Must not be shared with other threads.
+   * Using a private allocator prevents contention with other threads. */
+  apr_pool_t *thread_pool
+    = apr_allocator_get_owner(svn_pool_create_allocator(FALSE));
+  apr_pool_t *iterpool = svn_pool_create(thread_pool);
+
+  if (queue->context_constructor)
+    err = queue->context_constructor(&thread_context, queue->context_baton,
+                                     thread_pool, iterpool);
+
+  apr_thread_mutex_lock(queue->mutex);
+  if (err)
+    abort_queue(queue, err);
+
+  while (!queue->aborted)
+    {
+      apr_int64_t index;
+      apr_pool_t *result_pool;
+      void *result = NULL;
+      slot_t *slot;
+
+      /* Wait until there is work to do and room to put the result. */
+      while (   !queue->aborted
+             && queue->next_to_process < queue->count
+             && queue->next_to_process
+                  >= queue->next_to_output + queue->slot_count)
+        apr_thread_cond_wait(queue->cond, queue->mutex);
+
+      if (queue->aborted || queue->next_to_process >= queue->count)
+        break;
+
+      index = queue->next_to_process++;
+      apr_thread_mutex_unlock(queue->mutex);
+
+      /* The result will be released by the calling thread, hence it
+       * must not share THREAD_POOL's allocator. */
+      svn_pool_clear(iterpool);
+      result_pool = apr_allocator_get_owner(svn_pool_create_allocator(FALSE));
+      err = queue->process_func(&result, thread_context,
+                                queue->process_baton, index,
+                                worker_cancel_func, queue,
+                                result_pool, iterpool);
+
+      apr_thread_mutex_lock(queue->mutex);
+      if (err)
+        {
+          svn_pool_destroy(result_pool);
+          abort_queue(queue, err);
+          break;
+        }
+
+      slot = &queue->slots[index % queue->slot_count];
+      slot->result = result;
+      slot->pool = result_pool;
+      slot->done = TRUE;
+      apr_thread_cond_broadcast(queue->cond);
+    }
+
+  apr_thread_mutex_unlock(queue->mutex);
+  svn_pool_destroy(thread_pool);
+
+  return NULL;
+}
+
+/* Core implementation of svn_task__run() for the multi-threaded case.
+ * The parameters are the same. */
+static svn_error_t *
+run_concurrently(int concurrency,
+                 apr_int64_t count,
+                 svn_task__thread_context_constructor_t context_constructor,
+                 void *context_baton,
+                 svn_task__process_func_t process_func,
+                 void *process_baton,
+                 svn_task__output_func_t output_func,
+                 void *output_baton,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  task_queue_t *queue = apr_pcalloc(scratch_pool, sizeof(*queue));
+  apr_thread_t **threads;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_error_t *err = SVN_NO_ERROR;
+  int started;
+  int i;
+
+  queue->count = count;
+  queue->slot_count = concurrency * SLOTS_PER_THREAD;
+  queue->slots = apr_pcalloc(scratch_pool,
+                             queue->slot_count * sizeof(*queue->slots));
+  queue->context_constructor = context_constructor;
+  queue->context_baton = context_baton;
+  queue->process_func = process_func;
+  queue->process_baton = process_baton;
+
+  WRAP_APR_ERR(apr_thread_mutex_create(&queue->mutex,
+                                       APR_THREAD_MUTEX_DEFAULT,
+                                       scratch_pool),
+               _("Can't create task queue mutex"));
+  WRAP_APR_ERR(apr_thread_cond_create(&queue->cond, scratch_pool),
+               _("Can't create condition variable"));
+
+  /* Start the workers. */
+  threads = apr_pcalloc(scratch_pool, concurrency * sizeof(*threads));
+  for (started = 0; started < concurrency; ++started)
+    {
+      apr_status_t status = apr_thread_create(&threads[started], NULL,
+                                              worker, queue, scratch_pool);
+      if (status)
+        {
+          err = svn_error_wrap_apr(status, _("Can't create thread"));
+          break;
+        }
+    }
+
+  /* Hand the results to OUTPUT_FUNC in item order. */
+  apr_thread_mutex_lock(queue->mutex);
+  if (err || started == 0)
+    {
+      abort_queue(queue, err);
+      err = SVN_NO_ERROR;
+    }
+
+  while (!queue->aborted && queue->next_to_output < count)
+    {
+      apr_int64_t index = queue->next_to_output;
+      slot_t *slot = &queue->slots[index % queue->slot_count];
+      slot_t item;
+
+      if (!slot->done)
+        {
+          /* Don't wait for slow items without checking for cancellation.
+           * CANCEL_FUNC must only be called from this thread. */
+          if (cancel_func)
+            {
+              apr_thread_cond_timedwait(queue->cond, queue->mutex,
+                                        CANCEL_POLL_INTERVAL);
+              apr_thread_mutex_unlock(queue->mutex);
+              err = cancel_func(cancel_baton);
+              apr_thread_mutex_lock(queue->mutex);
+              if (err)
+                {
+                  abort_queue(queue, err);
+                  err = SVN_NO_ERROR;
+                }
+            }
+          else
+            {
+              apr_thread_cond_wait(queue->cond, queue->mutex);
+            }
+
+          continue;
+        }
+
+      /* Take ownership of the result and free the slot. */
+      item = *slot;
+      memset(slot, 0, sizeof(*slot));
+      queue->next_to_output++;
+      apr_thread_cond_broadcast(queue->cond);
+      apr_thread_mutex_unlock(queue->mutex);
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        err = cancel_func(cancel_baton);
+      if (!err && output_func)
+        err = output_func(item.result, output_baton, index, iterpool);
+      svn_pool_destroy(item.pool);
+
+      apr_thread_mutex_lock(queue->mutex);
+      if (err)
+        {
+          abort_queue(queue, err);
+          err = SVN_NO_ERROR;
+        }
+    }
+
+  /* Make sure the workers don't pick up further items. */
+  queue->aborted = TRUE;
+  svn_atomic_set(&queue->abort_flag, TRUE);
+  apr_thread_cond_broadcast(queue->cond);
+  apr_thread_mutex_unlock(queue->mutex);
+
+  for (i = 0; i < started; ++i)
+    {
+      apr_status_t retval;
+      apr_thread_join(&retval, threads[i]);
+    }
+
+  /* Release results that were never handed to OUTPUT_FUNC. */
+  for (i = 0; i < queue->slot_count; ++i)
+    if (queue->slots[i].pool)
+      svn_pool_destroy(queue->slots[i].pool);
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_error_compose_create(err, queue->error));
+}
+
+#endif
+
+svn_error_t *
+svn_task__run(int concurrency,
+              apr_int64_t count,
+              svn_task__thread_context_constructor_t context_constructor,
+              void *context_baton,
+              svn_task__process_func_t process_func,
+              void *process_baton,
+              svn_task__output_func_t output_func,
+              void *output_baton,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *scratch_pool)
+{
+  /* There is no point in having more threads than work items. */
+  if (concurrency > count)
+    concurrency = (int)count;
+
+#if APR_HAS_THREADS
+  if (concurrency > 1)
+    return svn_error_trace(run_concurrently(concurrency, count,
+                                            context_constructor,
+                                            context_baton,
+                                            process_func, process_baton,
+                                            output_func, output_baton,
+                                            cancel_func, cancel_baton,
+                                            scratch_pool));
+#endif
+
+  return svn_error_trace(run_sequentially(count,
+                                          context_constructor,
+                                          context_baton,
+                                          process_func, process_baton,
+                                          output_func, output_baton,
+                                          cancel_func, cancel_baton,
+                                          scratch_pool));
+}
@@ -880,6 +880,9 @@ INSERT INTO work_queue (work) VALUES (?1)
 -- STMT_SELECT_WORK_ITEM
 SELECT id, work FROM work_queue ORDER BY id LIMIT 1
 
+-- STMT_SELECT_WORK_ITEMS_AFTER
+SELECT id, work FROM work_queue WHERE id > ?1 ORDER BY id LIMIT ?2
+
 -- STMT_DELETE_WORK_ITEM
 DELETE FROM work_queue WHERE id = ?1
 
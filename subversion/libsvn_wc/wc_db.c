@@ -13597,6 +13597,52 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
 }
 
 
+svn_error_t *
+svn_wc__db_wq_fetch_following(apr_array_header_t **ids,
+                              apr_array_header_t **work_items,
+                              svn_wc__db_t *db,
+                              const char *wri_abspath,
+                              apr_uint64_t after_id,
+                              int max_items,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  *ids = apr_array_make(result_pool, max_items, sizeof(apr_uint64_t));
+  *work_items = apr_array_make(result_pool, max_items, sizeof(svn_skel_t *));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_WORK_ITEMS_AFTER));
+  SVN_ERR(svn_sqlite__bindf(stmt, "id", after_id, max_items));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row)
+    {
+      apr_size_t len;
+      const void *val;
+
+      APR_ARRAY_PUSH(*ids, apr_uint64_t) = svn_sqlite__column_int64(stmt, 0);
+
+      val = svn_sqlite__column_blob(stmt, 1, &len, result_pool);
+      APR_ARRAY_PUSH(*work_items, svn_skel_t *)
+        = svn_skel__parse(val, len, result_pool);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
 
 /* ### temporary API. remove before release.  */
 svn_error_t *
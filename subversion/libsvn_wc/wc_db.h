@@ -3028,6 +3028,23 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
                                     apr_pool_t *result_pool,
                                     apr_pool_t *scratch_pool);
 
+/* Look ahead in the work queue for WRI_ABSPATH: return up to MAX_ITEMS
+   work items that follow the item with id AFTER_ID, in queue order.
+   Their ids are returned in *IDS as apr_uint64_t and the items in
+   *WORK_ITEMS as svn_skel_t *, both allocated in RESULT_POOL.
+
+   Nothing gets marked as completed; the items must still be processed
+   through svn_wc__db_wq_fetch_next() and friends.  */
+svn_error_t *
+svn_wc__db_wq_fetch_following(apr_array_header_t **ids,
+                              apr_array_header_t **work_items,
+                              svn_wc__db_t *db,
+                              const char *wri_abspath,
+                              apr_uint64_t after_id,
+                              int max_items,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
+
 
 /* @} */
 
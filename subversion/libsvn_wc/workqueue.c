@@ -30,6 +30,7 @@
 #include "svn_subst.h"
 #include "svn_hash.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -40,6 +41,7 @@
 
 #include "private/svn_io_private.h"
 #include "private/svn_skel.h"
+#include "private/svn_task.h"
 
 
 /* Workqueue operation names.  */
@@ -445,60 +447,77 @@ svn_wc__wq_build_postupgrade(svn_skel_t **work_item,
 
 /* OP_FILE_INSTALL */
 
-/* Process the OP_FILE_INSTALL work item WORK_ITEM.
- * See svn_wc__wq_build_file_install() which generates this work item.
- * Implements (struct work_item_dispatch).func. */
-static svn_error_t *
-run_file_install(work_item_baton_t *wqb,
-                 svn_wc__db_t *db,
-                 const svn_skel_t *work_item,
-                 const char *wri_abspath,
-                 svn_cancel_func_t cancel_func,
-                 void *cancel_baton,
-                 apr_pool_t *scratch_pool)
+/* Everything needed to install the file described by an OP_FILE_INSTALL
+ * work item, as far as it requires access to the wc.db.  Once this has
+ * been filled in, the (potentially expensive) translation into a
+ * temporary file does not need the db and may happen in any thread. */
+typedef struct file_install_t
 {
-  const svn_skel_t *arg1 = work_item->children->next;
-  const svn_skel_t *arg4 = arg1->next->next->next;
-  const char *local_relpath;
+  /* The file to install and where to read its "normal form" from. */
   const char *local_abspath;
+  const char *source_abspath;
+
+  /* Where to put the temporary, translated file. */
+  const char *temp_dir_abspath;
+
+  /* Flags stored in the work item. */
   svn_boolean_t use_commit_times;
   svn_boolean_t record_fileinfo;
+
+  /* Translation bits.  KEYWORDS is NULL, if no keywords need expanding. */
   svn_boolean_t special;
-  svn_stream_t *src_stream;
-  svn_subst_eol_style_t style;
+  svn_boolean_t translate;
   const char *eol;
   apr_hash_t *keywords;
-  const char *temp_dir_abspath;
-  svn_stream_t *dst_stream;
+
+  /* Pristine properties and last-changed date of the node. */
+  apr_hash_t *props;
+  apr_time_t changed_date;
+} file_install_t;
+
+/* Read everything from DB that is needed to process the OP_FILE_INSTALL
+ * work item WORK_ITEM and return it in *INSTALL, allocated in RESULT_POOL.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+prepare_file_install(file_install_t **install,
+                     svn_wc__db_t *db,
+                     const svn_skel_t *work_item,
+                     const char *wri_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  const svn_skel_t *arg1 = work_item->children->next;
+  const svn_skel_t *arg4 = arg1->next->next->next;
+  file_install_t *fi = apr_pcalloc(result_pool, sizeof(*fi));
+  const char *local_relpath;
+  svn_subst_eol_style_t style;
   apr_int64_t val;
   const char *wcroot_abspath;
-  const char *source_abspath;
   const svn_checksum_t *checksum;
-  apr_hash_t *props;
-  apr_time_t changed_date;
 
   local_relpath = apr_pstrmemdup(scratch_pool, arg1->data, arg1->len);
-  SVN_ERR(svn_wc__db_from_relpath(&local_abspath, db, wri_abspath,
-                                  local_relpath, scratch_pool, scratch_pool));
+  SVN_ERR(svn_wc__db_from_relpath(&fi->local_abspath, db, wri_abspath,
+                                  local_relpath, result_pool, scratch_pool));
 
   SVN_ERR(svn_skel__parse_int(&val, arg1->next, scratch_pool));
-  use_commit_times = (val != 0);
+  fi->use_commit_times = (val != 0);
   SVN_ERR(svn_skel__parse_int(&val, arg1->next->next, scratch_pool));
-  record_fileinfo = (val != 0);
+  fi->record_fileinfo = (val != 0);
 
   SVN_ERR(svn_wc__db_read_node_install_info(&wcroot_abspath,
-                                            &checksum, &props,
-                                            &changed_date,
-                                            db, local_abspath, wri_abspath,
-                                            scratch_pool, scratch_pool));
+                                            &checksum, &fi->props,
+                                            &fi->changed_date,
+                                            db, fi->local_abspath,
+                                            wri_abspath,
+                                            result_pool, scratch_pool));
 
   if (arg4 != NULL)
     {
       /* Use the provided path for the source.  */
       local_relpath = apr_pstrmemdup(scratch_pool, arg4->data, arg4->len);
-      SVN_ERR(svn_wc__db_from_relpath(&source_abspath, db, wri_abspath,
+      SVN_ERR(svn_wc__db_from_relpath(&fi->source_abspath, db, wri_abspath,
                                       local_relpath,
-                                      scratch_pool, scratch_pool));
+                                      result_pool, scratch_pool));
     }
   else if (! checksum)
     {
@@ -513,28 +532,101 @@ run_file_install(work_item_baton_t *wqb,
                                _("Can't install '%s' from pristine store, "
                                  "because no checksum is recorded for this "
                                  "file"),
-                               svn_dirent_local_style(local_abspath,
+                               svn_dirent_local_style(fi->local_abspath,
                                                       scratch_pool));
     }
   else
     {
-      SVN_ERR(svn_wc__db_pristine_get_future_path(&source_abspath,
+      SVN_ERR(svn_wc__db_pristine_get_future_path(&fi->source_abspath,
                                                   wcroot_abspath,
                                                   checksum,
-                                                  scratch_pool, scratch_pool));
+                                                  result_pool, scratch_pool));
     }
 
-  SVN_ERR(svn_stream_open_readonly(&src_stream, source_abspath,
+  /* Fetch all the translation bits.  */
+  SVN_ERR(svn_wc__get_translate_info(&style, &fi->eol,
+                                     &fi->keywords,
+                                     &fi->special, db, fi->local_abspath,
+                                     fi->props, FALSE,
+                                     result_pool, scratch_pool));
+  fi->translate = svn_subst_translation_required(style, fi->eol,
+                                                 fi->keywords,
+                                                 FALSE /* special */,
+                                                 TRUE /* force_eol_check */);
+
+  /* Where is the Right Place to put a temp file in this working copy?  */
+  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&fi->temp_dir_abspath,
+                                         db, wcroot_abspath,
+                                         result_pool, scratch_pool));
+
+  *install = fi;
+  return SVN_NO_ERROR;
+}
+
+/* Translate the source of the non-special file described by INSTALL into
+ * a temporary file and return the not yet installed result in *DST_STREAM,
+ * allocated in RESULT_POOL.  This does not access the wc.db and may be
+ * called from any thread.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+translate_file_install(svn_stream_t **dst_stream,
+                       const file_install_t *install,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  svn_stream_t *src_stream;
+
+  SVN_ERR(svn_stream_open_readonly(&src_stream, install->source_abspath,
                                    scratch_pool, scratch_pool));
 
-  /* Fetch all the translation bits.  */
-  SVN_ERR(svn_wc__get_translate_info(&style, &eol,
-                                     &keywords,
-                                     &special, db, local_abspath,
-                                     props, FALSE,
-                                     scratch_pool, scratch_pool));
-  if (special)
+  if (install->translate)
     {
+      /* Wrap it in a translating (expanding) stream.  */
+      src_stream = svn_subst_stream_translated(src_stream, install->eol,
+                                               TRUE /* repair */,
+                                               install->keywords,
+                                               TRUE /* expand */,
+                                               scratch_pool);
+    }
+
+  /* Translate to a temporary file. We don't want the user seeing a partial
+     file, nor let them muck with it while we translate. We may also need to
+     get its TRANSLATED_SIZE before the user can monkey it.  */
+  SVN_ERR(svn_stream__create_for_install(dst_stream,
+                                         install->temp_dir_abspath,
+                                         result_pool, scratch_pool));
+
+  /* Copy from the source to the dest, translating as we go. This will also
+     close both streams.  */
+  return svn_error_trace(svn_stream_copy3(src_stream, *dst_stream,
+                                          cancel_func, cancel_baton,
+                                          scratch_pool));
+}
+
+/* Move the translated DST_STREAM for the file described by INSTALL into
+ * place and apply the file flags, timestamps and fileinfo recording.
+ * Special files get created here and DST_STREAM is being ignored.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+finish_file_install(work_item_baton_t *wqb,
+                    svn_wc__db_t *db,
+                    const file_install_t *install,
+                    svn_stream_t *dst_stream,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *scratch_pool)
+{
+  const char *local_abspath = install->local_abspath;
+  apr_hash_t *props = install->props;
+
+  if (install->special)
+    {
+      svn_stream_t *src_stream;
+
+      SVN_ERR(svn_stream_open_readonly(&src_stream, install->source_abspath,
+                                       scratch_pool, scratch_pool));
+
       /* When this stream is closed, the resulting special file will
          atomically be created/moved into place at LOCAL_ABSPATH.  */
       SVN_ERR(svn_subst_create_specialfile(&dst_stream, local_abspath,
@@ -552,35 +644,6 @@ run_file_install(work_item_baton_t *wqb,
       return SVN_NO_ERROR;
     }
 
-  if (svn_subst_translation_required(style, eol, keywords,
-                                     FALSE /* special */,
-                                     TRUE /* force_eol_check */))
-    {
-      /* Wrap it in a translating (expanding) stream.  */
-      src_stream = svn_subst_stream_translated(src_stream, eol,
-                                               TRUE /* repair */,
-                                               keywords,
-                                               TRUE /* expand */,
-                                               scratch_pool);
-    }
-
-  /* Where is the Right Place to put a temp file in this working copy?  */
-  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&temp_dir_abspath,
-                                         db, wcroot_abspath,
-                                         scratch_pool, scratch_pool));
-
-  /* Translate to a temporary file. We don't want the user seeing a partial
-     file, nor let them muck with it while we translate. We may also need to
-     get its TRANSLATED_SIZE before the user can monkey it.  */
-  SVN_ERR(svn_stream__create_for_install(&dst_stream, temp_dir_abspath,
-                                         scratch_pool, scratch_pool));
-
-  /* Copy from the source to the dest, translating as we go. This will also
-     close both streams.  */
-  SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
-                           cancel_func, cancel_baton,
-                           scratch_pool));
-
   /* All done. Move the file into place.  */
   /* With a single db we might want to install files in a missing directory.
      Simply trying this scenario on error won't do any harm and at least
@@ -612,16 +675,16 @@ run_file_install(work_item_baton_t *wqb,
         SVN_ERR(svn_io_set_file_read_only(local_abspath, FALSE, scratch_pool));
     }
 
-  if (use_commit_times)
+  if (install->use_commit_times)
     {
-      if (changed_date)
-        SVN_ERR(svn_io_set_file_affected_time(changed_date,
+      if (install->changed_date)
+        SVN_ERR(svn_io_set_file_affected_time(install->changed_date,
                                               local_abspath,
                                               scratch_pool));
     }
 
   /* ### this should happen before we rename the file into place.  */
-  if (record_fileinfo)
+  if (install->record_fileinfo)
     {
       SVN_ERR(get_and_record_fileinfo(wqb, local_abspath,
                                       FALSE /* ignore_enoent */,
@@ -631,6 +694,33 @@ run_file_install(work_item_baton_t *wqb,
   return SVN_NO_ERROR;
 }
 
+/* Process the OP_FILE_INSTALL work item WORK_ITEM.
+ * See svn_wc__wq_build_file_install() which generates this work item.
+ * Implements (struct work_item_dispatch).func. */
+static svn_error_t *
+run_file_install(work_item_baton_t *wqb,
+                 svn_wc__db_t *db,
+                 const svn_skel_t *work_item,
+                 const char *wri_abspath,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  file_install_t *install;
+  svn_stream_t *dst_stream = NULL;
+
+  SVN_ERR(prepare_file_install(&install, db, work_item, wri_abspath,
+                               scratch_pool, scratch_pool));
+  if (! install->special)
+    SVN_ERR(translate_file_install(&dst_stream, install,
+                                   cancel_func, cancel_baton,
+                                   scratch_pool, scratch_pool));
+
+  return svn_error_trace(finish_file_install(wqb, db, install, dst_stream,
+                                             cancel_func, cancel_baton,
+                                             scratch_pool));
+}
+
 
 svn_error_t *
 svn_wc__wq_build_file_install(svn_skel_t **work_item,
@@ -1474,6 +1564,273 @@ dispatch_work_item(work_item_baton_t *wqb,
 }
 
 
+/* Mark the work item COMPLETED_ID (if not 0) as completed, together with
+   recording the fileinfo collected in WIB, and fetch the next work item
+   into *ID and *WORK_ITEM, allocated in RESULT_POOL. */
+static svn_error_t *
+fetch_next_work_item(apr_uint64_t *id,
+                     svn_skel_t **work_item,
+                     work_item_baton_t *wib,
+                     svn_wc__db_t *db,
+                     const char *wri_abspath,
+                     apr_uint64_t completed_id,
+                     apr_pool_t *result_pool)
+{
+  if (! wib->used)
+    {
+      SVN_ERR(svn_wc__db_wq_fetch_next(id, work_item, db, wri_abspath,
+                                       completed_id,
+                                       result_pool, result_pool));
+    }
+  else
+    {
+      SVN_ERR(svn_wc__db_wq_record_and_fetch_next(id, work_item,
+                                                  db, wri_abspath,
+                                                  completed_id,
+                                                  wib->record_map,
+                                                  result_pool,
+                                                  wib->result_pool));
+
+      svn_pool_clear(wib->result_pool);
+      wib->record_map = NULL;
+      wib->used = FALSE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Wrap ERR, returned for the work item ID / WORK_ITEM, in an error that
+   tells the user which work queue entry failed. */
+static svn_error_t *
+wrap_work_item_error(svn_error_t *err,
+                     const char *wri_abspath,
+                     apr_uint64_t id,
+                     const svn_skel_t *work_item,
+                     apr_pool_t *scratch_pool)
+{
+  const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
+
+  return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
+                           _("Failed to run the WC DB work queue "
+                             "associated with '%s', work item %d %s"),
+                           svn_dirent_local_style(wri_abspath,
+                                                  scratch_pool),
+                           (int)id, skel);
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* Batched OP_FILE_INSTALL processing.
+
+   An update or checkout queues one OP_FILE_INSTALL item per added file
+   and runs the queue once per directory.  Translating the pristines into
+   the working files is pure file I/O, so we collect runs of consecutive
+   install items and translate them into temporary files concurrently.
+   Everything that touches the wc.db - reading the install info, moving
+   the files into place, recording their fileinfo and completing the
+   work items - still happens in the calling thread and in queue order.
+   A work item is only marked as completed after its file got installed,
+   so the queue remains restartable at any point. */
+
+/* Number of threads translating files and the maximum number of install
+   items that we look ahead in the queue. */
+#if APR_HAS_THREADS
+#define INSTALL_CONCURRENCY 4
+#else
+#define INSTALL_CONCURRENCY 1
+#endif
+#define INSTALL_BATCH_SIZE 256
+
+/* Baton for the svn_task__run() callbacks of run_install_batch(). */
+typedef struct install_batch_t
+{
+  work_item_baton_t *wib;
+  svn_wc__db_t *db;
+  const char *wri_abspath;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* The work items in this batch (apr_uint64_t and svn_skel_t *). */
+  apr_array_header_t *ids;
+  apr_array_header_t *work_items;
+
+  /* Prepared install info for each element of WORK_ITEMS. */
+  file_install_t **installs;
+} install_batch_t;
+
+/* Implements svn_task__process_func_t.  Translate the file of the
+   INDEX-th item of the install_batch_t in PROCESS_BATON and return the
+   uninstalled temporary file stream in *RESULT.
+
+   This may run in a worker thread, so use the CANCEL_FUNC provided by
+   svn_task__run() rather than the caller's one. */
+static svn_error_t *
+translate_batch_item(void **result,
+                     void *thread_context,
+                     void *process_baton,
+                     apr_int64_t index,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  install_batch_t *batch = process_baton;
+  const file_install_t *install = batch->installs[index];
+  svn_stream_t *dst_stream = NULL;
+
+  if (! install->special)
+    {
+      svn_error_t *err = translate_file_install(&dst_stream, install,
+                                                cancel_func, cancel_baton,
+                                                result_pool, scratch_pool);
+      if (err)
+        return wrap_work_item_error(err, batch->wri_abspath,
+                                    APR_ARRAY_IDX(batch->ids, index,
+                                                  apr_uint64_t),
+                                    APR_ARRAY_IDX(batch->work_items, index,
+                                                  svn_skel_t *),
+                                    scratch_pool);
+    }
+
+  *result = dst_stream;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Complete the previous work item
+   of the install_batch_t in OUTPUT_BATON and move the file of the INDEX-th
+   item, translated into the svn_stream_t RESULT, into place. */
+static svn_error_t *
+install_batch_item(void *result,
+                   void *output_baton,
+                   apr_int64_t index,
+                   apr_pool_t *scratch_pool)
+{
+  install_batch_t *batch = output_baton;
+  svn_error_t *err;
+
+  if (index > 0)
+    {
+      apr_uint64_t next_id;
+      svn_skel_t *next_item;
+
+      SVN_ERR(fetch_next_work_item(&next_id, &next_item, batch->wib,
+                                   batch->db, batch->wri_abspath,
+                                   APR_ARRAY_IDX(batch->ids, index - 1,
+                                                 apr_uint64_t),
+                                   scratch_pool));
+    }
+
+  err = finish_file_install(batch->wib, batch->db, batch->installs[index],
+                            result, batch->cancel_func, batch->cancel_baton,
+                            scratch_pool);
+  if (err)
+    return wrap_work_item_error(err, batch->wri_abspath,
+                                APR_ARRAY_IDX(batch->ids, index,
+                                              apr_uint64_t),
+                                APR_ARRAY_IDX(batch->work_items, index,
+                                              svn_skel_t *),
+                                scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Process the OP_FILE_INSTALL work item ID / WORK_ITEM, which has just
+   been fetched from the queue, together with the install items directly
+   following it.  Set *LAST_ID to the last item processed; it is left to
+   the caller to mark that one as completed.  All earlier items in the
+   batch have already been completed.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+run_install_batch(apr_uint64_t *last_id,
+                  work_item_baton_t *wib,
+                  svn_wc__db_t *db,
+                  const char *wri_abspath,
+                  apr_uint64_t id,
+                  svn_skel_t *work_item,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *scratch_pool)
+{
+  install_batch_t batch = { 0 };
+  apr_array_header_t *following_ids;
+  apr_array_header_t *following_items;
+  apr_pool_t *iterpool;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  batch.wib = wib;
+  batch.db = db;
+  batch.wri_abspath = wri_abspath;
+  batch.cancel_func = cancel_func;
+  batch.cancel_baton = cancel_baton;
+
+  SVN_ERR(svn_wc__db_wq_fetch_following(&following_ids, &following_items,
+                                        db, wri_abspath, id,
+                                        INSTALL_BATCH_SIZE - 1,
+                                        scratch_pool, scratch_pool));
+
+  /* The batch is the current item plus all install items up to the
+     first item of any other type. */
+  batch.ids = apr_array_make(scratch_pool, following_ids->nelts + 1,
+                             sizeof(apr_uint64_t));
+  batch.work_items = apr_array_make(scratch_pool, following_ids->nelts + 1,
+                                    sizeof(svn_skel_t *));
+  APR_ARRAY_PUSH(batch.ids, apr_uint64_t) = id;
+  APR_ARRAY_PUSH(batch.work_items, svn_skel_t *) = work_item;
+
+  for (i = 0; i < following_items->nelts; i++)
+    {
+      svn_skel_t *item = APR_ARRAY_IDX(following_items, i, svn_skel_t *);
+      if (! svn_skel__matches_atom(item->children, OP_FILE_INSTALL))
+        break;
+
+      APR_ARRAY_PUSH(batch.ids, apr_uint64_t)
+        = APR_ARRAY_IDX(following_ids, i, apr_uint64_t);
+      APR_ARRAY_PUSH(batch.work_items, svn_skel_t *) = item;
+    }
+
+  /* Read all the install info up-front.  If that fails for some item,
+     we still install everything before it and report the error after. */
+  batch.installs = apr_pcalloc(scratch_pool,
+                               batch.work_items->nelts
+                                 * sizeof(*batch.installs));
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < batch.work_items->nelts; i++)
+    {
+      svn_pool_clear(iterpool);
+      err = prepare_file_install(&batch.installs[i], db,
+                                 APR_ARRAY_IDX(batch.work_items, i,
+                                               svn_skel_t *),
+                                 wri_abspath, scratch_pool, iterpool);
+      if (err)
+        {
+          err = wrap_work_item_error(err, wri_abspath,
+                                     APR_ARRAY_IDX(batch.ids, i,
+                                                   apr_uint64_t),
+                                     APR_ARRAY_IDX(batch.work_items, i,
+                                                   svn_skel_t *),
+                                     scratch_pool);
+          break;
+        }
+    }
+  svn_pool_destroy(iterpool);
+
+  /* The first I items are ready to go. */
+  if (i > 0)
+    SVN_ERR(svn_error_compose_create(
+              svn_task__run(MIN(INSTALL_CONCURRENCY, i), i,
+                            NULL, NULL,
+                            translate_batch_item, &batch,
+                            install_batch_item, &batch,
+                            cancel_func, cancel_baton, scratch_pool),
+              err));
+
+  SVN_ERR(err);
+
+  *last_id = APR_ARRAY_IDX(batch.ids, i - 1, apr_uint64_t);
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_wc__wq_run(svn_wc__db_t *db,
                const char *wri_abspath,
@@ -1508,29 +1865,11 @@ svn_wc__wq_run(svn_wc__db_t *db,
 
       svn_pool_clear(iterpool);
 
-      if (! wib.used)
-        {
-          /* Make sure to do this *early* in the loop iteration. There may
-             be a LAST_ID that needs to be marked as completed, *before* we
-             start worrying about anything else.  */
-          SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db, wri_abspath,
-                                           last_id, iterpool, iterpool));
-        }
-      else
-        {
-          /* Make sure to do this *early* in the loop iteration. There may
-             be a LAST_ID that needs to be marked as completed, *before* we
-             start worrying about anything else.  */
-          SVN_ERR(svn_wc__db_wq_record_and_fetch_next(&id, &work_item,
-                                                      db, wri_abspath,
-                                                      last_id, wib.record_map,
-                                                      iterpool,
-                                                      wib.result_pool));
-
-          svn_pool_clear(wib.result_pool);
-          wib.record_map = NULL;
-          wib.used = FALSE;
-        }
+      /* Make sure to do this *early* in the loop iteration. There may
+         be a LAST_ID that needs to be marked as completed, *before* we
+         start worrying about anything else.  */
+      SVN_ERR(fetch_next_work_item(&id, &work_item, &wib, db, wri_abspath,
+                                   last_id, iterpool));
 
       /* Stop work queue processing, if requested. A future 'svn cleanup'
          should be able to continue the processing. Note that we may
@@ -1543,19 +1882,21 @@ svn_wc__wq_run(svn_wc__db_t *db,
       if (work_item == NULL)
         break;
 
+      /* Translate runs of file installs concurrently. */
+      if (INSTALL_CONCURRENCY > 1
+          && svn_skel__matches_atom(work_item->children, OP_FILE_INSTALL))
+        {
+          SVN_ERR(run_install_batch(&last_id, &wib, db, wri_abspath,
+                                    id, work_item, cancel_func, cancel_baton,
+                                    iterpool));
+          continue;
+        }
+
       err = dispatch_work_item(&wib, db, wri_abspath, work_item,
                                cancel_func, cancel_baton, iterpool);
       if (err)
-        {
-          const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
-
-          return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
-                                   _("Failed to run the WC DB work queue "
-                                     "associated with '%s', work item %d %s"),
-                                   svn_dirent_local_style(wri_abspath,
-                                                          scratch_pool),
-                                   (int)id, skel);
-        }
+        return wrap_work_item_error(err, wri_abspath, id, work_item,
+                                    scratch_pool);
 
       /* The work item finished without error. Mark it completed
          in the next loop.  */
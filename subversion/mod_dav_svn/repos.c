@@ -1766,7 +1766,9 @@ static int sort_encoding_pref(const void *accept_rec1, const void *accept_rec2)
 
 static int get_svndiff_version(const struct accept_rec *rec)
 {
-  if (strcmp(rec->name, "svndiff2") == 0)
+  if (strcmp(rec->name, "svndiff3") == 0)
+    return 3;
+  else if (strcmp(rec->name, "svndiff2") == 0)
     return 2;
   else if (strcmp(rec->name, "svndiff1") == 0)
     return 1;
@@ -1791,6 +1793,7 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
   apr_array_header_t *encoding_prefs;
   apr_array_header_t *svndiff_encodings;
   svn_boolean_t accepts_svndiff2 = FALSE;
+  svn_boolean_t accepts_svndiff3 = FALSE;
 
   encoding_prefs = do_header_line(r->pool,
                                   apr_table_get(r->headers_in,
@@ -1814,6 +1817,8 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
 
       if (version == 2)
         accepts_svndiff2 = TRUE;
+      else if (version == 3)
+        accepts_svndiff3 = TRUE;
     }
 
   if (dav_svn__get_compression_level(r) == 0)
@@ -1822,14 +1827,17 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
        * svndiff0 format, which we assume is always supported. */
       *svndiff_version = 0;
     }
-  else if (accepts_svndiff2 && dav_svn__get_compression_level(r) == 1)
+  else if ((accepts_svndiff2 || accepts_svndiff3)
+           && dav_svn__get_compression_level(r) == 1)
     {
       /* Enable svndiff2 if the client can read it, and if the server-side
        * compression level is set to 1.  Svndiff2 offers better speed and
        * compression ratio comparable to svndiff1 with compression level 1,
-       * but not with other compression levels.
+       * but not with other compression levels.  Svndiff3 uses the same
+       * compression with a more compact instruction encoding, so prefer
+       * it whenever available.
        */
-      *svndiff_version = 2;
+      *svndiff_version = accepts_svndiff3 ? 3 : 2;
     }
   else if (svndiff_encodings->nelts > 0)
     {
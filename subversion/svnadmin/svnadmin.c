@@ -51,6 +51,7 @@
 #include "private/svn_cmdline_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_fs_fs_private.h"
+#include "private/svn_io_private.h"
 
 #include "svn_private_config.h"
 
@@ -97,6 +98,8 @@ check_lib_versions(void)
 /** Subcommands. **/
 
 static svn_opt_subcommand_t
+  subcommand_build_log_index,
+  subcommand_build_repcache,
   subcommand_crashtest,
   subcommand_create,
   subcommand_delrevprop,
@@ -132,6 +135,7 @@ enum svnadmin__cmdline_options_t
     svnadmin__incremental,
     svnadmin__keep_going,
     svnadmin__deltas,
+    svnadmin__raw_deltas,
     svnadmin__ignore_uuid,
     svnadmin__force_uuid,
     svnadmin__fs_type,
@@ -158,7 +162,10 @@ enum svnadmin__cmdline_options_t
     svnadmin__normalize_props,
     svnadmin__exclude,
     svnadmin__include,
-    svnadmin__glob
+    svnadmin__glob,
+    svnadmin__jobs,
+    svnadmin__rep_cache_batch,
+    svnadmin__compress
   };
 
 /* Option codes and descriptions.
@@ -188,6 +195,11 @@ static const apr_getopt_option_t options_table[] =
     {"deltas",        svnadmin__deltas, 0,
      N_("use deltas in dump output")},
 
+    {"raw-deltas",    svnadmin__raw_deltas, 0,
+     N_("with --deltas, copy compressed deltas from the\n"
+        "                             repository as is (may need Subversion\n"
+        "                             1.10+ to load the dump)")},
+
     {"bypass-hooks",  svnadmin__bypass_hooks, 0,
      N_("bypass the repository hook system")},
 
@@ -297,6 +309,22 @@ static const apr_getopt_option_t options_table[] =
         "                             Character '/' is not treated specially, so\n"
         "                             pattern /*/foo matches paths /a/foo and /a/b/foo.") },
 
+    {"jobs", svnadmin__jobs, 1,
+     N_("use up to ARG threads to process independent parts\n"
+        "                             of the repository concurrently\n"
+        "                             [used for FSFS repositories only]")},
+
+    {"compress", svnadmin__compress, 1,
+     N_("compress the dump stream using method ARG\n"
+        "                             ('zlib' or 'lz4'); together with --jobs,\n"
+        "                             compress in multiple threads")},
+
+    {"rep-cache-batch", svnadmin__rep_cache_batch, 1,
+     N_("write rep-cache entries once every ARG revisions\n"
+        "                             (faster; an interrupted load may miss some\n"
+        "                             opportunities to share representations)\n"
+        "                             [used for FSFS repositories only]")},
+
     {NULL}
   };
 
@@ -306,6 +334,26 @@ static const apr_getopt_option_t options_table[] =
  */
 static const svn_opt_subcommand_desc3_t cmd_table[] =
 {
+  {"build-log-index", subcommand_build_log_index, {0}, {N_(
+    "usage: svnadmin build-log-index REPOS_PATH\n"
+    "\n"), N_(
+    "Create the log index of the repository at REPOS_PATH, if it does\n"
+    "not exist yet, and add all revisions that are missing from it.\n"
+    "The index speeds up 'svn log -g'.  Once it exists, every commit\n"
+    "extends it.\n"
+   )},
+   {'q'} },
+
+  {"build-repcache", subcommand_build_repcache, {0}, {N_(
+    "usage: svnadmin build-repcache REPOS_PATH [-r LOWER[:UPPER]]\n"
+    "\n"), N_(
+    "Add missing entries to the representation cache for the repository\n"
+    "at REPOS_PATH.  Process data in revisions LOWER through UPPER.\n"
+    "If no revision arguments are given, process all revisions.  If only\n"
+    "LOWER revision argument is given, process only that single revision.\n"
+   )},
+   {'r', 'q', 'M'} },
+
   {"crashtest", subcommand_crashtest, {0}, {N_(
     "usage: svnadmin crashtest REPOS_PATH\n"
     "\n"), N_(
@@ -370,9 +418,13 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Using --exclude or --include gives results equivalent to authz-based\n"
     "path exclusions. In particular, when the source of a copy is\n"
     "excluded, the copy is transformed into an add (unlike in 'svndumpfilter').\n"
+    "\n"), N_(
+    "Using --compress writes a block-compressed dumpfile that only\n"
+    "'svnadmin load', 'svnrdump load' and 'svndumpfilter' can read.\n"
    )},
-  {'r', svnadmin__incremental, svnadmin__deltas, 'q', 'M', 'F',
-   svnadmin__exclude, svnadmin__include, svnadmin__glob },
+  {'r', svnadmin__incremental, svnadmin__deltas, svnadmin__raw_deltas,
+   'q', 'M', 'F', svnadmin__exclude, svnadmin__include, svnadmin__glob,
+   svnadmin__jobs, svnadmin__compress },
   {{'F', N_("write to file ARG instead of stdout")}} },
 
   {"dump-revprops", subcommand_dump_revprops, {0}, {N_(
@@ -418,7 +470,7 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "If --incremental is passed, data which already exists at the destination\n"
     "is not copied again.  Incremental mode is implemented for FSFS repositories.\n"
    )},
-   {svnadmin__clean_logs, svnadmin__incremental, 'q'} },
+   {svnadmin__clean_logs, svnadmin__incremental, 'q', svnadmin__jobs} },
 
   {"info", subcommand_info, {0}, {N_(
     "usage: svnadmin info REPOS_PATH\n"
@@ -453,13 +505,16 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "one specified in the stream.  Progress feedback is sent to stdout.\n"
     "If --revision is specified, limit the loaded revisions to only those\n"
     "in the dump stream whose revision numbers match the specified range.\n"
+    "Block-compressed dumpfiles (see 'svnadmin dump --compress') are\n"
+    "detected and decompressed automatically.\n"
    )},
    {'q', 'r', svnadmin__ignore_uuid, svnadmin__force_uuid,
     svnadmin__ignore_dates,
     svnadmin__use_pre_commit_hook, svnadmin__use_post_commit_hook,
     svnadmin__parent_dir, svnadmin__normalize_props,
     svnadmin__bypass_prop_validation, 'M',
-    svnadmin__no_flush_to_disk, 'F'},
+    svnadmin__no_flush_to_disk, svnadmin__rep_cache_batch,
+    svnadmin__jobs, 'F'},
    {{'F', N_("read from file ARG instead of stdin")}} },
 
   {"load-revprops", subcommand_load_revprops, {0}, {N_(
@@ -509,7 +564,7 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Possibly compact the repository into a more efficient storage model.\n"
     "This may not apply to all repositories, in which case, exit.\n"
    )},
-   {'q', 'M'} },
+   {'q', 'M', svnadmin__jobs} },
 
   {"recover", subcommand_recover, {0}, {N_(
     "usage: svnadmin recover REPOS_PATH\n"
@@ -619,7 +674,8 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Verify the data stored in the repository.\n"
    )},
    {'t', 'r', 'q', svnadmin__keep_going, 'M',
-    svnadmin__check_normalization, svnadmin__metadata_only} },
+    svnadmin__check_normalization, svnadmin__metadata_only,
+    svnadmin__jobs} },
 
   { NULL, NULL, {0}, {NULL}, {0} }
 };
@@ -637,6 +693,7 @@ struct svnadmin_opt_state
   svn_boolean_t version;                            /* --version */
   svn_boolean_t incremental;                        /* --incremental */
   svn_boolean_t use_deltas;                         /* --deltas */
+  svn_boolean_t raw_deltas;                         /* --raw-deltas */
   svn_boolean_t use_pre_commit_hook;                /* --use-pre-commit-hook */
   svn_boolean_t use_post_commit_hook;               /* --use-post-commit-hook */
   svn_boolean_t use_pre_revprop_change_hook;        /* --use-pre-revprop-change-hook */
@@ -657,6 +714,9 @@ struct svnadmin_opt_state
   enum svn_repos_load_uuid uuid_action;             /* --ignore-uuid,
                                                        --force-uuid */
   apr_uint64_t memory_cache_size;                   /* --memory-cache-size M */
+  int jobs;                                         /* --jobs */
+  int rep_cache_batch;                              /* --rep-cache-batch */
+  int compression;                                  /* --compress */
   const char *parent_dir;                           /* --parent-dir */
   const char *file;                                 /* --file */
   apr_array_header_t *exclude;                      /* --exclude */
@@ -691,6 +751,12 @@ open_repos(svn_repos_t **repos,
                            use_block_read ? "1" : "0");
   svn_hash_sets(fs_config, SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                            opt_state->no_flush_to_disk ? "1" : "0");
+  if (opt_state->jobs > 1)
+    svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_JOBS,
+                             apr_itoa(pool, opt_state->jobs));
+  if (opt_state->rep_cache_batch > 1)
+    svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_REP_CACHE_BATCH,
+                             apr_itoa(pool, opt_state->rep_cache_batch));
 
   /* now, open the requested repository */
   SVN_ERR(svn_repos_open3(repos, path, fs_config, pool, pool));
@@ -1004,7 +1070,7 @@ struct repos_verify_callback_baton
 };
 
 /* Implementation of svn_repos_verify_callback_t to handle errors coming
-   from svn_repos_verify_fs3(). */
+   from svn_repos_verify_fs4(). */
 static svn_error_t *
 repos_verify_callback(void *baton,
                       svn_revnum_t revision,
@@ -1047,7 +1113,7 @@ repos_verify_callback(void *baton,
 
 /* Implementation of svn_repos_notify_func_t to wrap the output to a
    response stream for svn_repos_dump_fs2(), svn_repos_verify_fs(),
-   svn_repos_hotcopy3() and others. */
+   svn_repos_hotcopy4() and others. */
 static void
 repos_notify_handler(void *baton,
                      const svn_repos_notify_t *notify,
@@ -1270,6 +1336,21 @@ repos_notify_handler(void *baton,
                         notify->new_revision));
       return;
 
+    case svn_repos_notify_log_index_rev_range:
+      if (notify->start_revision == notify->end_revision)
+        {
+          svn_error_clear(svn_stream_printf(feedback_stream, scratch_pool,
+                                            _("* Indexed revision %ld.\n"),
+                                            notify->start_revision));
+        }
+      else
+        {
+          svn_error_clear(svn_stream_printf(feedback_stream, scratch_pool,
+                               _("* Indexed revisions from %ld to %ld.\n"),
+                               notify->start_revision, notify->end_revision));
+        }
+      return;
+
     default:
       return;
   }
@@ -1410,6 +1491,35 @@ dump_filter_func(svn_boolean_t *include,
   return SVN_NO_ERROR;
 }
 
+/* Baton for dump_notify_handler(). */
+struct dump_notify_baton_t
+{
+  /* The dump stream, possibly block-compressed. */
+  svn_stream_t *out_stream;
+
+  /* Where to send progress feedback to, or NULL. */
+  svn_stream_t *feedback_stream;
+
+  /* First error that occurred while ending a compression block. */
+  svn_error_t *err;
+};
+
+/* Implements svn_repos_notify_func_t.  Start a new compression block for
+   every revision and forward the notification to repos_notify_handler(). */
+static void
+dump_notify_handler(void *baton,
+                    const svn_repos_notify_t *notify,
+                    apr_pool_t *scratch_pool)
+{
+  struct dump_notify_baton_t *b = baton;
+
+  if (notify->action == svn_repos_notify_dump_rev_end && !b->err)
+    b->err = svn_stream__block_boundary(b->out_stream);
+
+  if (b->feedback_stream)
+    repos_notify_handler(b->feedback_stream, notify, scratch_pool);
+}
+
 /* This implements `svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_dump(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -1420,6 +1530,7 @@ subcommand_dump(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   svn_revnum_t lower, upper;
   svn_stream_t *feedback_stream = NULL;
   struct dump_filter_baton_t filter_baton = {0};
+  struct dump_notify_baton_t notify_baton = {0};
 
   /* Expect no more arguments. */
   SVN_ERR(parse_args(NULL, os, 0, 0, pool));
@@ -1441,10 +1552,18 @@ subcommand_dump(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   else
     SVN_ERR(svn_stream_for_stdout(&out_stream, pool));
 
+  if (opt_state->compression)
+    out_stream = svn_stream__block_compressed(out_stream,
+                                              opt_state->compression,
+                                              opt_state->jobs, pool);
+
   /* Progress feedback goes to STDERR, unless they asked to suppress it. */
   if (! opt_state->quiet)
     feedback_stream = recode_stream_create(stderr, pool);
 
+  notify_baton.out_stream = out_stream;
+  notify_baton.feedback_stream = feedback_stream;
+
   /* Initialize the filter baton. */
   filter_baton.glob = opt_state->glob;
 
@@ -1465,16 +1584,20 @@ subcommand_dump(apr_getopt_t *os, void *baton, apr_pool_t *pool)
                                  "cannot be used simultaneously"));
     }
 
-  SVN_ERR(svn_repos_dump_fs4(repos, out_stream, lower, upper,
+  SVN_ERR(svn_repos_dump_fs5(repos, out_stream, lower, upper,
                              opt_state->incremental, opt_state->use_deltas,
-                             TRUE, TRUE,
-                             !opt_state->quiet ? repos_notify_handler : NULL,
-                             feedback_stream,
+                             opt_state->raw_deltas, TRUE, TRUE,
+                             opt_state->jobs,
+                             opt_state->compression || !opt_state->quiet
+                               ? dump_notify_handler : NULL,
+                             &notify_baton,
                              filter_baton.prefixes ? dump_filter_func : NULL,
                              &filter_baton,
                              check_cancel, NULL, pool));
+  SVN_ERR(notify_baton.err);
 
-  return SVN_NO_ERROR;
+  /* Flush any data still held by the compressing stream. */
+  return svn_error_trace(svn_stream_close(out_stream));
 }
 
 /* This implements `svn_opt_subcommand_t'. */
@@ -1511,8 +1634,8 @@ subcommand_dump_revprops(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   if (! opt_state->quiet)
     feedback_stream = recode_stream_create(stderr, pool);
 
-  SVN_ERR(svn_repos_dump_fs4(repos, out_stream, lower, upper,
-                             FALSE, FALSE, TRUE, FALSE,
+  SVN_ERR(svn_repos_dump_fs5(repos, out_stream, lower, upper,
+                             FALSE, FALSE, FALSE, TRUE, FALSE, 1,
                              !opt_state->quiet ? repos_notify_handler : NULL,
                              feedback_stream, NULL, NULL,
                              check_cancel, NULL, pool));
@@ -1690,6 +1813,39 @@ get_load_range(svn_revnum_t *lower,
 }
 
 
+/* Set *STREAM to the dump stream to load, i.e. the file given by -F in
+   OPT_STATE or STDIN.  Allocate it in RESULT_POOL. */
+static svn_error_t *
+open_load_input(svn_stream_t **stream,
+                struct svnadmin_opt_state *opt_state,
+                apr_pool_t *result_pool)
+{
+  /* Open the file or STDIN, depending on whether -F was specified. */
+  if (opt_state->file)
+    SVN_ERR(svn_stream_open_readonly(stream, opt_state->file,
+                                     result_pool, result_pool));
+  else
+    SVN_ERR(svn_stream_for_stdin2(stream, TRUE, result_pool));
+
+  /* Transparently decompress block-compressed dump streams.  Plain dump
+     files are read directly, because the parser reads lines much faster
+     from streams that support mark and seek. */
+  if (svn_stream_supports_mark(*stream))
+    {
+      svn_boolean_t compressed;
+
+      SVN_ERR(svn_stream__is_block_compressed(&compressed, *stream,
+                                              result_pool));
+      if (!compressed)
+        return SVN_NO_ERROR;
+    }
+
+  *stream = svn_stream__block_decompressed(*stream, opt_state->jobs,
+                                           result_pool);
+
+  return SVN_NO_ERROR;
+}
+
 /* This implements `svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_load(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -1699,6 +1855,7 @@ subcommand_load(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   svn_repos_t *repos;
   svn_revnum_t lower, upper;
   svn_stream_t *in_stream;
+  apr_pool_t *input_pool;
   svn_stream_t *feedback_stream = NULL;
 
   /* Expect no more arguments. */
@@ -1710,26 +1867,32 @@ subcommand_load(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 
   SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
 
-  /* Open the file or STDIN, depending on whether -F was specified. */
-  if (opt_state->file)
-    SVN_ERR(svn_stream_open_readonly(&in_stream, opt_state->file,
-                                     pool, pool));
-  else
-    SVN_ERR(svn_stream_for_stdin2(&in_stream, TRUE, pool));
+  /* The input may get read and decompressed by other threads while we
+     commit.  Give it a root pool of its own with a thread-safe
+     allocator. */
+  input_pool = svn_pool_create(NULL);
+  err = open_load_input(&in_stream, opt_state, input_pool);
+  if (err)
+    {
+      svn_pool_destroy(input_pool);
+      return svn_error_trace(err);
+    }
 
   /* Progress feedback goes to STDOUT, unless they asked to suppress it. */
   if (! opt_state->quiet)
     feedback_stream = recode_stream_create(stdout, pool);
 
-  err = svn_repos_load_fs6(repos, in_stream, lower, upper,
+  err = svn_repos_load_fs7(repos, in_stream, lower, upper,
                            opt_state->uuid_action, opt_state->parent_dir,
                            opt_state->use_pre_commit_hook,
                            opt_state->use_post_commit_hook,
                            !opt_state->bypass_prop_validation,
                            opt_state->ignore_dates,
                            opt_state->normalize_props,
+                           opt_state->jobs,
                            opt_state->quiet ? NULL : repos_notify_handler,
                            feedback_stream, check_cancel, NULL, pool);
+  svn_pool_destroy(input_pool);
 
   if (svn_error_find_cause(err, SVN_ERR_BAD_PROPERTY_VALUE_EOL))
     {
@@ -1758,6 +1921,7 @@ subcommand_load_revprops(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   svn_repos_t *repos;
   svn_revnum_t lower, upper;
   svn_stream_t *in_stream;
+  apr_pool_t *input_pool;
 
   svn_stream_t *feedback_stream = NULL;
 
@@ -1770,12 +1934,16 @@ subcommand_load_revprops(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 
   SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
 
-  /* Open the file or STDIN, depending on whether -F was specified. */
-  if (opt_state->file)
-    SVN_ERR(svn_stream_open_readonly(&in_stream, opt_state->file,
-                                     pool, pool));
-  else
-    SVN_ERR(svn_stream_for_stdin2(&in_stream, TRUE, pool));
+  /* The input may get read and decompressed by other threads while we
+     commit.  Give it a root pool of its own with a thread-safe
+     allocator. */
+  input_pool = svn_pool_create(NULL);
+  err = open_load_input(&in_stream, opt_state, input_pool);
+  if (err)
+    {
+      svn_pool_destroy(input_pool);
+      return svn_error_trace(err);
+    }
 
   /* Progress feedback goes to STDOUT, unless they asked to suppress it. */
   if (! opt_state->quiet)
@@ -1788,6 +1956,7 @@ subcommand_load_revprops(apr_getopt_t *os, void *baton, apr_pool_t *pool)
                                    opt_state->quiet ? NULL
                                                     : repos_notify_handler,
                                    feedback_stream, check_cancel, NULL, pool);
+  svn_pool_destroy(input_pool);
 
   if (svn_error_find_cause(err, SVN_ERR_BAD_PROPERTY_VALUE_EOL))
     {
@@ -2177,9 +2346,66 @@ subcommand_setlog(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 }
 
 
+/* Implements svn_repos_notify_func_t.  With multiple jobs, several shards
+   may be in progress at the same time, so report their start and end on
+   separate lines and forward anything else to repos_notify_handler(). */
+static void
+pack_jobs_notify_handler(void *baton,
+                         const svn_repos_notify_t *notify,
+                         apr_pool_t *scratch_pool)
+{
+  svn_stream_t *feedback_stream = baton;
+  const char *shardstr = apr_psprintf(scratch_pool, "%" APR_INT64_T_FMT,
+                                      notify->shard);
+
+  switch (notify->action)
+  {
+    case svn_repos_notify_pack_shard_start:
+      svn_error_clear(svn_stream_printf(feedback_stream, scratch_pool,
+                        _("Packing revisions in shard %s...\n"), shardstr));
+      return;
+
+    case svn_repos_notify_pack_shard_end:
+      svn_error_clear(svn_stream_printf(feedback_stream, scratch_pool,
+                        _("Packed revisions in shard %s.\n"), shardstr));
+      return;
+
+    default:
+      repos_notify_handler(baton, notify, scratch_pool);
+  }
+}
+
 /* This implements 'svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_pack(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+  svn_stream_t *feedback_stream = NULL;
+  svn_repos_notify_func_t notify_func = NULL;
+
+  /* Expect no more arguments. */
+  SVN_ERR(parse_args(NULL, os, 0, 0, pool));
+
+  SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
+
+  /* Progress feedback goes to STDOUT, unless they asked to suppress it. */
+  if (! opt_state->quiet)
+    {
+      feedback_stream = recode_stream_create(stdout, pool);
+      notify_func = opt_state->jobs > 1 ? pack_jobs_notify_handler
+                                        : repos_notify_handler;
+    }
+
+  return svn_error_trace(
+    svn_repos_fs_pack2(repos, notify_func, feedback_stream,
+                       check_cancel, NULL, pool));
+}
+
+
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_build_log_index(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 {
   struct svnadmin_opt_state *opt_state = baton;
   svn_repos_t *repos;
@@ -2195,8 +2421,78 @@ subcommand_pack(apr_getopt_t *os, void *baton, apr_pool_t *pool)
     feedback_stream = recode_stream_create(stdout, pool);
 
   return svn_error_trace(
-    svn_repos_fs_pack2(repos, !opt_state->quiet ? repos_notify_handler : NULL,
-                       feedback_stream, check_cancel, NULL, pool));
+    svn_repos_build_log_index(repos,
+                              !opt_state->quiet ? repos_notify_handler : NULL,
+                              feedback_stream, check_cancel, NULL, pool));
+}
+
+
+/* Implements svn_fs_progress_notify_func_t. */
+static void
+build_rep_cache_progress_func(svn_revnum_t revision,
+                              void *baton,
+                              apr_pool_t *pool)
+{
+  svn_error_clear(svn_cmdline_printf(pool,
+                                     _("* Processed revision %ld.\n"),
+                                     revision));
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_build_repcache(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_revnum_t youngest, lower, upper;
+  svn_fs_fs__ioctl_build_rep_cache_input_t input = {0};
+  svn_error_t *err;
+
+  /* Expect no more arguments. */
+  SVN_ERR(parse_args(NULL, os, 0, 0, pool));
+
+  SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
+  fs = svn_repos_fs(repos);
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+
+  /* Find the revision numbers at which to start and end. */
+  SVN_ERR(get_revnum(&lower, &opt_state->start_revision,
+                     youngest, repos, pool));
+  SVN_ERR(get_revnum(&upper, &opt_state->end_revision,
+                     youngest, repos, pool));
+
+  /* Fill in implied revisions if necessary. */
+  if (lower == SVN_INVALID_REVNUM)
+    {
+      lower = 0;
+      upper = youngest;
+    }
+  else if (upper == SVN_INVALID_REVNUM)
+    {
+      upper = lower;
+    }
+
+  if (lower > upper)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+       _("First revision cannot be higher than second"));
+
+  input.start_rev = lower;
+  input.end_rev = upper;
+  if (! opt_state->quiet)
+    input.progress_func = build_rep_cache_progress_func;
+
+  err = svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_BUILD_REP_CACHE, &input, NULL,
+                     check_cancel, NULL, pool, pool);
+  if (err && err->apr_err == SVN_ERR_FS_UNRECOGNIZED_IOCTL_CODE)
+    {
+      return svn_error_quick_wrapf(err,
+                                   _("Building rep-cache is not implemented "
+                                     "for the filesystem type found in '%s'"),
+                                   svn_fs_path(fs, pool));
+    }
+
+  return svn_error_trace(err);
 }
 
 
@@ -2261,9 +2557,10 @@ subcommand_verify(apr_getopt_t *os, void *baton, apr_pool_t *pool)
     apr_array_make(pool, 0, sizeof(struct verification_error *));
   verify_baton.result_pool = pool;
 
-  SVN_ERR(svn_repos_verify_fs3(repos, lower, upper,
+  SVN_ERR(svn_repos_verify_fs4(repos, lower, upper,
                                opt_state->check_normalization,
                                opt_state->metadata_only,
+                               opt_state->jobs,
                                !opt_state->quiet
                                  ? repos_notify_handler : NULL,
                                feedback_stream,
@@ -2361,8 +2658,9 @@ subcommand_hotcopy(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   if (! opt_state->quiet)
     feedback_stream = recode_stream_create(stdout, pool);
 
-  return svn_repos_hotcopy3(opt_state->repository_path, new_repos_path,
+  return svn_repos_hotcopy4(opt_state->repository_path, new_repos_path,
                             opt_state->clean_logs, opt_state->incremental,
+                            opt_state->jobs,
                             !opt_state->quiet ? repos_notify_handler : NULL,
                             feedback_stream, check_cancel, NULL, pool);
 }
@@ -2964,6 +3262,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
   opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.jobs = 1;
 
   /* Parse options. */
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -3029,6 +3328,24 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           opt_state.memory_cache_size = 0x100000 * sz_val;
         }
         break;
+      case svnadmin__jobs:
+        SVN_ERR(svn_cstring_atoi(&opt_state.jobs, opt_arg));
+        if (opt_state.jobs < 1)
+          return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                   _("Invalid number of jobs '%s'"),
+                                   opt_arg);
+        break;
+      case svnadmin__compress:
+        SVN_ERR(svn_stream__parse_block_compression(&opt_state.compression,
+                                                    opt_arg));
+        break;
+      case svnadmin__rep_cache_batch:
+        SVN_ERR(svn_cstring_atoi(&opt_state.rep_cache_batch, opt_arg));
+        if (opt_state.rep_cache_batch < 1)
+          return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                   _("Invalid number of revisions '%s'"),
+                                   opt_arg);
+        break;
       case 'F':
         SVN_ERR(svn_utf_cstring_to_utf8(&(opt_state.file), opt_arg, pool));
         dash_F_arg = TRUE;
@@ -3042,6 +3359,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnadmin__deltas:
         opt_state.use_deltas = TRUE;
         break;
+      case svnadmin__raw_deltas:
+        opt_state.raw_deltas = TRUE;
+        break;
       case svnadmin__ignore_uuid:
         opt_state.uuid_action = svn_repos_load_uuid_ignore;
         break;
@@ -3305,7 +3625,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_t settings = *svn_cache_config_get();
 
     settings.cache_size = opt_state.memory_cache_size;
-    settings.single_threaded = TRUE;
+
+    /* Worker threads will share the cache. */
+    settings.single_threaded = opt_state.jobs < 2;
 
     svn_cache_config_set(&settings);
   }
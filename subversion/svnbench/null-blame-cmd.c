@@ -33,6 +33,7 @@
 #include "svn_dirent_uri.h"
 #include "svn_path.h"
 #include "svn_pools.h"
+#include "svn_props.h"
 #include "svn_sorts.h"
 #include "cl.h"
 
@@ -40,10 +41,29 @@
 #include "private/svn_string_private.h"
 #include "private/svn_client_private.h"
 
+/* A file revision as reported by svn_ra_get_file_revs2(). */
+typedef struct recorded_rev_t
+{
+  const char *path;
+  svn_revnum_t revnum;
+  apr_hash_t *rev_props;
+  svn_boolean_t merged_revision;
+  apr_array_header_t *prop_diffs;
+
+  /* The svn_txdelta_window_t * of the text delta.  NULL if the contents
+     did not change. */
+  apr_array_header_t *windows;
+} recorded_rev_t;
+
 struct file_rev_baton {
   apr_int64_t byte_count;
   apr_int64_t delta_count;
   apr_int64_t rev_count;
+
+  /* If not NULL, record all recorded_rev_t * in here.  They will be
+     allocated in RECORD_POOL. */
+  apr_array_header_t *revs;
+  apr_pool_t *record_pool;
 };
 
 /* Implements svn_txdelta_window_handler_t */
@@ -53,7 +73,17 @@ delta_handler(svn_txdelta_window_t *window, void *baton)
   struct file_rev_baton *frb = baton;
 
   if (window != NULL)
-    frb->byte_count += window->tview_len;
+    {
+      frb->byte_count += window->tview_len;
+
+      if (frb->revs)
+        {
+          recorded_rev_t *rev = APR_ARRAY_IDX(frb->revs, frb->revs->nelts - 1,
+                                              recorded_rev_t *);
+          APR_ARRAY_PUSH(rev->windows, svn_txdelta_window_t *)
+            = svn_txdelta_window_dup(window, frb->record_pool);
+        }
+    }
 
   return SVN_NO_ERROR;
 }
@@ -72,6 +102,23 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
 
   frb->rev_count++;
 
+  if (frb->revs)
+    {
+      recorded_rev_t *rev = apr_pcalloc(frb->record_pool, sizeof(*rev));
+      rev->path = apr_pstrdup(frb->record_pool, path);
+      rev->revnum = revnum;
+      rev->rev_props = rev_props
+                     ? svn_prop_hash_dup(rev_props, frb->record_pool)
+                     : NULL;
+      rev->merged_revision = merged_revision;
+      rev->prop_diffs = svn_prop_array_dup(prop_diffs, frb->record_pool);
+      if (content_delta_handler)
+        rev->windows = apr_array_make(frb->record_pool, 4,
+                                      sizeof(svn_txdelta_window_t *));
+
+      APR_ARRAY_PUSH(frb->revs, recorded_rev_t *) = rev;
+    }
+
   if (content_delta_handler)
     {
       *content_delta_handler = delta_handler;
@@ -82,6 +129,66 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_client__file_revs_func_t.  Report the file revisions
+   recorded in BATON, an array of recorded_rev_t *, to HANDLER. */
+static svn_error_t *
+replay_file_revs(void *baton,
+                 svn_file_rev_handler_t handler,
+                 void *handler_baton,
+                 apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *revs = baton;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i, k;
+
+  for (i = 0; i < revs->nelts; ++i)
+    {
+      const recorded_rev_t *rev = APR_ARRAY_IDX(revs, i, recorded_rev_t *);
+      svn_txdelta_window_handler_t window_handler = NULL;
+      void *window_baton = NULL;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(handler(handler_baton, rev->path, rev->revnum, rev->rev_props,
+                      rev->merged_revision,
+                      rev->windows ? &window_handler : NULL,
+                      rev->windows ? &window_baton : NULL,
+                      rev->prop_diffs, iterpool));
+
+      if (window_handler)
+        {
+          for (k = 0; k < rev->windows->nelts; ++k)
+            SVN_ERR(window_handler(APR_ARRAY_IDX(rev->windows, k,
+                                                 svn_txdelta_window_t *),
+                                   window_baton));
+
+          SVN_ERR(window_handler(NULL, window_baton));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_client_blame_receiver4_t.  Count the lines in BATON,
+   an apr_int64_t. */
+static svn_error_t *
+blame_receiver(void *baton,
+               apr_int64_t line_no,
+               svn_revnum_t revision,
+               apr_hash_t *rev_props,
+               svn_revnum_t merged_revision,
+               apr_hash_t *merged_rev_props,
+               const char *merged_path,
+               const svn_string_t *line,
+               svn_boolean_t local_change,
+               apr_pool_t *pool)
+{
+  apr_int64_t *line_count = baton;
+  ++*line_count;
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 bench_null_blame(const char *target,
                  const svn_opt_revision_t *peg_revision,
@@ -89,10 +196,11 @@ bench_null_blame(const char *target,
                  const svn_opt_revision_t *end,
                  svn_boolean_t include_merged_revisions,
                  svn_boolean_t quiet,
+                 svn_boolean_t annotate,
                  svn_client_ctx_t *ctx,
                  apr_pool_t *pool)
 {
-  struct file_rev_baton frb = { 0, 0, 0};
+  struct file_rev_baton frb = { 0, 0, 0, NULL, NULL };
   svn_ra_session_t *ra_session;
   svn_revnum_t start_revnum, end_revnum;
   svn_boolean_t backwards;
@@ -140,6 +248,14 @@ bench_null_blame(const char *target,
 
   backwards = (start_revnum > end_revnum);
 
+  /* Keep the file revisions in memory, so we can run the blame algorithm
+     on them later without involving the RA layer. */
+  if (annotate)
+    {
+      frb.record_pool = pool;
+      frb.revs = apr_array_make(pool, 16, sizeof(recorded_rev_t *));
+    }
+
   /* Collect all blame information.
      We need to ensure that we get one revision before the start_rev,
      if available so that we can know what was actually changed in the start
@@ -160,6 +276,33 @@ bench_null_blame(const char *target,
                                svn__ui64toa_sep(frb.delta_count, ',', pool),
                                svn__ui64toa_sep(frb.byte_count, ',', pool)));
 
+  /* Run the actual blame algorithm on the recorded data.  This excludes
+     the RA layer and the network from the measurement. */
+  if (annotate)
+    {
+      apr_int64_t line_count = 0;
+      const char *repos_root_url;
+      apr_time_t start_time;
+
+      SVN_ERR(svn_ra_get_repos_root2(ra_session, &repos_root_url, pool));
+
+      start_time = apr_time_now();
+      SVN_ERR(svn_client__blame_file_revs(target, repos_root_url,
+                                          start_revnum, end_revnum,
+                                          replay_file_revs, frb.revs,
+                                          svn_diff_file_options_create(pool),
+                                          TRUE, include_merged_revisions,
+                                          blame_receiver, &line_count,
+                                          ctx, pool));
+
+      if (!quiet)
+        SVN_ERR(svn_cmdline_printf(pool,
+                                   _("%15s lines annotated\n"
+                                     "%15.6f seconds to annotate\n"),
+                                   svn__ui64toa_sep(line_count, ',', pool),
+                                   (apr_time_now() - start_time) / 1.0e6));
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -243,6 +386,7 @@ svn_cl__null_blame(apr_getopt_t *os,
                              &opt_state->end_revision,
                              opt_state->use_merge_history,
                              opt_state->quiet,
+                             opt_state->annotate,
                              ctx,
                              iterpool);
 
@@ -70,7 +70,8 @@ typedef enum svn_cl__longopt_t {
   opt_trust_server_cert,
   opt_trust_server_cert_failures,
   opt_changelist,
-  opt_search
+  opt_search,
+  opt_annotate
 } svn_cl__longopt_t;
 
 
@@ -171,6 +172,10 @@ const apr_getopt_option_t svn_cl__options[] =
                        "history")},
   {"search", opt_search, 1,
                        N_("use ARG as search pattern (glob syntax)")},
+  {"annotate",      opt_annotate, 0,
+                    N_("also run the annotation algorithm on the fetched\n"
+                       "                             "
+                       "revisions and report the time it took")},
 
   /* Long-opt Aliases
    *
@@ -232,9 +237,11 @@ const svn_opt_subcommand_desc3_t svn_cl__cmd_table[] =
      "  If specified, REV determines in which revision the target is first\n"
      "  looked up.\n"
      "\n"), N_(
-     "  Write the annotated result to standard output.\n"
+     "  With --annotate, keep the fetched revisions in memory and afterwards\n"
+     "  run the complete annotation algorithm on them.  The reported time\n"
+     "  does not include fetching the revisions from the repository.\n"
     )},
-    {'r', 'g'} },
+    {'r', 'g', opt_annotate} },
 
   { "null-export", svn_cl__null_export, {0}, {N_(
      "Create an unversioned copy of a tree.\n"
@@ -704,6 +711,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                                  apr_pstrdup(pool, utf8_opt_arg),
                                  pool);
         break;
+      case opt_annotate:
+        opt_state.annotate = TRUE;
+        break;
       default:
         /* Hmmm. Perhaps this would be a good place to squirrel away
            opts that commands like svn diff might need. Hmmm indeed. */
@@ -48,6 +48,7 @@
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_sorts_private.h"
+#include "private/svn_io_private.h"
 
 /*** Code. ***/
 
@@ -380,6 +381,7 @@ output_revision(struct revision_baton_t *rb)
   if (write_out_rev)
     {
       /* This revision is a keeper. */
+      SVN_ERR(svn_stream__block_boundary(rb->pb->out_stream));
       SVN_ERR(svn_repos__dump_revision_record(rb->pb->out_stream,
                                               rb->rev_actual,
                                               rb->original_headers,
@@ -932,7 +934,9 @@ enum
     svndumpfilter__targets,
     svndumpfilter__quiet,
     svndumpfilter__glob,
-    svndumpfilter__version
+    svndumpfilter__version,
+    svndumpfilter__compress,
+    svndumpfilter__jobs
   };
 
 /* Option codes and descriptions.
@@ -971,6 +975,12 @@ static const apr_getopt_option_t options_table[] =
     {"targets", svndumpfilter__targets, 1,
      N_("Read additional prefixes, one per line, from\n"
         "                             file ARG.")},
+    {"compress", svndumpfilter__compress, 1,
+     N_("Block-compress the output using method ARG\n"
+        "                             ('zlib' or 'lz4').  Compressed input is\n"
+        "                             detected automatically.")},
+    {"jobs", svndumpfilter__jobs, 1,
+     N_("Use up to ARG threads to compress and decompress.")},
     {NULL}
   };
 
@@ -988,7 +998,7 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
       svndumpfilter__renumber_revs,
       svndumpfilter__skip_missing_merge_sources, svndumpfilter__targets,
       svndumpfilter__preserve_revprops, svndumpfilter__quiet,
-      svndumpfilter__glob} },
+      svndumpfilter__glob, svndumpfilter__compress, svndumpfilter__jobs} },
 
     {"include", subcommand_include, {0}, {N_(
         "Filter out nodes without given prefixes from dumpstream.\n"
@@ -998,7 +1008,7 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
       svndumpfilter__renumber_revs,
       svndumpfilter__skip_missing_merge_sources, svndumpfilter__targets,
       svndumpfilter__preserve_revprops, svndumpfilter__quiet,
-      svndumpfilter__glob} },
+      svndumpfilter__glob, svndumpfilter__compress, svndumpfilter__jobs} },
 
     {"help", subcommand_help, {"?", "h"}, {N_(
         "Describe the usage of this program or its subcommands.\n"
@@ -1026,6 +1036,8 @@ struct svndumpfilter_opt_state
   svn_boolean_t skip_missing_merge_sources;
                                          /* --skip-missing-merge-sources */
   const char *targets_file;              /* --targets-file       */
+  int compression;                       /* --compress          */
+  int jobs;                              /* --jobs              */
   apr_array_header_t *prefixes;          /* mainargs.           */
 };
 
@@ -1040,9 +1052,15 @@ parse_baton_initialize(struct parse_baton_t **pb,
 
   /* Read the stream from STDIN.  Users can redirect a file. */
   SVN_ERR(svn_stream_for_stdin2(&baton->in_stream, TRUE, pool));
+  baton->in_stream = svn_stream__block_decompressed(baton->in_stream,
+                                                    opt_state->jobs, pool);
 
   /* Have the parser dump results to STDOUT. Users can redirect a file. */
   SVN_ERR(svn_stream_for_stdout(&baton->out_stream, pool));
+  if (opt_state->compression)
+    baton->out_stream = svn_stream__block_compressed(baton->out_stream,
+                                                     opt_state->compression,
+                                                     opt_state->jobs, pool);
 
   baton->do_exclude = do_exclude;
 
@@ -1176,6 +1194,9 @@ do_filter(apr_getopt_t *os,
   SVN_ERR(svn_repos_parse_dumpstream3(pb->in_stream, &filtering_vtable, pb,
                                       TRUE, NULL, NULL, pool));
 
+  /* Flush any data still held by the compressing stream. */
+  SVN_ERR(svn_stream_close(pb->out_stream));
+
   /* The rest of this is just reporting.  If we aren't reporting, get
      outta here. */
   if (opt_state->quiet)
@@ -1320,6 +1341,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 
   /* Initialize opt_state. */
   memset(&opt_state, 0, sizeof(opt_state));
+  opt_state.jobs = 1;
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
 
@@ -1379,6 +1401,17 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           SVN_ERR(svn_utf_cstring_to_utf8(&opt_state.targets_file,
                                           opt_arg, pool));
           break;
+        case svndumpfilter__compress:
+          SVN_ERR(svn_stream__parse_block_compression(&opt_state.compression,
+                                                      opt_arg));
+          break;
+        case svndumpfilter__jobs:
+          SVN_ERR(svn_cstring_atoi(&opt_state.jobs, opt_arg));
+          if (opt_state.jobs < 1)
+            return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                     _("Invalid number of jobs '%s'"),
+                                     opt_arg);
+          break;
         default:
           {
             SVN_ERR(subcommand_help(NULL, NULL, pool));
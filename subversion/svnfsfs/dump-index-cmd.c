@@ -82,7 +82,7 @@ dump_index(const char *path,
   svn_fs_fs__ioctl_dump_index_input_t input = {0};
 
   /* Check repository type and open it. */
-  SVN_ERR(open_fs(&fs, path, pool));
+  SVN_ERR(open_fs(&fs, path, NULL, pool));
 
   /* Write header line. */
   printf("       Start       Length Type   Revision     Item Checksum\n");
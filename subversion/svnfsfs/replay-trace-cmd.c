@@ -0,0 +1,184 @@
+/* replay-trace-cmd.c -- implements the replay-trace sub-command.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_pools.h"
+
+#include "private/svn_fs_fs_private.h"
+#include "private/svn_string_private.h"
+
+#include "svn_private_config.h"
+#include "svnfsfs.h"
+
+/* Display names of the svn_fs_fs__access_kind_t values. */
+static const char *access_kind_str[SVN_FS_FS__ACCESS_KIND_COUNT]
+  = {"node", "rep", "window", "chgs"};
+
+/* Totals for one kind of access, either as recorded or as replayed. */
+typedef struct access_totals_t
+{
+  /* Number of accesses. */
+  apr_uint64_t count;
+
+  /* Number of those served from cache. */
+  apr_uint64_t cache_hits;
+
+  /* Bytes read from rev / pack files, if known. */
+  apr_uint64_t bytes_read;
+
+  /* Total time spent in microseconds. */
+  apr_uint64_t latency;
+} access_totals_t;
+
+/* Baton for replay_callback(). */
+typedef struct replay_baton_t
+{
+  /* Access statistics per svn_fs_fs__access_kind_t. */
+  access_totals_t recorded[SVN_FS_FS__ACCESS_KIND_COUNT];
+  access_totals_t replayed[SVN_FS_FS__ACCESS_KIND_COUNT];
+
+  /* Number of accesses that could not be replayed. */
+  apr_uint64_t skipped;
+} replay_baton_t;
+
+/* Add RECORD to TOTALS. */
+static void
+add_access(access_totals_t *totals,
+           const svn_fs_fs__access_record_t *record)
+{
+  totals[record->kind].count++;
+  totals[record->kind].latency += record->latency;
+  if (record->cache_hit)
+    totals[record->kind].cache_hits++;
+  else if (record->kind != svn_fs_fs__access_rep_header)
+    totals[record->kind].bytes_read += record->size;
+}
+
+/* Implements svn_fs_fs__replay_access_func_t, accumulating the access
+ * statistics in the replay_baton_t * BATON. */
+static svn_error_t *
+replay_callback(const svn_fs_fs__access_record_t *recorded,
+                const svn_fs_fs__access_record_t *replayed,
+                void *baton,
+                apr_pool_t *scratch_pool)
+{
+  replay_baton_t *b = baton;
+
+  if (replayed)
+    {
+      add_access(b->recorded, recorded);
+      add_access(b->replayed, replayed);
+    }
+  else
+    {
+      b->skipped++;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Print one line to console showing TOTALS under the given LABEL.
+ * Use POOL for allocations. */
+static void
+print_totals(const char *label,
+             const access_totals_t *totals,
+             apr_pool_t *pool)
+{
+  printf(_("%-7s %12s %12s %14s %10.1f ms\n"),
+         label,
+         svn__ui64toa_sep(totals->count, ',', pool),
+         svn__ui64toa_sep(totals->cache_hits, ',', pool),
+         svn__ui64toa_sep(totals->bytes_read, ',', pool),
+         totals->latency / 1000.0);
+}
+
+/* Print the access statistics in TOTALS to console, starting with a
+ * line containing TITLE.  Use POOL for allocations. */
+static void
+print_table(const char *title,
+            const access_totals_t *totals,
+            apr_pool_t *pool)
+{
+  access_totals_t sum = { 0 };
+  int i;
+
+  printf("\n%s\n", title);
+  printf(_("%-7s %12s %12s %14s %13s\n"),
+         _("kind"), _("accesses"), _("cache hits"), _("bytes read"),
+         _("time"));
+
+  for (i = 0; i < SVN_FS_FS__ACCESS_KIND_COUNT; ++i)
+    {
+      print_totals(access_kind_str[i], &totals[i], pool);
+
+      sum.count += totals[i].count;
+      sum.cache_hits += totals[i].cache_hits;
+      sum.bytes_read += totals[i].bytes_read;
+      sum.latency += totals[i].latency;
+    }
+
+  print_totals(_("total"), &sum, pool);
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+svn_error_t *
+subcommand__replay_trace(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  svnfsfs__opt_state *opt_state = baton;
+  apr_array_header_t *args;
+  svn_fs_t *fs;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  svn_fs_fs__ioctl_replay_access_trace_input_t input = { 0 };
+  replay_baton_t *replay_baton = apr_pcalloc(pool, sizeof(*replay_baton));
+  const char *trace_path;
+  void *output;
+
+  SVN_ERR(svn_opt_parse_all_args(&args, os, pool));
+  if (args->nelts != 1)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Exactly one trace file argument required"));
+
+  trace_path = svn_dirent_internal_style(APR_ARRAY_IDX(args, 0,
+                                                       const char *),
+                                         pool);
+
+  /* The trace may have been recorded with a different setting. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ,
+                opt_state->block_read ? "1" : "0");
+  SVN_ERR(open_fs(&fs, opt_state->repository_path, fs_config, pool));
+
+  input.trace_path = trace_path;
+  input.callback_func = replay_callback;
+  input.callback_baton = replay_baton;
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_REPLAY_ACCESS_TRACE, &input,
+                       &output, check_cancel, NULL, pool, pool));
+
+  print_table(_("Recorded:"), replay_baton->recorded, pool);
+  print_table(_("Replayed:"), replay_baton->replayed, pool);
+
+  if (replay_baton->skipped)
+    printf(_("\n%s accesses could not be replayed\n"),
+           svn__ui64toa_sep(replay_baton->skipped, ',', pool));
+
+  return SVN_NO_ERROR;
+}
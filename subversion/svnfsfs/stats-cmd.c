@@ -22,7 +22,10 @@
 
 #include <assert.h>
 
+#include <apr_strings.h>
+
 #include "svn_fs.h"
+#include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_sorts.h"
 
@@ -501,11 +504,17 @@ subcommand__stats(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 {
   svnfsfs__opt_state *opt_state = baton;
   svn_fs_t *fs;
+  apr_hash_t *fs_config = apr_hash_make(pool);
   svn_fs_fs__ioctl_get_stats_input_t input = {0};
   svn_fs_fs__ioctl_get_stats_output_t *output;
 
+  /* Scan rev / pack files concurrently, if requested. */
+  if (opt_state->jobs > 1)
+    svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_JOBS,
+                  apr_itoa(pool, opt_state->jobs));
+
   printf("Reading revisions\n");
-  SVN_ERR(open_fs(&fs, opt_state->repository_path, pool));
+  SVN_ERR(open_fs(&fs, opt_state->repository_path, fs_config, pool));
 
   input.progress_func = print_progress;
   SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_GET_STATS, &input, (void **)&output,
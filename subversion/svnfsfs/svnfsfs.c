@@ -76,7 +76,9 @@ check_lib_versions(void)
 
 enum svnfsfs__cmdline_options_t
   {
-    svnfsfs__version = SVN_OPT_FIRST_LONGOPT_ID
+    svnfsfs__version = SVN_OPT_FIRST_LONGOPT_ID,
+    svnfsfs__jobs,
+    svnfsfs__block_read
   };
 
 /* Option codes and descriptions.
@@ -104,6 +106,14 @@ static const apr_getopt_option_t options_table[] =
      N_("size of the extra in-memory cache in MB used to\n"
         "                             minimize redundant operations. Default: 16.")},
 
+    {"jobs",          svnfsfs__jobs, 1,
+     N_("use up to ARG threads to process independent parts\n"
+        "                             of the repository concurrently")},
+
+    {"block-read",    svnfsfs__block_read, 0,
+     N_("read and cache whole blocks of rev / pack files\n"
+        "                             (FSFS format 7+ only)")},
+
     {NULL}
   };
 
@@ -167,7 +177,18 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "\n"), N_(
     "Write object size statistics to console.\n"
    )},
-   {'M'} },
+   {'M', svnfsfs__jobs} },
+
+  {"replay-trace", subcommand__replay_trace, {0}, {N_(
+    "usage: svnfsfs replay-trace REPOS_PATH TRACE_FILE\n"
+    "\n"), N_(
+    "Re-execute all item accesses recorded in TRACE_FILE against the repository\n"
+    "and compare cache hits, bytes read and time spent per item type with the\n"
+    "recorded values.  Traces get recorded when FSFS is configured with the\n"
+    "'fsfs-access-trace' option.  Use -M and --block-read to evaluate the effect\n"
+    "of different cache sizes and block-read settings.\n"
+   )},
+   {'M', svnfsfs__block_read} },
 
   { NULL, NULL, {0}, {NULL}, {0} }
 };
@@ -176,6 +197,7 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
 svn_error_t *
 open_fs(svn_fs_t **fs,
         const char *path,
+        apr_hash_t *fs_config,
         apr_pool_t *pool)
 {
   const char *fs_type;
@@ -189,7 +211,7 @@ open_fs(svn_fs_t **fs,
                              fs_type);
 
   /* Now open it. */
-  SVN_ERR(svn_fs_open2(fs, path, NULL, pool, pool));
+  SVN_ERR(svn_fs_open2(fs, path, fs_config, pool, pool));
   svn_fs_set_warning_func(*fs, warning_func, NULL);
 
   return SVN_NO_ERROR;
@@ -259,6 +281,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
   opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.jobs = 1;
 
   /* Parse options. */
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -320,6 +343,16 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           opt_state.memory_cache_size = 0x100000 * sz_val;
         }
         break;
+      case svnfsfs__jobs:
+        SVN_ERR(svn_cstring_atoi(&opt_state.jobs, opt_arg));
+        if (opt_state.jobs < 1)
+          return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                   _("Invalid number of jobs '%s'"),
+                                   opt_arg);
+        break;
+      case svnfsfs__block_read:
+        opt_state.block_read = TRUE;
+        break;
       case svnfsfs__version:
         opt_state.version = TRUE;
         break;
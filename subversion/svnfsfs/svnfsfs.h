@@ -45,6 +45,8 @@ typedef struct svnfsfs__opt_state
   svn_boolean_t version;                            /* --version */
   svn_boolean_t quiet;                              /* --quiet */
   apr_uint64_t memory_cache_size;                   /* --memory-cache-size M */
+  int jobs;                                         /* --jobs */
+  svn_boolean_t block_read;                         /* --block-read */
 } svnfsfs__opt_state;
 
 /* Declare all the command procedures */
@@ -52,14 +54,17 @@ svn_opt_subcommand_t
   subcommand__help,
   subcommand__dump_index,
   subcommand__load_index,
-  subcommand__stats;
+  subcommand__stats,
+  subcommand__replay_trace;
 
 
-/* Check that the filesystem at PATH is an FSFS repository and then open it.
- * Return the filesystem in *FS, allocated in POOL. */
+/* Check that the filesystem at PATH is an FSFS repository and then open it
+ * using the optional FS_CONFIG.  Return the filesystem in *FS, allocated
+ * in POOL. */
 svn_error_t *
 open_fs(svn_fs_t **fs,
         const char *path,
+        apr_hash_t *fs_config,
         apr_pool_t *pool);
 
 /* Our cancellation callback. */
@@ -35,12 +35,17 @@
 #include "svn_private_config.h"
 #include "svn_string.h"
 #include "svn_props.h"
+#include "svn_sorts.h"
 
 #include "svnrdump.h"
 
 #include "private/svn_repos_private.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_ra_private.h"
+#include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
+#include "private/svn_task.h"
+#include "private/svn_atomic.h"
 
 
 
@@ -67,7 +72,9 @@ enum svn_svnrdump__longopt_t
     opt_incremental,
     opt_trust_server_cert,
     opt_trust_server_cert_failures,
-    opt_version
+    opt_version,
+    opt_compress,
+    opt_jobs
   };
 
 #define SVN_SVNRDUMP__BASE_OPTIONS opt_config_dir, \
@@ -89,15 +96,20 @@ static const svn_opt_subcommand_desc3_t svnrdump__cmd_table[] =
        "Dump revisions LOWER to UPPER of repository at remote URL to stdout\n"
        "in a 'dumpfile' portable format.  If only LOWER is given, dump that\n"
        "one revision.\n"
+       "\n"), N_(
+       "With --jobs, revisions get replayed in chunks over multiple\n"
+       "concurrent sessions and then written in order.\n"
     )},
-    { 'r', 'q', opt_incremental, 'F', SVN_SVNRDUMP__BASE_OPTIONS },
+    { 'r', 'q', opt_incremental, 'F', opt_compress, opt_jobs,
+      SVN_SVNRDUMP__BASE_OPTIONS },
     {{'F', N_("write to file ARG instead of stdout")}} },
   { "load", load_cmd, { 0 }, {N_(
        "usage: svnrdump load URL\n"
        "\n"), N_(
        "Load a 'dumpfile' given on stdin to a repository at remote URL.\n"
+       "Block-compressed dumpfiles are decompressed automatically.\n"
     )},
-    { 'q', opt_skip_revprop, 'F', SVN_SVNRDUMP__BASE_OPTIONS },
+    { 'q', opt_skip_revprop, 'F', opt_jobs, SVN_SVNRDUMP__BASE_OPTIONS },
     {{'F', N_("read from file ARG instead of stdin")}} },
   { "help", 0, { "?", "h" }, {N_(
        "usage: svnrdump help [SUBCOMMAND...]\n"
@@ -168,6 +180,16 @@ static const apr_getopt_option_t svnrdump__options[] =
                        "separately classified certificate errors).")},
     {"file",          'F', 1,
                       N_("read/write file ARG instead of stdin/stdout")},
+    {"compress",      opt_compress, 1,
+                      N_("block-compress the dump stream using method ARG\n"
+                         "                             "
+                         "('zlib' or 'lz4')")},
+    {"jobs",          opt_jobs, 1,
+                      N_("use up to ARG threads to compress or decompress\n"
+                         "                             "
+                         "the dump stream; when dumping, also replay\n"
+                         "                             "
+                         "revisions over ARG concurrent sessions")},
     {0, 0, 0, 0}
   };
 
@@ -179,10 +201,30 @@ struct replay_baton {
   /* The output stream */
   svn_stream_t *stdout_stream;
 
+  /* When replaying into a spill buffer, the buffer behind STDOUT_STREAM
+     and the offsets (svn_filesize_t) at which the revisions start in it.
+     NULL otherwise. */
+  svn_spillbuf_t *buffer;
+  apr_array_header_t *offsets;
+
   /* Whether to be quiet. */
   svn_boolean_t quiet;
 };
 
+/* Command line options needed to create an authentication baton. */
+typedef struct auth_opts_t {
+  svn_boolean_t non_interactive;
+  const char *username;
+  const char *password;
+  const char *config_dir;
+  svn_boolean_t no_auth_cache;
+  svn_boolean_t trust_unknown_ca;
+  svn_boolean_t trust_cn_mismatch;
+  svn_boolean_t trust_expired;
+  svn_boolean_t trust_not_yet_valid;
+  svn_boolean_t trust_other_failure;
+} auth_opts_t;
+
 /* Option set */
 typedef struct opt_baton_t {
   svn_client_ctx_t *ctx;
@@ -196,8 +238,25 @@ typedef struct opt_baton_t {
   svn_boolean_t quiet;
   svn_boolean_t incremental;
   apr_hash_t *skip_revprops;
+  int compression;
+  int jobs;
+  auth_opts_t auth_opts;
 } opt_baton_t;
 
+/* Tell RB that the next revision starts here.  Unless we replay into a
+ * spill buffer, start a new compression block, if applicable. */
+static svn_error_t *
+mark_revision_start(struct replay_baton *rb)
+{
+  if (rb->offsets)
+    APR_ARRAY_PUSH(rb->offsets, svn_filesize_t)
+      = svn_spillbuf__get_size(rb->buffer);
+  else
+    SVN_ERR(svn_stream__block_boundary(rb->stdout_stream));
+
+  return SVN_NO_ERROR;
+}
+
 /* Print dumpstream-formatted information about REVISION.
  * Implements the `svn_ra_replay_revstart_callback_t' interface.
  */
@@ -212,6 +271,9 @@ replay_revstart(svn_revnum_t revision,
   struct replay_baton *rb = replay_baton;
   apr_hash_t *normal_props;
 
+  /* Start a new compression block, if applicable. */
+  SVN_ERR(mark_revision_start(rb));
+
   /* Normalize and dump the revprops */
   SVN_ERR(svn_rdump__normalize_props(&normal_props, rev_props, pool));
   SVN_ERR(svn_repos__dump_revision_record(rb->stdout_stream, revision, NULL,
@@ -261,6 +323,9 @@ replay_revstart_v2(svn_revnum_t revision,
   struct replay_baton *rb = replay_baton;
   apr_hash_t *normal_props;
 
+  /* Start a new compression block, if applicable. */
+  SVN_ERR(mark_revision_start(rb));
+
   /* Normalize and dump the revprops */
   SVN_ERR(svn_rdump__normalize_props(&normal_props, rev_props, pool));
   SVN_ERR(svn_repos__dump_revision_record(rb->stdout_stream, revision,
@@ -297,31 +362,50 @@ replay_revend_v2(svn_revnum_t revision,
 }
 #endif
 
+/* Set *AUTH_BATON to a new authentication baton for the command line
+ * options AUTH_OPTS, allocated from POOL.  Use CFG_CONFIG and the
+ * cancellation function of CTX.
+ */
+static svn_error_t *
+create_auth_baton(svn_auth_baton_t **auth_baton,
+                  const auth_opts_t *auth_opts,
+                  svn_config_t *cfg_config,
+                  svn_client_ctx_t *ctx,
+                  apr_pool_t *pool)
+{
+  return svn_error_trace(svn_cmdline_create_auth_baton2(
+                           auth_baton,
+                           auth_opts->non_interactive,
+                           auth_opts->username,
+                           auth_opts->password,
+                           auth_opts->config_dir,
+                           auth_opts->no_auth_cache,
+                           auth_opts->trust_unknown_ca,
+                           auth_opts->trust_cn_mismatch,
+                           auth_opts->trust_expired,
+                           auth_opts->trust_not_yet_valid,
+                           auth_opts->trust_other_failure,
+                           cfg_config, ctx->cancel_func,
+                           ctx->cancel_baton, pool));
+}
+
 /* Initialize the RA layer, and set *CTX to a new client context baton
- * allocated from POOL.  Use CONFIG_DIR and pass USERNAME, PASSWORD,
- * CONFIG_DIR and NO_AUTH_CACHE to initialize the authorization baton.
+ * allocated from POOL.  Use the CONFIG_DIR in AUTH_OPTS and pass all of
+ * AUTH_OPTS to initialize the authorization baton.
  * CONFIG_OPTIONS (if not NULL) is a list of configuration overrides.
  * REPOS_URL is used to fiddle with server-specific configuration
  * options.
  */
 static svn_error_t *
 init_client_context(svn_client_ctx_t **ctx_p,
-                    svn_boolean_t non_interactive,
-                    const char *username,
-                    const char *password,
-                    const char *config_dir,
+                    const auth_opts_t *auth_opts,
                     const char *repos_url,
-                    svn_boolean_t no_auth_cache,
-                    svn_boolean_t trust_unknown_ca,
-                    svn_boolean_t trust_cn_mismatch,
-                    svn_boolean_t trust_expired,
-                    svn_boolean_t trust_not_yet_valid,
-                    svn_boolean_t trust_other_failure,
                     apr_array_header_t *config_options,
                     apr_pool_t *pool)
 {
   svn_client_ctx_t *ctx = NULL;
   svn_config_t *cfg_config, *cfg_servers;
+  const char *config_dir = auth_opts->config_dir;
 
   SVN_ERR(svn_ra_initialize(pool));
 
@@ -380,14 +464,8 @@ init_client_context(svn_client_ctx_t **ctx_p,
   ctx->cancel_func = check_cancel;
 
   /* Default authentication providers for non-interactive use */
-  SVN_ERR(svn_cmdline_create_auth_baton2(&(ctx->auth_baton), non_interactive,
-                                         username, password, config_dir,
-                                         no_auth_cache, trust_unknown_ca,
-                                         trust_cn_mismatch, trust_expired,
-                                         trust_not_yet_valid,
-                                         trust_other_failure,
-                                         cfg_config, ctx->cancel_func,
-                                         ctx->cancel_baton, pool));
+  SVN_ERR(create_auth_baton(&ctx->auth_baton, auth_opts, cfg_config, ctx,
+                            pool));
   *ctx_p = ctx;
   return SVN_NO_ERROR;
 }
@@ -404,6 +482,7 @@ dump_revision_header(svn_ra_session_t *session,
 {
   apr_hash_t *prophash;
 
+  SVN_ERR(svn_stream__block_boundary(stdout_stream));
   SVN_ERR(svn_ra_rev_proplist(session, revision, &prophash, pool));
   SVN_ERR(svn_repos__dump_revision_record(stdout_stream, revision, NULL,
                                           prophash,
@@ -465,20 +544,322 @@ dump_initial_full_revision(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
+/* Number of revisions that a single task in replay_concurrently() replays
+ * in one go. */
+#define REPLAY_CHUNK_SIZE 16
+
+/* Keep up to this many bytes of replayed dump data per task in memory
+ * before spilling the remainder to a temporary file. */
+#define REPLAY_BUFFER_SIZE 0x100000
+
+/* The pair of RA sessions used by one thread in replay_concurrently(). */
+typedef struct replay_sessions_t
+{
+  /* Session to replay the revisions with. */
+  svn_ra_session_t *session;
+
+  /* Backdoor session for the dump editor, rooted at the repository root. */
+  svn_ra_session_t *extra_ra_session;
+} replay_sessions_t;
+
+/* Replay result of a single chunk of revisions. */
+typedef struct replay_chunk_t
+{
+  /* The dump data of the revisions in this chunk. */
+  svn_spillbuf_t *buffer;
+
+  /* Offsets (svn_filesize_t) of the revision records in BUFFER. */
+  apr_array_header_t *offsets;
+
+  /* The revisions in this chunk. */
+  svn_revnum_t start_revision;
+  svn_revnum_t end_revision;
+} replay_chunk_t;
+
+/* Baton type used with svn_task__run() by replay_concurrently(). */
+typedef struct replay_chunks_baton_t
+{
+  /* Session pairs, one per thread. */
+  replay_sessions_t *sessions;
+
+  /* Index of the next unused entry in SESSIONS. */
+  volatile svn_atomic_t next_session;
+
+  /* Revision range to replay and number of revisions per chunk. */
+  svn_revnum_t start_revision;
+  svn_revnum_t end_revision;
+  svn_revnum_t chunk_size;
+
+  /* Where to write the dump data to. */
+  svn_stream_t *output_stream;
+
+  /* Whether to be quiet. */
+  svn_boolean_t quiet;
+} replay_chunks_baton_t;
+
+/* Implements svn_task__thread_context_constructor_t.
+ * Hand out the next unused session pair of the replay_chunks_baton_t. */
+static svn_error_t *
+claim_sessions(void **thread_context,
+               void *baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  replay_chunks_baton_t *chunks_baton = baton;
+
+  *thread_context
+    = &chunks_baton->sessions[svn_atomic_inc(&chunks_baton->next_session)];
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+ * Replay chunk number INDEX into a spill buffer and return it as a
+ * replay_chunk_t. */
+static svn_error_t *
+replay_chunk(void **result,
+             void *thread_context,
+             void *process_baton,
+             apr_int64_t index,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  replay_chunks_baton_t *chunks_baton = process_baton;
+  replay_sessions_t *sessions = thread_context;
+  replay_chunk_t *chunk = apr_pcalloc(result_pool, sizeof(*chunk));
+  struct replay_baton *replay_baton;
+
+  chunk->start_revision = chunks_baton->start_revision
+                        + (svn_revnum_t)index * chunks_baton->chunk_size;
+  chunk->end_revision = MIN(chunk->start_revision
+                              + chunks_baton->chunk_size - 1,
+                            chunks_baton->end_revision);
+  chunk->buffer = svn_spillbuf__create(SVN__STREAM_CHUNK_SIZE,
+                                       REPLAY_BUFFER_SIZE, result_pool);
+  chunk->offsets = apr_array_make(result_pool, (int)chunks_baton->chunk_size,
+                                  sizeof(svn_filesize_t));
+
+  /* Progress gets reported in revision order by replay_chunk_output(). */
+  replay_baton = apr_pcalloc(scratch_pool, sizeof(*replay_baton));
+  replay_baton->stdout_stream = svn_stream__from_spillbuf(chunk->buffer,
+                                                          scratch_pool);
+  replay_baton->buffer = chunk->buffer;
+  replay_baton->offsets = chunk->offsets;
+  replay_baton->extra_ra_session = sessions->extra_ra_session;
+  replay_baton->quiet = TRUE;
+
+#ifndef USE_EV2_IMPL
+  SVN_ERR(svn_ra_replay_range(sessions->session, chunk->start_revision,
+                              chunk->end_revision, 0, TRUE,
+                              replay_revstart, replay_revend, replay_baton,
+                              scratch_pool));
+#else
+  SVN_ERR(svn_ra__replay_range_ev2(sessions->session, chunk->start_revision,
+                                   chunk->end_revision, 0, TRUE,
+                                   replay_revstart_v2, replay_revend_v2,
+                                   replay_baton, NULL, NULL, NULL, NULL,
+                                   scratch_pool));
+#endif
+
+  *result = chunk;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * Copy the replay_chunk_t RESULT to the output stream, starting a new
+ * compression block with every revision, and report progress. */
+static svn_error_t *
+replay_chunk_output(void *result,
+                    void *output_baton,
+                    apr_int64_t index,
+                    apr_pool_t *scratch_pool)
+{
+  replay_chunks_baton_t *chunks_baton = output_baton;
+  replay_chunk_t *chunk = result;
+  svn_revnum_t revision;
+  svn_filesize_t pos = 0;
+  int next = 0;
+  const char *data;
+
+  while (TRUE)
+    {
+      apr_size_t len;
+
+      SVN_ERR(svn_spillbuf__read(&data, &len, chunk->buffer, scratch_pool));
+      if (data == NULL)
+        break;
+
+      while (len)
+        {
+          apr_size_t part = len;
+
+          if (next < chunk->offsets->nelts)
+            {
+              svn_filesize_t offset = APR_ARRAY_IDX(chunk->offsets, next,
+                                                    svn_filesize_t);
+
+              if (offset == pos)
+                {
+                  SVN_ERR(svn_stream__block_boundary(
+                            chunks_baton->output_stream));
+                  ++next;
+                  continue;
+                }
+
+              if (offset - pos < (svn_filesize_t)len)
+                part = (apr_size_t)(offset - pos);
+            }
+
+          SVN_ERR(svn_stream_write(chunks_baton->output_stream, data,
+                                   &part));
+          data += part;
+          len -= part;
+          pos += part;
+        }
+    }
+
+  if (! chunks_baton->quiet)
+    for (revision = chunk->start_revision;
+         revision <= chunk->end_revision;
+         ++revision)
+      SVN_ERR(svn_cmdline_fprintf(stderr, scratch_pool,
+                                  "* Dumped revision %lu.\n", revision));
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *PAIR_CTX to a new client context for a session pair in
+ * replay_concurrently(), allocated in POOL.  Give it its own copy of the
+ * configuration of CTX and its own authentication baton for AUTH_OPTS,
+ * so that no state is shared with any other thread.
+ */
+static svn_error_t *
+create_pair_context(svn_client_ctx_t **pair_ctx,
+                    svn_client_ctx_t *ctx,
+                    const auth_opts_t *auth_opts,
+                    apr_pool_t *pool)
+{
+  apr_hash_t *config;
+  svn_client_ctx_t *new_ctx;
+
+  SVN_ERR(svn_config_copy_config(&config, ctx->config, pool));
+  SVN_ERR(svn_client_create_context2(&new_ctx, config, pool));
+  new_ctx->cancel_func = ctx->cancel_func;
+  new_ctx->cancel_baton = ctx->cancel_baton;
+  SVN_ERR(create_auth_baton(&new_ctx->auth_baton, auth_opts,
+                            svn_hash_gets(config,
+                                          SVN_CONFIG_CATEGORY_CONFIG),
+                            new_ctx, pool));
+
+  *pair_ctx = new_ctx;
+
+  return SVN_NO_ERROR;
+}
+
+/* Replay revisions START_REVISION thru END_REVISION (inclusive) of the
+ * repository URL at which SESSION is rooted to OUTPUT_STREAM, like
+ * svn_ra_replay_range() with our replay callbacks would.  Open up to JOBS
+ * pairs of RA sessions and replay disjoint chunks of revisions over them
+ * concurrently.  Every pair gets its own client context based on CTX and
+ * AUTH_OPTS.  The dump data of each chunk gets buffered and written in
+ * revision order.  If QUIET is set, don't generate progress messages.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+replay_concurrently(svn_ra_session_t *session,
+                    svn_client_ctx_t *ctx,
+                    const auth_opts_t *auth_opts,
+                    svn_stream_t *output_stream,
+                    svn_revnum_t start_revision,
+                    svn_revnum_t end_revision,
+                    svn_boolean_t quiet,
+                    int jobs,
+                    apr_pool_t *scratch_pool)
+{
+  replay_chunks_baton_t baton = { 0 };
+  svn_revnum_t count = end_revision - start_revision + 1;
+  apr_pool_t **session_pools;
+  const char *session_url, *repos_root;
+  apr_int64_t chunks;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  baton.start_revision = start_revision;
+  baton.end_revision = end_revision;
+  baton.output_stream = output_stream;
+  baton.quiet = quiet;
+
+  /* Give every thread a few chunks to keep all sessions busy. */
+  baton.chunk_size = MAX(1, MIN(REPLAY_CHUNK_SIZE, count / jobs));
+  chunks = (count + baton.chunk_size - 1) / baton.chunk_size;
+  jobs = (int)MIN(jobs, chunks);
+
+  /* Open all sessions up-front, so that authentication happens here in
+   * the main thread.  Every pair lives in its own root pool and has its
+   * own client context because it will be used by a single worker thread
+   * only.  Should a session need to authenticate again later, it must
+   * not prompt from a worker thread. */
+  SVN_ERR(svn_ra_get_session_url(session, &session_url, scratch_pool));
+  SVN_ERR(svn_ra_get_repos_root2(session, &repos_root, scratch_pool));
+
+  baton.sessions = apr_pcalloc(scratch_pool,
+                               jobs * sizeof(*baton.sessions));
+  session_pools = apr_pcalloc(scratch_pool, jobs * sizeof(*session_pools));
+  for (i = 0; i < jobs && !err; ++i)
+    {
+      svn_client_ctx_t *pair_ctx;
+
+      session_pools[i] = svn_pool_create(NULL);
+      err = create_pair_context(&pair_ctx, ctx, auth_opts,
+                                session_pools[i]);
+      if (!err)
+        err = svn_client_open_ra_session2(&baton.sessions[i].session,
+                                          session_url, NULL, pair_ctx,
+                                          session_pools[i], scratch_pool);
+      if (!err)
+        err = svn_client_open_ra_session2(
+                &baton.sessions[i].extra_ra_session, repos_root, NULL,
+                pair_ctx, session_pools[i], scratch_pool);
+      if (!err)
+        svn_auth_set_parameter(pair_ctx->auth_baton,
+                               SVN_AUTH_PARAM_NON_INTERACTIVE, "");
+    }
+
+  if (!err)
+    err = svn_task__run(jobs, chunks, claim_sessions, &baton,
+                        replay_chunk, &baton, replay_chunk_output, &baton,
+                        check_cancel, NULL, scratch_pool);
+
+  for (i = 0; i < jobs && session_pools[i]; ++i)
+    svn_pool_destroy(session_pools[i]);
+
+  return svn_error_trace(err);
+}
+
 /* Replay revisions START_REVISION thru END_REVISION (inclusive) of
  * the repository URL at which SESSION is rooted, using callbacks
  * which generate Subversion repository dumpstreams describing the
  * changes made in those revisions.  If QUIET is set, don't generate
- * progress messages.
+ * progress messages.  If COMPRESSION is not 0, block-compress the output
+ * with that method.  Use up to JOBS threads to compress and, if JOBS > 1,
+ * to replay revisions over multiple RA sessions opened with client
+ * contexts based on CTX and AUTH_OPTS.
  */
 static svn_error_t *
 replay_revisions(svn_ra_session_t *session,
                  svn_ra_session_t *extra_ra_session,
+                 svn_client_ctx_t *ctx,
+                 const auth_opts_t *auth_opts,
                  svn_revnum_t start_revision,
                  svn_revnum_t end_revision,
                  svn_boolean_t quiet,
                  svn_boolean_t incremental,
                  const char *dumpfile,
+                 int compression,
+                 int jobs,
                  apr_pool_t *pool)
 {
   struct replay_baton *replay_baton;
@@ -494,6 +875,10 @@ replay_revisions(svn_ra_session_t *session,
       SVN_ERR(svn_stream_for_stdout(&output_stream, pool));
     }
 
+  if (compression)
+    output_stream = svn_stream__block_compressed(output_stream, compression,
+                                                 jobs, pool);
+
   replay_baton = apr_pcalloc(pool, sizeof(*replay_baton));
   replay_baton->stdout_stream = output_stream;
   replay_baton->extra_ra_session = extra_ra_session;
@@ -534,7 +919,13 @@ replay_revisions(svn_ra_session_t *session,
     }
 
   /* If there are still revisions left to be dumped, do so. */
-  if (start_revision <= end_revision)
+  if (jobs > 1 && start_revision < end_revision)
+    {
+      SVN_ERR(replay_concurrently(session, ctx, auth_opts, output_stream,
+                                  start_revision, end_revision, quiet,
+                                  jobs, pool));
+    }
+  else if (start_revision <= end_revision)
     {
 #ifndef USE_EV2_IMPL
       SVN_ERR(svn_ra_replay_range(session, start_revision, end_revision,
@@ -556,7 +947,8 @@ replay_revisions(svn_ra_session_t *session,
  * of transmitting that information to the repository located at URL
  * (to which SESSION has been opened).  AUX_SESSION is a second RA
  * session opened to the same URL for performing auxiliary out-of-band
- * operations.
+ * operations.  Block-compressed dumpstreams get decompressed using up
+ * to JOBS threads.
  */
 static svn_error_t *
 load_revisions(svn_ra_session_t *session,
@@ -564,19 +956,28 @@ load_revisions(svn_ra_session_t *session,
                const char *dumpfile,
                svn_boolean_t quiet,
                apr_hash_t *skip_revprops,
+               int jobs,
                apr_pool_t *pool)
 {
   svn_stream_t *output_stream;
+  svn_boolean_t compressed = TRUE;
 
   if (dumpfile)
     {
       SVN_ERR(svn_stream_open_readonly(&output_stream, dumpfile, pool, pool));
+      SVN_ERR(svn_stream__is_block_compressed(&compressed, output_stream,
+                                              pool));
     }
   else
     {
       SVN_ERR(svn_stream_for_stdin2(&output_stream, TRUE, pool));
     }
 
+  /* Keep mark and seek support for plain dump files. */
+  if (compressed)
+    output_stream = svn_stream__block_decompressed(output_stream, jobs,
+                                                   pool);
+
   SVN_ERR(svn_rdump__load_dumpstream(output_stream, session, aux_session,
                                      quiet, skip_revprops,
                                      check_cancel, NULL, pool));
@@ -645,10 +1046,12 @@ dump_cmd(apr_getopt_t *os,
   SVN_ERR(svn_ra_reparent(extra_ra_session, repos_root, pool));
 
   return replay_revisions(opt_baton->session, extra_ra_session,
+                          opt_baton->ctx, &opt_baton->auth_opts,
                           opt_baton->start_revision.value.number,
                           opt_baton->end_revision.value.number,
                           opt_baton->quiet, opt_baton->incremental,
-                          opt_baton->dumpfile, pool);
+                          opt_baton->dumpfile, opt_baton->compression,
+                          opt_baton->jobs, pool);
 }
 
 /* Handle the "load" subcommand.  Implements `svn_opt_subcommand_t'.  */
@@ -664,7 +1067,7 @@ load_cmd(apr_getopt_t *os,
                                       opt_baton->ctx, pool, pool));
   return load_revisions(opt_baton->session, aux_session,
                         opt_baton->dumpfile, opt_baton->quiet,
-                        opt_baton->skip_revprops, pool);
+                        opt_baton->skip_revprops, opt_baton->jobs, pool);
 }
 
 /* Handle the "help" subcommand.  Implements `svn_opt_subcommand_t'.  */
@@ -813,6 +1216,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   opt_baton->url = NULL;
   opt_baton->skip_revprops = apr_hash_make(pool);
   opt_baton->dumpfile = NULL;
+  opt_baton->jobs = 1;
 
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
 
@@ -933,6 +1337,17 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           SVN_ERR(svn_utf_cstring_to_utf8(&opt_arg, opt_arg, pool));
           opt_baton->dumpfile = opt_arg;
           break;
+        case opt_compress:
+          SVN_ERR(svn_stream__parse_block_compression(&opt_baton->compression,
+                                                      opt_arg));
+          break;
+        case opt_jobs:
+          SVN_ERR(svn_cstring_atoi(&opt_baton->jobs, opt_arg));
+          if (opt_baton->jobs < 1)
+            return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                     _("Invalid number of jobs '%s'"),
+                                     opt_arg);
+          break;
         }
     }
 
@@ -1109,18 +1524,20 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   non_interactive = !svn_cmdline__be_interactive(non_interactive,
                                                  force_interactive);
 
+  opt_baton->auth_opts.non_interactive = non_interactive;
+  opt_baton->auth_opts.username = username;
+  opt_baton->auth_opts.password = password;
+  opt_baton->auth_opts.config_dir = config_dir;
+  opt_baton->auth_opts.no_auth_cache = no_auth_cache;
+  opt_baton->auth_opts.trust_unknown_ca = trust_unknown_ca;
+  opt_baton->auth_opts.trust_cn_mismatch = trust_cn_mismatch;
+  opt_baton->auth_opts.trust_expired = trust_expired;
+  opt_baton->auth_opts.trust_not_yet_valid = trust_not_yet_valid;
+  opt_baton->auth_opts.trust_other_failure = trust_other_failure;
+
   SVN_ERR(init_client_context(&(opt_baton->ctx),
-                              non_interactive,
-                              username,
-                              password,
-                              config_dir,
+                              &opt_baton->auth_opts,
                               opt_baton->url,
-                              no_auth_cache,
-                              trust_unknown_ca,
-                              trust_cn_mismatch,
-                              trust_expired,
-                              trust_not_yet_valid,
-                              trust_other_failure,
                               config_options,
                               pool));
 
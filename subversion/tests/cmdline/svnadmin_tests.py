@@ -3965,6 +3965,33 @@ def dump_include_copied_directory(sbox):
   svntest.actions.run_and_verify_svn(expected_output, [],
                                      'log', '-v', '-q', sbox2.repo_url)
 
+def load_compressed_with_jobs(sbox):
+  "load block-compressed dump with --jobs"
+
+  sbox.build()
+  for i in range(1, 11):
+    sbox.simple_append('iota', 'Line %d.\n' % i)
+    sbox.simple_propset('prop', 'value %d' % i, 'A/mu')
+    sbox.simple_commit()
+  expected_dump = svntest.actions.run_and_verify_dump(sbox.repo_dir)
+
+  dumpfile = sbox.get_tempname()
+  svntest.actions.run_and_verify_svnadmin2(None, [], 0, 'dump', '-q',
+                                           '--compress', 'lz4',
+                                           '--file', dumpfile,
+                                           sbox.repo_dir)
+
+  # Decompress and parse the input on other threads while committing.
+  sbox2 = sbox.clone_dependent()
+  sbox2.build(create_wc=False, empty=True)
+  svntest.actions.run_and_verify_svnadmin2(None, [], 0, 'load', '-q',
+                                           '--jobs', '4',
+                                           '--file', dumpfile,
+                                           sbox2.repo_dir)
+
+  actual_dump = svntest.actions.run_and_verify_dump(sbox2.repo_dir)
+  svntest.verify.compare_dump_files(None, None, expected_dump, actual_dump)
+
 ########################################################################
 # Run the tests
 
@@ -4043,6 +4070,7 @@ test_list = [ None,
               recover_prunes_rep_cache_when_enabled,
               recover_prunes_rep_cache_when_disabled,
               dump_include_copied_directory,
+              load_compressed_with_jobs,
              ]
 
 if __name__ == '__main__':
@@ -1021,6 +1021,10 @@ def load_invalid_svn_date_revprop_in_r1(sbox):
                                [], expected_err, 1,
                                sbox.repo_url)
 
+def concurrent_dump(sbox):
+  "dump: replay revisions over multiple sessions"
+  run_dump_test(sbox, "with_merges.dump", extra_options=['--jobs', '3'])
+
 ########################################################################
 # Run the tests
 
@@ -1084,6 +1088,7 @@ test_list = [ None,
               load_non_deltas_with_props,
               load_invalid_svn_date_revprop_in_r0,
               load_invalid_svn_date_revprop_in_r1,
+              concurrent_dump,
              ]
 
 if __name__ == '__main__':
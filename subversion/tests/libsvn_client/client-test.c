@@ -26,9 +26,11 @@
 #define SVN_DEPRECATED
 
 #include <limits.h>
+#include <string.h>
 #include "svn_mergeinfo.h"
 #include "../../libsvn_client/mergeinfo.h"
 #include "../../libsvn_client/client.h"
+#include "../../libsvn_client/blame_tree.h"
 #include "svn_pools.h"
 #include "svn_client.h"
 #include "private/svn_client_private.h"
@@ -1419,6 +1421,133 @@ test_copy_pin_externals_select_subtree(const svn_test_opts_t *opts, apr_pool_t *
   return SVN_NO_ERROR;
 }
 
+/* Baton type used by check_blame_chunk(). */
+typedef struct blame_tree_check_t
+{
+  /* The expected data for each token. */
+  const void **model;
+  apr_off_t model_len;
+
+  /* Position at which the next chunk must start. */
+  apr_off_t next_start;
+
+  /* First error found. */
+  svn_error_t *err;
+} blame_tree_check_t;
+
+/* Implements svn_client__blame_tree_walk_func_t.  Compare the chunk with
+   the model in BATON, a blame_tree_check_t. */
+static void
+check_blame_chunk(void *baton,
+                  const void *data,
+                  apr_off_t start,
+                  apr_off_t length)
+{
+  blame_tree_check_t *check = baton;
+  apr_off_t i;
+
+  if (check->err)
+    return;
+
+  if (   start != check->next_start
+      || length <= 0
+      || length > check->model_len - start)
+    {
+      check->err = svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                     "Unexpected chunk at %" APR_OFF_T_FMT
+                                     " with %" APR_OFF_T_FMT " tokens",
+                                     start, length);
+      return;
+    }
+
+  for (i = start; i < start + length; ++i)
+    if (check->model[i] != data)
+      {
+        check->err = svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                       "Wrong data for token %" APR_OFF_T_FMT,
+                                       i);
+        return;
+      }
+
+  check->next_start = start + length;
+}
+
+/* Verify that TREE matches the MODEL_LEN tokens in MODEL. */
+static svn_error_t *
+check_blame_tree(svn_client__blame_tree_t *tree,
+                 const void **model,
+                 apr_off_t model_len)
+{
+  blame_tree_check_t check;
+
+  check.model = model;
+  check.model_len = model_len;
+  check.next_start = 0;
+  check.err = SVN_NO_ERROR;
+
+  svn_client__blame_tree_walk(tree, check_blame_chunk, &check);
+  SVN_ERR(check.err);
+  SVN_TEST_ASSERT(check.next_start == model_len);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_blame_tree(apr_pool_t *pool)
+{
+  enum { OPERATIONS = 2000, MAX_TOKENS = 1000, MAX_RANGE = 20 };
+
+  svn_client__blame_tree_t *tree = svn_client__blame_tree_create(pool);
+  const void **model = apr_palloc(pool, MAX_TOKENS * sizeof(*model));
+  char *labels = apr_palloc(pool, OPERATIONS);
+  apr_off_t model_len = 0;
+  apr_uint32_t seed = 0x12345678;
+  int i;
+
+  SVN_ERR(check_blame_tree(tree, model, model_len));
+
+  /* Apply random insertions and deletions to both, the tree and a plain
+     array of per-token data, and compare them after each step. */
+  for (i = 0; i < OPERATIONS; ++i)
+    {
+      apr_off_t start = svn_test_rand(&seed) % (model_len + 1);
+      apr_off_t length = 1 + svn_test_rand(&seed) % MAX_RANGE;
+
+      if (   model_len + length <= MAX_TOKENS
+          && (model_len == 0 || svn_test_rand(&seed) % 2))
+        {
+          apr_off_t k;
+
+          svn_client__blame_tree_insert(tree, &labels[i], start, length);
+
+          memmove(model + start + length, model + start,
+                  (model_len - start) * sizeof(*model));
+          for (k = start; k < start + length; ++k)
+            model[k] = &labels[i];
+          model_len += length;
+        }
+      else
+        {
+          svn_client__blame_tree_delete(tree, start, length);
+
+          /* Deleting beyond the end simply truncates. */
+          if (length > model_len - start)
+            length = model_len - start;
+          memmove(model + start, model + start + length,
+                  (model_len - start - length) * sizeof(*model));
+          model_len -= length;
+        }
+
+      SVN_ERR(check_blame_tree(tree, model, model_len));
+    }
+
+  /* Remove everything. */
+  svn_client__blame_tree_delete(tree, 0, model_len);
+  SVN_ERR(check_blame_tree(tree, model, 0));
+
+  return SVN_NO_ERROR;
+}
+
 /* ========================================================================== */
 
 
@@ -1447,6 +1576,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test svn_client_copy7 with externals_to_pin"),
     SVN_TEST_OPTS_PASS(test_copy_pin_externals_select_subtree,
                        "pin externals on selected subtrees only"),
+    SVN_TEST_PASS2(test_blame_tree,
+                   "test svn_client__blame_tree_t"),
     SVN_TEST_NULL
   };
 
@@ -34,9 +34,15 @@
 #include "../svn_test.h"
 
 #include "svn_delta.h"
+#include "svn_string.h"
 #include "svn_pools.h"
 #include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_sorts.h"
 
+#include "private/svn_delta_private.h"
+#include "private/svn_sorts_private.h"
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
 
@@ -330,7 +336,7 @@ do_random_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 4,
                               i % 10, delta_pool);
 
       /* Make stage 1: create the text delta.  */
@@ -426,7 +432,7 @@ do_random_combine_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 4,
                               i % 10, delta_pool);
 
       /* Make stage 1: create the text deltas.  */
@@ -569,7 +575,7 @@ do_random_txdelta_to_svndiff_stream_test(apr_pool_t *pool,
                    svn_stream_from_aprfile2(source, TRUE, iterpool),
                    svn_stream_from_aprfile2(target, TRUE, iterpool),
                    FALSE, iterpool);
-      delta_stream = svn_txdelta_to_svndiff_stream(txstream, i % 3, i % 10,
+      delta_stream = svn_txdelta_to_svndiff_stream(txstream, i % 4, i % 10,
                                                    iterpool);
 
       /* Apply it to a copy of the source file to see if we get the
@@ -605,6 +611,431 @@ random_txdelta_to_svndiff_stream_test(apr_pool_t *pool)
   return err;
 }
 
+/* Size of the data used by the xdelta large data test. */
+#define LARGE_DATA_SIZE (4 * 1024 * 1024)
+
+/* Return a buffer of LEN pseudo-random bytes, allocated in POOL.
+   Use and update *SEED. */
+static char *
+random_buffer(apr_size_t len,
+              apr_uint32_t *seed,
+              apr_pool_t *pool)
+{
+  char *data = apr_palloc(pool, len);
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    data[i] = (char)svn_test_rand(seed);
+
+  return data;
+}
+
+/* Return a buffer of LEN bytes resembling source code, allocated in POOL.
+   Use and update *SEED. */
+static char *
+text_buffer(apr_size_t len,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  static const char *const words[] =
+    {
+      "if", "(", ")", "{", "}", "return", "svn_error_t", "*", "err", ";",
+      "apr_pool_t", "pool", "SVN_ERR", "NULL", "=", "static", "const",
+      "char", "int", "while", "for", "++", "->", "data", "len", "\n", "\n",
+      "  ", "    ", "/*", "*/", "the", "of", "a", "to", "and"
+    };
+  char *data = apr_palloc(pool, len);
+  apr_size_t i = 0;
+
+  while (i < len)
+    {
+      const char *word = words[svn_test_rand(seed)
+                               % (sizeof(words) / sizeof(words[0]))];
+      for (; *word && i < len; ++word)
+        data[i++] = *word;
+      if (i < len)
+        data[i++] = ' ';
+    }
+
+  return data;
+}
+
+/* Return a copy of SOURCE with size LEN, allocated in POOL, with EDITS
+   random modifications applied to it.  Every modification replaces a
+   random range of the data with random bytes of a different length.
+   Use and update *SEED. */
+static svn_string_t *
+modify_buffer(const char *source,
+              apr_size_t len,
+              int edits,
+              apr_uint32_t *seed,
+              apr_pool_t *pool)
+{
+  svn_stringbuf_t *target = svn_stringbuf_create_ensure(len, pool);
+  apr_size_t pos = 0;
+  int i;
+
+  for (i = 0; i < edits && pos < len; ++i)
+    {
+      apr_size_t keep = svn_test_rand(seed) % (2 * len / edits);
+      apr_size_t remove = svn_test_rand(seed) % 100;
+      apr_size_t insert = svn_test_rand(seed) % 100;
+
+      if (keep > len - pos)
+        keep = len - pos;
+      svn_stringbuf_appendbytes(target, source + pos, keep);
+      pos += keep;
+
+      remove = remove > len - pos ? len - pos : remove;
+      pos += remove;
+
+      svn_stringbuf_appendbytes(target, random_buffer(insert, seed, pool),
+                                insert);
+    }
+
+  svn_stringbuf_appendbytes(target, source + pos, len - pos);
+
+  return svn_string_create_from_buf(target, pool);
+}
+
+/* Return the throughput in MB/s for processing LEN bytes in TIME. */
+static double
+throughput(apr_size_t len,
+           apr_interval_time_t time)
+{
+  return len / (time ? (double)time : 1.0);
+}
+
+/* Deltify TARGET against SOURCE, apply the delta to SOURCE and verify
+   that we get TARGET back.  Return the svndiff encoded delta in *SVNDIFF,
+   the number of bytes of new data in it in *NEW_DATA and the time spent
+   in the delta engine in *DELTA_TIME.  Use POOL for allocations. */
+static svn_error_t *
+run_large_delta(svn_stringbuf_t **svndiff,
+                apr_size_t *new_data,
+                apr_interval_time_t *delta_time,
+                const svn_string_t *source,
+                const svn_string_t *target,
+                apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *txdelta_stream;
+  svn_txdelta_window_handler_t apply_handler, encode_handler;
+  void *apply_baton, *encode_baton;
+  svn_stringbuf_t *regenerated = svn_stringbuf_create_empty(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_txdelta_window_t *window;
+
+  *svndiff = svn_stringbuf_create_empty(pool);
+  *new_data = 0;
+  *delta_time = 0;
+
+  svn_txdelta_apply(svn_stream_from_string(source, pool),
+                    svn_stream_from_stringbuf(regenerated, pool),
+                    NULL, NULL, pool, &apply_handler, &apply_baton);
+  svn_txdelta_to_svndiff3(&encode_handler, &encode_baton,
+                          svn_stream_from_stringbuf(*svndiff, pool),
+                          0, SVN_DELTA_COMPRESSION_LEVEL_NONE, pool);
+  svn_txdelta2(&txdelta_stream,
+               svn_stream_from_string(source, pool),
+               svn_stream_from_string(target, pool),
+               FALSE, pool);
+
+  do
+    {
+      apr_time_t start;
+
+      svn_pool_clear(iterpool);
+
+      start = apr_time_now();
+      SVN_ERR(svn_txdelta_next_window(&window, txdelta_stream, iterpool));
+      *delta_time += apr_time_now() - start;
+
+      if (window && window->new_data)
+        *new_data += window->new_data->len;
+
+      SVN_ERR(apply_handler(window, apply_baton));
+      SVN_ERR(encode_handler(window, encode_baton));
+    }
+  while (window);
+
+  svn_pool_destroy(iterpool);
+
+  SVN_TEST_ASSERT(svn_string_compare_stringbuf(target, regenerated));
+
+  return SVN_NO_ERROR;
+}
+
+/* Deltify TARGET against SOURCE once with byte-wise and once with
+   word-wise match extension.  Verify that both round-trip and produce
+   identical deltas.  If MAX_NEW_DATA is not 0, verify that the delta
+   contains no more than that many bytes of new data, i.e. that matches
+   have been found and fully extended.  If VERBOSE is set, print the delta
+   size and the throughput of both variants using NAME as a label; that is
+   for information only and not compared against anything.  Use POOL for
+   allocations. */
+static svn_error_t *
+check_large_delta(const char *name,
+                  const svn_string_t *source,
+                  const svn_string_t *target,
+                  apr_size_t max_new_data,
+                  svn_boolean_t verbose,
+                  apr_pool_t *pool)
+{
+  svn_stringbuf_t *bytewise_svndiff, *wordwise_svndiff;
+  apr_interval_time_t bytewise_time, wordwise_time;
+  apr_size_t new_data;
+  svn_error_t *err;
+
+  svn_txdelta__xdelta_set_word_matching(FALSE);
+  err = run_large_delta(&bytewise_svndiff, &new_data, &bytewise_time,
+                        source, target, pool);
+  svn_txdelta__xdelta_set_word_matching(TRUE);
+  SVN_ERR(err);
+
+  SVN_ERR(run_large_delta(&wordwise_svndiff, &new_data, &wordwise_time,
+                          source, target, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(bytewise_svndiff,
+                                        wordwise_svndiff));
+
+  if (verbose)
+    printf("%-24s %9" APR_SIZE_T_FMT " bytes new data, "
+           "%8.1f MB/s byte-wise, %8.1f MB/s word-wise\n",
+           name, new_data,
+           throughput(target->len, bytewise_time),
+           throughput(target->len, wordwise_time));
+
+  if (max_new_data && new_data > max_new_data)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "%s: delta has %" APR_SIZE_T_FMT " bytes of "
+                             "new data, expected at most %" APR_SIZE_T_FMT,
+                             name, new_data, max_new_data);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *TEXT to the concatenated C sources of libsvn_delta and libsvn_subr,
+   up to LEN bytes, in a stable order.  Find them relative to the test's
+   source directory given in OPTS.  Set *TEXT to NULL if they are not
+   available.  Allocate *TEXT in POOL. */
+static svn_error_t *
+read_source_files(svn_stringbuf_t **text,
+                  apr_size_t len,
+                  const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  static const char *const dirs[] = { "libsvn_delta", "libsvn_subr" };
+  const char *srcdir;
+  apr_size_t i;
+  int k;
+
+  SVN_ERR(svn_test_get_srcdir(&srcdir, opts, pool));
+  *text = svn_stringbuf_create_ensure(len, pool);
+
+  for (i = 0; i < sizeof(dirs) / sizeof(dirs[0]); ++i)
+    {
+      const char *dir = svn_dirent_join_many(pool, srcdir, "..", "..",
+                                             dirs[i], SVN_VA_NULL);
+      apr_hash_t *dirents;
+      apr_array_header_t *names;
+      svn_error_t *err;
+
+      err = svn_io_get_dirents3(&dirents, dir, TRUE, pool, pool);
+      if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+        {
+          svn_error_clear(err);
+          *text = NULL;
+          return SVN_NO_ERROR;
+        }
+      SVN_ERR(err);
+
+      names = svn_sort__hash(dirents, svn_sort_compare_items_lexically,
+                             pool);
+      for (k = 0; k < names->nelts && (*text)->len < len; ++k)
+        {
+          const char *name = APR_ARRAY_IDX(names, k, svn_sort__item_t).key;
+          apr_size_t name_len = strlen(name);
+          svn_stringbuf_t *contents;
+
+          if (name_len < 2 || strcmp(name + name_len - 2, ".c") != 0)
+            continue;
+
+          SVN_ERR(svn_stringbuf_from_file2(&contents,
+                                           svn_dirent_join(dir, name, pool),
+                                           pool));
+          svn_stringbuf_appendbytes(*text, contents->data,
+                                    MIN(contents->len, len - (*text)->len));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_test_driver2_t.  Run the xdelta engine over larger
+   amounts of random, synthetic and real-world data, using byte-wise as
+   well as word-wise match extension.  Check that it round-trips, finds
+   the expected matches and that both variants produce the same deltas.
+   This does not detect performance regressions; the throughput shown in
+   verbose mode is merely informational. */
+static svn_error_t *
+xdelta_large_data_test(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  apr_uint32_t seed = 42;
+  apr_size_t len = LARGE_DATA_SIZE;
+  const char *data;
+  svn_string_t source;
+  svn_stringbuf_t *sources;
+
+  /* Binary data with a few and with many small changes. */
+  source.data = data = random_buffer(len, &seed, pool);
+  source.len = len;
+  /* Every edit inserts less than 100 bytes.  Allow for some slack at
+     window boundaries on top of that. */
+  SVN_ERR(check_large_delta("random, similar",
+                            &source,
+                            modify_buffer(data, len, 10, &seed, pool),
+                            len / 64, opts->verbose, pool));
+  SVN_ERR(check_large_delta("random, many changes",
+                            &source,
+                            modify_buffer(data, len, 10000, &seed, pool),
+                            len / 4, opts->verbose, pool));
+
+  /* Completely unrelated binary data. */
+  SVN_ERR(check_large_delta("random, unrelated",
+                            &source,
+                            svn_string_ncreate(random_buffer(len, &seed,
+                                                             pool),
+                                               len, pool),
+                            0, opts->verbose, pool));
+
+  /* Text with lots of repetitions. */
+  source.data = data = text_buffer(len, &seed, pool);
+  SVN_ERR(check_large_delta("text, similar",
+                            &source,
+                            modify_buffer(data, len, 1000, &seed, pool),
+                            len / 16, opts->verbose, pool));
+
+  /* Real-world text: our own sources.  There should be plenty of them,
+     unless we can't find them at all. */
+  SVN_ERR(read_source_files(&sources, len, opts, pool));
+  if (sources && sources->len >= len / 4)
+    {
+      source.data = data = sources->data;
+      source.len = sources->len;
+      SVN_ERR(check_large_delta("sources, similar",
+                                &source,
+                                modify_buffer(data, source.len, 1000,
+                                              &seed, pool),
+                                source.len / 16, opts->verbose, pool));
+    }
+  else if (opts->verbose)
+    printf("sources not found, skipping real-world data\n");
+
+  return SVN_NO_ERROR;
+}
+
+/* Size of the data used by the svndiff3 large window test. */
+#define LARGE_WINDOW_DATA_SIZE (2 * 1024 * 1024)
+
+/* Deltify TARGET against SOURCE using WINDOW_SIZE windows and encode the
+   result in svndiff VERSION.  Return the encoded delta in *ENCODED after
+   verifying that it can be decoded and applied to SOURCE to get TARGET.
+   Use POOL for allocations. */
+static svn_error_t *
+svndiff_round_trip(svn_stringbuf_t **encoded,
+                   const svn_string_t *source,
+                   const svn_string_t *target,
+                   apr_size_t window_size,
+                   int version,
+                   apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *txdelta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream;
+  svn_stringbuf_t *regenerated = svn_stringbuf_create_empty(pool);
+  apr_size_t len;
+
+  *encoded = svn_stringbuf_create_empty(pool);
+  svn_txdelta__create(&txdelta_stream,
+                      svn_stream_from_string(source, pool),
+                      svn_stream_from_string(target, pool),
+                      FALSE, window_size, pool);
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(*encoded, pool),
+                          version, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                          pool);
+  SVN_ERR(svn_txdelta_send_txstream(txdelta_stream, handler, handler_baton,
+                                    pool));
+
+  svn_txdelta_apply(svn_stream_from_string(source, pool),
+                    svn_stream_from_stringbuf(regenerated, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE, pool);
+  len = (*encoded)->len;
+  SVN_ERR(svn_stream_write(stream, (*encoded)->data, &len));
+  SVN_ERR(svn_stream_close(stream));
+
+  SVN_TEST_ASSERT(svn_string_compare_stringbuf(target, regenerated));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+svndiff3_large_window_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = 4711;
+  apr_size_t len = LARGE_WINDOW_DATA_SIZE;
+  svn_stringbuf_t *target = svn_stringbuf_create_ensure(len, pool);
+  svn_stringbuf_t *small_delta, *large_delta;
+  svn_string_t source;
+  svn_stream_t *stream;
+  svn_string_t raw_data;
+  apr_size_t write_len, window_len;
+
+  /* Swap the two halves of some random data.  No 100kB window can find
+     any matches for that but a window covering all the data can. */
+  source.data = random_buffer(len, &seed, pool);
+  source.len = len;
+  svn_stringbuf_appendbytes(target, source.data + len / 2, len - len / 2);
+  svn_stringbuf_appendbytes(target, source.data, len / 2);
+
+  SVN_ERR(svndiff_round_trip(&small_delta, &source,
+                             svn_string_create_from_buf(target, pool),
+                             0, 2, pool));
+  SVN_ERR(svndiff_round_trip(&large_delta, &source,
+                             svn_string_create_from_buf(target, pool),
+                             2 * len, 3, pool));
+
+  SVN_TEST_ASSERT(small_delta->len > len / 2);
+  SVN_TEST_ASSERT(large_delta->len < len / 100);
+
+  /* Reading raw windows only allows large windows for svndiff3. */
+  raw_data.data = large_delta->data + 4;
+  raw_data.len = large_delta->len - 4;
+  SVN_ERR(svn_txdelta__read_raw_window_len(&window_len,
+                                           svn_stream_from_string(&raw_data,
+                                                                  pool),
+                                           3, pool));
+  SVN_TEST_ASSERT(window_len <= raw_data.len);
+  SVN_TEST_ASSERT_ERROR(svn_txdelta__read_raw_window_len(
+                          &window_len,
+                          svn_stream_from_string(&raw_data, pool),
+                          2, pool),
+                        SVN_ERR_SVNDIFF_CORRUPT_WINDOW);
+
+  /* Older svndiff versions must reject such large windows. */
+  large_delta->data[3] = 2;
+  stream = svn_txdelta_parse_svndiff(svn_delta_noop_window_handler, NULL,
+                                     TRUE, pool);
+  write_len = large_delta->len;
+  SVN_TEST_ASSERT_ERROR(svn_stream_write(stream, large_delta->data,
+                                         &write_len),
+                        SVN_ERR_SVNDIFF_CORRUPT_WINDOW);
+
+  return SVN_NO_ERROR;
+}
+
 /* Change to 1 to enable the unit test for the delta combiner's range index: */
 #if 0
 #include "range-index-test.h"
@@ -625,6 +1056,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random combine delta test"),
     SVN_TEST_PASS2(random_txdelta_to_svndiff_stream_test,
                    "random txdelta to svndiff stream test"),
+    SVN_TEST_OPTS_PASS(xdelta_large_data_test,
+                       "xdelta on large inputs"),
+    SVN_TEST_PASS2(svndiff3_large_window_test,
+                   "svndiff3 with large delta windows"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
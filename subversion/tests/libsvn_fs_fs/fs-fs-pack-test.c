@@ -36,6 +36,7 @@
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_string_private.h"
 
 #include "../svn_test_fs.h"
@@ -190,7 +191,7 @@ create_packed_filesystem(const char *dir,
   /* Now pack the FS */
   pnb.expected_shard = 0;
   pnb.expected_action = svn_fs_pack_notify_start;
-  return svn_fs_pack(dir, pack_notify, &pnb, NULL, NULL, pool);
+  return svn_fs_pack2(dir, NULL, pack_notify, &pnb, NULL, NULL, pool);
 }
 
 /* Create a packed FSFS filesystem for revprop tests at REPO_NAME with
@@ -225,7 +226,7 @@ prepare_revprop_repo(svn_fs_t **fs,
   svn_pool_destroy(subpool);
 
   /* Pack the repository. */
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -662,7 +663,7 @@ recover_fully_packed(const svn_test_opts_t *opts,
   SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, subpool));
   SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(after_rev));
   svn_pool_destroy(subpool);
-  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
   SVN_ERR(svn_fs_recover(REPO_NAME, NULL, NULL, pool));
 
   /* Now, delete the youngest revprop file, and recover again.  This
@@ -1001,7 +1002,7 @@ upgrade_txns_to_log_addressing(const svn_test_opts_t *opts,
   /* Pack repo to verify that old and new shard get packed according to
      their respective addressing mode */
 
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   /* verify that our changes got in */
 
@@ -1887,6 +1888,368 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+/* Return the contents of file "big" in revision REV, spanning several
+   delta windows of any size used by changing_delta_window_size(). */
+static const char *
+get_big_contents(svn_revnum_t rev,
+                 apr_pool_t *pool)
+{
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(pool);
+  int i;
+
+  for (i = 0; i < 40000; ++i)
+    if (i % 97 == rev % 97)
+      svn_stringbuf_appendcstr(contents,
+                               apr_psprintf(pool, "Line %06d of r%ld\n",
+                                            i, rev));
+    else
+      svn_stringbuf_appendcstr(contents,
+                               apr_psprintf(pool, "This is line %06d.\n", i));
+
+  return contents->data;
+}
+
+#define REPO_NAME "test-repo-changing_delta_window_size"
+#define MAX_REV 12
+
+static svn_error_t *
+changing_delta_window_size(const svn_test_opts_t *opts,
+                           apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_revnum_t new_rev;
+  apr_hash_t *fs_config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (   (strcmp(opts->fs_type, "fsfs") != 0)
+      || (opts->server_minor_version && (opts->server_minor_version < 13)))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "large delta windows require format 9+");
+
+  /* Build a history of the same file, switching from default windows
+   * to large windows and back again while the deltification chain is
+   * still linear. */
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_pool_clear(iterpool);
+
+      ffd->delta_window_size = (rev > 4 && rev <= 8)
+                             ? 256 * 0x400
+                             : svn_txdelta__max_window_size(2);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      if (rev == 1)
+        SVN_ERR(svn_fs_make_file(root, "big", iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "big",
+                                          get_big_contents(rev, iterpool),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, iterpool));
+      SVN_TEST_ASSERT(new_rev == rev);
+    }
+
+  /* Every revision must read back correctly.  To make sure we actually
+   * read from disk, use a new FS instance with disjoint caches. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_stream_t *stream;
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_fs_file_contents(&stream, root, "big", iterpool));
+      SVN_ERR(svn_test__stream_to_string(&contents, stream, iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             get_big_contents(rev, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+/* Notification expectations for concurrent packing.  Multiple shards may
+   be in progress at the same time but each sequence of start and end
+   notifications must be in shard order. */
+struct pack_concurrent_notify_baton
+{
+  apr_int64_t next_start;
+  apr_int64_t next_end;
+};
+
+static svn_error_t *
+pack_concurrent_notify(void *baton,
+                       apr_int64_t shard,
+                       svn_fs_pack_notify_action_t action,
+                       apr_pool_t *pool)
+{
+  struct pack_concurrent_notify_baton *pnb = baton;
+
+  switch (action)
+    {
+      case svn_fs_pack_notify_start:
+        SVN_TEST_ASSERT(shard == pnb->next_start);
+        pnb->next_start++;
+        break;
+
+      case svn_fs_pack_notify_end:
+        /* A shard must not be reported as done before it got started. */
+        SVN_TEST_ASSERT(shard == pnb->next_end);
+        SVN_TEST_ASSERT(shard < pnb->next_start);
+        pnb->next_end++;
+        break;
+
+      default:
+        return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                                "Unknown notification action when packing");
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-pack-concurrently"
+#define SHARD_SIZE 4
+#define MAX_REV 37
+static svn_error_t *
+pack_concurrently(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  apr_hash_t *fs_config;
+  struct pack_concurrent_notify_baton pnb;
+  svn_revnum_t i;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+
+  /* Pack with multiple threads.  Notifications must still arrive in
+     shard order. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_JOBS, "4");
+
+  pnb.next_start = 0;
+  pnb.next_end = 0;
+  SVN_ERR(svn_fs_pack2(REPO_NAME, fs_config, pack_concurrent_notify, &pnb,
+                       NULL, NULL, pool));
+  SVN_TEST_ASSERT(pnb.next_start == (MAX_REV + 1) / SHARD_SIZE);
+  SVN_TEST_ASSERT(pnb.next_end == (MAX_REV + 1) / SHARD_SIZE);
+
+  /* All completed shards must have been packed. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_fs__update_min_unpacked_rev(fs, pool));
+  SVN_TEST_ASSERT(((fs_fs_data_t *)fs->fsap_data)->min_unpacked_rev
+                  == (MAX_REV + 1) / SHARD_SIZE * SHARD_SIZE);
+
+  /* Verify the contents. */
+  for (i = 2; i <= MAX_REV; i++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stream_t *stream;
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, iterpool));
+      SVN_ERR(svn_fs_file_contents(&stream, rev_root, "iota", iterpool));
+      SVN_ERR(svn_test__stream_to_string(&contents, stream, iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data, get_rev_contents(i, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-mmap_pack_files"
+#define SHARD_SIZE 5
+#define MAX_REV 11
+static svn_error_t *
+mmap_pack_files(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_revnum_t i;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+
+  /* Enable memory-mapped pack file access. */
+  SVN_ERR(svn_io_remove_file2(svn_dirent_join(REPO_NAME, PATH_CONFIG, pool),
+                              FALSE, pool));
+  SVN_ERR(svn_io_file_create(svn_dirent_join(REPO_NAME, PATH_CONFIG, pool),
+                             "[" CONFIG_SECTION_IO "]\n"
+                             CONFIG_OPTION_MMAP_PACK_FILES " = true\n",
+                             pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_TEST_ASSERT(((fs_fs_data_t *)fs->fsap_data)->mmap_pack_files);
+
+  /* Read contents, directories and changes from packed and non-packed
+   * revisions alike. */
+  for (i = 1; i <= MAX_REV; i++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stream_t *rstream;
+      svn_stringbuf_t *rstring;
+      apr_hash_t *entries;
+      apr_hash_t *changes;
+      const char *expected;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, iterpool));
+      SVN_ERR(svn_fs_file_contents(&rstream, rev_root, "iota", iterpool));
+      SVN_ERR(svn_test__stream_to_string(&rstring, rstream, iterpool));
+
+      expected = i == 1 ? "This is the file 'iota'.\n"
+                        : get_rev_contents(i, iterpool);
+      SVN_TEST_STRING_ASSERT(rstring->data, expected);
+
+      SVN_ERR(svn_fs_dir_entries(&entries, rev_root, "A/D/G", iterpool));
+      SVN_TEST_ASSERT(apr_hash_count(entries) == 3);
+
+      SVN_ERR(svn_fs_paths_changed2(&changes, rev_root, iterpool));
+      SVN_TEST_ASSERT(i == 1 ? apr_hash_count(changes) >= 20
+                             : apr_hash_count(changes) == 1);
+    }
+
+  /* The indexes and checksums must be readable through the mapping, too. */
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-revprop_lists"
+#define SHARD_SIZE 4
+#define MAX_REV 10
+
+/* Baton for revprop_lists_receiver(). */
+typedef struct revprop_lists_baton_t
+{
+  svn_fs_t *fs;
+  svn_revnum_t next_rev;
+  svn_boolean_t ascending;
+} revprop_lists_baton_t;
+
+/* Implements svn_fs_revision_proplist_receiver_t.  Verify that REVISION
+   is the one expected by the (revprop_lists_baton_t *) BATON and that
+   PROPLIST matches what svn_fs_revision_proplist2() returns. */
+static svn_error_t *
+revprop_lists_receiver(void *baton,
+                       svn_revnum_t revision,
+                       apr_hash_t *proplist,
+                       apr_pool_t *scratch_pool)
+{
+  revprop_lists_baton_t *b = baton;
+  apr_hash_t *expected;
+  apr_array_header_t *diffs;
+
+  SVN_TEST_ASSERT(revision == b->next_rev);
+  b->next_rev += b->ascending ? 1 : -1;
+
+  SVN_ERR(svn_fs_revision_proplist2(&expected, b->fs, revision, FALSE,
+                                    scratch_pool, scratch_pool));
+  SVN_ERR(svn_prop_diffs(&diffs, proplist, expected, scratch_pool));
+  SVN_TEST_ASSERT(diffs->nelts == 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+revprop_lists(const svn_test_opts_t *opts,
+              apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  revprop_lists_baton_t baton;
+
+  /* Create the packed FS with a non-packed head revision. */
+  SVN_ERR(prepare_revprop_repo(&fs, REPO_NAME, MAX_REV, SHARD_SIZE, opts,
+                               pool));
+
+  /* Modify a packed revprop to make sure we don't see stale data. */
+  SVN_ERR(svn_fs_change_rev_prop(fs, 5, SVN_PROP_REVISION_LOG,
+                                 svn_string_create("changed log", pool),
+                                 pool));
+
+  baton.fs = fs;
+
+  /* All revisions, oldest first. */
+  baton.next_rev = 0;
+  baton.ascending = TRUE;
+  SVN_ERR(svn_fs_revision_proplists(fs, 0, MAX_REV + 1, TRUE,
+                                    revprop_lists_receiver, &baton,
+                                    NULL, NULL, pool));
+  SVN_TEST_ASSERT(baton.next_rev == MAX_REV + 2);
+
+  /* A range crossing pack boundaries, newest first. */
+  baton.next_rev = MAX_REV;
+  baton.ascending = FALSE;
+  SVN_ERR(svn_fs_revision_proplists(fs, MAX_REV, 2, FALSE,
+                                    revprop_lists_receiver, &baton,
+                                    NULL, NULL, pool));
+  SVN_TEST_ASSERT(baton.next_rev == 1);
+
+  /* Single revision. */
+  baton.next_rev = 5;
+  baton.ascending = TRUE;
+  SVN_ERR(svn_fs_revision_proplists(fs, 5, 5, FALSE,
+                                    revprop_lists_receiver, &baton,
+                                    NULL, NULL, pool));
+  SVN_TEST_ASSERT(baton.next_rev == 6);
+
+  /* Revisions beyond HEAD must be rejected. */
+  SVN_TEST_ASSERT_ERROR(svn_fs_revision_proplists(fs, 0, MAX_REV + 2, FALSE,
+                                                  revprop_lists_receiver,
+                                                  &baton, NULL, NULL, pool),
+                        SVN_ERR_FS_NO_SUCH_REVISION);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
 
 
 /* The test table.  */
@@ -1942,6 +2305,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(changing_delta_window_size,
+                       "change delta-window-size along a delta chain"),
+    SVN_TEST_OPTS_PASS(pack_concurrently,
+                       "pack multiple shards concurrently"),
+    SVN_TEST_OPTS_PASS(mmap_pack_files,
+                       "read pack files through memory mappings"),
+    SVN_TEST_OPTS_PASS(revprop_lists,
+                       "read revprops of revision ranges"),
     SVN_TEST_NULL
   };
 
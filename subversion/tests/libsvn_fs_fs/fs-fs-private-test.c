@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <apr_thread_proc.h>
 
 #include "../svn_test.h"
 
@@ -34,7 +35,11 @@
 #include "private/svn_fs_fs_private.h"
 #include "private/svn_subr_private.h"
 
+#include "../../libsvn_fs_fs/fs.h"
+#include "../../libsvn_fs_fs/fs_fs.h"
 #include "../../libsvn_fs_fs/index.h"
+#include "../../libsvn_fs_fs/rep-cache.h"
+#include "../../libsvn_fs_fs/util.h"
 
 #include "../svn_test_fs.h"
 
@@ -72,6 +77,123 @@ create_greek_repo(svn_repos_t **repos,
   return SVN_NO_ERROR;
 }
 
+/* Return the expected contents of "iota" in revision REV of the
+ * repositories created by create_packed_fs(). */
+static const char *
+get_rev_contents(svn_revnum_t rev,
+                 apr_pool_t *pool)
+{
+  return apr_psprintf(pool, "iota in r%ld\n", rev);
+}
+
+/* Create a FSFS filesystem under REPO_NAME using OPTS and a shard size of
+ * SHARD_SIZE.  Add the Greek tree in r1 and modify "iota" in every
+ * following revision up to MAX_REV, see get_rev_contents().  Finally,
+ * pack the filesystem.  Use POOL for allocations.
+ */
+static svn_error_t *
+create_packed_fs(const char *repo_name,
+                 const svn_test_opts_t *opts,
+                 svn_revnum_t max_rev,
+                 int shard_size,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 6))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.6 SVN doesn't support FSFS packing");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, shard_size));
+  SVN_ERR(svn_test__create_fs2(&fs, repo_name, opts, fs_config, subpool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, subpool));
+
+  while (rev < max_rev)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          get_rev_contents(rev + 1,
+                                                           iterpool),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(subpool);
+
+  return svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool);
+}
+
+/* Return the number of occurrences of NEEDLE in STRING. */
+static int
+count_substring(svn_stringbuf_t *string,
+                const char *needle)
+{
+  int count = 0;
+  apr_size_t len = strlen(needle);
+  apr_size_t pos;
+
+  for (pos = 0; pos + len <= string->len; ++pos)
+    if (memcmp(string->data + pos, needle, len) == 0)
+      ++count;
+
+  return count;
+}
+
+/* Set *COUNT to the number of representations written in REVISION of FS.
+ * Use POOL for allocations.
+ */
+static svn_error_t *
+count_representations(int *count,
+                      svn_fs_t *fs,
+                      svn_revnum_t revision,
+                      apr_pool_t *pool)
+{
+  svn_stringbuf_t *rev_contents;
+  const char *rev_path = svn_fs_fs__path_rev_absolute(fs, revision, pool);
+  SVN_ERR(svn_stringbuf_from_file2(&rev_contents, rev_path, pool));
+
+  *count = count_substring(rev_contents, "PLAIN")
+         + count_substring(rev_contents, "DELTA");
+
+  return SVN_NO_ERROR;
+}
+
+/* Repeat string S many times to make it big enough for deltification etc.
+ * to kick in.
+ */
+static const char*
+multiply_string(const char *s,
+                apr_pool_t *pool)
+{
+  svn_stringbuf_t *temp = svn_stringbuf_create(s, pool);
+
+  int i;
+  for (i = 0; i < 7; ++i)
+    svn_stringbuf_insert(temp, temp->len, temp->data, temp->len);
+
+  return temp->data;
+}
+
 
 /* ------------------------------------------------------------------------ */
 
@@ -422,9 +544,9 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
   SVN_ERR(svn_fs_ioctl(svn_repos_fs(repos), SVN_FS_FS__IOCTL_LOAD_INDEX,
                        &load_input, NULL, NULL, NULL, pool, pool));
 
-  SVN_TEST_ASSERT_ERROR(svn_repos_verify_fs3(repos, rev, rev, FALSE, FALSE,
-                                             NULL, NULL, NULL, NULL, NULL,
-                                             NULL, pool),
+  SVN_TEST_ASSERT_ERROR(svn_repos_verify_fs4(repos, rev, rev, FALSE, FALSE,
+                                             1, NULL, NULL, NULL, NULL,
+                                             NULL, NULL, pool),
                         SVN_ERR_FS_INDEX_CORRUPTION);
 
   /* Restore the original index. */
@@ -432,7 +554,7 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
   load_input.entries = entries;
   SVN_ERR(svn_fs_ioctl(svn_repos_fs(repos), SVN_FS_FS__IOCTL_LOAD_INDEX,
                        &load_input, NULL, NULL, NULL, pool, pool));
-  SVN_ERR(svn_repos_verify_fs3(repos, rev, rev, FALSE, FALSE, NULL, NULL,
+  SVN_ERR(svn_repos_verify_fs4(repos, rev, rev, FALSE, FALSE, 1, NULL, NULL,
                                NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
@@ -440,11 +562,929 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-read_delta_chains"
+#define CHAIN_REVS 40
+#define CHAIN_LINES 300
+
+/* Return the contents of "foo" in revision REV of the repository created
+ * by read_delta_chains.  Every revision changes three lines. */
+static const char *
+get_chain_contents(svn_revnum_t rev,
+                   apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_empty(pool);
+  int line;
+
+  for (line = 0; line < CHAIN_LINES; ++line)
+    {
+      svn_revnum_t changed = 0;
+      svn_revnum_t k;
+
+      for (k = 1; k <= rev; ++k)
+        if (   (k * 37) % CHAIN_LINES == line
+            || (k * 53 + 1) % CHAIN_LINES == line
+            || (k * 91 + 2) % CHAIN_LINES == line)
+          changed = k;
+
+      svn_stringbuf_appendcstr(result,
+                               apr_psprintf(pool,
+                                            "Line %d, last changed in r%ld\n",
+                                            line, changed));
+    }
+
+  return result->data;
+}
+
+/* Read all revisions of "foo" from the repository in REPO_NAME, using
+ * a fresh cache namespace. */
+static svn_error_t *
+verify_chain_contents(apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t rev;
+  int pass;
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  /* The second pass will mainly be served from the caches. */
+  for (pass = 0; pass < 2; ++pass)
+    for (rev = 1; rev <= CHAIN_REVS; ++rev)
+      {
+        svn_fs_root_t *root;
+        svn_stringbuf_t *contents;
+
+        svn_pool_clear(iterpool);
+
+        SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+        SVN_ERR(svn_test__get_file_contents(root, "foo", &contents,
+                                            iterpool));
+        SVN_TEST_STRING_ASSERT(contents->data,
+                               get_chain_contents(rev, iterpool));
+      }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+read_delta_chains(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev = 0;
+  apr_hash_t *fs_config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  if (opts->server_minor_version && (opts->server_minor_version < 6))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.6 SVN doesn't support FSFS packing");
+
+  /* Create a file with a long history of small changes, i.e. deltas
+   * that need to be combined with several others to get the contents. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE, "10");
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  while (rev < CHAIN_REVS)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      if (rev == 0)
+        SVN_ERR(svn_fs_make_file(root, "foo", iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "foo",
+                                          get_chain_contents(rev + 1,
+                                                             iterpool),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* All of them must be readable with cold and with warm caches. */
+  SVN_ERR(verify_chain_contents(pool));
+
+  /* Same with most of the revisions in pack files. */
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(verify_chain_contents(pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef CHAIN_REVS
+#undef CHAIN_LINES
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-rep_cache_filter"
+
+/* Commit a new file PATH with contents CONTENTS to FS in a new revision
+   and return the number of representations written in *REP_COUNT. */
+static svn_error_t *
+commit_file(int *rep_count,
+            svn_fs_t *fs,
+            const char *path,
+            const char *contents,
+            apr_pool_t *pool)
+{
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+
+  SVN_ERR(svn_fs_youngest_rev(&rev, fs, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, path, pool));
+  SVN_ERR(svn_test__set_file_contents(root, path, contents, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_ERR(count_representations(rep_count, fs, rev, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+rep_cache_filter(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_t *fs2;
+  fs_fs_data_t *ffd;
+  svn_node_kind_t kind;
+  int count;
+  const char *filter_path;
+  const char *hello_str = multiply_string("Hello, ", pool);
+  const char *world_str = multiply_string("World!", pool);
+  const char *goodbye_str = multiply_string("Goodbye!", pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  ffd->rep_sharing_allowed = TRUE;
+  filter_path = svn_dirent_join(fs->path, REP_CACHE_FILTER_NAME, pool);
+
+  /* r1: New contents.  The commit creates the filter. */
+  SVN_ERR(commit_file(&count, fs, "foo", hello_str, pool));
+  SVN_TEST_ASSERT(count == 2);
+  SVN_ERR(svn_io_check_path(filter_path, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  /* All FS instances in this process share the filter in memory.  The
+     next commit that adds to the rep-cache writes the lost file anew. */
+  SVN_ERR(svn_io_remove_file2(filter_path, FALSE, pool));
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, NULL, pool, pool));
+  ((fs_fs_data_t *)fs2->fsap_data)->rep_sharing_allowed = TRUE;
+
+  SVN_ERR(commit_file(&count, fs2, "bar", hello_str, pool));
+  SVN_TEST_ASSERT(count == 1);
+  SVN_ERR(commit_file(&count, fs2, "baz", world_str, pool));
+  SVN_TEST_ASSERT(count == 2);
+  SVN_ERR(svn_io_check_path(filter_path, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  SVN_ERR(commit_file(&count, fs2, "qux", world_str, pool));
+  SVN_TEST_ASSERT(count == 1);
+
+  /* Keys added through one FS instance are visible through the other. */
+  SVN_ERR(commit_file(&count, fs, "quux", world_str, pool));
+  SVN_TEST_ASSERT(count == 1);
+  SVN_ERR(commit_file(&count, fs, "corge", goodbye_str, pool));
+  SVN_TEST_ASSERT(count == 2);
+  SVN_ERR(commit_file(&count, fs2, "grault", goodbye_str, pool));
+  SVN_TEST_ASSERT(count == 1);
+
+  /* A broken filter file must not be used and gets replaced. */
+  SVN_ERR(svn_io_write_atomic2(filter_path, "SVNRCF1\n", 8, NULL, FALSE,
+                               pool));
+  SVN_ERR(commit_file(&count, fs, "garply", hello_str, pool));
+  SVN_TEST_ASSERT(count == 1);
+  SVN_ERR(commit_file(&count, fs, "waldo", multiply_string("Waldo", pool),
+                      pool));
+  SVN_TEST_ASSERT(count == 2);
+  SVN_ERR(commit_file(&count, fs2, "fred", multiply_string("Waldo", pool),
+                      pool));
+  SVN_TEST_ASSERT(count == 1);
+
+  /* A new UUID makes for new shared data, i.e. no filter in memory.
+     Without a filter file, the first lookup rebuilds the filter from
+     the database even if the commit adds nothing to the rep-cache. */
+  SVN_ERR(svn_fs_set_uuid(fs, NULL, pool));
+  SVN_ERR(svn_io_remove_file2(filter_path, FALSE, pool));
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, NULL, pool, pool));
+  ((fs_fs_data_t *)fs2->fsap_data)->rep_sharing_allowed = TRUE;
+
+  SVN_ERR(commit_file(&count, fs2, "plugh", goodbye_str, pool));
+  SVN_TEST_ASSERT(count == 1);
+  SVN_ERR(svn_io_check_path(filter_path, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+  SVN_ERR(commit_file(&count, fs2, "xyzzy", multiply_string("Xyzzy", pool),
+                      pool));
+  SVN_TEST_ASSERT(count == 2);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-rep_cache_batch"
+
+static svn_error_t *
+rep_cache_batch(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_t *fs2;
+  apr_hash_t *fs_config;
+  int count;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  const char *hello_str = multiply_string("Hello, ", pool);
+  const char *world_str = multiply_string("World!", pool);
+  const char *goodbye_str = multiply_string("Goodbye!", pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_REP_CACHE_BATCH, "3");
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, subpool));
+  if (((fs_fs_data_t *)fs->fsap_data)->format
+        < SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  ((fs_fs_data_t *)fs->fsap_data)->rep_sharing_allowed = TRUE;
+
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, NULL, pool, pool));
+  ((fs_fs_data_t *)fs2->fsap_data)->rep_sharing_allowed = TRUE;
+
+  /* Deferred entries are visible to their own FS only. */
+  SVN_ERR(commit_file(&count, fs, "foo", hello_str, pool));
+  SVN_TEST_ASSERT(count == 2);
+  SVN_ERR(commit_file(&count, fs, "bar", hello_str, pool));
+  SVN_TEST_ASSERT(count == 1);
+  SVN_ERR(commit_file(&count, fs2, "baz", hello_str, pool));
+  SVN_TEST_ASSERT(count == 2);
+
+  /* The third revision written through FS flushes the batch. */
+  SVN_ERR(commit_file(&count, fs, "qux", world_str, pool));
+  SVN_TEST_ASSERT(count == 2);
+  SVN_ERR(commit_file(&count, fs2, "quux", world_str, pool));
+  SVN_TEST_ASSERT(count == 1);
+
+  /* Closing FS flushes the remainder. */
+  SVN_ERR(commit_file(&count, fs, "corge", goodbye_str, pool));
+  SVN_TEST_ASSERT(count == 2);
+  svn_pool_destroy(subpool);
+
+  SVN_ERR(commit_file(&count, fs2, "grault", goodbye_str, pool));
+  SVN_TEST_ASSERT(count == 1);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-build_rep_cache"
+
+static svn_error_t *
+build_rep_cache(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  int count;
+  int i;
+  const char *hello_str = multiply_string("Hello, ", pool);
+  const char *world_str = multiply_string("World!", pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Create content without rep-sharing, i.e. without rep-cache entries.
+     Use enough files to fill some multi-row insert batches.  r2 adds
+     file props. */
+  ffd->rep_sharing_allowed = FALSE;
+  SVN_ERR(commit_file(&count, fs, "hello", hello_str, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_change_node_prop(root, "hello", "prop",
+                                  svn_string_create("value", pool), pool));
+  for (i = 0; i < 40; ++i)
+    {
+      const char *path = apr_psprintf(pool, "file%d", i);
+      SVN_ERR(svn_fs_make_file(root, path, pool));
+      SVN_ERR(svn_test__set_file_contents(root, path,
+                                          apr_psprintf(pool, "%d\n", i),
+                                          pool));
+    }
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_ERR(commit_file(&count, fs, "world", world_str, pool));
+
+  /* Rep-sharing must be enabled for building the rep-cache. */
+  SVN_TEST_ASSERT_ERROR(svn_fs_fs__build_rep_cache(fs, SVN_INVALID_REVNUM,
+                                                   SVN_INVALID_REVNUM,
+                                                   NULL, NULL, NULL, NULL,
+                                                   pool),
+                        SVN_ERR_UNSUPPORTED_FEATURE);
+
+  /* Fill the rep-cache with the entries for r1 and r2 only. */
+  ffd->rep_sharing_allowed = TRUE;
+  SVN_ERR(svn_fs_fs__build_rep_cache(fs, 1, 2, NULL, NULL, NULL, NULL,
+                                     pool));
+
+  SVN_ERR(commit_file(&count, fs, "hello2", hello_str, pool));
+  SVN_TEST_ASSERT(count == 1);
+  SVN_ERR(commit_file(&count, fs, "file", "7\n", pool));
+  SVN_TEST_ASSERT(count == 1);
+  SVN_ERR(commit_file(&count, fs, "world2", world_str, pool));
+  SVN_TEST_ASSERT(count == 2);
+
+  /* Process all revisions, including existing entries. */
+  SVN_ERR(svn_fs_fs__build_rep_cache(fs, SVN_INVALID_REVNUM,
+                                     SVN_INVALID_REVNUM, NULL, NULL,
+                                     NULL, NULL, pool));
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-concurrent_commits"
+#define COMMITTERS 16
+#define COMMITS_PER_COMMITTER 8
+
+#if APR_HAS_THREADS
+/* Baton for committer_thread below. */
+typedef struct committer_baton_t
+{
+  /* Our own FS instance for REPO_NAME. */
+  svn_fs_t *fs;
+
+  /* Index of this thread, used to create unique paths. */
+  int id;
+
+  /* Allocate everything here.  This is a root pool of its own. */
+  apr_pool_t *pool;
+
+  /* Result of the thread. */
+  svn_error_t *err;
+} committer_baton_t;
+
+/* Commit COMMITS_PER_COMMITTER new files through BATON->FS. */
+static svn_error_t *
+run_committer(committer_baton_t *baton)
+{
+  apr_pool_t *iterpool = svn_pool_create(baton->pool);
+  int i;
+
+  for (i = 0; i < COMMITS_PER_COMMITTER; ++i)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *root;
+      svn_revnum_t rev;
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = apr_psprintf(iterpool, "/file-%d-%d", baton->id, i);
+
+      SVN_ERR(svn_fs_youngest_rev(&rev, baton->fs, iterpool));
+      SVN_ERR(svn_fs_begin_txn(&txn, baton->fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_fs_make_file(root, path, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, path, path, iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread function calling run_committer for the committer_baton_t
+   given by DATA. */
+static void * APR_THREAD_FUNC
+committer_thread(apr_thread_t *tid, void *data)
+{
+  committer_baton_t *baton = data;
+  baton->err = run_committer(baton);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+#endif
+
+static svn_error_t *
+concurrent_commits(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  svn_fs_t *fs;
+  apr_thread_t *threads[COMMITTERS];
+  committer_baton_t batons[COMMITTERS];
+  svn_revnum_t youngest;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  /* All committers use separate FS instances that share the in-process
+     write lock. */
+  for (i = 0; i < COMMITTERS; ++i)
+    {
+      batons[i].pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      batons[i].id = i;
+      batons[i].err = SVN_NO_ERROR;
+      SVN_ERR(svn_fs_open2(&batons[i].fs, REPO_NAME, NULL,
+                           batons[i].pool, batons[i].pool));
+    }
+
+  for (i = 0; i < COMMITTERS; ++i)
+    SVN_TEST_ASSERT(apr_thread_create(&threads[i], NULL, committer_thread,
+                                      &batons[i], pool) == APR_SUCCESS);
+
+  for (i = 0; i < COMMITTERS; ++i)
+    {
+      apr_status_t retval;
+      SVN_TEST_ASSERT(apr_thread_join(&retval, threads[i]) == APR_SUCCESS);
+      err = svn_error_compose_create(err, batons[i].err);
+      svn_pool_destroy(batons[i].pool);
+    }
+  SVN_ERR(err);
+
+  /* No commit got lost. */
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+  SVN_TEST_ASSERT(youngest == COMMITTERS * COMMITS_PER_COMMITTER);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "this test requires threads");
+#endif
+}
+
+#undef COMMITS_PER_COMMITTER
+#undef COMMITTERS
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-hotcopy_concurrently"
+#define SHARD_SIZE 4
+#define MAX_REV 21
+#define MORE_REVS 5
+
+/* Baton type for hotcopy_notify(). */
+struct hotcopy_notify_baton
+{
+  /* The next revision that may be reported. */
+  svn_revnum_t expected_rev;
+};
+
+/* Implements svn_fs_hotcopy_notify_t.  Check that notifications arrive
+   in revision order. */
+static void
+hotcopy_notify(void *baton,
+               svn_revnum_t start_revision,
+               svn_revnum_t end_revision,
+               apr_pool_t *scratch_pool)
+{
+  struct hotcopy_notify_baton *hnb = baton;
+
+  /* Make any ordering violation visible to the final check. */
+  if (start_revision < hnb->expected_rev || end_revision < start_revision)
+    hnb->expected_rev = SVN_INVALID_REVNUM;
+  else
+    hnb->expected_rev = end_revision + 1;
+}
+
+static svn_error_t *
+hotcopy_concurrently(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  const char *dst_path = REPO_NAME "-copy";
+  svn_fs_t *fs;
+  svn_fs_t *dst_fs;
+  apr_hash_t *fs_config;
+  struct hotcopy_notify_baton hnb;
+  svn_revnum_t youngest;
+  svn_revnum_t i;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  SVN_ERR(create_packed_fs(REPO_NAME, opts, MAX_REV, SHARD_SIZE, pool));
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_JOBS, "4");
+
+  /* Full hotcopy with multiple threads.  Every revision gets reported
+     exactly once and in order. */
+  SVN_ERR(svn_io_remove_dir2(dst_path, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(dst_path);
+
+  hnb.expected_rev = 0;
+  SVN_ERR(svn_fs_hotcopy4(REPO_NAME, dst_path, FALSE, FALSE, fs_config,
+                          hotcopy_notify, &hnb, NULL, NULL, pool));
+  SVN_TEST_ASSERT(hnb.expected_rev == MAX_REV + 1);
+
+  /* Add revisions to the source such that another shard gets packed. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (i = MAX_REV + 1; i <= MAX_REV + MORE_REVS; i++)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *txn_root;
+      const char *conflict;
+      svn_revnum_t new_rev;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, i - 1, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          get_rev_contents(i, iterpool),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(&conflict, &new_rev, txn, iterpool));
+      SVN_TEST_ASSERT(new_rev == i);
+    }
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
+
+  /* The incremental hotcopy must replace the former un-packed revisions
+     by the new pack and add the new revisions. */
+  hnb.expected_rev = 0;
+  SVN_ERR(svn_fs_hotcopy4(REPO_NAME, dst_path, FALSE, TRUE, fs_config,
+                          hotcopy_notify, &hnb, NULL, NULL, pool));
+  SVN_TEST_ASSERT(hnb.expected_rev == MAX_REV + MORE_REVS + 1);
+
+  SVN_ERR(svn_fs_open2(&dst_fs, dst_path, NULL, pool, pool));
+  SVN_ERR(svn_fs_youngest_rev(&youngest, dst_fs, pool));
+  SVN_TEST_ASSERT(youngest == MAX_REV + MORE_REVS);
+  SVN_ERR(svn_fs_fs__update_min_unpacked_rev(dst_fs, pool));
+  SVN_TEST_ASSERT(((fs_fs_data_t *)dst_fs->fsap_data)->min_unpacked_rev
+                  == (MAX_REV + MORE_REVS + 1) / SHARD_SIZE * SHARD_SIZE);
+
+  for (i = 2; i <= youngest; i++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stream_t *stream;
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_revision_root(&rev_root, dst_fs, i, iterpool));
+      SVN_ERR(svn_fs_file_contents(&stream, rev_root, "iota", iterpool));
+      SVN_ERR(svn_test__stream_to_string(&contents, stream, iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data, get_rev_contents(i, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_fs_verify(dst_path, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+#undef MORE_REVS
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-stats_concurrently"
+#define SHARD_SIZE 4
+#define MAX_REV 21
+
+static svn_error_t *
+stats_concurrently(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_t *concurrent_fs;
+  apr_hash_t *fs_config;
+  svn_fs_fs__stats_t *stats;
+  svn_fs_fs__stats_t *concurrent_stats;
+  apr_size_t i;
+
+  SVN_ERR(create_packed_fs(REPO_NAME, opts, MAX_REV, SHARD_SIZE, pool));
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_JOBS, "4");
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_open2(&concurrent_fs, REPO_NAME, fs_config, pool, pool));
+  SVN_TEST_ASSERT(((fs_fs_data_t *)concurrent_fs->fsap_data)->jobs == 4);
+
+  SVN_ERR(svn_fs_fs__get_stats(&stats, fs, NULL, NULL, NULL, NULL,
+                               pool, pool));
+  SVN_ERR(svn_fs_fs__get_stats(&concurrent_stats, concurrent_fs, NULL, NULL,
+                               NULL, NULL, pool, pool));
+
+  /* Scanning packed and non-packed revs concurrently must produce the
+     exact same results as a single-threaded run. */
+  SVN_TEST_ASSERT(stats->revision_count == MAX_REV + 1);
+  SVN_TEST_ASSERT(concurrent_stats->revision_count == stats->revision_count);
+  SVN_TEST_ASSERT(concurrent_stats->total_size == stats->total_size);
+  SVN_TEST_ASSERT(concurrent_stats->change_count == stats->change_count);
+  SVN_TEST_ASSERT(concurrent_stats->change_len == stats->change_len);
+  SVN_TEST_ASSERT(!memcmp(&concurrent_stats->total_rep_stats,
+                          &stats->total_rep_stats,
+                          sizeof(stats->total_rep_stats)));
+  SVN_TEST_ASSERT(!memcmp(&concurrent_stats->file_rep_stats,
+                          &stats->file_rep_stats,
+                          sizeof(stats->file_rep_stats)));
+  SVN_TEST_ASSERT(!memcmp(&concurrent_stats->dir_rep_stats,
+                          &stats->dir_rep_stats,
+                          sizeof(stats->dir_rep_stats)));
+  SVN_TEST_ASSERT(!memcmp(&concurrent_stats->file_prop_rep_stats,
+                          &stats->file_prop_rep_stats,
+                          sizeof(stats->file_prop_rep_stats)));
+  SVN_TEST_ASSERT(!memcmp(&concurrent_stats->dir_prop_rep_stats,
+                          &stats->dir_prop_rep_stats,
+                          sizeof(stats->dir_prop_rep_stats)));
+  SVN_TEST_ASSERT(!memcmp(&concurrent_stats->total_node_stats,
+                          &stats->total_node_stats,
+                          sizeof(stats->total_node_stats)));
+
+  /* The largest changes must be reported in the same order, too. */
+  SVN_TEST_ASSERT(concurrent_stats->largest_changes->count
+                  == stats->largest_changes->count);
+  for (i = 0; i < stats->largest_changes->count; ++i)
+    {
+      svn_fs_fs__large_change_info_t *expected
+        = stats->largest_changes->changes[i];
+      svn_fs_fs__large_change_info_t *actual
+        = concurrent_stats->largest_changes->changes[i];
+
+      SVN_TEST_ASSERT(actual->size == expected->size);
+      SVN_TEST_ASSERT(actual->revision == expected->revision);
+      SVN_TEST_STRING_ASSERT(actual->path->data, expected->path->data);
+    }
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-paged_directories"
+#define DIR_SIZE 1500
+static svn_error_t *
+paged_directories(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_fs_root_t *root1;
+  svn_fs_root_t *root2;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config;
+  apr_hash_t *entries;
+  svn_stringbuf_t *r1;
+  svn_node_kind_t kind;
+  int i;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if ((strcmp(opts->fs_type, "fsfs") != 0)
+      || (opts->server_minor_version && (opts->server_minor_version < 13)))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.13 SVN doesn't support paged directories");
+
+  /* Use physical addressing such that recovery has to parse directories. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_PAGED_DIRECTORIES, "1");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_LOG_ADDRESSING, "0");
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  SVN_TEST_ASSERT(((fs_fs_data_t *)fs->fsap_data)->paged_directories);
+
+  /* r1: A directory large enough to be paged. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(txn_root, "big", pool));
+  for (i = 0; i < DIR_SIZE; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_make_file(txn_root,
+                               apr_psprintf(iterpool, "big/f%05d", i),
+                               iterpool));
+    }
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 1);
+
+  SVN_ERR(svn_stringbuf_from_file2(&r1,
+                                   svn_dirent_join_many(pool, REPO_NAME,
+                                                        "revs", "0", "1",
+                                                        SVN_VA_NULL),
+                                   pool));
+  SVN_TEST_ASSERT(strstr(r1->data, "PLAIN\nPAGED 1500 6 "));
+
+  /* r2: Remove the first entries of the first two pages and append one. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_delete(txn_root, "big/f00000", pool));
+  SVN_ERR(svn_fs_delete(txn_root, "big/f00256", pool));
+  SVN_ERR(svn_fs_make_file(txn_root, "big/g", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 2);
+
+  /* Look up entries through the index, i.e. with cold caches. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root1, fs, 1, pool));
+  SVN_ERR(svn_fs_revision_root(&root2, fs, 2, pool));
+
+  for (i = 0; i < DIR_SIZE; ++i)
+    {
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = apr_psprintf(iterpool, "big/f%05d", i);
+
+      SVN_ERR(svn_fs_check_path(&kind, root1, path, iterpool));
+      SVN_TEST_ASSERT(kind == svn_node_file);
+
+      SVN_ERR(svn_fs_check_path(&kind, root2, path, iterpool));
+      SVN_TEST_ASSERT(kind == ((i == 0 || i == 256) ? svn_node_none
+                                                    : svn_node_file));
+    }
+
+  SVN_ERR(svn_fs_check_path(&kind, root1, "big/a", pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  SVN_ERR(svn_fs_check_path(&kind, root1, "big/g", pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  SVN_ERR(svn_fs_check_path(&kind, root2, "big/g", pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  /* Reading the whole directories must give the same results. */
+  SVN_ERR(svn_fs_dir_entries(&entries, root1, "big", pool));
+  SVN_TEST_ASSERT(apr_hash_count(entries) == DIR_SIZE);
+  SVN_ERR(svn_fs_dir_entries(&entries, root2, "big", pool));
+  SVN_TEST_ASSERT(apr_hash_count(entries) == DIR_SIZE - 1);
+  SVN_TEST_ASSERT(svn_hash_gets(entries, "g"));
+  SVN_TEST_ASSERT(!svn_hash_gets(entries, "f00256"));
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
+                        NULL, NULL, pool));
+  SVN_ERR(svn_fs_recover(REPO_NAME, NULL, NULL, pool));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef DIR_SIZE
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-access_trace"
+#define SHARD_SIZE 4
+#define MAX_REV 10
+
+/* Baton for access_trace_receiver(). */
+typedef struct access_trace_baton_t
+{
+  /* Number of accesses per svn_fs_fs__access_kind_t. */
+  int counts[SVN_FS_FS__ACCESS_KIND_COUNT];
+} access_trace_baton_t;
+
+/* Implements svn_fs_fs__replay_access_func_t.  Verify that REPLAYED
+   matches RECORDED and count them in the (access_trace_baton_t *) BATON. */
+static svn_error_t *
+access_trace_receiver(const svn_fs_fs__access_record_t *recorded,
+                      const svn_fs_fs__access_record_t *replayed,
+                      void *baton,
+                      apr_pool_t *scratch_pool)
+{
+  access_trace_baton_t *b = baton;
+
+  SVN_TEST_ASSERT(replayed);
+  SVN_TEST_ASSERT(replayed->kind == recorded->kind);
+  SVN_TEST_ASSERT(replayed->revision == recorded->revision);
+  SVN_TEST_ASSERT(replayed->item_index == recorded->item_index);
+  SVN_TEST_ASSERT(replayed->sub_item == recorded->sub_item);
+  SVN_TEST_ASSERT(replayed->packed == recorded->packed);
+
+  b->counts[recorded->kind]++;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+access_trace(const svn_test_opts_t *opts,
+             apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  apr_hash_t *fs_config;
+  const char *trace_path = REPO_NAME ".trace";
+  access_trace_baton_t baton = { { 0 } };
+  svn_fs_fs__ioctl_replay_access_trace_input_t input = { 0 };
+  svn_stringbuf_t *header;
+  void *output;
+  svn_revnum_t rev;
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  SVN_ERR(create_packed_fs(REPO_NAME, opts, MAX_REV, SHARD_SIZE, pool));
+  SVN_ERR(svn_io_remove_file2(trace_path, TRUE, pool));
+
+  /* Read packed and non-packed data with tracing enabled. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_ACCESS_TRACE, trace_path);
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, subpool, subpool));
+
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_fs_root_t *root;
+      svn_stringbuf_t *contents;
+      svn_fs_path_change_iterator_t *iterator;
+      svn_fs_path_change3_t *change;
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, subpool));
+      SVN_ERR(svn_test__get_file_contents(root, "iota", &contents, subpool));
+      SVN_ERR(svn_fs_paths_changed3(&iterator, root, subpool, subpool));
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+      SVN_TEST_ASSERT(change);
+    }
+
+  /* Closes the trace file. */
+  svn_pool_destroy(subpool);
+
+  SVN_ERR(svn_stringbuf_from_file2(&header, trace_path, pool));
+  SVN_TEST_ASSERT(header->len > 0);
+  SVN_TEST_ASSERT(!strncmp(header->data, "fsfs-access-trace", 17));
+
+  /* Replay the trace.  Which of the other items got read from disk
+     depends on what the caches still hold from creating the repo. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+
+  input.trace_path = trace_path;
+  input.callback_func = access_trace_receiver;
+  input.callback_baton = &baton;
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_REPLAY_ACCESS_TRACE, &input,
+                       &output, NULL, NULL, pool, pool));
+
+  SVN_TEST_ASSERT(baton.counts[svn_fs_fs__access_changes] == MAX_REV);
+
+  /* Reject files that are not traces. */
+  input.trace_path = svn_dirent_join(REPO_NAME, "format", pool);
+  SVN_TEST_ASSERT_ERROR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_REPLAY_ACCESS_TRACE,
+                                     &input, &output, NULL, NULL, pool, pool),
+                        SVN_ERR_MALFORMED_FILE);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
 
 
 /* The test table.  */
 
-static int max_threads = 0;
+static int max_threads = 4;
 
 static struct svn_test_descriptor_t test_funcs[] =
   {
@@ -455,6 +1495,24 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "dump the P2L index"),
     SVN_TEST_OPTS_PASS(load_index,
                        "load the P2L index"),
+    SVN_TEST_OPTS_PASS(read_delta_chains,
+                       "read long delta chains"),
+    SVN_TEST_OPTS_PASS(rep_cache_filter,
+                       "rep-cache lookups through the filter"),
+    SVN_TEST_OPTS_PASS(rep_cache_batch,
+                       "defer rep-cache entries over multiple commits"),
+    SVN_TEST_OPTS_PASS(build_rep_cache,
+                       "build the rep-cache for existing revisions"),
+    SVN_TEST_OPTS_PASS(concurrent_commits,
+                       "commit concurrently with batched fsyncs"),
+    SVN_TEST_OPTS_PASS(hotcopy_concurrently,
+                       "hotcopy packed and non-packed revs concurrently"),
+    SVN_TEST_OPTS_PASS(stats_concurrently,
+                       "gather repository statistics concurrently"),
+    SVN_TEST_OPTS_PASS(paged_directories,
+                       "look up entries in paged directories"),
+    SVN_TEST_OPTS_PASS(access_trace,
+                       "record and replay item access traces"),
     SVN_TEST_NULL
   };
 
@@ -192,7 +192,7 @@ create_packed_filesystem(const char *dir,
   /* Now pack the FS */
   pnb.expected_shard = 0;
   pnb.expected_action = svn_fs_pack_notify_start;
-  return svn_fs_pack(dir, pack_notify, &pnb, NULL, NULL, pool);
+  return svn_fs_pack2(dir, NULL, pack_notify, &pnb, NULL, NULL, pool);
 }
 
 /* Create a packed FSFS filesystem for revprop tests at REPO_NAME with
@@ -227,7 +227,7 @@ prepare_revprop_repo(svn_fs_t **fs,
   svn_pool_destroy(subpool);
 
   /* Pack the repository. */
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -652,7 +652,7 @@ recover_fully_packed(const svn_test_opts_t *opts,
   SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, subpool));
   SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(after_rev));
   svn_pool_destroy(subpool);
-  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
   SVN_ERR(svn_fs_recover(REPO_NAME, NULL, NULL, pool));
 
   /* Now, delete the youngest revprop file, and recover again.  This
@@ -28,6 +28,8 @@
 #include "svn_error.h"
 #include "svn_fs.h"
 #include "svn_repos.h"
+#include "svn_delta.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_repos_private.h"
 
 #include "../svn_test.h"
@@ -76,8 +78,8 @@ test_dump_bad_props(svn_stringbuf_t **dump_data_p,
   SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(youngest_rev));
 
   /* Test that a dump completes without error. */
-  SVN_ERR(svn_repos_dump_fs4(repos, stream, start_rev, end_rev,
-                             FALSE, FALSE, TRUE, TRUE,
+  SVN_ERR(svn_repos_dump_fs5(repos, stream, start_rev, end_rev,
+                             FALSE, FALSE, FALSE, TRUE, TRUE, 1,
                              notify_func, notify_baton,
                              NULL, NULL, NULL, NULL,
                              pool));
@@ -120,7 +122,7 @@ test_load_bad_props(svn_stringbuf_t *dump_data,
   svn_revnum_t youngest_rev;
   svn_string_t *loaded_prop_val;
 
-  SVN_ERR(svn_repos_load_fs6(repos, stream,
+  SVN_ERR(svn_repos_load_fs7(repos, stream,
                              SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
                              svn_repos_load_uuid_default,
                              parent_fspath,
@@ -128,6 +130,7 @@ test_load_bad_props(svn_stringbuf_t *dump_data,
                              validate_props,
                              FALSE /*ignore_dates*/,
                              FALSE /*normalize_props*/,
+                             1 /*jobs*/,
                              notify_func, notify_baton,
                              NULL, NULL, /*cancellation*/
                              pool));
@@ -273,6 +276,357 @@ test_load_r0_mergeinfo(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Number of revisions created by create_load_source(). */
+#define LOAD_SOURCE_REVS 40
+
+/* Create a repository called NAME with LOAD_SOURCE_REVS revisions in
+ * *REPOS.  There will be enough revisions and data to require multiple
+ * batches and spill files in a pipelined load.  Use OPTS and POOL as
+ * usual. */
+static svn_error_t *
+create_load_source(svn_repos_t **repos,
+                   const char *name,
+                   const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev = 0;
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  SVN_ERR(svn_test__create_repos(repos, name, opts, pool));
+  fs = svn_repos_fs(*repos);
+
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest_rev, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, *repos, &youngest_rev, txn, pool));
+
+  for (i = 2; i <= LOAD_SOURCE_REVS; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest_rev, 0, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+
+      /* Grow iota, so we get non-trivial deltas. */
+      svn_stringbuf_appendcstr(contents,
+                               apr_psprintf(iterpool, "line %d\n", i));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota", contents->data,
+                                          iterpool));
+      SVN_ERR(svn_fs_change_node_prop(txn_root, "A/mu", "prop",
+                                      svn_string_createf(iterpool, "%d", i),
+                                      iterpool));
+
+      if (i % 10 == 0)
+        {
+          svn_fs_root_t *rev_root;
+
+          SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev,
+                                       iterpool));
+          SVN_ERR(svn_fs_copy(rev_root, "A/B", txn_root,
+                              apr_psprintf(iterpool, "B%d", i), iterpool));
+        }
+
+      /* A text large enough to get spilled to disk. */
+      if (i == LOAD_SOURCE_REVS / 2)
+        {
+          svn_stringbuf_t *large = svn_stringbuf_create_empty(iterpool);
+
+          while (large->len < 0x180000)
+            svn_stringbuf_appendcstr(large,
+                                     apr_psprintf(iterpool, "%" APR_SIZE_T_FMT
+                                                  "\n", large->len));
+
+          SVN_ERR(svn_fs_make_file(txn_root, "large", iterpool));
+          SVN_ERR(svn_test__set_file_contents(txn_root, "large", large->data,
+                                              iterpool));
+        }
+
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, *repos, &youngest_rev, txn,
+                                      iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Dump all of REPOS into *DUMP_DATA, using deltas if USE_DELTAS is set,
+ * with JOBS threads.  Allocate the result in POOL. */
+static svn_error_t *
+dump_repos(svn_stringbuf_t **dump_data,
+           svn_repos_t *repos,
+           svn_boolean_t use_deltas,
+           int jobs,
+           apr_pool_t *pool)
+{
+  svn_stream_t *stream;
+
+  *dump_data = svn_stringbuf_create_empty(pool);
+  stream = svn_stream_from_stringbuf(*dump_data, pool);
+  SVN_ERR(svn_repos_dump_fs5(repos, stream,
+                             SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
+                             FALSE, use_deltas, FALSE, TRUE, TRUE, jobs,
+                             NULL, NULL, NULL, NULL, NULL, NULL, pool));
+
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+/* Load DUMP_DATA into the new repository NAME with JOBS threads and
+ * return it in *REPOS.  Return the load error, if any.  Use OPTS and POOL
+ * as usual. */
+static svn_error_t *
+load_repos(svn_repos_t **repos,
+           const char *name,
+           svn_stringbuf_t *dump_data,
+           int jobs,
+           const svn_test_opts_t *opts,
+           apr_pool_t *pool)
+{
+  svn_stream_t *stream = svn_stream_from_stringbuf(dump_data, pool);
+
+  SVN_ERR(svn_test__create_repos(repos, name, opts, pool));
+  return svn_error_trace(svn_repos_load_fs7(*repos, stream,
+                                            SVN_INVALID_REVNUM,
+                                            SVN_INVALID_REVNUM,
+                                            svn_repos_load_uuid_default,
+                                            NULL, FALSE, FALSE, TRUE,
+                                            FALSE, FALSE, jobs,
+                                            NULL, NULL, NULL, NULL,
+                                            pool));
+}
+
+static svn_error_t *
+test_load_pipelined(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_repos_t *source;
+  svn_repos_t *repos;
+  svn_stringbuf_t *expected;
+  svn_stringbuf_t *deltas;
+  svn_stringbuf_t *actual;
+
+  SVN_ERR(create_load_source(&source, "test-repo-load-pipelined", opts,
+                             pool));
+  SVN_ERR(dump_repos(&expected, source, FALSE, 1, pool));
+  SVN_ERR(dump_repos(&deltas, source, TRUE, 1, pool));
+
+  /* Loading fulltexts and deltas concurrently must reproduce the source
+   * repository exactly, including UUID and revision dates. */
+  SVN_ERR(load_repos(&repos, "test-repo-load-pipelined-text", expected, 4,
+                     opts, pool));
+  SVN_ERR(dump_repos(&actual, repos, FALSE, 1, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(expected, actual));
+
+  SVN_ERR(load_repos(&repos, "test-repo-load-pipelined-delta", deltas, 2,
+                     opts, pool));
+  SVN_ERR(dump_repos(&actual, repos, FALSE, 1, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(expected, actual));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_load_pipelined_error(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+  svn_repos_t *source;
+  svn_repos_t *repos;
+  svn_stringbuf_t *dump_data;
+  svn_revnum_t bad_rev = LOAD_SOURCE_REVS - 5;
+  svn_revnum_t youngest_rev;
+  const char *revision_header;
+  char *checksum;
+
+  SVN_ERR(create_load_source(&source, "test-repo-load-pipelined-err", opts,
+                             pool));
+  SVN_ERR(dump_repos(&dump_data, source, FALSE, 1, pool));
+
+  /* Corrupt the first text checksum in BAD_REV. */
+  revision_header = apr_psprintf(pool, "\nRevision-number: %ld\n",
+                                 bad_rev);
+  checksum = strstr(dump_data->data, revision_header);
+  SVN_TEST_ASSERT(checksum);
+  checksum = strstr(checksum, SVN_REPOS_DUMPFILE_TEXT_CONTENT_MD5 ": ");
+  SVN_TEST_ASSERT(checksum);
+  checksum += strlen(SVN_REPOS_DUMPFILE_TEXT_CONTENT_MD5 ": ");
+  *checksum = *checksum == '0' ? '1' : '0';
+
+  /* The load must fail at the same revision as a single-threaded one
+   * and all revisions before that must have been committed. */
+  SVN_TEST_ASSERT_ANY_ERROR(load_repos(&repos,
+                                       "test-repo-load-pipelined-err-1",
+                                       dump_data, 1, opts, pool));
+  SVN_ERR(svn_fs_youngest_rev(&youngest_rev, svn_repos_fs(repos), pool));
+  SVN_TEST_ASSERT(youngest_rev == bad_rev - 1);
+
+  SVN_TEST_ASSERT_ANY_ERROR(load_repos(&repos,
+                                       "test-repo-load-pipelined-err-2",
+                                       dump_data, 2, opts, pool));
+  SVN_ERR(svn_fs_youngest_rev(&youngest_rev, svn_repos_fs(repos), pool));
+  SVN_TEST_ASSERT(youngest_rev == bad_rev - 1);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_dump_concurrent(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_stringbuf_t *expected;
+  svn_stringbuf_t *actual;
+
+  SVN_ERR(create_load_source(&repos, "test-repo-dump-concurrent", opts,
+                             pool));
+
+  /* Concurrent dumps must produce exactly the same stream as sequential
+   * ones, no matter whether they contain fulltexts or deltas. */
+  SVN_ERR(dump_repos(&expected, repos, FALSE, 1, pool));
+  SVN_ERR(dump_repos(&actual, repos, FALSE, 4, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(expected, actual));
+
+  SVN_ERR(dump_repos(&expected, repos, TRUE, 1, pool));
+  SVN_ERR(dump_repos(&actual, repos, TRUE, 3, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(expected, actual));
+
+  return SVN_NO_ERROR;
+}
+
+/* Apply the svndiff data returned by svn_fs__get_stored_svndiff() for
+   SOURCE_ROOT / SOURCE_PATH and TARGET_ROOT / TARGET_PATH to the source
+   contents and return the result in *RESULT.  Set it to NULL if there is
+   no suitable stored delta.  Use POOL for allocations. */
+static svn_error_t *
+apply_stored_svndiff(svn_stringbuf_t **result,
+                     svn_fs_root_t *source_root,
+                     const char *source_path,
+                     svn_fs_root_t *target_root,
+                     const char *target_path,
+                     int max_version,
+                     apr_pool_t *pool)
+{
+  svn_stream_t *svndiff;
+  svn_stream_t *source;
+  svn_filesize_t len;
+  svn_stringbuf_t *data;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  SVN_ERR(svn_fs__get_stored_svndiff(&svndiff, &len, source_root,
+                                     source_path, target_root, target_path,
+                                     max_version, pool, pool));
+  if (svndiff == NULL)
+    {
+      *result = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  /* The reported length must match the actual data. */
+  SVN_ERR(svn_stringbuf_from_stream(&data, svndiff, 0, pool));
+  SVN_ERR(svn_stream_close(svndiff));
+  SVN_TEST_ASSERT(data->len == len);
+
+  if (source_root)
+    SVN_ERR(svn_fs_file_contents(&source, source_root, source_path, pool));
+  else
+    source = svn_stream_empty(pool);
+
+  *result = svn_stringbuf_create_empty(pool);
+  svn_txdelta_apply(source, svn_stream_from_stringbuf(*result, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  SVN_ERR(svn_stream_write(svn_txdelta_parse_svndiff(handler, handler_baton,
+                                                     TRUE, pool),
+                           data->data, &data->len));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_stored_svndiff(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_repos_t *loaded;
+  svn_stringbuf_t *expected;
+  svn_stringbuf_t *deltas;
+  svn_stringbuf_t *actual;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_fs_root_t *root1;
+  svn_fs_root_t *root2;
+  svn_revnum_t rev;
+  svn_stringbuf_t *text;
+  svn_stringbuf_t *result;
+  int i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-stored-svndiff", opts,
+                                 pool));
+  fs = svn_repos_fs(repos);
+
+  text = svn_stringbuf_create_empty(pool);
+  for (i = 0; i < 1000; ++i)
+    svn_stringbuf_appendcstr(text, apr_psprintf(pool, "line %d\n", i));
+
+  /* r1: Add two files. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_make_file(txn_root, "foo", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "foo", text->data, pool));
+  SVN_ERR(svn_fs_make_file(txn_root, "bar", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "bar", "bar\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &rev, txn, pool));
+  SVN_ERR(svn_fs_revision_root(&root1, fs, rev, pool));
+
+  /* r2: Modify one of them. */
+  svn_stringbuf_appendcstr(text, "one more line\n");
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "foo", text->data, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &rev, txn, pool));
+  SVN_ERR(svn_fs_revision_root(&root2, fs, rev, pool));
+
+  /* The delta against the predecessor is stored as such. */
+  SVN_ERR(apply_stored_svndiff(&result, root1, "foo", root2, "foo", 2,
+                               pool));
+  SVN_TEST_ASSERT(result);
+  SVN_TEST_STRING_ASSERT(result->data, text->data);
+
+  /* New files are stored as self-deltas. */
+  SVN_ERR(apply_stored_svndiff(&result, NULL, NULL, root1, "bar", 2,
+                               pool));
+  SVN_TEST_ASSERT(result);
+  SVN_TEST_STRING_ASSERT(result->data, "bar\n");
+
+  /* Anything else must be computed by the caller. */
+  SVN_ERR(apply_stored_svndiff(&result, root1, "bar", root2, "foo", 2,
+                               pool));
+  SVN_TEST_ASSERT(result == NULL);
+  SVN_ERR(apply_stored_svndiff(&result, root1, "foo", root2, "foo", -1,
+                               pool));
+  SVN_TEST_ASSERT(result == NULL);
+
+  /* Dumps that reuse the stored deltas must load as usual. */
+  SVN_ERR(dump_repos(&expected, repos, FALSE, 1, pool));
+  SVN_ERR(dump_repos(&deltas, repos, TRUE, 1, pool));
+  SVN_ERR(load_repos(&loaded, "test-repo-stored-svndiff-load", deltas, 1,
+                     opts, pool));
+  SVN_ERR(dump_repos(&actual, loaded, FALSE, 1, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(expected, actual));
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -284,6 +638,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test dumping with r0 mergeinfo"),
     SVN_TEST_OPTS_PASS(test_load_r0_mergeinfo,
                        "test loading with r0 mergeinfo"),
+    SVN_TEST_OPTS_PASS(test_load_pipelined,
+                       "test multi-threaded loading"),
+    SVN_TEST_OPTS_PASS(test_load_pipelined_error,
+                       "test multi-threaded loading of corrupt data"),
+    SVN_TEST_OPTS_PASS(test_dump_concurrent,
+                       "test multi-threaded dumping"),
+    SVN_TEST_OPTS_PASS(test_stored_svndiff,
+                       "test dumping stored svndiff data"),
     SVN_TEST_NULL
   };
 
@@ -34,6 +34,7 @@
 #include "svn_hash.h"
 #include "svn_repos.h"
 #include "svn_path.h"
+#include "svn_dirent_uri.h"
 #include "svn_delta.h"
 #include "svn_config.h"
 #include "svn_props.h"
@@ -45,6 +46,9 @@
 /* be able to look into svn_config_t */
 #include "../../libsvn_subr/config_impl.h"
 
+/* for the log index internals */
+#include "../../libsvn_repos/repos.h"
+
 #include "../svn_test_fs.h"
 
 #include "dir-delta-editor.h"
@@ -4466,6 +4470,200 @@ test_list(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_repos_log_entry_receiver_t.  Append a short description
+   of LOG_ENTRY to the svn_stringbuf_t BATON. */
+static svn_error_t *
+log_index_receiver(void *baton,
+                   svn_repos_log_entry_t *log_entry,
+                   apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buf = baton;
+
+  svn_stringbuf_appendcstr(buf,
+                           apr_psprintf(scratch_pool, "r%ld%s%s ",
+                                        log_entry->revision,
+                                        log_entry->has_children ? "+" : "",
+                                        log_entry->subtractive_merge
+                                          ? "-" : ""));
+  return SVN_NO_ERROR;
+}
+
+/* Return the 'svn log -g' output for PATH in REPOS as a short string in
+   *LOG, allocated in POOL. */
+static svn_error_t *
+get_merged_log(const char **log,
+               svn_repos_t *repos,
+               const char *path,
+               apr_pool_t *pool)
+{
+  svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+  apr_array_header_t *paths = apr_array_make(pool, 1, sizeof(const char *));
+
+  APR_ARRAY_PUSH(paths, const char *) = path;
+  SVN_ERR(svn_repos_get_logs5(repos, paths, SVN_INVALID_REVNUM, 0, 0,
+                              FALSE, TRUE, NULL, NULL, NULL, NULL, NULL,
+                              log_index_receiver, buf, pool));
+
+  *log = buf->data;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_log_index(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev;
+  svn_repos__log_index_t *index;
+  svn_revnum_t indexed_rev;
+  const char *log_without_index, *log_with_index;
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-log-index", opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* r1: The greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r2: Branch A to B. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "B", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r3: Change A/mu. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "new mu\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r4: Merge r3 to B. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "B/mu", "new mu\n", pool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "B", SVN_PROP_MERGEINFO,
+                                  svn_string_create("/A:3", pool), pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* No index, yet. */
+  SVN_ERR(svn_repos__log_index_open(&index, repos, svn_sqlite__mode_readonly,
+                                    pool, pool));
+  SVN_TEST_ASSERT(index == NULL);
+  SVN_ERR(get_merged_log(&log_without_index, repos, "/B", pool));
+  SVN_TEST_ASSERT(strstr(log_without_index, "r4+ ") != NULL);
+
+  /* The index must not change the result. */
+  SVN_ERR(svn_repos_build_log_index(repos, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_repos__log_index_open(&index, repos, svn_sqlite__mode_readonly,
+                                    subpool, subpool));
+  SVN_TEST_ASSERT(index != NULL);
+  SVN_ERR(svn_repos__log_index_youngest(&indexed_rev, index, pool));
+  SVN_TEST_ASSERT(indexed_rev == youngest_rev);
+
+  SVN_ERR(get_merged_log(&log_with_index, repos, "/B", pool));
+  SVN_TEST_STRING_ASSERT(log_with_index, log_without_index);
+
+  /* r5: Reverse-merge r3 from B.  The commit extends the index. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "B/mu",
+                                      "This is the file 'mu'.\n", pool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "B", SVN_PROP_MERGEINFO,
+                                  NULL, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_repos__log_index_youngest(&indexed_rev, index, pool));
+  SVN_TEST_ASSERT(indexed_rev == youngest_rev);
+  svn_pool_destroy(subpool);
+
+  SVN_ERR(get_merged_log(&log_with_index, repos, "/B", pool));
+  SVN_TEST_ASSERT(strstr(log_with_index, "r5+ ") != NULL);
+
+  /* Compare against the result without an index. */
+  SVN_ERR(svn_io_remove_file2(svn_dirent_join(svn_repos_path(repos, pool),
+                                              SVN_REPOS__LOG_INDEX_DB, pool),
+                              FALSE, pool));
+  SVN_ERR(get_merged_log(&log_without_index, repos, "/B", pool));
+  SVN_TEST_STRING_ASSERT(log_with_index, log_without_index);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_notify_func_t.  Append the revision numbers of all
+ * svn_repos_notify_verify_rev_end notifications to the array BATON. */
+static void
+record_verified_revision(void *baton,
+                         const svn_repos_notify_t *notify,
+                         apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *revisions = baton;
+  if (notify->action == svn_repos_notify_verify_rev_end)
+    APR_ARRAY_PUSH(revisions, svn_revnum_t) = notify->revision;
+}
+
+static svn_error_t *
+test_verify_concurrently(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t rev;
+  int i;
+  apr_array_header_t *revisions
+    = apr_array_make(pool, 0, sizeof(svn_revnum_t));
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  /* Create a repository with a few revisions in it. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-verify-concurrently",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &rev, txn, pool));
+
+  for (i = 0; i < 20; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(iterpool,
+                                                       "iota version %d\n",
+                                                       i),
+                                          iterpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &rev, txn, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Verify with multiple threads.  Results must arrive in order. */
+  SVN_ERR(svn_repos_verify_fs4(repos, 0, rev, FALSE, FALSE, 4,
+                               record_verified_revision, revisions,
+                               NULL, NULL, NULL, NULL, pool));
+
+  SVN_TEST_ASSERT(revisions->nelts == rev + 1);
+  for (i = 0; i < revisions->nelts; ++i)
+    SVN_TEST_ASSERT(APR_ARRAY_IDX(revisions, i, svn_revnum_t) == i);
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -4537,6 +4735,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "optional authz wildcard performance test"),
     SVN_TEST_OPTS_PASS(test_list,
                        "test svn_repos_list"),
+    SVN_TEST_OPTS_PASS(test_log_index,
+                       "test the log index for svn_repos_get_logs5"),
+    SVN_TEST_OPTS_PASS(test_verify_concurrently,
+                       "verify a repository concurrently"),
     SVN_TEST_NULL
   };
 
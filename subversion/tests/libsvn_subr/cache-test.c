@@ -28,8 +28,10 @@
 #include <apr_time.h>
 
 #include "svn_pools.h"
+#include "svn_dirent_uri.h"
 
 #include "private/svn_cache.h"
+#include "private/svn_task.h"
 #include "svn_private_config.h"
 
 #include "../svn_test.h"
@@ -591,6 +593,310 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
 }
 
 
+/* Number of distinct keys used by the contention test. */
+#define CONTENTION_KEY_COUNT 256
+
+/* Number of lookups each reader thread performs. */
+#define CONTENTION_GETS_PER_THREAD 20000
+
+/* Number of times the writer thread replaces all entries. */
+#define CONTENTION_WRITER_ROUNDS 100
+
+/* Number of words in each cached value. */
+#define CONTENTION_VALUE_WORDS 32
+
+/* Shared state of the contention test threads. */
+typedef struct contention_baton_t
+{
+  /* The cache backend shared by all threads. */
+  svn_membuffer_t *membuffer;
+
+  /* CONTENTION_KEY_COUNT keys, long enough to not fit into the
+   * fingerprint. */
+  const char **keys;
+
+  /* If set, work item 0 is a writer that keeps replacing all entries. */
+  svn_boolean_t with_writer;
+} contention_baton_t;
+
+/* Implements svn_cache__serialize_func_t for arrays of
+ * CONTENTION_VALUE_WORDS words. */
+static svn_error_t *
+serialize_words(void **data,
+                apr_size_t *data_len,
+                void *in,
+                apr_pool_t *pool)
+{
+  *data_len = CONTENTION_VALUE_WORDS * sizeof(apr_uint32_t);
+  *data = apr_pmemdup(pool, in, *data_len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for arrays of
+ * CONTENTION_VALUE_WORDS words. */
+static svn_error_t *
+deserialize_words(void **out,
+                  void *data,
+                  apr_size_t data_len,
+                  apr_pool_t *pool)
+{
+  if (data_len != CONTENTION_VALUE_WORDS * sizeof(apr_uint32_t))
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "Bad size for value in cache");
+
+  *out = apr_pmemdup(pool, data, data_len);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__thread_context_constructor_t.  Like the FS layer
+ * does for each session, give every thread its own cache front-end on
+ * top of the shared backend. */
+static svn_error_t *
+create_contention_cache(void **thread_context,
+                        void *baton,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  contention_baton_t *contention_baton = baton;
+  svn_cache__t *cache;
+
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            &cache, contention_baton->membuffer,
+            serialize_words, deserialize_words,
+            APR_HASH_KEY_STRING, "contention:",
+            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+            result_pool, scratch_pool));
+
+  *thread_context = cache;
+  return SVN_NO_ERROR;
+}
+
+/* Set all entries in CACHE such that every word of the value for the
+ * I-th key is I. */
+static svn_error_t *
+fill_contention_cache(svn_cache__t *cache,
+                      contention_baton_t *baton,
+                      apr_pool_t *scratch_pool)
+{
+  apr_uint32_t value[CONTENTION_VALUE_WORDS];
+  apr_uint32_t i, k;
+
+  for (i = 0; i < CONTENTION_KEY_COUNT; ++i)
+    {
+      for (k = 0; k < CONTENTION_VALUE_WORDS; ++k)
+        value[k] = i;
+
+      SVN_ERR(svn_cache__set(cache, baton->keys[i], value, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.  Hammer the cache in
+ * THREAD_CONTEXT with lookups or, for the writer, with updates. */
+static svn_error_t *
+contention_process(void **result,
+                   void *thread_context,
+                   void *process_baton,
+                   apr_int64_t index,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  contention_baton_t *baton = process_baton;
+  svn_cache__t *cache = thread_context;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  *result = NULL;
+
+  if (baton->with_writer && index == 0)
+    {
+      for (i = 0; i < CONTENTION_WRITER_ROUNDS; ++i)
+        {
+          svn_pool_clear(iterpool);
+          SVN_ERR(fill_contention_cache(cache, baton, iterpool));
+        }
+    }
+  else
+    {
+      for (i = 0; i < CONTENTION_GETS_PER_THREAD; ++i)
+        {
+          apr_uint32_t key = (apr_uint32_t)(i * 7 + index)
+                           % CONTENTION_KEY_COUNT;
+          apr_uint32_t *value;
+          svn_boolean_t found;
+          apr_uint32_t k;
+
+          if (i % 1000 == 0)
+            svn_pool_clear(iterpool);
+
+          SVN_ERR(svn_cache__get((void **)&value, &found, cache,
+                                 baton->keys[key], iterpool));
+
+          /* The writer may have removed the entry just now. */
+          if (!found)
+            {
+              SVN_TEST_ASSERT(baton->with_writer);
+              continue;
+            }
+
+          /* Torn reads would show up as mixed values. */
+          for (k = 0; k < CONTENTION_VALUE_WORDS; ++k)
+            SVN_TEST_ASSERT(value[k] == key);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_contention(const svn_test_opts_t *opts,
+                                apr_pool_t *pool)
+{
+  contention_baton_t baton;
+  svn_cache__t *cache;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int threads;
+  int i;
+
+  /* Use a single segment such that all threads compete for it. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&baton.membuffer,
+                                            4 * 1024 * 1024,
+                                            256 * 1024, 1,
+                                            TRUE, TRUE, pool));
+
+  baton.keys = apr_palloc(pool, CONTENTION_KEY_COUNT * sizeof(*baton.keys));
+  for (i = 0; i < CONTENTION_KEY_COUNT; ++i)
+    baton.keys[i] = apr_psprintf(pool, "contention-test-key-%d", i);
+
+  SVN_ERR(create_contention_cache((void **)&cache, &baton, pool, pool));
+  SVN_ERR(fill_contention_cache(cache, &baton, pool));
+
+  /* Read-only lookups.  Ideally, throughput scales with the number of
+   * threads up to the number of available CPU cores. */
+  baton.with_writer = FALSE;
+  for (threads = 1; threads <= 64; threads *= 2)
+    {
+      apr_time_t start = apr_time_now();
+      apr_time_t duration;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_task__run(threads, threads,
+                            create_contention_cache, &baton,
+                            contention_process, &baton,
+                            NULL, NULL, NULL, NULL, iterpool));
+
+      duration = apr_time_now() - start;
+      if (opts->verbose)
+        printf("%2d threads: %10.0f lookups/s\n", threads,
+               (double)threads * CONTENTION_GETS_PER_THREAD
+                 * APR_USEC_PER_SEC / (duration ? duration : 1));
+    }
+
+  /* Concurrent readers and a writer.  Readers must never see partially
+   * written entries. */
+  baton.with_writer = TRUE;
+  svn_pool_clear(iterpool);
+  SVN_ERR(svn_task__run(9, 9,
+                        create_contention_cache, &baton,
+                        contention_process, &baton,
+                        NULL, NULL, NULL, NULL, iterpool));
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Open the persistent cache file PATH for INSTANCE_ID and YOUNGEST and
+ * return a new revnum cache in *CACHE_P that uses it on top of a fresh
+ * membuffer.  Allocate everything in POOL. */
+static svn_error_t *
+create_persistent_cache(svn_cache__t **cache_p,
+                        const char *path,
+                        const char *instance_id,
+                        svn_revnum_t youngest,
+                        apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__file_tier_t *file_tier;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__file_tier_open(&file_tier, path, 1024 * 1024,
+                                    "test-uuid", instance_id, youngest,
+                                    pool, pool));
+  SVN_ERR(svn_cache__create_persistent_membuffer_cache(
+            cache_p, membuffer, file_tier,
+            serialize_revnum, deserialize_revnum,
+            APR_HASH_KEY_STRING, "cache:",
+            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE,
+            pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_persistent_cache(apr_pool_t *pool)
+{
+#if APR_HAS_MMAP
+  svn_cache__t *cache;
+  svn_boolean_t found;
+  svn_revnum_t *value;
+  svn_revnum_t valueA = 12345;
+  svn_revnum_t valueB = 67890;
+  const char *sb_dir;
+  const char *path;
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  SVN_ERR(svn_test_make_sandbox_dir(&sb_dir, "cache-persistent", pool));
+  path = svn_dirent_join(sb_dir, "cache", pool);
+
+  /* Populate the persistent cache through the membuffer front-end. */
+  SVN_ERR(create_persistent_cache(&cache, path, "instance 1", 10, subpool));
+  SVN_ERR(svn_cache__set(cache, "key A", &valueA, subpool));
+  SVN_ERR(svn_cache__set(cache, "key B", &valueB, subpool));
+  svn_pool_clear(subpool);
+
+  /* A fresh membuffer is empty but the data survives in the file.
+     New revisions don't invalidate the contents. */
+  SVN_ERR(create_persistent_cache(&cache, path, "instance 1", 12, subpool));
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "key A", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*value == valueA);
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "key B", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*value == valueB);
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "key C", pool));
+  SVN_TEST_ASSERT(!found);
+  svn_pool_clear(subpool);
+
+  /* A repository with fewer revisions than before has been replaced
+     and must not see the old contents. */
+  SVN_ERR(create_persistent_cache(&cache, path, "instance 1", 11, subpool));
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "key A", pool));
+  SVN_TEST_ASSERT(!found);
+  SVN_ERR(svn_cache__set(cache, "key A", &valueA, subpool));
+  svn_pool_clear(subpool);
+
+  /* Neither must a different repository instance. */
+  SVN_ERR(create_persistent_cache(&cache, path, "instance 2", 11, subpool));
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "key A", pool));
+  SVN_TEST_ASSERT(!found);
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "key B", pool));
+  SVN_TEST_ASSERT(!found);
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "memory-mapped files are not supported");
+#endif
+}
+
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -616,6 +922,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_OPTS_PASS(test_membuffer_cache_contention,
+                       "membuffer cache lookup scaling under contention"),
+    SVN_TEST_PASS2(test_membuffer_persistent_cache,
+                   "membuffer cache with a persistent file tier"),
     SVN_TEST_NULL
   };
 
@@ -1000,6 +1000,124 @@ test_stream_readline_file_crlf(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Write DATA to a block-compressed stream using COMPRESSION and JOBS,
+   marking a record boundary every RECORD_SIZE bytes.  Read the result
+   back through svn_stream__block_decompressed() and verify it matches. */
+static svn_error_t *
+verify_block_roundtrip(const svn_stringbuf_t *data,
+                       int compression,
+                       int jobs,
+                       apr_size_t record_size,
+                       apr_pool_t *pool)
+{
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *result;
+  svn_stream_t *stream;
+  svn_boolean_t is_compressed;
+  apr_size_t pos;
+
+  stream = svn_stream__block_compressed(
+             svn_stream_from_stringbuf(compressed, pool),
+             compression, jobs, pool);
+  for (pos = 0; pos < data->len; pos += record_size)
+    {
+      apr_size_t len = data->len - pos;
+
+      if (len > record_size)
+        len = record_size;
+      SVN_ERR(svn_stream__block_boundary(stream));
+      SVN_ERR(svn_stream_write(stream, data->data + pos, &len));
+    }
+  SVN_ERR(svn_stream_close(stream));
+
+  SVN_TEST_ASSERT(compressed->len >= 4);
+  SVN_TEST_ASSERT(memcmp(compressed->data, "SVNZ", 4) == 0);
+  if (data->len > 0)
+    SVN_TEST_ASSERT(compressed->len < data->len);
+
+  /* Detection must not change the read position. */
+  stream = svn_stream_from_stringbuf(compressed, pool);
+  SVN_ERR(svn_stream__is_block_compressed(&is_compressed, stream, pool));
+  SVN_TEST_ASSERT(is_compressed);
+
+  stream = svn_stream__block_decompressed(stream, jobs, pool);
+  SVN_ERR(svn_stringbuf_from_stream(&result, stream, 0, pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, data));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_stream_block_compressed(apr_pool_t *pool)
+{
+  static const int compressions[] = { SVN_STREAM__BLOCK_COMPRESSION_ZLIB,
+                                      SVN_STREAM__BLOCK_COMPRESSION_LZ4 };
+  static const int jobs[] = { 1, 4 };
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *result;
+  svn_stream_t *stream;
+  svn_boolean_t is_compressed;
+  int compression;
+  apr_uint32_t seed = 0;
+  int i, k;
+
+  /* Something compressible but not trivial, spanning several blocks. */
+  while (data->len < 0x380000)
+    svn_stringbuf_appendcstr(data,
+                             apr_psprintf(pool, "Line %u of the data\n",
+                                          (unsigned)(svn_test_rand(&seed)
+                                                     % 10000)));
+
+  SVN_ERR(svn_stream__parse_block_compression(&compression, "lz4"));
+  SVN_TEST_ASSERT(compression == SVN_STREAM__BLOCK_COMPRESSION_LZ4);
+  SVN_TEST_ASSERT_ERROR(svn_stream__parse_block_compression(&compression,
+                                                            "bzip2"),
+                        SVN_ERR_BAD_COMPRESSION_METHOD);
+
+  for (i = 0; i < 2; ++i)
+    for (k = 0; k < 2; ++k)
+      {
+        apr_pool_t *iterpool = svn_pool_create(pool);
+
+        /* Small and large records, and the empty stream. */
+        SVN_ERR(verify_block_roundtrip(data, compressions[i], jobs[k],
+                                       1000, iterpool));
+        SVN_ERR(verify_block_roundtrip(data, compressions[i], jobs[k],
+                                       0x180000, iterpool));
+        SVN_ERR(verify_block_roundtrip(svn_stringbuf_create_empty(iterpool),
+                                       compressions[i], jobs[k], 1,
+                                       iterpool));
+
+        svn_pool_destroy(iterpool);
+      }
+
+  /* Uncompressed data gets passed through unchanged. */
+  for (i = 0; i < 8; ++i)
+    {
+      svn_stringbuf_t *plain = svn_stringbuf_ncreate(data->data, i, pool);
+
+      stream = svn_stream_from_stringbuf(plain, pool);
+      SVN_ERR(svn_stream__is_block_compressed(&is_compressed, stream, pool));
+      SVN_TEST_ASSERT(!is_compressed);
+
+      stream = svn_stream__block_decompressed(stream, 1, pool);
+      SVN_ERR(svn_stringbuf_from_stream(&result, stream, 0, pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(result, plain));
+    }
+
+  stream = svn_stream__block_decompressed(
+             svn_stream_from_stringbuf(data, pool), 4, pool);
+  SVN_ERR(svn_stringbuf_from_stream(&result, stream, 0, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, data));
+
+  /* Boundaries on other streams are no-ops. */
+  SVN_ERR(svn_stream__block_boundary(svn_stream_empty(pool)));
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -1037,6 +1155,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test reading LF-terminated lines from file"),
     SVN_TEST_PASS2(test_stream_readline_file_crlf,
                    "test reading CRLF-terminated lines from file"),
+    SVN_TEST_PASS2(test_stream_block_compressed,
+                   "test block-compressed streams"),
     SVN_TEST_NULL
   };
 
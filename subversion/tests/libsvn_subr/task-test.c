@@ -0,0 +1,288 @@
+/*
+ * task-test.c:  a collection of svn_task__* tests
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* ====================================================================
+   To add tests, look toward the bottom of this file.
+
+*/
+
+
+
+#include <apr_pools.h>
+#include <apr_portable.h>
+#include <apr_time.h>
+
+#include "../svn_test.h"
+
+#include "svn_error.h"
+#include "private/svn_atomic.h"
+#include "private/svn_task.h"
+
+/* Number of work items to use in the tests. */
+#define ITEM_COUNT 1000
+
+/* Baton used by the test callbacks. */
+typedef struct test_baton_t
+{
+  /* Number of thread contexts that have been constructed. */
+  volatile svn_atomic_t contexts;
+
+  /* Next index that we expect to see in output_func. */
+  apr_int64_t expected;
+
+  /* If non-negative, process_func fails for this index. */
+  apr_int64_t fail_at;
+} test_baton_t;
+
+/* Implements svn_task__thread_context_constructor_t. */
+static svn_error_t *
+construct_context(void **thread_context,
+                  void *baton,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  test_baton_t *test_baton = baton;
+  svn_atomic_inc(&test_baton->contexts);
+
+  *thread_context = apr_pcalloc(result_pool, sizeof(apr_int64_t));
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.  Return the square of INDEX. */
+static svn_error_t *
+process_func(void **result,
+             void *thread_context,
+             void *process_baton,
+             apr_int64_t index,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  test_baton_t *test_baton = process_baton;
+  apr_int64_t *value = apr_palloc(result_pool, sizeof(*value));
+  apr_int64_t *items_processed = thread_context;
+
+  if (index == test_baton->fail_at)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Failing item %" APR_INT64_T_FMT, index);
+
+  /* Per-thread context must be available. */
+  SVN_ERR_ASSERT(items_processed);
+  ++*items_processed;
+
+  *value = index * index;
+  *result = value;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Check the order and the result. */
+static svn_error_t *
+output_func(void *result,
+            void *output_baton,
+            apr_int64_t index,
+            apr_pool_t *scratch_pool)
+{
+  test_baton_t *test_baton = output_baton;
+  apr_int64_t *value = result;
+
+  SVN_TEST_ASSERT(index == test_baton->expected);
+  SVN_TEST_ASSERT(*value == index * index);
+  test_baton->expected++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Process ITEM_COUNT items with CONCURRENCY threads and verify that the
+ * output arrives complete and in order. */
+static svn_error_t *
+check_ordered_output(int concurrency,
+                     apr_pool_t *pool)
+{
+  test_baton_t baton = { 0 };
+  baton.fail_at = -1;
+
+  SVN_ERR(svn_task__run(concurrency, ITEM_COUNT,
+                        construct_context, &baton,
+                        process_func, &baton,
+                        output_func, &baton,
+                        NULL, NULL, pool));
+
+  SVN_TEST_ASSERT(baton.expected == ITEM_COUNT);
+  SVN_TEST_ASSERT(baton.contexts >= 1);
+  SVN_TEST_ASSERT(baton.contexts <= (concurrency > 1 ? concurrency : 1));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_sequential(apr_pool_t *pool)
+{
+  return svn_error_trace(check_ordered_output(1, pool));
+}
+
+static svn_error_t *
+test_concurrent(apr_pool_t *pool)
+{
+  SVN_ERR(check_ordered_output(2, pool));
+  SVN_ERR(check_ordered_output(8, pool));
+  SVN_ERR(check_ordered_output(64, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_empty(apr_pool_t *pool)
+{
+  test_baton_t baton = { 0 };
+  baton.fail_at = -1;
+
+  SVN_ERR(svn_task__run(4, 0, construct_context, &baton,
+                        process_func, &baton, output_func, &baton,
+                        NULL, NULL, pool));
+  SVN_TEST_ASSERT(baton.expected == 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_error_propagation(apr_pool_t *pool)
+{
+  int concurrency;
+  for (concurrency = 1; concurrency <= 8; concurrency *= 2)
+    {
+      test_baton_t baton = { 0 };
+      svn_error_t *err;
+      baton.fail_at = ITEM_COUNT / 2;
+
+      err = svn_task__run(concurrency, ITEM_COUNT,
+                          construct_context, &baton,
+                          process_func, &baton,
+                          output_func, &baton,
+                          NULL, NULL, pool);
+      SVN_TEST_ASSERT_ERROR(err, SVN_ERR_TEST_FAILED);
+
+      /* Nothing after the failing item may have been reported. */
+      SVN_TEST_ASSERT(baton.expected <= baton.fail_at);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton used by the cancellation test. */
+typedef struct cancel_baton_t
+{
+  /* The thread that called svn_task__run(). */
+  apr_os_thread_t caller;
+
+  /* Number of calls to caller_cancel_func() so far. */
+  int calls;
+
+  /* Set if caller_cancel_func() got called from any other thread. */
+  svn_boolean_t wrong_thread;
+} cancel_baton_t;
+
+/* Implements svn_cancel_func_t.  Cancel on the third call and record
+ * whether we get called from any thread but the caller's. */
+static svn_error_t *
+caller_cancel_func(void *baton)
+{
+  cancel_baton_t *cancel_baton = baton;
+
+  if (!apr_os_thread_equal(apr_os_thread_current(), cancel_baton->caller))
+    cancel_baton->wrong_thread = TRUE;
+
+  if (++cancel_baton->calls >= 3)
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.  Block until CANCEL_FUNC reports
+ * cancellation or ten seconds have passed. */
+static svn_error_t *
+blocking_process_func(void **result,
+                      void *thread_context,
+                      void *process_baton,
+                      apr_int64_t index,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  apr_time_t deadline = apr_time_now() + apr_time_from_sec(10);
+
+  while (apr_time_now() < deadline)
+    {
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      apr_sleep(1000);
+    }
+
+  return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                          "Item has not been cancelled");
+}
+
+static svn_error_t *
+test_cancellation(apr_pool_t *pool)
+{
+  int concurrency;
+  for (concurrency = 1; concurrency <= 4; concurrency *= 2)
+    {
+      cancel_baton_t baton = { 0 };
+      svn_error_t *err;
+      baton.caller = apr_os_thread_current();
+
+      err = svn_task__run(concurrency, ITEM_COUNT, NULL, NULL,
+                          blocking_process_func, NULL, NULL, NULL,
+                          caller_cancel_func, &baton, pool);
+      SVN_TEST_ASSERT_ERROR(err, SVN_ERR_CANCELLED);
+      SVN_TEST_ASSERT(!baton.wrong_thread);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* An array of all test functions */
+
+static int max_threads = 1;
+
+static struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(test_sequential,
+                   "process items in the calling thread"),
+    SVN_TEST_PASS2(test_concurrent,
+                   "process items concurrently with ordered output"),
+    SVN_TEST_PASS2(test_empty,
+                   "process an empty item list"),
+    SVN_TEST_PASS2(test_error_propagation,
+                   "processing errors abort the run"),
+    SVN_TEST_PASS2(test_cancellation,
+                   "cancel long-running items from the calling thread"),
+    SVN_TEST_NULL
+  };
+
+SVN_TEST_MAIN
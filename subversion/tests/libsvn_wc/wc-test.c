@@ -35,6 +35,7 @@
 #include "svn_wc.h"
 #include "svn_client.h"
 #include "svn_hash.h"
+#include "svn_props.h"
 
 #include "utils.h"
 
@@ -493,6 +494,79 @@ test_internal_file_modified(const svn_test_opts_t *opts, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Number of files used by test_install_many_files(). */
+#define INSTALL_FILE_COUNT 300
+
+static svn_error_t *
+test_install_many_files(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint64_t id;
+  svn_skel_t *work_item;
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "install_many_files", opts, pool));
+  SVN_ERR(sbox_wc_mkdir(&b, "A"));
+
+  /* Mix plain, keyword-expanded and eol-translated files, so that the
+     concurrently translated files get installed with different sizes. */
+  for (i = 0; i < INSTALL_FILE_COUNT; i++)
+    {
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = apr_psprintf(iterpool, "A/f%d", i);
+      SVN_ERR(sbox_file_write(&b, path, "line 1\nline 2\n$Rev$\n"));
+      SVN_ERR(sbox_wc_add(&b, path));
+
+      if (i % 3 == 0)
+        SVN_ERR(sbox_wc_propset(&b, SVN_PROP_KEYWORDS, "Rev", path));
+      else if (i % 3 == 1)
+        SVN_ERR(sbox_wc_propset(&b, SVN_PROP_EOL_STYLE, "CRLF", path));
+    }
+  SVN_ERR(sbox_wc_commit(&b, ""));
+
+  /* Remove all files and get them back through the work queue. */
+  SVN_ERR(sbox_wc_update(&b, "", 0));
+  SVN_ERR(sbox_wc_update(&b, "", 1));
+
+  for (i = 0; i < INSTALL_FILE_COUNT; i++)
+    {
+      const char *local_abspath;
+      const char *expected;
+      svn_stringbuf_t *actual;
+      svn_boolean_t modified;
+
+      svn_pool_clear(iterpool);
+      local_abspath = sbox_wc_path(&b, apr_psprintf(iterpool, "A/f%d", i));
+
+      if (i % 3 == 0)
+        expected = "line 1\nline 2\n$Rev: 1 $\n";
+      else if (i % 3 == 1)
+        expected = "line 1\r\nline 2\r\n$Rev$\r\n";
+      else
+        expected = "line 1\nline 2\n$Rev$\n";
+
+      SVN_ERR(svn_stringbuf_from_file2(&actual, local_abspath, iterpool));
+      SVN_TEST_STRING_ASSERT(actual->data, expected);
+
+      /* The fileinfo must have been recorded for every file. */
+      SVN_ERR(svn_wc__internal_file_modified_p(&modified, b.wc_ctx->db,
+                                               local_abspath, FALSE,
+                                               iterpool));
+      SVN_TEST_ASSERT(!modified);
+    }
+
+  /* And all work items must have been completed. */
+  SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, b.wc_ctx->db,
+                                   b.wc_abspath, 0, pool, pool));
+  SVN_TEST_ASSERT(work_item == NULL);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 /* ---------------------------------------------------------------------- */
 /* The list of test functions */
 
@@ -515,6 +589,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test legacy commit2"),
     SVN_TEST_OPTS_PASS(test_internal_file_modified,
                        "test internal_file_modified"),
+    SVN_TEST_OPTS_PASS(test_install_many_files,
+                       "install many files through the work queue"),
     SVN_TEST_NULL
   };
 